@@ -19,8 +19,14 @@
 #ifndef MAIDSAFE_ROUTING_API_CONFIG_H_
 #define MAIDSAFE_ROUTING_API_CONFIG_H_
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
@@ -32,6 +38,7 @@
 #include "maidsafe/routing/bootstrap_file_operations.h"
 #include "maidsafe/routing/matrix_change.h"
 #include "maidsafe/routing/message.h"
+#include "maidsafe/routing/profiled_mutex.h"
 
 namespace maidsafe {
 
@@ -47,6 +54,208 @@ enum class DestinationType : int {
 
 typedef std::function<void(std::string)> ResponseFunctor;
 
+// For messages which want no reply, as an alternative to request/response sends taking a
+// ResponseFunctor.  kFireAndForget keeps no state at all once the message is sent on.
+// kDeliveryAcknowledged reports via a DeliveryFunctor whether the first hop accepted the message,
+// which doesn't mean it has reached its destination.  In both modes the receiver is told not to
+// reply.
+enum class SendMode : int {
+  kFireAndForget = 0,
+  kDeliveryAcknowledged
+};
+
+typedef std::function<void(bool /*delivered*/)> DeliveryFunctor;
+
+// One message for Routing::SendBatch.  destination_type is kDirect to send as SendDirect does, or
+// kGroup to send as SendGroup does.
+struct BatchedMessage {
+  BatchedMessage()
+      : destination_id(),
+        destination_type(DestinationType::kDirect),
+        data(),
+        cacheable(false),
+        response_functor() {}
+  BatchedMessage(NodeId destination_id_in, DestinationType destination_type_in,
+                 std::string data_in, bool cacheable_in, ResponseFunctor response_functor_in)
+      : destination_id(std::move(destination_id_in)),
+        destination_type(destination_type_in),
+        data(std::move(data_in)),
+        cacheable(cacheable_in),
+        response_functor(std::move(response_functor_in)) {}
+
+  NodeId destination_id;
+  DestinationType destination_type;
+  std::string data;
+  bool cacheable;
+  ResponseFunctor response_functor;
+};
+
+// Counts of a vault's routing-level cache activity, for cacheable gets and replies of one kind.
+struct CacheCounters {
+  CacheCounters()
+      : lookups(0), hits(0), misses(0), timeouts(0), bytes_served(0), evictions(0), coalesced(0) {}
+
+  uint64_t lookups;       // cacheable gets checked against the caches
+  uint64_t hits;          // of those, answered by the built-in cache or the application's
+  uint64_t misses;        // of those, answered by neither
+  uint64_t timeouts;      // misses for which the application gave no answer in time
+  uint64_t bytes_served;  // cached reply bytes sent, including to coalesced gets
+  uint64_t evictions;     // built-in cache entries displaced by replies of this kind
+  uint64_t coalesced;     // misses held back behind an identical get instead of being sent on
+};
+
+// Everything counted since the node started, by the kind of message: whether it came from and
+// was sent to a single node or a group.  Always zero for clients, which don't cache.
+struct CacheStatistics {
+  enum Kind { kSingleToSingle = 0, kSingleToGroup, kGroupToSingle, kGroupToGroup, kKindCount };
+
+  CacheCounters Total() const {
+    CacheCounters total;
+    for (const auto& kind : by_kind) {
+      total.lookups += kind.lookups;
+      total.hits += kind.hits;
+      total.misses += kind.misses;
+      total.timeouts += kind.timeouts;
+      total.bytes_served += kind.bytes_served;
+      total.evictions += kind.evictions;
+      total.coalesced += kind.coalesced;
+    }
+    return total;
+  }
+
+  CacheCounters by_kind[kKindCount];
+};
+
+// What a vault's routing table size tuning (see Parameters::auto_tune_table_size) last decided.
+struct TableTuningStatistics {
+  TableTuningStatistics()
+      : estimated_network_size(0), mean_hops(0.0), target_table_size(0), adjustments(0) {}
+
+  uint64_t estimated_network_size;
+  double mean_hops;            // over the latest interval with enough deliveries to count
+  uint16_t target_table_size;  // size the routing table is trimmed back towards
+  uint64_t adjustments;        // times the target has been changed
+};
+
+// Estimates of the bytes routing holds, by what holds them, and what it has shed to keep within
+// Parameters::memory_soft_budget and memory_hard_budget.  Containers are counted by their capacity
+// and element sizes, not by what the allocator handed out, so these are lower bounds.  Public keys
+// are shared by every node in the process, so are counted for each.
+struct MemoryStatistics {
+  enum Subsystem {
+    kRoutingTable = 0,
+    kClientRoutingTable,
+    kGroupMatrix,
+    kPublicKeys,
+    kInboundQueues,  // received messages waiting to be handled
+    kTimerTasks,
+    kCache,
+    kSubsystemCount
+  };
+  enum Pressure { kNormal = 0, kSoft, kHard };
+
+  MemoryStatistics()
+      : bytes(), pressure(kNormal), refused_clients(0), dropped_messages(0), cache_evictions(0) {}
+  uint64_t Total() const {
+    uint64_t total(0);
+    for (const auto& subsystem_bytes : bytes)
+      total += subsystem_bytes;
+    return total;
+  }
+
+  uint64_t bytes[kSubsystemCount];
+  Pressure pressure;          // against the budgets at the latest check
+  uint64_t refused_clients;   // connect requests from clients turned down over the soft budget
+  uint64_t dropped_messages;  // received messages dropped over the hard budget
+  uint64_t cache_evictions;   // cache entries evicted to shrink the cache
+};
+
+// A distribution of latencies in the manner of an HDR histogram: below 8 microseconds each value
+// has a bucket of its own, and above that each doubling is split into 8 buckets, so that a value
+// is known to within 12.5%.  Values beyond the last bucket, at over four minutes, are counted in
+// it.
+struct LatencyHistogram {
+  static const int kSubBucketBits = 3;
+  static const int kBucketCount = 208;
+
+  LatencyHistogram();
+  static int BucketIndex(std::chrono::microseconds latency);
+  // The largest latency counted in bucket |index|.
+  static std::chrono::microseconds BucketUpperBound(int index);
+  // The latency below which |percent| of those counted lie, to within the bucket width.  Zero if
+  // none have been counted.
+  std::chrono::microseconds Percentile(double percent) const;
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t count;
+  uint64_t buckets[kBucketCount];
+};
+
+// Counts of the messages of one type this node has had to do with.
+struct MessageTypeCounters {
+  MessageTypeCounters()
+      : received(0), bytes_received(0), dropped_duplicate(0), dropped_hops_to_live(0),
+        dropped_expired(0), dropped_invalid(0), handled_locally(0), forwarded(0), sent(0),
+        bytes_sent(0), send_failures(0) {}
+  void Merge(const MessageTypeCounters& other);
+
+  uint64_t received;              // from peers
+  uint64_t bytes_received;
+  uint64_t dropped_duplicate;     // of those received, seen before
+  uint64_t dropped_hops_to_live;  // of those received, out of hops
+  uint64_t dropped_expired;       // of those received, past the deadline their origin set
+  uint64_t dropped_invalid;       // of those received, otherwise failing validation
+  uint64_t handled_locally;       // of those received, for this node or its group
+  uint64_t forwarded;             // of those received, passed on towards their destination
+  uint64_t sent;                  // to peers, including those forwarded, each hop counting once
+  uint64_t bytes_sent;
+  uint64_t send_failures;         // of those sent, reported lost by the transport
+};
+
+// End-to-end outcomes of the requests of one kind this node sent expecting responses, counted as
+// each leaves its Timer.
+struct RequestStatistics {
+  RequestStatistics()
+      : completed(0), timed_out(0), timed_out_partially_answered(0), cancelled(0), responses(0),
+        expected_responses(0), completion_latency() {}
+  void Merge(const RequestStatistics& other);
+
+  uint64_t completed;                     // having had every expected response
+  uint64_t timed_out;
+  uint64_t timed_out_partially_answered;  // of those timed out, having had some responses
+  uint64_t cancelled;                     // e.g. on the node being destroyed
+  uint64_t responses;                     // over all requests, of the expected_responses
+  uint64_t expected_responses;
+  // From sending to the last expected response arriving, for those completed.
+  LatencyHistogram completion_latency;
+};
+
+// Everything counted since the node started, keyed by message type as routing's protocol numbers
+// them (1 = ping ... 8 = get group, 101 = node-level); types routing doesn't know are under 0.
+// Counting is spread across per-thread shards which this merges, so it's cheap enough to poll.
+struct RoutingStatistics {
+  // Requests' data up to 1 KiB, 16 KiB, 256 KiB and beyond.
+  static const int kRequestSizeClassCount = 4;
+
+  RoutingStatistics()
+      : by_type(), response_latency(), direct_requests(), group_requests(), locks() {}
+  static int RequestSizeClass(size_t data_size);
+  MessageTypeCounters Total() const {
+    MessageTypeCounters total;
+    for (const auto& type : by_type)
+      total.Merge(type.second);
+    return total;
+  }
+
+  std::map<int32_t, MessageTypeCounters> by_type;
+  // From each request being sent to each response to it arriving, for requests expecting any.
+  LatencyHistogram response_latency;
+  // SendDirect and SendGroup requests expecting responses, by the size class of their data.
+  std::array<RequestStatistics, kRequestSizeClassCount> direct_requests, group_requests;
+  // Only filled in by a build with MAIDSAFE_ROUTING_LOCK_PROFILING defined.
+  std::vector<LockStatistics> locks;
+};
+
 // They are passed as a parameter by MessageReceivedFunctor and should be called for responding to
 // the received message. Passing an empty message will mean you don't want to reply.
 typedef std::function<void(const std::string& /*message*/)> ReplyFunctor;
@@ -55,6 +264,15 @@ typedef std::function<void(const std::string& /*message*/)> ReplyFunctor;
 typedef std::function<void(const std::string& /*message*/,
                            ReplyFunctor /*reply functor*/)> MessageReceivedFunctor;
 
+// A message taken from Routing::ReceiveMessages, in place of a call to MessageReceivedFunctor.
+struct ReceivedMessage {
+  ReceivedMessage() : message(), reply() {}
+  ReceivedMessage(std::string message_in, ReplyFunctor reply_in)
+      : message(std::move(message_in)), reply(std::move(reply_in)) {}
+  std::string message;
+  ReplyFunctor reply;
+};
+
 // This is fired to validate a new peer node. User is supposed to validate the node and call
 // ValidateThisNode() method with valid public key.
 typedef std::function<void(asymm::PublicKey /*public_key*/)> GivePublicKeyFunctor;
@@ -79,6 +297,51 @@ typedef std::function<void(const std::vector<NodeInfo>& /*new_close_nodes*/)>
 
 typedef std::function<void(std::shared_ptr<MatrixChange> /*matrix_change*/)> MatrixChangedFunctor;
 
+// This functor fires with true when outbound messages queued locally pass
+// Parameters::outbound_queue_high_water, and with false once they are back under half of it.
+// Senders should hold off sending node-level messages while congested, as further ones may be
+// dropped.
+typedef std::function<void(bool /*congested*/)> CongestionFunctor;
+
+// This functor fires with the serialised contents of the routing table every
+// Parameters::routing_table_snapshot_interval and when routing is destroyed.  Passing the latest
+// snapshot to Join after a restart reconnects to those peers first, rather than rebuilding the
+// routing table from scratch.  Each entry is signed with the node's private key, and only entries
+// which verify against the joining node's public key are used.
+typedef std::function<void(const std::string& /*serialised_snapshot*/)>
+    RoutingTableSnapshotFunctor;
+
+// Routing::SendStream reports through this functor kSuccess once every fragment of the payload has
+// been acknowledged by the destination, or kResponseTimeout if one never was.
+typedef std::function<void(int /*result*/)> StreamSentFunctor;
+
+// This functor fires at the destination of a Routing::SendStream with the reassembled payload.
+typedef std::function<void(const NodeId& /*source_id*/, std::string /*payload*/)>
+    StreamReceivedFunctor;
+
+// One hop of a sampled message's path, see Parameters::path_trace_sampling.
+struct PathHop {
+  PathHop() : node_tag(), received(), queue_delay(0), next_hop_tag() {}
+  std::string node_tag;  // the trailing bytes of the node's ID, as in its route history
+  // By the node's own clock.  At the sender, when the message was passed to routing.
+  std::chrono::system_clock::time_point received;
+  std::chrono::microseconds queue_delay;  // from being received to being handled
+  std::string next_hop_tag;  // empty if the node handled the message rather than sending it on
+};
+
+// The path of a sampled message, from its sender to the node handling it.  A reply carries on the
+// path of its request, so the sender of a request sees the whole round trip in the reply's trace.
+struct PathTrace {
+  PathTrace() : message_id(0), message_type(0), request(false), hops() {}
+  int32_t message_id;
+  int32_t message_type;
+  bool request;
+  std::vector<PathHop> hops;
+};
+
+// This functor fires, on the node which handles it, with the path of each sampled message.
+typedef std::function<void(const PathTrace& /*trace*/)> PathTraceFunctor;
+
 // This functor fires when routing table size is over greedy limit. The furthest unnecessary
 // node in routing table is dropped. Unnecessary is defined as a node who does not have us in
 // it clsoest nodes.
@@ -110,9 +373,42 @@ struct MessageAndCachingFunctors {
   StoreCacheDataFunctor store_cache_data;
 };
 
+// An alternative to MessageAndCachingFunctors::message_received, for applications wanting each
+// node-level request to reach their code through one virtual call rather than a std::function.
+// Rather than deriving from this, wrap a handler type with MakeNodeLevelHandler.
+class NodeLevelHandler {
+ public:
+  virtual ~NodeLevelHandler() {}
+  virtual void MessageReceived(const std::string& message, ReplyFunctor reply) = 0;
+};
+
+namespace detail {
+
+template <typename Handler>
+class NodeLevelHandlerAdapter : public NodeLevelHandler {
+ public:
+  explicit NodeLevelHandlerAdapter(Handler handler) : handler_(std::move(handler)) {}
+  void MessageReceived(const std::string& message, ReplyFunctor reply) final {
+    handler_.MessageReceived(message, std::move(reply));
+  }
+
+ private:
+  Handler handler_;
+};
+
+}  // namespace detail
+
+// |Handler| is any type with a member void MessageReceived(const std::string&, ReplyFunctor).
+// Being known here, its body can be inlined into the one virtual call routing makes.
+template <typename Handler>
+std::shared_ptr<NodeLevelHandler> MakeNodeLevelHandler(Handler handler) {
+  return std::make_shared<detail::NodeLevelHandlerAdapter<Handler>>(std::move(handler));
+}
+
 // Note : Provide TypedMessageAndCachingFunctor for typed message API and MessageAndCachingFunctor
 // for string type message API. Providing both (TypedMessageAndCachingFunctor &
-// MessageAndCachingFunctor) is not allowed.
+// MessageAndCachingFunctor) is not allowed.  A node_level_handler takes the place of
+// message_and_caching.message_received, which is then left empty; its caching functors still apply.
 
 struct Functors {
   Functors()
@@ -123,7 +419,12 @@ struct Functors {
         matrix_changed(),
         set_public_key(),
         request_public_key(),
-        new_bootstrap_contact() {}
+        new_bootstrap_contact(),
+        congestion(),
+        routing_table_snapshot(),
+        stream_received(),
+        path_trace(),
+        node_level_handler() {}
 
   MessageAndCachingFunctors message_and_caching;
   TypedMessageAndCachingFunctor typed_message_and_caching;
@@ -133,6 +434,11 @@ struct Functors {
   GivePublicKeyFunctor set_public_key;
   RequestPublicKeyFunctor request_public_key;
   NewBootstrapContactFunctor new_bootstrap_contact;
+  CongestionFunctor congestion;
+  RoutingTableSnapshotFunctor routing_table_snapshot;
+  StreamReceivedFunctor stream_received;
+  PathTraceFunctor path_trace;
+  std::shared_ptr<NodeLevelHandler> node_level_handler;
 };
 
 }  // namespace routing
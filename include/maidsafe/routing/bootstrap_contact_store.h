@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BOOTSTRAP_CONTACT_STORE_H_
+#define MAIDSAFE_ROUTING_BOOTSTRAP_CONTACT_STORE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/routing/bootstrap_file_operations.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+struct BootstrapContactInfo {
+  BootstrapContactInfo();
+  explicit BootstrapContactInfo(const BootstrapContact& contact_in);
+  BootstrapContact contact;
+  std::chrono::system_clock::time_point last_seen;
+  uint32_t successes, failures;
+  // Smoothed time taken by successful bootstraps
+  std::chrono::milliseconds round_trip;
+};
+
+// The bootstrap file, with what's been seen of each contact, kept in memory.  Changes are queued
+// and appended to the file's journal by a writer thread Parameters::bootstrap_store_write_delay
+// after the first of them, so callers on the network thread never wait on the disk.
+class BootstrapContactStore {
+ public:
+  // Loads |bootstrap_file_path| if it exists, else starts empty and creates it on first write.
+  explicit BootstrapContactStore(const boost::filesystem::path& bootstrap_file_path);
+  // Flushes any queued changes.
+  ~BootstrapContactStore();
+
+  void Add(const BootstrapContact& contact);
+  void Remove(const BootstrapContact& contact);
+  // Both are ignored for a contact not in the store.
+  void RecordSuccess(const BootstrapContact& contact, std::chrono::milliseconds round_trip);
+  void RecordFailure(const BootstrapContact& contact);
+
+  // Newest first, as ReadBootstrapFile returns them.
+  std::vector<BootstrapContactInfo> GetContacts() const;
+  // Best first, as ranked for Routing::Join.
+  BootstrapContacts RankedContacts() const;
+  // Writes queued changes now.
+  void Flush();
+
+ private:
+  struct Change {
+    BootstrapContactInfo info;
+    bool removed;
+  };
+
+  BootstrapContactStore(const BootstrapContactStore&);
+  BootstrapContactStore& operator=(const BootstrapContactStore&);
+
+  std::vector<BootstrapContactInfo>::iterator Find(const BootstrapContact& contact);
+  void Queue(const BootstrapContactInfo& info, bool removed, std::unique_lock<std::mutex>& lock);
+  void Run();
+  void Write(std::unique_lock<std::mutex>& lock);
+
+  const boost::filesystem::path kBootstrapFilePath_;
+  mutable std::mutex mutex_;
+  std::mutex write_mutex_;
+  std::condition_variable cond_var_;
+  // Oldest first, as the file holds them.
+  std::vector<BootstrapContactInfo> contacts_;
+  // At most one per contact, the latest.
+  std::vector<Change> pending_;
+  bool file_exists_, stop_;
+  std::thread writer_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BOOTSTRAP_CONTACT_STORE_H_
@@ -46,6 +46,8 @@ BootstrapContacts ReadBootstrapFile(const boost::filesystem::path& bootstrap_fil
 void WriteBootstrapFile(const BootstrapContacts& bootstrap_contacts,
                         const boost::filesystem::path& bootstrap_file_path);
 
+// Appends the change to the file's journal rather than rewriting it.  For contacts kept along with
+// their bootstrap outcomes, see BootstrapContactStore.
 void UpdateBootstrapFile(const BootstrapContact& bootstrap_contact,
                          const boost::filesystem::path& bootstrap_file_path,
                          bool remove);
@@ -0,0 +1,185 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_FIXED_UINT_H_
+#define MAIDSAFE_ROUTING_FIXED_UINT_H_
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Unsigned integer of a fixed |Bits| bits, held on the stack in 32-bit limbs (least significant
+// first).  Arithmetic wraps modulo 2^Bits, so choose Bits with enough headroom for the values
+// involved.  Used for XOR-distance range arithmetic in place of crypto::BigInt, which
+// heap-allocates for every value.
+template <size_t Bits>
+class FixedUint {
+ public:
+  static_assert(Bits % 32 == 0 && Bits >= NodeId::kSize * 8,
+                "FixedUint must hold a whole number of limbs and at least a NodeId");
+  static const size_t kLimbs = Bits / 32;
+
+  FixedUint() : limbs_() { limbs_.fill(0); }
+  explicit FixedUint(uint32_t value) : limbs_() {
+    limbs_.fill(0);
+    limbs_[0] = value;
+  }
+  // The value of |node_id| read as a big-endian integer.
+  explicit FixedUint(const NodeId& node_id) : limbs_() {
+    limbs_.fill(0);
+    const std::string raw(node_id.string());
+    assert(raw.size() == NodeId::kSize);
+    for (size_t index(0); index != NodeId::kSize; ++index)
+      SetByte(NodeId::kSize - 1 - index, static_cast<unsigned char>(raw[index]));
+  }
+  // The XOR distance between |lhs| and |rhs|, without constructing an intermediate NodeId.
+  FixedUint(const NodeId& lhs, const NodeId& rhs) : limbs_() {
+    limbs_.fill(0);
+    const std::string lhs_raw(lhs.string()), rhs_raw(rhs.string());
+    assert(lhs_raw.size() == NodeId::kSize && rhs_raw.size() == NodeId::kSize);
+    for (size_t index(0); index != NodeId::kSize; ++index)
+      SetByte(NodeId::kSize - 1 - index,
+              static_cast<unsigned char>(lhs_raw[index] ^ rhs_raw[index]));
+  }
+
+  FixedUint& operator+=(const FixedUint& other) {
+    uint64_t carry(0);
+    for (size_t index(0); index != kLimbs; ++index) {
+      carry += static_cast<uint64_t>(limbs_[index]) + other.limbs_[index];
+      limbs_[index] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    return *this;
+  }
+  // Wraps modulo 2^Bits if |other| is the greater
+  FixedUint& operator-=(const FixedUint& other) {
+    int64_t borrow(0);
+    for (size_t index(0); index != kLimbs; ++index) {
+      int64_t difference(static_cast<int64_t>(limbs_[index]) - other.limbs_[index] - borrow);
+      borrow = difference < 0 ? 1 : 0;
+      limbs_[index] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+    return *this;
+  }
+  FixedUint& operator*=(uint32_t factor) {
+    uint64_t carry(0);
+    for (size_t index(0); index != kLimbs; ++index) {
+      carry += static_cast<uint64_t>(limbs_[index]) * factor;
+      limbs_[index] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    return *this;
+  }
+  FixedUint& operator/=(uint32_t divisor) {
+    assert(divisor != 0);
+    uint64_t remainder(0);
+    for (size_t index(kLimbs); index != 0; --index) {
+      remainder = (remainder << 32) | limbs_[index - 1];
+      limbs_[index - 1] = static_cast<uint32_t>(remainder / divisor);
+      remainder %= divisor;
+    }
+    return *this;
+  }
+  FixedUint& operator<<=(size_t shift) {
+    const size_t kLimbShift(shift / 32), kBitShift(shift % 32);
+    for (size_t index(kLimbs); index != 0; --index) {
+      const size_t kTarget(index - 1);
+      uint64_t value(0);
+      if (kTarget >= kLimbShift) {
+        value = static_cast<uint64_t>(limbs_[kTarget - kLimbShift]) << kBitShift;
+        if (kBitShift != 0 && kTarget > kLimbShift)
+          value |= limbs_[kTarget - kLimbShift - 1] >> (32 - kBitShift);
+      }
+      limbs_[kTarget] = static_cast<uint32_t>(value);
+    }
+    return *this;
+  }
+  FixedUint& operator>>=(size_t shift) {
+    const size_t kLimbShift(shift / 32), kBitShift(shift % 32);
+    for (size_t index(0); index != kLimbs; ++index) {
+      uint64_t value(0);
+      if (index + kLimbShift < kLimbs) {
+        value = limbs_[index + kLimbShift] >> kBitShift;
+        if (kBitShift != 0 && index + kLimbShift + 1 < kLimbs)
+          value |= static_cast<uint64_t>(limbs_[index + kLimbShift + 1]) << (32 - kBitShift);
+      }
+      limbs_[index] = static_cast<uint32_t>(value);
+    }
+    return *this;
+  }
+
+  friend FixedUint operator+(FixedUint lhs, const FixedUint& rhs) { return lhs += rhs; }
+  friend FixedUint operator-(FixedUint lhs, const FixedUint& rhs) { return lhs -= rhs; }
+  friend FixedUint operator*(FixedUint lhs, uint32_t rhs) { return lhs *= rhs; }
+  friend FixedUint operator/(FixedUint lhs, uint32_t rhs) { return lhs /= rhs; }
+  friend FixedUint operator<<(FixedUint lhs, size_t rhs) { return lhs <<= rhs; }
+  friend FixedUint operator>>(FixedUint lhs, size_t rhs) { return lhs >>= rhs; }
+
+  friend bool operator==(const FixedUint& lhs, const FixedUint& rhs) {
+    return lhs.limbs_ == rhs.limbs_;
+  }
+  friend bool operator!=(const FixedUint& lhs, const FixedUint& rhs) { return !(lhs == rhs); }
+  friend bool operator<(const FixedUint& lhs, const FixedUint& rhs) {
+    for (size_t index(kLimbs); index != 0; --index) {
+      if (lhs.limbs_[index - 1] != rhs.limbs_[index - 1])
+        return lhs.limbs_[index - 1] < rhs.limbs_[index - 1];
+    }
+    return false;
+  }
+  friend bool operator>(const FixedUint& lhs, const FixedUint& rhs) { return rhs < lhs; }
+  friend bool operator<=(const FixedUint& lhs, const FixedUint& rhs) { return !(rhs < lhs); }
+  friend bool operator>=(const FixedUint& lhs, const FixedUint& rhs) { return !(lhs < rhs); }
+
+  // The low NodeId::kSize bytes as a NodeId.  The value must fit.
+  NodeId ToNodeId() const {
+    std::string raw(NodeId::kSize, '\0');
+    for (size_t index(0); index != NodeId::kSize; ++index)
+      raw[NodeId::kSize - 1 - index] = static_cast<char>(GetByte(index));
+    assert((FixedUint(NodeId(raw)) == *this) && "Value too wide for a NodeId");
+    return NodeId(raw);
+  }
+
+ private:
+  // |index| counts from the least significant byte.
+  unsigned char GetByte(size_t index) const {
+    return static_cast<unsigned char>(limbs_[index / 4] >> (8 * (index % 4)));
+  }
+  void SetByte(size_t index, unsigned char value) {
+    limbs_[index / 4] = (limbs_[index / 4] & ~(0xFFu << (8 * (index % 4)))) |
+                        (static_cast<uint32_t>(value) << (8 * (index % 4)));
+  }
+
+  std::array<uint32_t, kLimbs> limbs_;
+};
+
+// Holds any XOR distance, with 64 bits of headroom so that scaling a distance by a 32-bit factor
+// or summing up to 2^64 distances can't overflow.
+typedef FixedUint<NodeId::kSize * 8 + 64> DistanceUint;
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_FIXED_UINT_H_
@@ -0,0 +1,99 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_GROUP_RANGE_VIEW_H_
+#define MAIDSAFE_ROUTING_GROUP_RANGE_VIEW_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/fixed_uint.h"
+#include "maidsafe/routing/matrix_change.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class GroupMatrix;
+class RoutingTable;
+
+// The IDs from |first| to |last| inclusive, in numeric order.
+struct KeyRange {
+  KeyRange() : first(), last() {}
+  KeyRange(const NodeId& first_in, const NodeId& last_in) : first(first_in), last(last_in) {}
+  NodeId first, last;
+};
+
+bool operator==(const KeyRange& lhs, const KeyRange& rhs);
+
+// The parts of the ID space this node is responsible for, each as sorted, disjoint ranges so that
+// a store ordered by key can be scanned range by range.  |in_range| and |proximal| hold the IDs
+// classed as kInRange and kInProximalRange; |gained| and |lost| the IDs which came into or went
+// out of either since the previous matrix change.
+struct ResponsibilityRanges {
+  ResponsibilityRanges() : in_range(), proximal(), gained(), lost() {}
+  std::vector<KeyRange> in_range, proximal, gained, lost;
+};
+
+// Sorts |ranges| and merges any which overlap or adjoin.
+std::vector<KeyRange> MergeRanges(std::vector<KeyRange> ranges);
+// The IDs in |lhs| but not in |rhs|, both sorted and disjoint.
+std::vector<KeyRange> SubtractRanges(const std::vector<KeyRange>& lhs,
+                                     const std::vector<KeyRange>& rhs);
+// Sets |current|.gained and |current|.lost from the IDs covered by |previous| and |current|.
+void SetRangeChanges(const ResponsibilityRanges& previous, ResponsibilityRanges& current);
+
+// A copy of the parts of the routing state which decide group range, taken under a single lock so
+// that many IDs can then be classified against it without locking.  It goes stale as the close
+// group changes, so should be retaken for each batch of checks.
+class GroupRangeView {
+ public:
+  GroupRangeView();
+
+  // As Routing::IsNodeIdInGroupRange, including throwing if |node_id| isn't this node's ID and this
+  // node isn't in range of |group_id|
+  GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id) const;
+  GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
+  // As Routing::EstimateInGroup
+  bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const;
+  // The ranges in which IsNodeIdInGroupRange(group_id) gives kInRange or kInProximalRange, leaving
+  // |gained| and |lost| empty.  A group ID equal to a node's ID is classed as its neighbours are,
+  // without the special cases IsNodeIdInGroupRange makes of it.
+  ResponsibilityRanges GetResponsibilityRanges() const;
+
+  friend class GroupMatrix;
+  friend class RoutingTable;
+
+ private:
+  NodeId node_id_;
+  bool client_mode_;
+  size_t connected_peers_count_;
+  NodeId furthest_connected_peer_;
+  std::vector<NodeId> unique_node_ids_;
+  DistanceUint radius_;
+  bool ready_to_estimate_;
+  DistanceUint in_group_distance_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_GROUP_RANGE_VIEW_H_
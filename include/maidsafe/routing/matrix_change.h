@@ -19,24 +19,29 @@
 #ifndef MAIDSAFE_ROUTING_MATRIX_CHANGE_H_
 #define MAIDSAFE_ROUTING_MATRIX_CHANGE_H_
 
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
 
 #include "maidsafe/common/config.h"
-#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/fixed_uint.h"
+
 namespace maidsafe {
 
 namespace routing {
 
 class RoutingTable;
 class GroupMatrix;
+class NotificationExecutor;
 
 namespace test {
 class MatrixChangeTest_BEH_CheckHolders_Test;
+class MatrixChangeTest_BEH_CheckHoldersBatch_Test;
 class SingleMatrixChangeTest_BEH_ChoosePmidNode_Test;
 class GroupMatrixTest_BEH_EmptyMatrix_Test;
 }
@@ -61,26 +66,69 @@ class MatrixChange {
   MatrixChange& operator=(MatrixChange other);
 
   CheckHoldersResult CheckHolders(const NodeId& target) const;
+  // Equivalent to calling CheckHolders(target) for each of [first, last), passing each target and
+  // its result to |result_functor| in order.  Holder candidates are reused while successive targets
+  // share enough of their leading bits, so this is fastest for targets in sorted order.
+  template <typename InputIterator, typename ResultFunctor>
+  void CheckHolders(InputIterator first, InputIterator last, ResultFunctor result_functor) const {
+    HolderCandidates candidates;
+    for (; first != last; ++first)
+      result_functor(*first, CheckHolders(*first, candidates));
+  }
+  // As above, splitting |targets| into up to |thread_count| contiguous runs checked concurrently.
+  // The results are in the same order as |targets|.
+  std::vector<CheckHoldersResult> CheckHolders(const std::vector<NodeId>& targets,
+                                               unsigned int thread_count = 1) const;
   NodeId ChoosePmidNode(const std::set<NodeId>& online_pmids, const NodeId& target) const;
-  std::vector<NodeId> lost_nodes() const { return lost_nodes_; }
-  std::vector<NodeId> new_nodes() const { return new_nodes_; }
+  const std::vector<NodeId>& lost_nodes() const;
+  const std::vector<NodeId>& new_nodes() const;
   void Print();
 
   friend void swap(MatrixChange& lhs, MatrixChange& rhs) MAIDSAFE_NOEXCEPT;
   friend class GroupMatrix;
   friend class RoutingTable;
+  friend class NotificationExecutor;
   friend class test::MatrixChangeTest_BEH_CheckHolders_Test;
+  friend class test::MatrixChangeTest_BEH_CheckHoldersBatch_Test;
   friend class test::SingleMatrixChangeTest_BEH_ChoosePmidNode_Test;
   friend class test::GroupMatrixTest_BEH_EmptyMatrix_Test;
 
  private:
-  MatrixChange(NodeId this_node_id, const std::vector<NodeId>& old_matrix,
-               const std::vector<NodeId>& new_matrix);
+  // The nodes of old_matrix_ and new_matrix_ sharing the longest ID prefixes with the last target
+  // checked.  They hold the closest holders for any target sharing at least the *_reuse_prefix
+  // leading bits with that one.
+  struct HolderCandidates {
+    HolderCandidates()
+        : valid(false), last_target(), old_reuse_prefix(0), new_reuse_prefix(0),
+          old_candidates(), new_candidates() {}
+    bool valid;
+    NodeId last_target;
+    size_t old_reuse_prefix, new_reuse_prefix;
+    std::vector<NodeId> old_candidates, new_candidates;
+  };
+
+  // Worked out from the old and new matrices on first use, since most changes are only ever
+  // compared with OldEqualsToNew()
+  struct Derived {
+    Derived() : once(), lost_nodes(), new_nodes(), radius() {}
+    std::once_flag once;
+    std::vector<NodeId> lost_nodes, new_nodes;
+    DistanceUint radius;
+  };
+
+  // |old_matrix| and |new_matrix| are only sorted if they aren't already in order of distance from
+  // |this_node_id|, as GroupMatrix::GetUniqueNodeIds() returns them.
+  MatrixChange(NodeId this_node_id, std::vector<NodeId> old_matrix,
+               std::vector<NodeId> new_matrix);
+  const Derived& GetDerived() const;
+  CheckHoldersResult CheckHolders(const NodeId& target, HolderCandidates& candidates) const;
+  CheckHoldersResult CheckHoldersAmong(const NodeId& target, std::vector<NodeId> old_holders,
+                                       std::vector<NodeId> new_holders) const;
   bool OldEqualsToNew() const;
 
   NodeId node_id_;
-  std::vector<NodeId> old_matrix_, new_matrix_, lost_nodes_, new_nodes_;
-  crypto::BigInt radius_;
+  std::vector<NodeId> old_matrix_, new_matrix_;
+  std::unique_ptr<Derived> derived_;
 };
 
 }  // namespace routing
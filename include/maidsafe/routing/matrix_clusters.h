@@ -0,0 +1,65 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MATRIX_CLUSTERS_H_
+#define MAIDSAFE_ROUTING_MATRIX_CLUSTERS_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/matrix_update.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The nodes of a MatrixModel whose IDs share a leading run of bits, so that network_viewer can
+// draw a network too large to show node by node.  Prefixes are written as '0's and '1's.
+struct MatrixCluster {
+  MatrixCluster() : prefix(), nodes(), links() {}
+
+  std::string prefix;
+  std::vector<NodeId> nodes;  // sorted
+  // For each other cluster, by prefix, how many of its nodes this cluster's rows hold.  Peers
+  // which aren't themselves in the model count for the cluster their ID falls in, if any.
+  std::map<std::string, size_t> links;
+};
+
+// Whether the leading bits of |node_id| are |prefix|.
+bool HasPrefix(const NodeId& node_id, const std::string& prefix);
+
+// The fewest prefix bits splitting |node_count| nodes into clusters of about |cluster_size| each,
+// assuming their IDs are evenly spread.
+uint16_t ClusterPrefixBits(size_t node_count, size_t cluster_size);
+
+// Divides |model|'s nodes into clusters, sorted by prefix.  Every cluster is split in two while its
+// prefix is shorter than |prefix_bits| or is in |expanded|, and it has more than one node; empty
+// halves are left out.  Drilling down by expanding a cluster then only redivides that cluster.
+std::vector<MatrixCluster> ClusterMatrix(const MatrixModel& model, uint16_t prefix_bits,
+                                         const std::set<std::string>& expanded);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MATRIX_CLUSTERS_H_
@@ -0,0 +1,102 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MATRIX_UPDATE_H_
+#define MAIDSAFE_ROUTING_MATRIX_UPDATE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/tools/network_viewer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The message queue network_viewer creates for MatrixUpdates, and which each node's RoutingTable
+// sends its own to when built with TESTING.
+extern const char kMatrixUpdateQueueName[];
+
+// A node's group matrix as shown by network_viewer: each peer it holds and how it holds it.
+typedef std::map<NodeId, network_viewer::ChildType> MatrixRow;
+
+// One node's change to its MatrixRow.  Each node numbers its updates from 1.  A snapshot carries
+// the whole row, any other update only the peers added or whose type changed, and those removed,
+// since the previous update.  A node which is leaving sends a last update marked |left|.
+struct MatrixUpdate {
+  MatrixUpdate();
+
+  std::string Serialise() const;
+  // Returns false, leaving |update| unspecified, if |serialised| isn't a MatrixUpdate.
+  static bool Parse(const std::string& serialised, MatrixUpdate& update);
+
+  NodeId node_id;
+  uint64_t sequence;
+  bool snapshot;
+  bool left;
+  std::vector<std::pair<NodeId, network_viewer::ChildType>> changed;
+  std::vector<NodeId> removed;
+};
+
+// Returns the update taking |previous| to |current|.
+MatrixUpdate DiffMatrixRows(const NodeId& node_id, uint64_t sequence, const MatrixRow& previous,
+                            const MatrixRow& current);
+MatrixUpdate SnapshotMatrixRow(const NodeId& node_id, uint64_t sequence, const MatrixRow& row);
+MatrixUpdate LeftMatrixUpdate(const NodeId& node_id, uint64_t sequence);
+
+// The rows of every node heard from, as rebuilt from their MatrixUpdates.  A node whose updates
+// arrive with a gap in their sequence, e.g. because the message queue was full, keeps showing its
+// last consistent row until its next snapshot arrives.
+class MatrixModel {
+ public:
+  enum class ApplyResult {
+    kAdded,    // the first snapshot of a node not already in the model
+    kApplied,
+    kIgnored,  // out of sequence, or a diff for a row which is awaiting a snapshot
+    kRemoved   // the node has left
+  };
+
+  MatrixModel();
+  ApplyResult Apply(const MatrixUpdate& update);
+  // Bumped by each update which is applied, so that views can tell when to redraw.
+  uint64_t version() const { return version_; }
+  std::vector<NodeId> Nodes() const;
+  // Empty for a node not heard from.
+  MatrixRow Row(const NodeId& node_id) const;
+
+ private:
+  struct Entry {
+    Entry() : sequence(0), synchronised(false), row() {}
+    uint64_t sequence;
+    bool synchronised;
+    MatrixRow row;
+  };
+
+  std::map<NodeId, Entry> entries_;
+  uint64_t version_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MATRIX_UPDATE_H_
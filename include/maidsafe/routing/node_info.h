@@ -20,6 +20,7 @@
 #define MAIDSAFE_ROUTING_NODE_INFO_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "maidsafe/common/node_id.h"
@@ -32,6 +33,25 @@ namespace maidsafe {
 
 namespace routing {
 
+// An immutable, reference-counted public key.  Valid keys are interned, so that every handle to
+// the same key shares one copy, and copying a handle (or a NodeInfo) costs only a reference count.
+class SharedPublicKey {
+ public:
+  SharedPublicKey();
+  SharedPublicKey(const asymm::PublicKey& public_key);  // NOLINT (implicit)
+  SharedPublicKey& operator=(const asymm::PublicKey& public_key);
+
+  const asymm::PublicKey& get() const;
+  operator const asymm::PublicKey&() const { return get(); }  // NOLINT (implicit)
+  // True if both handles share the same interned key.
+  bool SharesKeyWith(const SharedPublicKey& other) const { return key_ == other.key_; }
+  // Number of distinct valid keys held by any handle in the process.
+  static size_t InternedCount();
+
+ private:
+  std::shared_ptr<const asymm::PublicKey> key_;
+};
+
 struct NodeInfo {
   typedef TaggedValue<NonEmptyString, struct SerialisedNodeInfoTag> serialised_type;
 
@@ -46,7 +66,7 @@ struct NodeInfo {
 
   NodeId node_id;
   NodeId connection_id;  // Id of a node as far as rudp is concerned
-  asymm::PublicKey public_key;
+  SharedPublicKey public_key;
   int32_t rank;
   int32_t bucket;
   rudp::NatType nat_type;
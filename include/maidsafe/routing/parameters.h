@@ -34,6 +34,17 @@ struct Parameters {
   static uint16_t num_chunks_to_cache;
   static uint16_t closest_nodes_size;
   static uint16_t group_size;
+  // Zero has the leader of a group send every member its copy of a group message.  Otherwise the
+  // leader sends to at most group_fan_out members, each passing it on to a share of the rest, and
+  // so on down a tree of close group connections.
+  static uint16_t group_fan_out;
+  // If set, the members of a group send their replies to a single-source group request to the
+  // group's leader, which sends those with identical payloads on as one message.  It does so once
+  // all have replied, or after group_response_aggregation_timeout.  The requester only counts a
+  // merged reply's other senders if it has verify_signatures set, and then only those whose
+  // signatures check out.
+  static bool aggregate_group_responses;
+  static std::chrono::milliseconds group_response_aggregation_timeout;
   static uint16_t proximity_factor;
   static uint16_t max_routing_table_size;  // max size of RoutingTable owned by vault
   static uint16_t routing_table_size_threshold;
@@ -46,18 +57,257 @@ struct Parameters {
   static std::chrono::seconds recovery_time_lag;
   static std::chrono::seconds re_bootstrap_time_lag;
   static std::chrono::seconds find_close_node_interval;
+  // Group matrix changes are coalesced over this interval before being sent to network_viewer
+  static std::chrono::milliseconds matrix_publish_interval;
+  // Every this many group matrix updates sent to network_viewer, one is a full snapshot rather
+  // than a diff, so that a viewer which missed some catches up.
+  static uint16_t matrix_snapshot_period;
+  // Close group and matrix changes which don't alter the close group size are merged over this
+  // window before the functors fire.  Zero fires every change as it happens.
+  static std::chrono::milliseconds group_change_settle_window;
   static uint16_t find_node_repeats_per_num_requested;
   static uint16_t maximum_find_close_node_failures;
+  // Joins and recovery look up this node's closest nodes iteratively, keeping up to
+  // find_nodes_alpha FindNodes queries in flight to the closest candidates yet to be asked.  A
+  // query unanswered after find_nodes_query_timeout is abandoned.  Zero alpha disables the lookup.
+  static uint16_t find_nodes_alpha;
+  static std::chrono::milliseconds find_nodes_query_timeout;
   static uint16_t max_route_history;
+  // When set, and the peer sets it too, a new connection is completed on rudp's validation
+  // messages alone, which carry the responder's close IDs, instead of the ConnectSuccess
+  // acknowledgements following them.  The peer's public key is asked for as soon as the
+  // connection is agreed, while rudp connects.  Off by default.
+  static bool streamlined_handshake;
+  // Up to standby_cache_size nodes outside the routing table but close to this node, learned from
+  // FindNodes responses and group matrix updates, have their keys fetched ahead and are connected
+  // to as soon as a close node is lost.  Zero disables the cache.
+  static uint16_t standby_cache_size;
+  // At most max_concurrent_connect_attempts connects are started at a time in answer to
+  // ConnectRequests, up to max_queued_connect_requests more waiting their turn.  An attempt not
+  // completed within connect_attempt_timeout no longer counts, and a request queued that long is
+  // refused.  A vault also refuses peers which, counting the attempts already running, would be
+  // evicted again.  Zero max_concurrent_connect_attempts disables the limit.
+  static uint16_t max_concurrent_connect_attempts;
+  static uint16_t max_queued_connect_requests;
+  static std::chrono::seconds connect_attempt_timeout;
+  // Connections are credited with being alive by any message received over them or send rudp
+  // confirms.  A routing table peer idle for liveness_idle_time is pinged, and if still silent
+  // liveness_probe_timeout later is dropped without waiting for rudp to time it out.  Peers with
+  // sends outstanding are left to rudp.  Checks run every liveness_check_interval.  Zero
+  // liveness_idle_time, the default, disables probing.
+  static std::chrono::milliseconds liveness_idle_time;
+  static std::chrono::milliseconds liveness_probe_timeout;
+  static std::chrono::milliseconds liveness_check_interval;
+  // A failed send is retried at once via the next closest peer.  Only once every candidate has
+  // failed is the retry delayed, backing off exponentially with jitter from send_retry_base_delay
+  // up to send_retry_max_delay.  The message is dropped after max_send_retries failed attempts.
+  static uint16_t max_send_retries;
+  static std::chrono::milliseconds send_retry_base_delay;
+  static std::chrono::milliseconds send_retry_max_delay;
+  // Messages of up to coalesced_message_size_limit bytes to the same connection are packed into a
+  // single rudp send of at most max_coalesced_batch_size bytes, which is flushed no later than
+  // coalesce_flush_delay after its first message was queued.  Messages which aren't coalesced
+  // flush the peer's batch ahead of them.  A zero delay, the default, disables coalescing.
+  static uint32_t coalesced_message_size_limit;
+  static uint32_t max_coalesced_batch_size;
+  static std::chrono::milliseconds coalesce_flush_delay;
+  // When set, the next hop is the peer with the lowest expected latency among the
+  // latency_aware_candidates peers closest to the destination which are closer than this node.
+  static bool latency_aware_routing;
+  static uint16_t latency_aware_candidates;
+  // Outside the close group, where XOR distance leaves a free choice of peer within a bucket, a
+  // full table replaces the slowest peer in a candidate's bucket with the candidate if its measured
+  // or predicted round trip (see network_coordinates.h) is at most proximity_replacement_percent
+  // of the slowest's.  Zero disables this.
+  static uint16_t proximity_replacement_percent;
+  // When set, and the group matrix knows no closer node, the next hop is whichever of the
+  // lookahead_candidates peers closest to the destination, all closer than this node, has itself or
+  // a peer of its own closest to it, judged from summaries of their routing tables (see
+  // table_summaries.h).  A summary holds up to table_summary_size IDs.  It is carried on ping
+  // responses, and the liveness checks ping each peer whose summary is table_summary_interval old.
+  static bool lookahead_routing;
+  static uint16_t lookahead_candidates;
+  static uint16_t table_summary_size;
+  static std::chrono::seconds table_summary_interval;
+  // At most max_in_flight_per_peer node-level messages are handed to rudp per connection at once;
+  // more wait in a local queue of up to max_queued_per_peer, beyond which they are dropped.
+  // Routing messages are never held back.  outbound_queue_high_water is the total queued at
+  // which Functors::congestion fires.
+  static uint32_t max_in_flight_per_peer;
+  static uint32_t max_queued_per_peer;
+  static uint32_t outbound_queue_high_water;
+  // Queued node-level responses are sent response_send_weight at a time for each queued request,
+  // and a full queue makes room for a response by dropping its newest request.
+  static uint16_t response_send_weight;
+  // Up to route_cache_size next hops which messages were last sent on successfully are kept, keyed
+  // by the leading route_cache_prefix_bits of the destination ID.  Zero size disables the cache.
+  static uint32_t route_cache_size;
+  static uint16_t route_cache_prefix_bits;
+  // Number of peers a message sent in race mode is forwarded to in parallel by its originator.
+  // The default of one leaves race mode sending as usual.
+  static uint16_t race_send_width;
+  // Node-level messages for destinations this node is not close to are forwarded from their
+  // received bytes, without being parsed, when fast_path_forwarding is set.
+  static bool fast_path_forwarding;
+  // Once a node which joined through a bootstrap relay has relay_retirement_threshold peers in its
+  // routing table, its direct requests still awaiting a reply through the relay are resent over
+  // the routing table.  Zero disables the resend.
+  static uint16_t relay_retirement_threshold;
+  // Routing::SendStream splits a payload into fragments of stream_fragment_size bytes (or
+  // max_data_size, if less), bar a shorter last one, of which up to stream_window are awaiting
+  // acknowledgement at once.  A fragment is sent up to stream_fragment_attempts times.  A receiver
+  // reassembles up to max_incoming_streams payloads of at most max_stream_size bytes at once,
+  // rejecting fragments of any other size, and drops one not completed within
+  // stream_reassembly_timeout of its last fragment.
+  static uint32_t stream_fragment_size;
+  static uint16_t stream_window;
+  static uint16_t stream_fragment_attempts;
+  static uint32_t max_stream_size;
+  static uint16_t max_incoming_streams;
+  static std::chrono::steady_clock::duration stream_reassembly_timeout;
+  // Node-level payloads of at least compression_threshold bytes are deflated at
+  // compression_level on the first hop to a peer which decodes them, and stay compressed until a
+  // node acts on them.  A zero threshold turns compression off.
+  static uint32_t compression_threshold;
+  static int compression_level;
+  // Routing requests ask for the reply to name them by digest rather than carry them back in full,
+  // keeping them themselves until Parameters::default_response_timeout has passed.  Peers which
+  // don't know the option just ignore it.
+  static bool digest_rpc_responses;
+  // Requests for which the sender waits default_response_timeout carry that deadline, and nodes
+  // drop them and their replies once more than message_deadline_tolerance past it by their own
+  // clock, the tolerance allowing for skew between nodes' clocks.
+  static bool message_deadlines;
+  static std::chrono::steady_clock::duration message_deadline_tolerance;
+  // Destinations report how many hops each request took to reach them, and a bucket whose requests
+  // take longer than average keeps up to this many peers beyond bucket_target_size (see
+  // route_quality.h).  Zero keeps every bucket at bucket_target_size.
+  static uint16_t route_quality_max_bucket_bias;
+  // Inbound messages are handled on this many shards, chosen by source ID so that each source's
+  // messages are handled in order.  Routing messages and lost connections have a shard of their
+  // own which is served first.  A data shard sheds messages once max_inbound_queued_per_shard
+  // are waiting.
+  static uint16_t inbound_dispatch_shards;
+  static uint32_t max_inbound_queued_per_shard;
+  // If non-zero, the data shards are spread over this many single-threaded io_services, one per
+  // core, rather than sharing the AsioService's threads, so that each source's messages are handled
+  // on the same core.  With pin_dispatch_threads set, each thread is pinned to its core where the
+  // platform allows.  The routing shard, timers and rudp stay on the AsioService.
+  static uint16_t dispatch_cores;
+  static bool pin_dispatch_threads;
+  // If non-zero, node-level requests for the message_received functor are instead queued for the
+  // application to take in batches on its own threads with Routing::ReceiveMessages.  Once this
+  // many are waiting, further ones are dropped unanswered, so that their senders back off on
+  // timeouts rather than a slow application stalling routing.
+  static uint32_t application_queue_size;
+  // Each node drops messages it has received within the last duplicate_filter_window before doing
+  // any work on them, remembering at most duplicate_filter_capacity of them.
+  static uint32_t duplicate_filter_capacity;
+  static std::chrono::steady_clock::duration duplicate_filter_window;
+  // Node-level messages are signed by their source when sign_node_level_messages is set.  With
+  // verify_signatures set, those this node may act on are dropped unless their signature checks
+  // out; checks run on signature_verification_threads threads in batches of up to
+  // signature_verification_batch_size, and up to verified_signature_cache_size results are kept.
+  static bool sign_node_level_messages;
+  static bool verify_signatures;
+  static uint16_t signature_verification_threads;
+  static uint16_t signature_verification_batch_size;
+  static uint32_t verified_signature_cache_size;
+  // Vaults answer cacheable gets from a built-in cache of the replies passing through them when
+  // chunk_cache_bytes is non-zero, holding up to that many bytes of them and num_chunks_to_cache
+  // entries across chunk_cache_shards shards.  The application's caching functors are then only
+  // consulted on a miss.
+  static uint64_t chunk_cache_bytes;
+  static uint16_t chunk_cache_shards;
+  // While a cacheable get which missed every cache is in flight from a vault, identical ones
+  // arriving there from the same source are held back and answered with its reply.  Off by
+  // default.
+  static bool coalesce_cacheable_gets;
+  // Replies to cacheable gets are only cached on their way back once the get has been seen at
+  // least this many times recently, either by the caching node or by the one replying, so that
+  // popular chunks are cached all along the reverse path and one-off ones nowhere.
+  static uint16_t cache_popularity_threshold;
+  // Clients answer GetGroup from the memberships they've learned, and vaults from the answers
+  // they've recently worked out, up to group_cache_size of them, for group_cache_ttl after each.
+  // Zero group_cache_size disables this.
+  static uint16_t group_cache_size;
+  static std::chrono::steady_clock::duration group_cache_ttl;
+  // Peers' public keys given by Functors::request_public_key are kept, up to
+  // public_key_cache_size of them for public_key_cache_ttl after each, so that reconnecting to a
+  // peer needn't ask for its key again.  Zero public_key_cache_size disables this.
+  static uint16_t public_key_cache_size;
+  static std::chrono::steady_clock::duration public_key_cache_ttl;
   static uint16_t hops_to_live;
   static uint16_t greedy_fraction;
+  // Once a vault's routing table grows past removal_high_watermark, enough of its furthest nodes
+  // are asked at once to drop it to bring the table back down to removal_low_watermark.  A node
+  // evicted either way isn't reconnected to for eviction_backoff, unless it's among this node's
+  // closest_nodes_size closest.
+  static uint16_t removal_high_watermark;
+  static uint16_t removal_low_watermark;
+  static std::chrono::seconds eviction_backoff;
+  // If set, every auto_tune_interval a vault moves its removal watermarks to suit the estimated
+  // network size and the hop counts of the messages it receives, aiming for about log2(network
+  // size) hops.  The table is then kept between auto_tune_min_table_size and its maximum size, with
+  // auto_tune_entries_per_level peers more for each doubling of the network.  The target only moves
+  // in steps of at least auto_tune_hysteresis.
+  static bool auto_tune_table_size;
+  static std::chrono::seconds auto_tune_interval;
+  static uint16_t auto_tune_min_table_size;
+  static uint16_t auto_tune_entries_per_level;
+  static uint16_t auto_tune_hysteresis;
   static std::chrono::steady_clock::duration local_retreival_timeout;
   static uint16_t routing_table_ready_to_response;
   static uint16_t accepted_distance_tolerance;
+  // Number of the most recent network average distance samples the estimate is taken over
+  static uint16_t network_distance_window_size;
   static boost::posix_time::time_duration connect_rpc_prune_timeout;
   static bool append_maidsafe_endpoints;
   static bool append_maidsafe_local_endpoints;
   static bool append_local_live_port_endpoint;
+  // rudp takes one bootstrap at a time, tried against a list of contacts in turn.  The contacts are
+  // ranked by past outcomes and handed over in waves, the first of bootstrap_first_wave_size and
+  // each after it twice the size, so that the best contacts are tried before any dead ones and a
+  // dead contact delays only its own wave.  Zero hands over every contact in one wave.
+  static uint16_t bootstrap_first_wave_size;
+  // Vaults advertise their load from 0 to 255 in connect and find nodes responses: the greater of
+  // their client routing table's occupancy and how near their outbound queue is to
+  // outbound_queue_high_water.  Joiners try lightly loaded bootstrap contacts first and those at
+  // relay_overload_load or above last.  A vault so loaded redirects a client joining through it
+  // to up to relay_redirect_count of its peers which can be bootstrapped off.  Zero
+  // relay_redirect_count disables redirects.
+  static uint8_t relay_overload_load;
+  static uint16_t relay_redirect_count;
+  // Bootstrap file updates are appended to a journal, folded back into the file once the journal
+  // exceeds this many bytes.
+  static uint32_t bootstrap_journal_compaction_size;
+  // How long BootstrapContactStore collects changes before writing them out together
+  static std::chrono::milliseconds bootstrap_store_write_delay;
+  // How often Functors::routing_table_snapshot fires while joined.  Zero fires it only when routing
+  // is destroyed.
+  static std::chrono::seconds routing_table_snapshot_interval;
+  // One in this many node-level messages sent has its path recorded for Functors::path_trace.
+  // Zero records none.
+  static uint32_t path_trace_sampling;
+  // Inbound messages recorded by Routing::RecordInboundTrace but not yet written are allowed this
+  // many bytes.  Messages received beyond that are left out of the trace.
+  static uint32_t inbound_trace_buffer_size;
+  // Every memory_check_interval, the bytes routing holds (see Routing::GetMemoryStatistics) are
+  // compared with these budgets.  Past memory_soft_budget, new client connections are refused and
+  // the chunk cache is cut to half its size; past memory_hard_budget, the cache is emptied and
+  // received node-level messages are dropped rather than queued.  Zero disables a budget.
+  static uint64_t memory_soft_budget;
+  static uint64_t memory_hard_budget;
+  static std::chrono::seconds memory_check_interval;
+  // A node sending at least shortcut_message_threshold messages within shortcut_window to one
+  // destination it isn't connected to asks that destination for a direct connection, held outside
+  // the routing table's budget.  Up to max_shortcuts are held, each closed once it has gone unused
+  // (neither sent over nor received from) for shortcut_idle_time.  Zero shortcut_message_threshold,
+  // the default, disables shortcuts.
+  static uint32_t shortcut_message_threshold;
+  static std::chrono::seconds shortcut_window;
+  static std::chrono::seconds shortcut_idle_time;
+  static uint16_t max_shortcuts;
   static bool caching;
 
  private:
@@ -68,6 +318,22 @@ struct Parameters {
   Parameters& operator=(const Parameters&);
 };
 
+// The node-local limits, fixed for the lifetime of a Routing object, so that differently tuned
+// nodes (e.g. relays and storage vaults) can share a process.  Each defaults to the value in
+// Parameters when the NodeParameters is constructed.  Values which all nodes of a network must
+// agree on, such as closest_nodes_size, are only settable through Parameters.
+struct NodeParameters {
+  NodeParameters();
+
+  uint16_t max_routing_table_size;
+  uint16_t routing_table_size_threshold;
+  uint16_t max_routing_table_size_for_client;
+  uint16_t max_client_routing_table_size;
+  uint16_t greedy_fraction;
+  uint16_t removal_high_watermark;
+  uint16_t removal_low_watermark;
+};
+
 }  // namespace routing
 
 }  // namespace maidsafe
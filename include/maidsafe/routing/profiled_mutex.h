@@ -0,0 +1,121 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PROFILED_MUTEX_H_
+#define MAIDSAFE_ROUTING_PROFILED_MUTEX_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Use of the locks sharing one name, across every node in the process.
+struct LockStatistics {
+  LockStatistics()
+      : name(), acquisitions(0), contended_acquisitions(0), wait_time(0), hold_time(0) {}
+  std::string name;
+  uint64_t acquisitions;
+  uint64_t contended_acquisitions;  // of the acquisitions, those finding the lock already held
+  std::chrono::nanoseconds wait_time, hold_time;
+};
+
+// Counts for all the locks sharing one name, e.g. every RoutingTable's mutex_.
+struct LockProfile {
+  LockProfile() : acquisitions(0), contended_acquisitions(0), wait_nanoseconds(0),
+                  hold_nanoseconds(0) {}
+  std::atomic<uint64_t> acquisitions, contended_acquisitions, wait_nanoseconds, hold_nanoseconds;
+};
+
+// Process-wide register of LockProfiles, in the order their names were first seen.
+class LockProfiler {
+ public:
+  // The profile for |name|, which must be a string literal.  Returned references stay valid for
+  // the life of the process.
+  static LockProfile& Profile(const char* name);
+  static std::vector<LockStatistics> Snapshot();
+};
+
+// A std::mutex which counts its acquisitions, those finding it already held, and the time spent
+// waiting for and holding it, into the LockProfile for its name.  Costs two clock reads per
+// acquisition and some shared atomic adds, so is only used in place of the hot path locks in a
+// build with MAIDSAFE_ROUTING_LOCK_PROFILING defined; see HotPathMutex.
+class ProfiledMutex {
+ public:
+  explicit ProfiledMutex(const char* name);
+  void lock() {
+    if (!mutex_.try_lock()) {
+      const std::chrono::steady_clock::time_point kWaitStart(std::chrono::steady_clock::now());
+      mutex_.lock();
+      acquired_at_ = std::chrono::steady_clock::now();
+      profile_.contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+      profile_.wait_nanoseconds.fetch_add(Nanoseconds(acquired_at_ - kWaitStart),
+                                          std::memory_order_relaxed);
+    } else {
+      acquired_at_ = std::chrono::steady_clock::now();
+    }
+    profile_.acquisitions.fetch_add(1, std::memory_order_relaxed);
+  }
+  bool try_lock() {
+    if (!mutex_.try_lock())
+      return false;
+    acquired_at_ = std::chrono::steady_clock::now();
+    profile_.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  void unlock() {
+    const uint64_t kHeld(Nanoseconds(std::chrono::steady_clock::now() - acquired_at_));
+    mutex_.unlock();
+    profile_.hold_nanoseconds.fetch_add(kHeld, std::memory_order_relaxed);
+  }
+
+ private:
+  ProfiledMutex(const ProfiledMutex&);
+  ProfiledMutex& operator=(const ProfiledMutex&);
+  static uint64_t Nanoseconds(std::chrono::steady_clock::duration duration) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+  }
+
+  std::mutex mutex_;
+  LockProfile& profile_;
+  std::chrono::steady_clock::time_point acquired_at_;  // only touched by the holder
+};
+
+// The type of the locks taken on every message: RoutingTable::mutex_, each Timer shard's mutex,
+// NetworkUtils::running_mutex_ and NetworkStatistics::mutex_.  Named either way, so that both
+// builds construct them alike, but only profiled with MAIDSAFE_ROUTING_LOCK_PROFILING.
+#ifdef MAIDSAFE_ROUTING_LOCK_PROFILING
+typedef ProfiledMutex HotPathMutex;
+#else
+class HotPathMutex : public std::mutex {
+ public:
+  explicit HotPathMutex(const char* /*name*/) {}
+};
+#endif
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PROFILED_MUTEX_H_
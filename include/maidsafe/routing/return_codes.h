@@ -61,7 +61,8 @@ enum ReturnCode {
   kDataSizeNotAllowed = -303011,
   kFailedtoGetEndpoint = -303012,
   kPartialJoinSessionEnded = -303013,
-  kNetworkShuttingDown = -303014
+  kNetworkShuttingDown = -303014,
+  kSendQueueFull = -303015
 };
 
 }  // namespace routing
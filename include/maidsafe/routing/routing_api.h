@@ -31,6 +31,7 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_API_H_
 #define MAIDSAFE_ROUTING_ROUTING_API_H_
 
+#include <chrono>
 #include <condition_variable>
 #include <future>
 #include <memory>
@@ -40,13 +41,18 @@
 
 #include "boost/asio/ip/udp.hpp"
 #include "boost/date_time/posix_time/posix_time_config.hpp"
+#include "boost/filesystem/path.hpp"
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/rsa.h"
 
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/group_range_view.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing_context.h"
 
 namespace maidsafe {
 
@@ -73,6 +79,16 @@ class Routing {
  public:
   // create a non-mutating client
   Routing();
+  // As above, but running on |asio_service|, which may be shared by several Routing objects (e.g.
+  // the vaults of one process).  Each Routing object can be destroyed while the others keep the
+  // service running; handlers it leaves queued there then do nothing.  If |asio_service| is null,
+  // one is created for this object.
+  // |node_parameters| sets this node's own limits, which otherwise come from Parameters.
+  explicit Routing(std::shared_ptr<AsioService> asio_service,
+                   const NodeParameters& node_parameters = NodeParameters());
+  // As above, running on the service shared through |context|.
+  explicit Routing(const RoutingContext& context,
+                   const NodeParameters& node_parameters = NodeParameters());
 
   // Providing :
   // pmid as a paramater will create a non client routing object(vault).
@@ -84,32 +100,75 @@ class Routing {
     asymm::Keys keys;
     keys.private_key = fob.private_key();
     keys.public_key = fob.public_key();
-    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys);
+    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys,
+                    nullptr, NodeParameters());
   }
 
+  // As above, running on |asio_service| or |context| as for the non-mutating client.
+  template <typename FobType>
+  Routing(const FobType& fob, std::shared_ptr<AsioService> asio_service,
+          const NodeParameters& node_parameters = NodeParameters())
+      : pimpl_() {
+    asymm::Keys keys;
+    keys.private_key = fob.private_key();
+    keys.public_key = fob.public_key();
+    InitialisePimpl(detail::is_client<FobType>::value, NodeId(fob.name()->string()), keys,
+                    asio_service, node_parameters);
+  }
+
+  template <typename FobType>
+  Routing(const FobType& fob, const RoutingContext& context,
+          const NodeParameters& node_parameters = NodeParameters())
+      : Routing(fob, context.asio_service(), node_parameters) {}
+
   // Joins the network. Valid method for requesting public key must be provided by the functor,
   // otherwise no node will be added to the routing table and node will fail to join the network.
   // To force the node to use a specific endpoint for bootstrapping, provide peer_endpoint (i.e.
   // private network).
-  void Join(Functors functors, BootstrapContacts bootstrap_contacts = BootstrapContacts());
+  // A routing_table_snapshot from an earlier run (see Functors::routing_table_snapshot) makes the
+  // node bootstrap off and reconnect to its previous peers first, while still looking up its
+  // closest nodes as usual in case they've moved on.
+  void Join(Functors functors, BootstrapContacts bootstrap_contacts = BootstrapContacts(),
+            std::string routing_table_snapshot = std::string());
 
   // WARNING: THIS FUNCTION SHOULD BE ONLY USED TO JOIN FIRST TWO ZERO STATE NODES.
   int ZeroStateJoin(Functors functors, const boost::asio::ip::udp::endpoint& local_endpoint,
                     const boost::asio::ip::udp::endpoint& peer_endpoint, const NodeInfo& peer_info);
 
   // Sends message to a known destnation. (Typed Message API)
+  // If 'race' is set and the receiver is a single node, this node also forwards the message to the
+  // next closest peers in parallel (Parameters::race_send_width in all, one by default), trading
+  // duplicate delivery for lower latency.  Copies share one unique_id, so each node handles only
+  // the first to reach it.
   // Throws on invalid paramaters
   template <typename T>
-  void Send(const T& message);
+  void Send(const T& message, bool race = false);
+  // As above, but the message's contents are moved into the wire message rather than copied.
+  void Send(SingleToSingleMessage&& message, bool race = false);
+  void Send(SingleToGroupMessage&& message, bool race = false);
+  void Send(GroupToSingleMessage&& message, bool race = false);
+  void Send(GroupToGroupMessage&& message, bool race = false);
+  void Send(GroupToSingleRelayMessage&& message, bool race = false);
 
   // Sends message to a known destnation.
   // If a valid response functor is provided, it will be called when:
   // a) the response is receieved or,
   // b) waiting time (Parameters::default_response_timeout) for receiving the response expires
+  // If 'race' is set, the message is sent in parallel as for the typed Send and
+  // 'response_functor' is called for the first response only.
   // Throws on invalid paramaters
   void SendDirect(const NodeId& destination_id,                       // ID of final destination
                   const std::string& message, bool cacheable,  // to cache message content
-                  ResponseFunctor response_functor);                  // Called on response
+                  ResponseFunctor response_functor,                   // Called on response
+                  bool race = false);                                 // Send in race mode
+  // As above, but 'message' is moved into the wire message rather than copied.
+  void SendDirect(const NodeId& destination_id, std::string&& message, bool cacheable,
+                  ResponseFunctor response_functor, bool race = false);
+
+  // As above, but without expecting a response: see SendMode.  'delivery_functor' is required
+  // for SendMode::kDeliveryAcknowledged and ignored otherwise.
+  void SendDirect(const NodeId& destination_id, std::string message, bool cacheable,
+                  SendMode send_mode, DeliveryFunctor delivery_functor = DeliveryFunctor());
 
   // Sends message to Parameters::group_size most closest nodes to destination_id. The node
   // having id equal to destination id is not considered as part of group and will not receive
@@ -121,6 +180,38 @@ class Routing {
   void SendGroup(const NodeId& destination_id,  // ID of final destination or group centre
                  const std::string& message, bool cacheable,  // to cache message content
                  ResponseFunctor response_functor);                  // Called on each response
+  // As above, but 'message' is moved into the wire message rather than copied.
+  void SendGroup(const NodeId& destination_id, std::string&& message, bool cacheable,
+                 ResponseFunctor response_functor);
+  // As above, but without expecting responses: see SendMode.  'delivery_functor' is called once
+  // for the group, and only for SendMode::kDeliveryAcknowledged.
+  void SendGroup(const NodeId& destination_id, std::string message, bool cacheable,
+                 SendMode send_mode, DeliveryFunctor delivery_functor = DeliveryFunctor());
+  // As the first SendGroup, but rather than calling a functor per response, returns a future
+  // resolving to the responses once 'quorum' of the Parameters::group_size members have replied,
+  // or at the timeout to however many have, possibly none.  The remaining replies are then no
+  // longer waited for.  Zero 'quorum' waits for the whole group.  Throws on invalid paramaters.
+  std::future<std::vector<std::string>> SendGroup(const NodeId& destination_id,
+                                                  std::string message, bool cacheable,
+                                                  uint16_t quorum);
+
+  // Sends each of 'messages' as SendDirect or SendGroup would, but routes them together.  Their
+  // next hops are chosen from the same copy of the routing table, messages for the same peer go
+  // out back to back so that they share its outbound batches, and the response expectations are
+  // set up in one pass.  Throws on invalid paramaters, having sent none of the messages.
+  void SendBatch(std::vector<BatchedMessage> messages);
+
+  // As above, for the typed message API.  Throws on invalid paramaters.
+  template <typename T>
+  void SendBatch(std::vector<T> messages);
+
+  // Sends 'data', which may be up to Parameters::max_stream_size bytes, to 'destination_id' as
+  // fragments of Parameters::stream_fragment_size routed one by one, with
+  // Parameters::stream_window of them in flight at once.  The destination's
+  // Functors::stream_received fires with the reassembled payload, and 'stream_sent' here once it
+  // has acknowledged every fragment.  Throws on invalid paramaters.
+  void SendStream(const NodeId& destination_id, std::string data,
+                  StreamSentFunctor stream_sent = StreamSentFunctor());
 
   // Compares own closeness to target against other known nodes' closeness to the target
   bool ClosestToId(const NodeId& target_id);
@@ -140,6 +231,20 @@ class Routing {
   // if kNodeId_ == group_id, it returns kOutwithRange
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id) const;
 
+  // Returns a copy of the state deciding group range, against which any number of
+  // IsNodeIdInGroupRange and EstimateInGroup checks can be made without locking.  Retake it for
+  // each batch of checks, as it isn't updated by later close group changes.
+  GroupRangeView GetGroupRangeView() const;
+
+  // Returns the ID ranges this node is in group or proximal range of, and those gained and lost,
+  // as of the last matrix change.  Vaults can scan their stores by range rather than checking
+  // each key with IsNodeIdInGroupRange.  Empty until the first matrix change.
+  ResponsibilityRanges GetResponsibilityRanges() const;
+
+  // Forgets the cached public key of |node_id|, so that the next connection to it asks
+  // Functors::request_public_key again, e.g. once the upper layer learns the key was revoked.
+  void InvalidatePublicKey(const NodeId& node_id);
+
   // Gets a random connected node from routing table (excluding closest
   // Parameters::closest_nodes_size nodes).
   // Shouldn't be called when routing table is likely to be smaller than closest_nodes_size.
@@ -161,19 +266,55 @@ class Routing {
   // Returns the group matrix
   std::vector<NodeInfo> ClosestNodes();
 
+  // Returns the number of received messages waiting on each inbound dispatch queue
+  // (Parameters::inbound_dispatch_shards of them), followed by the routing control queue's.
+  std::vector<size_t> InboundQueueDepths() const;
+
+  // With Parameters::application_queue_size set, takes up to |max_count| received messages, oldest
+  // first, waiting up to |timeout| for the first.  Each is answered by calling its reply, from any
+  // thread.  Returns none on timing out, when the queue isn't in use, or once shutting down.
+  std::vector<ReceivedMessage> ReceiveMessages(size_t max_count, std::chrono::milliseconds timeout);
+
+  // Returns what this node's routing-level caching has done so far.  Cheap enough to poll.
+  CacheStatistics GetCacheStatistics() const;
+
+  // Returns counts of the messages this node has received, handled, forwarded, dropped and sent,
+  // by message type, and a histogram of its requests' response latencies.  Cheap enough to poll.
+  RoutingStatistics GetStatistics() const;
+
+  // Returns the routing table size this vault last chose for itself, if
+  // Parameters::auto_tune_table_size is set.
+  TableTuningStatistics GetTableTuningStatistics() const;
+
+  // Returns estimates of the bytes routing holds, and what it has shed to keep within
+  // Parameters::memory_soft_budget and memory_hard_budget.  Walks the tables, so poll it sparingly.
+  MemoryStatistics GetMemoryStatistics() const;
+
+  // Starts writing every message and lost connection rudp reports to this node to |path|, as an
+  // inbound trace (see inbound_trace.h) replacing any being recorded.  An empty |path| stops
+  // recording.  Throws std::runtime_error if |path| can't be written.
+  void RecordInboundTrace(const boost::filesystem::path& path);
+
   // Checks if routing table or group matrix contains given node id
   bool IsConnectedVault(const NodeId& node_id);
 
   // Checks if client routing table contains given node id
   bool IsConnectedClient(const NodeId& node_id);
 
+  // Tells this node's close nodes and clients that it is leaving, suggesting replacements from its
+  // close group, so they repair their tables at once rather than on noticing it gone.  Done on
+  // destruction if not before; calling it a little ahead gives the announcements time to be sent.
+  void Leave();
+
   friend class test::GenericNode;
 
  private:
   Routing(const Routing&);
   Routing(const Routing&&);
   Routing& operator=(const Routing&);
-  void InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys);
+  void InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                       std::shared_ptr<AsioService> asio_service,
+                       const NodeParameters& node_parameters);
 
   class Impl;
   std::shared_ptr<Impl> pimpl_;
@@ -187,18 +328,34 @@ template <>
 Routing::Routing(const NodeId& node_id);
 
 template <>
-void Routing::Send(const SingleToSingleMessage& message);
+void Routing::Send(const SingleToSingleMessage& message, bool race);
+template <>
+void Routing::Send(const SingleToGroupMessage& message, bool race);
+template <>
+void Routing::Send(const GroupToSingleMessage& message, bool race);
+template <>
+void Routing::Send(const GroupToGroupMessage& message, bool race);
+template <>
+void Routing::Send(const GroupToSingleRelayMessage& message, bool race);
+
+template <typename T>
+void Routing::Send(const T&, bool) {
+  T::message_type_must_be_one_of_the_specialisations_defined_as_typedefs_in_message_dot_h_file;
+}
+
+template <>
+void Routing::SendBatch(std::vector<SingleToSingleMessage> messages);
 template <>
-void Routing::Send(const SingleToGroupMessage& message);
+void Routing::SendBatch(std::vector<SingleToGroupMessage> messages);
 template <>
-void Routing::Send(const GroupToSingleMessage& message);
+void Routing::SendBatch(std::vector<GroupToSingleMessage> messages);
 template <>
-void Routing::Send(const GroupToGroupMessage& message);
+void Routing::SendBatch(std::vector<GroupToGroupMessage> messages);
 template <>
-void Routing::Send(const GroupToSingleRelayMessage& message);
+void Routing::SendBatch(std::vector<GroupToSingleRelayMessage> messages);
 
 template <typename T>
-void Routing::Send(const T&) {
+void Routing::SendBatch(std::vector<T>) {
   T::message_type_must_be_one_of_the_specialisations_defined_as_typedefs_in_message_dot_h_file;
 }
 
@@ -0,0 +1,65 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTING_CLOCK_H_
+#define MAIDSAFE_ROUTING_ROUTING_CLOCK_H_
+
+#include <chrono>
+#include <functional>
+
+#include "boost/asio/basic_waitable_timer.hpp"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The clock routing's timers and timeouts run on.  It follows std::chrono::steady_clock unless a
+// virtual time source has been installed, as a simulation does so that many nodes sharing one
+// executor thread run deterministically and faster than real time.  The source must be installed
+// before any Routing object is created and removed only once they have all been destroyed, and
+// the time it gives must never go backwards.
+struct RoutingClock {
+  typedef std::chrono::steady_clock::duration duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::steady_clock::time_point time_point;
+  typedef std::function<time_point()> TimeSource;
+
+  static const bool is_steady = true;
+
+  static time_point now();
+  // An empty |time_source| restores real time.
+  static void set_virtual_time(TimeSource time_source);
+  static bool is_virtual();
+};
+
+// A wait on the routing clock blocks for as long as it would on steady_clock, except under virtual
+// time, when the executor polls for expiry instead, as it can't tell how soon that will come.
+struct RoutingClockWaitTraits {
+  static RoutingClock::duration to_wait_duration(const RoutingClock::duration& duration) {
+    return RoutingClock::is_virtual() ? RoutingClock::duration::zero() : duration;
+  }
+};
+
+typedef boost::asio::basic_waitable_timer<RoutingClock, RoutingClockWaitTraits> RoutingTimer;
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTING_CLOCK_H_
@@ -0,0 +1,58 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTING_CONTEXT_H_
+#define MAIDSAFE_ROUTING_ROUTING_CONTEXT_H_
+
+#include <memory>
+
+#include "maidsafe/common/asio_service.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The host-level resources which several Routing objects in one process, e.g. a number of vaults,
+// can share, so that the threads used follow the core count rather than the node count.  Each
+// Routing object keeps its own identity, tables and transport, and can be destroyed while the
+// others carry on.
+class RoutingContext {
+ public:
+  // A |thread_count| of 0 runs one thread per core.
+  explicit RoutingContext(unsigned int thread_count = 0);
+  ~RoutingContext();
+
+  // Stops the shared service, waiting for its threads to finish.  Idempotent.
+  void Stop();
+
+  std::shared_ptr<AsioService> asio_service() const { return asio_service_; }
+  unsigned int thread_count() const { return kThreadCount_; }
+
+ private:
+  RoutingContext(const RoutingContext&);
+  RoutingContext& operator=(const RoutingContext&);
+
+  const unsigned int kThreadCount_;
+  std::shared_ptr<AsioService> asio_service_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTING_CONTEXT_H_
@@ -22,6 +22,7 @@
 #include <chrono>
 #include <future>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -51,6 +52,7 @@ namespace maidsafe {
 namespace routing {
 
 class Routing;
+class SimulatedNetwork;
 namespace protobuf {
 class Message;
 }
@@ -76,6 +78,14 @@ const uint32_t kClientSize(5);
 const uint32_t kServerSize(20);
 const uint32_t kNetworkSize = kClientSize + kServerSize;
 
+// The identities of the vaults and clients which join a network after GenericNetwork::SetUp's
+// zero-state pair, generated up front so that bringing the network up needn't wait on key
+// generation, and so that they can be reused by later networks.
+struct NetworkSnapshot {
+  std::vector<passport::Pmid> vaults;
+  std::vector<passport::Maid> clients;
+};
+
 class GenericNetwork;
 class NodesEnvironment;
 
@@ -144,9 +154,13 @@ void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message)
 
   void PostTaskToAsioService(std::function<void()> functor);
   rudp::NatType nat_type();
+  CacheStatistics GetCacheStatistics() const;
   std::string SerializeRoutingTable();
   passport::Maid GetMaid();
 
+  // Nodes constructed after this is called with a network send over transports of it instead of
+  // rudp, until it's called with null.
+  static void UseSimulatedNetwork(std::shared_ptr<SimulatedNetwork> simulated_network);
   static size_t next_node_id_;
   size_t MessagesSize() const;
   void ClearMessages();
@@ -167,12 +181,16 @@ void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message)
   rudp::NatType nat_type_;
   bool has_symmetric_nat_;
   boost::asio::ip::udp::endpoint endpoint_;
+  // Held so that it outlives routing_'s transport
+  std::shared_ptr<SimulatedNetwork> simulated_network_;
   std::vector<std::string> messages_;
   std::shared_ptr<Routing> routing_;
 
  private:
+  static std::shared_ptr<SimulatedNetwork> simulated_network_in_use_;
   std::mutex health_mutex_;
   int health_;
+  void InitialiseEndpoint();
   void InitialiseFunctors();
 };
 
@@ -196,6 +214,17 @@ class GenericNetwork {
   void SetUpNetwork(size_t total_number_vaults, size_t total_number_clients,
                     size_t num_symmetric_nat_vaults,
                     size_t num_symmetric_nat_clients);
+  // As SetUpNetwork, but joining the snapshot's vaults and then its clients in waves of up to
+  // |wave_size| at once, each wave joining before the next starts, instead of one at a time.
+  void SetUpNetworkInWaves(const NetworkSnapshot& snapshot, size_t wave_size = 8);
+  // Identities for SetUpNetwork(total_number_vaults, total_number_clients) to use, generated
+  // across all cores.
+  static NetworkSnapshot MakeNetworkSnapshot(size_t total_number_vaults,
+                                             size_t total_number_clients);
+  // As MakeNetworkSnapshot, but only generated the first time each size is asked for in a process,
+  // so that tests can share them.
+  static const NetworkSnapshot& SharedNetworkSnapshot(size_t total_number_vaults,
+                                                      size_t total_number_clients);
   void AddNode(bool client_mode, MatrixChangedFunctor matrix_change_functor);
   void AddNode(const passport::Maid& maid, MatrixChangedFunctor matrix_change_functor);
   void AddNode(const passport::Pmid& pmid, MatrixChangedFunctor matrix_change_functor);
@@ -261,7 +290,9 @@ class GenericNetwork {
  private:
   uint16_t NonClientNodesSize() const;
   uint16_t NonClientNonSymmetricNatNodesSize() const;
-  void AddNodeDetails(NodePtr node);
+  // Unless |settle|, returns as soon as |node| has joined, for joining several at once.
+  void AddNodeDetails(NodePtr node, bool settle = true);
+  void JoinInWaves(const std::vector<NodePtr>& nodes, size_t wave_size);
 
   mutable std::mutex mutex_, fobs_mutex_;
   std::vector<boost::asio::ip::udp::endpoint> bootstrap_endpoints_;
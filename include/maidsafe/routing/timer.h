@@ -19,16 +19,18 @@
 #ifndef MAIDSAFE_ROUTING_TIMER_H_
 #define MAIDSAFE_ROUTING_TIMER_H_
 
-#include <condition_variable>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
-#include <iterator>
-#include <map>
+#include <future>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "boost/asio/steady_timer.hpp"
 #include "boost/asio/error.hpp"
 
 #include "maidsafe/common/asio_service.h"
@@ -36,6 +38,9 @@
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/profiled_mutex.h"
+#include "maidsafe/routing/routing_clock.h"
+
 namespace maidsafe {
 
 namespace routing {
@@ -46,112 +51,495 @@ class TimerTest;
 
 typedef int32_t TaskId;
 
+// How a task left the Timer, reported to any outcome observer along with the tag it was added with.
+struct TaskOutcome {
+  enum Ending { kCompleted, kTimedOut, kCancelled };
+  TaskOutcome()
+      : ending(kCompleted), task_id(0), tag(0), expected_response_count(0), response_count(0),
+        elapsed() {}
+  Ending ending;
+  TaskId task_id;
+  uint32_t tag;
+  int expected_response_count, response_count;
+  std::chrono::steady_clock::duration elapsed;  // from being added to completing or ending early
+};
+
 template <typename Response>
 class Timer {
  public:
   typedef std::function<void(Response)> ResponseFunctor;
+  // Called with the time from a task being added to each response AddResponse gives it.
+  typedef std::function<void(std::chrono::steady_clock::duration)> LatencyObserver;
+  // Called once as each task completes, times out or is cancelled, outside the Timer's locks.
+  typedef std::function<void(const TaskOutcome&)> OutcomeObserver;
   explicit Timer(AsioService& asio_service);
-  // Cancels all tasks and blocks until all functors have been executed and all tasks removed.
+  // Cancels all tasks, invoking their functors once per "missing" expected Response.
   ~Timer();
   // Adds a task with a deadline, and returns a unique ID for the task.  'response_functor' will be
   // invoked every time 'AddResponse' is called for that task, up to 'expected_response_count'
   // times.  At the point of timeout, any shortfall in response count will cause 'response_functor'
   // to be invoked the appropriate number of times with a default-constructed Response.  Throws if
-  // 'response_functor' is null or if 'expected_response_count' < 1.
+  // 'response_functor' is null or if 'expected_response_count' < 1.  'tag' is opaque to the Timer
+  // and only passed back in the task's TaskOutcome.
   void AddTask(const std::chrono::steady_clock::duration& timeout,
                  const ResponseFunctor& response_functor, int expected_response_count,
-                 TaskId task_id);
+                 TaskId task_id, uint32_t tag = 0);
+  // As AddTask, but rather than invoking a functor per response, returns a future resolving to the
+  // responses once 'quorum' of the 'expected_response_count' have arrived, or at the deadline to
+  // however many have.  A task resolved early is cancelled, so the rest aren't waited for.  Throws
+  // as AddTask does, or if 'quorum' is not in [1, 'expected_response_count'].
+  std::future<std::vector<Response>> AddQuorumTask(
+      const std::chrono::steady_clock::duration& timeout, int quorum, int expected_response_count,
+      TaskId task_id, uint32_t tag = 0);
+  // A task for AddTasks.
+  struct NewTask {
+    NewTask(TaskId task_id_in, ResponseFunctor response_functor_in,
+            int expected_response_count_in, uint32_t tag_in = 0)
+        : task_id(task_id_in),
+          response_functor(std::move(response_functor_in)),
+          expected_response_count(expected_response_count_in),
+          tag(tag_in) {}
+    TaskId task_id;
+    ResponseFunctor response_functor;
+    int expected_response_count;
+    uint32_t tag;
+  };
+  // As AddTask for each of 'tasks', all sharing 'timeout', with each shard's lock taken once for
+  // the lot.  Throws, having added none of them, if any is invalid as for AddTask.
+  void AddTasks(const std::chrono::steady_clock::duration& timeout, std::vector<NewTask> tasks);
   // Removes the task and invokes its functor once per "missing" expected Response, with a
   // default-constructed Response each time.  Throws if the indicated task doesn't exist.
   void CancelTask(TaskId task_id);
-  // Invokes the response functor for the indicated task.  Throws if the indicated task doesn't
-  // exist.
-  void AddResponse(TaskId task_id, const Response& response);
+  // Invokes the response functor for the indicated task, moving 'response' into it.  Throws if the
+  // indicated task doesn't exist.
+  void AddResponse(TaskId task_id, Response response);
 
   TaskId NewTaskId();
+  // Reserves 'count' consecutive IDs, returning the first.
+  TaskId NewTaskIds(int count);
+  // Estimated heap bytes held by the shards' slabs, buckets and indices, and by the live tasks'
+  // functors, less anything the functors' captures allocate.
+  uint64_t MemoryBytes() const;
+  // Must be set before any task is added.
+  void set_response_latency_observer(LatencyObserver observer) {
+    response_latency_observer_ = std::move(observer);
+  }
+  // Must be set before any task is added.
+  void set_task_outcome_observer(OutcomeObserver observer) {
+    for (const auto& shard : shards_)
+      shard->outcome_observer = observer;
+  }
 
   friend class test::TimerTest;
 
   void PrintTaskIds() {
-    std::lock_guard<std::mutex> lock(mutex_);
     LOG(kVerbose) << "This timer containing following tasks : ";
-    for (auto& task : tasks_) {
-      LOG(kVerbose) << "      task id   ---   " << task.first;
+    for (const auto& shard : shards_) {
+      std::lock_guard<HotPathMutex> lock(shard->mutex);
+      for (auto& task : shard->tasks)
+        LOG(kVerbose) << "      task id   ---   " << task.first;
     }
   }
 
  private:
+  typedef uint32_t SlotIndex;
+  // Shared rather than copied into each invocation, so that passing a response on doesn't copy
+  // the functor.
+  typedef std::shared_ptr<ResponseFunctor> SharedFunctor;
+  typedef std::vector<std::pair<SharedFunctor, int>> Shortfalls;
+  typedef std::vector<TaskOutcome> Outcomes;
+
+  // The responses gathered for an AddQuorumTask task.  'finished' counts missing responses as well
+  // as those which arrived.
+  struct Quorum {
+    Quorum(int quorum_in, int expected_response_count_in)
+        : mutex(), promise(), responses(), kQuorum(quorum_in),
+          kExpectedResponseCount(expected_response_count_in), finished(0), resolved(false) {}
+    std::mutex mutex;
+    std::promise<std::vector<Response>> promise;
+    std::vector<Response> responses;
+    const int kQuorum, kExpectedResponseCount;
+    int finished;
+    bool resolved;
+  };
+
+  // Delivers a single response, which is moved into the functor.
+  struct ResponseInvocation {
+    ResponseInvocation(SharedFunctor functor_in, Response response_in)
+        : functor(std::move(functor_in)), response(std::move(response_in)) {}
+    void operator()() { (*functor)(std::move(response)); }
+    SharedFunctor functor;
+    Response response;
+  };
+
+  // Delivers a task's whole shortfall at once, rather than as one handler per missing response.
+  struct ShortfallInvocation {
+    ShortfallInvocation(SharedFunctor functor_in, int count_in)
+        : functor(std::move(functor_in)), count(count_in) {}
+    void operator()() const {
+      for (int i(0); i != count; ++i)
+        (*functor)(Response());
+    }
+    SharedFunctor functor;
+    int count;
+  };
+
   struct Task {
-    Task(boost::asio::io_service& io_service, const std::chrono::steady_clock::duration& timeout,
-         ResponseFunctor functor_in, int expected_response_count);
-    Task(Task&& other);
-    Task& operator=(Task&& other);
-
-    std::unique_ptr<boost::asio::steady_timer> timer;
-    ResponseFunctor functor;
-    int outstanding_response_count;
-
-   private:
-    Task() = delete;
-    Task(const Task&) = delete;
-    Task& operator=(const Task&) = delete;
+    Task();
+    SharedFunctor functor;
+    int expected_response_count, outstanding_response_count;
+    TaskId task_id;
+    uint32_t tag;
+    std::chrono::steady_clock::time_point added;
+    uint64_t expiry_tick;
+    uint32_t bucket;
+    SlotIndex previous, next;  // neighbours in the bucket's list
   };
 
+  // Tasks are spread across shards by TaskId, each shard having its own lock and wheel.  Within a
+  // shard, tasks live in a slab of reusable slots, each linked into one bucket of a hierarchical
+  // timing wheel.  Level 0 has one bucket per tick and each higher level's buckets span a whole
+  // revolution of the level below, being cascaded down as the wheel reaches them.  A single
+  // RoutingTimer drives each wheel, waking only for a non-empty level 0 bucket or a cascade.  Its
+  // handler holds the wheel weakly, so a wait still queued when the Timer is destroyed is a no-op.
+  struct Wheel {
+    static const int kTickMilliseconds = 10;
+    static const uint32_t kLevelBits = 6;
+    static const uint32_t kBucketsPerLevel = 1 << kLevelBits;
+    static const uint32_t kLevels = 4;
+
+    explicit Wheel(boost::asio::io_service& io_service_in);
+    uint64_t NowTick() const;
+    void Link(SlotIndex slot);
+    void Unlink(SlotIndex slot);
+    void Release(SlotIndex slot);
+    void Cascade(uint32_t level);
+    void Advance(uint64_t to_tick, Shortfalls& shortfalls, Outcomes& outcomes);
+    uint64_t NextWakeTick() const;
+    void Arm(uint64_t tick);
+    // Adds a task expiring at 'expiry_tick'.  Must be called with 'mutex' held.
+    void Insert(SharedFunctor functor, int expected_response_count, TaskId task_id, uint32_t tag,
+                const std::chrono::steady_clock::time_point& added, uint64_t expiry_tick);
+    // Appends the outcome of the task in 'slot' ending now, if anything is observing outcomes.
+    void RecordOutcome(SlotIndex slot, TaskOutcome::Ending ending, Outcomes& outcomes) const;
+    void ReportOutcomes(const Outcomes& outcomes) const;
+
+    boost::asio::io_service& io_service;
+    HotPathMutex mutex;
+    RoutingTimer timer;
+    const std::chrono::steady_clock::time_point kStart;
+    uint64_t current_tick, armed_tick;
+    bool armed;
+    std::vector<Task> slab;
+    std::vector<SlotIndex> free_slots;
+    std::unordered_map<TaskId, SlotIndex> tasks;
+    std::vector<SlotIndex> buckets;
+    std::weak_ptr<Wheel> self;
+    OutcomeObserver outcome_observer;
+  };
+
+  static const uint32_t kShardCount = 8;
+
   Timer(const Timer&);
   Timer(const Timer&&);
   Timer& operator=(Timer);
 
-  void FinishTask(TaskId task_id, const boost::system::error_code& error);
+  static uint32_t ShardIndex(TaskId task_id) {
+    return static_cast<uint32_t>(task_id) % kShardCount;
+  }
+  Wheel& ShardFor(TaskId task_id) { return *shards_[ShardIndex(task_id)]; }
+  static void OnTick(const std::weak_ptr<Wheel>& weak_wheel,
+                     const boost::system::error_code& error);
+  static uint64_t ExpiryTick(const Wheel& shard, const std::chrono::steady_clock::time_point& now,
+                             const std::chrono::steady_clock::duration& timeout);
+  static void InvokeShortfalls(boost::asio::io_service& io_service, const Shortfalls& shortfalls);
 
   AsioService& asio_service_;
-  TaskId new_task_id_;
-  std::mutex mutex_;
-  std::condition_variable cond_var_;
-  std::map<TaskId, Task> tasks_;
+  std::atomic<TaskId> new_task_id_;
+  std::vector<std::shared_ptr<Wheel>> shards_;
+  LatencyObserver response_latency_observer_;
 };
 
 // ==================== Implementation =============================================================
+namespace detail {
+
+const uint32_t kNoTimerSlot(std::numeric_limits<uint32_t>::max());
+
+}  // namespace detail
+
+// Bound to references by std::chrono, so need definitions.
+template <typename Response>
+const int Timer<Response>::Wheel::kTickMilliseconds;
+
+template <typename Response>
+Timer<Response>::Task::Task()
+    : functor(),
+      expected_response_count(0),
+      outstanding_response_count(0),
+      task_id(0),
+      tag(0),
+      added(),
+      expiry_tick(0),
+      bucket(0),
+      previous(detail::kNoTimerSlot),
+      next(detail::kNoTimerSlot) {}
+
+template <typename Response>
+Timer<Response>::Wheel::Wheel(boost::asio::io_service& io_service_in)
+    : io_service(io_service_in),
+      mutex("Timer::mutex"),
+      timer(io_service_in),
+      kStart(RoutingClock::now()),
+      current_tick(0),
+      armed_tick(0),
+      armed(false),
+      slab(),
+      free_slots(),
+      tasks(),
+      buckets(kLevels * kBucketsPerLevel, detail::kNoTimerSlot),
+      self(),
+      outcome_observer() {}
+
 template <typename Response>
-Timer<Response>::Task::Task(boost::asio::io_service& io_service,
-                            const std::chrono::steady_clock::duration& timeout,
-                            ResponseFunctor functor_in, int expected_response_count)
-    : timer(new boost::asio::steady_timer(io_service, timeout)),
-      functor(std::move(functor_in)),
-      outstanding_response_count(expected_response_count) {}
+uint64_t Timer<Response>::Wheel::NowTick() const {
+  return static_cast<uint64_t>((RoutingClock::now() - kStart) /
+                               std::chrono::milliseconds(kTickMilliseconds));
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Link(SlotIndex slot) {
+  Task& task(slab[slot]);
+  // A task is never placed in the bucket for the current tick, which has already been handled,
+  // and one beyond the wheel's reach waits in the furthest bucket to be cascaded again.
+  const uint64_t kMaxDelta((uint64_t(1) << (kLevelBits * kLevels)) - 1);
+  uint64_t target(std::max(task.expiry_tick, current_tick + 1));
+  target = std::min(target, current_tick + kMaxDelta);
+  uint64_t delta(target - current_tick);
+  uint32_t level(0);
+  while (level + 1 < kLevels && delta >= (uint64_t(1) << (kLevelBits * (level + 1))))
+    ++level;
+  task.bucket = level * kBucketsPerLevel +
+                static_cast<uint32_t>((target >> (kLevelBits * level)) & (kBucketsPerLevel - 1));
+  task.previous = detail::kNoTimerSlot;
+  task.next = buckets[task.bucket];
+  if (task.next != detail::kNoTimerSlot)
+    slab[task.next].previous = slot;
+  buckets[task.bucket] = slot;
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Unlink(SlotIndex slot) {
+  Task& task(slab[slot]);
+  if (task.previous != detail::kNoTimerSlot)
+    slab[task.previous].next = task.next;
+  else
+    buckets[task.bucket] = task.next;
+  if (task.next != detail::kNoTimerSlot)
+    slab[task.next].previous = task.previous;
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Release(SlotIndex slot) {
+  Unlink(slot);
+  tasks.erase(slab[slot].task_id);
+  slab[slot] = Task();
+  free_slots.push_back(slot);
+  // An idle wheel doesn't keep a wait pending on the io_service.
+  if (tasks.empty() && armed) {
+    timer.cancel();
+    armed = false;
+  }
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Cascade(uint32_t level) {
+  uint32_t bucket(level * kBucketsPerLevel +
+                  static_cast<uint32_t>((current_tick >> (kLevelBits * level)) &
+                                        (kBucketsPerLevel - 1)));
+  SlotIndex slot(buckets[bucket]);
+  buckets[bucket] = detail::kNoTimerSlot;
+  while (slot != detail::kNoTimerSlot) {
+    SlotIndex next(slab[slot].next);
+    Link(slot);
+    slot = next;
+  }
+}
 
 template <typename Response>
-Timer<Response>::Task::Task(Task&& other)
-    : timer(std::move(other.timer)),
-      functor(std::move(other.functor)),
-      outstanding_response_count(std::move(other.outstanding_response_count)) {}
+void Timer<Response>::Wheel::Advance(uint64_t to_tick, Shortfalls& shortfalls,
+                                     Outcomes& outcomes) {
+  while (current_tick < to_tick && !tasks.empty()) {
+    ++current_tick;
+    // Higher levels are cascaded first, as their tasks may land in a lower level's bucket which is
+    // itself due to be cascaded at this tick.
+    for (uint32_t level(kLevels - 1); level != 0; --level) {
+      if ((current_tick & ((uint64_t(1) << (kLevelBits * level)) - 1)) == 0)
+        Cascade(level);
+    }
+    uint32_t bucket(static_cast<uint32_t>(current_tick & (kBucketsPerLevel - 1)));
+    SlotIndex slot(buckets[bucket]);
+    while (slot != detail::kNoTimerSlot) {
+      SlotIndex next(slab[slot].next);
+      if (slab[slot].expiry_tick <= current_tick) {
+        LOG(kWarning) << "Timed out waiting for task " << slab[slot].task_id;
+        RecordOutcome(slot, TaskOutcome::kTimedOut, outcomes);
+        shortfalls.push_back(std::make_pair(std::move(slab[slot].functor),
+                                            slab[slot].outstanding_response_count));
+        Release(slot);
+      }
+      slot = next;
+    }
+  }
+  current_tick = std::max(current_tick, to_tick);
+}
 
 template <typename Response>
-typename Timer<Response>::Task& Timer<Response>::Task::operator=(Task&& other) {
-  timer = std::move(other.timer);
-  functor = std::move(other.functor);
-  outstanding_response_count = std::move(other.outstanding_response_count);
-  return *this;
+uint64_t Timer<Response>::Wheel::NextWakeTick() const {
+  // The first non-empty level 0 bucket before the next cascade, else that cascade.
+  uint64_t cascade_tick((current_tick | (kBucketsPerLevel - 1)) + 1);
+  for (uint64_t tick(current_tick + 1); tick != cascade_tick; ++tick) {
+    if (buckets[tick & (kBucketsPerLevel - 1)] != detail::kNoTimerSlot)
+      return tick;
+  }
+  return cascade_tick;
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Arm(uint64_t tick) {
+  if (armed && armed_tick <= tick)
+    return;
+  armed = true;
+  armed_tick = tick;
+  // Resetting the expiry aborts any wait already pending, whose handler then does nothing.
+  timer.expires_at(kStart + std::chrono::milliseconds(kTickMilliseconds) * tick);
+  std::weak_ptr<Wheel> weak_wheel(self);
+  timer.async_wait([weak_wheel](const boost::system::error_code& error) {
+    Timer<Response>::OnTick(weak_wheel, error);
+  });
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::Insert(SharedFunctor functor, int expected_response_count,
+                                    TaskId task_id, uint32_t tag,
+                                    const std::chrono::steady_clock::time_point& added,
+                                    uint64_t expiry_tick) {
+  assert(tasks.count(task_id) == 0);
+  // An idle wheel has no tasks to fire, so is moved straight to the present.
+  if (tasks.empty())
+    current_tick = std::max(current_tick, NowTick());
+  SlotIndex slot(static_cast<SlotIndex>(slab.size()));
+  if (free_slots.empty()) {
+    slab.push_back(Task());
+  } else {
+    slot = free_slots.back();
+    free_slots.pop_back();
+  }
+  Task& task(slab[slot]);
+  task.functor = std::move(functor);
+  task.expected_response_count = expected_response_count;
+  task.outstanding_response_count = expected_response_count;
+  task.task_id = task_id;
+  task.tag = tag;
+  task.added = added;
+  task.expiry_tick = expiry_tick;
+  tasks.insert(std::make_pair(task_id, slot));
+  Link(slot);
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::RecordOutcome(SlotIndex slot, TaskOutcome::Ending ending,
+                                           Outcomes& outcomes) const {
+  if (!outcome_observer)
+    return;
+  const Task& task(slab[slot]);
+  TaskOutcome outcome;
+  outcome.ending = ending;
+  outcome.task_id = task.task_id;
+  outcome.tag = task.tag;
+  outcome.expected_response_count = task.expected_response_count;
+  outcome.response_count = task.expected_response_count - task.outstanding_response_count;
+  outcome.elapsed = RoutingClock::now() - task.added;
+  outcomes.push_back(outcome);
+}
+
+template <typename Response>
+void Timer<Response>::Wheel::ReportOutcomes(const Outcomes& outcomes) const {
+  for (const auto& outcome : outcomes)
+    outcome_observer(outcome);
+}
+
+template <typename Response>
+void Timer<Response>::OnTick(const std::weak_ptr<Wheel>& weak_wheel,
+                             const boost::system::error_code& error) {
+  if (error == boost::asio::error::operation_aborted)
+    return;
+  std::shared_ptr<Wheel> wheel(weak_wheel.lock());
+  if (!wheel)
+    return;
+  if (error)
+    LOG(kError) << "Error waiting for timer wheel - " << error.message();
+  Shortfalls shortfalls;
+  Outcomes outcomes;
+  {
+    std::lock_guard<HotPathMutex> lock(wheel->mutex);
+    wheel->armed = false;
+    wheel->Advance(wheel->NowTick(), shortfalls, outcomes);
+    if (!wheel->tasks.empty())
+      wheel->Arm(wheel->NextWakeTick());
+  }
+  wheel->ReportOutcomes(outcomes);
+  InvokeShortfalls(wheel->io_service, shortfalls);
+}
+
+template <typename Response>
+void Timer<Response>::InvokeShortfalls(boost::asio::io_service& io_service,
+                                       const Shortfalls& shortfalls) {
+  for (const auto& shortfall : shortfalls) {
+    if (shortfall.second != 0)
+      io_service.dispatch(ShortfallInvocation(shortfall.first, shortfall.second));
+  }
 }
 
 template <typename Response>
 Timer<Response>::Timer(AsioService& asio_service)
-    : asio_service_(asio_service), new_task_id_(RandomInt32()), mutex_(), cond_var_(), tasks_() {}
+    : asio_service_(asio_service),
+      new_task_id_(RandomInt32()),
+      shards_(),
+      response_latency_observer_() {
+  for (uint32_t i(0); i != kShardCount; ++i) {
+    shards_.push_back(std::make_shared<Wheel>(asio_service.service()));
+    shards_.back()->self = shards_.back();
+  }
+}
 
 template <typename Response>
 Timer<Response>::~Timer() {
   LOG(kVerbose) << "Timer<Response>::Destructor";
-  std::unique_lock<std::mutex> lock(mutex_);
-  LOG(kVerbose) << "Timer<Response>::Destructor process destruction " << tasks_.size();
-  for (const auto& task : tasks_)
-    task.second.timer->cancel();
-  cond_var_.wait(lock, [&] { return tasks_.empty(); });
+  Shortfalls shortfalls;
+  for (const auto& shard : shards_) {
+    Outcomes outcomes;
+    std::unique_lock<HotPathMutex> lock(shard->mutex);
+    LOG(kVerbose) << "Timer<Response>::Destructor process destruction " << shard->tasks.size();
+    while (!shard->tasks.empty()) {
+      SlotIndex slot(shard->tasks.begin()->second);
+      LOG(kInfo) << "Cancelled task " << shard->slab[slot].task_id;
+      shard->RecordOutcome(slot, TaskOutcome::kCancelled, outcomes);
+      shortfalls.push_back(std::make_pair(std::move(shard->slab[slot].functor),
+                                          shard->slab[slot].outstanding_response_count));
+      shard->Release(slot);
+    }
+    shard->timer.cancel();
+    lock.unlock();
+    shard->ReportOutcomes(outcomes);
+  }
+  InvokeShortfalls(asio_service_.service(), shortfalls);
   LOG(kVerbose) << "Timer<Response>::Destructor completed";
 }
 
 template <typename Response>
 void Timer<Response>::AddTask(const std::chrono::steady_clock::duration& timeout,
                                 const ResponseFunctor& response_functor,
-                                int expected_response_count, TaskId task_id) {
+                                int expected_response_count, TaskId task_id, uint32_t tag) {
   LOG(kVerbose) << "Timer<Response>::AddTask add task " << task_id
                 << " with expected_response_count as " << expected_response_count;
   if (!response_functor || expected_response_count < 1) {
@@ -159,107 +547,186 @@ void Timer<Response>::AddTask(const std::chrono::steady_clock::duration& timeout
                 << " incorrect expected_response_count";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  std::lock_guard<std::mutex> lock(mutex_);
+  SharedFunctor functor(std::make_shared<ResponseFunctor>(response_functor));
+  Wheel& shard(ShardFor(task_id));
+  std::lock_guard<HotPathMutex> lock(shard.mutex);
   LOG(kVerbose) << "Timer<Response>::AddTask process adding task " << task_id;
-  auto result(tasks_.insert(std::move(
-      std::make_pair(task_id, std::move(Task(asio_service_.service(), timeout, response_functor,
-                                             expected_response_count))))));
-  assert(result.second);
-  result.first->second.timer->async_wait([this, task_id](const boost::system::error_code & error) {
-    this->FinishTask(task_id, error);
-  });
+  const std::chrono::steady_clock::time_point kNow(RoutingClock::now());
+  shard.Insert(std::move(functor), expected_response_count, task_id, tag, kNow,
+               ExpiryTick(shard, kNow, timeout));
+  shard.Arm(shard.NextWakeTick());
 }
 
 template <typename Response>
-void Timer<Response>::FinishTask(TaskId task_id, const boost::system::error_code& error) {
-  int outstanding_response_count(0);
-  ResponseFunctor functor;
-  LOG(kVerbose) << "Timer<Response>::FinishTask finish task " << task_id;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    LOG(kVerbose) << "Timer<Response>::FinishTask process finishing task " << task_id;
-    auto itr(tasks_.find(task_id));
-    if (itr == std::end(tasks_)) {
-      LOG(kError) << "Timer<Response>::FinishTask Task " << task_id << " not held by Timer.";
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+std::future<std::vector<Response>> Timer<Response>::AddQuorumTask(
+    const std::chrono::steady_clock::duration& timeout, int quorum, int expected_response_count,
+    TaskId task_id, uint32_t tag) {
+  if (quorum < 1 || quorum > expected_response_count) {
+    LOG(kError) << "Timer<Response>::AddQuorumTask incorrect quorum " << quorum;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  auto gathered(std::make_shared<Quorum>(quorum, expected_response_count));
+  std::future<std::vector<Response>> future(gathered->promise.get_future());
+  AddTask(timeout, [this, gathered, task_id](Response response) {
+    bool cancel(false);
+    {
+      std::lock_guard<std::mutex> lock(gathered->mutex);
+      if (gathered->resolved)
+        return;
+      ++gathered->finished;
+      if (!(response == Response()))
+        gathered->responses.push_back(std::move(response));
+      if (static_cast<int>(gathered->responses.size()) < gathered->kQuorum &&
+          gathered->finished < gathered->kExpectedResponseCount)
+        return;
+      gathered->resolved = true;
+      // Only a response which arrived can meet the quorum early, so the Timer is still alive.
+      cancel = gathered->finished < gathered->kExpectedResponseCount;
+      gathered->promise.set_value(std::move(gathered->responses));
     }
-    assert(itr->second.outstanding_response_count >= 0);
-    LOG(kVerbose) << "Timer<Response>::FinishTask outstanding_response_count for Task "
-                  << task_id << " is " << itr->second.outstanding_response_count;
-    if (itr->second.outstanding_response_count != 0) {
-      outstanding_response_count = itr->second.outstanding_response_count;
-      functor = itr->second.functor;
+    if (!cancel)
+      return;
+    try {
+      CancelTask(task_id);
+    }
+    catch (const maidsafe_error&) {
+      // Timed out meanwhile
     }
+  }, expected_response_count, task_id, tag);
+  return future;
+}
 
-    tasks_.erase(itr);
-
-    switch (error.value()) {
-      case boost::system::errc::success:  // Task's timer has expired
-        LOG(kWarning) << "Timed out waiting for task " << task_id;
-        break;
-      case boost::asio::error::operation_aborted:  // Cancelled via CancelTask
-        LOG(kInfo) << "Cancelled task " << task_id;
-        break;
-      default:
-        LOG(kError) << "Error waiting for task " << task_id << " - " << error.message();
+template <typename Response>
+void Timer<Response>::AddTasks(const std::chrono::steady_clock::duration& timeout,
+                               std::vector<NewTask> tasks) {
+  LOG(kVerbose) << "Timer<Response>::AddTasks add " << tasks.size() << " tasks";
+  for (const auto& task : tasks) {
+    if (!task.response_functor || task.expected_response_count < 1) {
+      LOG(kError) << "Timer<Response>::AddTasks response_functor not initialised or "
+                  << " incorrect expected_response_count for task " << task.task_id;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+  }
+  std::vector<std::vector<size_t>> by_shard(kShardCount);
+  for (size_t i(0); i != tasks.size(); ++i)
+    by_shard[ShardIndex(tasks[i].task_id)].push_back(i);
+  const std::chrono::steady_clock::time_point kNow(RoutingClock::now());
+  for (uint32_t i(0); i != kShardCount; ++i) {
+    if (by_shard[i].empty())
+      continue;
+    Wheel& shard(*shards_[i]);
+    std::lock_guard<HotPathMutex> lock(shard.mutex);
+    const uint64_t kExpiryTick(ExpiryTick(shard, kNow, timeout));
+    for (auto index : by_shard[i]) {
+      NewTask& task(tasks[index]);
+      shard.Insert(std::make_shared<ResponseFunctor>(std::move(task.response_functor)),
+                   task.expected_response_count, task.task_id, task.tag, kNow, kExpiryTick);
     }
+    shard.Arm(shard.NextWakeTick());
   }
-  for (int i(0); i != outstanding_response_count; ++i)
-    asio_service_.service().dispatch([=] { functor(Response()); });
-  LOG(kVerbose) << "Timer<Response> notifying condition_variable";
-  cond_var_.notify_one();
-  LOG(kVerbose) << "Timer<Response>::FinishTask completed";
 }
 
 template <typename Response>
 void Timer<Response>::CancelTask(TaskId task_id) {
   LOG(kVerbose) << "Timer<Response>::CancelTask task " << task_id << " is to be canceled";
-  std::lock_guard<std::mutex> lock(mutex_);
-  LOG(kVerbose) << "Timer<Response>::CancelTask process cancelling task " << task_id;
-  auto itr(tasks_.find(task_id));
-  if (itr == std::end(tasks_)) {
-    LOG(kError) << "Task " << task_id << " not held by Timer.";
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  Shortfalls shortfalls;
+  Outcomes outcomes;
+  Wheel& shard(ShardFor(task_id));
+  {
+    std::lock_guard<HotPathMutex> lock(shard.mutex);
+    LOG(kVerbose) << "Timer<Response>::CancelTask process cancelling task " << task_id;
+    auto itr(shard.tasks.find(task_id));
+    if (itr == std::end(shard.tasks)) {
+      LOG(kError) << "Task " << task_id << " not held by Timer.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+    }
+    Task& task(shard.slab[itr->second]);
+    shard.RecordOutcome(itr->second, TaskOutcome::kCancelled, outcomes);
+    shortfalls.push_back(std::make_pair(std::move(task.functor), task.outstanding_response_count));
+    shard.Release(itr->second);
+    LOG(kInfo) << "Cancelled task " << task_id;
   }
-  itr->second.timer->cancel();
+  shard.ReportOutcomes(outcomes);
+  InvokeShortfalls(asio_service_.service(), shortfalls);
   LOG(kVerbose) << "Timer<Response>::CancelTask completed";
 }
 
 template <typename Response>
-void Timer<Response>::AddResponse(TaskId task_id, const Response& response) {
-  ResponseFunctor functor;
+void Timer<Response>::AddResponse(TaskId task_id, Response response) {
+  SharedFunctor functor;
+  std::chrono::steady_clock::time_point added;
+  Outcomes outcomes;
   LOG(kVerbose) << "Timer<Response>::AddResponse add response to task " << task_id;
+  Wheel& shard(ShardFor(task_id));
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<HotPathMutex> lock(shard.mutex);
     LOG(kVerbose) << "Timer<Response>::AddResponse process adding response to task " << task_id;
-    auto itr(tasks_.find(task_id));
-    if (itr == std::end(tasks_)) {
+    auto itr(shard.tasks.find(task_id));
+    if (itr == std::end(shard.tasks)) {
       LOG(kError) << "Task " << task_id << " not held by Timer.";
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
     }
-    if (itr->second.outstanding_response_count == 0) {
-      LOG(kError) << "outstanding_response_count already reached zero";
-      return;
-    }
-    --(itr->second.outstanding_response_count);
-    LOG(kVerbose) << "Task " << task_id << " now having " << itr->second.outstanding_response_count
+    Task& task(shard.slab[itr->second]);
+    assert(task.outstanding_response_count > 0);
+    added = task.added;
+    --task.outstanding_response_count;
+    LOG(kVerbose) << "Task " << task_id << " now having " << task.outstanding_response_count
                   << " outstanding_response_count.";
-    functor = itr->second.functor;
-    if (itr->second.outstanding_response_count == 0)
-      itr->second.timer->cancel();  // Invokes 'FinishTask'
+    if (task.outstanding_response_count == 0) {
+      shard.RecordOutcome(itr->second, TaskOutcome::kCompleted, outcomes);
+      functor = std::move(task.functor);
+      shard.Release(itr->second);
+    } else {
+      functor = task.functor;
+    }
   }
-  asio_service_.service().dispatch([=] { functor(response); });
+  if (response_latency_observer_)
+    response_latency_observer_(RoutingClock::now() - added);
+  shard.ReportOutcomes(outcomes);
+  asio_service_.service().dispatch(ResponseInvocation(std::move(functor), std::move(response)));
   LOG(kVerbose) << "Timer<Response>::AddResponse completed";
 }
 
 template <typename Response>
 TaskId Timer<Response>::NewTaskId() {
   LOG(kVerbose) << "Timer<Response>::NewTaskId";
-  std::lock_guard<std::mutex> lock(mutex_);
-  LOG(kVerbose) << "Timer<Response>::NewTaskId completed";
   return new_task_id_++;
 }
 
+template <typename Response>
+TaskId Timer<Response>::NewTaskIds(int count) {
+  LOG(kVerbose) << "Timer<Response>::NewTaskIds " << count;
+  return new_task_id_.fetch_add(count);
+}
+
+template <typename Response>
+uint64_t Timer<Response>::MemoryBytes() const {
+  // A functor shares its allocation with the shared_ptr control block.
+  const uint64_t kFunctorBytes(sizeof(ResponseFunctor) + 2 * sizeof(void*));
+  const uint64_t kIndexNodeBytes(sizeof(std::pair<const TaskId, SlotIndex>) + 2 * sizeof(void*));
+  uint64_t bytes(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<HotPathMutex> lock(shard->mutex);
+    bytes += shard->slab.capacity() * sizeof(Task) +
+             shard->free_slots.capacity() * sizeof(SlotIndex) +
+             shard->buckets.capacity() * sizeof(SlotIndex) +
+             shard->tasks.size() * (kIndexNodeBytes + kFunctorBytes) +
+             shard->tasks.bucket_count() * sizeof(void*);
+  }
+  return bytes;
+}
+
+template <typename Response>
+uint64_t Timer<Response>::ExpiryTick(const Wheel& shard,
+                                     const std::chrono::steady_clock::time_point& now,
+                                     const std::chrono::steady_clock::duration& timeout) {
+  // Rounded up, so that a task never fires before its timeout.
+  const std::chrono::steady_clock::duration kTick(
+      std::chrono::milliseconds(Wheel::kTickMilliseconds));
+  return static_cast<uint64_t>((now - shard.kStart + timeout + kTick -
+                                std::chrono::steady_clock::duration(1)) / kTick);
+}
+
 
 }  // namespace routing
 
@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/application_queue.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+ApplicationQueue::ApplicationQueue(uint32_t capacity)
+    : mutex_(), condition_(), running_(true), slots_(capacity), head_(0), count_(0) {}
+
+bool ApplicationQueue::Push(ReceivedMessage& message) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_ || count_ == slots_.size())
+      return false;
+    ReceivedMessage& slot(slots_[(head_ + count_) % slots_.size()]);
+    slot.message.swap(message.message);
+    slot.reply.swap(message.reply);
+    ++count_;
+  }
+  condition_.notify_one();
+  return true;
+}
+
+std::vector<ReceivedMessage> ApplicationQueue::Take(size_t max_count,
+                                                    std::chrono::milliseconds timeout) {
+  std::vector<ReceivedMessage> messages;
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!condition_.wait_for(lock, timeout, [this] { return !running_ || count_ != 0; }) ||
+      !running_)
+    return messages;
+  messages.resize(std::min(max_count, count_));
+  for (auto& message : messages) {
+    ReceivedMessage& slot(slots_[head_]);
+    message.message.swap(slot.message);
+    message.reply.swap(slot.reply);
+    head_ = (head_ + 1) % slots_.size();
+    --count_;
+  }
+  // Another taker may be waiting for what's left.
+  if (count_ != 0)
+    condition_.notify_one();
+  return messages;
+}
+
+void ApplicationQueue::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    std::vector<ReceivedMessage>(slots_.size()).swap(slots_);
+    head_ = count_ = 0;
+  }
+  condition_.notify_all();
+}
+
+size_t ApplicationQueue::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,65 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_APPLICATION_QUEUE_H_
+#define MAIDSAFE_ROUTING_APPLICATION_QUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Hands received messages from routing's threads to the application's, which take them in
+// batches.  Routing never waits on it: a message pushed while |capacity| are waiting is refused.
+class ApplicationQueue {
+ public:
+  explicit ApplicationQueue(uint32_t capacity);
+  // Returns false, leaving |message| untouched, if the queue is full or stopped.
+  bool Push(ReceivedMessage& message);
+  // Takes up to |max_count| of the oldest messages, waiting up to |timeout| for the first.  Returns
+  // none on timing out or once stopped.
+  std::vector<ReceivedMessage> Take(size_t max_count, std::chrono::milliseconds timeout);
+  // Wakes any takers.  Messages still waiting are discarded unanswered.
+  void Stop();
+  size_t size() const;
+
+ private:
+  ApplicationQueue(const ApplicationQueue&);
+  ApplicationQueue(const ApplicationQueue&&);
+  ApplicationQueue& operator=(const ApplicationQueue&);
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_;
+  // A ring of capacity slots, the oldest message at head_
+  std::vector<ReceivedMessage> slots_;
+  size_t head_, count_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_APPLICATION_QUEUE_H_
@@ -0,0 +1,217 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/bootstrap_contact_store.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/bootstrap_journal.h"
+#include "maidsafe/routing/bootstrap_ranking.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace routing {
+
+BootstrapContactInfo::BootstrapContactInfo()
+    : contact(), last_seen(), successes(0), failures(0), round_trip() {}
+
+BootstrapContactInfo::BootstrapContactInfo(const BootstrapContact& contact_in)
+    : contact(contact_in), last_seen(), successes(0), failures(0), round_trip() {}
+
+BootstrapContactStore::BootstrapContactStore(const fs::path& bootstrap_file_path)
+    : kBootstrapFilePath_(bootstrap_file_path),
+      mutex_(),
+      write_mutex_(),
+      cond_var_(),
+      contacts_(),
+      pending_(),
+      file_exists_(false),
+      stop_(false),
+      writer_() {
+  boost::system::error_code error_code;
+  if (fs::exists(kBootstrapFilePath_, error_code)) {
+    contacts_ = ReadBootstrapContactInfo(kBootstrapFilePath_);
+    file_exists_ = true;
+  }
+  writer_ = std::thread([this] { Run(); });
+}
+
+BootstrapContactStore::~BootstrapContactStore() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_var_.notify_one();
+  writer_.join();
+  Flush();
+}
+
+void BootstrapContactStore::Add(const BootstrapContact& contact) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto itr(Find(contact));
+  if (itr == contacts_.end()) {
+    contacts_.push_back(BootstrapContactInfo(contact));
+    itr = contacts_.end() - 1;
+  }
+  itr->last_seen = std::chrono::system_clock::now();
+  Queue(*itr, false, lock);
+}
+
+void BootstrapContactStore::Remove(const BootstrapContact& contact) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto itr(Find(contact));
+  if (itr == contacts_.end())
+    return;
+  BootstrapContactInfo info(*itr);
+  contacts_.erase(itr);
+  Queue(info, true, lock);
+}
+
+void BootstrapContactStore::RecordSuccess(const BootstrapContact& contact,
+                                          std::chrono::milliseconds round_trip) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto itr(Find(contact));
+  if (itr == contacts_.end())
+    return;
+  itr->last_seen = std::chrono::system_clock::now();
+  itr->round_trip = itr->successes == 0 ? round_trip : (3 * itr->round_trip + round_trip) / 4;
+  ++itr->successes;
+  Queue(*itr, false, lock);
+}
+
+void BootstrapContactStore::RecordFailure(const BootstrapContact& contact) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto itr(Find(contact));
+  if (itr == contacts_.end())
+    return;
+  ++itr->failures;
+  Queue(*itr, false, lock);
+}
+
+std::vector<BootstrapContactInfo> BootstrapContactStore::GetContacts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<BootstrapContactInfo>(contacts_.rbegin(), contacts_.rend());
+}
+
+BootstrapContacts BootstrapContactStore::RankedContacts() const {
+  BootstrapRanking ranking;
+  BootstrapContacts ranked;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ranked.reserve(contacts_.size());
+    for (auto itr(contacts_.rbegin()); itr != contacts_.rend(); ++itr) {
+      BootstrapRanking::Record record;
+      record.successes = itr->successes;
+      record.failures = itr->failures;
+      record.round_trip = itr->round_trip;
+      ranking.Insert(itr->contact, record);
+      ranked.push_back(itr->contact);
+    }
+  }
+  ranking.Order(ranked);
+  return ranked;
+}
+
+void BootstrapContactStore::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Write(lock);
+}
+
+std::vector<BootstrapContactInfo>::iterator BootstrapContactStore::Find(
+    const BootstrapContact& contact) {
+  return std::find_if(contacts_.begin(), contacts_.end(),
+                      [&](const BootstrapContactInfo& info) { return info.contact == contact; });
+}
+
+void BootstrapContactStore::Queue(const BootstrapContactInfo& info, bool removed,
+                                  std::unique_lock<std::mutex>& /*lock*/) {
+  auto itr(std::find_if(pending_.begin(), pending_.end(), [&](const Change& change) {
+    return change.info.contact == info.contact;
+  }));
+  Change change = { info, removed };
+  if (itr != pending_.end()) {
+    *itr = change;
+    return;
+  }
+  pending_.push_back(change);
+  if (pending_.size() == 1)
+    cond_var_.notify_one();
+}
+
+void BootstrapContactStore::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    cond_var_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (stop_)
+      return;
+    // Let whatever else is about to change join this write.
+    cond_var_.wait_for(lock, Parameters::bootstrap_store_write_delay, [this] { return stop_; });
+    Write(lock);
+  }
+}
+
+void BootstrapContactStore::Write(std::unique_lock<std::mutex>& lock) {
+  // Taken before |pending_| is, so that concurrent writes reach the file in the order queued.
+  lock.unlock();
+  std::lock_guard<std::mutex> write_lock(write_mutex_);
+  lock.lock();
+  if (pending_.empty() && file_exists_)
+    return;
+  std::vector<BootstrapJournalEntry> entries;
+  entries.reserve(pending_.size());
+  for (const auto& change : pending_) {
+    BootstrapJournalEntry entry;
+    entry.info = change.info;
+    entry.removed = change.removed;
+    entry.has_metadata = true;
+    entries.push_back(entry);
+  }
+  pending_.clear();
+  const bool kRewrite(!file_exists_);
+  std::vector<BootstrapContactInfo> contacts(kRewrite ? contacts_
+                                                      : std::vector<BootstrapContactInfo>());
+  file_exists_ = true;
+  lock.unlock();
+  try {
+    if (kRewrite)
+      WriteBootstrapContactInfo(contacts, kBootstrapFilePath_);
+    else
+      AppendBootstrapJournal(entries, kBootstrapFilePath_);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to write bootstrap file at " << kBootstrapFilePath_ << " : "
+                << e.what();
+    lock.lock();
+    // What's in memory is complete, so the next write replaces the file with it.
+    file_exists_ = false;
+    return;
+  }
+  lock.lock();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -18,11 +18,18 @@
 
 #include "maidsafe/routing/bootstrap_file_operations.h"
 
+#include <algorithm>
+#include <exception>
+#include <fstream>
 #include <string>
 
+#include "boost/filesystem/operations.hpp"
+
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/bootstrap_journal.h"
+#include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/utils.h"
 
@@ -33,7 +40,108 @@ namespace maidsafe {
 namespace routing {
 
 namespace {
-  typedef boost::asio::ip::udp::endpoint Endpoint;
+
+typedef boost::asio::ip::udp::endpoint Endpoint;
+
+std::string SerialiseBootstrapContactInfo(const BootstrapContactInfo& info, bool has_metadata) {
+  protobuf::BootstrapContact protobuf_bootstrap_contact;
+  SetProtobufEndpoint(info.contact, protobuf_bootstrap_contact.mutable_endpoint());
+  if (has_metadata) {
+    protobuf_bootstrap_contact.set_last_seen(std::chrono::duration_cast<std::chrono::milliseconds>(
+        info.last_seen.time_since_epoch()).count());
+    protobuf_bootstrap_contact.set_successes(info.successes);
+    protobuf_bootstrap_contact.set_failures(info.failures);
+    protobuf_bootstrap_contact.set_round_trip(static_cast<uint32_t>(info.round_trip.count()));
+  }
+  std::string serialised_bootstrap_contact;
+  if (!protobuf_bootstrap_contact.SerializeToString(&serialised_bootstrap_contact)) {
+    LOG(kError) << "Failed to serialise bootstrap contact.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  }
+  return serialised_bootstrap_contact;
+}
+
+// Fields absent from |serialised_bootstrap_contact| are left as they are in |info|.
+void ParseBootstrapContactInfo(const std::string& serialised_bootstrap_contact,
+                               BootstrapContactInfo& info) {
+  protobuf::BootstrapContact protobuf_bootstrap_contact;
+  if (!protobuf_bootstrap_contact.ParseFromString(serialised_bootstrap_contact)) {
+    LOG(kError) << "Could not parse bootstrap contact.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  info.contact = GetEndpointFromProtobuf(protobuf_bootstrap_contact.endpoint());
+  if (protobuf_bootstrap_contact.has_last_seen()) {
+    info.last_seen = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(protobuf_bootstrap_contact.last_seen()));
+  }
+  if (protobuf_bootstrap_contact.has_successes())
+    info.successes = protobuf_bootstrap_contact.successes();
+  if (protobuf_bootstrap_contact.has_failures())
+    info.failures = protobuf_bootstrap_contact.failures();
+  if (protobuf_bootstrap_contact.has_round_trip())
+    info.round_trip = std::chrono::milliseconds(protobuf_bootstrap_contact.round_trip());
+}
+
+// Each journal record is a four byte little endian size, then the serialised entry.
+const size_t kJournalRecordHeaderSize(4);
+
+void AppendJournalRecord(const std::string& serialised_entry, std::string& output) {
+  for (size_t i(0); i != kJournalRecordHeaderSize; ++i)
+    output.push_back(static_cast<char>((serialised_entry.size() >> (8 * i)) & 0xFF));
+  output.append(serialised_entry);
+}
+
+size_t ReadJournalRecordSize(const char* input) {
+  size_t size(0);
+  for (size_t i(0); i != kJournalRecordHeaderSize; ++i)
+    size |= static_cast<size_t>(static_cast<unsigned char>(input[i])) << (8 * i);
+  return size;
+}
+
+void ReplayBootstrapJournal(const boost::filesystem::path& journal_path,
+                            std::vector<BootstrapContactInfo>& contacts) {
+  const std::string kJournal(ReadFile(journal_path).string());
+  size_t offset(0);
+  while (offset != kJournal.size()) {
+    const size_t kRemaining(kJournal.size() - offset);
+    const size_t kRecordSize(kRemaining < kJournalRecordHeaderSize
+                                 ? 0
+                                 : ReadJournalRecordSize(kJournal.data() + offset));
+    protobuf::BootstrapJournalEntry entry;
+    // Most likely an append cut short; everything before it, and the snapshot, is still sound.
+    if (kRemaining < kJournalRecordHeaderSize ||
+        kRemaining - kJournalRecordHeaderSize < kRecordSize ||
+        !entry.ParseFromArray(kJournal.data() + offset + kJournalRecordHeaderSize,
+                              static_cast<int>(kRecordSize))) {
+      LOG(kWarning) << "Stopped replaying bootstrap journal at : " << journal_path
+                    << " on an unreadable record at offset " << offset;
+      return;
+    }
+    offset += kJournalRecordHeaderSize + kRecordSize;
+    BootstrapContactInfo update;
+    try {
+      ParseBootstrapContactInfo(entry.serialised_bootstrap_contact(), update);
+    }
+    catch (const std::exception&) {
+      LOG(kWarning) << "Stopped replaying bootstrap journal at : " << journal_path
+                    << " on an unreadable contact";
+      return;
+    }
+    auto itr(std::find_if(std::begin(contacts), std::end(contacts),
+                          [&](const BootstrapContactInfo& info) {
+                            return info.contact == update.contact;
+                          }));
+    if (entry.removed()) {
+      if (itr != std::end(contacts))
+        contacts.erase(itr);
+    } else if (itr == std::end(contacts)) {
+      contacts.push_back(update);
+    } else {
+      ParseBootstrapContactInfo(entry.serialised_bootstrap_contact(), *itr);
+    }
+  }
+}
+
 }  // unnamed namespace
 
 std::string SerialiseBootstrapContact(const BootstrapContact& bootstrap_contact) {
@@ -86,12 +194,90 @@ BootstrapContacts ParseBootstrapContacts(const std::string& serialised_bootstrap
 }
 
 
+boost::filesystem::path BootstrapJournalPath(const fs::path& bootstrap_file_path) {
+  return fs::path(bootstrap_file_path.string() + ".journal");
+}
+
+std::vector<BootstrapContactInfo> ReadBootstrapContactInfo(const fs::path& bootstrap_file_path) {
+  protobuf::BootstrapContacts protobuf_bootstrap_contacts;
+  if (!protobuf_bootstrap_contacts.ParseFromString(ReadFile(bootstrap_file_path).string())) {
+    LOG(kError) << "Could not parse bootstrap file.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  std::vector<BootstrapContactInfo> contacts(
+      protobuf_bootstrap_contacts.serialised_bootstrap_contacts().size());
+  for (int index(0); index != protobuf_bootstrap_contacts.serialised_bootstrap_contacts_size();
+       ++index) {
+    ParseBootstrapContactInfo(protobuf_bootstrap_contacts.serialised_bootstrap_contacts(index),
+                              contacts[index]);
+  }
+  boost::system::error_code error_code;
+  const fs::path kJournalPath(BootstrapJournalPath(bootstrap_file_path));
+  if (fs::exists(kJournalPath, error_code))
+    ReplayBootstrapJournal(kJournalPath, contacts);
+  return contacts;
+}
+
+void WriteBootstrapContactInfo(const std::vector<BootstrapContactInfo>& contacts,
+                               const fs::path& bootstrap_file_path) {
+  protobuf::BootstrapContacts protobuf_bootstrap_contacts;
+  for (const auto& info : contacts)
+    protobuf_bootstrap_contacts.add_serialised_bootstrap_contacts(
+        SerialiseBootstrapContactInfo(info, true));
+  std::string serialised_bootstrap_contacts;
+  if (!protobuf_bootstrap_contacts.SerializeToString(&serialised_bootstrap_contacts)) {
+    LOG(kError) << "Failed to serialise bootstrap contacts.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  }
+  if (!WriteFile(bootstrap_file_path, serialised_bootstrap_contacts)) {
+    LOG(kError) << "Could not write bootstrap file at : " << bootstrap_file_path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+  }
+  boost::system::error_code error_code;
+  fs::remove(BootstrapJournalPath(bootstrap_file_path), error_code);
+}
+
+void AppendBootstrapJournal(const std::vector<BootstrapJournalEntry>& entries,
+                            const fs::path& bootstrap_file_path) {
+  if (entries.empty())
+    return;
+  std::string records;
+  for (const auto& entry : entries) {
+    protobuf::BootstrapJournalEntry protobuf_entry;
+    protobuf_entry.set_serialised_bootstrap_contact(
+        SerialiseBootstrapContactInfo(entry.info, entry.has_metadata && !entry.removed));
+    if (entry.removed)
+      protobuf_entry.set_removed(true);
+    std::string serialised_entry;
+    if (!protobuf_entry.SerializeToString(&serialised_entry)) {
+      LOG(kError) << "Failed to serialise bootstrap journal entry.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+    }
+    AppendJournalRecord(serialised_entry, records);
+  }
+  const fs::path kJournalPath(BootstrapJournalPath(bootstrap_file_path));
+  {
+    std::ofstream journal(kJournalPath.string().c_str(),
+                          std::ios::out | std::ios::binary | std::ios::app);
+    if (!journal || !journal.write(records.data(), records.size()) || !journal.flush()) {
+      LOG(kError) << "Could not append to bootstrap journal at : " << kJournalPath;
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
+    }
+  }
+  boost::system::error_code error_code;
+  auto journal_size(fs::file_size(kJournalPath, error_code));
+  if (!error_code && journal_size > Parameters::bootstrap_journal_compaction_size)
+    WriteBootstrapContactInfo(ReadBootstrapContactInfo(bootstrap_file_path), bootstrap_file_path);
+}
+
 // TODO(Team) : Consider timestamp in forming the list. If offline for more than a week, then
 // list new nodes first
 BootstrapContacts ReadBootstrapFile(const fs::path& bootstrap_file_path) {
-  auto bootstrap_contacts(ParseBootstrapContacts(ReadFile(bootstrap_file_path).string()));
-
-  std::reverse(std::begin(bootstrap_contacts), std::end(bootstrap_contacts));
+  auto contacts(ReadBootstrapContactInfo(bootstrap_file_path));
+  BootstrapContacts bootstrap_contacts;
+  bootstrap_contacts.reserve(contacts.size());
+  for (auto itr(contacts.rbegin()); itr != contacts.rend(); ++itr)
+    bootstrap_contacts.push_back(itr->contact);
   return bootstrap_contacts;
 }
 
@@ -102,6 +288,8 @@ void WriteBootstrapFile(const BootstrapContacts& bootstrap_contacts,
     LOG(kError) << "Could not write bootstrap file at : " << bootstrap_file_path;
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
   }
+  boost::system::error_code error_code;
+  fs::remove(BootstrapJournalPath(bootstrap_file_path), error_code);
 }
 
 void UpdateBootstrapFile(const BootstrapContact& bootstrap_contact,
@@ -111,24 +299,16 @@ void UpdateBootstrapFile(const BootstrapContact& bootstrap_contact,
     LOG(kWarning) << "Invalid Endpoint" << bootstrap_contact;
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
   }
-  auto bootstrap_contacts(ParseBootstrapContacts(ReadFile(bootstrap_file_path).string()));
-  auto itr(std::find(std::begin(bootstrap_contacts), std::end(bootstrap_contacts),
-                     bootstrap_contact));
-  if (remove) {
-    if (itr != std::end(bootstrap_contacts)) {
-      bootstrap_contacts.erase(itr);
-      WriteBootstrapFile(bootstrap_contacts, bootstrap_file_path);
-    } else {
-      LOG(kVerbose) << "Can't find endpoint to remove : " << bootstrap_contact;
-    }
-  } else {
-    if (itr == std::end(bootstrap_contacts)) {
-      bootstrap_contacts.push_back(bootstrap_contact);
-      WriteBootstrapFile(bootstrap_contacts, bootstrap_file_path);
-    }  else {
-      LOG(kVerbose) << "Endpoint already in the list : " << bootstrap_contact;
-    }
+  boost::system::error_code error_code;
+  if (!fs::exists(bootstrap_file_path, error_code)) {
+    LOG(kError) << "No bootstrap file at : " << bootstrap_file_path;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::filesystem_io_error));
   }
+  // Adding a contact already listed, or removing one which isn't, is a no-op on replay.
+  BootstrapJournalEntry entry;
+  entry.info.contact = bootstrap_contact;
+  entry.removed = remove;
+  AppendBootstrapJournal(std::vector<BootstrapJournalEntry>(1, entry), bootstrap_file_path);
 }
 
 }  // namespace routing
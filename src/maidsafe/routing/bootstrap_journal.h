@@ -0,0 +1,62 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BOOTSTRAP_JOURNAL_H_
+#define MAIDSAFE_ROUTING_BOOTSTRAP_JOURNAL_H_
+
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/routing/bootstrap_contact_store.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The bootstrap file is a snapshot plus a journal of changes since, at "<file>.journal".  Updates
+// append to the journal and the snapshot is rewritten only once the journal has grown past
+// Parameters::bootstrap_journal_compaction_size.
+
+struct BootstrapJournalEntry {
+  BootstrapJournalEntry() : info(), removed(false), has_metadata(false) {}
+  BootstrapContactInfo info;
+  bool removed;
+  // If false, replaying the entry leaves what's known of the contact as it was.
+  bool has_metadata;
+};
+
+boost::filesystem::path BootstrapJournalPath(const boost::filesystem::path& bootstrap_file_path);
+
+// Snapshot with the journal replayed over it, oldest first.  Throws if the snapshot is missing.
+std::vector<BootstrapContactInfo> ReadBootstrapContactInfo(
+    const boost::filesystem::path& bootstrap_file_path);
+
+// Rewrites the snapshot and discards the journal.
+void WriteBootstrapContactInfo(const std::vector<BootstrapContactInfo>& contacts,
+                               const boost::filesystem::path& bootstrap_file_path);
+
+// Appends |entries| to the journal, compacting it into the snapshot if it has grown too large.
+void AppendBootstrapJournal(const std::vector<BootstrapJournalEntry>& entries,
+                            const boost::filesystem::path& bootstrap_file_path);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BOOTSTRAP_JOURNAL_H_
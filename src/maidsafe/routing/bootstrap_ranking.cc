@@ -0,0 +1,118 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/bootstrap_ranking.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Laplace-smoothed, so that a single outcome doesn't decide a contact's place outright.
+double SuccessRate(const BootstrapRanking::Record& record) {
+  return (record.successes + 1.0) / (record.successes + record.failures + 2.0);
+}
+
+bool Overloaded(const BootstrapRanking::Record& record) {
+  return record.load >= Parameters::relay_overload_load;
+}
+
+}  // unnamed namespace
+
+BootstrapRanking::BootstrapRanking() : mutex_(), records_() {}
+
+void BootstrapRanking::RecordSuccess(const BootstrapContact& contact,
+                                     std::chrono::milliseconds round_trip) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Record& record(records_[contact]);
+  record.round_trip = record.successes == 0 ? round_trip : (3 * record.round_trip + round_trip) / 4;
+  ++record.successes;
+}
+
+void BootstrapRanking::RecordFailure(const BootstrapContact& contact) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++records_[contact].failures;
+}
+
+void BootstrapRanking::RecordLoad(const BootstrapContact& contact, uint8_t load) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  records_[contact].load = load;
+}
+
+void BootstrapRanking::Insert(const BootstrapContact& contact, const Record& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  records_[contact] = record;
+}
+
+void BootstrapRanking::Order(BootstrapContacts& contacts) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (records_.empty())
+    return;
+  std::vector<std::pair<Record, BootstrapContact>> keyed;
+  keyed.reserve(contacts.size());
+  for (const auto& contact : contacts) {
+    auto found(records_.find(contact));
+    keyed.push_back(std::make_pair(found == records_.end() ? Record() : found->second, contact));
+  }
+  std::stable_sort(keyed.begin(), keyed.end(),
+                   [](const std::pair<Record, BootstrapContact>& lhs,
+                      const std::pair<Record, BootstrapContact>& rhs) {
+    if (Overloaded(lhs.first) != Overloaded(rhs.first))
+      return Overloaded(rhs.first);
+    const double kLhsRate(SuccessRate(lhs.first)), kRhsRate(SuccessRate(rhs.first));
+    if (kLhsRate != kRhsRate)
+      return kLhsRate > kRhsRate;
+    // Coarsely, so that small swings in load don't outweigh a much quicker round trip.
+    if (lhs.first.load / 32 != rhs.first.load / 32)
+      return lhs.first.load < rhs.first.load;
+    // Only contacts which have succeeded have a round trip to compare.
+    if ((lhs.first.successes == 0) != (rhs.first.successes == 0))
+      return rhs.first.successes == 0;
+    return lhs.first.round_trip < rhs.first.round_trip;
+  });
+  for (size_t index(0); index != contacts.size(); ++index)
+    contacts[index] = keyed[index].second;
+}
+
+BootstrapRanking::Record BootstrapRanking::Get(const BootstrapContact& contact) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(records_.find(contact));
+  return found == records_.end() ? Record() : found->second;
+}
+
+std::vector<BootstrapContacts> BootstrapRanking::Waves(const BootstrapContacts& ranked,
+                                                       size_t first_wave_size) {
+  std::vector<BootstrapContacts> waves;
+  size_t wave_size(first_wave_size == 0 ? ranked.size() : first_wave_size);
+  for (auto itr(ranked.begin()); itr != ranked.end();) {
+    auto wave_end(itr + std::min(wave_size, static_cast<size_t>(ranked.end() - itr)));
+    waves.push_back(BootstrapContacts(itr, wave_end));
+    itr = wave_end;
+    wave_size *= 2;
+  }
+  return waves;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,76 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_BOOTSTRAP_RANKING_H_
+#define MAIDSAFE_ROUTING_BOOTSTRAP_RANKING_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/routing/bootstrap_file_operations.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Outcomes of past bootstrap attempts to each contact, so that the contacts likeliest to answer,
+// and quickest, are tried first.
+class BootstrapRanking {
+ public:
+  struct Record {
+    Record() : successes(0), failures(0), round_trip(), load(0) {}
+    uint32_t successes, failures;
+    // Smoothed time taken by successful bootstraps
+    std::chrono::milliseconds round_trip;
+    // Last advertised by the contact (see Parameters::relay_overload_load); not persisted
+    uint8_t load;
+  };
+
+  BootstrapRanking();
+  void RecordSuccess(const BootstrapContact& contact, std::chrono::milliseconds round_trip);
+  void RecordFailure(const BootstrapContact& contact);
+  void RecordLoad(const BootstrapContact& contact, uint8_t load);
+  // Replaces what's recorded for |contact|, e.g. with outcomes kept from an earlier session.
+  void Insert(const BootstrapContact& contact, const Record& record);
+  // Stable-sorts |contacts| best first: overloaded contacts last, then by estimated success rate,
+  // then by lighter load, then by shorter round trip.  A contact never tried is taken to succeed
+  // half the time.
+  void Order(BootstrapContacts& contacts) const;
+  Record Get(const BootstrapContact& contact) const;
+
+  // Splits |ranked| into successive waves, the first of |first_wave_size| contacts and each after
+  // it twice the size of the last.  Zero |first_wave_size| gives a single wave of all contacts.
+  static std::vector<BootstrapContacts> Waves(const BootstrapContacts& ranked,
+                                              size_t first_wave_size);
+
+ private:
+  BootstrapRanking(const BootstrapRanking&);
+  BootstrapRanking& operator=(const BootstrapRanking&);
+
+  mutable std::mutex mutex_;
+  std::map<BootstrapContact, Record> records_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_BOOTSTRAP_RANKING_H_
@@ -16,13 +16,20 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
-#include <future>
-
 #include "maidsafe/routing/cache_manager.h"
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "maidsafe/routing/duplicate_filter.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/object_pool.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/signature_verifier.h"
 #include "maidsafe/routing/utils.h"
 
 
@@ -30,16 +37,45 @@ namespace maidsafe {
 
 namespace routing {
 
-CacheManager::CacheManager(const NodeId& node_id, NetworkUtils &network)
+namespace {
+
+const size_t kTrackedRequestCount(4096);
+
+// Each part is length prefixed, so that one get's key can't be made to match another's.
+std::string CoalescingKey(const protobuf::Message& message) {
+  std::string key;
+  auto append([&key](const std::string& part) {
+    key.append(std::to_string(part.size())).append(1, ':').append(part);
+  });
+  append(message.source_id());
+  append(message.destination_id());
+  append(message.data(0));
+  return key;
+}
+
+}  // unnamed namespace
+
+CacheManager::CacheManager(const NodeId& node_id, const asymm::PrivateKey& private_key,
+                           NetworkUtils &network, Timer<std::string>& timer)
     : kNodeId_(node_id),
+      kPrivateKey_(private_key),
       network_(network),
+      timer_(timer),
       message_and_caching_functors_(),
-      typed_message_and_caching_functors_() {}
+      typed_message_and_caching_functors_(),
+      chunk_cache_once_(),
+      chunk_cache_(),
+      built_chunk_cache_(nullptr),
+      chunk_cache_limit_(std::numeric_limits<uint64_t>::max()),
+      counters_(),
+      request_frequencies_mutex_(),
+      request_frequencies_(kTrackedRequestCount),
+      pending_gets_mutex_(),
+      pending_gets_() {}
 
 void CacheManager::InitialiseFunctors(const MessageAndCachingFunctors&
                                       message_and_caching_functors) {
 #ifndef TESTING
-  assert(message_and_caching_functors.message_received);
   assert(message_and_caching_functors.have_cache_data);
   assert(message_and_caching_functors.store_cache_data);
 #endif
@@ -56,6 +92,18 @@ void CacheManager::InitialiseFunctors(const TypedMessageAndCachingFunctor&
 
 void CacheManager::AddToCache(const protobuf::Message& message) {
 //  assert(!message.request());
+  if (message.has_cache_key() && message.has_popularity() &&
+      std::max(message.popularity(), Popularity(message.cache_key())) <
+          Parameters::cache_popularity_threshold) {
+    LOG(kVerbose) << "Not caching the reply to a rarely requested get, id: " << message.id();
+    return;
+  }
+  ChunkCache* chunk_cache(message.has_cache_key() ? GetChunkCache() : nullptr);
+  if (chunk_cache && message.data_size() == 1) {
+    size_t evicted(0);
+    chunk_cache->Put(message.cache_key(), message.data(0), &evicted);
+    CountersFor(message).evictions += evicted;
+  }
   if (message_and_caching_functors_.store_cache_data) {
     message_and_caching_functors_.store_cache_data(message.data(0));
   } else {
@@ -64,6 +112,30 @@ void CacheManager::AddToCache(const protobuf::Message& message) {
   }
 }
 
+ChunkCache* CacheManager::GetChunkCache() {
+  std::call_once(chunk_cache_once_, [this] {
+    if (Parameters::chunk_cache_bytes != 0) {
+      chunk_cache_.reset(new ChunkCache(Parameters::chunk_cache_bytes,
+                                        Parameters::num_chunks_to_cache,
+                                        Parameters::chunk_cache_shards));
+      chunk_cache_->SetByteLimit(chunk_cache_limit_);
+      built_chunk_cache_ = chunk_cache_.get();
+    }
+  });
+  return chunk_cache_.get();
+}
+
+uint64_t CacheManager::CachedBytes() const {
+  ChunkCache* chunk_cache(built_chunk_cache_);
+  return chunk_cache ? chunk_cache->bytes() : 0;
+}
+
+size_t CacheManager::LimitCache(uint64_t byte_limit) {
+  chunk_cache_limit_ = byte_limit;
+  ChunkCache* chunk_cache(built_chunk_cache_);
+  return chunk_cache ? chunk_cache->SetByteLimit(byte_limit) : 0;
+}
+
 void CacheManager::TypedMessageAddtoCache(const protobuf::Message& message) {
   assert(!(message.has_relay_id() || message.has_relay_connection_id()));
   if ((!message.has_group_source() && !message.has_group_destination()) &&
@@ -85,74 +157,220 @@ void CacheManager::TypedMessageAddtoCache(const protobuf::Message& message) {
   }
 }
 
-// TODO(Mahmoud): In the current implementation, typed and untyped messages are handled slighlty
-// differently, which needs to become the same after discussions.
-// 1) Typed message cache handling is blocking
-// 2) Untyped message cache handling is blocking, however, there is a deadline of
-//    Parameter::local_retreival_timeout seconds for a reply. If the reply is not received at this
-//    deadline the function returns "false".
-// The advantages of the second approach (the one for untyped messages) are:
-//     a) not allowing a slow node to slows down the flow
-//     b) to customise the timeout in such a way to avoid the potential conflicts with acks.
-bool CacheManager::HandleGetFromCache(protobuf::Message& message) {
+// Untyped lookups are completed through a Timer task, so that the application's reply, an empty
+// reply and the deadline passing all arrive as the one response the task expects, on whichever
+// thread produces it.
+bool CacheManager::HandleGetFromCache(protobuf::Message& message,
+                                      const CacheMissFunctor& cache_miss_functor) {
   assert(IsRequest(message));
   assert(IsCacheableGet(message));
-  auto cache_hit(std::make_shared<std::promise<bool>>());
-  auto future(cache_hit->get_future());
-  if (message_and_caching_functors_.have_cache_data) {
-    if (IsRequest(message)) {
-      LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] rcvd : "
-                    << MessageTypeString(message) << " from "
-                    << HexSubstr(message.source_id())
-                    << "   (id: " << message.id() << ")  --NodeLevel-- caching";
-      ReplyFunctor response_functor = [=](const std::string& reply_message) {
-          if (reply_message.empty()) {
-            LOG(kVerbose) << "No cache available, passing on the original request";
-            cache_hit->set_value(false);
-            return;
-          }
-
-          LOG(kVerbose) << "Cache contents: " << reply_message;
-
-          //  Responding with cached response
-          protobuf::Message message_out;
-          message_out.set_request(false);
-          message_out.set_hops_to_live(Parameters::hops_to_live);
-          message_out.set_destination_id(message.source_id());
-          message_out.set_type(message.type());
-          message_out.set_direct(true);
-          message_out.clear_data();
-          message_out.set_client_node(message.client_node());
-          message_out.set_routing_message(message.routing_message());
-          message_out.add_data(reply_message);
-          message_out.set_last_id(kNodeId_.string());
-          message_out.set_source_id(kNodeId_.string());
-          if (message.has_cacheable())
-            message_out.set_cacheable(static_cast<int32_t>(Cacheable::kPut));
-          if (message.has_id())
-            message_out.set_id(message.id());
-          else
-            LOG(kInfo) << "Message to be sent back had no ID.";
-
-          if (message.has_relay_id())
-            message_out.set_relay_id(message.relay_id());
-
-          if (message.has_relay_connection_id()) {
-            message_out.set_relay_connection_id(message.relay_connection_id());
-          }
-          network_.SendToClosestNode(message_out);
-          cache_hit->set_value(true);
-      };
-
-      if (message_and_caching_functors_.have_cache_data)
-        message_and_caching_functors_.have_cache_data(message.data(0), response_functor);
+  KindCounters& counters(CountersFor(message));
+  ++counters.lookups;
+  if (message.data_size() == 1) {
+    std::lock_guard<std::mutex> lock(request_frequencies_mutex_);
+    request_frequencies_.Increment(FrequencySketch::HashOf(message.data(0)));
+  }
+  ChunkCache* chunk_cache(message.data_size() == 1 ? GetChunkCache() : nullptr);
+  if (chunk_cache) {
+    std::shared_ptr<const std::string> cached(chunk_cache->Get(message.data(0)));
+    if (cached) {
+      LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] answering (id: " << message.id()
+                    << ") from the built-in cache";
+      ++counters.hits;
+      SendCachedReply(message, *cached);
+      return true;
     }
-  } else {
-    return TypedMessageHandleGetFromCache(message);
   }
-  if (future.wait_for(Parameters::local_retreival_timeout) != std::future_status::ready)
+  if (!message_and_caching_functors_.have_cache_data) {
+    if (TypedMessageHandleGetFromCache(message)) {
+      ++counters.hits;
+      return true;
+    }
+    ++counters.misses;
+    return CoalesceGet(message, cache_miss_functor);
+  }
+
+  LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] rcvd : "
+                << MessageTypeString(message) << " from "
+                << HexSubstr(message.source_id())
+                << "   (id: " << message.id() << ")  --NodeLevel-- caching";
+  std::shared_ptr<protobuf::Message> request(ObjectPool<protobuf::Message>::AcquireShared());
+  request->Swap(&message);
+  // Distinguishes the application answering with an empty reply from it not answering in time.
+  std::shared_ptr<std::atomic<bool>> answered(std::make_shared<std::atomic<bool>>(false));
+  const TaskId kTaskId(timer_.NewTaskId());
+  timer_.AddTask(Parameters::local_retreival_timeout,
+                 [this, request, answered, &counters,
+                  cache_miss_functor](std::string reply_message) {
+                   if (reply_message.empty()) {
+                     ++counters.misses;
+                     if (!*answered)
+                       ++counters.timeouts;
+                     if (CoalesceGet(*request, cache_miss_functor))
+                       return;
+                     LOG(kVerbose) << "No cache available, passing on the original request";
+                     cache_miss_functor(*request);
+                     return;
+                   }
+                   ++counters.hits;
+                   SendCachedReply(*request, reply_message);
+                 },
+                 1, kTaskId);
+  Timer<std::string>& timer(timer_);
+  ReplyFunctor response_functor = [&timer, kTaskId,
+                                   answered](const std::string& reply_message) {
+    *answered = true;
+    try {
+      timer.AddResponse(kTaskId, reply_message);
+    }
+    catch (const maidsafe_error&) {
+      LOG(kVerbose) << "Cache reply arrived after the lookup had timed out.";
+    }
+  };
+  message_and_caching_functors_.have_cache_data(request->data(0), response_functor);
+  return true;
+}
+
+CacheStatistics CacheManager::Statistics() const {
+  CacheStatistics statistics;
+  for (int kind(0); kind != CacheStatistics::kKindCount; ++kind) {
+    CacheCounters& counters(statistics.by_kind[kind]);
+    counters.lookups = counters_[kind].lookups;
+    counters.hits = counters_[kind].hits;
+    counters.misses = counters_[kind].misses;
+    counters.timeouts = counters_[kind].timeouts;
+    counters.bytes_served = counters_[kind].bytes_served;
+    counters.evictions = counters_[kind].evictions;
+    counters.coalesced = counters_[kind].coalesced;
+  }
+  return statistics;
+}
+
+CacheManager::KindCounters& CacheManager::CountersFor(const protobuf::Message& message) {
+  const bool kToGroup(message.has_group_destination() || !message.direct());
+  if (message.has_group_source())
+    return counters_[kToGroup ? CacheStatistics::kGroupToGroup : CacheStatistics::kGroupToSingle];
+  return counters_[kToGroup ? CacheStatistics::kSingleToGroup : CacheStatistics::kSingleToSingle];
+}
+
+uint32_t CacheManager::Popularity(const std::string& request_contents) const {
+  std::lock_guard<std::mutex> lock(request_frequencies_mutex_);
+  return request_frequencies_.Estimate(FrequencySketch::HashOf(request_contents));
+}
+
+void CacheManager::SendCachedReply(const protobuf::Message& message,
+                                   const std::string& reply_message) {
+  LOG(kVerbose) << "Cache contents: " << reply_message;
+  CountersFor(message).bytes_served += reply_message.size();
+
+  //  Responding with cached response
+  protobuf::Message message_out;
+  message_out.set_request(false);
+  message_out.set_hops_to_live(Parameters::hops_to_live);
+  message_out.set_destination_id(message.source_id());
+  message_out.set_type(message.type());
+  message_out.set_direct(true);
+  message_out.clear_data();
+  message_out.set_client_node(message.client_node());
+  message_out.set_routing_message(message.routing_message());
+  message_out.add_data(reply_message);
+  if (message.has_deadline())
+    message_out.set_deadline(message.deadline());
+  message_out.set_last_id(kNodeId_.string());
+  message_out.set_source_id(kNodeId_.string());
+  message_out.set_unique_id(NewMessageId(kNodeId_));
+  if (Parameters::sign_node_level_messages)
+    SignMessage(message_out, kPrivateKey_);
+  if (message.has_cacheable()) {
+    message_out.set_cacheable(static_cast<int32_t>(Cacheable::kPut));
+    message_out.set_cache_key(message.data(0));
+    message_out.set_popularity(Popularity(message.data(0)));
+  }
+  if (message.has_id())
+    message_out.set_id(message.id());
+  else
+    LOG(kInfo) << "Message to be sent back had no ID.";
+
+  if (message.has_relay_id())
+    message_out.set_relay_id(message.relay_id());
+
+  if (message.has_relay_connection_id()) {
+    message_out.set_relay_connection_id(message.relay_connection_id());
+  }
+  network_.SendToClosestNode(message_out);
+}
+
+bool CacheManager::CoalesceGet(protobuf::Message& message,
+                              const CacheMissFunctor& cache_miss_functor) {
+  // Only a get with a single reply, going on from here, has one worth sharing.
+  if (!Parameters::coalesce_cacheable_gets || !message.direct() || message.one_way() ||
+      message.has_group_destination() || message.data_size() != 1 ||
+      message.destination_id() == kNodeId_.string()) {
     return false;
-  return future.get();
+  }
+  std::shared_ptr<protobuf::Message> request(ObjectPool<protobuf::Message>::AcquireShared());
+  request->Swap(&message);
+  const std::string kKey(CoalescingKey(*request));
+  {
+    std::lock_guard<std::mutex> lock(pending_gets_mutex_);
+    auto pending(pending_gets_.find(kKey));
+    if (pending != pending_gets_.end()) {
+      LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] parking (id: " << request->id()
+                    << ") behind a coalesced get";
+      pending->second.push_back(request);
+      ++CountersFor(*request).coalesced;
+      return true;
+    }
+    pending_gets_[kKey].push_back(request);
+  }
+  const TaskId kTaskId(timer_.NewTaskId());
+  timer_.AddTask(Parameters::default_response_timeout,
+                 [this, kKey, cache_miss_functor](std::string reply_message) {
+                   CompleteCoalescedGet(kKey, reply_message, cache_miss_functor);
+                 },
+                 1, kTaskId);
+  SendCoalescedGet(*request, kTaskId);
+  return true;
+}
+
+void CacheManager::SendCoalescedGet(const protobuf::Message& message, TaskId task_id) {
+  // The reply comes back to this node as the response to |task_id|.
+  protobuf::Message message_out(message);
+  message_out.set_source_id(kNodeId_.string());
+  message_out.set_last_id(kNodeId_.string());
+  message_out.set_id(task_id);
+  message_out.set_unique_id(NewMessageId(kNodeId_));
+  message_out.set_hops_to_live(Parameters::hops_to_live);
+  message_out.set_client_node(false);
+  message_out.clear_relay_id();
+  message_out.clear_relay_connection_id();
+  message_out.clear_actual_destination_is_relay_id();
+  message_out.clear_route_history_tags();
+  message_out.clear_signature();
+  if (Parameters::sign_node_level_messages)
+    SignMessage(message_out, kPrivateKey_);
+  network_.SendToClosestNode(message_out);
+}
+
+void CacheManager::CompleteCoalescedGet(const std::string& key, const std::string& reply_message,
+                                        const CacheMissFunctor& cache_miss_functor) {
+  std::vector<std::shared_ptr<protobuf::Message>> requests;
+  {
+    std::lock_guard<std::mutex> lock(pending_gets_mutex_);
+    auto pending(pending_gets_.find(key));
+    if (pending == pending_gets_.end())
+      return;
+    requests.swap(pending->second);
+    pending_gets_.erase(pending);
+  }
+  LOG(kVerbose) << " [" << DebugId(kNodeId_) << "] completing a coalesced get for "
+                << requests.size() << " request(s)";
+  for (const auto& request : requests) {
+    if (reply_message.empty())
+      cache_miss_functor(*request);
+    else
+      SendCachedReply(*request, reply_message);
+  }
 }
 
 bool CacheManager::TypedMessageHandleGetFromCache(protobuf::Message& message) {
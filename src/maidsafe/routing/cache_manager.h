@@ -19,9 +19,20 @@
 #ifndef MAIDSAFE_ROUTING_CACHE_MANAGER_H_
 #define MAIDSAFE_ROUTING_CACHE_MANAGER_H_
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include "maidsafe/common/rsa.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/chunk_cache.h"
+#include "maidsafe/routing/frequency_sketch.h"
+#include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
 
@@ -35,25 +46,83 @@ class NetworkUtils;
 
 class CacheManager {
  public:
-  CacheManager(const NodeId& node_id, NetworkUtils& network);
+  // Resumes handling of a cacheable get request for which no cached reply was given.
+  typedef std::function<void(protobuf::Message& /*message*/)> CacheMissFunctor;
+
+  // Replies given from a cache are signed with |private_key|, see
+  // Parameters::sign_node_level_messages.
+  CacheManager(const NodeId& node_id, const asymm::PrivateKey& private_key, NetworkUtils& network,
+               Timer<std::string>& timer);
 
   void InitialiseFunctors(const MessageAndCachingFunctors& message_and_caching_functors);
   void InitialiseFunctors(const TypedMessageAndCachingFunctor& typed_message_and_caching_functors);
+  // Cacheable replies for requests seen fewer than Parameters::cache_popularity_threshold times,
+  // by this node or by the replier, aren't cached.
   void AddToCache(const protobuf::Message& message);
-  bool HandleGetFromCache(protobuf::Message& message);
+  // Returns true if |message| has been taken over.  It is answered at once if the built-in cache
+  // holds a reply (see Parameters::chunk_cache_bytes).  Otherwise, for the typed API, it is taken
+  // over if the get functor reports a hit.  For the untyped API it always is: the contents of
+  // |message| are handed to have_cache_data, and |cache_miss_functor| is called with them if no
+  // cached reply is given within Parameters::local_retreival_timeout.  Never blocks waiting for
+  // the application.  A request which misses every cache is coalesced with identical ones, so
+  // that only one is sent on (see Parameters::coalesce_cacheable_gets).
+  bool HandleGetFromCache(protobuf::Message& message, const CacheMissFunctor& cache_miss_functor);
+  // Estimated number of recent cacheable gets this node has seen with |request_contents|.
+  uint32_t Popularity(const std::string& request_contents) const;
+  CacheStatistics Statistics() const;
+  // Bytes held by the built-in cache, or zero if it hasn't been needed yet.
+  uint64_t CachedBytes() const;
+  // Holds the built-in cache to |byte_limit| bytes (see ChunkCache::SetByteLimit), now and once it
+  // is built, returning the number of entries evicted.
+  size_t LimitCache(uint64_t byte_limit);
 
  private:
   CacheManager(const CacheManager&);
   CacheManager(const CacheManager&&);
   CacheManager& operator=(const CacheManager&);
 
+  // CacheCounters, updated concurrently.
+  struct KindCounters {
+    KindCounters()
+        : lookups(0), hits(0), misses(0), timeouts(0), bytes_served(0), evictions(0),
+          coalesced(0) {}
+    std::atomic<uint64_t> lookups, hits, misses, timeouts, bytes_served, evictions, coalesced;
+  };
+
+  KindCounters& CountersFor(const protobuf::Message& message);
+  void SendCachedReply(const protobuf::Message& message, const std::string& reply_message);
+  // Returns true, having taken over |message|, if it is parked behind a get already in flight
+  // from this node for the same source, destination and contents, or if it starts one.  In the
+  // latter case a copy is sent on, signed by this node as its source, and every parked request is
+  // answered with its reply, or
+  // passed to |cache_miss_functor| if none arrives within Parameters::default_response_timeout.
+  bool CoalesceGet(protobuf::Message& message, const CacheMissFunctor& cache_miss_functor);
+  void SendCoalescedGet(const protobuf::Message& message, TaskId task_id);
+  void CompleteCoalescedGet(const std::string& key, const std::string& reply_message,
+                            const CacheMissFunctor& cache_miss_functor);
+  ChunkCache* GetChunkCache();
   void TypedMessageAddtoCache(const protobuf::Message& message);
   bool TypedMessageHandleGetFromCache(protobuf::Message& message);
 
   const NodeId kNodeId_;
+  const asymm::PrivateKey kPrivateKey_;
   NetworkUtils& network_;
+  Timer<std::string>& timer_;
   MessageAndCachingFunctors message_and_caching_functors_;
   TypedMessageAndCachingFunctor typed_message_and_caching_functors_;
+  // Built on first use, so that a node seeing no cacheable traffic allocates no shards.
+  std::once_flag chunk_cache_once_;
+  std::unique_ptr<ChunkCache> chunk_cache_;  // null unless Parameters::chunk_cache_bytes is set
+  // chunk_cache_, published once built for the callers which mustn't build it.
+  std::atomic<ChunkCache*> built_chunk_cache_;
+  std::atomic<uint64_t> chunk_cache_limit_;
+  KindCounters counters_[CacheStatistics::kKindCount];
+  mutable std::mutex request_frequencies_mutex_;
+  FrequencySketch request_frequencies_;
+  std::mutex pending_gets_mutex_;
+  // Requests awaiting the reply to a coalesced get, keyed by their source, destination and
+  // contents.
+  std::map<std::string, std::vector<std::shared_ptr<protobuf::Message>>> pending_gets_;
 };
 
 }  // namespace routing
@@ -0,0 +1,140 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/chunk_cache.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace maidsafe {
+
+namespace routing {
+
+ChunkCache::ChunkCache(uint64_t byte_budget, size_t max_entries, uint16_t shard_count)
+    : kShardByteBudget_(byte_budget / std::max<uint16_t>(shard_count, 1)),
+      kShardMaxEntries_((max_entries + std::max<uint16_t>(shard_count, 1) - 1) /
+                        std::max<uint16_t>(shard_count, 1)),
+      shard_byte_limit_(kShardByteBudget_),
+      shards_() {
+  for (uint16_t i(0); i != std::max<uint16_t>(shard_count, 1); ++i)
+    shards_.emplace_back(new Shard(kShardMaxEntries_));
+}
+
+std::shared_ptr<const std::string> ChunkCache::Get(const std::string& key) {
+  const uint64_t kHash(FrequencySketch::HashOf(key));
+  Shard& shard(ShardFor(kHash));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Misses are counted too, so that a chunk in demand is admitted once it is fetched.  Stores
+  // aren't, so popularity is only what was asked for.
+  shard.sketch.Increment(kHash);
+  auto found(shard.index.find(key));
+  if (found == shard.index.end())
+    return nullptr;
+  shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+  return found->second->value;
+}
+
+bool ChunkCache::Put(const std::string& key, std::string value, size_t* evicted) {
+  if (evicted)
+    *evicted = 0;
+  const uint64_t kHash(FrequencySketch::HashOf(key));
+  const uint64_t kSize(key.size() + value.size());
+  const uint64_t kShardByteLimit(shard_byte_limit_);
+  if (kSize > kShardByteLimit || kShardMaxEntries_ == 0)
+    return false;
+  std::shared_ptr<const std::string> stored(std::make_shared<const std::string>(std::move(value)));
+  Shard& shard(ShardFor(kHash));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto found(shard.index.find(key));
+  if (found != shard.index.end()) {
+    shard.bytes = shard.bytes - found->second->value->size() + stored->size();
+    found->second->value = stored;
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    while (shard.bytes > kShardByteLimit && shard.entries.size() > 1) {
+      Erase(shard, std::prev(shard.entries.end()));
+      if (evicted)
+        ++*evicted;
+    }
+    return true;
+  }
+
+  // The least recently used entries which would have to go are each compared against the newcomer
+  // before any is evicted.
+  const uint8_t kFrequency(shard.sketch.Estimate(kHash));
+  uint64_t freed(0);
+  size_t victim_count(0);
+  auto victim(shard.entries.end());
+  while (shard.bytes - freed + kSize > kShardByteLimit ||
+         shard.entries.size() - victim_count >= kShardMaxEntries_) {
+    --victim;
+    if (shard.sketch.Estimate(victim->hash) >= kFrequency)
+      return false;
+    freed += victim->key.size() + victim->value->size();
+    ++victim_count;
+  }
+  if (evicted)
+    *evicted = victim_count;
+  for (; victim_count != 0; --victim_count)
+    Erase(shard, std::prev(shard.entries.end()));
+  shard.entries.emplace_front(key, kHash, stored);
+  shard.index.insert(std::make_pair(key, shard.entries.begin()));
+  shard.bytes += kSize;
+  return true;
+}
+
+size_t ChunkCache::SetByteLimit(uint64_t byte_limit) {
+  const uint64_t kShardByteLimit(std::min(kShardByteBudget_, byte_limit / shards_.size()));
+  shard_byte_limit_ = kShardByteLimit;
+  size_t evicted(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    while (shard->bytes > kShardByteLimit) {
+      Erase(*shard, std::prev(shard->entries.end()));
+      ++evicted;
+    }
+  }
+  return evicted;
+}
+
+void ChunkCache::Erase(Shard& shard, std::list<Entry>::iterator itr) {
+  shard.bytes -= itr->key.size() + itr->value->size();
+  shard.index.erase(itr->key);
+  shard.entries.erase(itr);
+}
+
+uint64_t ChunkCache::bytes() const {
+  uint64_t total(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->bytes;
+  }
+  return total;
+}
+
+size_t ChunkCache::size() const {
+  size_t total(0);
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->entries.size();
+  }
+  return total;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
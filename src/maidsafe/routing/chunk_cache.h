@@ -0,0 +1,95 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CHUNK_CACHE_H_
+#define MAIDSAFE_ROUTING_CHUNK_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/routing/frequency_sketch.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A concurrent store of replies to cacheable gets, keyed by the request's contents and bounded in
+// both bytes and entries.  Keys are spread across shards, each with its own lock, budget and LRU
+// order.  Every lookup of a key is counted in an approximate frequency sketch, and a new entry is
+// only admitted over the entries it would evict if it has been asked for more often than each of
+// them (TinyLFU), so a scan of one-off requests can't flush out the popular chunks.
+class ChunkCache {
+ public:
+  // |byte_budget| and |max_entries| are shared evenly between |shard_count| shards, each holding
+  // at least one entry unless |max_entries| is zero.
+  ChunkCache(uint64_t byte_budget, size_t max_entries, uint16_t shard_count);
+  // Returns the value held for |key|, or null.
+  std::shared_ptr<const std::string> Get(const std::string& key);
+  // Caches |value| for |key|, displacing the least recently used entries if admitted.  Returns
+  // false if it wasn't admitted.  If |evicted| is given, it is set to the number displaced.
+  bool Put(const std::string& key, std::string value, size_t* evicted = nullptr);
+  // Holds the cache to |byte_limit| bytes, or to its budget if that is less, evicting the least
+  // recently used entries to fit at once.  Returns the number evicted.
+  size_t SetByteLimit(uint64_t byte_limit);
+  uint64_t bytes() const;
+  size_t size() const;
+
+ private:
+  ChunkCache(const ChunkCache&);
+  ChunkCache(const ChunkCache&&);
+  ChunkCache& operator=(const ChunkCache&);
+
+  struct Entry {
+    Entry(std::string key_in, uint64_t hash_in, std::shared_ptr<const std::string> value_in)
+        : key(std::move(key_in)), hash(hash_in), value(std::move(value_in)) {}
+    std::string key;
+    uint64_t hash;
+    std::shared_ptr<const std::string> value;
+  };
+
+  struct Shard {
+    explicit Shard(size_t expected_entries)
+        : mutex(), entries(), index(), sketch(expected_entries), bytes(0) {}
+    std::mutex mutex;
+    std::list<Entry> entries;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    FrequencySketch sketch;
+    uint64_t bytes;
+  };
+
+  Shard& ShardFor(uint64_t hash) { return *shards_[hash % shards_.size()]; }
+  void Erase(Shard& shard, std::list<Entry>::iterator itr);
+
+  const uint64_t kShardByteBudget_;
+  const size_t kShardMaxEntries_;
+  std::atomic<uint64_t> shard_byte_limit_;  // no more than kShardByteBudget_
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CHUNK_CACHE_H_
@@ -20,8 +20,11 @@
 
 #include "maidsafe/common/log.h"
 
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/memory_budget.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
@@ -30,11 +33,19 @@ namespace routing {
 namespace {
 
 typedef boost::asio::ip::udp::endpoint Endpoint;
+typedef boost::shared_lock<boost::shared_mutex> SharedLock;
+typedef boost::unique_lock<boost::shared_mutex> UniqueLock;
 
 }  // unnamed namespace
 
-ClientRoutingTable::ClientRoutingTable(NodeId node_id)
-    : kNodeId_(std::move(node_id)), nodes_(), mutex_() {}
+ClientRoutingTable::ClientRoutingTable(NodeId node_id, uint16_t max_size)
+    : kNodeId_(std::move(node_id)),
+      kMaxSize_(max_size),
+      nodes_(),
+      node_index_(),
+      connection_index_(),
+      key_index_(),
+      mutex_() {}
 
 bool ClientRoutingTable::AddNode(NodeInfo& node, const NodeId& furthest_close_node_id) {
   return AddOrCheckNode(node, furthest_close_node_id, true);
@@ -48,70 +59,77 @@ bool ClientRoutingTable::AddOrCheckNode(NodeInfo& node, const NodeId& furthest_c
                                         bool add) {
   if (node.node_id == kNodeId_)
     return false;
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (CheckRangeForNodeToBeAdded(node, furthest_close_node_id, add)) {
-    if (add) {
-      nodes_.push_back(node);
-      LOG(kInfo) << "Added to ClientRoutingTable :" << DebugId(node.node_id);
-      LOG(kVerbose) << PrintClientRoutingTable();
-    }
-    return true;
+  if (!add) {
+    SharedLock lock(mutex_);
+    return CheckRangeForNodeToBeAdded(node, furthest_close_node_id, add);
   }
-  return false;
+  UniqueLock lock(mutex_);
+  if (!CheckRangeForNodeToBeAdded(node, furthest_close_node_id, add))
+    return false;
+  node_index_.insert(std::make_pair(node.node_id, node.connection_id));
+  connection_index_[node.connection_id] = nodes_.size();
+  key_index_.insert(std::make_pair(PublicKeyFingerprint(node.public_key), node.node_id));
+  nodes_.push_back(node);
+  LOG(kInfo) << "Added to ClientRoutingTable :" << DebugId(node.node_id);
+  LOG(kVerbose) << PrintClientRoutingTable();
+  return true;
 }
 
 std::vector<NodeInfo> ClientRoutingTable::DropNodes(const NodeId& node_to_drop) {
   std::vector<NodeInfo> nodes_info;
-  std::lock_guard<std::mutex> lock(mutex_);
-  uint16_t i(0);
-  while (i < nodes_.size()) {
-    if (nodes_.at(i).node_id == node_to_drop) {
-      nodes_info.push_back(nodes_.at(i));
-      nodes_.erase(nodes_.begin() + i);
-    } else {
-      ++i;
-    }
-  }
+  UniqueLock lock(mutex_);
+  auto range(node_index_.equal_range(node_to_drop));
+  std::vector<NodeId> connection_ids;
+  for (auto itr(range.first); itr != range.second; ++itr)
+    connection_ids.push_back(itr->second);
+  for (const auto& connection_id : connection_ids)
+    nodes_info.push_back(Erase(connection_index_.find(connection_id)));
   return nodes_info;
 }
 
 NodeInfo ClientRoutingTable::DropConnection(const NodeId& connection_to_drop) {
-  NodeInfo node_info;
-  std::lock_guard<std::mutex> lock(mutex_);
-  for (auto it = nodes_.begin(); it != nodes_.end(); ++it) {
-    if ((*it).connection_id == connection_to_drop) {
-      node_info = *it;
-      nodes_.erase(it);
-      break;
-    }
-  }
-  return node_info;
+  UniqueLock lock(mutex_);
+  auto found(connection_index_.find(connection_to_drop));
+  if (found == connection_index_.end())
+    return NodeInfo();
+  return Erase(found);
 }
 
 std::vector<NodeInfo> ClientRoutingTable::GetNodesInfo(const NodeId& node_id) const {
   std::vector<NodeInfo> nodes_info;
-  std::lock_guard<std::mutex> lock(mutex_);
-  for (const auto& elem : nodes_) {
-    if ((elem).node_id == node_id)
-      nodes_info.push_back(elem);
-  }
+  SharedLock lock(mutex_);
+  auto range(node_index_.equal_range(node_id));
+  for (auto itr(range.first); itr != range.second; ++itr)
+    nodes_info.push_back(nodes_.at(connection_index_.at(itr->second)));
   return nodes_info;
 }
 
 bool ClientRoutingTable::Contains(const NodeId& node_id) const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return std::find_if(nodes_.begin(), nodes_.end(), [node_id](const NodeInfo & node_info) {
-           return node_info.node_id == node_id;
-         }) != nodes_.end();
+  SharedLock lock(mutex_);
+  return node_index_.count(node_id) != 0;
 }
 
 bool ClientRoutingTable::IsConnected(const NodeId& node_id) const { return Contains(node_id); }
 
 size_t ClientRoutingTable::size() const {
-  std::lock_guard<std::mutex> lock(mutex_);
+  SharedLock lock(mutex_);
   return nodes_.size();
 }
 
+uint64_t ClientRoutingTable::MemoryBytes() const {
+  SharedLock lock(mutex_);
+  uint64_t bytes(NodeInfoBytes(nodes_) + HashedContainerBytes(node_index_) +
+                 HashedContainerBytes(connection_index_) + HashedContainerBytes(key_index_));
+  for (const auto& key : key_index_)
+    bytes += key.first.capacity();
+  return bytes;
+}
+
+std::vector<NodeInfo> ClientRoutingTable::nodes() const {
+  SharedLock lock(mutex_);
+  return nodes_;
+}
+
 // TODO(Prakash): re-order checks to increase performance if needed
 bool ClientRoutingTable::CheckValidParameters(const NodeInfo& node) const {
   // bucket index is not used in ClientRoutingTable
@@ -124,30 +142,26 @@ bool ClientRoutingTable::CheckValidParameters(const NodeInfo& node) const {
 
 bool ClientRoutingTable::CheckParametersAreUnique(const NodeInfo& node) const {
   // If we already have a duplicate endpoint return false
-  if (std::find_if(nodes_.begin(), nodes_.end(), [node](const NodeInfo & node_info) {
-        return (node_info.connection_id == node.connection_id);
-      }) != nodes_.end()) {
+  if (connection_index_.count(node.connection_id) != 0) {
     LOG(kInfo) << "Already have node with this connection_id.";
     return false;
   }
 
   // If we already have a duplicate public key under different node ID return false
-  //  if (std::find_if(nodes_.begin(),
-  //                   nodes_.end(),
-  //                   [node](const NodeInfo& node_info) {
-  //                     return (asymm::MatchingKeys(node_info.public_key, node.public_key) &&
-  //                             (node_info.node_id != node.node_id));
-  //                   }) != nodes_.end()) {
-  //    LOG(kInfo) << "Already have a different node ID with this public key.";
-  //    return false;
-  //  }
+  auto range(key_index_.equal_range(PublicKeyFingerprint(node.public_key)));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (itr->second != node.node_id) {
+      LOG(kInfo) << "Already have a different node ID with this public key.";
+      return false;
+    }
+  }
   return true;
 }
 
 bool ClientRoutingTable::CheckRangeForNodeToBeAdded(NodeInfo& node,
                                                     const NodeId& furthest_close_node_id,
                                                     bool add) const {
-  if (nodes_.size() >= Parameters::max_client_routing_table_size) {
+  if (nodes_.size() >= kMaxSize_) {
     LOG(kInfo) << "ClientRoutingTable full.";
     return false;
   }
@@ -160,13 +174,43 @@ bool ClientRoutingTable::CheckRangeForNodeToBeAdded(NodeInfo& node,
   return IsThisNodeInRange(node.node_id, furthest_close_node_id);
 }
 
+NodeInfo ClientRoutingTable::Erase(
+    std::unordered_map<NodeId, size_t, NodeIdHash>::iterator connection_itr) {
+  assert(connection_itr != connection_index_.end());
+  size_t position(connection_itr->second);
+  NodeInfo node_info(nodes_.at(position));
+  connection_index_.erase(connection_itr);
+  auto range(node_index_.equal_range(node_info.node_id));
+  for (auto itr(range.first); itr != range.second; ++itr) {
+    if (itr->second == node_info.connection_id) {
+      node_index_.erase(itr);
+      break;
+    }
+  }
+  // Any of the node's entries in key_index_ will do, as they only differ by connection.
+  auto keys(key_index_.equal_range(PublicKeyFingerprint(node_info.public_key)));
+  for (auto itr(keys.first); itr != keys.second; ++itr) {
+    if (itr->second == node_info.node_id) {
+      key_index_.erase(itr);
+      break;
+    }
+  }
+  // Order of nodes_ isn't significant, so fill the gap with the last entry.
+  if (position != nodes_.size() - 1) {
+    nodes_.at(position) = nodes_.back();
+    connection_index_[nodes_.at(position).connection_id] = position;
+  }
+  nodes_.pop_back();
+  return node_info;
+}
+
 bool ClientRoutingTable::IsThisNodeInRange(const NodeId& node_id,
                                            const NodeId& furthest_close_node_id) const {
   if (furthest_close_node_id == node_id) {
     assert(false && "node_id (client) and furthest_close_node_id (vault) should not be equal.");
     return false;
   }
-  return (furthest_close_node_id ^ kNodeId_) > (node_id ^ kNodeId_);
+  return Distance(node_id, kNodeId_) < Distance(furthest_close_node_id, kNodeId_);
 }
 
 std::string ClientRoutingTable::PrintClientRoutingTable() {
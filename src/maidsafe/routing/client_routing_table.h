@@ -20,16 +20,19 @@
 #define MAIDSAFE_ROUTING_CLIENT_ROUTING_TABLE_H_
 
 #include <cstdint>
-#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
+#include "boost/thread/shared_mutex.hpp"
 
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/rsa.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/parameters.h"
 
 namespace maidsafe {
 
@@ -49,9 +52,13 @@ namespace protobuf {
 class Contact;
 }
 
+// Clients connected to this vault, several connections per client allowed.  Entries are indexed
+// by node ID, connection ID and public key, so that no operation scans the table and it can hold
+// as many clients as its max_size allows.  Lookups share the lock.
 class ClientRoutingTable {
  public:
-  explicit ClientRoutingTable(NodeId node_id);
+  explicit ClientRoutingTable(
+      NodeId node_id, uint16_t max_size = Parameters::max_client_routing_table_size);
   bool AddNode(NodeInfo& node, const NodeId& furthest_close_node_id);
   bool CheckNode(NodeInfo& node, const NodeId& furthest_close_node_id);
   std::vector<NodeInfo> DropNodes(const NodeId& node_to_drop);
@@ -60,6 +67,10 @@ class ClientRoutingTable {
   bool Contains(const NodeId& node_id) const;
   bool IsConnected(const NodeId& node_id) const;
   size_t size() const;
+  uint16_t kMaxSize() const { return kMaxSize_; }
+  // Estimated heap bytes held, less the nodes' public keys (see MemoryStatistics).
+  uint64_t MemoryBytes() const;
+  std::vector<NodeInfo> nodes() const;
   NodeId kNodeId() const { return kNodeId_; }
 
   friend class test::GenericNode;
@@ -74,14 +85,21 @@ class ClientRoutingTable {
   bool CheckRangeForNodeToBeAdded(NodeInfo& node, const NodeId& furthest_close_node_id,
                                   bool add) const;
   bool IsThisNodeInRange(const NodeId& node_id, const NodeId& furthest_close_node_id) const;
+  NodeInfo Erase(std::unordered_map<NodeId, size_t, NodeIdHash>::iterator connection_itr);
   std::string PrintClientRoutingTable();
 
   friend class test::BasicClientRoutingTableTest;
   friend class test::BasicClientRoutingTableTest_BEH_IsThisNodeInRange_Test;
 
   const NodeId kNodeId_;
+  const uint16_t kMaxSize_;
   std::vector<NodeInfo> nodes_;
-  mutable std::mutex mutex_;
+  // Connection IDs of each node, and position in nodes_ of each connection
+  std::unordered_multimap<NodeId, NodeId, NodeIdHash> node_index_;
+  std::unordered_map<NodeId, size_t, NodeIdHash> connection_index_;
+  // Node ID of each connection, keyed by PublicKeyFingerprint of its key
+  std::unordered_multimap<std::string, NodeId> key_index_;
+  mutable boost::shared_mutex mutex_;
 };
 
 }  // namespace routing
@@ -0,0 +1,111 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/connect_admission.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+ConnectAdmission::ConnectAdmission(size_t max_attempts, size_t max_queued,
+                                   std::chrono::steady_clock::duration timeout)
+    : kMaxAttempts_(max_attempts), kMaxQueued_(max_queued), kTimeout_(timeout), mutex_(),
+      attempts_(), queue_(), expired_() {}
+
+bool ConnectAdmission::TryAdmit(const NodeId& peer_id, std::chrono::steady_clock::time_point now) {
+  if (kMaxAttempts_ == 0)
+    return true;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Expire(now);
+  auto itr(attempts_.find(peer_id));
+  if (itr != attempts_.end()) {
+    itr->second = now;
+    return true;
+  }
+  if (attempts_.size() >= kMaxAttempts_)
+    return false;
+  attempts_.insert(std::make_pair(peer_id, now));
+  return true;
+}
+
+bool ConnectAdmission::Queue(protobuf::Message& message,
+                             std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Expire(now);
+  if (queue_.size() >= kMaxQueued_)
+    return false;
+  queue_.push_back(QueuedRequest());
+  queue_.back().message.Swap(&message);
+  queue_.back().queued = now;
+  return true;
+}
+
+void ConnectAdmission::Release(const NodeId& peer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  attempts_.erase(peer_id);
+}
+
+bool ConnectAdmission::NextQueued(protobuf::Message& message,
+                                  std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Expire(now);
+  if (queue_.empty() || (kMaxAttempts_ != 0 && attempts_.size() >= kMaxAttempts_))
+    return false;
+  message.Swap(&queue_.front().message);
+  queue_.pop_front();
+  return true;
+}
+
+bool ConnectAdmission::NextExpired(protobuf::Message& message) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (expired_.empty())
+    return false;
+  message.Swap(&expired_.front());
+  expired_.pop_front();
+  return true;
+}
+
+size_t ConnectAdmission::attempts() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return attempts_.size();
+}
+
+size_t ConnectAdmission::queued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+void ConnectAdmission::Expire(std::chrono::steady_clock::time_point now) {
+  for (auto itr(attempts_.begin()); itr != attempts_.end();) {
+    if (now - itr->second >= kTimeout_)
+      itr = attempts_.erase(itr);
+    else
+      ++itr;
+  }
+  while (!queue_.empty() && now - queue_.front().queued >= kTimeout_) {
+    if (expired_.size() >= kMaxQueued_)
+      expired_.pop_front();
+    expired_.push_back(protobuf::Message());
+    expired_.back().Swap(&queue_.front().message);
+    queue_.pop_front();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
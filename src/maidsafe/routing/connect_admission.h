@@ -0,0 +1,82 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CONNECT_ADMISSION_H_
+#define MAIDSAFE_ROUTING_CONNECT_ADMISSION_H_
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Limits the connect attempts started in answer to ConnectRequests to |max_attempts| at a time.
+// Requests arriving while that many are running wait in a queue of up to |max_queued|, oldest
+// first, until an attempt ends.  An attempt not ended within |timeout| is taken to have failed,
+// and a request queued for longer than that is set aside to be refused, its requester having moved
+// on.  Zero |max_attempts| disables the limit.
+class ConnectAdmission {
+ public:
+  ConnectAdmission(size_t max_attempts, size_t max_queued,
+                   std::chrono::steady_clock::duration timeout);
+  // True if an attempt with |peer_id| is running or can start now, in which case it's counted.
+  bool TryAdmit(const NodeId& peer_id, std::chrono::steady_clock::time_point now);
+  // Takes |message| to hand back from NextQueued.  False if the queue is full.
+  bool Queue(protobuf::Message& message, std::chrono::steady_clock::time_point now);
+  void Release(const NodeId& peer_id);
+  // Takes the oldest queued request into |message| if an attempt could start for it now.
+  bool NextQueued(protobuf::Message& message, std::chrono::steady_clock::time_point now);
+  // Takes the oldest request which was queued for too long into |message|.
+  bool NextExpired(protobuf::Message& message);
+  size_t attempts() const;
+  size_t queued() const;
+
+ private:
+  struct QueuedRequest {
+    QueuedRequest() : message(), queued() {}
+    protobuf::Message message;
+    std::chrono::steady_clock::time_point queued;
+  };
+
+  ConnectAdmission(const ConnectAdmission&);
+  ConnectAdmission& operator=(const ConnectAdmission&);
+
+  // Must be called with mutex_ held.
+  void Expire(std::chrono::steady_clock::time_point now);
+
+  const size_t kMaxAttempts_, kMaxQueued_;
+  const std::chrono::steady_clock::duration kTimeout_;
+  mutable std::mutex mutex_;
+  // Peer IDs to the times their attempts started
+  std::map<NodeId, std::chrono::steady_clock::time_point> attempts_;
+  std::deque<QueuedRequest> queue_;
+  std::deque<protobuf::Message> expired_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CONNECT_ADMISSION_H_
@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/core_executors.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+CoreExecutors::CoreExecutors(uint16_t count, bool pin_threads)
+    : executors_(), stop_mutex_(), stopped_(false) {
+  const unsigned kCores(std::max(std::thread::hardware_concurrency(), 1U));
+  for (uint16_t i(0); i != std::max<uint16_t>(count, 1); ++i) {
+    executors_.emplace_back(new Executor);
+    Executor& executor(*executors_.back());
+    executor.thread = std::thread([&executor] { executor.io_service.run(); });
+    if (pin_threads)
+      Pin(executor.thread, i % kCores);
+  }
+}
+
+CoreExecutors::~CoreExecutors() { Stop(); }
+
+void CoreExecutors::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    if (stopped_)
+      return;
+    stopped_ = true;
+  }
+  for (auto& executor : executors_) {
+    executor->work.reset();
+    executor->io_service.stop();
+  }
+  for (auto& executor : executors_) {
+    if (executor->thread.get_id() == std::this_thread::get_id())
+      executor->thread.detach();
+    else if (executor->thread.joinable())
+      executor->thread.join();
+  }
+}
+
+void CoreExecutors::Pin(std::thread& thread, unsigned core) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core, &cpu_set);
+  int result(pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set));
+  if (result != 0)
+    LOG(kWarning) << "Failed to pin a dispatch thread to core " << core << ": " << result;
+#else
+  static_cast<void>(thread);
+  static_cast<void>(core);
+#endif
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
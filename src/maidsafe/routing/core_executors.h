@@ -0,0 +1,70 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_CORE_EXECUTORS_H_
+#define MAIDSAFE_ROUTING_CORE_EXECUTORS_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A set of single-threaded io_services, one per core, for work which is partitioned so that each
+// part stays on one core (see Parameters::dispatch_cores).  Where the platform allows, each thread
+// is pinned to its core.
+class CoreExecutors {
+ public:
+  // Uses cores 0 to |count| - 1, wrapping if there are fewer cores than that.
+  CoreExecutors(uint16_t count, bool pin_threads);
+  ~CoreExecutors();
+  size_t size() const { return executors_.size(); }
+  boost::asio::io_service& service(size_t index) { return executors_[index]->io_service; }
+  // Joins the threads after any handlers they are running.  Those still queued are discarded.
+  void Stop();
+
+ private:
+  struct Executor {
+    Executor() : io_service(), work(new boost::asio::io_service::work(io_service)), thread() {}
+    boost::asio::io_service io_service;
+    std::unique_ptr<boost::asio::io_service::work> work;
+    std::thread thread;
+  };
+
+  CoreExecutors(const CoreExecutors&);
+  CoreExecutors(const CoreExecutors&&);
+  CoreExecutors& operator=(const CoreExecutors&);
+
+  static void Pin(std::thread& thread, unsigned core);
+
+  std::vector<std::unique_ptr<Executor>> executors_;
+  std::mutex stop_mutex_;
+  bool stopped_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_CORE_EXECUTORS_H_
@@ -0,0 +1,117 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/data_compression.h"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+#include "cryptopp/gzip.h"
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/message.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Gunzips |compressed| as crypto::Uncompress does, but a chunk at a time, giving up once more than
+// |max_size| bytes have come out.
+bool BoundedUncompress(const std::string& compressed, size_t max_size, std::string& uncompressed) {
+  const size_t kChunkSize(4096);
+  const unsigned char* input(reinterpret_cast<const unsigned char*>(compressed.data()));
+  CryptoPP::Gunzip gunzip;
+  for (size_t offset(0); offset < compressed.size(); offset += kChunkSize) {
+    gunzip.Put(input + offset, std::min(kChunkSize, compressed.size() - offset));
+    if (gunzip.MaxRetrievable() > max_size)
+      return false;
+  }
+  gunzip.MessageEnd();
+  if (gunzip.MaxRetrievable() > max_size)
+    return false;
+  uncompressed.assign(static_cast<size_t>(gunzip.MaxRetrievable()), '\0');
+  if (!uncompressed.empty())
+    gunzip.Get(reinterpret_cast<unsigned char*>(&uncompressed[0]), uncompressed.size());
+  return true;
+}
+
+}  // unnamed namespace
+
+uint32_t DecodableCompression() { return 1U << protobuf::kDeflate; }
+
+bool IsCompressible(const protobuf::Message& message) {
+  // Cacheable payloads are read by the caches on the way, so are left as they are.
+  return Parameters::compression_threshold != 0 && IsNodeLevelMessage(message) &&
+         message.data_size() == 1 && !message.has_data_compression() &&
+         message.cacheable() == static_cast<int32_t>(Cacheable::kNone) &&
+         message.data(0).size() >= Parameters::compression_threshold;
+}
+
+bool CompressData(protobuf::Message& message) {
+  if (!IsCompressible(message))
+    return false;
+  try {
+    crypto::CompressedText compressed(crypto::Compress(
+        crypto::UncompressedText(message.data(0)), Parameters::compression_level));
+    if (compressed.string().size() >= message.data(0).size())
+      return false;
+    message.set_data(0, compressed.string());
+    message.set_data_compression(protobuf::kDeflate);
+    return true;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to compress payload: " << e.what();
+    return false;
+  }
+}
+
+bool UncompressData(protobuf::Message& message) {
+  if (!message.has_data_compression() || message.data_compression() == protobuf::kUncompressed) {
+    message.clear_data_compression();
+    return true;
+  }
+  if (message.data_compression() != protobuf::kDeflate || message.data_size() != 1)
+    return false;
+  try {
+    std::string uncompressed;
+    if (!BoundedUncompress(message.data(0), Parameters::max_data_size, uncompressed)) {
+      LOG(kWarning) << "Dropping payload which uncompresses to over " << Parameters::max_data_size
+                    << " bytes, id: " << message.id();
+      return false;
+    }
+    message.set_data(0, uncompressed);
+    message.clear_data_compression();
+    return true;
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to uncompress payload: " << e.what() << " id: " << message.id();
+    return false;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
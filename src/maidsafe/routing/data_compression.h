@@ -0,0 +1,54 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_DATA_COMPRESSION_H_
+#define MAIDSAFE_ROUTING_DATA_COMPRESSION_H_
+
+#include <cstdint>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Node-level payloads are compressed by NetworkUtils::RudpSend on the first hop to a peer whose
+// Contact says it decodes them, and are forwarded as they are from then on.  They are uncompressed
+// by a node about to act on them, or before being sent to a peer which can't decode them.
+
+// The DataCompression bits to advertise in this node's Contact.
+uint32_t DecodableCompression();
+
+// Whether |message| carries a node-level payload worth compressing.
+bool IsCompressible(const protobuf::Message& message);
+
+// Deflates the payload of |message| if it is compressible and gets smaller, returning whether it
+// did.
+bool CompressData(protobuf::Message& message);
+
+// Restores the payload of a compressed |message|, returning false if it can't be decoded or would
+// be over Parameters::max_data_size bytes.
+bool UncompressData(protobuf::Message& message);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_DATA_COMPRESSION_H_
@@ -0,0 +1,131 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_DISTANCE_H_
+#define MAIDSAFE_ROUTING_DISTANCE_H_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// XOR distance between two node IDs, held as big-endian 64-bit words so that comparing two
+// distances is at most kWords integer compares rather than a byte-by-byte string walk.
+class Distance {
+ public:
+  static const size_t kWords = NodeId::kSize / sizeof(uint64_t);
+
+  Distance() : words_() { words_.fill(0); }
+  Distance(const NodeId& lhs, const NodeId& rhs) : words_() {
+    const std::string lhs_raw(lhs.string()), rhs_raw(rhs.string());
+    assert(lhs_raw.size() == NodeId::kSize && rhs_raw.size() == NodeId::kSize);
+    for (size_t index(0); index != kWords; ++index)
+      words_[index] = LoadWord(lhs_raw, index) ^ LoadWord(rhs_raw, index);
+  }
+
+  Distance operator^(const Distance& other) const {
+    Distance result;
+    for (size_t index(0); index != kWords; ++index)
+      result.words_[index] = words_[index] ^ other.words_[index];
+    return result;
+  }
+
+  // Index of the highest set bit, or 0 for a zero distance.  For a distance from this node's own ID
+  // this is the routing table bucket index.
+  int32_t HighestBit() const {
+    for (size_t index(0); index != kWords; ++index) {
+      if (words_[index] != 0) {
+        int32_t bit(63);
+        while ((words_[index] >> bit) == 0)
+          --bit;
+        return static_cast<int32_t>(64 * (kWords - 1 - index)) + bit;
+      }
+    }
+    return 0;
+  }
+
+  bool operator<(const Distance& other) const { return words_ < other.words_; }
+  bool operator==(const Distance& other) const { return words_ == other.words_; }
+  bool operator!=(const Distance& other) const { return words_ != other.words_; }
+
+ private:
+  static uint64_t LoadWord(const std::string& raw_id, size_t index) {
+    uint64_t word(0);
+    for (size_t offset(index * sizeof(uint64_t)); offset != (index + 1) * sizeof(uint64_t);
+         ++offset)
+      word = (word << 8) | static_cast<unsigned char>(raw_id[offset]);
+    return word;
+  }
+
+  std::array<uint64_t, kWords> words_;
+};
+
+inline bool CloserToTarget(const NodeId& lhs, const NodeId& rhs, const NodeId& target) {
+  return Distance(lhs, target) < Distance(rhs, target);
+}
+
+inline const NodeId& NodeIdOf(const NodeId& node_id) { return node_id; }
+inline const NodeId& NodeIdOf(const NodeInfo& node_info) { return node_info.node_id; }
+
+// Reorders |items| so that the first |count| are the closest to |target|, in order.  Each item's
+// distance is computed once up front, so the sort itself compares cached keys only.
+template <typename T, typename Projection>
+void PartialSortByDistance(std::vector<T>& items, const NodeId& target, size_t count,
+                           Projection node_id_of) {
+  count = std::min(count, items.size());
+  if (count == 0)
+    return;
+  std::vector<std::pair<Distance, size_t>> keys;
+  keys.reserve(items.size());
+  for (size_t index(0); index != items.size(); ++index)
+    keys.push_back(std::make_pair(Distance(node_id_of(items[index]), target), index));
+  std::partial_sort(keys.begin(), keys.begin() + count, keys.end());
+  std::vector<T> sorted;
+  sorted.reserve(items.size());
+  for (const auto& key : keys)
+    sorted.push_back(std::move(items[key.second]));
+  items.swap(sorted);
+}
+
+template <typename T>
+void PartialSortByDistance(std::vector<T>& items, const NodeId& target, size_t count) {
+  PartialSortByDistance(items, target, count,
+                        [](const T & item)->const NodeId & { return NodeIdOf(item); });
+}
+
+template <typename T>
+void SortByDistance(std::vector<T>& items, const NodeId& target) {
+  PartialSortByDistance(items, target, items.size());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_DISTANCE_H_
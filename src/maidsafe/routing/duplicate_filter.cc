@@ -0,0 +1,121 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/duplicate_filter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// The finaliser of splitmix64.
+uint64_t Mix(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+// A power of two slot count keeps each generation at most half full.
+size_t SlotCount(size_t generation_capacity) {
+  size_t slot_count(16);
+  while (slot_count < 2 * generation_capacity)
+    slot_count *= 2;
+  return slot_count;
+}
+
+}  // unnamed namespace
+
+uint64_t NewMessageId(const NodeId& source_id) {
+  static std::atomic<uint32_t> counter(RandomUint32());
+  const std::string kSourceId(source_id.string());
+  uint64_t prefix(0);
+  for (size_t i(0); i != 4 && i != kSourceId.size(); ++i)
+    prefix = (prefix << 8) | static_cast<uint8_t>(kSourceId[i]);
+  return (prefix << 32) | counter++;
+}
+
+uint64_t DuplicateKey(uint64_t unique_id, const std::string& destination_id, bool request,
+                      bool visited) {
+  uint64_t flags((request ? 1 : 0) | (visited ? 2 : 0));
+  return Mix(Mix(unique_id) ^ std::hash<std::string>()(destination_id) ^ flags);
+}
+
+DuplicateFilter::Generation::Generation(size_t slot_count)
+    : slots(slot_count, 0), count(0), started(RoutingClock::now()) {}
+
+bool DuplicateFilter::Generation::Contains(uint64_t key) const {
+  const size_t kMask(slots.size() - 1);
+  for (size_t index(key & kMask); slots[index] != 0; index = (index + 1) & kMask) {
+    if (slots[index] == key)
+      return true;
+  }
+  return false;
+}
+
+void DuplicateFilter::Generation::Insert(uint64_t key) {
+  const size_t kMask(slots.size() - 1);
+  size_t index(key & kMask);
+  while (slots[index] != 0)
+    index = (index + 1) & kMask;
+  slots[index] = key;
+  ++count;
+}
+
+void DuplicateFilter::Generation::Clear(std::chrono::steady_clock::time_point now) {
+  std::fill(std::begin(slots), std::end(slots), 0);
+  count = 0;
+  started = now;
+}
+
+DuplicateFilter::DuplicateFilter(size_t capacity, std::chrono::steady_clock::duration window)
+    : mutex_(),
+      generation_capacity_(std::max<size_t>(capacity / 2, 1)),
+      generation_lifetime_(window / 2),
+      current_(SlotCount(generation_capacity_)),
+      previous_(SlotCount(generation_capacity_)) {}
+
+bool DuplicateFilter::Insert(uint64_t key) {
+  if (key == 0)  // reserved for empty slots
+    key = 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (current_.Contains(key) || previous_.Contains(key))
+    return false;
+  auto now(RoutingClock::now());
+  if (current_.count >= generation_capacity_ || now - current_.started >= generation_lifetime_) {
+    std::swap(current_, previous_);
+    current_.Clear(now);
+    // After a quiet spell the older generation may be past the window too.
+    if (now - previous_.started >= 2 * generation_lifetime_)
+      previous_.Clear(now);
+  }
+  current_.Insert(key);
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
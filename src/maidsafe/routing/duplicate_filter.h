@@ -0,0 +1,78 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
+#define MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Returns a new value for protobuf::Message::unique_id.  The leading 32 bits are taken from
+// |source_id| and the rest from a counter started at a random value, so IDs from different
+// sources, and from successive runs of one source, don't collide.
+uint64_t NewMessageId(const NodeId& source_id);
+
+// Identifies one delivery of a message.  Copies of a message fanned out to several destinations,
+// and a response carrying its request's ID, are told apart.
+uint64_t DuplicateKey(uint64_t unique_id, const std::string& destination_id, bool request,
+                      bool visited);
+
+// A time-bounded set of recently seen keys in a fixed amount of memory.  Keys are held in two
+// open-addressed generations; the older is discarded once the newer has held capacity / 2 keys
+// or been filling for window / 2, so a key is remembered for up to |window|.
+class DuplicateFilter {
+ public:
+  DuplicateFilter(size_t capacity, std::chrono::steady_clock::duration window);
+  // Records |key| and returns true, or returns false if it has been seen recently.
+  bool Insert(uint64_t key);
+
+ private:
+  DuplicateFilter(const DuplicateFilter&);
+  DuplicateFilter(const DuplicateFilter&&);
+  DuplicateFilter& operator=(const DuplicateFilter&);
+
+  struct Generation {
+    explicit Generation(size_t slot_count);
+    bool Contains(uint64_t key) const;
+    void Insert(uint64_t key);
+    void Clear(std::chrono::steady_clock::time_point now);
+    std::vector<uint64_t> slots;  // zero marks an empty slot
+    size_t count;
+    std::chrono::steady_clock::time_point started;
+  };
+
+  std::mutex mutex_;
+  const size_t generation_capacity_;
+  const std::chrono::steady_clock::duration generation_lifetime_;
+  Generation current_, previous_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_DUPLICATE_FILTER_H_
@@ -0,0 +1,76 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/encoded_message.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Key of protobuf::Message::destination_id (field 2, length-delimited).
+const char kDestinationIdKey((2 << 3) | 2);
+
+void AppendVarint(uint32_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+std::shared_ptr<const std::string> EncodeBody(const protobuf::Message& message) {
+  if (!message.has_destination_id())
+    return std::make_shared<const std::string>(message.SerializeAsString());
+  protobuf::Message body(message);
+  body.clear_destination_id();
+  return std::make_shared<const std::string>(body.SerializeAsString());
+}
+
+}  // unnamed namespace
+
+EncodedMessage::EncodedMessage(const protobuf::Message& message)
+    : body_(EncodeBody(message)),
+      id_(message.id()),
+      type_(message.type()),
+      hops_to_live_(message.hops_to_live()),
+      routing_message_(message.routing_message()),
+      request_(message.request()) {}
+
+std::string EncodedMessage::ForDestination(const std::string& destination_id) const {
+  if (destination_id.empty())
+    return *body_;
+  std::string encoded;
+  encoded.reserve(body_->size() + destination_id.size() + 6);
+  encoded.append(*body_);
+  encoded.push_back(kDestinationIdKey);
+  AppendVarint(static_cast<uint32_t>(destination_id.size()), encoded);
+  encoded.append(destination_id);
+  return encoded;
+}
+
+std::string EncodedMessage::ForDestination(const NodeId& destination_id) const {
+  return ForDestination(destination_id.string());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
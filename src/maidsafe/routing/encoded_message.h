@@ -0,0 +1,64 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ENCODED_MESSAGE_H_
+#define MAIDSAFE_ROUTING_ENCODED_MESSAGE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// A message serialised once so that it can be sent to several peers.  The encoded body is shared
+// between copies and omits the destination ID, which is appended per peer as a one-field trailer.
+// When parsing, protobuf keeps the last value seen for a singular field, so the receiving end
+// reads an ordinary protobuf::Message.
+class EncodedMessage {
+ public:
+  explicit EncodedMessage(const protobuf::Message& message);
+  // Returns the bytes to send for |destination_id|.  An empty |destination_id| yields the body
+  // alone, i.e. a message with no destination ID.
+  std::string ForDestination(const std::string& destination_id) const;
+  std::string ForDestination(const NodeId& destination_id) const;
+
+  int32_t id() const { return id_; }
+  int32_t type() const { return type_; }
+  int32_t hops_to_live() const { return hops_to_live_; }
+  bool routing_message() const { return routing_message_; }
+  bool request() const { return request_; }
+
+ private:
+  std::shared_ptr<const std::string> body_;
+  int32_t id_, type_, hops_to_live_;
+  bool routing_message_, request_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ENCODED_MESSAGE_H_
@@ -0,0 +1,82 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/frequency_sketch.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// The finaliser of splitmix64.
+uint64_t Mix(uint64_t value) {
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+}  // unnamed namespace
+
+const uint8_t FrequencySketch::kMaxFrequency;
+
+FrequencySketch::FrequencySketch(size_t expected_entries)
+    : counters_(), width_mask_(0), additions_(0), sample_size_(0) {
+  size_t width(16);
+  while (width < expected_entries)
+    width *= 2;
+  counters_.assign(kDepth * width, 0);
+  width_mask_ = width - 1;
+  sample_size_ = 10 * width;
+}
+
+uint64_t FrequencySketch::HashOf(const std::string& key) {
+  return Mix(std::hash<std::string>()(key));
+}
+
+size_t FrequencySketch::Index(uint64_t hash, int row) const {
+  return row * (width_mask_ + 1) +
+         static_cast<size_t>(Mix(hash + (row + 1) * 0x9E3779B97F4A7C15ULL) & width_mask_);
+}
+
+void FrequencySketch::Increment(uint64_t hash) {
+  for (int row(0); row != kDepth; ++row) {
+    uint8_t& counter(counters_[Index(hash, row)]);
+    if (counter < kMaxFrequency)
+      ++counter;
+  }
+  if (++additions_ == sample_size_) {
+    for (auto& counter : counters_)
+      counter /= 2;
+    additions_ /= 2;
+  }
+}
+
+uint8_t FrequencySketch::Estimate(uint64_t hash) const {
+  uint8_t estimate(kMaxFrequency);
+  for (int row(0); row != kDepth; ++row)
+    estimate = std::min(estimate, counters_[Index(hash, row)]);
+  return estimate;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
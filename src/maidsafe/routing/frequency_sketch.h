@@ -0,0 +1,52 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_FREQUENCY_SKETCH_H_
+#define MAIDSAFE_ROUTING_FREQUENCY_SKETCH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Count-min sketch of 4-bit counters estimating how often each key has been seen, all halved once
+// ten increments per counter width have been made so that old popularity fades.  Not thread-safe.
+class FrequencySketch {
+ public:
+  static const uint8_t kMaxFrequency = 15;
+
+  explicit FrequencySketch(size_t expected_entries);
+  void Increment(uint64_t hash);
+  uint8_t Estimate(uint64_t hash) const;
+  static uint64_t HashOf(const std::string& key);
+
+ private:
+  static const int kDepth = 4;
+  size_t Index(uint64_t hash, int row) const;
+  std::vector<uint8_t> counters_;
+  size_t width_mask_, additions_, sample_size_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_FREQUENCY_SKETCH_H_
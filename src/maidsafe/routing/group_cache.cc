@@ -0,0 +1,138 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/group_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
+#include "maidsafe/routing/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+GroupCache::GroupCache() : mutex_(), entries_() {}
+
+bool GroupCache::Get(const NodeId& group_id, std::vector<NodeId>& group) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(entries_.find(group_id));
+  if (found == entries_.end())
+    return false;
+  if (found->second.expiry <= RoutingClock::now()) {
+    entries_.erase(found);
+    return false;
+  }
+  group = found->second.group;
+  return true;
+}
+
+void GroupCache::Add(const NodeId& group_id, std::vector<NodeId> group) {
+  if (Parameters::group_cache_size == 0 || group.empty())
+    return;
+  const auto kNow(RoutingClock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.count(group_id) == 0)
+    MakeRoom(kNow);
+  Entry& entry(entries_[group_id]);
+  entry.group = std::move(group);
+  entry.expiry = kNow + Parameters::group_cache_ttl;
+}
+
+void GroupCache::HandleClosestNodesUpdate(const protobuf::ClosestNodesUpdate& update) {
+  std::vector<NodeId> removed, added;
+  for (const auto& node_id : update.removed_nodes()) {
+    if (CheckId(node_id))
+      removed.push_back(NodeId(node_id));
+  }
+  for (const auto& basic_info : update.nodes_info()) {
+    if (CheckId(basic_info.node_id()))
+      added.push_back(NodeId(basic_info.node_id()));
+  }
+  Invalidate(removed, added);
+  if (update.delta() || !CheckId(update.node()))
+    return;
+  // A full update lists the sender's closest nodes, from which the group around it follows.
+  const NodeId kSender(update.node());
+  added.push_back(kSender);
+  PartialSortByDistance(added, kSender, Parameters::group_size);
+  added.resize(std::min(added.size(), static_cast<size_t>(Parameters::group_size)));
+  LOG(kVerbose) << "Caching the group around " << DebugId(kSender);
+  Add(kSender, std::move(added));
+}
+
+void GroupCache::HandleMatrixChange(const MatrixChange& change) {
+  if (change.lost_nodes().empty() && change.new_nodes().empty())
+    return;
+  Invalidate(change.lost_nodes(), change.new_nodes());
+}
+
+size_t GroupCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void GroupCache::Invalidate(const std::vector<NodeId>& removed,
+                            const std::vector<NodeId>& added) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto itr(entries_.begin()); itr != entries_.end();) {
+    const NodeId& kGroupId(itr->first);
+    const std::vector<NodeId>& kGroup(itr->second.group);
+    const Distance kFurthest(kGroup.back(), kGroupId);
+    bool stale(std::any_of(removed.begin(), removed.end(), [&](const NodeId& node_id) {
+      return std::find(kGroup.begin(), kGroup.end(), node_id) != kGroup.end();
+    }));
+    stale = stale || std::any_of(added.begin(), added.end(), [&](const NodeId& node_id) {
+      return std::find(kGroup.begin(), kGroup.end(), node_id) == kGroup.end() &&
+             (kGroup.size() < Parameters::group_size || Distance(node_id, kGroupId) < kFurthest);
+    });
+    if (stale)
+      itr = entries_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+void GroupCache::MakeRoom(std::chrono::steady_clock::time_point now) {
+  if (entries_.size() < Parameters::group_cache_size)
+    return;
+  for (auto itr(entries_.begin()); itr != entries_.end();) {
+    if (itr->second.expiry <= now)
+      itr = entries_.erase(itr);
+    else
+      ++itr;
+  }
+  if (entries_.size() < Parameters::group_cache_size)
+    return;
+  entries_.erase(std::min_element(entries_.begin(), entries_.end(),
+                                  [](const std::pair<const NodeId, Entry>& lhs,
+                                     const std::pair<const NodeId, Entry>& rhs) {
+                                    return lhs.second.expiry < rhs.second.expiry;
+                                  }));
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_GROUP_CACHE_H_
+#define MAIDSAFE_ROUTING_GROUP_CACHE_H_
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class MatrixChange;
+
+namespace protobuf {
+class ClosestNodesUpdate;
+}
+
+// Group memberships a client has learned, so that repeated GetGroup calls for the same group can
+// be answered without going to the network, or a vault has worked out from its group matrix.
+// Entries expire after Parameters::group_cache_ttl, and are dropped sooner once a close node update
+// or matrix change shows one of their members leaving, or a closer node arriving.  At most
+// Parameters::group_cache_size are held.
+class GroupCache {
+ public:
+  GroupCache();
+  // Returns false if no fresh membership of |group_id| is held.
+  bool Get(const NodeId& group_id, std::vector<NodeId>& group);
+  // |group| is the answer to GetGroup(|group_id|), closest first.
+  void Add(const NodeId& group_id, std::vector<NodeId> group);
+  // Invalidates entries as |update| implies, and records the group around its sender if it is a
+  // full list of the sender's closest nodes.
+  void HandleClosestNodesUpdate(const protobuf::ClosestNodesUpdate& update);
+  // Invalidates only the entries whose group loses a member, or gains a closer node, in |change|.
+  void HandleMatrixChange(const MatrixChange& change);
+  size_t size() const;
+
+ private:
+  GroupCache(const GroupCache&);
+  GroupCache(const GroupCache&&);
+  GroupCache& operator=(const GroupCache&);
+
+  struct Entry {
+    Entry() : group(), expiry() {}
+    std::vector<NodeId> group;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  void Invalidate(const std::vector<NodeId>& removed, const std::vector<NodeId>& added);
+  // Makes room for one more entry, dropping expired ones, or failing that the soonest to expire.
+  void MakeRoom(std::chrono::steady_clock::time_point now);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<NodeId, Entry, NodeIdHash> entries_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_GROUP_CACHE_H_
@@ -18,6 +18,7 @@
 
 #include "maidsafe/routing/group_change_handler.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -28,6 +29,7 @@
 
 #include "maidsafe/routing/client_routing_table.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/rpcs.h"
@@ -42,7 +44,12 @@ GroupChangeHandler::GroupChangeHandler(RoutingTable& routing_table,
                                        NetworkUtils& network)
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
-      network_(network) {}
+      network_(network),
+      mutex_(),
+      update_sequence_(0),
+      last_sent_closest_nodes_(),
+      last_update_subscribers_(),
+      peer_closest_nodes_() {}
 
 GroupChangeHandler::~GroupChangeHandler() {}
 
@@ -66,16 +73,17 @@ std::pair<NodeId, std::vector<NodeInfo>> GroupChangeHandler::ClosestNodesUpdate(
     return matrix_update_pair;
   }
 
+  if (closest_node_update.request_full_state()) {
+    SendFullClosestNodesUpdate(NodeId(closest_node_update.node()));
+    message.Clear();
+    return matrix_update_pair;
+  }
+
   std::vector<NodeInfo> closest_nodes;
-  NodeInfo node_info;
-  for (const auto& basic_info : closest_node_update.nodes_info()) {
-    if (CheckId(basic_info.node_id())) {
-      node_info.node_id = NodeId(basic_info.node_id());
-      node_info.rank = basic_info.rank();
-      closest_nodes.push_back(node_info);
-    }
+  if (!ResolveClosestNodes(closest_node_update, closest_nodes)) {
+    message.Clear();
+    return matrix_update_pair;
   }
-  assert(!closest_nodes.empty());
   if (!routing_table_.client_mode())
     message.Clear();
   if (UpdateGroupChange(NodeId(closest_node_update.node()), closest_nodes))
@@ -85,6 +93,72 @@ std::pair<NodeId, std::vector<NodeInfo>> GroupChangeHandler::ClosestNodesUpdate(
                                                   closest_nodes);
 }
 
+bool GroupChangeHandler::ResolveClosestNodes(
+    const protobuf::ClosestNodesUpdate& closest_node_update, std::vector<NodeInfo>& closest_nodes) {
+  NodeId peer(closest_node_update.node());
+  NodeInfo node_info;
+  std::vector<NodeInfo> nodes_info;
+  for (const auto& basic_info : closest_node_update.nodes_info()) {
+    if (CheckId(basic_info.node_id())) {
+      node_info.node_id = NodeId(basic_info.node_id());
+      node_info.rank = basic_info.rank();
+      nodes_info.push_back(node_info);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!closest_node_update.delta()) {
+      assert(!nodes_info.empty());
+      if (peer_closest_nodes_.size() > 2U * routing_table_.kMaxSize())
+        peer_closest_nodes_.clear();  // stale senders resync with a full state request
+      auto& peer_closest_nodes(peer_closest_nodes_[peer]);
+      peer_closest_nodes.sequence = closest_node_update.sequence();
+      peer_closest_nodes.nodes = nodes_info;
+      closest_nodes.swap(nodes_info);
+      return true;
+    }
+
+    auto found(peer_closest_nodes_.find(peer));
+    if (found != std::end(peer_closest_nodes_) &&
+        found->second.sequence + 1 == closest_node_update.sequence()) {
+      auto& nodes(found->second.nodes);
+      for (const auto& removed_node : closest_node_update.removed_nodes()) {
+        nodes.erase(std::remove_if(std::begin(nodes), std::end(nodes),
+                                   [&removed_node](const NodeInfo& node_info) {
+                                     return node_info.node_id.string() == removed_node;
+                                   }),
+                    std::end(nodes));
+      }
+      for (const auto& added_node : nodes_info) {
+        if (std::find_if(std::begin(nodes), std::end(nodes), [&](const NodeInfo& node_info) {
+              return node_info.node_id == added_node.node_id;
+            }) == std::end(nodes))
+          nodes.push_back(added_node);
+      }
+      found->second.sequence = closest_node_update.sequence();
+      closest_nodes = nodes;
+      return true;
+    }
+    if (found != std::end(peer_closest_nodes_))
+      peer_closest_nodes_.erase(found);
+  }
+
+  LOG(kWarning) << DebugId(routing_table_.kNodeId()) << " missed closest nodes update from "
+                << DebugId(peer) << " before " << closest_node_update.sequence()
+                << ", requesting full state";
+  protobuf::Message full_state_request(
+      rpcs::ClosestNodesUpdateFullStateRequest(peer, routing_table_.kNodeId()));
+  NodeInfo peer_info;
+  if (routing_table_.GetNodeInfo(peer, peer_info)) {
+    SendToNode(full_state_request, peer_info);
+  } else {
+    for (const auto& client : client_routing_table_.GetNodesInfo(peer))
+      SendToNode(full_state_request, client);
+  }
+  return false;
+}
+
 bool GroupChangeHandler::UpdateGroupChange(const NodeId& node_id,
                                            std::vector<NodeInfo> close_nodes) {
   if (routing_table_.Contains(node_id)) {
@@ -126,25 +200,97 @@ void GroupChangeHandler::SendClosestNodesUpdateRpcs(
                 << "] SendClosestNodesUpdateRpcs: " << closest_nodes.size();
   std::vector<NodeInfo> update_subscribers(closest_nodes);
   // clients are also notified of changes in connected close nodes
-  for (const auto& client : client_routing_table_.nodes_)
+  for (const auto& client : client_routing_table_.nodes())
     update_subscribers.push_back(client);
+  // nodes no longer close get this one last update
+  for (const auto& old_closest_node : old_closest_nodes)
+    update_subscribers.push_back(old_closest_node);
+
+  uint32_t sequence(0);
+  std::vector<NodeInfo> added_nodes;
+  std::vector<NodeId> removed_nodes;
+  std::unordered_set<NodeId, NodeIdHash> previous_subscribers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequence = ++update_sequence_;
+    for (const auto& node_info : closest_nodes) {
+      if (std::find_if(std::begin(last_sent_closest_nodes_), std::end(last_sent_closest_nodes_),
+                       [&](const NodeInfo& sent) { return sent.node_id == node_info.node_id; }) ==
+          std::end(last_sent_closest_nodes_))
+        added_nodes.push_back(node_info);
+    }
+    for (const auto& sent : last_sent_closest_nodes_) {
+      if (std::find_if(std::begin(closest_nodes), std::end(closest_nodes),
+                       [&](const NodeInfo& node_info) {
+                         return sent.node_id == node_info.node_id;
+                       }) == std::end(closest_nodes))
+        removed_nodes.push_back(sent.node_id);
+    }
+    last_sent_closest_nodes_ = closest_nodes;
+    previous_subscribers.swap(last_update_subscribers_);
+    for (const auto& update_subscriber : update_subscribers) {
+      if (std::find_if(std::begin(old_closest_nodes), std::end(old_closest_nodes),
+                       [&](const NodeInfo& node_info) {
+                         return update_subscriber.node_id == node_info.node_id;
+                       }) == std::end(old_closest_nodes))
+        last_update_subscribers_.insert(update_subscriber.node_id);
+    }
+  }
+
+  // The delta message is the same for every subscriber apart from its destination, so only
+  // subscribers which missed the previous update are sent the full list.  Each variant is
+  // serialised once, on first use, and only has its destination ID patched per subscriber.
+  std::unique_ptr<EncodedMessage> delta_update, full_update;
   for (const auto& update_subscriber : update_subscribers) {
     LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
                   << "] Sending update to: " << DebugId(update_subscriber.node_id);
-    protobuf::Message closest_nodes_update_rpc(rpcs::ClosestNodesUpdate(
-        update_subscriber.node_id, routing_table_.kNodeId(), closest_nodes));
-    network_.SendToDirect(closest_nodes_update_rpc, update_subscriber.node_id,
-                          update_subscriber.connection_id);
+    if (previous_subscribers.count(update_subscriber.node_id) != 0) {
+      if (!delta_update) {
+        delta_update.reset(new EncodedMessage(rpcs::ClosestNodesUpdateDelta(
+            update_subscriber.node_id, routing_table_.kNodeId(), added_nodes, removed_nodes,
+            sequence)));
+      }
+      SendToNode(*delta_update, update_subscriber);
+    } else {
+      if (!full_update) {
+        full_update.reset(new EncodedMessage(rpcs::ClosestNodesUpdate(
+            update_subscriber.node_id, routing_table_.kNodeId(), closest_nodes, sequence)));
+      }
+      SendToNode(*full_update, update_subscriber);
+    }
   }
-  for (const auto& old_closest_node : old_closest_nodes) {
-    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId())
-                  << "] Sending update to: " << DebugId(old_closest_node.node_id);
-    protobuf::Message closest_nodes_update_rpc(rpcs::ClosestNodesUpdate(
-        old_closest_node.node_id, routing_table_.kNodeId(), closest_nodes));
-    network_.SendToDirect(closest_nodes_update_rpc, old_closest_node.node_id,
-                          old_closest_node.connection_id);
+}
+
+void GroupChangeHandler::SendFullClosestNodesUpdate(const NodeId& node_id) {
+  std::vector<NodeInfo> closest_nodes;
+  uint32_t sequence(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (last_sent_closest_nodes_.empty())
+      return;
+    closest_nodes = last_sent_closest_nodes_;
+    sequence = update_sequence_;
+    last_update_subscribers_.insert(node_id);
+  }
+  protobuf::Message closest_nodes_update_rpc(
+      rpcs::ClosestNodesUpdate(node_id, routing_table_.kNodeId(), closest_nodes, sequence));
+  NodeInfo node_info;
+  if (routing_table_.GetNodeInfo(node_id, node_info)) {
+    SendToNode(closest_nodes_update_rpc, node_info);
+  } else {
+    for (const auto& client : client_routing_table_.GetNodesInfo(node_id))
+      SendToNode(closest_nodes_update_rpc, client);
   }
 }
+
+void GroupChangeHandler::SendToNode(const protobuf::Message& message, const NodeInfo& node_info) {
+  network_.SendToDirect(message, node_info.node_id, node_info.connection_id);
+}
+
+void GroupChangeHandler::SendToNode(const EncodedMessage& message, const NodeInfo& node_info) {
+  network_.SendEncodedToDirect(message, node_info.node_id, node_info.connection_id);
+}
+
 bool GroupChangeHandler::GetNodeInfo(const NodeId& node_id, const NodeId& connection_id,
                                      NodeInfo& out_node_info) {
   if (routing_table_.GetNodeInfo(node_id, out_node_info))
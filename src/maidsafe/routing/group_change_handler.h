@@ -19,12 +19,18 @@
 #ifndef MAIDSAFE_ROUTING_GROUP_CHANGE_HANDLER_H_
 #define MAIDSAFE_ROUTING_GROUP_CHANGE_HANDLER_H_
 
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <utility>
 
 #include "maidsafe/common/node_id.h"
 
+#include "maidsafe/routing/encoded_message.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/node_id_hash.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/routing.pb.h"
 
@@ -60,12 +66,34 @@ class GroupChangeHandler {
   GroupChangeHandler(const GroupChangeHandler&);
   GroupChangeHandler& operator=(const GroupChangeHandler&);
 
+  // Last full list received from a peer, rebuilt from its deltas
+  struct PeerClosestNodes {
+    PeerClosestNodes() : sequence(0), nodes() {}
+    uint32_t sequence;
+    std::vector<NodeInfo> nodes;
+  };
+
   void Subscribe(const NodeId& node_id, const NodeId& connection_id);
   bool GetNodeInfo(const NodeId& node_id, const NodeId& connection_id, NodeInfo& out_node_info);
+  // Returns false and requests a full update from the sender if |closest_node_update| can't be
+  // applied to what has been received from it so far.
+  bool ResolveClosestNodes(const protobuf::ClosestNodesUpdate& closest_node_update,
+                           std::vector<NodeInfo>& closest_nodes);
+  void SendFullClosestNodesUpdate(const NodeId& node_id);
+  void SendToNode(const protobuf::Message& message, const NodeInfo& node_info);
+  void SendToNode(const EncodedMessage& message, const NodeInfo& node_info);
 
   RoutingTable& routing_table_;
   ClientRoutingTable& client_routing_table_;
   NetworkUtils& network_;
+  std::mutex mutex_;
+  // Sender state: the last list sent, its sequence number and the nodes it was sent to.  Nodes in
+  // last_update_subscribers_ are sent the next update as a delta.
+  uint32_t update_sequence_;
+  std::vector<NodeInfo> last_sent_closest_nodes_;
+  std::unordered_set<NodeId, NodeIdHash> last_update_subscribers_;
+  // Receiver state, keyed by sender
+  std::unordered_map<NodeId, PeerClosestNodes, NodeIdHash> peer_closest_nodes_;
 };
 
 }  // namespace routing
@@ -21,10 +21,12 @@
 #include <algorithm>
 #include <bitset>
 #include <cstdint>
-#include <set>
+#include <limits>
 
 #include "maidsafe/common/log.h"
 
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/memory_budget.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/return_codes.h"
@@ -34,108 +36,116 @@ namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+const uint32_t kNoHolder(std::numeric_limits<uint32_t>::max());
+
+}  // unnamed namespace
+
 GroupMatrix::GroupMatrix(const NodeId& this_node_id, bool client_mode)
     : kNodeId_(this_node_id),
+      records_(),
+      free_records_(),
+      record_index_(),
       unique_nodes_(),
-      radius_(crypto::BigInt::Zero()),
+      connected_peers_(),
+      radius_(),
       client_mode_(client_mode),
       matrix_() {
-  UpdateUniqueNodeList();
+  if (!client_mode_) {
+    NodeInfo node_info;
+    node_info.node_id = kNodeId_;
+    AddReference(node_info, kNoHolder);
+  }
+  UpdateConnectedPeersAndRadius();
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::AddConnectedPeer(
     const NodeInfo& node_info, const std::vector<NodeInfo>& matrix_update) {
   std::vector<NodeId> old_unique_ids(GetUniqueNodeIds());
   LOG(kVerbose) << DebugId(kNodeId_) << " AddConnectedPeer : " << DebugId(node_info.node_id);
-  auto node_id(node_info.node_id);
-  auto found(std::find_if(std::begin(matrix_), std::end(matrix_),
-                          [node_id](const std::vector<NodeInfo>& info) {
-                            return info.begin()->node_id == node_id;
-                          }));
-  if (found != std::end(matrix_)) {
+  if (FindRow(node_info.node_id) != std::end(matrix_)) {
     LOG(kWarning) << "Already Added in matrix";
     return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
   }
 
-  std::vector<NodeInfo> nodes_info(std::vector<NodeInfo>(1, node_info));
-  std::copy(std::begin(matrix_update), std::end(matrix_update), std::back_inserter(nodes_info));
-  matrix_.push_back(nodes_info);
+  AddRow(node_info, matrix_update);
   Prune();
-  UpdateUniqueNodeList();
+  UpdateConnectedPeersAndRadius();
   return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::RemoveConnectedPeer(const NodeInfo& node_info) {
   std::vector<NodeId> old_unique_ids(GetUniqueNodeIds());
-  matrix_.erase(std::remove_if(std::begin(matrix_), std::end(matrix_),
-                               [node_info](const std::vector<NodeInfo>& nodes) {
-                                 return (node_info.node_id == nodes.begin()->node_id);
-                               }),
-                std::end(matrix_));
+  auto row_itr(FindRow(node_info.node_id));
+  if (row_itr != std::end(matrix_))
+    EraseRow(row_itr);
   Prune();
-  UpdateUniqueNodeList();
+  UpdateConnectedPeersAndRadius();
   return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
 }
 
-std::vector<NodeInfo> GroupMatrix::GetConnectedPeers() const {
-  std::vector<NodeInfo> connected_peers;
-  for (const auto& nodes : matrix_) {
-    if (nodes.begin()->node_id != kNodeId_)
-      connected_peers.push_back(nodes.at(0));
+std::shared_ptr<MatrixChange> GroupMatrix::UpdateConnectedPeers(
+    const std::vector<NodeInfo>& added_peers, const std::vector<NodeId>& removed_peers) {
+  std::vector<NodeId> old_unique_ids(GetUniqueNodeIds());
+  for (auto itr(std::begin(matrix_)); itr != std::end(matrix_);) {
+    if (std::find(std::begin(removed_peers), std::end(removed_peers), NodeIdOf(itr->front())) !=
+        std::end(removed_peers))
+      itr = EraseRow(itr);
+    else
+      ++itr;
   }
-  return connected_peers;
+  for (const auto& added_peer : added_peers) {
+    if (FindRow(added_peer.node_id) == std::end(matrix_)) {
+      LOG(kVerbose) << DebugId(kNodeId_) << " UpdateConnectedPeers adds : "
+                    << DebugId(added_peer.node_id);
+      AddRow(added_peer, std::vector<NodeInfo>());
+    }
+  }
+  Prune();
+  UpdateConnectedPeersAndRadius();
+  return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
+}
+
+std::vector<NodeInfo> GroupMatrix::GetConnectedPeers() const {
+  return NodeInfosOf(std::begin(connected_peers_), std::end(connected_peers_));
 }
 
 NodeInfo GroupMatrix::GetConnectedPeerFor(const NodeId& target_node_id) {
-  /*
-    for (const auto& nodes : matrix_) {
-      if (nodes.at(0).node_id == target_node_id) {
-        assert(false && "Shouldn't request connected peer for node in first column of group
-    matrix.");
-        return NodeInfo();
-      }
-    }*/
-  for (const auto& nodes : matrix_) {
-    if (std::find_if(std::begin(nodes), std::end(nodes),
-                     [target_node_id](const NodeInfo& node_info) {
-                       return (node_info.node_id == target_node_id);
-                     }) != std::end(nodes)) {
-      return nodes.at(0);
-    }
-  }
-  return NodeInfo();
+  auto found(record_index_.find(target_node_id));
+  if (found == std::end(record_index_))
+    return NodeInfo();
+  auto row(FirstRowHeldBy(records_[found->second].holders, NodeId(), std::vector<std::string>()));
+  return row ? records_[row->front()].node_info : NodeInfo();
 }
 
 void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
-                                                 const std::vector<std::string>& exclude,
+                                                 const ExcludedNodes& exclude,
                                                  bool ignore_exact_match,
                                                  NodeInfo& current_closest_peer) {
   NodeId closest_id(current_closest_peer.node_id);
+  Distance closest_distance(closest_id, target_node_id);
+  const NodeId kExcludedPeerId(ignore_exact_match ? target_node_id : NodeId());
 
-  for (const auto& row : matrix_) {
-    if (ignore_exact_match && row.at(0).node_id == target_node_id)
+  // Each matrix entry is visited once via unique_nodes_, and the exclusion checks and row lookup
+  // only run for an entry closer than the best found so far.
+  for (auto record : unique_nodes_) {
+    const NodeId& node_id(NodeIdOf(record));
+    if (node_id == kNodeId_)
       continue;
-    if (std::find(exclude.begin(), exclude.end(), row.at(0).node_id.string()) != exclude.end())
+    if (ignore_exact_match && node_id == target_node_id)
       continue;
-
-    for (const auto& node : row) {
-      if (node.node_id == kNodeId_)
-        continue;
-      if (ignore_exact_match && node.node_id == target_node_id)
-        continue;
-      if (std::find(exclude.begin(), exclude.end(), node.node_id.string()) != exclude.end())
-        continue;
-      if (NodeId::CloserToTarget(node.node_id, closest_id, target_node_id)) {
-//        PrintGroupMatrix();
-        LOG(kVerbose) << DebugId(closest_id) << ", peer to send: "
-                      << DebugId(current_closest_peer.node_id) << ", "
-                      << DebugId(row.at(0).node_id);
-        closest_id = node.node_id;
-        current_closest_peer = row.at(0);
-        LOG(kVerbose) << DebugId(closest_id) << ", peer to send: "
-                      << DebugId(current_closest_peer.node_id);
-      }
-    }
+    Distance distance(node_id, target_node_id);
+    if (!(distance < closest_distance))
+      continue;
+    if (exclude.Contains(node_id))
+      continue;
+    auto row(FirstRowHeldBy(records_[record].holders, kExcludedPeerId, exclude));
+    if (!row)
+      continue;
+    closest_id = node_id;
+    closest_distance = distance;
+    current_closest_peer = records_[row->front()].node_info;
   }
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "]\ttarget: " << DebugId(target_node_id)
                 << "\tfound node in matrix: " << DebugId(closest_id)
@@ -146,19 +156,23 @@ void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
                                                  bool ignore_exact_match,
                                                  NodeId& current_closest_peer_id) {
   NodeId closest_id(current_closest_peer_id);
+  Distance closest_distance(closest_id, target_node_id);
+  const NodeId kExcludedPeerId(ignore_exact_match ? target_node_id : NodeId());
+  const std::vector<std::string> kNoExclusions;
 
-  for (const auto& row : matrix_) {
-    if (ignore_exact_match && row.at(0).node_id == target_node_id)
+  for (auto record : unique_nodes_) {
+    const NodeId& node_id(NodeIdOf(record));
+    if (ignore_exact_match && node_id == target_node_id)
       continue;
-
-    for (const auto& node : row) {
-      if (ignore_exact_match && node.node_id == target_node_id)
-        continue;
-      if (NodeId::CloserToTarget(node.node_id, closest_id, target_node_id)) {
-        closest_id = node.node_id;
-        current_closest_peer_id = row.at(0).node_id;
-      }
-    }
+    Distance distance(node_id, target_node_id);
+    if (!(distance < closest_distance))
+      continue;
+    auto row(FirstRowHeldBy(records_[record].holders, kExcludedPeerId, kNoExclusions));
+    if (!row)
+      continue;
+    closest_id = node_id;
+    closest_distance = distance;
+    current_closest_peer_id = NodeIdOf(row->front());
   }
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "]\ttarget: " << DebugId(target_node_id)
                 << "\tfound node in matrix: " << DebugId(closest_id)
@@ -167,13 +181,10 @@ void GroupMatrix::GetBetterNodeForSendingMessage(const NodeId& target_node_id,
 
 std::vector<NodeInfo> GroupMatrix::GetAllConnectedPeersFor(const NodeId& target_id) {
   std::vector<NodeInfo> connected_nodes;
-  for (const auto& row : matrix_) {
-    if (std::find_if(row.begin(), row.end(), [&target_id](const NodeInfo & node_info) {
-          return target_id == node_info.node_id;
-        }) != row.end()) {
-      connected_nodes.push_back(row.at(0));
-    }
-  }
+  VisitAllConnectedPeersFor(target_id, [&connected_nodes](const NodeInfo& node_info) {
+    connected_nodes.push_back(node_info);
+    return true;
+  });
   return connected_nodes;
 }
 
@@ -190,16 +201,17 @@ bool GroupMatrix::IsThisNodeGroupLeader(const NodeId& target_id, NodeId& connect
   }
 
   std::string log("unique_nodes_ for " + DebugId(kNodeId_) + " are ");
-  for (const auto& node : unique_nodes_) {
-    log += DebugId(node.node_id) + ", ";
+  for (auto record : unique_nodes_) {
+    log += DebugId(NodeIdOf(record)) + ", ";
   }
   LOG(kVerbose) << log;
 
-  for (const auto& node : unique_nodes_) {
-    if (node.node_id == target_id)
+  for (auto record : unique_nodes_) {
+    const NodeId& node_id(NodeIdOf(record));
+    if (node_id == target_id)
       continue;
-    if (NodeId::CloserToTarget(node.node_id, kNodeId_, target_id)) {
-      LOG(kVerbose) << DebugId(node.node_id) << " could be leader";
+    if (NodeId::CloserToTarget(node_id, kNodeId_, target_id)) {
+      LOG(kVerbose) << DebugId(node_id) << " could be leader";
       is_group_leader = false;
       break;
     }
@@ -217,18 +229,19 @@ bool GroupMatrix::ClosestToId(const NodeId& target_id) {
   if (unique_nodes_.size() == 0)
     return true;
 
-  PartialSortFromTarget(target_id, 2, unique_nodes_);
-  if (unique_nodes_.at(0).node_id == kNodeId_)
+  // unique_nodes_ must stay sorted from kNodeId_, so isn't sorted in place here.
+  auto closest(GetClosestUniqueNodes(target_id, 2));
+  if (closest.at(0).node_id == kNodeId_)
     return true;
 
-  if (unique_nodes_.at(0).node_id == target_id) {
-    if (unique_nodes_.at(1).node_id == kNodeId_)
+  if (closest.at(0).node_id == target_id) {
+    if (closest.at(1).node_id == kNodeId_)
       return true;
     else
-      return NodeId::CloserToTarget(kNodeId_, unique_nodes_.at(1).node_id, target_id);
+      return NodeId::CloserToTarget(kNodeId_, closest.at(1).node_id, target_id);
   }
 
-  return NodeId::CloserToTarget(kNodeId_, unique_nodes_.at(0).node_id, target_id);
+  return NodeId::CloserToTarget(kNodeId_, closest.at(0).node_id, target_id);
 }
 
 // bool GroupMatrix::IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) {
@@ -252,83 +265,49 @@ bool GroupMatrix::ClosestToId(const NodeId& target_id) {
 
 GroupRangeStatus GroupMatrix::IsNodeIdInGroupRange(const NodeId& group_id,
                                                    const NodeId& node_id) const {
-  auto connected_peers(GetConnectedPeers());
-  if (connected_peers.empty())
-    return GroupRangeStatus::kInRange;
-
-  std::partial_sort(std::begin(connected_peers), std::begin(connected_peers) + 1,
-                    std::end(connected_peers),
-                    [node_id](const NodeInfo& lhs, const NodeInfo& rhs) {
-                      return NodeId::CloserToTarget(rhs.node_id, lhs.node_id, node_id);
-                    });
-
-  if (connected_peers.size() >= Parameters::closest_nodes_size && node_id == kNodeId_ &&
-      NodeId::CloserToTarget(connected_peers.front().node_id, group_id, kNodeId_)) {
-    return GroupRangeStatus::kOutwithRange;
-  }
-
-  size_t group_size_adjust(Parameters::group_size + 1U);
-  size_t new_holders_size = std::min(unique_nodes_.size(), group_size_adjust);
-  std::vector<NodeInfo> new_holders_info(new_holders_size);
-  std::partial_sort_copy(unique_nodes_.begin(), unique_nodes_.end(), new_holders_info.begin(),
-                         new_holders_info.end(),
-                         [group_id](const NodeInfo& lhs, const NodeInfo& rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, group_id);
-  });
-
-  std::vector<NodeId> new_holders;
-  for (const auto& new_holder_info : new_holders_info)
-    new_holders.push_back(new_holder_info.node_id);
+  return GetGroupRangeView().IsNodeIdInGroupRange(group_id, node_id);
+}
 
-  new_holders.erase(std::remove(new_holders.begin(), new_holders.end(), group_id),
-                    new_holders.end());
-  if (new_holders.size() > Parameters::group_size) {
-    new_holders.resize(Parameters::group_size);
-    assert(new_holders.size() == Parameters::group_size);
-  }
-  if (!client_mode_) {
-    auto this_node_range(GetProximalRange(group_id, kNodeId_, kNodeId_, radius_, new_holders));
-    if (node_id == kNodeId_)
-      return this_node_range;
-    else if (this_node_range != GroupRangeStatus::kInRange)
-      BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_in_range));  // not_in_group
-  } else {
-    if (node_id == kNodeId_)
-      return GroupRangeStatus::kInProximalRange;
-  }
-  return GetProximalRange(group_id, node_id, kNodeId_, radius_, new_holders);
+GroupRangeView GroupMatrix::GetGroupRangeView() const {
+  GroupRangeView group_range_view;
+  group_range_view.node_id_ = kNodeId_;
+  group_range_view.client_mode_ = client_mode_;
+  group_range_view.connected_peers_count_ = connected_peers_.size();
+  // connected_peers_ is sorted from kNodeId_, so its last entry is the furthest connected peer.
+  if (!connected_peers_.empty())
+    group_range_view.furthest_connected_peer_ = NodeIdOf(connected_peers_.back());
+  group_range_view.unique_node_ids_ = GetUniqueNodeIds();
+  group_range_view.radius_ = radius_;
+  return group_range_view;
 }
 
 std::shared_ptr<MatrixChange> GroupMatrix::UpdateFromConnectedPeer(
     const NodeId& peer, const std::vector<NodeInfo>& nodes,
     const std::vector<NodeId>& old_unique_ids) {
-  assert(nodes.size() < Parameters::max_routing_table_size);
   if (peer.IsZero()) {
     assert(false && "Invalid peer node id.");
     return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
   }
   // If peer is in my group
-  auto group_itr(std::begin(matrix_));
-  for (; group_itr != std::end(matrix_); ++group_itr) {
-    if (group_itr->begin()->node_id == peer)
-      break;
-  }
-
+  auto group_itr(FindRow(peer));
   if (group_itr == std::end(matrix_)) {
     LOG(kWarning) << "Peer Node : " << DebugId(peer) << " is not in closest group of this node.";
     return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, old_unique_ids));
   }
 
-  // Update peer's row
-  if (group_itr->size() > 1) {
-    group_itr->erase(group_itr->begin() + 1, group_itr->end());
-  }
-  for (const auto& i : nodes)
-    group_itr->push_back(i);
+  // Update peer's row.  References to the new entries are taken before the old ones are released,
+  // so entries present in both only have their reference counts touched.
+  const RecordIndex kPeerRecord(group_itr->front());
+  Row row(1, kPeerRecord);
+  row.reserve(nodes.size() + 1);
+  for (const auto& node_info : nodes)
+    row.push_back(AddReference(node_info, kPeerRecord));
+  for (auto itr(group_itr->begin() + 1); itr != group_itr->end(); ++itr)
+    RemoveReference(*itr, kPeerRecord);
+  group_itr->swap(row);
 
-  // Update unique node vector
   Prune();
-  UpdateUniqueNodeList();
+  UpdateConnectedPeersAndRadius();
   return std::make_shared<MatrixChange>(MatrixChange(kNodeId_, old_unique_ids, GetUniqueNodeIds()));
 }
 
@@ -337,39 +316,39 @@ bool GroupMatrix::GetRow(const NodeId& row_id, std::vector<NodeInfo>& row_entrie
     assert(false && "Invalid node id.");
     return false;
   }
-  auto group_itr(std::begin(matrix_));
-  for (group_itr = std::begin(matrix_); group_itr != std::end(matrix_); ++group_itr) {
-    if ((*group_itr).at(0).node_id == row_id)
-      break;
-  }
-
+  auto group_itr(FindRow(row_id));
   if (group_itr == std::end(matrix_))
     return false;
 
-  row_entries.clear();
-  for (uint32_t i(0); i < (*group_itr).size(); ++i) {
-    if (i != 0) {
-      row_entries.push_back((*group_itr).at(i));
-    }
-  }
+  row_entries = NodeInfosOf(group_itr->begin() + 1, group_itr->end());
   return true;
 }
 
-std::vector<NodeInfo> GroupMatrix::GetUniqueNodes() const { return unique_nodes_; }
+std::vector<NodeInfo> GroupMatrix::GetUniqueNodes() const {
+  return NodeInfosOf(std::begin(unique_nodes_), std::end(unique_nodes_));
+}
 
 std::vector<NodeId> GroupMatrix::GetUniqueNodeIds() const {
   std::vector<NodeId> unique_node_ids;
-  for (auto& node_info : unique_nodes_)
-    unique_node_ids.push_back(node_info.node_id);
+  unique_node_ids.reserve(unique_nodes_.size());
+  for (auto record : unique_nodes_)
+    unique_node_ids.push_back(NodeIdOf(record));
   return unique_node_ids;
 }
 
+uint64_t GroupMatrix::MemoryBytes() const {
+  uint64_t bytes(ContainerBytes(records_) + ContainerBytes(free_records_) +
+                 HashedContainerBytes(record_index_) + ContainerBytes(unique_nodes_) +
+                 ContainerBytes(connected_peers_) + ContainerBytes(matrix_));
+  for (const auto& record : records_)
+    bytes += ContainerBytes(record.node_info.dimension_list) + ContainerBytes(record.holders);
+  for (const auto& row : matrix_)
+    bytes += ContainerBytes(row);
+  return bytes;
+}
+
 bool GroupMatrix::IsRowEmpty(const NodeInfo& node_info) {
-  auto group_itr(std::begin(matrix_));
-  for (; group_itr != std::end(matrix_); ++group_itr) {
-    if ((*group_itr).at(0).node_id == node_info.node_id)
-      break;
-  }
+  auto group_itr(FindRow(node_info.node_id));
   assert(group_itr != std::end(matrix_));
   if (group_itr == std::end(matrix_))
     return false;
@@ -378,101 +357,204 @@ bool GroupMatrix::IsRowEmpty(const NodeInfo& node_info) {
 }
 
 std::vector<NodeInfo> GroupMatrix::GetClosestNodes(uint16_t size) {
-  uint16_t size_to_sort(std::min(size, static_cast<uint16_t>(unique_nodes_.size())));
-  PartialSortFromTarget(kNodeId_, size_to_sort, unique_nodes_);
-  return std::vector<NodeInfo>(unique_nodes_.begin(), unique_nodes_.begin() + size_to_sort);
+  uint16_t size_to_get(std::min(size, static_cast<uint16_t>(unique_nodes_.size())));
+  return NodeInfosOf(unique_nodes_.begin(), unique_nodes_.begin() + size_to_get);
+}
+
+std::vector<NodeInfo> GroupMatrix::GetClosestUniqueNodes(const NodeId& target,
+                                                        uint16_t number) const {
+  Row closest(ClosestUniqueRecords(target, number));
+  return NodeInfosOf(closest.begin(), closest.end());
+}
+
+GroupMatrix::Row GroupMatrix::ClosestUniqueRecords(const NodeId& target, uint16_t number) const {
+  std::vector<std::pair<Distance, size_t>> keys;
+  keys.reserve(unique_nodes_.size());
+  for (size_t index(0); index != unique_nodes_.size(); ++index)
+    keys.push_back(std::make_pair(Distance(NodeIdOf(unique_nodes_[index]), target), index));
+  size_t count(std::min(static_cast<size_t>(number), keys.size()));
+  std::partial_sort(keys.begin(), keys.begin() + count, keys.end());
+  Row closest;
+  closest.reserve(count);
+  for (auto itr(keys.begin()); itr != keys.begin() + count; ++itr)
+    closest.push_back(unique_nodes_[itr->second]);
+  return closest;
 }
 
 bool GroupMatrix::Contains(const NodeId& node_id) {
-  return std::find_if(unique_nodes_.begin(), unique_nodes_.end(),
-                      [&node_id](const NodeInfo & node_info) {
-           return node_info.node_id == node_id;
-         }) != unique_nodes_.end();
+  return record_index_.count(node_id) != 0;
 }
 
-void GroupMatrix::UpdateUniqueNodeList() {
-  std::set<NodeInfo, std::function<bool(const NodeInfo&, const NodeInfo&)>> sorted_to_owner([&](
-      const NodeInfo & lhs,
-      const NodeInfo & rhs) { return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_); });
+GroupMatrix::RecordIndex GroupMatrix::AddReference(const NodeInfo& node_info, RecordIndex holder) {
+  auto found(record_index_.find(node_info.node_id));
+  if (found != std::end(record_index_)) {
+    auto& record(records_[found->second]);
+    ++record.references;
+    if (holder != kNoHolder)
+      record.holders.push_back(holder);
+    return found->second;
+  }
+  RecordIndex index(static_cast<RecordIndex>(records_.size()));
+  if (free_records_.empty()) {
+    records_.push_back(NodeRecord());
+  } else {
+    index = free_records_.back();
+    free_records_.pop_back();
+  }
+  auto& record(records_[index]);
+  record.node_info = node_info;
+  record.references = 1;
+  if (holder != kNoHolder)
+    record.holders.push_back(holder);
+  record_index_.insert(std::make_pair(node_info.node_id, index));
+  Distance distance(node_info.node_id, kNodeId_);
+  unique_nodes_.insert(std::upper_bound(std::begin(unique_nodes_), std::end(unique_nodes_),
+                                        distance,
+                                        [this](const Distance& lhs, RecordIndex rhs) {
+                                          return lhs < Distance(NodeIdOf(rhs), kNodeId_);
+                                        }),
+                       index);
+  return index;
+}
+
+void GroupMatrix::RemoveReference(RecordIndex index, RecordIndex holder) {
+  auto& record(records_[index]);
+  assert(record.references != 0);
+  auto holder_itr(std::find(std::begin(record.holders), std::end(record.holders), holder));
+  if (holder_itr != std::end(record.holders))
+    record.holders.erase(holder_itr);
+  if (--record.references != 0)
+    return;
+  unique_nodes_.erase(FindUniqueNode(index));
+  record_index_.erase(record.node_info.node_id);
+  record = NodeRecord();
+  free_records_.push_back(index);
+}
+
+std::vector<NodeInfo> GroupMatrix::NodeInfosOf(Row::const_iterator first,
+                                               Row::const_iterator last) const {
+  std::vector<NodeInfo> node_infos;
+  node_infos.reserve(std::distance(first, last));
+  for (; first != last; ++first)
+    node_infos.push_back(records_[*first].node_info);
+  return node_infos;
+}
+
+const GroupMatrix::Row* GroupMatrix::FirstRowHeldBy(
+    const std::vector<RecordIndex>& holders, const NodeId& excluded_peer_id,
+    const ExcludedNodes& exclude) const {
+  for (const auto& row : matrix_) {
+    if (std::find(std::begin(holders), std::end(holders), row.front()) == std::end(holders))
+      continue;
+    const NodeId& peer_id(NodeIdOf(row.front()));
+    if (peer_id == excluded_peer_id)
+      continue;
+    if (exclude.Contains(peer_id))
+      continue;
+    return &row;
+  }
+  return nullptr;
+}
+
+std::vector<GroupMatrix::Row>::iterator GroupMatrix::FindRow(const NodeId& peer_id) {
+  auto found(record_index_.find(peer_id));
+  if (found == std::end(record_index_))
+    return std::end(matrix_);
+  const RecordIndex kPeerRecord(found->second);
+  return std::find_if(std::begin(matrix_), std::end(matrix_),
+                      [kPeerRecord](const Row& row) { return row.front() == kPeerRecord; });
+}
+
+GroupMatrix::Row::iterator GroupMatrix::FindUniqueNode(RecordIndex record) {
+  Distance distance(NodeIdOf(record), kNodeId_);
+  auto itr(std::lower_bound(std::begin(unique_nodes_), std::end(unique_nodes_), distance,
+                            [this](RecordIndex lhs, const Distance& rhs) {
+                              return Distance(NodeIdOf(lhs), kNodeId_) < rhs;
+                            }));
+  assert(itr != std::end(unique_nodes_) && *itr == record);
+  return itr;
+}
+
+void GroupMatrix::AddRow(const NodeInfo& peer, const std::vector<NodeInfo>& entries) {
+  RecordIndex peer_record(AddReference(peer, kNoHolder));
+  // Prefer a connected peer's own entry over copies of it reported in other rows.
+  records_[peer_record].node_info = peer;
+  records_[peer_record].holders.push_back(peer_record);
+  Row row(1, peer_record);
+  row.reserve(entries.size() + 1);
+  for (const auto& node_info : entries)
+    row.push_back(AddReference(node_info, peer_record));
+  matrix_.push_back(std::move(row));
+}
+
+std::vector<GroupMatrix::Row>::iterator GroupMatrix::EraseRow(
+    std::vector<Row>::iterator row_itr) {
+  const RecordIndex kPeerRecord(row_itr->front());
+  for (auto record : *row_itr)
+    RemoveReference(record, kPeerRecord);
+  return matrix_.erase(row_itr);
+}
+
+void GroupMatrix::UpdateConnectedPeersAndRadius() {
   auto closest_nodes_size_adjust = Parameters::closest_nodes_size;
-  if (!client_mode_) {
-    NodeInfo node_info;
-    node_info.node_id = kNodeId_;
-    sorted_to_owner.insert(node_info);
+  if (!client_mode_)
     ++closest_nodes_size_adjust;
+
+  Row connected_peers;
+  for (const auto& row : matrix_) {
+    if (NodeIdOf(row.front()) != kNodeId_)
+      connected_peers.push_back(row.front());
   }
-  for (const auto& node_ids : matrix_) {
-    for (const auto& node_id : node_ids)
-      sorted_to_owner.insert(node_id);
-  }
-  unique_nodes_.assign(std::begin(sorted_to_owner), std::end(sorted_to_owner));
+  PartialSortByDistance(connected_peers, kNodeId_, connected_peers.size(),
+                        [this](RecordIndex record)->const NodeId & { return NodeIdOf(record); });
+  connected_peers_.swap(connected_peers);
 
   // Updating radius
-  NodeId fcn_distance;
   if (unique_nodes_.size() >= closest_nodes_size_adjust) {
-    fcn_distance = kNodeId_ ^ unique_nodes_[closest_nodes_size_adjust - 1].node_id;
-
-    radius_ =
-        (crypto::BigInt((fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-         Parameters::proximity_factor);
+    radius_ = DistanceUint(kNodeId_, NodeIdOf(unique_nodes_[closest_nodes_size_adjust - 1])) *
+              Parameters::proximity_factor;
   } else {
-    fcn_distance = NodeId(NodeId::kMaxId);  // FIXME Prakash
-    radius_ =
-        (crypto::BigInt((fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()));
+    radius_ = DistanceUint(NodeId(NodeId::kMaxId));  // FIXME Prakash
   }
 }
 
-void GroupMatrix::PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                        std::vector<NodeInfo>& nodes) {
-  uint16_t count = std::min(number, static_cast<uint16_t>(nodes.size()));
-  std::partial_sort(nodes.begin(), nodes.begin() + count, nodes.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-  });
-}
-
 void GroupMatrix::Prune() {
   if (matrix_.size() <= Parameters::closest_nodes_size)
     return;
   NodeId node_id;
-  std::partial_sort(std::begin(matrix_), std::begin(matrix_) + Parameters::closest_nodes_size,
-                    std::end(matrix_), [this](const std::vector<NodeInfo>& lhs,
-                                              const std::vector<NodeInfo>& rhs) {
-                                         return NodeId::CloserToTarget(lhs.begin()->node_id,
-                                                                       rhs.begin()->node_id,
-                                                                       kNodeId_);
-                                       });
+  PartialSortByDistance(matrix_, kNodeId_, Parameters::closest_nodes_size,
+                        [this](const Row& row)->const NodeId & { return NodeIdOf(row.front()); });
   auto itr(std::begin(matrix_));
   std::advance(itr, Parameters::closest_nodes_size);
   while (itr != std::end(matrix_)) {
     if (client_mode_) {
       LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes "
-                 << DebugId(itr->begin()->node_id);
-      itr = matrix_.erase(itr);
+                 << DebugId(NodeIdOf(itr->front()));
+      itr = EraseRow(itr);
       continue;
     }
-    node_id = itr->begin()->node_id;
+    node_id = NodeIdOf(itr->front());
     if (itr->size() <= Parameters::closest_nodes_size) {
       if (itr->size() > 1) {  // avoids removing the recently added node
         LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes " << DebugId(node_id);
-        itr = matrix_.erase(itr);
+        itr = EraseRow(itr);
       } else {
         itr++;
       }
       continue;
     }
-    std::sort(itr->begin() + 1, itr->end(), [node_id](const NodeInfo& lhs, const NodeInfo& rhs) {
-                                              return NodeId::CloserToTarget(lhs.node_id,
-                                                                            rhs.node_id, node_id);
+    std::sort(itr->begin() + 1, itr->end(), [&](RecordIndex lhs, RecordIndex rhs) {
+                                              return NodeId::CloserToTarget(NodeIdOf(lhs),
+                                                                            NodeIdOf(rhs), node_id);
                                             });
-    if (NodeId::CloserToTarget(itr->at(Parameters::closest_nodes_size).node_id, kNodeId_,
+    if (NodeId::CloserToTarget(NodeIdOf(itr->at(Parameters::closest_nodes_size)), kNodeId_,
                                node_id) ||
-        (std::find_if(std::begin(*itr), std::end(*itr), [&](const NodeInfo& node_info) {
-                                                          return node_info.node_id == kNodeId_;
+        (std::find_if(std::begin(*itr), std::end(*itr), [&](RecordIndex record) {
+                                                          return NodeIdOf(record) == kNodeId_;
                                                         }) == std::end(*itr))) {
       LOG(kInfo) << DebugId(kNodeId_) << " matrix conected removes "
-                 << DebugId(itr->begin()->node_id);
-      itr = matrix_.erase(itr);
+                 << DebugId(NodeIdOf(itr->front()));
+      itr = EraseRow(itr);
     } else {
       itr++;
     }
@@ -486,9 +568,9 @@ void GroupMatrix::PrintGroupMatrix() const {
   std::string output("Group matrix of node with NodeID: " + DebugId(kNodeId_));
   for (group_itr = std::begin(matrix_); group_itr != std::end(matrix_); ++group_itr) {
     output.append("\nGroup matrix row:");
-    for (const auto& elem : (*group_itr)) {
+    for (auto record : (*group_itr)) {
       output.append(tab);
-      output.append(DebugId(elem.node_id));
+      output.append(DebugId(NodeIdOf(record)));
     }
   }
   LOG(kVerbose) << output;
@@ -19,15 +19,21 @@
 #ifndef MAIDSAFE_ROUTING_GROUP_MATRIX_H_
 #define MAIDSAFE_ROUTING_GROUP_MATRIX_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <mutex>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/node_id_hash.h"
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/fixed_uint.h"
+#include "maidsafe/routing/group_range_view.h"
+#include "maidsafe/routing/route_history.h"
 
 namespace maidsafe {
 
@@ -53,6 +59,11 @@ class GroupMatrix {
 
   std::shared_ptr<MatrixChange> RemoveConnectedPeer(const NodeInfo& node_info);
 
+  // Applies all additions and removals of connected peers before pruning and rebuilding the unique
+  // node list once, so that the whole batch is reported as a single change.
+  std::shared_ptr<MatrixChange> UpdateConnectedPeers(const std::vector<NodeInfo>& added_peers,
+                                                     const std::vector<NodeId>& removed_peers);
+
   // Returns the connected peers sorted to node ids from kNodeId_
   std::vector<NodeInfo> GetConnectedPeers() const;
 
@@ -61,8 +72,8 @@ class GroupMatrix {
 
   // Returns the peer which has node closest to target_id in its row (1st occurrence).
   void GetBetterNodeForSendingMessage(const NodeId& target_node_id,
-                                      const std::vector<std::string>& exclude,
-                                      bool ignore_exact_match, NodeInfo& current_closest_peer);
+                                      const ExcludedNodes& exclude, bool ignore_exact_match,
+                                      NodeInfo& current_closest_peer);
   void GetBetterNodeForSendingMessage(const NodeId& target_node_id, bool ignore_exact_match,
                                       NodeId& current_closest_peer_id);
   std::vector<NodeInfo> GetAllConnectedPeersFor(const NodeId& target_id);
@@ -71,6 +82,7 @@ class GroupMatrix {
   bool ClosestToId(const NodeId& target_id);
   //  bool IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id);
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
+  GroupRangeView GetGroupRangeView() const;
   // Updates group matrix if peer is present in 1st column of matrix
   std::shared_ptr<MatrixChange> UpdateFromConnectedPeer(const NodeId& peer,
                                                         const std::vector<NodeInfo>& nodes,
@@ -82,8 +94,30 @@ class GroupMatrix {
   std::vector<NodeInfo> GetUniqueNodes() const;
   std::vector<NodeId> GetUniqueNodeIds() const;
   std::vector<NodeInfo> GetClosestNodes(uint16_t size);
+  // Returns up to |number| unique nodes closest to |target|, copying only those returned.
+  std::vector<NodeInfo> GetClosestUniqueNodes(const NodeId& target, uint16_t number) const;
+  // Visitor forms of GetConnectedPeers, GetUniqueNodes, GetClosestUniqueNodes and
+  // GetAllConnectedPeersFor, calling |visitor| with each node in the same order instead of copying
+  // them out.  Visiting stops early if |visitor| returns false.
+  template <typename Visitor>
+  void VisitConnectedPeers(Visitor visitor) const {
+    VisitRecords(connected_peers_.begin(), connected_peers_.end(), visitor);
+  }
+  template <typename Visitor>
+  void VisitUniqueNodes(Visitor visitor) const {
+    VisitRecords(unique_nodes_.begin(), unique_nodes_.end(), visitor);
+  }
+  template <typename Visitor>
+  void VisitClosestUniqueNodes(const NodeId& target, uint16_t number, Visitor visitor) const {
+    Row closest(ClosestUniqueRecords(target, number));
+    VisitRecords(closest.begin(), closest.end(), visitor);
+  }
+  template <typename Visitor>
+  void VisitAllConnectedPeersFor(const NodeId& target_id, Visitor visitor) const;
   bool Contains(const NodeId& node_id);
   void Prune();
+  // Estimated heap bytes held, less the nodes' public keys (see MemoryStatistics).
+  uint64_t MemoryBytes() const;
 
   friend class RoutingTable;
   friend class test::GenericNode;
@@ -91,20 +125,75 @@ class GroupMatrix {
   friend class test::GroupMatrixTest_BEH_Prune_Test;
 
  private:
+  typedef uint32_t RecordIndex;
+  // Each distinct node in the matrix is held once in records_; rows, unique_nodes_ and
+  // connected_peers_ hold indices into it.
+  struct NodeRecord {
+    NodeRecord() : node_info(), references(0), holders() {}
+    NodeInfo node_info;
+    size_t references;  // occurrences across all rows, plus one for this node's own entry
+    std::vector<RecordIndex> holders;  // first-column record of each row holding the node
+  };
+  typedef std::vector<RecordIndex> Row;
+
   GroupMatrix(const GroupMatrix&);
   GroupMatrix& operator=(const GroupMatrix&);
-  void UpdateUniqueNodeList();
-  void PartialSortFromTarget(const NodeId& target, uint16_t number,
-                             std::vector<NodeInfo>& nodes);
+  // unique_nodes_ is maintained incrementally as rows are added, changed and erased; this
+  // refreshes the state derived from it and from the first column of matrix_.
+  void UpdateConnectedPeersAndRadius();
+  // Adds a reference to the record for |node_info|, interning it if it isn't already held, and
+  // returns its index.  |holder| is the record of the connected peer whose row holds the
+  // reference, or kNoHolder for this node's own entry.
+  RecordIndex AddReference(const NodeInfo& node_info, RecordIndex holder);
+  void RemoveReference(RecordIndex record, RecordIndex holder);
+  const NodeId& NodeIdOf(RecordIndex record) const { return records_[record].node_info.node_id; }
+  std::vector<NodeInfo> NodeInfosOf(Row::const_iterator first, Row::const_iterator last) const;
+  template <typename Visitor>
+  void VisitRecords(Row::const_iterator first, Row::const_iterator last, Visitor& visitor) const {
+    for (; first != last; ++first) {
+      if (!visitor(records_[*first].node_info))
+        return;
+    }
+  }
+  // The records of up to |number| unique nodes closest to |target|, closest first.
+  Row ClosestUniqueRecords(const NodeId& target, uint16_t number) const;
+  // Returns the first row in matrix_ order held by one of |holders| and not excluded.
+  const Row* FirstRowHeldBy(const std::vector<RecordIndex>& holders,
+                            const NodeId& excluded_peer_id,
+                            const ExcludedNodes& exclude) const;
+  std::vector<Row>::iterator FindRow(const NodeId& peer_id);
+  Row::iterator FindUniqueNode(RecordIndex record);
+  void AddRow(const NodeInfo& peer, const std::vector<NodeInfo>& entries);
+  std::vector<Row>::iterator EraseRow(std::vector<Row>::iterator row_itr);
   void PrintGroupMatrix() const;
 
   const NodeId& kNodeId_;
-  std::vector<NodeInfo> unique_nodes_;
-  crypto::BigInt radius_;
+  std::vector<NodeRecord> records_;
+  // Indices of records_ released when their last reference is removed, for reuse.
+  std::vector<RecordIndex> free_records_;
+  std::unordered_map<NodeId, RecordIndex, NodeIdHash> record_index_;
+  // Every live record, held sorted from kNodeId_
+  Row unique_nodes_;
+  // First column of matrix_, held sorted from kNodeId_
+  Row connected_peers_;
+  DistanceUint radius_;
   bool client_mode_;
-  std::vector<std::vector<NodeInfo>> matrix_;
+  std::vector<Row> matrix_;
 };
 
+template <typename Visitor>
+void GroupMatrix::VisitAllConnectedPeersFor(const NodeId& target_id, Visitor visitor) const {
+  auto found(record_index_.find(target_id));
+  if (found == std::end(record_index_))
+    return;
+  const auto& holders(records_[found->second].holders);
+  for (const auto& row : matrix_) {
+    if (std::find(std::begin(holders), std::end(holders), row.front()) != std::end(holders) &&
+        !visitor(records_[row.front()].node_info))
+      return;
+  }
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
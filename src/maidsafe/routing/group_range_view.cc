@@ -0,0 +1,310 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/group_range_view.h"
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <utility>
+
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Whether all, none or only some of the IDs in a block have a property.
+enum class Extent { kNone, kAll, kSome };
+
+Extent Both(Extent lhs, Extent rhs) {
+  if (lhs == Extent::kNone || rhs == Extent::kNone)
+    return Extent::kNone;
+  return (lhs == Extent::kAll && rhs == Extent::kAll) ? Extent::kAll : Extent::kSome;
+}
+
+Extent Neither(Extent extent) {
+  if (extent == Extent::kSome)
+    return extent;
+  return extent == Extent::kAll ? Extent::kNone : Extent::kAll;
+}
+
+bool Bit(const std::string& raw, size_t index) {
+  return ((static_cast<unsigned char>(raw[index / 8]) >> (7 - index % 8)) & 1U) != 0;
+}
+
+void SetBit(std::string& raw, size_t index, bool value) {
+  const unsigned char kMask(static_cast<unsigned char>(0x80U >> (index % 8)));
+  unsigned char byte(static_cast<unsigned char>(raw[index / 8]));
+  raw[index / 8] = static_cast<char>(value ? (byte | kMask) : (byte & ~kMask));
+}
+
+// |raw| with every bit from |first_bit| on set to |value|.
+std::string Fill(std::string raw, size_t first_bit, bool value) {
+  for (size_t index(first_bit); index != raw.size() * 8; ++index)
+    SetBit(raw, index, value);
+  return raw;
+}
+
+// A block is the IDs sharing the first |bits| bits of |prefix|, whose later bits are zero.
+// Classifies blocks, splitting any whose IDs aren't all classed alike, and appends the results in
+// ID order, merging neighbours of the same class.
+class RangeClassifier {
+ public:
+  RangeClassifier(const NodeId& node_id, bool client_mode, bool bounded,
+                  const DistanceUint& bound, const DistanceUint& radius)
+      : node_id_(node_id),
+        node_raw_(node_id.string()),
+        client_mode_(client_mode),
+        bounded_(bounded),
+        bound_(bound),
+        radius_(radius),
+        ranges_() {}
+
+  // |holders| are the nodes still competing for the |slots| closest places to IDs in the block,
+  // or empty once |in_group| is no longer kSome.
+  void Classify(const std::string& prefix, size_t bits, const std::vector<NodeId>& holders,
+                size_t slots, Extent in_group) {
+    if (in_group == Extent::kSome) {
+      if (std::find(holders.begin(), holders.end(), node_id_) == holders.end())
+        in_group = Extent::kNone;
+      else if (holders.size() <= slots)
+        in_group = Extent::kAll;
+    }
+    const Extent kBounded(bounded_ ? WithinDistance(prefix, bits, bound_, true) : Extent::kAll);
+    const Extent kInRange(client_mode_ ? Extent::kNone : Both(in_group, kBounded));
+    const Extent kProximal(
+        client_mode_ ? kBounded
+                     : Both(Both(Neither(kInRange), WithinDistance(prefix, bits, radius_, false)),
+                            kBounded));
+    if ((kInRange != Extent::kSome && kProximal != Extent::kSome) || bits == prefix.size() * 8) {
+      Append(prefix, bits, kInRange == Extent::kAll ? GroupRangeStatus::kInRange
+                               : (kProximal == Extent::kAll ? GroupRangeStatus::kInProximalRange
+                                                            : GroupRangeStatus::kOutwithRange));
+      return;
+    }
+    for (int half(0); half != 2; ++half) {
+      std::string child(prefix);
+      SetBit(child, bits, half != 0);
+      if (in_group != Extent::kSome) {
+        Classify(child, bits + 1, std::vector<NodeId>(), 0, in_group);
+        continue;
+      }
+      // Nodes in this half are closer than the others to all of its IDs, so take the first places.
+      std::vector<NodeId> nearer, further;
+      for (const auto& holder : holders)
+        (Bit(holder.string(), bits) == (half != 0) ? nearer : further).push_back(holder);
+      if (nearer.size() >= slots ||
+          std::find(nearer.begin(), nearer.end(), node_id_) != nearer.end()) {
+        Classify(child, bits + 1, nearer, slots, in_group);
+      } else {
+        Classify(child, bits + 1, further, slots - nearer.size(), in_group);
+      }
+    }
+  }
+
+  ResponsibilityRanges Result() const {
+    ResponsibilityRanges result;
+    for (const auto& range : ranges_) {
+      if (range.second == GroupRangeStatus::kInRange)
+        result.in_range.push_back(range.first);
+      else if (range.second == GroupRangeStatus::kInProximalRange)
+        result.proximal.push_back(range.first);
+    }
+    return result;
+  }
+
+ private:
+  RangeClassifier(const RangeClassifier&);
+  RangeClassifier& operator=(const RangeClassifier&);
+
+  Extent WithinDistance(const std::string& prefix, size_t bits, const DistanceUint& limit,
+                        bool inclusive) const {
+    std::string distance(prefix);
+    for (size_t index(0); index != distance.size(); ++index)
+      distance[index] = static_cast<char>(distance[index] ^ node_raw_[index]);
+    const DistanceUint kNearest(NodeId(Fill(distance, bits, false)));
+    const DistanceUint kFurthest(NodeId(Fill(distance, bits, true)));
+    auto within([&](const DistanceUint & value) {
+      return inclusive ? value <= limit : value < limit;
+    });
+    if (within(kFurthest))
+      return Extent::kAll;
+    return within(kNearest) ? Extent::kSome : Extent::kNone;
+  }
+
+  void Append(const std::string& prefix, size_t bits, GroupRangeStatus status) {
+    const KeyRange kRange(NodeId(Fill(prefix, bits, false)), NodeId(Fill(prefix, bits, true)));
+    if (!ranges_.empty() && ranges_.back().second == status)
+      ranges_.back().first.last = kRange.last;
+    else
+      ranges_.push_back(std::make_pair(kRange, status));
+  }
+
+  const NodeId node_id_;
+  const std::string node_raw_;
+  const bool client_mode_, bounded_;
+  const DistanceUint bound_, radius_;
+  std::vector<std::pair<KeyRange, GroupRangeStatus>> ranges_;
+};
+
+NodeId Next(const NodeId& node_id) {
+  return (DistanceUint(node_id) + DistanceUint(1U)).ToNodeId();
+}
+
+NodeId Previous(const NodeId& node_id) {
+  return (DistanceUint(node_id) - DistanceUint(1U)).ToNodeId();
+}
+
+}  // unnamed namespace
+
+bool operator==(const KeyRange& lhs, const KeyRange& rhs) {
+  return lhs.first == rhs.first && lhs.last == rhs.last;
+}
+
+std::vector<KeyRange> MergeRanges(std::vector<KeyRange> ranges) {
+  std::sort(ranges.begin(), ranges.end(), [](const KeyRange & lhs, const KeyRange & rhs) {
+    return lhs.first < rhs.first;
+  });
+  std::vector<KeyRange> merged;
+  for (const auto& range : ranges) {
+    if (!merged.empty() && (merged.back().last == NodeId(NodeId::kMaxId) ||
+                            !(Next(merged.back().last) < range.first))) {
+      if (merged.back().last < range.last)
+        merged.back().last = range.last;
+    } else {
+      merged.push_back(range);
+    }
+  }
+  return merged;
+}
+
+std::vector<KeyRange> SubtractRanges(const std::vector<KeyRange>& lhs,
+                                     const std::vector<KeyRange>& rhs) {
+  std::vector<KeyRange> difference;
+  auto rhs_itr(rhs.begin());
+  for (const auto& range : lhs) {
+    KeyRange remainder(range);
+    bool remaining(true);
+    while (rhs_itr != rhs.end() && rhs_itr->last < remainder.first)
+      ++rhs_itr;
+    for (auto itr(rhs_itr); remaining && itr != rhs.end() && !(remainder.last < itr->first);
+         ++itr) {
+      if (remainder.first < itr->first)
+        difference.push_back(KeyRange(remainder.first, Previous(itr->first)));
+      if (itr->last < remainder.last)
+        remainder.first = Next(itr->last);
+      else
+        remaining = false;
+    }
+    if (remaining)
+      difference.push_back(remainder);
+  }
+  return difference;
+}
+
+void SetRangeChanges(const ResponsibilityRanges& previous, ResponsibilityRanges& current) {
+  std::vector<KeyRange> previous_covered(previous.in_range), current_covered(current.in_range);
+  previous_covered.insert(previous_covered.end(), previous.proximal.begin(),
+                          previous.proximal.end());
+  current_covered.insert(current_covered.end(), current.proximal.begin(), current.proximal.end());
+  previous_covered = MergeRanges(previous_covered);
+  current_covered = MergeRanges(current_covered);
+  current.gained = SubtractRanges(current_covered, previous_covered);
+  current.lost = SubtractRanges(previous_covered, current_covered);
+}
+
+GroupRangeView::GroupRangeView()
+    : node_id_(),
+      client_mode_(false),
+      connected_peers_count_(0),
+      furthest_connected_peer_(),
+      unique_node_ids_(),
+      radius_(),
+      ready_to_estimate_(false),
+      in_group_distance_() {}
+
+GroupRangeStatus GroupRangeView::IsNodeIdInGroupRange(const NodeId& group_id) const {
+  return IsNodeIdInGroupRange(group_id, node_id_);
+}
+
+GroupRangeStatus GroupRangeView::IsNodeIdInGroupRange(const NodeId& group_id,
+                                                      const NodeId& node_id) const {
+  if (group_id == node_id)
+    return GroupRangeStatus::kInRange;
+
+  if (connected_peers_count_ == 0)
+    return GroupRangeStatus::kInRange;
+
+  if (connected_peers_count_ >= Parameters::closest_nodes_size && node_id == node_id_ &&
+      NodeId::CloserToTarget(furthest_connected_peer_, group_id, node_id_)) {
+    return GroupRangeStatus::kOutwithRange;
+  }
+
+  size_t group_size_adjust(Parameters::group_size + 1U);
+  size_t new_holders_size = std::min(unique_node_ids_.size(), group_size_adjust);
+  std::vector<NodeId> new_holders(unique_node_ids_);
+  PartialSortByDistance(new_holders, group_id, new_holders_size);
+  new_holders.resize(new_holders_size);
+
+  new_holders.erase(std::remove(new_holders.begin(), new_holders.end(), group_id),
+                    new_holders.end());
+  if (new_holders.size() > Parameters::group_size) {
+    new_holders.resize(Parameters::group_size);
+    assert(new_holders.size() == Parameters::group_size);
+  }
+  if (!client_mode_) {
+    auto this_node_range(GetProximalRange(group_id, node_id_, node_id_, radius_, new_holders));
+    if (node_id == node_id_)
+      return this_node_range;
+    else if (this_node_range != GroupRangeStatus::kInRange)
+      BOOST_THROW_EXCEPTION(MakeError(RoutingErrors::not_in_range));  // not_in_group
+  } else {
+    if (node_id == node_id_)
+      return GroupRangeStatus::kInProximalRange;
+  }
+  return GetProximalRange(group_id, node_id, node_id_, radius_, new_holders);
+}
+
+// FIXME(Prakash) handle the case of sender_id == info_id
+bool GroupRangeView::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const {
+  return ready_to_estimate_ && DistanceUint(info_id, sender_id) <= in_group_distance_;
+}
+
+ResponsibilityRanges GroupRangeView::GetResponsibilityRanges() const {
+  ResponsibilityRanges result;
+  if (connected_peers_count_ == 0) {
+    result.in_range.push_back(KeyRange(NodeId(), NodeId(NodeId::kMaxId)));
+    return result;
+  }
+  RangeClassifier classifier(node_id_, client_mode_,
+                             connected_peers_count_ >= Parameters::closest_nodes_size,
+                             DistanceUint(node_id_, furthest_connected_peer_), radius_);
+  classifier.Classify(NodeId().string(), 0, unique_node_ids_, Parameters::group_size,
+                      Extent::kSome);
+  return classifier.Result();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
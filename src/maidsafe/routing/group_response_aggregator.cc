@@ -0,0 +1,117 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/group_response_aggregator.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// The replies to one request, by payload, each with the first of them kept as the one sent on.
+struct Collected {
+  Collected() : mutex(), replies() {}
+  std::mutex mutex;
+  std::vector<protobuf::Message> replies;
+};
+
+void AddToCollected(Collected& collected, protobuf::Message reply) {
+  std::lock_guard<std::mutex> lock(collected.mutex);
+  for (auto& merged : collected.replies) {
+    if (merged.data(0) != reply.data(0))
+      continue;
+    merged.add_aggregated_source_ids(reply.source_id());
+    merged.add_aggregated_signatures(reply.signature());
+    return;
+  }
+  reply.clear_aggregate_for();
+  collected.replies.push_back(std::move(reply));
+}
+
+}  // unnamed namespace
+
+GroupResponseAggregator::GroupResponseAggregator(Timer<std::string>& timer,
+                                                 SendFunctor send_functor)
+    : timer_(timer), send_functor_(std::move(send_functor)), mutex_(), tasks_() {}
+
+void GroupResponseAggregator::Expect(const protobuf::Message& request, int reply_count) {
+  const RequestKey kKey(request.source_id(), request.id());
+  const TaskId kTaskId(timer_.NewTaskId());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!tasks_.insert(std::make_pair(kKey, kTaskId)).second)
+      return;
+  }
+  auto collected(std::make_shared<Collected>());
+  auto remaining(std::make_shared<std::atomic<int>>(reply_count));
+  timer_.AddTask(Parameters::group_response_aggregation_timeout,
+                 [this, kKey, collected, remaining](std::string serialised_reply) {
+                   protobuf::Message reply;
+                   if (!serialised_reply.empty() && reply.ParseFromString(serialised_reply))
+                     AddToCollected(*collected, std::move(reply));
+                   if (--*remaining != 0)
+                     return;
+                   {
+                     std::lock_guard<std::mutex> lock(mutex_);
+                     tasks_.erase(kKey);
+                   }
+                   LOG(kVerbose) << "Sending " << collected->replies.size()
+                                 << " merged group response(s) to " << HexSubstr(kKey.first)
+                                 << ", id: " << kKey.second;
+                   for (auto& merged : collected->replies)
+                     send_functor_(merged);
+                 },
+                 reply_count, kTaskId);
+}
+
+bool GroupResponseAggregator::Add(const protobuf::Message& reply) {
+  if (reply.data_size() != 1)
+    return false;
+  TaskId task_id(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(tasks_.find(RequestKey(reply.aggregate_for(), reply.id())));
+    if (itr == tasks_.end())
+      return false;
+    task_id = itr->second;
+  }
+  try {
+    timer_.AddResponse(task_id, reply.SerializeAsString());
+  }
+  catch (const maidsafe_error&) {
+    return false;  // collection has just finished
+  }
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
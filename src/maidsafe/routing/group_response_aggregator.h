@@ -0,0 +1,74 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_GROUP_RESPONSE_AGGREGATOR_H_
+#define MAIDSAFE_ROUTING_GROUP_RESPONSE_AGGREGATOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "maidsafe/routing/timer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// Run by a group leader for Parameters::aggregate_group_responses: the members' replies to a group
+// request are collected, and those with identical payloads are sent on to the requester as one
+// message.  It carries the payload once, the first sender's ID and signature as usual, and the
+// others' in aggregated_source_ids and aggregated_signatures.  Whatever has arrived is sent once
+// every member has replied, or after Parameters::group_response_aggregation_timeout.
+class GroupResponseAggregator {
+ public:
+  typedef std::function<void(protobuf::Message& /*merged_response*/)> SendFunctor;
+
+  GroupResponseAggregator(Timer<std::string>& timer, SendFunctor send_functor);
+
+  // Starts collecting the |reply_count| replies to |request|.
+  void Expect(const protobuf::Message& request, int reply_count);
+  // Takes |reply|, a member's reply with aggregate_for set, returning false if no replies to its
+  // request are being collected.
+  bool Add(const protobuf::Message& reply);
+
+ private:
+  GroupResponseAggregator(const GroupResponseAggregator&);
+  GroupResponseAggregator(const GroupResponseAggregator&&);
+  GroupResponseAggregator& operator=(const GroupResponseAggregator&);
+
+  // Requester's ID and the request's ID
+  typedef std::pair<std::string, int32_t> RequestKey;
+
+  Timer<std::string>& timer_;
+  SendFunctor send_functor_;
+  std::mutex mutex_;
+  std::map<RequestKey, TaskId> tasks_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_GROUP_RESPONSE_AGGREGATOR_H_
@@ -0,0 +1,173 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/inbound_dispatcher.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/core_executors.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// An exception escaping a handler is logged rather than let unwind the thread running it.
+void RunHandler(const std::function<void()>& handler) {
+  try {
+    handler();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Inbound handler threw: " << e.what();
+  }
+  catch (...) {
+    LOG(kError) << "Inbound handler threw an unknown exception.";
+  }
+}
+
+}  // unnamed namespace
+
+InboundDispatcher::State::State(boost::asio::io_service& io_service_in, uint16_t shard_count,
+                                uint32_t max_queued_per_shard_in, CoreExecutors* cores_in)
+    : io_service(io_service_in),
+      cores(cores_in),
+      max_queued_per_shard(max_queued_per_shard_in),
+      mutex(),
+      data_shards(std::max<uint16_t>(shard_count, 1)),
+      control_shard(),
+      next_data_shard(0),
+      parked_runs(0) {}
+
+InboundDispatcher::InboundDispatcher(boost::asio::io_service& io_service, uint16_t shard_count,
+                                     uint32_t max_queued_per_shard, CoreExecutors* cores)
+    : state_(std::make_shared<State>(io_service, shard_count, max_queued_per_shard, cores)) {}
+
+bool InboundDispatcher::Post(const std::string& key, const std::function<void()>& handler) {
+  const size_t kIndex(std::hash<std::string>()(key) % state_->data_shards.size());
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    Shard& shard(state_->data_shards[kIndex]);
+    if (shard.handlers.size() >= state_->max_queued_per_shard)
+      return false;
+    shard.handlers.push_back(handler);
+  }
+  if (state_->cores) {
+    std::shared_ptr<State> state(state_);
+    state_->cores->service(kIndex % state_->cores->size()).post([state, kIndex]() {
+      RunShard(state, kIndex);
+    });
+  } else {
+    PostRun(state_);
+  }
+  return true;
+}
+
+void InboundDispatcher::PostControl(const std::function<void()>& handler) {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->control_shard.handlers.push_back(handler);
+  }
+  PostRun(state_);
+}
+
+std::vector<size_t> InboundDispatcher::QueueDepths() const {
+  std::vector<size_t> depths;
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  for (const auto& shard : state_->data_shards)
+    depths.push_back(shard.handlers.size());
+  depths.push_back(state_->control_shard.handlers.size());
+  return depths;
+}
+
+void InboundDispatcher::PostRun(const std::shared_ptr<State>& state) {
+  state->io_service.post([state]() { RunNext(state); });
+}
+
+void InboundDispatcher::RunNext(const std::shared_ptr<State>& state) {
+  Shard* shard(nullptr);
+  std::function<void()> handler;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    shard = NextRunnableShard(*state);
+    if (!shard) {
+      ++state->parked_runs;
+      return;
+    }
+    handler.swap(shard->handlers.front());
+    shard->handlers.pop_front();
+    shard->running = true;
+  }
+
+  // However the handler finishes, the shard is freed and a run request parked behind it resumed.
+  struct RunningGuard {
+    ~RunningGuard() {
+      bool unpark(false);
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        shard->running = false;
+        if (!shard->handlers.empty() && state->parked_runs != 0) {
+          --state->parked_runs;
+          unpark = true;
+        }
+      }
+      if (unpark)
+        PostRun(state);
+    }
+    const std::shared_ptr<State>& state;
+    Shard* const shard;
+  } running_guard = {state, shard};
+  RunHandler(handler);
+}
+
+void InboundDispatcher::RunShard(const std::shared_ptr<State>& state, size_t index) {
+  // There is a run request per handler, and the executor's one thread runs them in order.
+  std::function<void()> handler;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    Shard& shard(state->data_shards[index]);
+    if (shard.handlers.empty())
+      return;
+    handler.swap(shard.handlers.front());
+    shard.handlers.pop_front();
+  }
+  handler();
+}
+
+InboundDispatcher::Shard* InboundDispatcher::NextRunnableShard(State& state) {
+  if (!state.control_shard.running && !state.control_shard.handlers.empty())
+    return &state.control_shard;
+  if (state.cores)
+    return nullptr;
+  for (size_t i(0); i != state.data_shards.size(); ++i) {
+    size_t index((state.next_data_shard + i) % state.data_shards.size());
+    Shard& shard(state.data_shards[index]);
+    if (!shard.running && !shard.handlers.empty()) {
+      state.next_data_shard = index + 1;
+      return &shard;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,94 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_INBOUND_DISPATCHER_H_
+#define MAIDSAFE_ROUTING_INBOUND_DISPATCHER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+
+namespace maidsafe {
+
+namespace routing {
+
+class CoreExecutors;
+
+// Runs inbound handlers on an io_service.  Handlers posted with the same key run one at a time in
+// the order posted, as do control handlers.  Whenever a thread becomes free, a waiting control
+// handler is run in preference to any data handler; otherwise the data shards take turns.  A
+// data shard holding max_queued_per_shard handlers sheds further ones.  Given |cores|, which must
+// outlive the dispatcher's handlers, each data shard instead runs on one of its executors, in
+// turn, leaving only the control shard on |io_service|.
+class InboundDispatcher {
+ public:
+  InboundDispatcher(boost::asio::io_service& io_service, uint16_t shard_count,
+                    uint32_t max_queued_per_shard, CoreExecutors* cores = nullptr);
+  // Returns false if |handler| was shed because its shard is full.
+  bool Post(const std::string& key, const std::function<void()>& handler);
+  void PostControl(const std::function<void()>& handler);
+  // Returns the number of handlers posted to each data shard and not yet started, followed by the
+  // control shard's.
+  std::vector<size_t> QueueDepths() const;
+
+ private:
+  InboundDispatcher(const InboundDispatcher&);
+  InboundDispatcher(const InboundDispatcher&&);
+  InboundDispatcher& operator=(const InboundDispatcher&);
+
+  struct Shard {
+    Shard() : handlers(), running(false) {}
+    std::deque<std::function<void()>> handlers;
+    bool running;
+  };
+
+  // Held by each posted run request too, so one still queued when the dispatcher is destroyed
+  // doesn't outlive the shards.  There is a run request for every queued handler, but a request
+  // finding only shards which are already running is parked until one of them finishes.
+  struct State {
+    State(boost::asio::io_service& io_service_in, uint16_t shard_count,
+          uint32_t max_queued_per_shard_in, CoreExecutors* cores_in);
+    boost::asio::io_service& io_service;
+    CoreExecutors* const cores;
+    const uint32_t max_queued_per_shard;
+    mutable std::mutex mutex;
+    std::vector<Shard> data_shards;
+    Shard control_shard;
+    size_t next_data_shard, parked_runs;
+  };
+
+  static void PostRun(const std::shared_ptr<State>& state);
+  static void RunNext(const std::shared_ptr<State>& state);
+  // Runs the next handler of a data shard on its executor's single thread.
+  static void RunShard(const std::shared_ptr<State>& state, size_t index);
+  static Shard* NextRunnableShard(State& state);
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_INBOUND_DISPATCHER_H_
@@ -0,0 +1,154 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/inbound_trace.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const char kMagic[] = {'M', 'S', 'I', 'N', 'T', 'R', '\0', '\1'};
+const size_t kMagicSize(sizeof(kMagic));
+const size_t kEventHeaderSize(1 + 8 + 4);
+
+void AppendUint(uint64_t value, size_t bytes, std::string& output) {
+  for (size_t i(0); i != bytes; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint64_t ReadUint(const char* input, size_t bytes) {
+  uint64_t value(0);
+  for (size_t i(0); i != bytes; ++i)
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(input[i])) << (8 * i);
+  return value;
+}
+
+}  // unnamed namespace
+
+InboundTraceRecorder::InboundTraceRecorder(const boost::filesystem::path& path,
+                                           size_t max_buffered_bytes)
+    : stream_(path.string().c_str(), std::ios::binary | std::ios::trunc),
+      kMaxBufferedBytes_(max_buffered_bytes),
+      kStart_(std::chrono::steady_clock::now()),
+      mutex_(),
+      cond_var_(),
+      pending_(),
+      pending_bytes_(0),
+      dropped_(0),
+      stopping_(false),
+      thread_() {
+  if (!stream_.write(kMagic, kMagicSize))
+    throw std::runtime_error("Failed to open inbound trace " + path.string());
+  thread_ = std::thread([this] { Write(); });
+}
+
+InboundTraceRecorder::~InboundTraceRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cond_var_.notify_one();
+  thread_.join();
+  if (dropped_ != 0)
+    LOG(kWarning) << "Inbound trace dropped " << dropped_ << " events";
+}
+
+void InboundTraceRecorder::RecordMessage(const std::string& message) {
+  Record(InboundTraceEvent::kMessageReceived, message);
+}
+
+void InboundTraceRecorder::RecordConnectionLost(const NodeId& connection_id) {
+  Record(InboundTraceEvent::kConnectionLost, connection_id.string());
+}
+
+uint64_t InboundTraceRecorder::dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void InboundTraceRecorder::Record(InboundTraceEvent::Kind kind, const std::string& payload) {
+  InboundTraceEvent event;
+  event.kind = kind;
+  event.offset = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - kStart_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_bytes_ + payload.size() > kMaxBufferedBytes_) {
+      ++dropped_;
+      return;
+    }
+    pending_bytes_ += payload.size();
+    event.payload = payload;
+    pending_.push_back(std::move(event));
+  }
+  cond_var_.notify_one();
+}
+
+void InboundTraceRecorder::Write() {
+  std::string buffer;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    cond_var_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty())
+      break;
+    std::deque<InboundTraceEvent> events;
+    events.swap(pending_);
+    pending_bytes_ = 0;
+    lock.unlock();
+    buffer.clear();
+    for (const auto& event : events) {
+      buffer.push_back(static_cast<char>(event.kind));
+      AppendUint(static_cast<uint64_t>(event.offset.count()), 8, buffer);
+      AppendUint(event.payload.size(), 4, buffer);
+      buffer.append(event.payload);
+    }
+    stream_.write(buffer.data(), buffer.size());
+    stream_.flush();
+    lock.lock();
+  }
+}
+
+InboundTraceReader::InboundTraceReader(const boost::filesystem::path& path)
+    : stream_(path.string().c_str(), std::ios::binary) {
+  char magic[kMagicSize];
+  if (!stream_.read(magic, kMagicSize) || !std::equal(magic, magic + kMagicSize, kMagic))
+    throw std::runtime_error(path.string() + " is not an inbound trace");
+}
+
+bool InboundTraceReader::Next(InboundTraceEvent& event) {
+  char header[kEventHeaderSize];
+  if (!stream_.read(header, kEventHeaderSize))
+    return false;
+  event.kind = static_cast<InboundTraceEvent::Kind>(header[0]);
+  event.offset = std::chrono::microseconds(static_cast<int64_t>(ReadUint(header + 1, 8)));
+  event.payload.resize(static_cast<size_t>(ReadUint(header + 9, 4)));
+  return event.payload.empty() || static_cast<bool>(stream_.read(&event.payload[0],
+                                                                 event.payload.size()));
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_INBOUND_TRACE_H_
+#define MAIDSAFE_ROUTING_INBOUND_TRACE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>  // NOLINT
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "boost/filesystem/path.hpp"
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// An inbound trace is a file of what a node was given by rudp, for replaying offline.  After an
+// 8-byte magic string, each event is a 1-byte kind, the microseconds since recording started and
+// the payload's size, as little-endian uint64 and uint32, then the payload: a message exactly as
+// received, batches included, or the ID of a lost connection.
+struct InboundTraceEvent {
+  enum Kind : uint8_t { kMessageReceived = 0, kConnectionLost = 1 };
+
+  InboundTraceEvent() : kind(kMessageReceived), offset(0), payload() {}
+
+  Kind kind;
+  std::chrono::microseconds offset;
+  std::string payload;
+};
+
+// Writes an inbound trace on a thread of its own, so that recording costs a receiving thread only
+// a copy of what it records.  Events are dropped and counted rather than buffered once
+// |max_buffered_bytes| of payloads are waiting to be written, so that a slow disk can't hold up
+// routing.
+class InboundTraceRecorder {
+ public:
+  // Throws std::runtime_error if |path| can't be written.
+  InboundTraceRecorder(const boost::filesystem::path& path, size_t max_buffered_bytes);
+  // Writes whatever is still buffered.
+  ~InboundTraceRecorder();
+  void RecordMessage(const std::string& message);
+  void RecordConnectionLost(const NodeId& connection_id);
+  uint64_t dropped() const;
+
+ private:
+  InboundTraceRecorder(const InboundTraceRecorder&);
+  InboundTraceRecorder& operator=(const InboundTraceRecorder&);
+  void Record(InboundTraceEvent::Kind kind, const std::string& payload);
+  void Write();
+
+  std::ofstream stream_;
+  const size_t kMaxBufferedBytes_;
+  const std::chrono::steady_clock::time_point kStart_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_var_;
+  std::deque<InboundTraceEvent> pending_;
+  size_t pending_bytes_;
+  uint64_t dropped_;
+  bool stopping_;
+  std::thread thread_;
+};
+
+// Reads back the events of an inbound trace, in the order they were recorded.
+class InboundTraceReader {
+ public:
+  // Throws std::runtime_error if |path| can't be read or isn't an inbound trace.
+  explicit InboundTraceReader(const boost::filesystem::path& path);
+  // Returns false at the end of the trace, including at a final event cut short.
+  bool Next(InboundTraceEvent& event);
+
+ private:
+  InboundTraceReader(const InboundTraceReader&);
+  InboundTraceReader& operator=(const InboundTraceReader&);
+
+  std::ifstream stream_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_INBOUND_TRACE_H_
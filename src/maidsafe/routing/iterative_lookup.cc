@@ -0,0 +1,123 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/iterative_lookup.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/distance.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+IterativeLookup::IterativeLookup(const NodeId& target, const NodeId& this_node_id, uint16_t k,
+                                 uint16_t alpha)
+    : kTarget_(target), kThisNodeId_(this_node_id), kK_(std::max(k, uint16_t(1))),
+      kAlpha_(std::max(alpha, uint16_t(1))), shortlist_(), in_flight_(0) {}
+
+void IterativeLookup::AddCandidates(const std::vector<NodeId>& nodes) {
+  for (const auto& node_id : nodes) {
+    if (node_id.IsZero() || node_id == kThisNodeId_)
+      continue;
+    const Distance kDistance(node_id, kTarget_);
+    auto position(std::lower_bound(shortlist_.begin(), shortlist_.end(), kDistance,
+                                   [this](const Candidate& candidate, const Distance& distance) {
+      return Distance(candidate.node_id, kTarget_) < distance;
+    }));
+    if (position != shortlist_.end() && position->node_id == node_id)
+      continue;
+    shortlist_.insert(position, Candidate(node_id));
+  }
+  // Candidates far enough out never to be queried are dropped, keeping those in flight so that
+  // their answers are still accounted for.
+  const size_t kMaxShortlistSize(4 * static_cast<size_t>(kK_));
+  for (size_t index(shortlist_.size()); index > kMaxShortlistSize; --index) {
+    if (shortlist_[index - 1].state != State::kInFlight)
+      shortlist_.erase(shortlist_.begin() + (index - 1));
+  }
+}
+
+std::vector<NodeId> IterativeLookup::NextQueries(std::chrono::steady_clock::time_point now) {
+  std::vector<NodeId> queries;
+  size_t live(0);
+  for (auto& candidate : shortlist_) {
+    if (in_flight_ >= kAlpha_ || live == kK_)
+      break;
+    if (candidate.state == State::kFailed)
+      continue;
+    ++live;
+    if (candidate.state != State::kNotQueried)
+      continue;
+    candidate.state = State::kInFlight;
+    candidate.sent = now;
+    ++in_flight_;
+    queries.push_back(candidate.node_id);
+  }
+  return queries;
+}
+
+void IterativeLookup::HandleResponse(const NodeId& peer, const std::vector<NodeId>& nodes) {
+  auto found(std::find_if(shortlist_.begin(), shortlist_.end(),
+                          [&peer](const Candidate& candidate) {
+    return candidate.node_id == peer;
+  }));
+  if (found != shortlist_.end()) {
+    if (found->state == State::kInFlight)
+      --in_flight_;
+    found->state = State::kAnswered;
+  }
+  AddCandidates(nodes);
+}
+
+void IterativeLookup::ExpireQueries(std::chrono::steady_clock::time_point deadline) {
+  for (auto& candidate : shortlist_) {
+    if (candidate.state == State::kInFlight && candidate.sent < deadline) {
+      candidate.state = State::kFailed;
+      --in_flight_;
+    }
+  }
+}
+
+bool IterativeLookup::Done() const {
+  size_t answered(0);
+  for (const auto& candidate : shortlist_) {
+    if (candidate.state == State::kFailed)
+      continue;
+    if (candidate.state != State::kAnswered)
+      return false;
+    if (++answered == kK_)
+      return true;
+  }
+  return !shortlist_.empty() && in_flight_ == 0;
+}
+
+std::vector<NodeId> IterativeLookup::Closest() const {
+  std::vector<NodeId> closest;
+  for (const auto& candidate : shortlist_) {
+    if (closest.size() == kK_)
+      break;
+    if (candidate.state != State::kFailed)
+      closest.push_back(candidate.node_id);
+  }
+  return closest;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
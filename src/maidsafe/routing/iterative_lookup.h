@@ -0,0 +1,82 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ITERATIVE_LOOKUP_H_
+#define MAIDSAFE_ROUTING_ITERATIVE_LOOKUP_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The state of a Kademlia-style iterative lookup for the nodes closest to a target.  Up to |alpha|
+// FindNodes queries are kept in flight to the closest candidates not yet asked, each response is
+// merged into a shortlist held in order of distance from the target, and the lookup is done once
+// the |k| closest live candidates have all answered.  Not thread-safe.
+class IterativeLookup {
+ public:
+  IterativeLookup(const NodeId& target, const NodeId& this_node_id, uint16_t k, uint16_t alpha);
+  // Adds any of |nodes| not already held, other than this node, to the shortlist.
+  void AddCandidates(const std::vector<NodeId>& nodes);
+  // Returns the candidates to query now, closest first, enough to bring the queries in flight up
+  // to alpha, and marks them as in flight.
+  std::vector<NodeId> NextQueries(std::chrono::steady_clock::time_point now);
+  // Records |peer|'s answer and merges |nodes| into the shortlist.  An answer from a peer which
+  // was never queried is merged all the same.
+  void HandleResponse(const NodeId& peer, const std::vector<NodeId>& nodes);
+  // Fails the queries sent before |deadline| which are still unanswered.
+  void ExpireQueries(std::chrono::steady_clock::time_point deadline);
+  // False until at least one candidate is known.
+  bool Done() const;
+  size_t in_flight() const { return in_flight_; }
+  // The live candidates, closest first, up to k of them.
+  std::vector<NodeId> Closest() const;
+  const NodeId& target() const { return kTarget_; }
+
+ private:
+  enum class State {
+    kNotQueried,
+    kInFlight,
+    kAnswered,
+    kFailed
+  };
+  struct Candidate {
+    explicit Candidate(const NodeId& node_id_in)
+        : node_id(node_id_in), state(State::kNotQueried), sent() {}
+    NodeId node_id;
+    State state;
+    std::chrono::steady_clock::time_point sent;
+  };
+
+  const NodeId kTarget_, kThisNodeId_;
+  const uint16_t kK_, kAlpha_;
+  // Held closest to kTarget_ first
+  std::vector<Candidate> shortlist_;
+  size_t in_flight_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ITERATIVE_LOOKUP_H_
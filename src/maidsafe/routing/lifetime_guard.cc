@@ -0,0 +1,67 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/lifetime_guard.h"
+
+#include <algorithm>
+
+namespace maidsafe {
+
+namespace routing {
+
+LifetimeGuard::LifetimeGuard() : state_(std::make_shared<State>()) {}
+
+LifetimeGuard::~LifetimeGuard() { Revoke(); }
+
+void LifetimeGuard::Revoke() {
+  const std::thread::id kThisThread(std::this_thread::get_id());
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->alive = false;
+  // Handlers running on this thread are those Revoke was called from, so can't be waited for.
+  state_->cond_var.wait(lock, [this, kThisThread] {
+    return std::all_of(state_->running.begin(), state_->running.end(),
+                       [kThisThread](const std::thread::id& id) { return id == kThisThread; });
+  });
+}
+
+bool LifetimeGuard::alive() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->alive;
+}
+
+bool LifetimeGuard::Enter(State& state) {
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.alive)
+    return false;
+  state.running.push_back(std::this_thread::get_id());
+  return true;
+}
+
+void LifetimeGuard::Exit(State& state) {
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto itr(std::find(state.running.begin(), state.running.end(), std::this_thread::get_id()));
+    if (itr != state.running.end())
+      state.running.erase(itr);
+  }
+  state.cond_var.notify_all();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
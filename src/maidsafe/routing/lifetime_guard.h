@@ -0,0 +1,95 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_LIFETIME_GUARD_H_
+#define MAIDSAFE_ROUTING_LIFETIME_GUARD_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Lets handlers posted to an asio service which may be shared, and so outlive their owner, act
+// on that owner only while it is alive.  A handler wrapped by Wrap does nothing once Revoke has
+// been called, and Revoke waits for wrapped handlers already running on other threads to return.
+class LifetimeGuard {
+ private:
+  struct State {
+    State() : mutex(), cond_var(), alive(true), running() {}
+    std::mutex mutex;
+    std::condition_variable cond_var;
+    bool alive;
+    std::vector<std::thread::id> running;  // one entry per wrapped handler running
+  };
+
+ public:
+  template <typename Handler>
+  class Wrapped {
+   public:
+    Wrapped(std::weak_ptr<State> state, Handler handler)
+        : state_(std::move(state)), handler_(std::move(handler)) {}
+    template <typename... Args>
+    void operator()(Args&&... args) const {
+      std::shared_ptr<State> state(state_.lock());
+      if (!state || !Enter(*state))
+        return;
+      struct ExitGuard {
+        ~ExitGuard() { Exit(state); }
+        State& state;
+      } exit_guard = {*state};
+      handler_(std::forward<Args>(args)...);
+    }
+
+   private:
+    std::weak_ptr<State> state_;
+    Handler handler_;
+  };
+
+  LifetimeGuard();
+  // Revokes.
+  ~LifetimeGuard();
+  // Safe to call more than once, and from within a wrapped handler.
+  void Revoke();
+  bool alive() const;
+
+  template <typename Handler>
+  Wrapped<Handler> Wrap(Handler handler) const {
+    return Wrapped<Handler>(state_, std::move(handler));
+  }
+
+ private:
+  LifetimeGuard(const LifetimeGuard&);
+  LifetimeGuard& operator=(const LifetimeGuard&);
+
+  static bool Enter(State& state);
+  static void Exit(State& state);
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_LIFETIME_GUARD_H_
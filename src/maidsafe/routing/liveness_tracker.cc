@@ -0,0 +1,109 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/liveness_tracker.h"
+
+#include "maidsafe/routing/route_history.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+LivenessTracker::LivenessTracker() : mutex_(), entries_(), tags_() {}
+
+void LivenessTracker::Add(const NodeId& connection_id,
+                          std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(entries_.find(connection_id));
+  if (itr != entries_.end()) {
+    itr->second = Entry(now);
+    return;
+  }
+  entries_.insert(std::make_pair(connection_id, Entry(now)));
+  tags_[RouteHistoryTag(connection_id)] = connection_id;
+}
+
+void LivenessTracker::Remove(const NodeId& connection_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (entries_.erase(connection_id) == 0)
+    return;
+  auto itr(tags_.find(RouteHistoryTag(connection_id)));
+  if (itr != tags_.end() && itr->second == connection_id)
+    tags_.erase(itr);
+}
+
+void LivenessTracker::RecordActivity(const NodeId& connection_id,
+                                     std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(entries_.find(connection_id));
+  if (itr == entries_.end())
+    return;
+  itr->second.last_active = now;
+  itr->second.probe_outstanding = false;
+  itr->second.suspected = false;
+}
+
+void LivenessTracker::RecordActivityByTag(const std::string& tag,
+                                          std::chrono::steady_clock::time_point now) {
+  NodeId connection_id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr(tags_.find(tag));
+    if (itr == tags_.end())
+      return;
+    connection_id = itr->second;
+  }
+  RecordActivity(connection_id, now);
+}
+
+std::vector<NodeId> LivenessTracker::TakeIdle(std::chrono::steady_clock::duration idle_time,
+                                              std::chrono::steady_clock::time_point now) {
+  std::vector<NodeId> idle;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : entries_) {
+    if (entry.second.probe_outstanding || now - entry.second.last_active < idle_time)
+      continue;
+    entry.second.probe_outstanding = true;
+    entry.second.probed = now;
+    idle.push_back(entry.first);
+  }
+  return idle;
+}
+
+std::vector<NodeId> LivenessTracker::TakeSuspected(
+    std::chrono::steady_clock::duration probe_timeout, std::chrono::steady_clock::time_point now) {
+  std::vector<NodeId> suspected;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : entries_) {
+    if (!entry.second.probe_outstanding || entry.second.suspected ||
+        now - entry.second.probed < probe_timeout)
+      continue;
+    entry.second.suspected = true;
+    suspected.push_back(entry.first);
+  }
+  return suspected;
+}
+
+size_t LivenessTracker::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
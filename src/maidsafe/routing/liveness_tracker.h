@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_LIVENESS_TRACKER_H_
+#define MAIDSAFE_ROUTING_LIVENESS_TRACKER_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// When each connection was last seen alive, from sends rudp confirmed and messages received from
+// it.  Busy connections need nothing more; idle ones are probed, and one which stays silent after
+// its probe is suspected dead well before rudp's keepalives would give up on it.
+class LivenessTracker {
+ public:
+  LivenessTracker();
+  void Add(const NodeId& connection_id, std::chrono::steady_clock::time_point now);
+  void Remove(const NodeId& connection_id);
+  // A no-op for connections not added.
+  void RecordActivity(const NodeId& connection_id, std::chrono::steady_clock::time_point now);
+  // As above, for the connection whose ID gives route history tag |tag|.
+  void RecordActivityByTag(const std::string& tag, std::chrono::steady_clock::time_point now);
+  // Returns the connections idle for at least |idle_time| which haven't been probed since they
+  // were last active, marking them probed at |now|.
+  std::vector<NodeId> TakeIdle(std::chrono::steady_clock::duration idle_time,
+                               std::chrono::steady_clock::time_point now);
+  // Returns the connections silent for at least |probe_timeout| since being probed.  Each is
+  // returned once, until it's active again.
+  std::vector<NodeId> TakeSuspected(std::chrono::steady_clock::duration probe_timeout,
+                                    std::chrono::steady_clock::time_point now);
+  size_t size() const;
+
+ private:
+  struct Entry {
+    explicit Entry(std::chrono::steady_clock::time_point now)
+        : last_active(now), probed(), probe_outstanding(false), suspected(false) {}
+    std::chrono::steady_clock::time_point last_active, probed;
+    bool probe_outstanding, suspected;
+  };
+
+  LivenessTracker(const LivenessTracker&);
+  LivenessTracker& operator=(const LivenessTracker&);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<NodeId, Entry, NodeIdHash> entries_;
+  // Route history tags to the connection IDs giving them
+  std::unordered_map<std::string, NodeId> tags_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_LIVENESS_TRACKER_H_
@@ -18,9 +18,12 @@
 
 #include "maidsafe/routing/matrix_change.h"
 
+#include <functional>
+#include <future>
 #include <limits>
 #include <utility>
 
+#include "maidsafe/routing/distance.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/utils.h"
 
@@ -28,101 +31,168 @@ namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+std::vector<NodeId> SortedFrom(const NodeId& node_id, std::vector<NodeId> node_ids) {
+  if (!std::is_sorted(std::begin(node_ids), std::end(node_ids),
+                      [&node_id](const NodeId& lhs, const NodeId& rhs) {
+                        return CloserToTarget(lhs, rhs, node_id);
+                      }))
+    SortByDistance(node_ids, node_id);
+  return node_ids;
+}
+
+size_t CommonPrefixLength(const NodeId& lhs, const NodeId& rhs) {
+  if (lhs == rhs)
+    return NodeId::kSize * 8;
+  return NodeId::kSize * 8 - 1 - static_cast<size_t>(Distance(lhs, rhs).HighestBit());
+}
+
+// Copies to |candidates| the nodes of |matrix| inside the smallest subtree around |target| which
+// holds at least |count| of them.  Every node inside the subtree is closer to |target| than every
+// node outside it, and this stays true for any target sharing one more leading bit with |target|
+// than the subtree's prefix, so the returned prefix length is how much a later target must share
+// with |target| to reuse |candidates|.
+size_t SelectHolderCandidates(const std::vector<NodeId>& matrix, const NodeId& target,
+                              size_t count, std::vector<NodeId>& candidates) {
+  candidates.clear();
+  if (matrix.size() <= count) {
+    candidates = matrix;
+    return 0;
+  }
+  std::vector<size_t> prefix_lengths;
+  prefix_lengths.reserve(matrix.size());
+  for (const auto& node_id : matrix)
+    prefix_lengths.push_back(CommonPrefixLength(node_id, target));
+  std::vector<size_t> sorted_lengths(prefix_lengths);
+  std::nth_element(std::begin(sorted_lengths), std::begin(sorted_lengths) + (count - 1),
+                   std::end(sorted_lengths), std::greater<size_t>());
+  size_t subtree_prefix(sorted_lengths[count - 1]);
+  for (size_t index(0); index != matrix.size(); ++index) {
+    if (prefix_lengths[index] >= subtree_prefix)
+      candidates.push_back(matrix[index]);
+  }
+  return subtree_prefix + 1;
+}
+
+}  // unnamed namespace
+
 MatrixChange::MatrixChange()
-    : node_id_(),
-      old_matrix_(),
-      new_matrix_(),
-      lost_nodes_(),
-      new_nodes_(),
-      radius_() {}
+    : node_id_(), old_matrix_(), new_matrix_(), derived_(new Derived) {}
 
 MatrixChange::MatrixChange(const MatrixChange& other)
     : node_id_(other.node_id_),
       old_matrix_(other.old_matrix_),
       new_matrix_(other.new_matrix_),
-      lost_nodes_(other.lost_nodes_),
-      new_nodes_(other.new_nodes_),
-      radius_(other.radius_) {}
+      derived_(new Derived) {}
 
 MatrixChange::MatrixChange(MatrixChange&& other)
     : node_id_(std::move(other.node_id_)),
       old_matrix_(std::move(other.old_matrix_)),
       new_matrix_(std::move(other.new_matrix_)),
-      lost_nodes_(std::move(other.lost_nodes_)),
-      new_nodes_(std::move(other.new_nodes_)),
-      radius_(std::move(other.radius_)) {}
+      derived_(std::move(other.derived_)) {
+  other.derived_.reset(new Derived);
+}
 
 MatrixChange& MatrixChange::operator=(MatrixChange other) {
   swap(*this, other);
   return *this;
 }
 
-MatrixChange::MatrixChange(NodeId this_node_id, const std::vector<NodeId>& old_matrix,
-                           const std::vector<NodeId>& new_matrix)
+MatrixChange::MatrixChange(NodeId this_node_id, std::vector<NodeId> old_matrix,
+                           std::vector<NodeId> new_matrix)
     : node_id_(std::move(this_node_id)),
-      old_matrix_([this](std::vector<NodeId> old_matrix_in)->std::vector<NodeId> {
-        std::sort(std::begin(old_matrix_in), std::end(old_matrix_in),
-                  [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return old_matrix_in;
-      }(old_matrix)),
-      new_matrix_([this](std::vector<NodeId> new_matrix_in)->std::vector<NodeId> {
-        std::sort(std::begin(new_matrix_in), std::end(new_matrix_in),
-                  [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return new_matrix_in;
-      }(new_matrix)),
-      lost_nodes_([this]()->std::vector<NodeId> {
-        std::vector<NodeId> lost_nodes;
-        std::set_difference(std::begin(old_matrix_), std::end(old_matrix_), std::begin(new_matrix_),
-                            std::end(new_matrix_), std::back_inserter(lost_nodes),
-                            [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return lost_nodes;
-      }()),
-      new_nodes_([this]()->std::vector<NodeId> {
-        std::vector<NodeId> new_nodes;
-        std::set_difference(std::begin(new_matrix_), std::end(new_matrix_), std::begin(old_matrix_),
-                            std::end(old_matrix_), std::back_inserter(new_nodes),
-                            [this](const NodeId & lhs, const NodeId & rhs) {
-          return NodeId::CloserToTarget(lhs, rhs, node_id_);
-        });
-        return new_nodes;
-      }()),
-      radius_([this]()->crypto::BigInt {
-        NodeId fcn_distance;
-        if (new_matrix_.size() >= Parameters::closest_nodes_size)
-          fcn_distance = node_id_ ^ new_matrix_[Parameters::closest_nodes_size - 1];
-        else
-          fcn_distance = node_id_ ^ (NodeId(NodeId::kMaxId));  // FIXME
-        return (crypto::BigInt(
-                    (fcn_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-                Parameters::proximity_factor);
-      }()) {}
+      old_matrix_(SortedFrom(node_id_, std::move(old_matrix))),
+      new_matrix_(SortedFrom(node_id_, std::move(new_matrix))),
+      derived_(new Derived) {}
+
+const MatrixChange::Derived& MatrixChange::GetDerived() const {
+  std::call_once(derived_->once, [this] {
+    // Both matrices are ordered by distance from node_id_, so one merge pass finds the nodes
+    // which are only in one of them.
+    auto old_itr(std::begin(old_matrix_)), new_itr(std::begin(new_matrix_));
+    while (old_itr != std::end(old_matrix_) || new_itr != std::end(new_matrix_)) {
+      if (new_itr == std::end(new_matrix_) ||
+          (old_itr != std::end(old_matrix_) && CloserToTarget(*old_itr, *new_itr, node_id_))) {
+        derived_->lost_nodes.push_back(*old_itr++);
+      } else if (old_itr == std::end(old_matrix_) || *old_itr != *new_itr) {
+        derived_->new_nodes.push_back(*new_itr++);
+      } else {
+        ++old_itr;
+        ++new_itr;
+      }
+    }
+    if (new_matrix_.size() >= Parameters::closest_nodes_size) {
+      derived_->radius = DistanceUint(node_id_, new_matrix_[Parameters::closest_nodes_size - 1]) *
+                         Parameters::proximity_factor;
+    } else {
+      derived_->radius = DistanceUint(node_id_, NodeId(NodeId::kMaxId)) *  // FIXME
+                         Parameters::proximity_factor;
+    }
+  });
+  return *derived_;
+}
+
+const std::vector<NodeId>& MatrixChange::lost_nodes() const { return GetDerived().lost_nodes; }
+
+const std::vector<NodeId>& MatrixChange::new_nodes() const { return GetDerived().new_nodes; }
 
 CheckHoldersResult MatrixChange::CheckHolders(const NodeId& target) const {
+  return CheckHoldersAmong(target, old_matrix_, new_matrix_);
+}
+
+std::vector<CheckHoldersResult> MatrixChange::CheckHolders(const std::vector<NodeId>& targets,
+                                                           unsigned int thread_count) const {
+  std::vector<CheckHoldersResult> results(targets.size());
+  auto check_run([&](size_t begin, size_t end) {
+    HolderCandidates candidates;
+    for (size_t index(begin); index != end; ++index)
+      results[index] = CheckHolders(targets[index], candidates);
+  });
+  // Each run restarts its candidate selection, so runs shorter than this gain little from a thread
+  const size_t kMinRunSize(256);
+  size_t run_count(std::max(static_cast<size_t>(1),
+                            std::min(static_cast<size_t>(thread_count),
+                                     targets.size() / kMinRunSize)));
+  size_t run_size((targets.size() + run_count - 1) / run_count);
+  std::vector<std::future<void>> runs;
+  for (size_t begin(run_size); begin < targets.size(); begin += run_size) {
+    runs.push_back(std::async(std::launch::async, check_run, begin,
+                              std::min(begin + run_size, targets.size())));
+  }
+  check_run(0, std::min(run_size, targets.size()));
+  for (auto& run : runs)
+    run.get();
+  return results;
+}
+
+CheckHoldersResult MatrixChange::CheckHolders(const NodeId& target,
+                                              HolderCandidates& candidates) const {
+  const size_t kHoldersSize(Parameters::group_size + 1U);
+  size_t shared_prefix(candidates.valid ? CommonPrefixLength(target, candidates.last_target) : 0);
+  if (!candidates.valid || shared_prefix < candidates.old_reuse_prefix)
+    candidates.old_reuse_prefix =
+        SelectHolderCandidates(old_matrix_, target, kHoldersSize, candidates.old_candidates);
+  if (!candidates.valid || shared_prefix < candidates.new_reuse_prefix)
+    candidates.new_reuse_prefix =
+        SelectHolderCandidates(new_matrix_, target, kHoldersSize, candidates.new_candidates);
+  candidates.valid = true;
+  candidates.last_target = target;
+  return CheckHoldersAmong(target, candidates.old_candidates, candidates.new_candidates);
+}
+
+CheckHoldersResult MatrixChange::CheckHoldersAmong(const NodeId& target,
+                                                   std::vector<NodeId> old_holders,
+                                                   std::vector<NodeId> new_holders) const {
   // Handle cases of lower number of group matrix nodes
   size_t group_size_adjust(Parameters::group_size + 1U);
-  size_t old_holders_size = std::min(old_matrix_.size(), group_size_adjust);
-  size_t new_holders_size = std::min(new_matrix_.size(), group_size_adjust);
+  size_t old_holders_size = std::min(old_holders.size(), group_size_adjust);
+  size_t new_holders_size = std::min(new_holders.size(), group_size_adjust);
 
-  std::vector<NodeId> old_holders(old_holders_size), new_holders(new_holders_size),
-      lost_nodes(lost_nodes_);
-  std::partial_sort_copy(std::begin(old_matrix_), std::end(old_matrix_), std::begin(old_holders),
-                         std::end(old_holders), [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
-  std::partial_sort_copy(std::begin(new_matrix_), std::end(new_matrix_), std::begin(new_holders),
-                         std::end(new_holders), [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
-  std::sort(std::begin(lost_nodes), std::end(lost_nodes),
-            [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
+  PartialSortByDistance(old_holders, target, old_holders_size);
+  old_holders.resize(old_holders_size);
+  PartialSortByDistance(new_holders, target, new_holders_size);
+  new_holders.resize(new_holders_size);
 
   // Remove target == node ids and adjust holder size
   old_holders.erase(std::remove(std::begin(old_holders), std::end(old_holders), target),
@@ -137,21 +207,19 @@ CheckHoldersResult MatrixChange::CheckHolders(const NodeId& target) const {
     new_holders.resize(Parameters::group_size);
     assert(new_holders.size() == Parameters::group_size);
   }
-  lost_nodes.erase(std::remove(std::begin(lost_nodes), std::end(lost_nodes), target),
-                   std::end(lost_nodes));
 
   CheckHoldersResult holders_result;
   holders_result.proximity_status =
-      GetProximalRange(target, node_id_, node_id_, radius_, new_holders);
+      GetProximalRange(target, node_id_, node_id_, GetDerived().radius, new_holders);
   // Only return holders if this node is part of target group
   if (GroupRangeStatus::kInRange != holders_result.proximity_status)
     return holders_result;
 
-  // Old holders = Old holder ∩ Lost nodes
-  std::set_intersection(std::begin(old_holders), std::end(old_holders), std::begin(lost_nodes),
-                        std::end(lost_nodes), std::back_inserter(holders_result.old_holders),
-                        [target](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
+  // Old holders = Old holder ∩ Lost nodes, in order of distance to target
+  std::copy_if(std::begin(old_holders), std::end(old_holders),
+               std::back_inserter(holders_result.old_holders), [this](const NodeId& old_holder) {
+    return std::find(std::begin(lost_nodes()), std::end(lost_nodes()), old_holder) !=
+           std::end(lost_nodes());
   });
 
   // New holders = All new holders - Old holders
@@ -178,11 +246,9 @@ NodeId MatrixChange::ChoosePmidNode(const std::set<NodeId>& online_pmids,
 
   // In case storing to PublicPmid, the data shall not be stored on the Vault itself
   // However, the vault will appear in DM's routing table and affect result
-  std::vector<NodeId> temp(Parameters::group_size + 1);
-  std::partial_sort_copy(std::begin(new_matrix_), std::end(new_matrix_), std::begin(temp),
-                         std::end(temp), [&target](const NodeId& lhs, const NodeId& rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, target);
-  });
+  std::vector<NodeId> temp(new_matrix_);
+  PartialSortByDistance(temp, target, Parameters::group_size + 1);
+  temp.resize(Parameters::group_size + 1);
 
   LOG(kInfo) << "MatrixChange::ChoosePmidNode own id : "
                 << HexSubstr(node_id_.string()) << " and closest+1 to the target are : ";
@@ -214,8 +280,7 @@ void swap(MatrixChange& lhs, MatrixChange& rhs) MAIDSAFE_NOEXCEPT {
   swap(lhs.node_id_, rhs.node_id_);
   swap(lhs.old_matrix_, rhs.old_matrix_);
   swap(lhs.new_matrix_, rhs.new_matrix_);
-  swap(lhs.lost_nodes_, rhs.lost_nodes_);
-  swap(lhs.radius_, rhs.radius_);
+  swap(lhs.derived_, rhs.derived_);
 }
 
 void MatrixChange::Print() {
@@ -229,11 +294,11 @@ void MatrixChange::Print() {
     output.append("\n" + tab + tab+ "entry in new_matrix" + tab + "------" + tab + DebugId(entry));
   output.append("\nMatrix of Node " + DebugId(node_id_) +
                 " having following entries in lost_nodes_ :");
-  for (auto entry : lost_nodes_)
+  for (auto entry : lost_nodes())
     output.append("\n" + tab + tab+ "entry in lost_nodes" + tab + "------" + tab + DebugId(entry));
   output.append("\nMatrix of Node " + DebugId(node_id_) +
                 " having following entries in new_nodes_ :");
-  for (auto entry : new_nodes_)
+  for (auto entry : new_nodes())
     output.append("\n" + tab + tab+ "entry in new_nodes" + tab + "------" + tab + DebugId(entry));
   LOG(kInfo) << output;
 }
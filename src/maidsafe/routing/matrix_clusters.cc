@@ -0,0 +1,123 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/matrix_clusters.h"
+
+#include <algorithm>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+bool Bit(const std::string& id, size_t index) {
+  return (static_cast<unsigned char>(id[index / 8]) & (0x80 >> (index % 8))) != 0;
+}
+
+// Appends the clusters of the sorted range [first, last), all of whose nodes start with |prefix|.
+void Divide(std::vector<NodeId>::const_iterator first, std::vector<NodeId>::const_iterator last,
+            std::string& prefix, uint16_t prefix_bits, const std::set<std::string>& expanded,
+            std::vector<MatrixCluster>& clusters) {
+  if (first == last)
+    return;
+  if (std::distance(first, last) == 1 || prefix.size() == NodeId::kSize * 8 ||
+      (prefix.size() >= prefix_bits && expanded.count(prefix) == 0)) {
+    MatrixCluster cluster;
+    cluster.prefix = prefix;
+    cluster.nodes.assign(first, last);
+    clusters.push_back(cluster);
+    return;
+  }
+  // Sorted IDs with the next bit clear all come before those with it set.
+  const size_t kBit(prefix.size());
+  auto middle(std::partition_point(first, last, [kBit](const NodeId& node_id) {
+    return !Bit(node_id.string(), kBit);
+  }));
+  prefix.push_back('0');
+  Divide(first, middle, prefix, prefix_bits, expanded, clusters);
+  prefix.back() = '1';
+  Divide(middle, last, prefix, prefix_bits, expanded, clusters);
+  prefix.pop_back();
+}
+
+}  // unnamed namespace
+
+bool HasPrefix(const NodeId& node_id, const std::string& prefix) {
+  const std::string kId(node_id.string());
+  if (prefix.size() > kId.size() * 8)
+    return false;
+  for (size_t i(0); i != prefix.size(); ++i) {
+    if (Bit(kId, i) != (prefix[i] == '1'))
+      return false;
+  }
+  return true;
+}
+
+uint16_t ClusterPrefixBits(size_t node_count, size_t cluster_size) {
+  uint16_t prefix_bits(0);
+  while (prefix_bits < NodeId::kSize * 8 && cluster_size != 0 &&
+         (node_count >> prefix_bits) > cluster_size) {
+    ++prefix_bits;
+  }
+  return prefix_bits;
+}
+
+std::vector<MatrixCluster> ClusterMatrix(const MatrixModel& model, uint16_t prefix_bits,
+                                         const std::set<std::string>& expanded) {
+  const std::vector<NodeId> kNodes(model.Nodes());
+  std::vector<MatrixCluster> clusters;
+  std::string prefix;
+  Divide(kNodes.begin(), kNodes.end(), prefix, prefix_bits, expanded, clusters);
+
+  // A peer's cluster is the one whose prefix starts its ID.  There are few distinct prefix lengths,
+  // so each is tried in turn.
+  std::set<size_t> prefix_sizes;
+  for (const auto& cluster : clusters)
+    prefix_sizes.insert(cluster.prefix.size());
+  std::map<std::string, size_t> cluster_of_prefix;
+  for (size_t i(0); i != clusters.size(); ++i)
+    cluster_of_prefix[clusters[i].prefix] = i;
+  auto find_cluster([&](const NodeId& peer)->const MatrixCluster* {
+    std::string bits;
+    const std::string kId(peer.string());
+    for (size_t size : prefix_sizes) {
+      while (bits.size() < size)
+        bits.push_back(Bit(kId, bits.size()) ? '1' : '0');
+      auto itr(cluster_of_prefix.find(bits));
+      if (itr != cluster_of_prefix.end())
+        return &clusters[itr->second];
+    }
+    return nullptr;
+  });
+
+  for (auto& cluster : clusters) {
+    for (const auto& node_id : cluster.nodes) {
+      for (const auto& peer : model.Row(node_id)) {
+        const MatrixCluster* peer_cluster(find_cluster(peer.first));
+        if (peer_cluster && peer_cluster != &cluster)
+          ++cluster.links[peer_cluster->prefix];
+      }
+    }
+  }
+  return clusters;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,219 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/matrix_update.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Serialised as a flag byte (kSnapshotFlag and kLeftFlag), the node ID, the sequence number as a
+// little-endian uint64, then the changed peers and the removed ones, each list a little-endian
+// uint32 count followed by its IDs, every changed peer's followed by its ChildType byte.
+const uint8_t kSnapshotFlag(1);
+const uint8_t kLeftFlag(2);
+
+void AppendUint(uint64_t value, size_t bytes, std::string& output) {
+  for (size_t i(0); i != bytes; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+bool ReadUint(const std::string& input, size_t bytes, size_t& position, uint64_t& value) {
+  if (input.size() - position < bytes)
+    return false;
+  value = 0;
+  for (size_t i(0); i != bytes; ++i)
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(input[position + i])) << (8 * i);
+  position += bytes;
+  return true;
+}
+
+bool ReadNodeId(const std::string& input, size_t& position, NodeId& node_id) {
+  if (input.size() - position < NodeId::kSize)
+    return false;
+  node_id = NodeId(input.substr(position, NodeId::kSize));
+  position += NodeId::kSize;
+  return true;
+}
+
+bool IsChildType(uint64_t value) {
+  return value == static_cast<uint64_t>(network_viewer::ChildType::kMatrix) ||
+         value == static_cast<uint64_t>(network_viewer::ChildType::kGroup) ||
+         value == static_cast<uint64_t>(network_viewer::ChildType::kClosest);
+}
+
+}  // unnamed namespace
+
+const char kMatrixUpdateQueueName[] = "maidsafe_routing_matrix_updates";
+
+MatrixUpdate::MatrixUpdate()
+    : node_id(), sequence(0), snapshot(false), left(false), changed(), removed() {}
+
+std::string MatrixUpdate::Serialise() const {
+  std::string serialised;
+  serialised.reserve(1 + NodeId::kSize + 8 + 4 + changed.size() * (NodeId::kSize + 1) + 4 +
+                     removed.size() * NodeId::kSize);
+  serialised.push_back(static_cast<char>((snapshot ? kSnapshotFlag : 0) | (left ? kLeftFlag : 0)));
+  serialised += node_id.string();
+  AppendUint(sequence, 8, serialised);
+  AppendUint(changed.size(), 4, serialised);
+  for (const auto& peer : changed) {
+    serialised += peer.first.string();
+    serialised.push_back(static_cast<char>(peer.second));
+  }
+  AppendUint(removed.size(), 4, serialised);
+  for (const auto& peer : removed)
+    serialised += peer.string();
+  return serialised;
+}
+
+bool MatrixUpdate::Parse(const std::string& serialised, MatrixUpdate& update) {
+  size_t position(0);
+  uint64_t value(0);
+  if (!ReadUint(serialised, 1, position, value) ||
+      (value & ~uint64_t(kSnapshotFlag | kLeftFlag)) != 0) {
+    return false;
+  }
+  update.snapshot = (value & kSnapshotFlag) != 0;
+  update.left = (value & kLeftFlag) != 0;
+  if (!ReadNodeId(serialised, position, update.node_id) ||
+      !ReadUint(serialised, 8, position, update.sequence) ||
+      !ReadUint(serialised, 4, position, value)) {
+    return false;
+  }
+  update.changed.clear();
+  for (uint64_t i(0); i != value; ++i) {
+    NodeId peer;
+    uint64_t type(0);
+    if (!ReadNodeId(serialised, position, peer) || !ReadUint(serialised, 1, position, type) ||
+        !IsChildType(type)) {
+      return false;
+    }
+    update.changed.emplace_back(peer, static_cast<network_viewer::ChildType>(type));
+  }
+  if (!ReadUint(serialised, 4, position, value))
+    return false;
+  update.removed.clear();
+  for (uint64_t i(0); i != value; ++i) {
+    NodeId peer;
+    if (!ReadNodeId(serialised, position, peer))
+      return false;
+    update.removed.push_back(peer);
+  }
+  return position == serialised.size();
+}
+
+MatrixUpdate DiffMatrixRows(const NodeId& node_id, uint64_t sequence, const MatrixRow& previous,
+                            const MatrixRow& current) {
+  MatrixUpdate update;
+  update.node_id = node_id;
+  update.sequence = sequence;
+  // Both rows are sorted by peer ID, so one merge pass finds every difference.
+  auto previous_itr(previous.begin());
+  auto current_itr(current.begin());
+  while (previous_itr != previous.end() || current_itr != current.end()) {
+    if (current_itr == current.end() ||
+        (previous_itr != previous.end() && previous_itr->first < current_itr->first)) {
+      update.removed.push_back((previous_itr++)->first);
+    } else if (previous_itr == previous.end() || current_itr->first < previous_itr->first) {
+      update.changed.push_back(*current_itr++);
+    } else {
+      if (previous_itr->second != current_itr->second)
+        update.changed.push_back(*current_itr);
+      ++previous_itr;
+      ++current_itr;
+    }
+  }
+  return update;
+}
+
+MatrixUpdate SnapshotMatrixRow(const NodeId& node_id, uint64_t sequence, const MatrixRow& row) {
+  MatrixUpdate update;
+  update.node_id = node_id;
+  update.sequence = sequence;
+  update.snapshot = true;
+  update.changed.assign(row.begin(), row.end());
+  return update;
+}
+
+MatrixUpdate LeftMatrixUpdate(const NodeId& node_id, uint64_t sequence) {
+  MatrixUpdate update;
+  update.node_id = node_id;
+  update.sequence = sequence;
+  update.left = true;
+  return update;
+}
+
+MatrixModel::MatrixModel() : entries_(), version_(0) {}
+
+MatrixModel::ApplyResult MatrixModel::Apply(const MatrixUpdate& update) {
+  auto itr(entries_.find(update.node_id));
+  if (update.left) {
+    if (itr == entries_.end())
+      return ApplyResult::kIgnored;
+    entries_.erase(itr);
+    ++version_;
+    return ApplyResult::kRemoved;
+  }
+  if (update.snapshot) {
+    // A restarted node numbers its updates from 1 again, so snapshots are taken even if older.
+    bool added(itr == entries_.end());
+    Entry& entry(entries_[update.node_id]);
+    entry.sequence = update.sequence;
+    entry.synchronised = true;
+    entry.row = MatrixRow(update.changed.begin(), update.changed.end());
+    ++version_;
+    return added ? ApplyResult::kAdded : ApplyResult::kApplied;
+  }
+
+  if (itr == entries_.end() || !itr->second.synchronised ||
+      update.sequence <= itr->second.sequence) {
+    return ApplyResult::kIgnored;
+  }
+  Entry& entry(itr->second);
+  if (update.sequence != entry.sequence + 1) {
+    entry.synchronised = false;
+    return ApplyResult::kIgnored;
+  }
+  entry.sequence = update.sequence;
+  for (const auto& peer : update.removed)
+    entry.row.erase(peer);
+  for (const auto& peer : update.changed)
+    entry.row[peer.first] = peer.second;
+  ++version_;
+  return ApplyResult::kApplied;
+}
+
+std::vector<NodeId> MatrixModel::Nodes() const {
+  std::vector<NodeId> nodes;
+  nodes.reserve(entries_.size());
+  for (const auto& entry : entries_)
+    nodes.push_back(entry.first);
+  return nodes;
+}
+
+MatrixRow MatrixModel::Row(const NodeId& node_id) const {
+  auto itr(entries_.find(node_id));
+  return itr == entries_.end() ? MatrixRow() : itr->second.row;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/memory_budget.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+uint64_t NodeInfoBytes(const std::vector<NodeInfo>& nodes) {
+  uint64_t bytes(ContainerBytes(nodes));
+  for (const auto& node : nodes)
+    bytes += ContainerBytes(node.dimension_list);
+  return bytes;
+}
+
+MemoryBudget::MemoryBudget(uint64_t soft_budget, uint64_t hard_budget)
+    : kSoftBudget_(soft_budget),
+      kHardBudget_(hard_budget),
+      held_bytes_(0),
+      queued_bytes_(0),
+      refused_clients_(0),
+      dropped_messages_(0),
+      cache_evictions_(0) {}
+
+bool MemoryBudget::Enqueue(uint64_t bytes, bool droppable) {
+  if (droppable && pressure() == MemoryStatistics::kHard) {
+    ++dropped_messages_;
+    return false;
+  }
+  queued_bytes_ += bytes;
+  return true;
+}
+
+void MemoryBudget::Dequeue(uint64_t bytes) { queued_bytes_ -= bytes; }
+
+bool MemoryBudget::AdmitClient() {
+  if (pressure() == MemoryStatistics::kNormal)
+    return true;
+  ++refused_clients_;
+  return false;
+}
+
+MemoryStatistics::Pressure MemoryBudget::Update(uint64_t held_bytes) {
+  held_bytes_ = held_bytes;
+  return pressure();
+}
+
+MemoryStatistics::Pressure MemoryBudget::pressure() const {
+  const uint64_t kTotal(held_bytes_ + queued_bytes_);
+  if (kHardBudget_ != 0 && kTotal >= kHardBudget_)
+    return MemoryStatistics::kHard;
+  if (kSoftBudget_ != 0 && kTotal >= kSoftBudget_)
+    return MemoryStatistics::kSoft;
+  return MemoryStatistics::kNormal;
+}
+
+void MemoryBudget::FillStatistics(MemoryStatistics& statistics) const {
+  statistics.bytes[MemoryStatistics::kInboundQueues] = queued_bytes_;
+  statistics.pressure = pressure();
+  statistics.refused_clients = refused_clients_;
+  statistics.dropped_messages = dropped_messages_;
+  statistics.cache_evictions = cache_evictions_;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,88 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MEMORY_BUDGET_H_
+#define MAIDSAFE_ROUTING_MEMORY_BUDGET_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// An RSA public key as Crypto++ holds it, with its Integers' buffers.
+const uint64_t kPublicKeyBytes(1024);
+
+// The heap bytes of a container's elements, as MemoryStatistics counts them: a vector by its
+// capacity, a hashed container by its nodes and bucket array.
+template <typename T>
+uint64_t ContainerBytes(const std::vector<T>& container) {
+  return container.capacity() * sizeof(T);
+}
+
+template <typename HashedContainer>
+uint64_t HashedContainerBytes(const HashedContainer& container) {
+  return container.size() * (sizeof(typename HashedContainer::value_type) + 2 * sizeof(void*)) +
+         container.bucket_count() * sizeof(void*);
+}
+
+// The bytes held by |nodes|, less their public keys, which are interned and counted once.
+uint64_t NodeInfoBytes(const std::vector<NodeInfo>& nodes);
+
+// Weighs the bytes routing holds against a soft and a hard budget.  Received messages are counted
+// as they join and leave the inbound queues, so that a burst is seen at once; everything else is
+// sampled periodically and handed to Update.  Either budget may be zero, disabling it.
+class MemoryBudget {
+ public:
+  MemoryBudget(uint64_t soft_budget, uint64_t hard_budget);
+  // Counts |bytes| of a received message joining an inbound queue.  Returns false, counting the
+  // message as dropped instead, if it is |droppable| and the hard budget has been reached.
+  bool Enqueue(uint64_t bytes, bool droppable);
+  // Counts |bytes| leaving an inbound queue, whether handled or not.
+  void Dequeue(uint64_t bytes);
+  // Returns false, counting a refused client, if the soft budget has been reached.
+  bool AdmitClient();
+  // Replaces the estimate of the bytes held outside the inbound queues, returning the resulting
+  // pressure.
+  MemoryStatistics::Pressure Update(uint64_t held_bytes);
+  void AddCacheEvictions(uint64_t count) { cache_evictions_ += count; }
+  MemoryStatistics::Pressure pressure() const;
+  uint64_t queued_bytes() const { return queued_bytes_; }
+  // Sets the kInboundQueues bytes, pressure and shedding counts of |statistics|.
+  void FillStatistics(MemoryStatistics& statistics) const;
+
+ private:
+  MemoryBudget(const MemoryBudget&);
+  MemoryBudget(const MemoryBudget&&);
+  MemoryBudget& operator=(const MemoryBudget&);
+
+  const uint64_t kSoftBudget_, kHardBudget_;
+  std::atomic<uint64_t> held_bytes_, queued_bytes_;
+  std::atomic<uint64_t> refused_clients_, dropped_messages_, cache_evictions_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MEMORY_BUDGET_H_
@@ -18,45 +18,129 @@
 
 #include "maidsafe/routing/message_handler.h"
 
+#include <algorithm>
+#include <set>
 #include <vector>
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/node_id.h"
 
+#include "maidsafe/routing/application_queue.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/duplicate_filter.h"
+#include "maidsafe/routing/encoded_message.h"
+#include "maidsafe/routing/group_cache.h"
 #include "maidsafe/routing/group_change_handler.h"
 #include "maidsafe/routing/message.h"
+#include "maidsafe/routing/message_traits.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/object_pool.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/path_trace.h"
+#include "maidsafe/routing/pending_requests.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_metrics.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/service.h"
+#include "maidsafe/routing/signature_verifier.h"
 #include "maidsafe/routing/remove_furthest_node.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+typedef detail::TypedMessageRecievedFunctors TypedFunctors;
+
+const std::function<void(const SingleToSingleMessage&)>& TypedFunctor(
+    const TypedFunctors& functors, const SingleToSingleMessage*) {
+  return functors.single_to_single;
+}
+
+const std::function<void(const SingleToGroupMessage&)>& TypedFunctor(
+    const TypedFunctors& functors, const SingleToGroupMessage*) {
+  return functors.single_to_group;
+}
+
+const std::function<void(const GroupToSingleMessage&)>& TypedFunctor(
+    const TypedFunctors& functors, const GroupToSingleMessage*) {
+  return functors.group_to_single;
+}
+
+const std::function<void(const GroupToGroupMessage&)>& TypedFunctor(
+    const TypedFunctors& functors, const GroupToGroupMessage*) {
+  return functors.group_to_group;
+}
+
+const std::function<void(const SingleToGroupRelayMessage&)>& TypedFunctor(
+    const TypedFunctors& functors, const SingleToGroupRelayMessage*) {
+  return functors.single_to_group_relay;
+}
+
+template <typename T>
+void DeliverTypedMessage(const TypedFunctors& functors, protobuf::Message& proto_message) {
+  const auto& functor(TypedFunctor(functors, static_cast<const T*>(nullptr)));
+  if (functor)
+    functor(ReleaseTypedMessage<T>(proto_message));
+  else
+    LOG(kWarning) << "No functor for typed message, id: " << proto_message.id();
+}
+
+typedef void (*TypedDelivery)(const TypedFunctors&, protobuf::Message&);
+
+// Indexed by detail::TypedMessageKind.
+const TypedDelivery kTypedDeliveries[detail::kTypedMessageKindCount] = {
+    &DeliverTypedMessage<SingleToSingleMessage>, &DeliverTypedMessage<SingleToGroupMessage>,
+    &DeliverTypedMessage<GroupToSingleMessage>, &DeliverTypedMessage<GroupToGroupMessage>,
+    &DeliverTypedMessage<SingleToGroupRelayMessage>};
+
+static_assert(detail::TypedMessageKind<SingleToSingleMessage>() == 0 &&
+                  detail::TypedMessageKind<SingleToGroupMessage>() == 1 &&
+                  detail::TypedMessageKind<GroupToSingleMessage>() == 2 &&
+                  detail::TypedMessageKind<GroupToGroupMessage>() == 3 &&
+                  detail::TypedMessageKind<SingleToGroupRelayMessage>() == 4,
+              "kTypedDeliveries is out of step with the message traits");
+
+}  // unnamed namespace
+
 MessageHandler::MessageHandler(RoutingTable& routing_table,
                                ClientRoutingTable& client_routing_table, NetworkUtils& network,
                                Timer<std::string>& timer, RemoveFurthestNode& remove_furthest_node,
                                GroupChangeHandler& group_change_handler,
-                               NetworkStatistics& network_statistics)
+                               NetworkStatistics& network_statistics, GroupCache& group_cache)
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       network_statistics_(network_statistics),
       network_(network),
       remove_furthest_node_(remove_furthest_node),
       group_change_handler_(group_change_handler),
+      group_cache_(group_cache),
       cache_manager_(routing_table_.client_mode()
                          ? nullptr
-                         : (new CacheManager(routing_table_.kNodeId(), network_))),
+                         : (new CacheManager(routing_table_.kNodeId(),
+                                             routing_table_.kPrivateKey(), network_, timer))),
       timer_(timer),
+      group_response_aggregator_(timer,
+                                 [this](protobuf::Message& merged) { SendResponse(merged); }),
+      stream_reassembler_(Parameters::max_stream_size,
+                          std::min(Parameters::stream_fragment_size, Parameters::max_data_size),
+                          Parameters::max_incoming_streams, Parameters::stream_reassembly_timeout),
+      stream_received_functor_(),
+      path_trace_functor_(),
+      leave_functor_(),
+      resume_functor_(),
       response_handler_(new ResponseHandler(routing_table, client_routing_table, network_,
                                             group_change_handler)),
       service_(new Service(routing_table, client_routing_table, network_)),
       message_received_functor_(),
-      typed_message_received_functors_() {}
+      typed_message_received_functors_(),
+      application_queue_(),
+      node_level_handler_() {
+  service_->set_public_key_prefetch(response_handler_->public_key_prefetch());
+}
 
 void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
   bool request(message.request());
@@ -71,7 +155,14 @@ void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
       message.request() ? service_->FindNodes(message) : response_handler_->FindNodes(message);
       break;
     case MessageType::kConnectSuccess:
-      service_->ConnectSuccess(message);
+      // The peer's side of a connect attempt this node admitted has completed.
+      if (message.has_source_id())
+        service_->EndConnectAttempt(NodeId(message.source_id()));
+      if (!response_handler_->StreamlinedConnectSuccess(message) &&
+          !response_handler_->ShortcutConnectSuccess(message))
+        service_->ConnectSuccess(message);
+      else
+        message.Clear();  // message is sent directly to the peer
       break;
     case MessageType::kConnectSuccessAcknowledgement:
       response_handler_->ConnectSuccessAcknowledgement(message);
@@ -88,13 +179,21 @@ void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
           response_handler_->AddMatrixUpdateFromUnvalidatedPeer(matrix_update.first,
                                                                 matrix_update.second);
       }
-      if (routing_table_.client_mode())
+      // cleared if it was a resync request or a delta which couldn't be applied
+      if (routing_table_.client_mode() && message.IsInitialized()) {
+        protobuf::ClosestNodesUpdate closest_nodes_update;
+        if (message.data_size() == 1 && closest_nodes_update.ParseFromString(message.data(0)))
+          group_cache_.HandleClosestNodesUpdate(closest_nodes_update);
         response_handler_->CloseNodeUpdateForClient(message);
+      }
       break;
     case MessageType::kGetGroup:
       message.request() ? service_->GetGroup(message)
                         : response_handler_->GetGroup(timer_, message);
       break;
+    case MessageType::kLeave:
+      HandleLeave(message);
+      break;
     default:  // unknown (silent drop)
       return;
   }
@@ -109,6 +208,87 @@ void MessageHandler::HandleRoutingMessage(protobuf::Message& message) {
     network_.SendToClosestNode(message);
 }
 
+void MessageHandler::SendNodeLevelReply(const protobuf::Message& request,
+                                        const std::string& reply) {
+  if (reply.empty()) {
+    LOG(kInfo) << "Empty response for message id :" << request.id();
+    return;
+  }
+  LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
+                << "] repl : " << MessageTypeString(request) << " from "
+                << HexSubstr(request.source_id()) << "   (id: " << request.id()
+                << ")  --NodeLevel Replied--";
+  protobuf::Message message_out;
+  message_out.set_request(false);
+  message_out.set_hops_to_live(Parameters::hops_to_live);
+  message_out.set_destination_id(request.source_id());
+  message_out.set_type(request.type());
+  message_out.set_direct(true);
+  message_out.clear_data();
+  message_out.set_client_node(request.client_node());
+  message_out.set_routing_message(request.routing_message());
+  message_out.add_data(reply);
+  message_out.set_request_hops(Parameters::hops_to_live - request.hops_to_live());
+  if (request.has_deadline())
+    message_out.set_deadline(request.deadline());
+  if (IsCacheableGet(request)) {
+    message_out.set_cacheable(static_cast<int32_t>(Cacheable::kPut));
+    message_out.set_cache_key(request.data(0));
+    if (cache_manager_)
+      message_out.set_popularity(cache_manager_->Popularity(request.data(0)));
+  }
+  message_out.set_last_id(routing_table_.kNodeId().string());
+  message_out.set_source_id(routing_table_.kNodeId().string());
+  message_out.set_unique_id(NewMessageId(routing_table_.kNodeId()));
+  if (Parameters::sign_node_level_messages)
+    SignMessage(message_out, routing_table_.kPrivateKey());
+  if (request.has_id())
+    message_out.set_id(request.id());
+  else
+    LOG(kInfo) << "Message to be sent back had no ID.";
+
+  if (request.has_relay_id())
+    message_out.set_relay_id(request.relay_id());
+  // The reply's hops are added to its request's, so that the requester sees the round trip.
+  if (request.has_path_trace())
+    message_out.set_path_trace(request.path_trace());
+
+  if (request.has_relay_connection_id()) {
+    message_out.set_relay_connection_id(request.relay_connection_id());
+  }
+  if (request.aggregator_id().size() == NodeId::kSize) {
+    message_out.set_aggregate_for(message_out.destination_id());
+    message_out.set_destination_id(request.aggregator_id());
+  }
+  if (routing_table_.client_mode() &&
+      routing_table_.kNodeId().string() == message_out.destination_id()) {
+    network_.SendToClosestNode(message_out);
+    return;
+  }
+  if (routing_table_.kNodeId().string() != message_out.destination_id()) {
+    network_.SendToClosestNode(message_out);
+  } else {
+    LOG(kInfo) << "Sending response to self." << " id: " << request.id();
+    HandleMessage(message_out);
+  }
+}
+
+void MessageHandler::HandleStreamFragment(protobuf::Message& message) {
+  std::string payload;
+  auto result(stream_reassembler_.Add(message.source_id(), message.stream_id(),
+                                      message.fragment_index(), message.fragment_count(),
+                                      std::move(*message.mutable_data(0)), payload));
+  if (result == StreamReassembler::Result::kRejected) {
+    LOG(kWarning) << "Rejected stream fragment " << message.fragment_index() << " of "
+                  << message.fragment_count() << " from " << HexSubstr(message.source_id());
+    return;
+  }
+  if (!message.one_way())
+    SendNodeLevelReply(message, std::to_string(message.fragment_index()));
+  if (result == StreamReassembler::Result::kComplete && stream_received_functor_)
+    stream_received_functor_(NodeId(message.source_id()), std::move(payload));
+}
+
 void MessageHandler::HandleNodeLevelMessageForThisNode(protobuf::Message& message) {
   if (IsRequest(message) &&
       !IsClientToClientMessageWithDifferentNodeIds(message, routing_table_.client_mode())) {
@@ -116,72 +296,67 @@ void MessageHandler::HandleNodeLevelMessageForThisNode(protobuf::Message& messag
                   << "] rcvd : " << MessageTypeString(message) << " from "
                   << HexSubstr(message.source_id()) << "   (id: " << message.id()
                   << ")  --NodeLevel--";
-    ReplyFunctor response_functor = [=](const std::string & reply_message) {
-      if (reply_message.empty()) {
-        LOG(kInfo) << "Empty response for message id :" << message.id();
-        return;
-      }
-      LOG(kSuccess) << " [" << DebugId(routing_table_.kNodeId())
-                    << "] repl : " << MessageTypeString(message) << " from "
-                    << HexSubstr(message.source_id()) << "   (id: " << message.id()
-                    << ")  --NodeLevel Replied--";
-      protobuf::Message message_out;
-      message_out.set_request(false);
-      message_out.set_hops_to_live(Parameters::hops_to_live);
-      message_out.set_destination_id(message.source_id());
-      message_out.set_type(message.type());
-      message_out.set_direct(true);
-      message_out.clear_data();
-      message_out.set_client_node(message.client_node());
-      message_out.set_routing_message(message.routing_message());
-      message_out.add_data(reply_message);
-      if (IsCacheableGet(message))
-        message_out.set_cacheable(static_cast<int32_t>(Cacheable::kPut));
-      message_out.set_last_id(routing_table_.kNodeId().string());
-      message_out.set_source_id(routing_table_.kNodeId().string());
-      if (message.has_id())
-        message_out.set_id(message.id());
-      else
-        LOG(kInfo) << "Message to be sent back had no ID.";
-
-      if (message.has_relay_id())
-        message_out.set_relay_id(message.relay_id());
-
-      if (message.has_relay_connection_id()) {
-        message_out.set_relay_connection_id(message.relay_connection_id());
-      }
-      if (routing_table_.client_mode() &&
-          routing_table_.kNodeId().string() == message_out.destination_id()) {
-        network_.SendToClosestNode(message_out);
-        return;
-      }
-      if (routing_table_.kNodeId().string() != message_out.destination_id()) {
-        network_.SendToClosestNode(message_out);
-      } else {
-        LOG(kInfo) << "Sending response to self." << " id: " << message.id();
-        HandleMessage(message_out);
-      }
-    };
-    if (message_received_functor_) {
-      LOG(kVerbose) << "calling message_received_functor_ " << " id: " << message.id();
-      message_received_functor_(message.data(0), response_functor);
-    } else {
+    ReportPathTrace(message);
+    if (message.has_stream_id() && message.data_size() == 1)
+      return HandleStreamFragment(message);
+    if (!message_received_functor_ && !application_queue_ && !node_level_handler_) {
       LOG(kVerbose) << "calling InvokeTypedMessageReceivedFunctor " << " id: " << message.id();
       try {
         InvokeTypedMessageReceivedFunctor(message);  // typed message received
       } catch (...) {
         LOG(kError) << "InvokeTypedMessageReceivedFunctor error";
       }
+      return;
+    }
+    ReplyFunctor response_functor;
+    if (message.one_way()) {
+      // The sender keeps no state to match a reply against, so none is sent.
+      response_functor = [](const std::string&) {};
+    } else {
+      response_functor = [=](const std::string & reply_message) {
+        SendNodeLevelReply(message, reply_message);
+      };
     }
+    if (application_queue_) {
+      ReceivedMessage received(message.data(0), std::move(response_functor));
+      if (!application_queue_->Push(received))
+        LOG(kWarning) << "Application queue full, dropping message id: " << message.id();
+      return;
+    }
+    if (node_level_handler_)
+      return node_level_handler_->MessageReceived(message.data(0), std::move(response_functor));
+    LOG(kVerbose) << "calling message_received_functor_ " << " id: " << message.id();
+    message_received_functor_(message.data(0), response_functor);
   } else if (IsResponse(message)) {                // response
     LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId())
                << "] rcvd : " << MessageTypeString(message) << " from "
                << HexSubstr(message.source_id()) << "   (id: " << message.id()
                << ")  --NodeLevel--";
+    if (message.has_aggregate_for()) {
+      if (group_response_aggregator_.Add(message))
+        return;
+      // Too late to be merged, so sent on alone
+      message.set_destination_id(message.aggregate_for());
+      message.clear_aggregate_for();
+      return SendResponse(message);
+    }
+    ReportPathTrace(message);
+    if (message.has_request_hops() && message.has_source_id())
+      routing_table_.RecordRouteHops(NodeId(message.source_id()), message.request_hops());
     try {
       if (!message.has_id() || message.data_size() != 1)
         BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
-      timer_.AddResponse(message.id(), message.data(0));
+      // A merged group reply stands for each of the group members which sent its payload.  Those
+      // whose signatures didn't check out were removed on receipt; a member is counted once.
+      std::set<std::string> senders;
+      senders.insert(message.source_id());
+      for (const auto& source_id : message.aggregated_source_ids()) {
+        if (senders.size() == Parameters::group_size)
+          break;
+        if (senders.insert(source_id).second)
+          timer_.AddResponse(message.id(), message.data(0));
+      }
+      timer_.AddResponse(message.id(), std::move(*message.mutable_data(0)));
     }
     catch (const maidsafe_error& e) {
       LOG(kError) << e.what();
@@ -200,6 +375,8 @@ void MessageHandler::HandleNodeLevelMessageForThisNode(protobuf::Message& messag
 void MessageHandler::HandleMessageForThisNode(protobuf::Message& message) {
   if (RelayDirectMessageIfNeeded(message))
     return;
+  if (message.fan_out_ids_size() != 0)
+    PassOnGroupMessage(message);
 
   LOG(kVerbose) << "Message for this node."
                 << " id: " << message.id();
@@ -274,19 +451,14 @@ void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message)
     return network_.SendToClosestNode(message);
   }
 
-  std::vector<std::string> route_history;
-  if (message.route_history().size() > 1)
-    route_history = std::vector<std::string>(message.route_history().begin(),
-                                             message.route_history().end() - 1);
-  else if ((message.route_history().size() == 1) &&
-           (message.route_history(0) != routing_table_.kNodeId().string()))
-    route_history.push_back(message.route_history(0));
+  const ExcludedNodes kRouteHistory(
+      RouteHistoryExclusions(message, routing_table_.kNodeId(), false));
 
   // Confirming from group matrix. If this node is closest to the target id or else passing on to
   // the connected peer which has the closer node.
   NodeInfo closest_to_group_leader_node;
   if (!routing_table_.IsThisNodeGroupLeader(NodeId(message.destination_id()),
-                                            closest_to_group_leader_node, route_history)) {
+                                            closest_to_group_leader_node, kRouteHistory)) {
     assert(NodeId(message.destination_id()) != closest_to_group_leader_node.node_id);
     return network_.SendToDirectAdjustedRoute(message, closest_to_group_leader_node.node_id,
                                               closest_to_group_leader_node.connection_id);
@@ -302,22 +474,19 @@ void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message)
 
   --replication;  // Will send to self as well
   message.set_direct(true);
-  message.clear_route_history();
+  message.clear_route_history_tags();
   NodeId destination_id(message.destination_id());
   NodeId own_node_id(routing_table_.kNodeId());
-  auto close_from_matrix(routing_table_.GetClosestMatrixNodes(destination_id, replication + 2));
-  close_from_matrix.erase(std::remove_if(close_from_matrix.begin(), close_from_matrix.end(),
-                                         [&destination_id](const NodeInfo & node_info) {
-                            return node_info.node_id == destination_id;
-                          }),
-                          close_from_matrix.end());
-  close_from_matrix.erase(std::remove_if(close_from_matrix.begin(), close_from_matrix.end(),
-                                         [&own_node_id](const NodeInfo & node_info) {
-                            return node_info.node_id == own_node_id;
-                          }),
-                          close_from_matrix.end());
-  while (close_from_matrix.size() > replication)
-    close_from_matrix.pop_back();
+  std::vector<NodeInfo> close_from_matrix;
+  close_from_matrix.reserve(replication);
+  routing_table_.VisitClosestMatrixNodes(destination_id, replication + 2,
+                                         [&](const NodeInfo& node_info) {
+    if (close_from_matrix.size() == replication)
+      return false;
+    if (node_info.node_id != destination_id && node_info.node_id != own_node_id)
+      close_from_matrix.push_back(node_info);
+    return true;
+  });
 
   std::string group_id(message.destination_id());
   std::string group_members("[" + DebugId(routing_table_.kNodeId()) + "]");
@@ -326,16 +495,29 @@ void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message)
     group_members += std::string("[" + DebugId(i.node_id) + "]");
   LOG(kInfo) << "Group nodes for group_id " << HexSubstr(group_id) << " : " << group_members;
 
+  if (Parameters::aggregate_group_responses && IsRequest(message) && !IsRoutingMessage(message) &&
+      !message.one_way() && message.has_id() && !message.has_relay_id() &&
+      !message.has_group_source()) {
+    message.set_aggregator_id(own_node_id.string());
+    group_response_aggregator_.Expect(message, static_cast<int>(close_from_matrix.size()) + 1);
+  }
+  if (Parameters::group_fan_out != 0 && close_from_matrix.size() > Parameters::group_fan_out) {
+    FanOutGroupMessage(message, close_from_matrix);
+    close_from_matrix.clear();
+  }
+  // Replicas only differ in their destination ID, so the message is serialised once for all
+  // directly connected group members.
+  EncodedMessage encoded_message(message);
   for (const auto& i : close_from_matrix) {
     LOG(kInfo) << "[" << DebugId(own_node_id) << "] - "
                << "Replicating message to : " << HexSubstr(i.node_id.string())
                << " [ group_id : " << HexSubstr(group_id) << "]"
                << " id: " << message.id();
-    message.set_destination_id(i.node_id.string());
     NodeInfo node;
     if (routing_table_.GetNodeInfo(i.node_id, node)) {
-      network_.SendToDirect(message, node.node_id, node.connection_id);
+      network_.SendEncodedToDirect(encoded_message, node.node_id, node.connection_id);
     } else {
+      message.set_destination_id(i.node_id.string());
       network_.SendToClosestNode(message);
     }
   }
@@ -351,6 +533,53 @@ void MessageHandler::HandleGroupMessageAsClosestNode(protobuf::Message& message)
   }
 }
 
+void MessageHandler::FanOutGroupMessage(const protobuf::Message& message,
+                                        const std::vector<NodeInfo>& members) {
+  const size_t kChildren(
+      std::min(static_cast<size_t>(std::max<uint16_t>(Parameters::group_fan_out, 1)),
+               members.size()));
+  std::vector<protobuf::Message> copies(kChildren, message);
+  for (auto& copy : copies)
+    copy.clear_fan_out_ids();
+  for (size_t i(kChildren); i < members.size(); ++i)
+    copies[(i - kChildren) % kChildren].add_fan_out_ids(members[i].node_id.string());
+  for (size_t i(0); i != kChildren; ++i) {
+    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] fanning group message out to "
+                  << DebugId(members[i].node_id) << " for " << copies[i].fan_out_ids_size()
+                  << " more, id: " << message.id();
+    copies[i].set_destination_id(members[i].node_id.string());
+    NodeInfo node;
+    if (routing_table_.GetNodeInfo(members[i].node_id, node))
+      network_.SendToDirect(copies[i], node.node_id, node.connection_id);
+    else
+      network_.SendToClosestNode(copies[i]);
+  }
+}
+
+void MessageHandler::PassOnGroupMessage(protobuf::Message& message) {
+  std::vector<NodeInfo> members;
+  // A longer list than a group could need is not passed on, so that it can't be used to amplify.
+  if (message.fan_out_ids_size() < Parameters::group_size) {
+    for (const auto& node_id : message.fan_out_ids()) {
+      if (node_id.size() != NodeId::kSize || node_id == routing_table_.kNodeId().string())
+        continue;
+      NodeInfo member;
+      member.node_id = NodeId(node_id);
+      members.push_back(member);
+    }
+  }
+  message.clear_fan_out_ids();
+  if (!members.empty())
+    FanOutGroupMessage(message, members);
+}
+
+void MessageHandler::SendResponse(protobuf::Message& message) {
+  if (message.destination_id() == routing_table_.kNodeId().string())
+    HandleMessage(message);
+  else
+    network_.SendToClosestNode(message);
+}
+
 void MessageHandler::HandleMessageAsFarNode(protobuf::Message& message) {
   if (message.has_visited() &&
       routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !message.direct()) &&
@@ -363,21 +592,61 @@ void MessageHandler::HandleMessageAsFarNode(protobuf::Message& message) {
   network_.SendToClosestNode(message);
 }
 
+bool MessageHandler::ForwardAsFarNode(const MessageHeader& header,
+                                      const std::string& serialised) {
+  if (!Parameters::fast_path_forwarding || routing_table_.client_mode())
+    return false;
+  // Anything which HandleMessage could treat other than by HandleMessageAsFarNode with no
+  // changes beyond hops_to_live and route_history takes the full path, as do sampled messages,
+  // which record each hop.
+  if (header.routing_message || header.cacheable != 0 || header.hops_to_live <= 0 ||
+      header.has_path_trace || !header.has_source_id || !CheckId(header.source_id) ||
+      !CheckId(header.destination_id))
+    return false;
+  const NodeId kDestinationId(header.destination_id);
+  if (kDestinationId == routing_table_.kNodeId() ||
+      NodeId(header.source_id) == routing_table_.kNodeId() ||
+      client_routing_table_.Contains(kDestinationId) ||
+      routing_table_.IsThisNodeInRange(kDestinationId, Parameters::group_size) ||
+      routing_table_.IsThisNodeClosestTo(kDestinationId, !header.direct))
+    return false;
+  if (!network_.ForwardSerialised(header, serialised))
+    return false;
+  network_.metrics().Add(RoutingMetrics::kForwarded, header.type);
+  return true;
+}
+
 void MessageHandler::HandleMessage(protobuf::Message& message) {
   LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "]"
                 << " MessageHandler::HandleMessage handle message with id: " << message.id();
   if (!ValidateMessage(message)) {
     LOG(kWarning) << "Validate message failed， id: " << message.id();
+    network_.metrics().Add(message.IsInitialized() && message.hops_to_live() <= 0
+                               ? RoutingMetrics::kDroppedHopsToLive
+                               : RoutingMetrics::kDroppedInvalid,
+                           message.type());
     BOOST_ASSERT_MSG((message.hops_to_live() > 0),
                      "Message has traversed maximum number of hops allowed");
     return;
   }
 
+  if (message.has_deadline() && DeadlinePassed(message.deadline())) {
+    LOG(kVerbose) << "Dropping message id: " << message.id() << " past its deadline";
+    network_.metrics().Add(RoutingMetrics::kDroppedExpired, message.type());
+    return;
+  }
+
   // Decrement hops_to_live
   message.set_hops_to_live(message.hops_to_live() - 1);
 
-  if (IsValidCacheableGet(message) && HandleCacheLookup(message))
+  if (IsValidCacheableGet(message) && HandleCacheLookup(message)) {
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return;  // forwarding message is done by cache manager or vault
+  }
+  HandleUncachedMessage(message);
+}
+
+void MessageHandler::HandleUncachedMessage(protobuf::Message& message) {
   if (IsValidCacheablePut(message)) {
     LOG(kVerbose) << "StoreCacheCopy: " << message.id();
     StoreCacheCopy(message);  // Upper layer should take this on seperate thread
@@ -386,18 +655,21 @@ void MessageHandler::HandleMessage(protobuf::Message& message) {
   // If group message request to self id
   if (IsGroupMessageRequestToSelfId(message)) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleGroupMessageToSelfId";
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return HandleGroupMessageToSelfId(message);
   }
 
   // If this node is a client
   if (routing_table_.client_mode()) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleClientMessage";
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return HandleClientMessage(message);
   }
 
   // Relay mode message
   if (message.source_id().empty()) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleRelayRequest";
+    network_.metrics().Add(RoutingMetrics::kForwarded, message.type());
     return HandleRelayRequest(message);
   }
 
@@ -405,23 +677,27 @@ void MessageHandler::HandleMessage(protobuf::Message& message) {
   if (NodeId(message.source_id()).IsZero()) {
     LOG(kWarning) << "Stray message dropped, need valid source ID for processing."
                   << " id: " << message.id();
+    network_.metrics().Add(RoutingMetrics::kDroppedInvalid, message.type());
     return;
   }
 
   // Direct message
   if (message.destination_id() == routing_table_.kNodeId().string()) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageForThisNode";
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return HandleMessageForThisNode(message);
   }
 
   if (IsRelayResponseForThisNode(message)) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleRoutingMessage";
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return HandleRoutingMessage(message);
   }
 
   if (client_routing_table_.Contains(NodeId(message.destination_id())) && IsDirect(message)) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id()
                << " HandleMessageForNonRoutingNodes";
+    network_.metrics().Add(RoutingMetrics::kForwarded, message.type());
     return HandleMessageForNonRoutingNodes(message);
   }
 
@@ -431,9 +707,11 @@ void MessageHandler::HandleMessage(protobuf::Message& message) {
       (routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()), !message.direct()) &&
        message.visited())) {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageAsClosestNode";
+    network_.metrics().Add(RoutingMetrics::kHandledLocally, message.type());
     return HandleMessageAsClosestNode(message);
   } else {
     LOG(kInfo) << "MessageHandler::HandleMessage " << message.id() << " HandleMessageAsFarNode";
+    network_.metrics().Add(RoutingMetrics::kForwarded, message.type());
     return HandleMessageAsFarNode(message);
   }
 }
@@ -470,6 +748,9 @@ void MessageHandler::HandleRelayRequest(protobuf::Message& message) {
     }
   }
 
+  if (RedirectRelayRequest(message))
+    return;
+
   // This node may be closest for group messages.
   if (message.request() && routing_table_.IsThisNodeClosestTo(NodeId(message.destination_id()))) {
     if (message.direct()) {
@@ -484,6 +765,41 @@ void MessageHandler::HandleRelayRequest(protobuf::Message& message) {
   network_.SendToClosestNode(message);
 }
 
+bool MessageHandler::RedirectRelayRequest(protobuf::Message& message) {
+  if (Parameters::relay_redirect_count == 0 || !message.client_node() || !message.request() ||
+      message.type() != static_cast<int32_t>(MessageType::kFindNodes) || message.data_size() != 1 ||
+      network_.Load() < Parameters::relay_overload_load)
+    return false;
+  protobuf::FindNodesResponse redirect;
+  routing_table_.VisitClosestNodes(
+      NodeId(message.relay_id()), static_cast<uint16_t>(routing_table_.size()),
+      [this, &redirect](const NodeInfo& node_info) {
+        auto endpoint(network_.PeerEndpoint(node_info.connection_id));
+        if (!endpoint.address().is_unspecified())
+          SetProtobufEndpoint(endpoint, redirect.add_redirect_endpoints());
+        return redirect.redirect_endpoints_size() < int(Parameters::relay_redirect_count);
+      });
+  if (redirect.redirect_endpoints_size() == 0)
+    return false;
+  LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] overloaded, redirecting client "
+             << HexSubstr(message.relay_id()) << " to " << redirect.redirect_endpoints_size()
+             << " peers";
+  redirect.set_load(network_.Load());
+  TakeSignedOriginalRequest(message, redirect);
+  message.clear_destination_id();
+  message.set_source_id(routing_table_.kNodeId().string());
+  message.clear_route_history_tags();
+  message.clear_data();
+  redirect.SerializeToString(message.add_data());
+  message.set_direct(true);
+  message.set_replication(1);
+  message.set_client_node(routing_table_.client_mode());
+  message.set_request(false);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  network_.SendToClosestNode(message);
+  return true;
+}
+
 void MessageHandler::HandleDirectRelayRequestMessageAsClosestNode(protobuf::Message& message) {
   assert(message.direct());
   // Dropping direct messages if this node is closest and destination node is not in routing_table_
@@ -543,28 +859,27 @@ void MessageHandler::HandleGroupRelayRequestMessageAsClosestNode(protobuf::Messa
   message.set_direct(true);
   if (have_node_with_group_id)
     ++replication;
-  auto close(routing_table_.GetClosestNodes(NodeId(message.destination_id()), replication));
-
-  if (have_node_with_group_id)
-    close.erase(close.begin());
   std::string group_id(message.destination_id());
   std::string group_members("[" + DebugId(routing_table_.kNodeId()) + "]");
-
-  for (const auto& i : close)
-    group_members += std::string("[" + DebugId(i) + "]");
-  LOG(kInfo) << "Group members for group_id " << HexSubstr(group_id) << " are: " << group_members;
   // This node relays back the responses
   message.set_source_id(routing_table_.kNodeId().string());
-  for (const auto& i : close) {
-    LOG(kInfo) << "Replicating message to : " << HexSubstr(i.string())
+  EncodedMessage encoded_message(message);
+  bool skip_group_id_node(have_node_with_group_id);
+  // The peers are visited straight from the routing table snapshot, so need no further lookup.
+  routing_table_.VisitClosestNodes(NodeId(message.destination_id()), replication,
+                                   [&](const NodeInfo& node) {
+    if (skip_group_id_node) {
+      skip_group_id_node = false;
+      return true;
+    }
+    group_members += std::string("[" + DebugId(node.node_id) + "]");
+    LOG(kInfo) << "Replicating message to : " << HexSubstr(node.node_id.string())
                << " [ group_id : " << HexSubstr(group_id) << "]"
                << " id: " << message.id();
-    message.set_destination_id(i.string());
-    NodeInfo node;
-    if (routing_table_.GetNodeInfo(i, node)) {
-      network_.SendToDirect(message, node.node_id, node.connection_id);
-    }
-  }
+    network_.SendEncodedToDirect(encoded_message, node.node_id, node.connection_id);
+    return true;
+  });
+  LOG(kInfo) << "Group members for group_id " << HexSubstr(group_id) << " are: " << group_members;
 
   message.set_destination_id(routing_table_.kNodeId().string());
 //  message.clear_source_id();
@@ -653,28 +968,69 @@ void MessageHandler::HandleGroupMessageToSelfId(protobuf::Message& message) {
   network_.SendToClosestNode(message);
 }
 
-void MessageHandler::InvokeTypedMessageReceivedFunctor(const protobuf::Message& proto_message) {
-  if ((!proto_message.has_group_source() && !proto_message.has_group_destination()) &&
-      typed_message_received_functors_.single_to_single) {  // Single to Single
-    typed_message_received_functors_.single_to_single(CreateSingleToSingleMessage(proto_message));
-  } else if ((!proto_message.has_group_source() && proto_message.has_group_destination()) &&
-             typed_message_received_functors_.single_to_group) {
-    // Single to Group
-    if (proto_message.has_relay_id() && proto_message.has_relay_connection_id()) {
-      typed_message_received_functors_.single_to_group_relay(
-          CreateSingleToGroupRelayMessage(proto_message));
-    } else {
-      typed_message_received_functors_.single_to_group(CreateSingleToGroupMessage(proto_message));
+void MessageHandler::InvokeTypedMessageReceivedFunctor(protobuf::Message& proto_message) {
+  kTypedDeliveries[detail::TypedMessageKind(
+      proto_message.has_group_source(), proto_message.has_group_destination(),
+      proto_message.has_relay_id() && proto_message.has_relay_connection_id())](
+      typed_message_received_functors_, proto_message);
+}
+
+void MessageHandler::set_stream_received_functor(StreamReceivedFunctor stream_received_functor) {
+  stream_received_functor_ = stream_received_functor;
+}
+
+void MessageHandler::set_path_trace_functor(PathTraceFunctor path_trace_functor) {
+  path_trace_functor_ = path_trace_functor;
+}
+
+void MessageHandler::set_leave_functor(LeaveFunctor leave_functor) {
+  leave_functor_ = leave_functor;
+}
+
+void MessageHandler::set_resume_functor(ResumeFunctor resume_functor) {
+  resume_functor_ = resume_functor;
+}
+
+void MessageHandler::HandleLeave(protobuf::Message& message) {
+  protobuf::LeaveRequest leave_request;
+  // Only a leaver's own announcement, not yet forwarded by anyone, is acted on.
+  if (leave_functor_ && message.source_id().size() == NodeId::kSize &&
+      message.hops_to_live() == Parameters::hops_to_live && message.data_size() == 1 &&
+      leave_request.ParseFromString(message.data(0))) {
+    std::vector<NodeId> replacement_ids;
+    for (const auto& replacement_id : leave_request.replacement_ids()) {
+      if (replacement_ids.size() == Parameters::closest_nodes_size)
+        break;
+      if (replacement_id.size() == NodeId::kSize &&
+          replacement_id != routing_table_.kNodeId().string() &&
+          replacement_id != message.source_id())
+        replacement_ids.push_back(NodeId(replacement_id));
     }
-  } else if ((proto_message.has_group_source() && !proto_message.has_group_destination()) &&
-             typed_message_received_functors_.group_to_single) {
-    typed_message_received_functors_.group_to_single(CreateGroupToSingleMessage(proto_message));
-  } else if ((proto_message.has_group_source() && proto_message.has_group_destination()) &&
-             typed_message_received_functors_.group_to_group) {  // Group to Group
-    typed_message_received_functors_.group_to_group(CreateGroupToGroupMessage(proto_message));
-  } else {
-    assert(false);
+    LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] " << HexSubstr(message.source_id())
+               << " is leaving, suggesting " << replacement_ids.size() << " replacements";
+    leave_functor_(NodeId(message.source_id()), replacement_ids);
   }
+  message.Clear();  // one-way
+}
+
+void MessageHandler::ReportPathTrace(const protobuf::Message& message) {
+  if (!message.has_path_trace() || !path_trace_functor_)
+    return;
+  PathTrace trace;
+  if (!GetPathTrace(message, trace)) {
+    LOG(kWarning) << "Malformed path trace on message id " << message.id();
+    return;
+  }
+  path_trace_functor_(trace);
+}
+
+void MessageHandler::set_application_queue(std::shared_ptr<ApplicationQueue> application_queue) {
+  application_queue_ = application_queue;
+}
+
+void MessageHandler::set_node_level_handler(
+    std::shared_ptr<NodeLevelHandler> node_level_handler) {
+  node_level_handler_ = node_level_handler;
 }
 
 void MessageHandler::set_message_and_caching_functor(MessageAndCachingFunctors functors) {
@@ -702,10 +1058,55 @@ void MessageHandler::set_request_public_key_functor(
   service_->set_request_public_key_functor(request_public_key_functor);
 }
 
+void MessageHandler::set_find_nodes_response_functor(
+    ResponseHandler::FindNodesResponseFunctor find_nodes_response_functor) {
+  response_handler_->set_find_nodes_response_functor(find_nodes_response_functor);
+}
+
+void MessageHandler::SendConnectRequests(const std::vector<NodeId>& node_ids) {
+  response_handler_->SendConnectRequests(node_ids);
+}
+
+void MessageHandler::SendShortcutRequest(const NodeId& peer_id) {
+  response_handler_->SendShortcutRequest(peer_id);
+}
+
+void MessageHandler::PrefetchPublicKeys(const std::vector<NodeId>& node_ids) {
+  for (const auto& node_id : node_ids)
+    response_handler_->standby_key_prefetch()->Prefetch(node_id);
+}
+
+CacheStatistics MessageHandler::GetCacheStatistics() const {
+  return cache_manager_ ? cache_manager_->Statistics() : CacheStatistics();
+}
+
+uint64_t MessageHandler::CachedBytes() const {
+  return cache_manager_ ? cache_manager_->CachedBytes() : 0;
+}
+
+size_t MessageHandler::LimitCache(uint64_t byte_limit) {
+  return cache_manager_ ? cache_manager_->LimitCache(byte_limit) : 0;
+}
+
+void MessageHandler::set_service_post_functor(Service::PostFunctor post_functor) {
+  service_->set_post_functor(post_functor);
+}
+
+void MessageHandler::set_memory_budget(std::shared_ptr<MemoryBudget> memory_budget) {
+  service_->set_memory_budget(memory_budget);
+}
+
 bool MessageHandler::HandleCacheLookup(protobuf::Message& message) {
   assert(!routing_table_.client_mode());
   assert(IsCacheableGet(message));
-  return cache_manager_->HandleGetFromCache(message);
+  return cache_manager_->HandleGetFromCache(message, [this](protobuf::Message& uncached) {
+    if (!resume_functor_)
+      return HandleUncachedMessage(uncached);
+    std::shared_ptr<protobuf::Message> resumed(ObjectPool<protobuf::Message>::AcquireShared());
+    resumed->Swap(&uncached);
+    const std::string kKey(resumed->has_source_id() ? resumed->source_id() : resumed->relay_id());
+    resume_functor_(kKey, [this, resumed]() { HandleUncachedMessage(*resumed); });
+  });
 }
 
 void MessageHandler::StoreCacheCopy(const protobuf::Message& message) {
@@ -19,14 +19,19 @@
 #ifndef MAIDSAFE_ROUTING_MESSAGE_HANDLER_H_
 #define MAIDSAFE_ROUTING_MESSAGE_HANDLER_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
 #include "maidsafe/routing/cache_manager.h"
+#include "maidsafe/routing/group_response_aggregator.h"
+#include "maidsafe/routing/message_header.h"
 #include "maidsafe/routing/response_handler.h"
 #include "maidsafe/routing/service.h"
+#include "maidsafe/routing/stream_transfer.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
@@ -45,6 +50,8 @@ class MessageHandlerTest_BEH_HandleRelay_Test;
 class MessageHandlerTest_BEH_HandleGroupMessage_Test;
 class MessageHandlerTest_BEH_HandleNodeLevelMessage_Test;
 class MessageHandlerTest_BEH_ClientRoutingTable_Test;
+class MessageHandlerTest_BEH_PassOnFannedOutGroupMessage_Test;
+class MessageHandlerTest_BEH_ReplayInboundTrace_Test;
 }
 
 namespace detail {
@@ -58,12 +65,14 @@ struct TypedMessageRecievedFunctors {
 
 }  // unnamed detail
 
+class ApplicationQueue;
 class NetworkUtils;
 class ClientRoutingTable;
 class RoutingTable;
 class RemoveFurthestNode;
 class GroupChangeHandler;
 class NetworkStatistics;
+class GroupCache;
 
 enum class MessageType : int32_t {
   kPing = 1,
@@ -74,19 +83,57 @@ enum class MessageType : int32_t {
   kRemove = 6,
   kClosestNodesUpdate = 7,
   kGetGroup = 8,
+  kLeave = 9,
   kMaxRouting = 100,
   kNodeLevel = 101
 };
 
 class MessageHandler {
  public:
+  typedef std::function<void(const NodeId& /*leaver_id*/,
+                             const std::vector<NodeId>& /*replacement_ids*/)> LeaveFunctor;
+  // Queues |handler| behind the other messages from the sender keyed by |key|.
+  typedef std::function<void(const std::string& /*key*/,
+                             const std::function<void()>& /*handler*/)> ResumeFunctor;
+
   MessageHandler(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
                  NetworkUtils& network, Timer<std::string>& timer, RemoveFurthestNode& remove_node,
-                 GroupChangeHandler& group_change_handler, NetworkStatistics& network_statistics);
+                 GroupChangeHandler& group_change_handler, NetworkStatistics& network_statistics,
+                 GroupCache& group_cache);
   void HandleMessage(protobuf::Message& message);
+  // Forwards |serialised|, whose decoded |header| is given, unparsed if it is a node-level message
+  // for a destination this node is not close to.  Returns false if the message needs the full
+  // HandleMessage treatment instead.
+  bool ForwardAsFarNode(const MessageHeader& header, const std::string& serialised);
   void set_typed_message_and_caching_functor(TypedMessageAndCachingFunctor functors);
   void set_message_and_caching_functor(MessageAndCachingFunctors functors);
+  // Requests which would be passed to the message_received functor are pushed to
+  // |application_queue| instead, see Parameters::application_queue_size.
+  void set_application_queue(std::shared_ptr<ApplicationQueue> application_queue);
+  // Takes the place of the message_received functor, see Functors::node_level_handler.
+  void set_node_level_handler(std::shared_ptr<NodeLevelHandler> node_level_handler);
   void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key_functor);
+  void set_stream_received_functor(StreamReceivedFunctor stream_received_functor);
+  void set_path_trace_functor(PathTraceFunctor path_trace_functor);
+  void set_find_nodes_response_functor(
+      ResponseHandler::FindNodesResponseFunctor find_nodes_response_functor);
+  // Called with the sender of each valid leave announcement this node receives.
+  void set_leave_functor(LeaveFunctor leave_functor);
+  // Used to resume handling a cache miss, which completes on a timer or application thread.  The
+  // miss is handled on the completing thread if this isn't set.
+  void set_resume_functor(ResumeFunctor resume_functor);
+  // See Service::set_post_functor.
+  void set_service_post_functor(Service::PostFunctor post_functor);
+  void SendConnectRequests(const std::vector<NodeId>& node_ids);
+  void SendShortcutRequest(const NodeId& peer_id);
+  // Asks for the keys of nodes likely to be connected to soon, ready for when they are.
+  void PrefetchPublicKeys(const std::vector<NodeId>& node_ids);
+  CacheStatistics GetCacheStatistics() const;
+  // As CacheManager's, for a vault; a client holds no cache.
+  uint64_t CachedBytes() const;
+  size_t LimitCache(uint64_t byte_limit);
+  // Consulted before accepting a client's connect request.
+  void set_memory_budget(std::shared_ptr<MemoryBudget> memory_budget);
 
  private:
   MessageHandler(const MessageHandler&);
@@ -95,12 +142,30 @@ class MessageHandler {
   bool CheckCacheData(protobuf::Message& message);
   void HandleRoutingMessage(protobuf::Message& message);
   void HandleNodeLevelMessageForThisNode(protobuf::Message& message);
+  // Sends |reply| to the sender of the node-level |request|.
+  void SendNodeLevelReply(const protobuf::Message& request, const std::string& reply);
+  // Passes a leave announcement's sender and suggested replacements to the leave functor.
+  void HandleLeave(protobuf::Message& message);
+  // Passes the path of a sampled |message| which this node has handled to the path trace functor.
+  void ReportPathTrace(const protobuf::Message& message);
+  // Acknowledges a fragment sent by Routing::SendStream, delivering the payload once complete.
+  void HandleStreamFragment(protobuf::Message& message);
   void HandleMessageForThisNode(protobuf::Message& message);
   void HandleMessageAsClosestNode(protobuf::Message& message);
   void HandleDirectMessageAsClosestNode(protobuf::Message& message);
   void HandleGroupMessageAsClosestNode(protobuf::Message& message);
+  // Sends |message| to the first Parameters::group_fan_out of |members|, dealing the rest out
+  // between them in its fan_out_ids to pass on in turn.
+  void FanOutGroupMessage(const protobuf::Message& message, const std::vector<NodeInfo>& members);
+  // Passes a group member's copy of a group message on to the members in its fan_out_ids.
+  void PassOnGroupMessage(protobuf::Message& message);
+  // Sends a response on to its destination, or handles it if that is this node.
+  void SendResponse(protobuf::Message& message);
   void HandleMessageAsFarNode(protobuf::Message& message);
   void HandleRelayRequest(protobuf::Message& message);
+  // Answers a joining client's FindNodes relay request with peers to bootstrap off instead, if
+  // this node is overloaded (see Parameters::relay_overload_load).  Returns false otherwise.
+  bool RedirectRelayRequest(protobuf::Message& message);
   void HandleGroupMessageToSelfId(protobuf::Message& message);
   bool IsRelayResponseForThisNode(protobuf::Message& message);
   bool IsGroupMessageRequestToSelfId(protobuf::Message& message);
@@ -109,17 +174,24 @@ class MessageHandler {
   void HandleMessageForNonRoutingNodes(protobuf::Message& message);
   void HandleDirectRelayRequestMessageAsClosestNode(protobuf::Message& message);
   void HandleGroupRelayRequestMessageAsClosestNode(protobuf::Message& message);
+  // Returns true if the cache manager has taken |message| over, in which case it resumes handling
+  // via HandleUncachedMessage on a miss, through the resume functor if set.
   bool HandleCacheLookup(protobuf::Message& message);
+  // The rest of HandleMessage, for a message which isn't answered from the cache.
+  void HandleUncachedMessage(protobuf::Message& message);
   void StoreCacheCopy(const protobuf::Message& message);
   bool IsValidCacheableGet(const protobuf::Message& message);
   bool IsValidCacheablePut(const protobuf::Message& message);
-  void InvokeTypedMessageReceivedFunctor(const protobuf::Message& proto_message);
+  // Hands the payload of |proto_message| to the typed functor for its kind, leaving it empty.
+  void InvokeTypedMessageReceivedFunctor(protobuf::Message& proto_message);
   friend class test::MessageHandlerTest;
   friend class test::MessageHandlerTest_BEH_HandleInvalidMessage_Test;
   friend class test::MessageHandlerTest_BEH_HandleRelay_Test;
   friend class test::MessageHandlerTest_BEH_HandleGroupMessage_Test;
   friend class test::MessageHandlerTest_BEH_HandleNodeLevelMessage_Test;
   friend class test::MessageHandlerTest_BEH_ClientRoutingTable_Test;
+  friend class test::MessageHandlerTest_BEH_PassOnFannedOutGroupMessage_Test;
+  friend class test::MessageHandlerTest_BEH_ReplayInboundTrace_Test;
   friend class test::GenericNode;
 
 
@@ -129,12 +201,21 @@ class MessageHandler {
   NetworkUtils& network_;
   RemoveFurthestNode& remove_furthest_node_;
   GroupChangeHandler& group_change_handler_;
+  GroupCache& group_cache_;
   std::unique_ptr<CacheManager> cache_manager_;
   Timer<std::string>& timer_;
+  GroupResponseAggregator group_response_aggregator_;
+  StreamReassembler stream_reassembler_;
+  StreamReceivedFunctor stream_received_functor_;
+  PathTraceFunctor path_trace_functor_;
+  LeaveFunctor leave_functor_;
+  ResumeFunctor resume_functor_;
   std::shared_ptr<ResponseHandler> response_handler_;
   std::shared_ptr<Service> service_;
   MessageReceivedFunctor message_received_functor_;
   detail::TypedMessageRecievedFunctors typed_message_received_functors_;
+  std::shared_ptr<ApplicationQueue> application_queue_;
+  std::shared_ptr<NodeLevelHandler> node_level_handler_;
 };
 
 }  // namespace routing
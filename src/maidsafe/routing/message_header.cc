@@ -0,0 +1,272 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/message_header.h"
+
+#include "maidsafe/routing/route_history.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Field numbers of protobuf::Message.
+enum Field : uint32_t {
+  kSourceId = 1,
+  kDestinationId = 2,
+  kRoutingMessage = 3,
+  kRelayId = 5,
+  kDirect = 8,
+  kType = 10,
+  kCacheable = 11,
+  kId = 12,
+  kClientNode = 13,
+  kLegacyRouteHistory = 17,
+  kRequest = 18,
+  kHopsToLive = 19,
+  kVisited = 20,
+  kUniqueId = 25,
+  kDataCompression = 37,
+  kPathTrace = 40,
+  kDeadline = 41,
+  kRouteHistory = 42
+};
+
+enum WireType : uint32_t {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kFixed32 = 5
+};
+
+bool ReadVarint(const std::string& input, size_t& position, uint64_t& value) {
+  value = 0;
+  for (int shift(0); shift < 64 && position != input.size(); shift += 7) {
+    uint8_t byte(static_cast<uint8_t>(input[position++]));
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+void AppendVarint(uint64_t value, std::string& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+bool IsBytesField(uint32_t number) {
+  return number == kSourceId || number == kDestinationId || number == kRelayId ||
+         number == kLegacyRouteHistory || number == kRouteHistory || number == kPathTrace;
+}
+
+bool IsVarintField(uint32_t number) {
+  return number == kRoutingMessage || number == kDirect || number == kType ||
+         number == kCacheable || number == kId || number == kClientNode || number == kRequest ||
+         number == kHopsToLive || number == kVisited || number == kDataCompression;
+}
+
+// A top-level field: its number, wire type, and either its varint or fixed-width value or the
+// extent of its length-delimited contents.
+struct WireField {
+  uint32_t number, wire_type;
+  uint64_t value;
+  size_t begin, end;
+};
+
+// Reads the field at |position|, leaving |position| just past it.
+bool ReadField(const std::string& input, size_t& position, WireField& field) {
+  uint64_t key(0);
+  if (!ReadVarint(input, position, key) || (key >> 3) == 0 || (key >> 3) > 0x1FFFFFFF)
+    return false;
+  field.number = static_cast<uint32_t>(key >> 3);
+  field.wire_type = static_cast<uint32_t>(key & 7);
+  field.value = 0;
+  switch (field.wire_type) {
+    case kVarint:
+      return ReadVarint(input, position, field.value);
+    case kFixed64:
+    case kFixed32: {
+      size_t size(field.wire_type == kFixed64 ? 8 : 4);
+      if (input.size() - position < size)
+        return false;
+      // Fixed-width values are little-endian.
+      for (size_t i(size); i != 0; --i)
+        field.value = (field.value << 8) | static_cast<uint8_t>(input[position + i - 1]);
+      position += size;
+      return true;
+    }
+    case kLengthDelimited: {
+      uint64_t size(0);
+      if (!ReadVarint(input, position, size) || size > input.size() - position)
+        return false;
+      field.begin = position;
+      position += static_cast<size_t>(size);
+      field.end = position;
+      return true;
+    }
+    default:  // groups are not used by protobuf::Message
+      return false;
+  }
+}
+
+}  // unnamed namespace
+
+MessageHeader::MessageHeader()
+    : source_id(),
+      destination_id(),
+      relay_id(),
+      route_history(),
+      hops_to_live(0),
+      cacheable(0),
+      id(0),
+      type(0),
+      data_compression(0),
+      unique_id(0),
+      deadline(0),
+      has_source_id(false),
+      has_relay_id(false),
+      has_visited(false),
+      has_unique_id(false),
+      has_path_trace(false),
+      has_deadline(false),
+      routing_message(false),
+      direct(false),
+      client_node(false),
+      request(false),
+      visited(false) {}
+
+bool MessageHeader::Decode(const std::string& serialised) {
+  *this = MessageHeader();
+  uint32_t required_fields(0);
+  size_t position(0);
+  WireField field;
+  while (position != serialised.size()) {
+    if (!ReadField(serialised, position, field))
+      return false;
+    if ((IsBytesField(field.number) && field.wire_type != kLengthDelimited) ||
+        (IsVarintField(field.number) && field.wire_type != kVarint) ||
+        ((field.number == kUniqueId || field.number == kDeadline) &&
+         field.wire_type != kFixed64))
+      return false;
+    switch (field.number) {
+      case kSourceId:
+        source_id.assign(serialised, field.begin, field.end - field.begin);
+        has_source_id = true;
+        break;
+      case kDestinationId:
+        destination_id.assign(serialised, field.begin, field.end - field.begin);
+        break;
+      case kRelayId:
+        relay_id.assign(serialised, field.begin, field.end - field.begin);
+        has_relay_id = true;
+        break;
+      case kLegacyRouteHistory:  // a full node ID, from an older node
+        if (field.end - field.begin >= kRouteHistoryTagSize)
+          route_history.append(serialised, field.end - kRouteHistoryTagSize, kRouteHistoryTagSize);
+        break;
+      case kRouteHistory:
+        route_history.append(serialised, field.begin, field.end - field.begin);
+        break;
+      case kRoutingMessage:
+        routing_message = field.value != 0;
+        required_fields |= 1 << 0;
+        break;
+      case kDirect:
+        direct = field.value != 0;
+        required_fields |= 1 << 1;
+        break;
+      case kType:  // sint32, zigzag encoded
+        type = static_cast<int32_t>(static_cast<uint32_t>(field.value >> 1) ^
+                                    (0U - static_cast<uint32_t>(field.value & 1)));
+        break;
+      case kCacheable:
+        cacheable = static_cast<int32_t>(field.value);
+        break;
+      case kId:
+        id = static_cast<int32_t>(field.value);
+        break;
+      case kClientNode:
+        client_node = field.value != 0;
+        required_fields |= 1 << 2;
+        break;
+      case kRequest:
+        request = field.value != 0;
+        required_fields |= 1 << 3;
+        break;
+      case kHopsToLive:
+        hops_to_live = static_cast<int32_t>(field.value);
+        required_fields |= 1 << 4;
+        break;
+      case kVisited:
+        visited = field.value != 0;
+        has_visited = true;
+        break;
+      case kUniqueId:
+        unique_id = field.value;
+        has_unique_id = true;
+        break;
+      case kDataCompression:
+        data_compression = static_cast<int32_t>(field.value);
+        break;
+      case kPathTrace:
+        has_path_trace = true;
+        break;
+      case kDeadline:
+        deadline = field.value;
+        has_deadline = true;
+        break;
+      default:
+        break;
+    }
+  }
+  return required_fields == 0x1F;
+}
+
+std::string RewriteForwardedMessage(const std::string& serialised, int32_t hops_to_live,
+                                    const std::string& route_history) {
+  std::string rewritten;
+  rewritten.reserve(serialised.size() + route_history.size() + 8);
+  size_t position(0);
+  WireField field;
+  while (position != serialised.size()) {
+    size_t field_begin(position);
+    if (!ReadField(serialised, position, field))
+      return std::string();
+    if (field.number != kLegacyRouteHistory && field.number != kRouteHistory &&
+        field.number != kHopsToLive)
+      rewritten.append(serialised, field_begin, position - field_begin);
+  }
+  if (!route_history.empty()) {
+    AppendVarint((kRouteHistory << 3) | kLengthDelimited, rewritten);
+    AppendVarint(route_history.size(), rewritten);
+    rewritten.append(route_history);
+  }
+  AppendVarint((kHopsToLive << 3) | kVarint, rewritten);
+  // Negative int32 values are sign extended to 64 bits on the wire.
+  AppendVarint(static_cast<uint64_t>(static_cast<int64_t>(hops_to_live)), rewritten);
+  return rewritten;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_HEADER_H_
+#define MAIDSAFE_ROUTING_MESSAGE_HEADER_H_
+
+#include <cstdint>
+#include <string>
+
+namespace maidsafe {
+
+namespace routing {
+
+// The routing fields of a serialised protobuf::Message, read straight from the wire format so
+// that a node forwarding the message need not parse or copy its payload.
+struct MessageHeader {
+  MessageHeader();
+  // Returns false if |serialised| is not well-formed at the top level or lacks a required field.
+  bool Decode(const std::string& serialised);
+
+  // |route_history| holds the route history tags, with those of any full IDs an older node sent
+  // ahead of them.
+  std::string source_id, destination_id, relay_id, route_history;
+  int32_t hops_to_live, cacheable, id, type, data_compression;
+  uint64_t unique_id, deadline;
+  bool has_source_id, has_relay_id, has_visited, has_unique_id, has_path_trace, has_deadline;
+  bool routing_message, direct, client_node, request, visited;
+};
+
+// Returns |serialised| with its hops_to_live and route history fields replaced by |hops_to_live|
+// and the tags in |route_history|, copying every other field byte for byte.  Returns an empty
+// string if |serialised| is malformed.
+std::string RewriteForwardedMessage(const std::string& serialised, int32_t hops_to_live,
+                                    const std::string& route_history);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_HEADER_H_
@@ -0,0 +1,103 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_MESSAGE_TRAITS_H_
+#define MAIDSAFE_ROUTING_MESSAGE_TRAITS_H_
+
+#include <cstddef>
+#include <type_traits>
+
+#include "maidsafe/routing/message.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace detail {
+
+// Group Source
+template <typename Messsage>
+struct is_group_source;
+
+template <typename Messsage>
+struct is_group_source : public std::true_type {};
+
+template <>
+struct is_group_source<SingleToSingleMessage> : public std::false_type {};
+template <>
+struct is_group_source<SingleToGroupMessage> : public std::false_type {};
+template <>
+struct is_group_source<GroupToSingleMessage> : public std::true_type {};
+template <>
+struct is_group_source<GroupToGroupMessage> : public std::true_type {};
+template <>
+struct is_group_source<GroupToSingleRelayMessage> : public std::true_type {};
+template <>
+struct is_group_source<SingleToGroupRelayMessage> : public std::false_type {};
+
+// Group Destination
+template <typename Messsage>
+struct is_group_destination;
+
+template <typename Messsage>
+struct is_group_destination : public std::true_type {};
+
+template <>
+struct is_group_destination<SingleToSingleMessage> : public std::false_type {};
+template <>
+struct is_group_destination<SingleToGroupMessage> : public std::true_type {};
+template <>
+struct is_group_destination<GroupToSingleMessage> : public std::false_type {};
+template <>
+struct is_group_destination<GroupToGroupMessage> : public std::true_type {};
+template <>
+struct is_group_destination<GroupToSingleRelayMessage> : public std::false_type {};
+template <>
+struct is_group_destination<SingleToGroupRelayMessage> : public std::true_type {};
+
+// Relayed Source
+template <typename Messsage>
+struct is_relay_source : public std::false_type {};
+
+template <>
+struct is_relay_source<SingleToGroupRelayMessage> : public std::true_type {};
+
+// The kinds of typed message delivered to this node, as indices into a dispatch table.
+const size_t kTypedMessageKindCount = 5;
+
+template <typename Message>
+constexpr size_t TypedMessageKind() {
+  return is_relay_source<Message>::value
+             ? 4
+             : (is_group_source<Message>::value ? 2 : 0) +
+                   (is_group_destination<Message>::value ? 1 : 0);
+}
+
+inline size_t TypedMessageKind(bool group_source, bool group_destination, bool relay_source) {
+  return (relay_source && !group_source && group_destination)
+             ? 4
+             : (group_source ? 2 : 0) + (group_destination ? 1 : 0);
+}
+
+}  // namespace detail
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_MESSAGE_TRAITS_H_
@@ -0,0 +1,137 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/network_coordinates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const size_t kEncodedSize(4);
+// Fractions of the error and of the disagreement by which each sample moves the estimates, scaled
+// by how confident this node is relative to the peer, as in the Vivaldi paper.
+const double kErrorGain(0.25);
+const double kMoveGain(0.25);
+const double kMaxError(1.0);
+const double kMinError(0.001);
+const double kMinHeight(100.0);  // microseconds
+// Round trips are measured in whole milliseconds, so a zero sample stands for half of one.
+const double kMinRoundTrip(500.0);  // microseconds
+
+}  // unnamed namespace
+
+NetworkCoordinates::Coordinate::Coordinate()
+    : x(0.0), y(0.0), height(kMinHeight), error(kMaxError) {}
+
+NetworkCoordinates::Coordinate::Coordinate(const std::vector<int32_t>& encoded)
+    : x(encoded.at(0)), y(encoded.at(1)), height(encoded.at(2)), error(encoded.at(3) / 1000.0) {}
+
+std::vector<int32_t> NetworkCoordinates::Coordinate::Encode() const {
+  std::vector<int32_t> encoded;
+  encoded.push_back(static_cast<int32_t>(std::lround(x)));
+  encoded.push_back(static_cast<int32_t>(std::lround(y)));
+  encoded.push_back(static_cast<int32_t>(std::lround(height)));
+  encoded.push_back(std::max(1, static_cast<int32_t>(std::lround(error * 1000))));
+  return encoded;
+}
+
+NetworkCoordinates::NetworkCoordinates()
+    : mutex_(), local_(), peers_(), remembered_order_() {}
+
+std::vector<int32_t> NetworkCoordinates::Local() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return local_.Encode();
+}
+
+void NetworkCoordinates::Update(const NodeId& peer_id, const std::vector<int32_t>& coordinates,
+                                std::chrono::milliseconds round_trip) {
+  if (!Valid(coordinates))
+    return;
+  const Coordinate kRemote(coordinates);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Remember(peer_id, kRemote);
+  if (round_trip.count() < 0)
+    return;
+
+  const double kRoundTrip(std::max(kMinRoundTrip, round_trip.count() * 1000.0));
+  const double kWeight(local_.error / (local_.error + kRemote.error));
+  const double kDistance(Distance(local_, kRemote));
+  const double kSampleError(std::abs(kDistance - kRoundTrip) / kRoundTrip);
+  const double kErrorStep(kErrorGain * kWeight);
+  const double kError(kSampleError * kErrorStep + local_.error * (1.0 - kErrorStep));
+  local_.error = std::min(kMaxError, std::max(kMinError, kError));
+
+  // Pushed along the line to the peer, or, if the two coincide in the plane, in a direction the
+  // peer's ID picks so that nodes starting at the origin spread apart.
+  double dx(local_.x - kRemote.x), dy(local_.y - kRemote.y);
+  if (dx == 0.0 && dy == 0.0) {
+    const std::string kRawId(peer_id.string());
+    const double kAngle((static_cast<unsigned char>(kRawId[0]) * 256 +
+                         static_cast<unsigned char>(kRawId[1])) * (2 * M_PI / 65536));
+    dx = std::cos(kAngle);
+    dy = std::sin(kAngle);
+  }
+  const double kPlane(std::sqrt(dx * dx + dy * dy));
+  const double kNorm(kPlane + local_.height + kRemote.height);
+  const double kForce(kMoveGain * kWeight * (kRoundTrip - kDistance) / kNorm);
+  local_.x += kForce * dx;
+  local_.y += kForce * dy;
+  local_.height = std::max(kMinHeight,
+                           local_.height + kForce * (local_.height + kRemote.height));
+}
+
+double NetworkCoordinates::PredictedRoundTrip(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(peers_.find(peer_id));
+  if (itr == std::end(peers_))
+    return -1.0;
+  return Distance(local_, itr->second) / 1000.0;
+}
+
+bool NetworkCoordinates::Valid(const std::vector<int32_t>& coordinates) {
+  return coordinates.size() == kEncodedSize && coordinates[2] >= 0 && coordinates[3] > 0 &&
+         coordinates[3] <= kMaxError * 1000;
+}
+
+double NetworkCoordinates::Distance(const Coordinate& lhs, const Coordinate& rhs) {
+  const double kDx(lhs.x - rhs.x), kDy(lhs.y - rhs.y);
+  return std::sqrt(kDx * kDx + kDy * kDy) + lhs.height + rhs.height;
+}
+
+void NetworkCoordinates::Remember(const NodeId& peer_id, const Coordinate& coordinate) {
+  if (peers_.insert(std::make_pair(peer_id, coordinate)).second) {
+    remembered_order_.push_back(peer_id);
+    if (remembered_order_.size() > kMaxRemembered) {
+      peers_.erase(remembered_order_.front());
+      remembered_order_.pop_front();
+    }
+  } else {
+    peers_[peer_id] = coordinate;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
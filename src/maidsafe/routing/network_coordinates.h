@@ -0,0 +1,88 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NETWORK_COORDINATES_H_
+#define MAIDSAFE_ROUTING_NETWORK_COORDINATES_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A Vivaldi network coordinate for this node, a point in a 2D plane plus a height above it, which
+// each measured round trip to a peer nudges towards agreement with that peer's coordinate.  The
+// predicted round trip between two nodes is then the plane distance plus both heights, so the
+// latency to a peer can be estimated before ever connecting to it.  Coordinates are carried as
+// NodeInfo::dimension_list is: x, y and height in microseconds followed by the node's confidence
+// in them, as a relative error in thousandths.  The latest coordinates of a bounded number of
+// peers are remembered.
+class NetworkCoordinates {
+ public:
+  NetworkCoordinates();
+  // this node's coordinate, to advertise
+  std::vector<int32_t> Local() const;
+  // Remembers |coordinates| for |peer_id| and, given a non-negative |round_trip| measured to it,
+  // moves this node's coordinate.  Invalid coordinates are ignored.
+  void Update(const NodeId& peer_id, const std::vector<int32_t>& coordinates,
+              std::chrono::milliseconds round_trip);
+  // In milliseconds; negative if the peer's coordinates aren't known
+  double PredictedRoundTrip(const NodeId& peer_id) const;
+  static bool Valid(const std::vector<int32_t>& coordinates);
+
+ private:
+  struct Coordinate {
+    Coordinate();
+    explicit Coordinate(const std::vector<int32_t>& encoded);
+    std::vector<int32_t> Encode() const;
+    double x, y, height, error;  // microseconds, bar error
+  };
+
+  NetworkCoordinates(const NetworkCoordinates&);
+  NetworkCoordinates& operator=(const NetworkCoordinates&);
+
+  static double Distance(const Coordinate& lhs, const Coordinate& rhs);
+  void Remember(const NodeId& peer_id, const Coordinate& coordinate);
+
+  static const size_t kMaxRemembered = 256;
+
+  mutable std::mutex mutex_;
+  Coordinate local_;
+  std::unordered_map<NodeId, Coordinate, NodeIdHash> peers_;
+  std::deque<NodeId> remembered_order_;  // oldest first
+};
+
+template <typename RepeatedField>
+std::vector<int32_t> CoordinatesFrom(const RepeatedField& field) {
+  return std::vector<int32_t>(field.begin(), field.end());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NETWORK_COORDINATES_H_
@@ -21,6 +21,7 @@
 #include <string>
 #include <algorithm>
 
+#include "maidsafe/routing/distance.h"
 #include "maidsafe/routing/parameters.h"
 
 namespace maidsafe {
@@ -28,65 +29,144 @@ namespace maidsafe {
 namespace routing {
 
 NetworkStatistics::NetworkStatistics(NodeId node_id)
-    : mutex_(), kNodeId_(std::move(node_id)), distance_(), network_distance_data_() {}
+    : mutex_("NetworkStatistics::mutex_"),
+      kNodeId_(std::move(node_id)),
+      network_distance_data_(),
+      estimate_(std::make_shared<Estimate>()),
+      peer_latencies_mutex_(),
+      peer_latencies_() {}
 
 void NetworkStatistics::UpdateLocalAverageDistance(std::vector<NodeId>& unique_nodes) {
   if (unique_nodes.size() < Parameters::group_size)
     return;
-#ifndef __GNUC__
-  std::nth_element(unique_nodes.begin(), unique_nodes.begin() + Parameters::group_size,
-                   unique_nodes.end(), [&](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, kNodeId_);
-  });
-#else
-  // BEFORE_RELEASE use std::nth_element() for all platform when min required Gcc version is 4.8.3
-  // http://gcc.gnu.org/bugzilla/show_bug.cgi?id=58800 Bug fixed in gcc 4.8.3
-  std::partial_sort(unique_nodes.begin(), unique_nodes.begin() + Parameters::group_size,
-                    unique_nodes.end(), [&](const NodeId & lhs, const NodeId & rhs) {
-    return NodeId::CloserToTarget(lhs, rhs, kNodeId_);
-  });
-#endif
+  PartialSortByDistance(unique_nodes, kNodeId_, Parameters::group_size);
   NodeId furthest_group_node(unique_nodes.at(
       std::min(Parameters::group_size - 1, static_cast<int>(unique_nodes.size()))));
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    distance_ = furthest_group_node ^ kNodeId_;
+    std::lock_guard<HotPathMutex> lock(mutex_);
+    PublishEstimate(furthest_group_node ^ kNodeId_, GetEstimate()->average_distance, lock);
   }
 }
 
 void NetworkStatistics::UpdateNetworkAverageDistance(const NodeId& distance) {
   if (distance == NodeId())
     return;
-  crypto::BigInt distance_integer(
-      (distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
+  DistanceUint distance_integer(distance);
   {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<HotPathMutex> lock(mutex_);
+    auto& samples(network_distance_data_.samples);
+    const size_t kWindowSize(std::max(static_cast<size_t>(1),
+                                      static_cast<size_t>(
+                                          Parameters::network_distance_window_size)));
+    if (samples.size() > kWindowSize) {  // the window has been shrunk
+      samples.clear();
+      network_distance_data_.next_sample = 0;
+      network_distance_data_.total_distance = DistanceUint();
+    }
+    if (samples.size() < kWindowSize) {
+      samples.push_back(distance_integer);
+    } else {
+      network_distance_data_.total_distance -= samples[network_distance_data_.next_sample];
+      samples[network_distance_data_.next_sample] = distance_integer;
+      network_distance_data_.next_sample = (network_distance_data_.next_sample + 1) % kWindowSize;
+    }
     network_distance_data_.total_distance += distance_integer;
-    auto average(network_distance_data_.total_distance /
-                 ++network_distance_data_.contributors_count);
-    std::string average_str(NodeId::kSize, '\0');
-    for (auto index(NodeId::kSize - 1); index >= 0; --index)
-      average_str[NodeId::kSize - 1 - index] = average.GetByte(index);
-    network_distance_data_.average_distance = NodeId(average_str);
+    auto average(network_distance_data_.total_distance / static_cast<uint32_t>(samples.size()));
+    PublishEstimate(GetEstimate()->distance, average.ToNodeId(), lock);
   }
 }
 
 // FIXME(Prakash) handle the case of sender_id == info_id
-bool NetworkStatistics::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) {
-  NodeId local_distance;
+bool NetworkStatistics::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const {
+  return DistanceUint(info_id, sender_id) <= GetEstimate()->in_group_distance;
+}
+
+NodeId NetworkStatistics::GetDistance() const { return GetEstimate()->distance; }
+
+DistanceUint NetworkStatistics::GetInGroupDistance() const {
+  return GetEstimate()->in_group_distance;
+}
+
+std::shared_ptr<const NetworkStatistics::Estimate> NetworkStatistics::GetEstimate() const {
+  return std::atomic_load(&estimate_);
+}
+
+void NetworkStatistics::PublishEstimate(const NodeId& distance, const NodeId& average_distance,
+                                        std::lock_guard<HotPathMutex>& lock) {
+  static_cast<void>(lock);
+  auto estimate(std::make_shared<Estimate>());
+  estimate->distance = distance;
+  estimate->in_group_distance = DistanceUint(distance) * Parameters::accepted_distance_tolerance;
+  estimate->average_distance = average_distance;
+  std::atomic_store(&estimate_, std::shared_ptr<const Estimate>(estimate));
+}
+
+void NetworkStatistics::RecordRoundTrip(const NodeId& peer_id,
+                                        std::chrono::milliseconds round_trip) {
+  if (round_trip.count() < 0)
+    return;
+  // Weighted as TCP's SRTT, so that a single slow response doesn't swing peer selection.
+  const double kGain(1.0 / 8);
+  std::lock_guard<std::mutex> lock(peer_latencies_mutex_);
+  PeerLatency& latency(peer_latencies_[peer_id]);
+  double sample(static_cast<double>(round_trip.count()));
+  latency.round_trip = (latency.round_trip < 0)
+                           ? sample
+                           : latency.round_trip + kGain * (sample - latency.round_trip);
+}
+
+void NetworkStatistics::RecordSendResult(const NodeId& peer_id, bool success) {
+  const double kGain(1.0 / 16);
+  std::lock_guard<std::mutex> lock(peer_latencies_mutex_);
+  PeerLatency& latency(peer_latencies_[peer_id]);
+  latency.loss += kGain * ((success ? 0.0 : 1.0) - latency.loss);
+}
+
+void NetworkStatistics::RemovePeer(const NodeId& peer_id) {
+  std::lock_guard<std::mutex> lock(peer_latencies_mutex_);
+  peer_latencies_.erase(peer_id);
+}
+
+double NetworkStatistics::RoundTrip(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(peer_latencies_mutex_);
+  auto itr(peer_latencies_.find(peer_id));
+  return itr == std::end(peer_latencies_) ? -1.0 : itr->second.round_trip;
+}
+
+size_t NetworkStatistics::GetFastestPeer(const std::vector<NodeId>& candidates) const {
+  // A lost message costs roughly one more round trip, so the expected delivery time is
+  // round_trip / (1 - loss), with loss capped to keep the estimate finite.
+  const double kMaxLoss(0.9);
+  std::vector<double> expected(candidates.size(), -1.0), loss(candidates.size(), 0.0);
+  double total_round_trip(0.0);
+  size_t measured(0);
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    local_distance = distance_;
+    std::lock_guard<std::mutex> lock(peer_latencies_mutex_);
+    for (size_t i(0); i != candidates.size(); ++i) {
+      auto itr(peer_latencies_.find(candidates[i]));
+      if (itr == std::end(peer_latencies_))
+        continue;
+      loss[i] = std::min(itr->second.loss, kMaxLoss);
+      if (itr->second.round_trip >= 0) {
+        expected[i] = itr->second.round_trip;
+        total_round_trip += expected[i];
+        ++measured;
+      }
+    }
   }
-  return crypto::BigInt(
-             ((info_id ^ sender_id).ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) <=
-         crypto::BigInt(
-             (local_distance.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-             Parameters::accepted_distance_tolerance;
+  const double kMeanRoundTrip(measured == 0 ? 0.0 : total_round_trip / measured);
+  size_t fastest(0);
+  double fastest_expected(0.0);
+  for (size_t i(0); i != candidates.size(); ++i) {
+    double candidate_expected((expected[i] < 0 ? kMeanRoundTrip : expected[i]) / (1.0 - loss[i]));
+    if (i == 0 || candidate_expected < fastest_expected) {
+      fastest = i;
+      fastest_expected = candidate_expected;
+    }
+  }
+  return fastest;
 }
 
-NodeId NetworkStatistics::GetDistance() { return distance_; }
-
 }  // namespace routing
 
 }  // namespace maidsafe
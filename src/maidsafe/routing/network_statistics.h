@@ -19,12 +19,20 @@
 #ifndef MAIDSAFE_ROUTING_NETWORK_STATISTICS_H_
 #define MAIDSAFE_ROUTING_NETWORK_STATISTICS_H_
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "maidsafe/common/crypto.h"
 
 #include "maidsafe/common/node_id.h"
+#include "maidsafe/routing/fixed_uint.h"
+#include "maidsafe/routing/node_id_hash.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/profiled_mutex.h"
 
 namespace maidsafe {
 
@@ -33,31 +41,67 @@ namespace routing {
 namespace test {
 class NetworkStatisticsTest_BEH_AverageDistance_Test;
 class NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
+class NetworkStatisticsTest_BEH_PeerLatency_Test;
 }
 
 class NetworkStatistics {
  public:
   explicit NetworkStatistics(NodeId node_id);
   void UpdateLocalAverageDistance(std::vector<NodeId>& unique_nodes);
+  // Adds a sample to the window of the last Parameters::network_distance_window_size received
   void UpdateNetworkAverageDistance(const NodeId& distance);
-  bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id);
-  NodeId GetDistance();
+  // Neither of these takes a lock
+  bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const;
+  NodeId GetDistance() const;
+  // Largest distance between a sender and an ID for EstimateInGroup() to accept it
+  DistanceUint GetInGroupDistance() const;
+
+  // Smoothed round trip time and send loss rate of connected peers
+  void RecordRoundTrip(const NodeId& peer_id, std::chrono::milliseconds round_trip);
+  void RecordSendResult(const NodeId& peer_id, bool success);
+  void RemovePeer(const NodeId& peer_id);
+  // In milliseconds; negative until the peer's first sample
+  double RoundTrip(const NodeId& peer_id) const;
+  // Index into |candidates| of the peer expected to deliver soonest, allowing for retransmission
+  // after loss.  Unmeasured peers are taken to be as fast as the mean of the measured ones, and
+  // ties go to the earlier candidate.
+  size_t GetFastestPeer(const std::vector<NodeId>& candidates) const;
 
   friend class test::NetworkStatisticsTest_BEH_AverageDistance_Test;
   friend class test::NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
+  friend class test::NetworkStatisticsTest_BEH_PeerLatency_Test;
 
  private:
   NetworkStatistics(const NetworkStatistics&);
   NetworkStatistics& operator=(const NetworkStatistics&);
+  // Immutable; the writers publish a new one on each update
+  struct Estimate {
+    Estimate() : distance(), in_group_distance(), average_distance() {}
+    NodeId distance;  // from kNodeId_ to the furthest node of its group
+    DistanceUint in_group_distance;  // distance * Parameters::accepted_distance_tolerance
+    NodeId average_distance;  // over the sample window
+  };
   struct NetworkDistanceData {
-    NetworkDistanceData() : contributors_count(), total_distance(), average_distance() {}
-    crypto::BigInt contributors_count, total_distance;
-    NodeId average_distance;
+    NetworkDistanceData() : samples(), next_sample(0), total_distance() {}
+    std::vector<DistanceUint> samples;  // ring of the most recent samples
+    size_t next_sample;
+    DistanceUint total_distance;  // of samples
+  };
+  struct PeerLatency {
+    PeerLatency() : round_trip(-1.0), loss(0.0) {}
+    double round_trip;  // milliseconds; negative until the first sample
+    double loss;  // fraction of recent sends which failed
   };
-  std::mutex mutex_;
+  std::shared_ptr<const Estimate> GetEstimate() const;
+  void PublishEstimate(const NodeId& distance, const NodeId& average_distance,
+                       std::lock_guard<HotPathMutex>& lock);
+
+  HotPathMutex mutex_;  // serialises the writers
   const NodeId kNodeId_;
-  NodeId distance_;
   NetworkDistanceData network_distance_data_;
+  std::shared_ptr<const Estimate> estimate_;
+  mutable std::mutex peer_latencies_mutex_;
+  std::unordered_map<NodeId, PeerLatency, NodeIdHash> peer_latencies_;
 };
 
 }  // namespace routing
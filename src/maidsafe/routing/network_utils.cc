@@ -18,6 +18,10 @@
 
 #include "maidsafe/routing/network_utils.h"
 
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
 #include "boost/date_time/posix_time/posix_time_config.hpp"
 
 #include "maidsafe/common/log.h"
@@ -27,10 +31,15 @@
 #include "maidsafe/routing/bootstrap_file_operations.h"
 #include "maidsafe/routing/bootstrap_utils.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/data_compression.h"
+#include "maidsafe/routing/object_pool.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/path_trace.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/rpcs.h"
+#include "maidsafe/routing/trace.h"
 #include "maidsafe/routing/utils.h"
 
 namespace bptime = boost::posix_time;
@@ -42,27 +51,127 @@ namespace {
 typedef boost::asio::ip::udp::endpoint Endpoint;
 typedef boost::shared_lock<boost::shared_mutex> SharedLock;
 typedef boost::unique_lock<boost::shared_mutex> UniqueLock;
+typedef routing::ObjectPool<routing::protobuf::Message> MessagePool;
+
+// A peer which fails this many attempts to send the same message is dropped.
+const size_t kMaxSendFailuresPerPeer(3);
+
+uint64_t RoutePrefix(const NodeId& destination_id) {
+  const std::string kRawId(destination_id.string());
+  uint64_t prefix(0);
+  for (size_t i(0); i != sizeof(prefix) && i != kRawId.size(); ++i)
+    prefix = (prefix << 8) | static_cast<unsigned char>(kRawId[i]);
+  const uint16_t kBits(std::min<uint16_t>(routing::Parameters::route_cache_prefix_bits, 64));
+  return kBits == 0 ? 0 : prefix >> (64 - kBits);
+}
+
+struct DeliveryCount {
+  explicit DeliveryCount(size_t attempts) : mutex(), outstanding(attempts), reported(false) {}
+  std::mutex mutex;
+  size_t outstanding;
+  bool reported;
+};
+
+// Wraps |delivered| for a message sent |attempts| times, so that it is called once: with true at
+// the first success, else with false once every attempt has failed.
+routing::DeliveryFunctor ReportOnce(const routing::DeliveryFunctor& delivered, size_t attempts) {
+  if (!delivered || attempts < 2)
+    return delivered;
+  std::shared_ptr<DeliveryCount> count(std::make_shared<DeliveryCount>(attempts));
+  return [delivered, count](bool success) {
+    {
+      std::lock_guard<std::mutex> lock(count->mutex);
+      --count->outstanding;
+      if (count->reported || (!success && count->outstanding != 0))
+        return;
+      count->reported = true;
+    }
+    delivered(success);
+  };
+}
 
 }  // anonymous namespace
 
 namespace routing {
 
-NetworkUtils::NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table)
+NetworkUtils::NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+                           AsioService& asio_service)
     : running_(true),
-      running_mutex_(),
+      running_mutex_("NetworkUtils::running_mutex_"),
+      asio_service_(asio_service),
+      timer_guard_(std::make_shared<TimerGuard>()),
+      outbound_mutex_(),
+      outbound_batches_(),
+      window_mutex_(),
+      peer_windows_(),
+      queued_count_(0),
+      congested_(false),
+      congestion_functor_(),
+      route_cache_mutex_(),
+      route_cache_(),
+      bootstrap_contacts_mutex_(),
       bootstrap_attempt_(0),
       bootstrap_contacts_(),
+      bootstrap_ranking_(),
+      bootstrap_contact_(),
+      peer_endpoints_mutex_(),
+      peer_endpoints_(),
+      compression_peers_mutex_(),
+      compression_peers_(),
+      pending_requests_(Parameters::default_response_timeout),
+      metrics_(),
       bootstrap_connection_id_(),
       this_node_relay_connection_id_(),
       routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       nat_type_(rudp::NatType::kUnknown),
       new_bootstrap_contact_(),
-      rudp_() {}
+      liveness_(),
+      suspected_dead_functor_(),
+      liveness_timer_(asio_service.service()),
+      shortcuts_(Parameters::max_shortcuts, Parameters::shortcut_message_threshold,
+                 Parameters::shortcut_window),
+      shortcut_functor_(),
+      shortcut_timer_(asio_service.service()),
+      transport_(new RudpTransport) {}
 
 NetworkUtils::~NetworkUtils() {
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(timer_guard_->mutex);
+    timer_guard_->running = false;
+  }
+  std::vector<rudp::MessageSentFunctor> unsent;
+  {
+    std::lock_guard<std::mutex> lock(outbound_mutex_);
+    for (auto& batch : outbound_batches_) {
+      batch.second->flush_timer.cancel();
+      for (auto& message_sent_functor : batch.second->message_sent_functors)
+        unsent.push_back(std::move(message_sent_functor));
+    }
+    outbound_batches_.clear();
+  }
+  {
+    std::lock_guard<std::mutex> lock(window_mutex_);
+    for (auto& window : peer_windows_) {
+      for (auto& queued_send : window.second.responses)
+        unsent.push_back(std::move(queued_send.message_sent_functor));
+      for (auto& queued_send : window.second.requests)
+        unsent.push_back(std::move(queued_send.message_sent_functor));
+    }
+    peer_windows_.clear();
+    queued_count_ = 0;
+  }
+  liveness_timer_.cancel();
+  shortcut_timer_.cancel();
+  {
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    running_ = false;
+  }
+  // Messages still waiting in a batch or a window will never be sent, so their senders are told.
+  for (const auto& message_sent_functor : unsent) {
+    if (message_sent_functor)
+      message_sent_functor(kNetworkShuttingDown);
+  }
 }
 
 int NetworkUtils::Bootstrap(const BootstrapContacts& bootstrap_contacts,
@@ -70,7 +179,7 @@ int NetworkUtils::Bootstrap(const BootstrapContacts& bootstrap_contacts,
                             const rudp::ConnectionLostFunctor& connection_lost_functor,
                             Endpoint local_endpoint) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return kNetworkShuttingDown;
   }
@@ -80,33 +189,69 @@ int NetworkUtils::Bootstrap(const BootstrapContacts& bootstrap_contacts,
   auto private_key(std::make_shared<asymm::PrivateKey>(routing_table_.kPrivateKey()));
   auto public_key(std::make_shared<asymm::PublicKey>(routing_table_.kPublicKey()));
 
-  if (!bootstrap_contacts.empty())
-    bootstrap_contacts_ = bootstrap_contacts;
+  BootstrapContacts ranked;
+  {
+    std::lock_guard<std::mutex> lock(bootstrap_contacts_mutex_);
+    if (!bootstrap_contacts.empty())
+      bootstrap_contacts_ = bootstrap_contacts;
 
-  if (Parameters::append_maidsafe_endpoints && bootstrap_attempt_ == 0) {
-    LOG(kInfo) << "Appending Maidsafe Endpoints";
-    auto maidsafe_bootstrap_contacts(MaidSafeBootstrapContacts());
-    bootstrap_contacts_.insert(bootstrap_contacts_.end(), maidsafe_bootstrap_contacts.begin(),
-                                maidsafe_bootstrap_contacts.end());
-  } else if (Parameters::append_maidsafe_local_endpoints && bootstrap_attempt_ == 0) {
-    auto maidsafe_local_bootstrap_contacts(MaidSafeLocalBootstrapContacts());
-    bootstrap_contacts_.insert(bootstrap_contacts_.end(),
-                                maidsafe_local_bootstrap_contacts.begin(),
-                                maidsafe_local_bootstrap_contacts.end());
-  }
+    if (Parameters::append_maidsafe_endpoints && bootstrap_attempt_ == 0) {
+      LOG(kInfo) << "Appending Maidsafe Endpoints";
+      auto maidsafe_bootstrap_contacts(MaidSafeBootstrapContacts());
+      bootstrap_contacts_.insert(bootstrap_contacts_.end(), maidsafe_bootstrap_contacts.begin(),
+                                  maidsafe_bootstrap_contacts.end());
+    } else if (Parameters::append_maidsafe_local_endpoints && bootstrap_attempt_ == 0) {
+      auto maidsafe_local_bootstrap_contacts(MaidSafeLocalBootstrapContacts());
+      bootstrap_contacts_.insert(bootstrap_contacts_.end(),
+                                  maidsafe_local_bootstrap_contacts.begin(),
+                                  maidsafe_local_bootstrap_contacts.end());
+    }
 
-  if (Parameters::append_local_live_port_endpoint && bootstrap_attempt_ == 0) {
-    bootstrap_contacts_.push_back(Endpoint(GetLocalIp(), kLivePort));
-    LOG(kInfo) << "Appending local live port endpoints: " << bootstrap_contacts_.back();
-  }
+    if (Parameters::append_local_live_port_endpoint && bootstrap_attempt_ == 0) {
+      bootstrap_contacts_.push_back(Endpoint(GetLocalIp(), kLivePort));
+      LOG(kInfo) << "Appending local live port endpoints: " << bootstrap_contacts_.back();
+    }
 
-  if (bootstrap_contacts_.empty())
-    return kInvalidBootstrapContacts;
+    if (bootstrap_contacts_.empty())
+      return kInvalidBootstrapContacts;
 
-  int result(rudp_.Bootstrap(/* sorted_ */ bootstrap_contacts_, message_received_functor,
-                             connection_lost_functor, routing_table_.kConnectionId(), private_key,
-                             public_key, bootstrap_connection_id_, nat_type_, local_endpoint));
-  ++bootstrap_attempt_;
+    ranked = bootstrap_contacts_;
+    bootstrap_ranking_.Order(ranked);
+    bootstrap_contact_ = BootstrapContact();
+  }
+  int result(kNoOnlineBootstrapContacts);
+  for (const auto& wave : BootstrapRanking::Waves(ranked, Parameters::bootstrap_first_wave_size)) {
+    {
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
+      if (!running_)
+        return kNetworkShuttingDown;
+    }
+    const auto kStart(RoutingClock::now());
+    result = transport_->Bootstrap(wave, message_received_functor, connection_lost_functor,
+                                   routing_table_.kConnectionId(), private_key, public_key,
+                                   bootstrap_connection_id_, nat_type_, local_endpoint);
+    if (result == kSuccess) {
+      // Which contact of a larger wave answered isn't known, so only single-contact waves are
+      // credited.
+      if (wave.size() == 1 && !bootstrap_connection_id_.IsZero()) {
+        {
+          std::lock_guard<std::mutex> lock(bootstrap_contacts_mutex_);
+          bootstrap_contact_ = wave.front();
+        }
+        bootstrap_ranking_.RecordSuccess(
+            wave.front(), std::chrono::duration_cast<std::chrono::milliseconds>(
+                              RoutingClock::now() - kStart));
+      }
+      break;
+    }
+    for (const auto& contact : wave)
+      bootstrap_ranking_.RecordFailure(contact);
+    LOG(kVerbose) << "No contact of a wave of " << wave.size() << " answered";
+  }
+  {
+    std::lock_guard<std::mutex> lock(bootstrap_contacts_mutex_);
+    ++bootstrap_attempt_;
+  }
   // RUDP will return a kZeroId for zero state !!
   if (result != kSuccess || bootstrap_connection_id_.IsZero()) {
     LOG(kError) << "No Online Bootstrap Node found.";
@@ -124,33 +269,40 @@ int NetworkUtils::GetAvailableEndpoint(const NodeId& peer_id,
                                        rudp::EndpointPair& this_endpoint_pair,
                                        rudp::NatType& this_nat_type) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return kNetworkShuttingDown;
   }
-  return rudp_.GetAvailableEndpoint(peer_id, peer_endpoint_pair, this_endpoint_pair, this_nat_type);
+  return transport_->GetAvailableEndpoint(peer_id, peer_endpoint_pair, this_endpoint_pair,
+                                          this_nat_type);
 }
 
 int NetworkUtils::Add(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
                       const std::string& validation_data) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return kNetworkShuttingDown;
   }
-  return rudp_.Add(peer_id, peer_endpoint_pair, validation_data);
+  return transport_->Add(peer_id, peer_endpoint_pair, validation_data);
 }
 
 int NetworkUtils::MarkConnectionAsValid(const NodeId& peer_id) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return kNetworkShuttingDown;
   }
   Endpoint new_bootstrap_endpoint;
-  int ret_val(rudp_.MarkConnectionAsValid(peer_id, new_bootstrap_endpoint));
+  int ret_val(transport_->MarkConnectionAsValid(peer_id, new_bootstrap_endpoint));
+  if (ret_val == kSuccess)
+    liveness_.Add(peer_id, RoutingClock::now());
   if ((ret_val == kSuccess) && !new_bootstrap_endpoint.address().is_unspecified()) {
     LOG(kVerbose) << "Found usable endpoint for bootstrapping : " << new_bootstrap_endpoint;
+    {
+      std::lock_guard<std::mutex> lock(peer_endpoints_mutex_);
+      peer_endpoints_[peer_id] = new_bootstrap_endpoint;
+    }
     // TODO(Prakash): Is separate thread needed here ?
     if (new_bootstrap_contact_)
       new_bootstrap_contact_(new_bootstrap_endpoint);
@@ -160,25 +312,74 @@ int NetworkUtils::MarkConnectionAsValid(const NodeId& peer_id) {
 
 void NetworkUtils::Remove(const NodeId& peer_id) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return;
   }
-  rudp_.Remove(peer_id);
+  {
+    std::lock_guard<std::mutex> lock(peer_endpoints_mutex_);
+    peer_endpoints_.erase(peer_id);
+  }
+  {
+    std::lock_guard<std::mutex> lock(compression_peers_mutex_);
+    compression_peers_.erase(peer_id);
+  }
+  liveness_.Remove(peer_id);
+  transport_->Remove(peer_id);
+}
+
+Endpoint NetworkUtils::PeerEndpoint(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(peer_endpoints_mutex_);
+  auto found(peer_endpoints_.find(peer_id));
+  return found == peer_endpoints_.end() ? Endpoint() : found->second;
+}
+
+void NetworkUtils::SetDecodableCompression(const NodeId& peer_id,
+                                           uint32_t decodable_compression) {
+  std::lock_guard<std::mutex> lock(compression_peers_mutex_);
+  if ((decodable_compression & DecodableCompression()) != 0)
+    compression_peers_.insert(peer_id);
+  else
+    compression_peers_.erase(peer_id);
+}
+
+bool NetworkUtils::DecodesCompression(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(compression_peers_mutex_);
+  return compression_peers_.count(peer_id) != 0;
 }
 
 void NetworkUtils::RudpSend(const NodeId& peer_id, const protobuf::Message& message,
                             const rudp::MessageSentFunctor& message_sent_functor) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return;
   }
-  rudp_.Send(peer_id, message.SerializeAsString(), message_sent_functor);
-  LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId())
-                << "] send : " << MessageTypeString(message) << " to   " << DebugId(peer_id)
-                << "   (id: " << message.id() << ")"
-                << " --To Rudp--";
+  // A payload is compressed for the first peer which decodes it, and stays so until it reaches one
+  // which doesn't.
+  const bool kCompressed(message.has_data_compression());
+  if (kCompressed != DecodesCompression(peer_id) && (kCompressed || IsCompressible(message))) {
+    protobuf::Message recoded(message);
+    if (kCompressed && !UncompressData(recoded)) {
+      LOG(kWarning) << "Dropping message with an undecodable payload for " << DebugId(peer_id)
+                    << " id: " << message.id();
+      return;
+    }
+    if (kCompressed || CompressData(recoded))
+      return RudpSend(peer_id, recoded, message_sent_functor);
+  }
+  std::string serialised_message(message.SerializeAsString());
+  metrics_.Add(RoutingMetrics::kSent, message.type());
+  metrics_.Add(RoutingMetrics::kBytesSent, message.type(), serialised_message.size());
+  Send(peer_id, std::move(serialised_message),
+       PriorityOf(IsRoutingMessage(message), IsRequest(message)), message_sent_functor);
+  ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kForwarded, message, peer_id.string());
+  if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+    LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId())
+                  << "] send : " << MessageTypeString(message) << " to   " << DebugId(peer_id)
+                  << "   (id: " << message.id() << ")"
+                  << " --To Rudp--";
+  }
 }
 
 void NetworkUtils::SendToDirect(const protobuf::Message& message, const NodeId& peer_connection_id,
@@ -198,6 +399,16 @@ void NetworkUtils::SendToDirectAdjustedRoute(protobuf::Message& message, const N
 }
 
 void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
+  DoSendToClosestNode(message, DeliveryFunctor());
+}
+
+void NetworkUtils::SendToClosestNode(const protobuf::Message& message,
+                                     const DeliveryFunctor& delivered) {
+  DoSendToClosestNode(message, delivered);
+}
+
+void NetworkUtils::DoSendToClosestNode(const protobuf::Message& message,
+                                       const DeliveryFunctor& delivered) {
   // Normal messages
   if (message.has_destination_id() && !message.destination_id().empty()) {
     auto client_routing_nodes(client_routing_table_.GetNodesInfo(NodeId(message.destination_id())));
@@ -207,6 +418,8 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
         LOG(kWarning) << "This node [" << DebugId(routing_table_.kNodeId())
                       << " Dropping message as client to client message not allowed."
                       << PrintMessage(message);
+        if (delivered)
+          delivered(false);
         return;
       }
       LOG(kVerbose) << "This node [" << DebugId(routing_table_.kNodeId()) << "] has "
@@ -214,17 +427,26 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
                     << " destination node(s) in its non-routing table."
                     << " id: " << message.id();
 
+      // Every connection of the destination node is sent the same bytes.
+      EncodedMessage encoded_message(message);
+      DeliveryFunctor delivered_once(ReportOnce(delivered, client_routing_nodes.size()));
       for (const auto& i : client_routing_nodes) {
         LOG(kVerbose) << "Sending message to NRT node with ID " << message.id() << " node_id "
                       << DebugId(i.node_id) << " connection id " << DebugId(i.connection_id);
-        SendTo(message, i.node_id, i.connection_id);
+        if (delivered_once)
+          SendEncodedToDirect(encoded_message, i.node_id, i.connection_id, delivered_once);
+        else
+          SendEncodedToDirect(encoded_message, i.node_id, i.connection_id);
       }
     } else if (routing_table_.size() > 0) {  // getting closer nodes from routing table
-      RecursiveSendOn(message);
+      if (!SendViaShortcut(message, delivered))
+        RecursiveSendOn(message, delivered);
     } else {
       LOG(kError) << " No endpoint to send to; aborting send.  Attempt to send a type "
                   << MessageTypeString(message) << " message to " << HexSubstr(message.source_id())
                   << " from " << DebugId(routing_table_.kNodeId()) << " id: " << message.id();
+      if (delivered)
+        delivered(false);
     }
     return;
   }
@@ -233,152 +455,770 @@ void NetworkUtils::SendToClosestNode(const protobuf::Message& message) {
   if (message.has_relay_id() /*&& (IsResponse(message))*/) {
     protobuf::Message relay_message(message);
     relay_message.set_destination_id(message.relay_id());  // so that peer identifies it as direct
-    SendTo(relay_message, NodeId(relay_message.relay_id()),
-           NodeId(relay_message.relay_connection_id()));
+    // A relayed node which has since joined may have dropped its bootstrap connection, so is sent
+    // to over the connection it joined with.
+    const NodeId kRelayId(relay_message.relay_id());
+    NodeInfo joined_node;
+    auto joined_clients(client_routing_table_.GetNodesInfo(kRelayId));
+    if (routing_table_.GetNodeInfo(kRelayId, joined_node)) {
+      SendTo(relay_message, kRelayId, joined_node.connection_id, delivered);
+    } else if (!joined_clients.empty()) {
+      SendTo(relay_message, kRelayId, joined_clients.front().connection_id, delivered);
+    } else {
+      SendTo(relay_message, kRelayId, NodeId(relay_message.relay_connection_id()), delivered);
+    }
   } else {
     LOG(kError) << "Unable to work out destination; aborting send."
                 << " id: " << message.id() << " message.has_relay_id() ; " << std::boolalpha
                 << message.has_relay_id() << " Isresponse(message) : " << std::boolalpha
                 << IsResponse(message) << " message.has_relay_connection_id() : " << std::boolalpha
                 << message.has_relay_connection_id();
+    if (delivered)
+      delivered(false);
   }
 }
 
-void NetworkUtils::SendTo(const protobuf::Message& message, const NodeId& peer_node_id,
-                          const NodeId& peer_connection_id) {
-  const std::string kThisId(routing_table_.kNodeId().string());
-  rudp::MessageSentFunctor message_sent_functor = [=](int message_sent) {
-    if (rudp::kSuccess == message_sent) {
-      LOG(kVerbose) << "  [" << HexSubstr(kThisId) << "] sent : " << MessageTypeString(message)
-                    << " to   " << DebugId(peer_node_id) << "   (id: " << message.id() << ")";
+NetworkUtils::SendPriority NetworkUtils::PriorityOf(bool routing_message, bool request) {
+  if (routing_message)
+    return SendPriority::kControl;
+  return request ? SendPriority::kRequest : SendPriority::kResponse;
+}
+
+void NetworkUtils::Send(const NodeId& peer_id, std::string serialised_message,
+                        SendPriority priority,
+                        const rudp::MessageSentFunctor& message_sent_functor) {
+  if (Parameters::coalesce_flush_delay == std::chrono::milliseconds(0))
+    return SendInWindow(peer_id, std::move(serialised_message), priority, message_sent_functor);
+  // Routing messages aren't held back waiting for a batch to fill, but anything already waiting
+  // for the peer goes ahead of them, so that messages to it leave in the order they were sent.
+  if (priority == SendPriority::kControl ||
+      serialised_message.size() > Parameters::coalesced_message_size_limit) {
+    std::shared_ptr<OutboundBatch> waiting_batch;
+    {
+      std::lock_guard<std::mutex> lock(outbound_mutex_);
+      auto itr(outbound_batches_.find(peer_id));
+      if (itr != std::end(outbound_batches_)) {
+        waiting_batch.swap(itr->second);
+        outbound_batches_.erase(itr);
+        waiting_batch->flush_timer.cancel();
+      }
+    }
+    if (waiting_batch)
+      SendBatch(peer_id, *waiting_batch);
+    return SendInWindow(peer_id, std::move(serialised_message), priority, message_sent_functor);
+  }
+
+  std::shared_ptr<OutboundBatch> full_batch;
+  {
+    std::lock_guard<std::mutex> lock(outbound_mutex_);
+    std::shared_ptr<OutboundBatch>& batch(outbound_batches_[peer_id]);
+    if (batch && batch->size + serialised_message.size() > Parameters::max_coalesced_batch_size) {
+      full_batch.swap(batch);
+      full_batch->flush_timer.cancel();
+    }
+    if (!batch) {
+      batch = std::make_shared<OutboundBatch>(asio_service_.service());
+      ArmBatchFlush(peer_id, batch);
+    }
+    batch->size += serialised_message.size();
+    batch->priority = std::min(batch->priority, priority);
+    batch->messages.push_back(std::move(serialised_message));
+    batch->message_sent_functors.push_back(message_sent_functor);
+  }
+  if (full_batch)
+    SendBatch(peer_id, *full_batch);
+}
+
+void NetworkUtils::ArmBatchFlush(const NodeId& peer_id,
+                                 const std::shared_ptr<OutboundBatch>& batch) {
+  batch->flush_timer.expires_from_now(Parameters::coalesce_flush_delay);
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  // The batch owns the timer, so the handler only holds it weakly.
+  std::weak_ptr<OutboundBatch> weak_batch(batch);
+  batch->flush_timer.async_wait([this, weak_guard, weak_batch, peer_id](
+      const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted)
+      return;
+    std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+    std::shared_ptr<OutboundBatch> batch(weak_batch.lock());
+    if (!guard || !batch)
+      return;
+    std::lock_guard<std::mutex> guard_lock(guard->mutex);
+    if (!guard->running)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(outbound_mutex_);
+      auto itr(outbound_batches_.find(peer_id));
+      // The batch may already have been sent on filling up.
+      if (itr == std::end(outbound_batches_) || itr->second != batch)
+        return;
+      outbound_batches_.erase(itr);
+    }
+    SendBatch(peer_id, *batch);
+  });
+}
+
+void NetworkUtils::SendBatch(const NodeId& peer_id, OutboundBatch& batch) {
+  if (batch.messages.size() == 1) {
+    return SendInWindow(peer_id, std::move(batch.messages.front()), batch.priority,
+                        batch.message_sent_functors.front());
+  }
+
+  std::vector<rudp::MessageSentFunctor> message_sent_functors;
+  message_sent_functors.swap(batch.message_sent_functors);
+  SendInWindow(peer_id, SerializeMessageBatch(batch.messages), batch.priority,
+               [message_sent_functors](int message_sent) {
+                 for (const auto& message_sent_functor : message_sent_functors) {
+                   if (message_sent_functor)
+                     message_sent_functor(message_sent);
+                 }
+               });
+}
+
+void NetworkUtils::SendInWindow(const NodeId& peer_id, std::string serialised_message,
+                                SendPriority priority,
+                                const rudp::MessageSentFunctor& message_sent_functor) {
+  bool send_now(false), dropped(false), now_congested(false);
+  rudp::MessageSentFunctor dropped_functor;
+  {
+    std::lock_guard<std::mutex> lock(window_mutex_);
+    PeerWindow& window(peer_windows_[peer_id]);
+    if (priority == SendPriority::kControl ||
+        window.in_flight < Parameters::max_in_flight_per_peer) {
+      ++window.in_flight;
+      send_now = true;
     } else {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
-                  << HexSubstr(kThisId) << " to " << DebugId(peer_node_id) << " failed with code "
-                  << message_sent << " id: " << message.id();
+      if (window.queued() >= Parameters::max_queued_per_peer &&
+          priority == SendPriority::kResponse && !window.requests.empty()) {
+        // Under overload requests are shed first, newest first, so that responses keep flowing.
+        dropped_functor = std::move(window.requests.back().message_sent_functor);
+        window.requests.pop_back();
+        --queued_count_;
+        dropped = true;
+      }
+      if (window.queued() < Parameters::max_queued_per_peer) {
+        (priority == SendPriority::kResponse ? window.responses : window.requests)
+            .emplace_back(std::move(serialised_message), message_sent_functor);
+        ++queued_count_;
+        if (!congested_ && queued_count_ >= Parameters::outbound_queue_high_water)
+          congested_ = now_congested = true;
+      } else {
+        dropped_functor = message_sent_functor;
+        dropped = true;
+      }
     }
+  }
+
+  if (now_congested)
+    NotifyCongestion(true);
+  if (send_now) {
+    transport_->Send(peer_id, serialised_message, WindowedFunctor(peer_id, message_sent_functor));
+  } else if (dropped) {
+    LOG(kWarning) << "[" << DebugId(routing_table_.kNodeId()) << "] outbound queue to "
+                  << DebugId(peer_id) << " is full; dropping message.";
+    if (dropped_functor)
+      dropped_functor(kSendQueueFull);
+  }
+}
+
+rudp::MessageSentFunctor NetworkUtils::WindowedFunctor(
+    const NodeId& peer_id, const rudp::MessageSentFunctor& message_sent_functor) {
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  return [this, weak_guard, peer_id, message_sent_functor](int message_sent) {
+    // Once this object is stopping, the window is left alone and nothing queued is sent on.
+    std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+    bool running(false);
+    if (guard) {
+      std::lock_guard<std::mutex> guard_lock(guard->mutex);
+      running = guard->running;
+    }
+    if (running) {
+      // rudp only reports success once the peer has acknowledged the message.
+      if (message_sent == kSuccess)
+        liveness_.RecordActivity(peer_id, RoutingClock::now());
+      OnSendInWindowDone(peer_id);
+    }
+    if (message_sent_functor)
+      message_sent_functor(message_sent);
   };
-  LOG(kVerbose) << " >>>>>>>>> rudp send message to connection id " << DebugId(peer_connection_id);
+}
+
+void NetworkUtils::OnSendInWindowDone(const NodeId& peer_id) {
+  QueuedSend next(std::string(), nullptr);
+  bool send_next(false), no_longer_congested(false);
+  {
+    std::lock_guard<std::mutex> lock(window_mutex_);
+    auto itr(peer_windows_.find(peer_id));
+    if (itr == std::end(peer_windows_))
+      return;
+    PeerWindow& window(itr->second);
+    if (window.in_flight != 0)
+      --window.in_flight;
+    if (window.queued() != 0 && window.in_flight < Parameters::max_in_flight_per_peer) {
+      next = window.PopNext();
+      --queued_count_;
+      ++window.in_flight;
+      send_next = true;
+      if (congested_ && queued_count_ <= Parameters::outbound_queue_high_water / 2) {
+        congested_ = false;
+        no_longer_congested = true;
+      }
+    } else if (window.in_flight == 0 && window.queued() == 0) {
+      peer_windows_.erase(itr);
+    }
+  }
+
+  if (no_longer_congested)
+    NotifyCongestion(false);
+  if (send_next) {
+    transport_->Send(peer_id, next.serialised_message,
+                     WindowedFunctor(peer_id, next.message_sent_functor));
+  }
+}
+
+NetworkUtils::QueuedSend NetworkUtils::PeerWindow::PopNext() {
+  bool take_response(!responses.empty() &&
+                     (requests.empty() || responses_in_turn < Parameters::response_send_weight));
+  std::deque<QueuedSend>& lane(take_response ? responses : requests);
+  QueuedSend next(std::move(lane.front()));
+  lane.pop_front();
+  if (take_response)
+    ++responses_in_turn;
+  else
+    responses_in_turn = 0;
+  return next;
+}
+
+void NetworkUtils::NotifyCongestion(bool congested) {
+  LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] outbound queues "
+             << (congested ? "congested" : "no longer congested");
+  if (congestion_functor_)
+    congestion_functor_(congested);
+}
+
+void NetworkUtils::SendTo(const protobuf::Message& message, const NodeId& peer_node_id,
+                          const NodeId& peer_connection_id, const DeliveryFunctor& delivered) {
+  rudp::MessageSentFunctor message_sent_functor(WithDelivery(
+      SendToFunctor(peer_node_id, message.id(), message.type(), message.hops_to_live()),
+      delivered));
+  if (message.has_path_trace()) {
+    protobuf::Message traced(message);
+    SetPathTraceNextHop(traced, routing_table_.kNodeId(), peer_node_id);
+    return RudpSend(peer_connection_id, traced, message_sent_functor);
+  }
   RudpSend(peer_connection_id, message, message_sent_functor);
 }
 
-void NetworkUtils::RecursiveSendOn(protobuf::Message message, NodeInfo last_node_attempted,
-                                   int attempt_count) {
+void NetworkUtils::SendEncodedToDirect(const EncodedMessage& message, const NodeId& peer_node_id,
+                                       const NodeId& peer_connection_id) {
+  SendEncodedToDirect(message, peer_node_id, peer_connection_id, DeliveryFunctor());
+}
+
+void NetworkUtils::SendEncodedToDirect(const EncodedMessage& message, const NodeId& peer_node_id,
+                                       const NodeId& peer_connection_id,
+                                       const DeliveryFunctor& delivered) {
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return;
   }
-  if (attempt_count >= 3) {
-    LOG(kWarning) << " Retry attempts failed to send to ["
-                  << HexSubstr(last_node_attempted.node_id.string())
-                  << "] will drop this node now and try with another node."
-                  << " id: " << message.id();
-    attempt_count = 0;
-    {
-      std::lock_guard<std::mutex> lock(running_mutex_);
-      if (!running_)
-        return;
-      rudp_.Remove(last_node_attempted.connection_id);
-      LOG(kWarning) << " Routing -> removing connection " << last_node_attempted.node_id.string();
-      // FIXME Should we remove this node or let rudp handle that?
-      routing_table_.DropNode(last_node_attempted.connection_id, false);
-      client_routing_table_.DropConnection(last_node_attempted.connection_id);
-    }
+  std::string serialised_message(message.ForDestination(peer_node_id));
+  metrics_.Add(RoutingMetrics::kSent, message.type());
+  metrics_.Add(RoutingMetrics::kBytesSent, message.type(), serialised_message.size());
+  Send(peer_connection_id, std::move(serialised_message),
+       PriorityOf(message.routing_message(), message.request()),
+       WithDelivery(SendToFunctor(peer_node_id, message.id(), message.type(),
+                                  message.hops_to_live()),
+                    delivered));
+  ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kForwarded, message, peer_connection_id.string());
+  if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+    LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId()) << "] send : type "
+                  << message.type() << " to   " << DebugId(peer_node_id)
+                  << "   (id: " << message.id() << ")"
+                  << " --To Rudp (encoded)--";
   }
+}
 
-  if (attempt_count > 0)
-    Sleep(std::chrono::milliseconds(50));
+rudp::MessageSentFunctor NetworkUtils::WithDelivery(rudp::MessageSentFunctor message_sent_functor,
+                                                    const DeliveryFunctor& delivered) {
+  if (!delivered)
+    return message_sent_functor;
+  return [message_sent_functor, delivered](int message_sent) {
+    message_sent_functor(message_sent);
+    delivered(rudp::kSuccess == message_sent);
+  };
+}
 
+rudp::MessageSentFunctor NetworkUtils::SendToFunctor(const NodeId& peer_node_id,
+                                                     int32_t message_id, int32_t message_type,
+                                                     int32_t hops_to_live) {
   const std::string kThisId(routing_table_.kNodeId().string());
-  bool ignore_exact_match(!IsDirect(message));
-  std::vector<std::string> route_history;
+  // Only the fields needed for diagnostics are captured, rather than a copy of the message.
+  const int32_t kMessageId(message_id), kMessageType(message_type), kHopsToLive(hops_to_live);
+  return [=](int message_sent) {
+    if (rudp::kSuccess == message_sent) {
+      if (ROUTING_TRACE_ENABLED(TraceLevel::kInfo)) {
+        Tracer::Instance().Record(TraceEvent::kSent, kMessageId, kMessageType, kHopsToLive,
+                                  peer_node_id.string());
+      }
+    } else {
+      metrics_.Add(RoutingMetrics::kSendFailures, kMessageType);
+      if (ROUTING_TRACE_ENABLED(TraceLevel::kInfo)) {
+        Tracer::Instance().Record(TraceEvent::kSendFailed, kMessageId, kMessageType, kHopsToLive,
+                                  peer_node_id.string());
+      }
+      LOG(kError) << "Sending type " << kMessageType << " message from " << HexSubstr(kThisId)
+                  << " to " << DebugId(peer_node_id) << " failed with code " << message_sent
+                  << " id: " << kMessageId;
+    }
+  };
+}
+
+// The usual route normally starts at the peer closest to the destination, so the extra copies go
+// to the ones after it.  The first response completes the request's Timer task; later ones find
+// the task gone and are dropped.
+void NetworkUtils::RaceToClosestNodes(const protobuf::Message& message, uint16_t width) {
+  SendToClosestNode(message);
+  const NodeId kDestinationId(message.destination_id());
+  if (width < 2 || !message.direct() || routing_table_.Contains(kDestinationId) ||
+      !client_routing_table_.GetNodesInfo(kDestinationId).empty())
+    return;
+  bool closest(true);
+  routing_table_.VisitClosestNodes(kDestinationId, width, [&](const NodeInfo& peer) {
+    if (closest) {  // Already sent to by SendToClosestNode
+      closest = false;
+      return true;
+    }
+    if (!NodeId::CloserToTarget(peer.node_id, routing_table_.kNodeId(), kDestinationId))
+      return false;
+    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] racing message id "
+                  << message.id() << " via " << DebugId(peer.node_id);
+    SendTo(message, peer.node_id, peer.connection_id);
+    return true;
+  });
+}
+
+NetworkUtils::SharedMessage NetworkUtils::ShareForSending(protobuf::Message& message) {
+  std::shared_ptr<protobuf::Message> shared(MessagePool::AcquireShared());
+  shared->Swap(&message);
+  AdjustRouteHistory(*shared);
+  return shared;
+}
+
+void NetworkUtils::RecursiveSendOn(const protobuf::Message& message, DeliveryFunctor delivered) {
+  // The pooled message keeps the capacity of its fields, so the copy needn't allocate.
+  std::shared_ptr<protobuf::Message> shared(MessagePool::AcquireShared());
+  shared->CopyFrom(message);
+  AdjustRouteHistory(*shared);
+  RecursiveSendOn(shared, std::vector<std::string>(), false, delivered);
+}
+
+void NetworkUtils::RecursiveSendOn(const SharedMessage& message,
+                                   std::vector<std::string> failed_peers,
+                                   bool retry_failed_peers, DeliveryFunctor delivered) {
+  {
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  if (failed_peers.size() > Parameters::max_send_retries) {
+    LOG(kWarning) << "Dropping type " << MessageTypeString(*message) << " message after "
+                  << failed_peers.size() << " failed attempts to send it.  id: " << message->id();
+    if (delivered)
+      delivered(false);
+    return;
+  }
+
+  const NodeId kDestinationId(message->destination_id());
+  bool ignore_exact_match(!IsDirect(*message));
+  uint64_t routes_version(0);
+  std::vector<std::string> exclude(retry_failed_peers ? std::vector<std::string>() : failed_peers);
   NodeInfo peer;
   {
-    std::lock_guard<std::mutex> lock(running_mutex_);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
     if (!running_)
       return;
-    if (message.route_history().size() > 1)
-      route_history = std::vector<std::string>(
-          message.route_history().begin(),
-          message.route_history().end() -
-              static_cast<size_t>(!(message.has_visited() && message.visited())));
-    else if ((message.route_history().size() == 1) &&
-             (message.route_history(0) != routing_table_.kNodeId().string()))
-      route_history.push_back(message.route_history(0));
-
-    peer = routing_table_.GetNodeForSendingMessage(NodeId(message.destination_id()), route_history,
-                                                   ignore_exact_match);
+    const ExcludedNodes kRouteHistory(RouteHistoryExclusions(
+        *message, routing_table_.kNodeId(), message->has_visited() && message->visited(),
+        exclude));
+    routes_version = routing_table_.routes_version();
+    peer = GetCachedRoute(kDestinationId, kRouteHistory, ignore_exact_match);
+    if (peer.node_id == NodeId()) {
+      peer = routing_table_.GetNodeForSendingMessage(kDestinationId, kRouteHistory,
+                                                     ignore_exact_match);
+    }
     if (peer.node_id == NodeId() && routing_table_.size() != 0) {
-      peer = routing_table_.GetNodeForSendingMessage(
-          NodeId(message.destination_id()), std::vector<std::string>(), ignore_exact_match);
+      peer = routing_table_.GetNodeForSendingMessage(kDestinationId, exclude, ignore_exact_match);
     }
     if (peer.node_id == NodeId()) {
+      if (!exclude.empty() && routing_table_.size() != 0) {
+        // Every candidate has failed, so back off before trying them again.
+        ScheduleSendRetry(message, failed_peers, delivered);
+        return;
+      }
       LOG(kError) << "This node's routing table is empty now.  Need to re-bootstrap.";
+      if (delivered)
+        delivered(false);
       return;
     }
-    AdjustRouteHistory(message);
   }
+  SendOnVia(message, peer, routes_version, failed_peers, delivered);
+}
 
+void NetworkUtils::SendOnVia(const SharedMessage& message, const NodeInfo& peer,
+                             uint64_t routes_version, std::vector<std::string> failed_peers,
+                             DeliveryFunctor delivered) {
+  const NodeId kDestinationId(message->destination_id());
   rudp::MessageSentFunctor message_sent_functor = [=](int message_sent) {
     {
-      std::lock_guard<std::mutex> lock(running_mutex_);
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
       if (!running_)
         return;
     }
+    if (kSendQueueFull == message_sent) {
+      metrics_.Add(RoutingMetrics::kSendFailures, message->type());
+      LOG(kWarning) << "Dropped type " << MessageTypeString(*message) << " message as the queue to "
+                    << HexSubstr(peer.node_id.string()) << " is full.  id: " << message->id();
+      if (delivered)
+        delivered(false);
+      return;
+    }
+    routing_table_.RecordSendResult(peer.node_id, rudp::kSuccess == message_sent);
     if (rudp::kSuccess == message_sent) {
-      LOG(kVerbose) << "  [" << HexSubstr(kThisId) << "] sent : " << MessageTypeString(message)
-                    << " to   " << HexSubstr(peer.node_id.string()) << "   (id: " << message.id()
-                    << ")"
-                    << " dst : " << HexSubstr(message.destination_id());
-    } else if (rudp::kSendFailure == message_sent) {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
-                  << HexSubstr(routing_table_.kNodeId().string()) << " to "
-                  << HexSubstr(peer.node_id.string()) << " with destination ID "
-                  << HexSubstr(message.destination_id()) << " failed with code " << message_sent
-                  << ".  Will retry to Send.  Attempt count = " << attempt_count + 1
-                  << " id: " << message.id();
-      RecursiveSendOn(message, peer, attempt_count + 1);
+      ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kSent, *message, peer.node_id.string());
+      CacheRoute(kDestinationId, peer, routes_version);
+      if (delivered)
+        delivered(true);
+      return;
+    }
+    metrics_.Add(RoutingMetrics::kSendFailures, message->type());
+    InvalidateRoute(kDestinationId, peer.node_id);
+    OnSendOnFailed(message, failed_peers, peer, message_sent, delivered);
+  };
+  // A sampled message is copied to record its next hop, leaving the original for any retry to
+  // record another.
+  if (message->has_path_trace()) {
+    protobuf::Message traced(*message);
+    SetPathTraceNextHop(traced, routing_table_.kNodeId(), peer.node_id);
+    return RudpSend(peer.connection_id, traced, message_sent_functor);
+  }
+  RudpSend(peer.connection_id, *message, message_sent_functor);
+}
+
+void NetworkUtils::SendToClosestNodes(std::vector<protobuf::Message> messages) {
+  // Only new messages which would go via RecursiveSendOn are routed together; the rest are sent
+  // one by one.
+  std::vector<size_t> direct, group;
+  for (size_t i(0); i != messages.size(); ++i) {
+    const protobuf::Message& message(messages[i]);
+    if (!message.has_destination_id() || message.destination_id().empty() ||
+        RouteHistorySize(message) != 0 ||
+        (message.direct() &&
+         !client_routing_table_.GetNodesInfo(NodeId(message.destination_id())).empty())) {
+      SendToClosestNode(message);
     } else {
-      LOG(kError) << "Sending type " << MessageTypeString(message) << " message from "
-                  << HexSubstr(kThisId) << " to " << HexSubstr(peer.node_id.string())
-                  << " with destination ID " << HexSubstr(message.destination_id())
-                  << " failed with code " << message_sent << "  Will remove node."
-                  << " message id: " << message.id();
-      {
-        std::lock_guard<std::mutex> lock(running_mutex_);
-        if (!running_)
+      (IsDirect(message) ? direct : group).push_back(i);
+    }
+  }
+  if (direct.empty() && group.empty())
+    return;
+
+  // Each message is then sent to its next hop in turn, so that those for the same peer arrive
+  // together and share its OutboundBatch.
+  std::vector<std::pair<NodeInfo, size_t>> next_hops;
+  uint64_t routes_version(0);
+  {
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    if (routing_table_.size() == 0) {
+      LOG(kError) << "This node's routing table is empty now.  Need to re-bootstrap.";
+      return;
+    }
+    routes_version = routing_table_.routes_version();
+    ChooseNextHops(messages, direct, false, next_hops);
+    ChooseNextHops(messages, group, true, next_hops);
+  }
+  std::stable_sort(next_hops.begin(), next_hops.end(),
+                   [](const std::pair<NodeInfo, size_t>& lhs,
+                      const std::pair<NodeInfo, size_t>& rhs) {
+                     return lhs.first.node_id < rhs.first.node_id;
+                   });
+  // Each message is moved, not copied, into the one shared by its attempts.
+  for (const auto& next_hop : next_hops) {
+    SharedMessage message(ShareForSending(messages[next_hop.second]));
+    if (next_hop.first.node_id == NodeId())
+      RecursiveSendOn(message, std::vector<std::string>(), false, DeliveryFunctor());
+    else
+      SendOnVia(message, next_hop.first, routes_version);
+  }
+}
+
+bool NetworkUtils::SendViaShortcut(const protobuf::Message& message,
+                                   const DeliveryFunctor& delivered) {
+  if (!shortcut_functor_ || !IsDirect(message))
+    return false;
+  const NodeId kDestinationId(message.destination_id());
+  // A destination in the routing table is a hop away already.
+  if (routing_table_.Contains(kDestinationId))
+    return false;
+  const auto kNow(RoutingClock::now());
+  NodeInfo shortcut(shortcuts_.Get(kDestinationId, kNow));
+  if (shortcut.node_id == NodeId()) {
+    // Only flows this node is the source of are counted; others' are for their sources to cut.
+    if (message.source_id() == routing_table_.kNodeId().string() &&
+        shortcuts_.RecordSend(kDestinationId, kNow)) {
+      LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] asking for a shortcut to "
+                 << DebugId(kDestinationId);
+      // Posted, since the sender may be holding locks of its own.
+      std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+      asio_service_.service().post([this, weak_guard, kDestinationId]() {
+        std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+        if (!guard)
           return;
-        rudp_.Remove(last_node_attempted.connection_id);
-      }
-      LOG(kWarning) << " Routing-> removing connection " << DebugId(peer.connection_id);
-      routing_table_.DropNode(peer.node_id, false);
-      client_routing_table_.DropConnection(peer.connection_id);
-      RecursiveSendOn(message);
+        {
+          std::lock_guard<std::mutex> guard_lock(guard->mutex);
+          if (!guard->running)
+            return;
+        }
+        shortcut_functor_(kDestinationId);
+      });
+    }
+    return false;
+  }
+
+  std::shared_ptr<protobuf::Message> shared(MessagePool::AcquireShared());
+  shared->CopyFrom(message);
+  AdjustRouteHistory(*shared);
+  SharedMessage shared_message(shared);
+  RudpSend(shortcut.connection_id, *shared_message, [=](int message_sent) {
+    {
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
+      if (!running_)
+        return;
+    }
+    if (rudp::kSuccess == message_sent) {
+      if (delivered)
+        delivered(true);
+      return;
+    }
+    metrics_.Add(RoutingMetrics::kSendFailures, shared_message->type());
+    LOG(kWarning) << "Sending over the shortcut to " << DebugId(kDestinationId)
+                  << " failed with code " << message_sent << "; routing the message instead."
+                  << " id: " << shared_message->id();
+    if (kSendQueueFull != message_sent && shortcuts_.Remove(shortcut.connection_id)) {
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
+      if (!running_)
+        return;
+      transport_->Remove(shortcut.connection_id);
+    }
+    RecursiveSendOn(shared_message, std::vector<std::string>(), false, delivered);
+  });
+  return true;
+}
+
+void NetworkUtils::ChooseNextHops(const std::vector<protobuf::Message>& messages,
+                                  const std::vector<size_t>& indices, bool ignore_exact_match,
+                                  std::vector<std::pair<NodeInfo, size_t>>& next_hops) {
+  std::vector<NodeId> to_choose;
+  std::vector<size_t> chosen_for;
+  for (auto index : indices) {
+    const NodeId kDestinationId(messages[index].destination_id());
+    NodeInfo peer(GetCachedRoute(kDestinationId, ExcludedNodes(), ignore_exact_match));
+    if (peer.node_id == NodeId()) {
+      to_choose.push_back(kDestinationId);
+      chosen_for.push_back(index);
+    } else {
+      next_hops.push_back(std::make_pair(peer, index));
     }
+  }
+  if (to_choose.empty())
+    return;
+  auto peers(routing_table_.GetNodesForSendingMessages(to_choose, ExcludedNodes(),
+                                                       ignore_exact_match));
+  for (size_t i(0); i != peers.size(); ++i)
+    next_hops.push_back(std::make_pair(peers[i], chosen_for[i]));
+}
+
+void NetworkUtils::OnSendOnFailed(const SharedMessage& message,
+                                  std::vector<std::string> failed_peers, const NodeInfo& peer,
+                                  int message_sent, const DeliveryFunctor& delivered) {
+  const std::string kThisId(routing_table_.kNodeId().string());
+  failed_peers.push_back(peer.node_id.string());
+  bool drop_peer(rudp::kSendFailure != message_sent ||
+                 static_cast<size_t>(std::count(failed_peers.begin(), failed_peers.end(),
+                                                peer.node_id.string())) >= kMaxSendFailuresPerPeer);
+  ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kSendFailed, *message, peer.node_id.string());
+  LOG(kError) << "Sending type " << MessageTypeString(*message) << " message from "
+              << HexSubstr(kThisId) << " to " << HexSubstr(peer.node_id.string())
+              << " with destination ID " << HexSubstr(message->destination_id())
+              << " failed with code " << message_sent << ".  Attempt count = "
+              << failed_peers.size() << (drop_peer ? ".  Will remove node." : "")
+              << " id: " << message->id();
+  if (drop_peer) {
+    {
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
+      if (!running_)
+        return;
+      transport_->Remove(peer.connection_id);
+    }
+    LOG(kWarning) << " Routing-> removing connection " << DebugId(peer.connection_id);
+    routing_table_.DropNode(peer.node_id, false);
+    client_routing_table_.DropConnection(peer.connection_id);
+  }
+  // Runs in rudp's send callback, so the next closest peer is tried straight away rather than
+  // blocking this thread to retry the same one.
+  RecursiveSendOn(message, failed_peers, false, delivered);
+}
+
+bool NetworkUtils::ForwardSerialised(const MessageHeader& header, const std::string& serialised) {
+  const NodeId kDestinationId(header.destination_id);
+  uint64_t routes_version(0);
+  NodeInfo peer;
+  {
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    if (!running_)
+      return true;
+    const ExcludedNodes kRouteHistory(RouteHistoryExclusions(
+        header.route_history, routing_table_.kNodeId(), header.has_visited && header.visited));
+    routes_version = routing_table_.routes_version();
+    peer = GetCachedRoute(kDestinationId, kRouteHistory, !header.direct);
+    if (peer.node_id == NodeId()) {
+      peer = routing_table_.GetNodeForSendingMessage(kDestinationId, kRouteHistory,
+                                                     !header.direct);
+    }
+  }
+  if (peer.node_id == NodeId())
+    return false;
+  // A compressed payload has to be uncompressed for a peer which can't decode it.
+  if (header.data_compression != 0 && !DecodesCompression(peer.connection_id))
+    return false;
+  std::string route_history(header.route_history);
+  AddToRouteHistory(route_history, routing_table_.kNodeId());
+  std::shared_ptr<const std::string> forwarded(std::make_shared<std::string>(
+      RewriteForwardedMessage(serialised, header.hops_to_live - 1, route_history)));
+  if (forwarded->empty())
+    return false;
+
+  const int32_t kMessageId(header.id), kMessageType(header.type);
+  rudp::MessageSentFunctor message_sent_functor = [=](int message_sent) {
+    {
+      std::lock_guard<HotPathMutex> lock(running_mutex_);
+      if (!running_)
+        return;
+    }
+    if (rudp::kSuccess != message_sent)
+      metrics_.Add(RoutingMetrics::kSendFailures, kMessageType);
+    if (kSendQueueFull == message_sent) {
+      LOG(kWarning) << "Dropped forwarded message as the queue to "
+                    << HexSubstr(peer.node_id.string()) << " is full.  id: " << kMessageId;
+      return;
+    }
+    routing_table_.RecordSendResult(peer.node_id, rudp::kSuccess == message_sent);
+    if (rudp::kSuccess == message_sent) {
+      CacheRoute(kDestinationId, peer, routes_version);
+      return;
+    }
+    InvalidateRoute(kDestinationId, peer.node_id);
+    // Retries need the full message, so only a failed forward pays for parsing it.
+    std::shared_ptr<protobuf::Message> message(MessagePool::AcquireShared());
+    if (message->ParseFromString(*forwarded))
+      OnSendOnFailed(message, std::vector<std::string>(), peer, message_sent);
   };
-  LOG(kVerbose) << "Rudp recursive send message to " << DebugId(peer.connection_id);
-  RudpSend(peer.connection_id, message, message_sent_functor);
+  LOG(kVerbose) << "  [" << DebugId(routing_table_.kNodeId()) << "] forwarding to "
+                << DebugId(peer.node_id) << " dst : " << HexSubstr(header.destination_id)
+                << " (id: " << kMessageId << ") --Fast path--";
+  metrics_.Add(RoutingMetrics::kSent, kMessageType);
+  metrics_.Add(RoutingMetrics::kBytesSent, kMessageType, forwarded->size());
+  Send(peer.connection_id, *forwarded, PriorityOf(false, header.request), message_sent_functor);
+  return true;
+}
+
+void NetworkUtils::ScheduleSendRetry(const SharedMessage& message,
+                                     std::vector<std::string> failed_peers,
+                                     DeliveryFunctor delivered) {
+  // Exponential backoff over the failed attempts so far, with up to 50% jitter added so that
+  // retries of messages which failed together are spread out.
+  std::chrono::milliseconds delay(Parameters::send_retry_max_delay);
+  size_t shift(failed_peers.empty() ? 0 : failed_peers.size() - 1);
+  if (shift < 16)
+    delay = std::min(delay, Parameters::send_retry_base_delay * (1 << shift));
+  delay += std::chrono::milliseconds(RandomUint32() % (delay.count() / 2 + 1));
+  LOG(kVerbose) << "Retrying type " << MessageTypeString(*message) << " message in "
+                << delay.count() << " ms.  id: " << message->id();
+
+  auto timer(std::make_shared<RoutingTimer>(asio_service_.service(), delay));
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  timer->async_wait([this, timer, weak_guard, message, failed_peers, delivered](
+      const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted)
+      return;
+    std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+    if (!guard)
+      return;
+    std::lock_guard<std::mutex> lock(guard->mutex);
+    if (guard->running)
+      RecursiveSendOn(message, failed_peers, true, delivered);
+  });
 }
 
 void NetworkUtils::AdjustRouteHistory(protobuf::Message& message) {
   if (Parameters::hops_to_live == message.hops_to_live() &&
       NodeId(message.source_id()) == routing_table_.kNodeId())
     return;
-  assert(message.route_history().size() <= Parameters::max_routing_table_size);
-  if (std::find(message.route_history().begin(), message.route_history().end(),
-                routing_table_.kNodeId().string()) == message.route_history().end()) {
-    message.add_route_history(routing_table_.kNodeId().string());
-    if (message.route_history().size() > Parameters::max_route_history) {
-      std::vector<std::string> route_history(message.route_history().begin() + 1,
-                                             message.route_history().end());
-      message.clear_route_history();
-      for (const auto& route : route_history) {
-        if (!NodeId(route).IsZero())
-          message.add_route_history(route);
-      }
+  AddToRouteHistory(message, routing_table_.kNodeId());
+  assert(RouteHistorySize(message) <= Parameters::max_route_history);
+}
+
+NodeInfo NetworkUtils::GetCachedRoute(const NodeId& destination_id,
+                                      const ExcludedNodes& exclude,
+                                      bool ignore_exact_match) {
+  // A directly connected destination is found at once by the full lookup.
+  if (Parameters::route_cache_size == 0 || routing_table_.Contains(destination_id))
+    return NodeInfo();
+  NodeInfo next_hop;
+  {
+    std::lock_guard<std::mutex> lock(route_cache_mutex_);
+    auto itr(route_cache_.find(RoutePrefix(destination_id)));
+    if (itr == std::end(route_cache_))
+      return NodeInfo();
+    if (itr->second.routes_version != routing_table_.routes_version()) {
+      route_cache_.erase(itr);
+      return NodeInfo();
     }
+    next_hop = itr->second.next_hop;
   }
-  assert(message.route_history().size() <= Parameters::max_routing_table_size);
+  // Other destinations sharing the prefix may lie on the far side of this node from next_hop.
+  if ((ignore_exact_match && next_hop.node_id == destination_id) ||
+      !NodeId::CloserToTarget(next_hop.node_id, routing_table_.kNodeId(), destination_id) ||
+      exclude.Contains(next_hop.node_id))
+    return NodeInfo();
+  return next_hop;
+}
+
+void NetworkUtils::CacheRoute(const NodeId& destination_id, const NodeInfo& next_hop,
+                              uint64_t routes_version) {
+  if (Parameters::route_cache_size == 0 || routing_table_.routes_version() != routes_version)
+    return;
+  std::lock_guard<std::mutex> lock(route_cache_mutex_);
+  uint64_t prefix(RoutePrefix(destination_id));
+  if (route_cache_.size() >= Parameters::route_cache_size && route_cache_.count(prefix) == 0)
+    route_cache_.erase(std::begin(route_cache_));
+  CachedRoute& cached_route(route_cache_[prefix]);
+  cached_route.next_hop = next_hop;
+  cached_route.routes_version = routes_version;
+}
+
+void NetworkUtils::InvalidateRoute(const NodeId& destination_id, const NodeId& next_hop_id) {
+  std::lock_guard<std::mutex> lock(route_cache_mutex_);
+  auto itr(route_cache_.find(RoutePrefix(destination_id)));
+  if (itr != std::end(route_cache_) && itr->second.next_hop.node_id == next_hop_id)
+    route_cache_.erase(itr);
+}
+
+void NetworkUtils::set_transport(std::unique_ptr<Transport> transport) {
+  assert(bootstrap_connection_id_.IsZero() && "The transport must be set before bootstrapping");
+  transport_ = std::move(transport);
 }
 
 void NetworkUtils::set_new_bootstrap_contact_functor(
@@ -386,6 +1226,199 @@ void NetworkUtils::set_new_bootstrap_contact_functor(
   new_bootstrap_contact_ = new_bootstrap_contact;
 }
 
+void NetworkUtils::set_congestion_functor(CongestionFunctor congestion_functor) {
+  congestion_functor_ = congestion_functor;
+}
+
+void NetworkUtils::set_suspected_dead_functor(SuspectedDeadFunctor suspected_dead) {
+  suspected_dead_functor_ = suspected_dead;
+  if (suspected_dead_functor_ && Parameters::liveness_idle_time != std::chrono::milliseconds(0))
+    ScheduleLivenessCheck();
+}
+
+void NetworkUtils::set_shortcut_functor(ShortcutFunctor shortcut) {
+  shortcut_functor_ = shortcut;
+  if (shortcut_functor_ && Parameters::shortcut_message_threshold != 0)
+    ScheduleShortcutCheck();
+}
+
+void NetworkUtils::RecordReceived(const MessageHeader& header) {
+  const auto kNow(RoutingClock::now());
+  // A message on its first hop came straight from its source; otherwise the last hop is the
+  // latest tag in its route history.
+  if (header.hops_to_live == Parameters::hops_to_live) {
+    if (header.has_source_id && header.source_id.size() == NodeId::kSize) {
+      liveness_.RecordActivity(NodeId(header.source_id), kNow);
+      if (shortcut_functor_)
+        shortcuts_.MarkUsed(NodeId(header.source_id), kNow);
+    }
+  } else if (header.route_history.size() >= kRouteHistoryTagSize) {
+    liveness_.RecordActivityByTag(
+        header.route_history.substr(header.route_history.size() - kRouteHistoryTagSize), kNow);
+  }
+}
+
+void NetworkUtils::ScheduleLivenessCheck() {
+  liveness_timer_.expires_from_now(Parameters::liveness_check_interval);
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  liveness_timer_.async_wait([this, weak_guard](const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted)
+      return;
+    std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+    if (!guard)
+      return;
+    {
+      std::lock_guard<std::mutex> guard_lock(guard->mutex);
+      if (!guard->running)
+        return;
+    }
+    CheckLiveness();
+    ScheduleLivenessCheck();
+  });
+}
+
+void NetworkUtils::CheckLiveness() {
+  const auto kNow(RoutingClock::now());
+  for (const auto& connection_id : liveness_.TakeSuspected(Parameters::liveness_probe_timeout,
+                                                           kNow)) {
+    // A busy peer may be slow to answer, but isn't idle.
+    if (HasSendsOutstanding(connection_id)) {
+      liveness_.RecordActivity(connection_id, kNow);
+      continue;
+    }
+    LOG(kWarning) << "[" << DebugId(routing_table_.kNodeId()) << "] no sign of life from "
+                  << DebugId(connection_id) << " since probing it.";
+    suspected_dead_functor_(connection_id);
+  }
+  for (const auto& connection_id : liveness_.TakeIdle(Parameters::liveness_idle_time, kNow)) {
+    NodeInfo peer;
+    if (!routing_table_.GetNodeInfo(connection_id, peer) ||
+        HasSendsOutstanding(connection_id)) {
+      // Only idle routing table peers are probed; other connections are left to rudp.
+      liveness_.RecordActivity(connection_id, kNow);
+      continue;
+    }
+    SendProbe(peer);
+  }
+  if (!Parameters::lookahead_routing || routing_table_.client_mode())
+    return;
+  // Peers in constant use are never idle, so are pinged for their table summaries separately.
+  for (const auto& peer_id : routing_table_.TakeStaleTableSummaries()) {
+    NodeInfo peer;
+    if (!routing_table_.GetNodeInfo(peer_id, peer))
+      continue;
+    protobuf::Message ping(rpcs::Ping(peer.node_id, routing_table_.kNodeId().string()));
+    pending_requests_.Add(ping);
+    SendToDirect(ping, peer.node_id, peer.connection_id);
+  }
+}
+
+bool NetworkUtils::HasSendsOutstanding(const NodeId& peer_id) const {
+  std::lock_guard<std::mutex> lock(window_mutex_);
+  auto itr(peer_windows_.find(peer_id));
+  return itr != std::end(peer_windows_) &&
+         (itr->second.in_flight != 0 || itr->second.queued() != 0);
+}
+
+void NetworkUtils::SendProbe(const NodeInfo& peer) {
+  protobuf::Message ping(rpcs::Ping(peer.node_id, routing_table_.kNodeId().string()));
+  pending_requests_.Add(ping);
+  std::string serialised_message(ping.SerializeAsString());
+  metrics_.Add(RoutingMetrics::kSent, ping.type());
+  metrics_.Add(RoutingMetrics::kBytesSent, ping.type(), serialised_message.size());
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  const NodeId kConnectionId(peer.connection_id);
+  transport_->Send(kConnectionId, serialised_message,
+                   [this, weak_guard, kConnectionId](int message_sent) {
+                     if (message_sent != kSuccess)
+                       return;
+                     std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+                     if (!guard)
+                       return;
+                     std::lock_guard<std::mutex> guard_lock(guard->mutex);
+                     if (guard->running)
+                       liveness_.RecordActivity(kConnectionId, RoutingClock::now());
+                   });
+}
+
+void NetworkUtils::ScheduleShortcutCheck() {
+  shortcut_timer_.expires_from_now(Parameters::shortcut_window);
+  std::weak_ptr<TimerGuard> weak_guard(timer_guard_);
+  shortcut_timer_.async_wait([this, weak_guard](const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted)
+      return;
+    std::shared_ptr<TimerGuard> guard(weak_guard.lock());
+    if (!guard)
+      return;
+    {
+      std::lock_guard<std::mutex> guard_lock(guard->mutex);
+      if (!guard->running)
+        return;
+    }
+    CloseIdleShortcuts();
+    ScheduleShortcutCheck();
+  });
+}
+
+void NetworkUtils::CloseIdleShortcuts() {
+  for (const auto& shortcut : shortcuts_.TakeIdle(Parameters::shortcut_idle_time,
+                                                  RoutingClock::now())) {
+    // A peer which has since joined either routing table keeps the connection.
+    if (routing_table_.Contains(shortcut.node_id) ||
+        client_routing_table_.Contains(shortcut.node_id))
+      continue;
+    LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] closing idle shortcut to "
+               << DebugId(shortcut.node_id);
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    transport_->Remove(shortcut.connection_id);
+  }
+}
+
+uint8_t NetworkUtils::Load() const {
+  size_t client_load(0), queue_load(0);
+  if (client_routing_table_.kMaxSize() != 0)
+    client_load = client_routing_table_.size() * 255 / client_routing_table_.kMaxSize();
+  if (Parameters::outbound_queue_high_water != 0) {
+    std::lock_guard<std::mutex> lock(window_mutex_);
+    queue_load = queued_count_ * 255 / Parameters::outbound_queue_high_water;
+  }
+  return static_cast<uint8_t>(std::min(std::max(client_load, queue_load), size_t(255)));
+}
+
+void NetworkUtils::RecordLoad(const BootstrapContact& contact, uint8_t load) {
+  bootstrap_ranking_.RecordLoad(contact, load);
+}
+
+void NetworkUtils::Redirect(const BootstrapContacts& contacts, uint8_t relay_load) {
+  NodeId bootstrap_connection_id;
+  {
+    std::lock_guard<HotPathMutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    bootstrap_connection_id = bootstrap_connection_id_;
+  }
+  if (bootstrap_connection_id.IsZero())
+    return;
+  BootstrapContact bootstrap_contact;
+  {
+    std::lock_guard<std::mutex> lock(bootstrap_contacts_mutex_);
+    bootstrap_contact = bootstrap_contact_;
+    for (const auto& contact : contacts) {
+      if (std::find(bootstrap_contacts_.begin(), bootstrap_contacts_.end(), contact) ==
+          bootstrap_contacts_.end())
+        bootstrap_contacts_.push_back(contact);
+    }
+  }
+  if (!bootstrap_contact.address().is_unspecified())
+    bootstrap_ranking_.RecordLoad(bootstrap_contact, relay_load);
+  LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] redirected by bootstrap node "
+             << DebugId(bootstrap_connection_id) << " with load " << int(relay_load) << " to "
+             << contacts.size() << " contacts";
+  Remove(bootstrap_connection_id);
+}
+
 void NetworkUtils::clear_bootstrap_connection_info() {
   bootstrap_connection_id_ = NodeId();
   this_node_relay_connection_id_ = NodeId();
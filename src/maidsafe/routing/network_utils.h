@@ -19,18 +19,37 @@
 #ifndef MAIDSAFE_ROUTING_NETWORK_UTILS_H_
 #define MAIDSAFE_ROUTING_NETWORK_UTILS_H_
 
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "boost/asio/ip/udp.hpp"
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/bootstrap_ranking.h"
+#include "maidsafe/routing/encoded_message.h"
+#include "maidsafe/routing/liveness_tracker.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/node_id_hash.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/pending_requests.h"
+#include "maidsafe/routing/profiled_mutex.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing_clock.h"
+#include "maidsafe/routing/routing_metrics.h"
+#include "maidsafe/routing/shortcut_table.h"
 #include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/transport.h"
 
 namespace maidsafe {
 
@@ -50,7 +69,11 @@ class MockNetworkUtils;
 
 class NetworkUtils {
  public:
-  NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table);
+  typedef std::function<void(const NodeId& /*connection_id*/)> SuspectedDeadFunctor;
+  typedef std::function<void(const NodeId& /*destination_id*/)> ShortcutFunctor;
+
+  NetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+               AsioService& asio_service);
   virtual ~NetworkUtils();
   int Bootstrap(const BootstrapContacts& bootstrap_contacts,
                 const rudp::MessageReceivedFunctor& message_received_functor,
@@ -64,23 +87,72 @@ class NetworkUtils {
                   const std::string& validation_data);
   virtual int MarkConnectionAsValid(const NodeId& peer_id);
   void Remove(const NodeId& peer_id);
+  // The endpoint rudp reported when the connection to |peer_id| was validated, if it can be
+  // bootstrapped off directly, else an unspecified endpoint.
+  boost::asio::ip::udp::endpoint PeerEndpoint(const NodeId& peer_id) const;
+  // Records the DataCompression bits which the Contact of the peer connected as |peer_id| gave.
+  void SetDecodableCompression(const NodeId& peer_id, uint32_t decodable_compression);
   // For sending relay requests, message with empty source ID may be provided, along with
   // direct endpoint.
   void SendToDirect(const protobuf::Message& message, const NodeId& peer_connection_id,
                     const rudp::MessageSentFunctor& message_sent_functor);
   virtual void SendToDirect(const protobuf::Message& message, const NodeId& peer_node_id,
                             const NodeId& peer_connection_id);
+  // Sends |message| to the peer with |peer_node_id|, which becomes the message's destination ID.
+  // Used where the same message fans out to several peers, so it is only serialised once.
+  virtual void SendEncodedToDirect(const EncodedMessage& message, const NodeId& peer_node_id,
+                                   const NodeId& peer_connection_id);
   void SendToDirectAdjustedRoute(protobuf::Message& message, const NodeId& peer_node_id,
                                  const NodeId& peer_connection_id);
   // Handles relay response messages.  Also leave destination ID empty if needs to send as a relay
   // response message
   virtual void SendToClosestNode(const protobuf::Message& message);
+  // As above, calling |delivered| once with true when a next hop has accepted |message|, or with
+  // false when it has been given up on.  Nothing is reported if this object is stopped first.
+  void SendToClosestNode(const protobuf::Message& message, const DeliveryFunctor& delivered);
+  // As SendToClosestNode for each of |messages|, but choosing the next hops of new messages all
+  // together and sending those for the same peer back to back.
+  void SendToClosestNodes(std::vector<protobuf::Message> messages);
+  // Sends a direct |message| as SendToClosestNode does and also straight to up to |width| - 1 of
+  // the next closest connected peers, each routing its copy on independently.
+  void RaceToClosestNodes(const protobuf::Message& message, uint16_t width);
+  // Forwards |serialised|, described by |header|, to the next hop towards its destination without
+  // parsing it.  Returns false, having sent nothing, if no next hop could be chosen.
+  bool ForwardSerialised(const MessageHeader& header, const std::string& serialised);
   void AddToBootstrapFile(const boost::asio::ip::udp::endpoint& endpoint);
+  // How busy this node is, from 0 to 255, as advertised to peers: see
+  // Parameters::relay_overload_load.
+  uint8_t Load() const;
+  // Records the load |contact| advertised, for ranking it as a bootstrap contact.
+  void RecordLoad(const BootstrapContact& contact, uint8_t load);
+  // Called while joining when the bootstrap node, advertising |relay_load|, redirects this node
+  // to |contacts|: drops the bootstrap connection so that the rebootstrap which follows tries
+  // them ahead of it.
+  void Redirect(const BootstrapContacts& contacts, uint8_t relay_load);
   void clear_bootstrap_connection_info();
   void set_new_bootstrap_contact_functor(NewBootstrapContactFunctor new_bootstrap_contact);
+  void set_congestion_functor(CongestionFunctor congestion_functor);
+  // Starts probing connections which have been idle for Parameters::liveness_idle_time, passing
+  // to |suspected_dead| those which then stay silent for Parameters::liveness_probe_timeout.
+  void set_suspected_dead_functor(SuspectedDeadFunctor suspected_dead);
+  // Asks |shortcut| to negotiate a shortcut to each destination which becomes due one (see
+  // Parameters::shortcut_message_threshold), and starts closing shortcuts which go idle.
+  void set_shortcut_functor(ShortcutFunctor shortcut);
+  // Credits the connection |header|'s message arrived over with being alive, where that can be
+  // told from the message's source and route history, and a shortcut from its source with use.
+  void RecordReceived(const MessageHeader& header);
   NodeId bootstrap_connection_id() const;
   NodeId this_node_relay_connection_id() const;
   rudp::NatType nat_type() const;
+  // Where the routing requests this node sends are kept, see Parameters::digest_rpc_responses.
+  PendingRequests& pending_requests() { return pending_requests_; }
+  // Where this node's direct connections outside its routing tables are kept.
+  ShortcutTable& shortcuts() { return shortcuts_; }
+  // Where this node's message counts are kept, see Routing::GetStatistics.
+  RoutingMetrics& metrics() { return metrics_; }
+  // Replaces the rudp connections this node sends over, e.g. with a SimulatedTransport.  Must be
+  // called before Bootstrap.
+  void set_transport(std::unique_ptr<Transport> transport);
 
   friend class test::GenericNode;
   friend class test::MockNetworkUtils;
@@ -90,25 +162,178 @@ class NetworkUtils {
   NetworkUtils(const NetworkUtils&&);
   NetworkUtils& operator=(const NetworkUtils&);
 
+  // Routing messages are sent at once.  Node-level responses are favoured over requests when
+  // they have to wait, since they finish work which the network has already done.
+  enum class SendPriority : int { kControl = 0, kResponse, kRequest };
+
+  // Small node-level messages share an OutboundBatch; anything else goes straight on.
+  struct OutboundBatch;
+  struct PeerWindow;
+
+  static SendPriority PriorityOf(bool routing_message, bool request);
+  bool DecodesCompression(const NodeId& peer_id) const;
+  // Compresses or uncompresses the payload of |message| as |peer_id| needs it.
   void RudpSend(const NodeId& peer_id, const protobuf::Message& message,
                 const rudp::MessageSentFunctor& message_sent_functor);
+  void Send(const NodeId& peer_id, std::string serialised_message, SendPriority priority,
+            const rudp::MessageSentFunctor& message_sent_functor);
+  void ArmBatchFlush(const NodeId& peer_id, const std::shared_ptr<OutboundBatch>& batch);
+  void SendBatch(const NodeId& peer_id, OutboundBatch& batch);
+  // Hands the message to rudp if it is a routing message or the peer's window has room, else
+  // queues or, if the queue is full, drops it with kSendQueueFull.
+  void SendInWindow(const NodeId& peer_id, std::string serialised_message, SendPriority priority,
+                    const rudp::MessageSentFunctor& message_sent_functor);
+  rudp::MessageSentFunctor WindowedFunctor(const NodeId& peer_id,
+                                           const rudp::MessageSentFunctor& message_sent_functor);
+  void OnSendInWindowDone(const NodeId& peer_id);
+  void NotifyCongestion(bool congested);
+  void ScheduleLivenessCheck();
+  void CheckLiveness();
+  // Whether sends to |peer_id| are waiting on rudp or the peer's window, in which case rudp is
+  // left to judge the connection.
+  bool HasSendsOutstanding(const NodeId& peer_id) const;
+  // Pings |peer| straight through rudp, so the probe doesn't wait behind the peer's window.
+  void SendProbe(const NodeInfo& peer);
+  void DoSendToClosestNode(const protobuf::Message& message, const DeliveryFunctor& delivered);
+  // Sends a direct |message| over the shortcut to its destination, if there is one, falling back
+  // to routing it should that fail.  Otherwise counts the message towards a shortcut and returns
+  // false, having sent nothing.
+  bool SendViaShortcut(const protobuf::Message& message, const DeliveryFunctor& delivered);
+  void ScheduleShortcutCheck();
+  void CloseIdleShortcuts();
+  void SendEncodedToDirect(const EncodedMessage& message, const NodeId& peer_node_id,
+                           const NodeId& peer_connection_id, const DeliveryFunctor& delivered);
   void SendTo(const protobuf::Message& message, const NodeId& peer_node_id,
-              const NodeId& peer_connection_id);
-  void RecursiveSendOn(protobuf::Message message, NodeInfo last_node_attempted = NodeInfo(),
-                       int attempt_count = 0);
+              const NodeId& peer_connection_id,
+              const DeliveryFunctor& delivered = DeliveryFunctor());
+  // Also reports the outcome to |delivered|, if set.
+  static rudp::MessageSentFunctor WithDelivery(rudp::MessageSentFunctor message_sent_functor,
+                                               const DeliveryFunctor& delivered);
+  rudp::MessageSentFunctor SendToFunctor(const NodeId& peer_node_id, int32_t message_id,
+                                         int32_t message_type, int32_t hops_to_live);
+  // A message being sent on, shared unchanged by every attempt to send it and by the completion
+  // handlers which retry it, so that none of them copies the payload.
+  typedef std::shared_ptr<const protobuf::Message> SharedMessage;
+  // Moves |message| into a SharedMessage, adding this node to its route history first.
+  SharedMessage ShareForSending(protobuf::Message& message);
+  // Sends a copy of |message| on as below.
+  void RecursiveSendOn(const protobuf::Message& message,
+                       DeliveryFunctor delivered = DeliveryFunctor());
+  // |failed_peers| holds the ID of the peer for each failed attempt to send |message|.  They are
+  // passed over when choosing the next peer unless |retry_failed_peers| is set.  |delivered|, if
+  // set, is told once whether some peer accepted the message.
+  void RecursiveSendOn(const SharedMessage& message, std::vector<std::string> failed_peers,
+                       bool retry_failed_peers, DeliveryFunctor delivered);
+  // Sends |message| to |peer|, chosen as its next hop when the routing table was at
+  // |routes_version|, handling the outcome as RecursiveSendOn does.
+  void SendOnVia(const SharedMessage& message, const NodeInfo& peer, uint64_t routes_version,
+                 std::vector<std::string> failed_peers = std::vector<std::string>(),
+                 DeliveryFunctor delivered = DeliveryFunctor());
+  // Appends the next hop for each of |messages| at |indices|, or a default-constructed NodeInfo
+  // where there is none, paired with its index.  Must be called with running_mutex_ held.
+  void ChooseNextHops(const std::vector<protobuf::Message>& messages,
+                      const std::vector<size_t>& indices, bool ignore_exact_match,
+                      std::vector<std::pair<NodeInfo, size_t>>& next_hops);
+  // Drops |peer| if it keeps failing, then sends |message| on via another peer.
+  void OnSendOnFailed(const SharedMessage& message, std::vector<std::string> failed_peers,
+                      const NodeInfo& peer, int message_sent,
+                      const DeliveryFunctor& delivered = DeliveryFunctor());
+  void ScheduleSendRetry(const SharedMessage& message, std::vector<std::string> failed_peers,
+                         DeliveryFunctor delivered);
   void AdjustRouteHistory(protobuf::Message& message);
+  // Returns a cached next hop towards |destination_id| which is still closer to it than this node
+  // and isn't in |exclude|, else a default-constructed NodeInfo.
+  NodeInfo GetCachedRoute(const NodeId& destination_id, const ExcludedNodes& exclude,
+                          bool ignore_exact_match);
+  void CacheRoute(const NodeId& destination_id, const NodeInfo& next_hop, uint64_t routes_version);
+  void InvalidateRoute(const NodeId& destination_id, const NodeId& next_hop_id);
+
+  struct OutboundBatch {
+    explicit OutboundBatch(boost::asio::io_service& io_service)
+        : flush_timer(io_service), messages(), message_sent_functors(), size(0),
+          priority(SendPriority::kRequest) {}
+    RoutingTimer flush_timer;
+    std::vector<std::string> messages;
+    std::vector<rudp::MessageSentFunctor> message_sent_functors;
+    size_t size;
+    SendPriority priority;  // the highest among messages
+  };
+
+  struct CachedRoute {
+    CachedRoute() : next_hop(), routes_version(0) {}
+    NodeInfo next_hop;
+    uint64_t routes_version;  // RoutingTable::routes_version() when next_hop was chosen
+  };
+
+  struct QueuedSend {
+    QueuedSend(std::string serialised_message_in, rudp::MessageSentFunctor message_sent_functor_in)
+        : serialised_message(std::move(serialised_message_in)),
+          message_sent_functor(std::move(message_sent_functor_in)) {}
+    std::string serialised_message;
+    rudp::MessageSentFunctor message_sent_functor;
+  };
+
+  // Sends to one connection which rudp hasn't yet reported on, and node-level messages waiting
+  // for room among them.
+  struct PeerWindow {
+    PeerWindow() : in_flight(0), responses(), requests(), responses_in_turn(0) {}
+    size_t queued() const { return responses.size() + requests.size(); }
+    // Takes Parameters::response_send_weight responses for each request while both are waiting.
+    QueuedSend PopNext();
+    size_t in_flight;
+    std::deque<QueuedSend> responses, requests;
+    uint16_t responses_in_turn;  // taken since the last request
+  };
+
+  // Held weakly by scheduled send retries, batch flushes and windowed sends' functors, which only
+  // act on this object while it is still running.
+  struct TimerGuard {
+    TimerGuard() : mutex(), running(true) {}
+    std::mutex mutex;
+    bool running;
+  };
 
   bool running_;
-  std::mutex running_mutex_;
+  HotPathMutex running_mutex_;
+  AsioService& asio_service_;
+  std::shared_ptr<TimerGuard> timer_guard_;
+  std::mutex outbound_mutex_;
+  std::unordered_map<NodeId, std::shared_ptr<OutboundBatch>, NodeIdHash> outbound_batches_;
+  mutable std::mutex window_mutex_;
+  std::unordered_map<NodeId, PeerWindow, NodeIdHash> peer_windows_;
+  size_t queued_count_;
+  bool congested_;
+  CongestionFunctor congestion_functor_;
+  std::mutex route_cache_mutex_;
+  std::unordered_map<uint64_t, CachedRoute> route_cache_;
+  // Guards bootstrap_attempt_, bootstrap_contacts_ and bootstrap_contact_, which Redirect
+  // updates mid-join
+  std::mutex bootstrap_contacts_mutex_;
   uint16_t bootstrap_attempt_;
   BootstrapContacts bootstrap_contacts_;
+  BootstrapRanking bootstrap_ranking_;
+  // The contact bootstrapped off, where known, else unspecified
+  BootstrapContact bootstrap_contact_;
+  mutable std::mutex peer_endpoints_mutex_;
+  std::unordered_map<NodeId, boost::asio::ip::udp::endpoint, NodeIdHash> peer_endpoints_;
+  // Connections to peers which decode compressed payloads, see data_compression.h
+  mutable std::mutex compression_peers_mutex_;
+  std::unordered_set<NodeId, NodeIdHash> compression_peers_;
+  PendingRequests pending_requests_;
+  RoutingMetrics metrics_;
   NodeId bootstrap_connection_id_;
   NodeId this_node_relay_connection_id_;
   RoutingTable& routing_table_;
   ClientRoutingTable& client_routing_table_;
   rudp::NatType nat_type_;
   NewBootstrapContactFunctor new_bootstrap_contact_;
-  rudp::ManagedConnections rudp_;
+  LivenessTracker liveness_;
+  SuspectedDeadFunctor suspected_dead_functor_;
+  RoutingTimer liveness_timer_;
+  ShortcutTable shortcuts_;
+  ShortcutFunctor shortcut_functor_;
+  RoutingTimer shortcut_timer_;
+  std::unique_ptr<Transport> transport_;
 };
 
 }  // namespace routing
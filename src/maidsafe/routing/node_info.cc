@@ -18,14 +18,98 @@
 
 #include "maidsafe/routing/node_info.h"
 
+#include <algorithm>
 #include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+const size_t kMinSweepSize(64);
+
+// Weakly held, so that a key is freed once the last node holding it has gone.  Expired entries are
+// swept whenever the map has doubled in size since the last sweep.
+class PublicKeyInterner {
+ public:
+  PublicKeyInterner() : mutex_(), keys_(), sweep_size_(kMinSweepSize) {}
+
+  std::shared_ptr<const asymm::PublicKey> Intern(const asymm::PublicKey& public_key) {
+    if (!asymm::ValidateKey(public_key))
+      return std::make_shared<const asymm::PublicKey>(public_key);
+    const std::string kFingerprint(PublicKeyFingerprint(public_key));
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::weak_ptr<const asymm::PublicKey>& entry(keys_[kFingerprint]);
+    auto interned(entry.lock());
+    if (!interned) {
+      interned = std::make_shared<const asymm::PublicKey>(public_key);
+      entry = interned;
+    }
+    if (keys_.size() >= sweep_size_)
+      Sweep();
+    return interned;
+  }
+
+  size_t LiveCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::count_if(
+        keys_.begin(), keys_.end(),
+        [](const std::pair<const std::string, std::weak_ptr<const asymm::PublicKey>>& entry) {
+          return !entry.second.expired();
+        }));
+  }
+
+ private:
+  void Sweep() {
+    for (auto itr(keys_.begin()); itr != keys_.end();) {
+      if (itr->second.expired())
+        itr = keys_.erase(itr);
+      else
+        ++itr;
+    }
+    sweep_size_ = std::max(kMinSweepSize, 2 * keys_.size());
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::weak_ptr<const asymm::PublicKey>> keys_;
+  size_t sweep_size_;
+};
+
+PublicKeyInterner& Interner() {
+  static PublicKeyInterner interner;
+  return interner;
+}
+
+const asymm::PublicKey& EmptyPublicKey() {
+  static const asymm::PublicKey kEmpty;
+  return kEmpty;
+}
+
+}  // unnamed namespace
+
+SharedPublicKey::SharedPublicKey() : key_() {}
+
+SharedPublicKey::SharedPublicKey(const asymm::PublicKey& public_key)
+    : key_(Interner().Intern(public_key)) {}
+
+SharedPublicKey& SharedPublicKey::operator=(const asymm::PublicKey& public_key) {
+  key_ = Interner().Intern(public_key);
+  return *this;
+}
+
+size_t SharedPublicKey::InternedCount() { return Interner().LiveCount(); }
+
+const asymm::PublicKey& SharedPublicKey::get() const {
+  return key_ ? *key_ : EmptyPublicKey();
+}
+
 NodeInfo::NodeInfo()
     : node_id(),
       connection_id(),
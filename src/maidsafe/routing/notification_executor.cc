@@ -0,0 +1,174 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/notification_executor.h"
+
+#include <utility>
+
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+template <typename Functor>
+void DeliverInline(const Functor& functor) {
+  try {
+    functor();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Notification handler threw: " << e.what();
+  }
+}
+
+}  // unnamed namespace
+
+NotificationExecutor::NotificationExecutor()
+    : mutex_(),
+      condition_(),
+      running_(true),
+      network_status_pending_(false),
+      network_status_(0),
+      network_status_functor_(),
+      matrix_change_(),
+      matrix_change_functor_(),
+      network_status_first_(false),
+      thread_() {}
+
+NotificationExecutor::~NotificationExecutor() { Stop(); }
+
+void NotificationExecutor::PostNetworkStatus(int network_status,
+                                             const NetworkStatusFunctor& functor) {
+  if (!functor)
+    return;
+  if (RoutingClock::is_virtual()) {
+    if (Running())
+      DeliverInline([&] { functor(network_status); });
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    if (!network_status_pending_) {
+      network_status_first_ = !matrix_change_;
+      network_status_pending_ = true;
+    }
+    network_status_ = network_status;
+    network_status_functor_ = functor;
+    Start();
+  }
+  condition_.notify_one();
+}
+
+void NotificationExecutor::PostMatrixChange(std::shared_ptr<MatrixChange> matrix_change,
+                                            const MatrixChangedFunctor& functor) {
+  if (!functor || !matrix_change)
+    return;
+  if (RoutingClock::is_virtual()) {
+    if (Running() && !matrix_change->OldEqualsToNew())
+      DeliverInline([&] { functor(matrix_change); });
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    if (!matrix_change_) {
+      network_status_first_ = network_status_pending_;
+      matrix_change_ = matrix_change;
+    } else {
+      // The oldest matrix is kept from the first change still pending and the newest from this.
+      matrix_change_ = std::make_shared<MatrixChange>(MatrixChange(
+          matrix_change->node_id_, matrix_change_->old_matrix_, matrix_change->new_matrix_));
+    }
+    matrix_change_functor_ = functor;
+    Start();
+  }
+  condition_.notify_one();
+}
+
+void NotificationExecutor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  condition_.notify_one();
+  if (!thread_.joinable())
+    return;
+  // A handler may itself be what's stopping this.
+  if (thread_.get_id() == std::this_thread::get_id())
+    thread_.detach();
+  else
+    thread_.join();
+}
+
+bool NotificationExecutor::Running() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return running_;
+}
+
+void NotificationExecutor::Start() {
+  if (!thread_.joinable())
+    thread_ = std::thread([this] { Deliver(); });
+}
+
+void NotificationExecutor::Deliver() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    condition_.wait(lock, [this] {
+      return !running_ || network_status_pending_ || matrix_change_;
+    });
+    if (!running_)
+      return;
+    try {
+      if (network_status_pending_ && (network_status_first_ || !matrix_change_)) {
+        int network_status(network_status_);
+        NetworkStatusFunctor functor;
+        functor.swap(network_status_functor_);
+        network_status_pending_ = false;
+        lock.unlock();
+        functor(network_status);
+      } else {
+        std::shared_ptr<MatrixChange> matrix_change;
+        matrix_change.swap(matrix_change_);
+        MatrixChangedFunctor functor;
+        functor.swap(matrix_change_functor_);
+        lock.unlock();
+        // Merged changes may have cancelled out.
+        if (!matrix_change->OldEqualsToNew())
+          functor(matrix_change);
+      }
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Notification handler threw: " << e.what();
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,78 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_NOTIFICATION_EXECUTOR_H_
+#define MAIDSAFE_ROUTING_NOTIFICATION_EXECUTOR_H_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+class MatrixChange;
+
+// Delivers network status and matrix change notifications to the application on a thread of its
+// own, so that a slow handler never holds up routing.  Notifications not yet delivered are
+// coalesced rather than queued: only the latest network status is kept, and successive matrix
+// changes are merged into one spanning them all, so at most one of each is ever pending.  Under
+// virtual time each is instead delivered at once on the posting thread, keeping a simulation run
+// on a single executor thread deterministic.
+class NotificationExecutor {
+ public:
+  NotificationExecutor();
+  ~NotificationExecutor();
+  void PostNetworkStatus(int network_status, const NetworkStatusFunctor& functor);
+  void PostMatrixChange(std::shared_ptr<MatrixChange> matrix_change,
+                        const MatrixChangedFunctor& functor);
+  // Joins the thread after any notification being delivered.  Those still pending are discarded.
+  void Stop();
+
+ private:
+  NotificationExecutor(const NotificationExecutor&);
+  NotificationExecutor(const NotificationExecutor&&);
+  NotificationExecutor& operator=(const NotificationExecutor&);
+
+  // Starts the thread if it isn't running yet.  Must be called under mutex_.
+  void Start();
+  bool Running();
+  void Deliver();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_;
+  bool network_status_pending_;
+  int network_status_;
+  NetworkStatusFunctor network_status_functor_;
+  std::shared_ptr<MatrixChange> matrix_change_;  // null unless one is pending
+  MatrixChangedFunctor matrix_change_functor_;
+  // Whether the pending network status was posted before the pending matrix change
+  bool network_status_first_;
+  std::thread thread_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_NOTIFICATION_EXECUTOR_H_
@@ -0,0 +1,187 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_OBJECT_POOL_H_
+#define MAIDSAFE_ROUTING_OBJECT_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+// Recycles heap objects of type T, such as protobuf messages, which must have Clear() to drop
+// their contents while keeping the capacity of their fields, and ByteSize().  Each thread takes
+// from and returns to a small cache of its own without locking.  An object whose ByteSize() is over
+// kMaxPooledBytes when released is freed instead, so that pooled objects don't pin big buffers the
+// memory budgets can't see.  An object may be returned on a different thread
+// from the one it was taken on; a thread whose cache is empty or full exchanges a batch with a
+// shared depot under a mutex, and objects beyond the depot's capacity are freed.
+template <typename T>
+class ObjectPool {
+ public:
+  struct Releaser {
+    void operator()(T* object) const { Release(object); }
+  };
+  typedef std::unique_ptr<T, Releaser> Pointer;
+
+  static const size_t kThreadCacheSize = 16;
+  static const size_t kBatchSize = kThreadCacheSize / 2;
+  static const size_t kDepotSize = 64;
+  static const size_t kMaxPooledBytes = 64 * 1024;
+
+  // Returns a cleared object, recycled if any is pooled.
+  static Pointer Acquire();
+  // As Acquire, for an object to be shared; its control block is still allocated afresh.
+  static std::shared_ptr<T> AcquireShared();
+  static void Release(T* object);
+  // Objects pooled in the depot, for tests.
+  static size_t DepotSize();
+
+ private:
+  typedef std::vector<std::unique_ptr<T>> Objects;
+
+  struct Depot {
+    Depot() : mutex(), objects() {}
+    std::mutex mutex;
+    Objects objects;
+  };
+
+  // Of this thread's cache.  Trivially destructible, so still readable while the thread's other
+  // thread_locals are being destroyed, by which time its cache may be gone.
+  enum CacheState { kUnborn = 0, kLive, kDestroyed };
+
+  struct Cache {
+    Cache() : objects() {
+      objects.reserve(kThreadCacheSize);
+      State() = kLive;
+    }
+    ~Cache() {
+      State() = kDestroyed;
+      SpillToDepot(objects, objects.size());
+    }
+    Objects objects;
+  };
+
+  ObjectPool();
+
+  static Depot& GetDepot();
+  static CacheState& State();
+  static Cache& GetCache();
+  // Moves the last |count| of |objects| to the depot, freeing any it hasn't room for.
+  static void SpillToDepot(Objects& objects, size_t count);
+};
+
+template <typename T>
+const size_t ObjectPool<T>::kThreadCacheSize;
+template <typename T>
+const size_t ObjectPool<T>::kBatchSize;
+template <typename T>
+const size_t ObjectPool<T>::kDepotSize;
+template <typename T>
+const size_t ObjectPool<T>::kMaxPooledBytes;
+
+template <typename T>
+typename ObjectPool<T>::Pointer ObjectPool<T>::Acquire() {
+  Cache& cache(GetCache());
+  if (cache.objects.empty()) {
+    Depot& depot(GetDepot());
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    while (!depot.objects.empty() && cache.objects.size() != kBatchSize) {
+      cache.objects.push_back(std::move(depot.objects.back()));
+      depot.objects.pop_back();
+    }
+  }
+  if (cache.objects.empty())
+    return Pointer(new T);
+  Pointer object(cache.objects.back().release());
+  cache.objects.pop_back();
+  return object;
+}
+
+template <typename T>
+std::shared_ptr<T> ObjectPool<T>::AcquireShared() {
+  return std::shared_ptr<T>(Acquire().release(), Releaser());
+}
+
+template <typename T>
+void ObjectPool<T>::Release(T* object) {
+  if (!object)
+    return;
+  std::unique_ptr<T> owned(object);
+  if (static_cast<size_t>(owned->ByteSize()) > kMaxPooledBytes)
+    return;
+  owned->Clear();
+  if (State() == kDestroyed) {
+    Objects orphan;
+    orphan.push_back(std::move(owned));
+    return SpillToDepot(orphan, 1);
+  }
+  Cache& cache(GetCache());
+  if (cache.objects.size() == kThreadCacheSize)
+    SpillToDepot(cache.objects, kBatchSize);
+  cache.objects.push_back(std::move(owned));
+}
+
+template <typename T>
+size_t ObjectPool<T>::DepotSize() {
+  Depot& depot(GetDepot());
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  return depot.objects.size();
+}
+
+template <typename T>
+typename ObjectPool<T>::Depot& ObjectPool<T>::GetDepot() {
+  // Never destroyed, so that threads outliving static destruction can still return objects.
+  static Depot* const kDepot(new Depot);
+  return *kDepot;
+}
+
+template <typename T>
+typename ObjectPool<T>::CacheState& ObjectPool<T>::State() {
+  static thread_local CacheState state(kUnborn);
+  return state;
+}
+
+template <typename T>
+typename ObjectPool<T>::Cache& ObjectPool<T>::GetCache() {
+  static thread_local Cache cache;
+  return cache;
+}
+
+template <typename T>
+void ObjectPool<T>::SpillToDepot(Objects& objects, size_t count) {
+  const auto kFirst(objects.end() - count);
+  {
+    Depot& depot(GetDepot());
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    for (auto itr(kFirst); itr != objects.end() && depot.objects.size() != kDepotSize; ++itr)
+      depot.objects.push_back(std::move(*itr));
+  }
+  objects.erase(kFirst, objects.end());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_OBJECT_POOL_H_
@@ -31,6 +31,9 @@ uint16_t Parameters::thread_count(8);
 uint16_t Parameters::num_chunks_to_cache(100);
 uint16_t Parameters::closest_nodes_size(8);
 uint16_t Parameters::group_size(4);
+uint16_t Parameters::group_fan_out(0);
+bool Parameters::aggregate_group_responses(false);
+std::chrono::milliseconds Parameters::group_response_aggregation_timeout(2000);
 uint16_t Parameters::proximity_factor(2);
 uint16_t Parameters::max_routing_table_size(64);
 uint16_t Parameters::routing_table_size_threshold(max_routing_table_size / 4);
@@ -42,12 +45,90 @@ std::chrono::seconds Parameters::find_node_interval(10);
 std::chrono::seconds Parameters::recovery_time_lag(5);
 std::chrono::seconds Parameters::re_bootstrap_time_lag(10);
 std::chrono::seconds Parameters::find_close_node_interval(3);
+std::chrono::milliseconds Parameters::matrix_publish_interval(500);
+uint16_t Parameters::matrix_snapshot_period(20);
+std::chrono::milliseconds Parameters::group_change_settle_window(0);
 uint16_t Parameters::find_node_repeats_per_num_requested(3);
 uint16_t Parameters::maximum_find_close_node_failures(10);
+uint16_t Parameters::find_nodes_alpha(3);
+std::chrono::milliseconds Parameters::find_nodes_query_timeout(2000);
+bool Parameters::streamlined_handshake(false);
+uint16_t Parameters::standby_cache_size(8);
+uint16_t Parameters::max_concurrent_connect_attempts(16);
+uint16_t Parameters::max_queued_connect_requests(64);
+std::chrono::seconds Parameters::connect_attempt_timeout(10);
+std::chrono::milliseconds Parameters::liveness_idle_time(0);
+std::chrono::milliseconds Parameters::liveness_probe_timeout(3000);
+std::chrono::milliseconds Parameters::liveness_check_interval(1000);
 uint16_t Parameters::max_route_history(3);
+uint16_t Parameters::max_send_retries(6);
+std::chrono::milliseconds Parameters::send_retry_base_delay(50);
+std::chrono::milliseconds Parameters::send_retry_max_delay(1000);
+uint32_t Parameters::coalesced_message_size_limit(2048);
+uint32_t Parameters::max_coalesced_batch_size(32768);
+std::chrono::milliseconds Parameters::coalesce_flush_delay(0);
+bool Parameters::latency_aware_routing(false);
+uint16_t Parameters::latency_aware_candidates(3);
+uint16_t Parameters::proximity_replacement_percent(50);
+bool Parameters::lookahead_routing(true);
+uint16_t Parameters::lookahead_candidates(4);
+uint16_t Parameters::table_summary_size(32);
+std::chrono::seconds Parameters::table_summary_interval(60);
+uint32_t Parameters::max_in_flight_per_peer(32);
+uint32_t Parameters::max_queued_per_peer(256);
+uint32_t Parameters::outbound_queue_high_water(1024);
+uint16_t Parameters::response_send_weight(3);
+uint32_t Parameters::route_cache_size(512);
+uint16_t Parameters::route_cache_prefix_bits(32);
+uint16_t Parameters::race_send_width(1);
+bool Parameters::fast_path_forwarding(true);
+uint16_t Parameters::relay_retirement_threshold(4);
+uint32_t Parameters::stream_fragment_size(256 * 1024);
+uint16_t Parameters::stream_window(8);
+uint16_t Parameters::stream_fragment_attempts(3);
+uint32_t Parameters::max_stream_size(32 * 1024 * 1024);
+uint16_t Parameters::max_incoming_streams(4);
+std::chrono::steady_clock::duration Parameters::stream_reassembly_timeout(std::chrono::seconds(30));
+uint32_t Parameters::compression_threshold(1024);
+int Parameters::compression_level(1);
+bool Parameters::digest_rpc_responses(true);
+bool Parameters::message_deadlines(true);
+std::chrono::steady_clock::duration Parameters::message_deadline_tolerance(std::chrono::seconds(5));
+uint16_t Parameters::route_quality_max_bucket_bias(2);
+uint16_t Parameters::inbound_dispatch_shards(16);
+uint32_t Parameters::max_inbound_queued_per_shard(1024);
+uint16_t Parameters::dispatch_cores(0);
+bool Parameters::pin_dispatch_threads(true);
+uint32_t Parameters::application_queue_size(0);
+uint32_t Parameters::duplicate_filter_capacity(32768);
+std::chrono::steady_clock::duration Parameters::duplicate_filter_window(std::chrono::seconds(60));
+bool Parameters::sign_node_level_messages(false);
+bool Parameters::verify_signatures(false);
+uint16_t Parameters::signature_verification_threads(2);
+uint16_t Parameters::signature_verification_batch_size(16);
+uint32_t Parameters::verified_signature_cache_size(4096);
+uint64_t Parameters::chunk_cache_bytes(0);
+uint16_t Parameters::chunk_cache_shards(8);
+bool Parameters::coalesce_cacheable_gets(false);
+uint16_t Parameters::cache_popularity_threshold(2);
+uint16_t Parameters::group_cache_size(256);
+std::chrono::steady_clock::duration Parameters::group_cache_ttl(std::chrono::seconds(30));
+uint16_t Parameters::public_key_cache_size(1024);
+std::chrono::steady_clock::duration Parameters::public_key_cache_ttl(std::chrono::minutes(10));
 uint16_t Parameters::hops_to_live(50);
 uint16_t Parameters::accepted_distance_tolerance(1);
+uint16_t Parameters::network_distance_window_size(256);
 uint16_t Parameters::greedy_fraction(Parameters::max_routing_table_size * 3 / 4);
+uint16_t Parameters::removal_high_watermark(
+    Parameters::greedy_fraction +
+    (Parameters::max_routing_table_size - Parameters::greedy_fraction) / 2);
+uint16_t Parameters::removal_low_watermark(Parameters::greedy_fraction);
+std::chrono::seconds Parameters::eviction_backoff(60);
+bool Parameters::auto_tune_table_size(false);
+std::chrono::seconds Parameters::auto_tune_interval(30);
+uint16_t Parameters::auto_tune_min_table_size(2 * Parameters::closest_nodes_size);
+uint16_t Parameters::auto_tune_entries_per_level(2);
+uint16_t Parameters::auto_tune_hysteresis(4);
 std::chrono::steady_clock::duration Parameters::local_retreival_timeout(std::chrono::seconds(2));
 uint16_t Parameters::routing_table_ready_to_response(Parameters::greedy_fraction * 9 / 10);
 bptime::time_duration Parameters::connect_rpc_prune_timeout(
@@ -65,8 +146,33 @@ bool Parameters::append_maidsafe_local_endpoints(false);
 // TODO(Prakash) : To allow bootstrapping off nodes on same machine, revert once local network
 // available
 bool Parameters::append_local_live_port_endpoint(false);
+uint16_t Parameters::bootstrap_first_wave_size(1);
+uint8_t Parameters::relay_overload_load(204);
+uint16_t Parameters::relay_redirect_count(4);
+uint32_t Parameters::bootstrap_journal_compaction_size(64 * 1024);
+std::chrono::milliseconds Parameters::bootstrap_store_write_delay(1000);
+std::chrono::seconds Parameters::routing_table_snapshot_interval(60);
+uint32_t Parameters::path_trace_sampling(0);
+uint32_t Parameters::inbound_trace_buffer_size(16 * 1024 * 1024);
+uint64_t Parameters::memory_soft_budget(0);
+uint64_t Parameters::memory_hard_budget(0);
+std::chrono::seconds Parameters::memory_check_interval(5);
+uint32_t Parameters::shortcut_message_threshold(0);
+std::chrono::seconds Parameters::shortcut_window(10);
+std::chrono::seconds Parameters::shortcut_idle_time(30);
+uint16_t Parameters::max_shortcuts(8);
 // TODO(Prakash): BEFORE_RELEASE enable caching after persona tests are passing
 bool Parameters::caching(true);
+
+NodeParameters::NodeParameters()
+    : max_routing_table_size(Parameters::max_routing_table_size),
+      routing_table_size_threshold(Parameters::routing_table_size_threshold),
+      max_routing_table_size_for_client(Parameters::max_routing_table_size_for_client),
+      max_client_routing_table_size(Parameters::max_client_routing_table_size),
+      greedy_fraction(Parameters::greedy_fraction),
+      removal_high_watermark(Parameters::removal_high_watermark),
+      removal_low_watermark(Parameters::removal_low_watermark) {}
+
 }  // namespace routing
 
 }  // namespace maidsafe
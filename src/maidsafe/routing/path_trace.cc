@@ -0,0 +1,124 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/path_trace.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const size_t kReceivedOffset(kRouteHistoryTagSize);
+const size_t kQueueDelayOffset(kReceivedOffset + 8);
+const size_t kNextHopOffset(kQueueDelayOffset + 4);
+
+void AppendFixed(uint64_t value, size_t size, std::string& out) {
+  for (size_t i(0); i != size; ++i)
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint64_t ReadFixed(const std::string& in, size_t offset, size_t size) {
+  uint64_t value(0);
+  for (size_t i(0); i != size; ++i)
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(in[offset + i])) << (8 * i);
+  return value;
+}
+
+void AppendRecord(std::string& trace, const NodeId& this_node_id,
+                  std::chrono::system_clock::time_point received,
+                  std::chrono::steady_clock::duration queue_delay) {
+  if (trace.size() / kPathTraceRecordSize >= kMaxPathTraceHops)
+    return;
+  trace.append(RouteHistoryTag(this_node_id));
+  AppendFixed(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                  received.time_since_epoch()).count()), 8, trace);
+  const int64_t kDelay(std::chrono::duration_cast<std::chrono::microseconds>(queue_delay).count());
+  AppendFixed(static_cast<uint64_t>(std::min<int64_t>(std::max<int64_t>(kDelay, 0),
+                                                  std::numeric_limits<uint32_t>::max())),
+              4, trace);
+  trace.append(kRouteHistoryTagSize, '\0');
+}
+
+bool LastRecordIsFrom(const std::string& trace, const std::string& tag) {
+  return trace.size() >= kPathTraceRecordSize &&
+         trace.compare(trace.size() - kPathTraceRecordSize, kRouteHistoryTagSize, tag) == 0;
+}
+
+}  // unnamed namespace
+
+bool SamplePathTrace() {
+  return Parameters::path_trace_sampling != 0 &&
+         RandomUint32() % Parameters::path_trace_sampling == 0;
+}
+
+void AddPathTraceHop(protobuf::Message& message, const NodeId& this_node_id,
+                     std::chrono::system_clock::time_point received,
+                     std::chrono::steady_clock::duration queue_delay) {
+  AppendRecord(*message.mutable_path_trace(), this_node_id, received, queue_delay);
+}
+
+void SetPathTraceNextHop(protobuf::Message& message, const NodeId& this_node_id,
+                         const NodeId& next_hop_id) {
+  std::string& trace(*message.mutable_path_trace());
+  const std::string kThisTag(RouteHistoryTag(this_node_id));
+  if (!LastRecordIsFrom(trace, kThisTag)) {
+    AppendRecord(trace, this_node_id, std::chrono::system_clock::now(),
+                 std::chrono::steady_clock::duration(0));
+    if (!LastRecordIsFrom(trace, kThisTag))
+      return;
+  }
+  trace.replace(trace.size() - kPathTraceRecordSize + kNextHopOffset, kRouteHistoryTagSize,
+                RouteHistoryTag(next_hop_id));
+}
+
+bool GetPathTrace(const protobuf::Message& message, PathTrace& trace) {
+  if (!message.has_path_trace() || message.path_trace().size() % kPathTraceRecordSize != 0)
+    return false;
+  const std::string& records(message.path_trace());
+  trace = PathTrace();
+  trace.message_id = message.id();
+  trace.message_type = message.type();
+  trace.request = message.request();
+  const std::string kNoNextHop(kRouteHistoryTagSize, '\0');
+  for (size_t offset(0); offset != records.size(); offset += kPathTraceRecordSize) {
+    PathHop hop;
+    hop.node_tag = records.substr(offset, kRouteHistoryTagSize);
+    hop.received = std::chrono::system_clock::time_point(std::chrono::duration_cast<
+        std::chrono::system_clock::duration>(std::chrono::microseconds(
+            static_cast<int64_t>(ReadFixed(records, offset + kReceivedOffset, 8)))));
+    hop.queue_delay = std::chrono::microseconds(ReadFixed(records, offset + kQueueDelayOffset, 4));
+    if (records.compare(offset + kNextHopOffset, kRouteHistoryTagSize, kNoNextHop) != 0)
+      hop.next_hop_tag = records.substr(offset + kNextHopOffset, kRouteHistoryTagSize);
+    trace.hops.push_back(hop);
+  }
+  return true;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,65 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PATH_TRACE_H_
+#define MAIDSAFE_ROUTING_PATH_TRACE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// protobuf::Message::path_trace is present only on sampled messages, and holds one fixed-size
+// record per hop, oldest first: the node's route history tag, when it received the message in
+// microseconds of its system clock, how long the message then queued in microseconds, and the tag
+// of the peer it sent the message on to, zeroed until chosen.  Records beyond kMaxPathTraceHops
+// are dropped, so that a looping message can't grow without bound.
+const size_t kPathTraceRecordSize = 28;
+const size_t kMaxPathTraceHops = 64;
+
+// Whether a new message should be sampled, per Parameters::path_trace_sampling.
+bool SamplePathTrace();
+// Appends this node's record on receiving a sampled message.
+void AddPathTraceHop(protobuf::Message& message, const NodeId& this_node_id,
+                     std::chrono::system_clock::time_point received,
+                     std::chrono::steady_clock::duration queue_delay);
+// Records |next_hop_id| in this node's record, first appending one stamped now if the message has
+// none from this node, i.e. it is being sent rather than passed on.  A retry to a different peer
+// overwrites the choice.
+void SetPathTraceNextHop(protobuf::Message& message, const NodeId& this_node_id,
+                         const NodeId& next_hop_id);
+// Returns false if |message|'s trace is missing or malformed.
+bool GetPathTrace(const protobuf::Message& message, PathTrace& trace);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PATH_TRACE_H_
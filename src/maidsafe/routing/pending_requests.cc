@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/pending_requests.h"
+
+#include "maidsafe/common/crypto.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+std::string RequestDigest(const std::string& serialised_request) {
+  return crypto::Hash<crypto::SHA1>(serialised_request).string();
+}
+
+PendingRequests::PendingRequests(std::chrono::steady_clock::duration timeout)
+    : kTimeout_(timeout), mutex_(), requests_() {}
+
+void PendingRequests::Add(protobuf::Message& message) {
+  if (!Parameters::digest_rpc_responses || message.data_size() != 1)
+    return;
+  message.set_digest_reply(true);
+  const auto kNow(RoutingClock::now());
+  Key key(message.id(), RequestDigest(message.data(0)));
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune(kNow);
+  requests_.erase(key);  // a resend of the same request
+  requests_.insert(std::make_pair(std::move(key), Request(message.data(0), kNow + kTimeout_)));
+}
+
+bool PendingRequests::Find(int32_t id, const std::string& digest,
+                           std::string& serialised_request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune(RoutingClock::now());
+  auto itr(requests_.find(std::make_pair(id, digest)));
+  if (itr == requests_.end())
+    return false;
+  serialised_request = itr->second.serialised;
+  return true;
+}
+
+bool PendingRequests::Parse(int32_t id, const std::string& digest,
+                            google::protobuf::MessageLite& request) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune(RoutingClock::now());
+  auto itr(requests_.find(std::make_pair(id, digest)));
+  return itr != requests_.end() && request.ParseFromString(itr->second.serialised);
+}
+
+size_t PendingRequests::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return requests_.size();
+}
+
+void PendingRequests::Prune(const std::chrono::steady_clock::time_point& now) {
+  for (auto itr(requests_.begin()); itr != requests_.end();) {
+    if (itr->second.expiry < now)
+      itr = requests_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,129 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PENDING_REQUESTS_H_
+#define MAIDSAFE_ROUTING_PENDING_REQUESTS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "google/protobuf/message_lite.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The digest a reply to a routing request with digest_reply set carries in place of the request.
+std::string RequestDigest(const std::string& serialised_request);
+
+// Sets the original_request of |response| to the request in |request|, or just its digest if
+// asked for.
+template <typename Response>
+void SetOriginalRequest(const protobuf::Message& request, Response& response) {
+  if (request.digest_reply())
+    response.set_request_digest(RequestDigest(request.data(0)));
+  else
+    response.set_original_request(request.data(0));
+}
+
+// As above, also setting the original_signature of |response| when the request is sent back.
+template <typename Response>
+void SetSignedOriginalRequest(const protobuf::Message& request, Response& response) {
+  SetOriginalRequest(request, response);
+  if (!request.digest_reply())
+    response.set_original_signature(request.signature());
+}
+
+// As SetSignedOriginalRequest, but moving the request out of |request| rather than copying it,
+// for a handler about to replace the request with its response.
+template <typename Response>
+void TakeSignedOriginalRequest(protobuf::Message& request, Response& response) {
+  if (request.digest_reply()) {
+    response.set_request_digest(RequestDigest(request.data(0)));
+    return;
+  }
+  response.mutable_original_request()->swap(*request.mutable_data(0));
+  response.mutable_original_signature()->swap(*request.mutable_signature());
+  request.clear_signature();
+}
+
+// Routing requests kept by their sender when Parameters::digest_rpc_responses is set, so that the
+// replies need only name them by digest rather than carry them back in full.  A request is kept for
+// |timeout|, so that every reply to it which arrives in that time can be matched.
+class PendingRequests {
+ public:
+  explicit PendingRequests(std::chrono::steady_clock::duration timeout);
+
+  // Keeps the request in |message| and sets its digest_reply, if digest_rpc_responses is set.
+  void Add(protobuf::Message& message);
+  // Copies the request with message ID |id| and a digest of |digest| into |serialised_request|,
+  // returning false if there is none.
+  bool Find(int32_t id, const std::string& digest, std::string& serialised_request);
+  // Copies the request which |response|, carried in |reply|, answers into |serialised_request|,
+  // whether it was carried back in full or named by digest.
+  template <typename Response>
+  bool Find(const protobuf::Message& reply, const Response& response,
+            std::string& serialised_request) {
+    if (response.has_request_digest())
+      return Find(reply.id(), response.request_digest(), serialised_request);
+    serialised_request = response.original_request();
+    return response.has_original_request();
+  }
+  // As above, but parsing the request into |request| straight from where it is held, returning
+  // false if there is none or it doesn't parse.
+  bool Parse(int32_t id, const std::string& digest, google::protobuf::MessageLite& request);
+  template <typename Response>
+  bool Parse(const protobuf::Message& reply, const Response& response,
+             google::protobuf::MessageLite& request) {
+    if (response.has_request_digest())
+      return Parse(reply.id(), response.request_digest(), request);
+    return response.has_original_request() && request.ParseFromString(response.original_request());
+  }
+  size_t size() const;
+
+ private:
+  PendingRequests(const PendingRequests&);
+  PendingRequests(const PendingRequests&&);
+  PendingRequests& operator=(const PendingRequests&);
+
+  typedef std::pair<int32_t, std::string> Key;  // message ID and digest
+  struct Request {
+    Request(std::string serialised_in, std::chrono::steady_clock::time_point expiry_in)
+        : serialised(std::move(serialised_in)), expiry(expiry_in) {}
+    std::string serialised;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  void Prune(const std::chrono::steady_clock::time_point& now);
+
+  const std::chrono::steady_clock::duration kTimeout_;
+  mutable std::mutex mutex_;
+  std::map<Key, Request> requests_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PENDING_REQUESTS_H_
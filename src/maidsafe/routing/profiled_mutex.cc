@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/profiled_mutex.h"
+
+#include <cstring>
+#include <deque>
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+struct NamedProfile {
+  explicit NamedProfile(const char* name_in) : name(name_in), profile() {}
+  const char* name;
+  LockProfile profile;
+};
+
+// A deque, so that growing it leaves existing profiles where they are.
+std::mutex& RegisterMutex() {
+  static std::mutex register_mutex;
+  return register_mutex;
+}
+
+std::deque<NamedProfile>& Register() {
+  static std::deque<NamedProfile> profiles;
+  return profiles;
+}
+
+}  // unnamed namespace
+
+LockProfile& LockProfiler::Profile(const char* name) {
+  std::lock_guard<std::mutex> lock(RegisterMutex());
+  for (auto& named_profile : Register()) {
+    if (std::strcmp(named_profile.name, name) == 0)
+      return named_profile.profile;
+  }
+  Register().emplace_back(name);
+  return Register().back().profile;
+}
+
+std::vector<LockStatistics> LockProfiler::Snapshot() {
+  std::vector<LockStatistics> statistics;
+  std::lock_guard<std::mutex> lock(RegisterMutex());
+  for (const auto& named_profile : Register()) {
+    const LockProfile& profile(named_profile.profile);
+    LockStatistics lock_statistics;
+    lock_statistics.name = named_profile.name;
+    lock_statistics.acquisitions = profile.acquisitions.load(std::memory_order_relaxed);
+    lock_statistics.contended_acquisitions =
+        profile.contended_acquisitions.load(std::memory_order_relaxed);
+    lock_statistics.wait_time =
+        std::chrono::nanoseconds(profile.wait_nanoseconds.load(std::memory_order_relaxed));
+    lock_statistics.hold_time =
+        std::chrono::nanoseconds(profile.hold_nanoseconds.load(std::memory_order_relaxed));
+    statistics.push_back(std::move(lock_statistics));
+  }
+  return statistics;
+}
+
+ProfiledMutex::ProfiledMutex(const char* name)
+    : mutex_(), profile_(LockProfiler::Profile(name)), acquired_at_() {}
+
+}  // namespace routing
+
+}  // namespace maidsafe
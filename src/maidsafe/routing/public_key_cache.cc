@@ -0,0 +1,81 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/public_key_cache.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+PublicKeyCache::PublicKeyCache() : mutex_(), entries_(), uses_() {}
+
+bool PublicKeyCache::Get(const NodeId& node_id, asymm::PublicKey& public_key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(entries_.find(node_id));
+  if (found == entries_.end())
+    return false;
+  if (found->second.expiry <= RoutingClock::now()) {
+    uses_.erase(found->second.use);
+    entries_.erase(found);
+    return false;
+  }
+  uses_.splice(uses_.begin(), uses_, found->second.use);
+  public_key = found->second.public_key;
+  return true;
+}
+
+void PublicKeyCache::Add(const NodeId& node_id, const asymm::PublicKey& public_key) {
+  if (Parameters::public_key_cache_size == 0 || !asymm::ValidateKey(public_key))
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(entries_.find(node_id));
+  if (found == entries_.end()) {
+    while (entries_.size() >= Parameters::public_key_cache_size) {
+      entries_.erase(uses_.back());
+      uses_.pop_back();
+    }
+    uses_.push_front(node_id);
+    found = entries_.insert(std::make_pair(node_id, Entry())).first;
+    found->second.use = uses_.begin();
+  } else {
+    uses_.splice(uses_.begin(), uses_, found->second.use);
+  }
+  found->second.public_key = public_key;
+  found->second.expiry = RoutingClock::now() + Parameters::public_key_cache_ttl;
+}
+
+void PublicKeyCache::Remove(const NodeId& node_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(entries_.find(node_id));
+  if (found == entries_.end())
+    return;
+  uses_.erase(found->second.use);
+  entries_.erase(found);
+}
+
+size_t PublicKeyCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
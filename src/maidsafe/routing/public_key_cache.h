@@ -0,0 +1,69 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PUBLIC_KEY_CACHE_H_
+#define MAIDSAFE_ROUTING_PUBLIC_KEY_CACHE_H_
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Public keys the upper layer has given for peers, so that reconnecting to a peer during churn
+// needn't ask for its key again.  Entries expire after Parameters::public_key_cache_ttl, and
+// beyond Parameters::public_key_cache_size the least recently used are dropped.
+class PublicKeyCache {
+ public:
+  PublicKeyCache();
+  // Returns false if no fresh key for |node_id| is held.
+  bool Get(const NodeId& node_id, asymm::PublicKey& public_key);
+  // Invalid keys aren't held.
+  void Add(const NodeId& node_id, const asymm::PublicKey& public_key);
+  void Remove(const NodeId& node_id);
+  size_t size() const;
+
+ private:
+  PublicKeyCache(const PublicKeyCache&);
+  PublicKeyCache& operator=(const PublicKeyCache&);
+
+  struct Entry {
+    Entry() : public_key(), expiry(), use() {}
+    asymm::PublicKey public_key;
+    std::chrono::steady_clock::time_point expiry;
+    std::list<NodeId>::iterator use;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<NodeId, Entry, NodeIdHash> entries_;
+  std::list<NodeId> uses_;  // most recently used first
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PUBLIC_KEY_CACHE_H_
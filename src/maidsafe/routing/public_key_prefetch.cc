@@ -0,0 +1,154 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/public_key_prefetch.h"
+
+#include <algorithm>
+
+namespace maidsafe {
+
+namespace routing {
+
+PublicKeyPrefetch::PublicKeyPrefetch(size_t capacity,
+                                     std::chrono::steady_clock::duration timeout)
+    : state_(std::make_shared<State>(capacity, timeout)) {}
+
+void PublicKeyPrefetch::set_request_public_key_functor(
+    RequestPublicKeyFunctor request_public_key) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->request_public_key = request_public_key;
+}
+
+void PublicKeyPrefetch::Prefetch(const NodeId& node_id) {
+  RequestPublicKeyFunctor request;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    Trim(*state_);
+    if (!state_->request_public_key || state_->entries.count(node_id) != 0)
+      return;
+    state_->entries[node_id];
+    Insert(*state_, node_id);
+    request = state_->request_public_key;
+  }
+  Request(state_, request, node_id);
+}
+
+bool PublicKeyPrefetch::Holds(const NodeId& node_id) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  Trim(*state_);
+  return state_->entries.count(node_id) != 0;
+}
+
+void PublicKeyPrefetch::Take(const NodeId& node_id, GivePublicKeyFunctor give_key) {
+  RequestPublicKeyFunctor request;
+  asymm::PublicKey public_key;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (!state_->request_public_key)
+      return;
+    Trim(*state_);
+    auto itr(state_->entries.find(node_id));
+    if (itr == state_->entries.end()) {
+      state_->entries[node_id].waiters.push_back(give_key);
+      Insert(*state_, node_id);
+      request = state_->request_public_key;
+    } else if (!itr->second.arrived) {
+      itr->second.waiters.push_back(give_key);
+      return;
+    } else {
+      public_key = itr->second.public_key;
+      state_->entries.erase(itr);
+    }
+  }
+  if (request)
+    Request(state_, request, node_id);
+  else
+    give_key(public_key);
+}
+
+void PublicKeyPrefetch::Insert(State& state, const NodeId& node_id) {
+  Entry& entry(state.entries[node_id]);
+  entry.requested = std::chrono::steady_clock::now();
+  state.order.push_back(std::make_pair(node_id, entry.requested));
+  Trim(state);
+}
+
+void PublicKeyPrefetch::Trim(State& state) {
+  const auto kNow(std::chrono::steady_clock::now());
+  for (auto itr(state.entries.begin()); itr != state.entries.end();) {
+    if (!itr->second.arrived && kNow - itr->second.requested >= state.timeout)
+      itr = state.entries.erase(itr);
+    else
+      ++itr;
+  }
+  auto is_live([&state](const State::Place& place) {
+    auto itr(state.entries.find(place.first));
+    return itr != state.entries.end() && itr->second.requested == place.second;
+  });
+  // Keys someone is waiting for are kept beyond capacity until they are given or time out.
+  auto unwaited(std::count_if(state.entries.begin(), state.entries.end(),
+                              [](const std::pair<const NodeId, Entry>& entry) {
+                                return entry.second.waiters.empty();
+                              }));
+  while (!state.order.empty() && static_cast<size_t>(unwaited) > state.capacity) {
+    if (is_live(state.order.front())) {
+      auto itr(state.entries.find(state.order.front().first));
+      if (itr->second.waiters.empty()) {
+        state.entries.erase(itr);
+        --unwaited;
+      }
+    }
+    state.order.pop_front();
+  }
+  // Entries taken or forgotten out of order leave stale places behind.
+  if (state.order.size() > 2 * state.entries.size() + 16) {
+    state.order.erase(std::remove_if(state.order.begin(), state.order.end(),
+                                     [&](const State::Place& place) { return !is_live(place); }),
+                      state.order.end());
+  }
+}
+
+void PublicKeyPrefetch::Request(const std::shared_ptr<State>& state,
+                                RequestPublicKeyFunctor request, const NodeId& node_id) {
+  std::weak_ptr<State> weak_state(state);
+  request(node_id, [weak_state, node_id](asymm::PublicKey public_key) {
+    std::shared_ptr<State> state(weak_state.lock());
+    if (!state)
+      return;
+    std::vector<GivePublicKeyFunctor> waiters;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      auto itr(state->entries.find(node_id));
+      if (itr == state->entries.end())
+        return;
+      if (itr->second.waiters.empty()) {
+        itr->second.arrived = true;
+        itr->second.public_key = public_key;
+        return;
+      }
+      waiters.swap(itr->second.waiters);
+      state->entries.erase(itr);
+    }
+    for (const auto& give_key : waiters)
+      give_key(public_key);
+  });
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
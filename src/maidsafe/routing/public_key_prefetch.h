@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_PUBLIC_KEY_PREFETCH_H_
+#define MAIDSAFE_ROUTING_PUBLIC_KEY_PREFETCH_H_
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Public keys of peers being connected to, asked for as soon as a connection is agreed so that
+// fetching them overlaps with rudp connecting rather than following it.  Each key is handed out
+// once; keys prefetched but never taken are forgotten, oldest first, beyond |capacity|.  A key not
+// given within |timeout| of being asked for is forgotten, along with anyone waiting for it.
+class PublicKeyPrefetch {
+ public:
+  PublicKeyPrefetch(size_t capacity, std::chrono::steady_clock::duration timeout);
+  void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key);
+  // Asks for |node_id|'s key, unless already asked for.
+  void Prefetch(const NodeId& node_id);
+  // Whether |node_id|'s key has been asked for and not yet taken or forgotten.
+  bool Holds(const NodeId& node_id);
+  // Gives |node_id|'s key to |give_key| once it has arrived, asking for it if it wasn't
+  // prefetched.  |give_key| is never called if no request functor is set.
+  void Take(const NodeId& node_id, GivePublicKeyFunctor give_key);
+
+ private:
+  struct Entry {
+    Entry() : arrived(false), requested(), public_key(), waiters() {}
+    bool arrived;
+    std::chrono::steady_clock::time_point requested;
+    asymm::PublicKey public_key;
+    std::vector<GivePublicKeyFunctor> waiters;
+  };
+  // Shared with the request callbacks, which may outlive this object.
+  struct State {
+    // An entry's node ID and requested time, which tells it from a later entry for the same node.
+    typedef std::pair<NodeId, std::chrono::steady_clock::time_point> Place;
+    State(size_t capacity_in, std::chrono::steady_clock::duration timeout_in)
+        : mutex(),
+          request_public_key(),
+          entries(),
+          order(),
+          capacity(capacity_in),
+          timeout(timeout_in) {}
+    std::mutex mutex;
+    RequestPublicKeyFunctor request_public_key;
+    std::map<NodeId, Entry> entries;
+    std::deque<Place> order;  // of insertion into entries
+    const size_t capacity;
+    const std::chrono::steady_clock::duration timeout;
+  };
+
+  PublicKeyPrefetch(const PublicKeyPrefetch&);
+  PublicKeyPrefetch& operator=(const PublicKeyPrefetch&);
+
+  // Must be called with state->mutex held, having just added an entry for |node_id|.
+  static void Insert(State& state, const NodeId& node_id);
+  // Forgets entries whose keys haven't arrived in time, and the oldest beyond capacity.  Must be
+  // called with state->mutex held.
+  static void Trim(State& state);
+  static void Request(const std::shared_ptr<State>& state, RequestPublicKeyFunctor request,
+                      const NodeId& node_id);
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_PUBLIC_KEY_PREFETCH_H_
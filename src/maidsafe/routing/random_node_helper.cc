@@ -18,37 +18,127 @@
 
 #include "maidsafe/routing/random_node_helper.h"
 
+#include <algorithm>
+#include <cassert>
+
 #include "maidsafe/common/utils.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+const uint64_t RandomNodeHelper::kRecencyFactor;
+
+namespace {
+
+std::atomic<uint64_t> next_instance_id(1);
+
+}  // unnamed namespace
+
+RandomNodeHelper::RandomNodeHelper(size_t capacity)
+    : kCapacity_(capacity),
+      kInstanceId_(next_instance_id++),
+      sample_(std::make_shared<Sample>()),
+      version_(0),
+      mutex_(),
+      seen_(0) {
+  assert(kCapacity_ != 0);
+}
+
 NodeId RandomNodeHelper::Get() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  assert(node_ids_.size() <= kMaxSize_);
-  if (node_ids_.empty())
+  std::shared_ptr<const Sample> sample(GetSample());
+  if (sample->node_ids.empty())
     return NodeId();
-  return node_ids_[(node_ids_.size() == kMaxSize_) ? 0 : (RandomUint32() % node_ids_.size())];
+  return sample->node_ids[RandomUint32() % sample->node_ids.size()];
 }
 
 void RandomNodeHelper::Add(const NodeId& node_id) {
   assert(!node_id.IsZero());
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (std::find(node_ids_.begin(), node_ids_.end(), node_id) != node_ids_.end())
+  if (Settled(*GetSample(), node_id))
     return;
 
-  node_ids_.push_back(node_id);
-  if (node_ids_.size() > kMaxSize_)
-    node_ids_.erase(node_ids_.begin());
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<const Sample> current(std::atomic_load(&sample_));
+  if (Settled(*current, node_id))
+    return;
+  auto next(std::make_shared<Sample>(*current));
+  if (next->tried.insert(node_id).second) {
+    next->tried_order.push_back(node_id);
+    if (next->tried_order.size() > kRecencyFactor * kCapacity_) {
+      next->tried.erase(next->tried_order.front());
+      next->tried_order.pop_front();
+    }
+    seen_ = std::min(seen_ + 1, kRecencyFactor * kCapacity_);
+  }
+  if (next->node_ids.size() < kCapacity_) {
+    next->index[node_id] = next->node_ids.size();
+    next->node_ids.push_back(node_id);
+  } else {
+    // Reservoir sampling: keep the newcomer with probability capacity / seen, in place of a
+    // uniformly chosen member.
+    uint64_t slot(((static_cast<uint64_t>(RandomUint32()) << 32) | RandomUint32()) % seen_);
+    if (slot < kCapacity_) {
+      next->index.erase(next->node_ids[slot]);
+      next->node_ids[slot] = node_id;
+      next->index[node_id] = slot;
+    }
+  }
+  Publish(next);
 }
 
 void RandomNodeHelper::Remove(const NodeId& node_id) {
   assert(!node_id.IsZero());
   std::lock_guard<std::mutex> lock(mutex_);
-  auto itr(std::find(node_ids_.begin(), node_ids_.end(), node_id));
-  if (itr != node_ids_.end())
-    node_ids_.erase(itr);
+  std::shared_ptr<const Sample> current(std::atomic_load(&sample_));
+  auto itr(current->index.find(node_id));
+  if (itr == current->index.end())
+    return;
+  auto next(std::make_shared<Sample>(*current));
+  SwapRemove(*next, itr->second);
+  Publish(next);
+}
+
+size_t RandomNodeHelper::size() const { return GetSample()->node_ids.size(); }
+
+std::shared_ptr<const RandomNodeHelper::Sample> RandomNodeHelper::GetSample() const {
+  // std::atomic_load of a shared_ptr takes a lock in libstdc++, so is only used once a change has
+  // been published since this thread last read the sample.
+  struct Cached {
+    uint64_t instance_id, version;
+    std::shared_ptr<const Sample> sample;
+  };
+  static thread_local Cached cached = {0, 0, std::shared_ptr<const Sample>()};
+  const uint64_t kVersion(version_.load(std::memory_order_acquire));
+  if (cached.instance_id != kInstanceId_ || cached.version != kVersion || !cached.sample) {
+    // Published no earlier than kVersion, so at worst read again next time.
+    cached.sample = std::atomic_load(&sample_);
+    cached.instance_id = kInstanceId_;
+    cached.version = kVersion;
+  }
+  return cached.sample;
+}
+
+void RandomNodeHelper::Publish(std::shared_ptr<const Sample> sample) {
+  std::atomic_store(&sample_, sample);
+  version_.fetch_add(1, std::memory_order_release);
+}
+
+bool RandomNodeHelper::Settled(const Sample& sample, const NodeId& node_id) const {
+  return Contains(sample, node_id) ||
+         (sample.node_ids.size() >= kCapacity_ && sample.tried.count(node_id) != 0);
+}
+
+bool RandomNodeHelper::Contains(const Sample& sample, const NodeId& node_id) {
+  return sample.index.find(node_id) != sample.index.end();
+}
+
+void RandomNodeHelper::SwapRemove(Sample& sample, size_t position) {
+  sample.index.erase(sample.node_ids[position]);
+  if (position + 1 != sample.node_ids.size()) {
+    sample.node_ids[position] = sample.node_ids.back();
+    sample.index[sample.node_ids[position]] = position;
+  }
+  sample.node_ids.pop_back();
 }
 
 }  // namespace routing
@@ -19,30 +19,72 @@
 #ifndef MAIDSAFE_ROUTING_RANDOM_NODE_HELPER_H_
 #define MAIDSAFE_ROUTING_RANDOM_NODE_HELPER_H_
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "maidsafe/common/node_id.h"
 
+#include "maidsafe/routing/node_id_hash.h"
+
 namespace maidsafe {
 
 namespace routing {
 
+// A bounded, uniformly random sample of the nodes messages have been received from.  Once full, a
+// newly seen node replaces a random member with the reservoir probability capacity / seen, where
+// seen (the count of distinct nodes added) is capped at kRecencyFactor * capacity so that a long
+// running node keeps taking in new peers rather than settling on its earliest ones.  A node has
+// one such trial however often it is added, until kRecencyFactor * capacity others have been seen
+// since.
+//
+// Get, and the Add of a node already sampled or tried, which is nearly every call from the receive
+// path, only read the published sample.  Each thread keeps the sample it last read, so that unless
+// a change has been published since, reading it takes no lock.  Other changes are made to a copy
+// of the sample under a mutex and then published.
 class RandomNodeHelper {
  public:
-  RandomNodeHelper() : node_ids_(), mutex_(), kMaxSize_(100) {}
+  explicit RandomNodeHelper(size_t capacity = 100);
+  // Returns a zero ID if the sample is empty.
   NodeId Get() const;
   void Add(const NodeId& node_id);
   void Remove(const NodeId& node_id);
+  size_t size() const;
 
  private:
+  struct Sample {
+    Sample() : node_ids(), index(), tried(), tried_order() {}
+    std::vector<NodeId> node_ids;
+    std::unordered_map<NodeId, size_t, NodeIdHash> index;  // position of each in node_ids
+    // The last kRecencyFactor * capacity distinct nodes added, oldest first in tried_order
+    std::unordered_set<NodeId, NodeIdHash> tried;
+    std::deque<NodeId> tried_order;
+  };
+
   RandomNodeHelper(const RandomNodeHelper&);
   RandomNodeHelper(const RandomNodeHelper&&);
   RandomNodeHelper& operator=(const RandomNodeHelper&);
 
-  std::vector<NodeId> node_ids_;
-  mutable std::mutex mutex_;
-  const size_t kMaxSize_;
+  std::shared_ptr<const Sample> GetSample() const;
+  static bool Contains(const Sample& sample, const NodeId& node_id);
+  // Whether |node_id| is sampled, or has had its trial while the sample was full.
+  bool Settled(const Sample& sample, const NodeId& node_id) const;
+  void Publish(std::shared_ptr<const Sample> sample);
+  // Removes the entry at |position|, moving the last into its place.
+  static void SwapRemove(Sample& sample, size_t position);
+
+  static const uint64_t kRecencyFactor = 4;
+  const size_t kCapacity_;
+  const uint64_t kInstanceId_;  // unique to this helper, identifying its samples in thread caches
+  std::shared_ptr<const Sample> sample_;  // only accessed via std::atomic_load/_store
+  std::atomic<uint64_t> version_;  // incremented after each change to sample_ is published
+  std::mutex mutex_;  // serialises changes to sample_
+  uint64_t seen_;
 };
 
 }  // namespace routing
@@ -22,6 +22,8 @@
 #include <vector>
 
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/pending_requests.h"
+#include "maidsafe/routing/routing_clock.h"
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/network_utils.h"
@@ -33,7 +35,7 @@ namespace maidsafe {
 namespace routing {
 
 RemoveFurthestNode::RemoveFurthestNode(RoutingTable& routing_table, NetworkUtils& network)
-    : routing_table_(routing_table), network_(network) {}
+    : routing_table_(routing_table), network_(network), mutex_(), pending_() {}
 
 void RemoveFurthestNode::RemoveRequest(protobuf::Message& message) {
   LOG(kVerbose) << "[" << HexSubstr(routing_table_.kNodeId().string())
@@ -61,6 +63,8 @@ void RemoveFurthestNode::HandleRemoveRequest(const NodeId& node_id) {
   LOG(kVerbose) << "[" << HexSubstr(routing_table_.kNodeId().string()) << "] drops "
                 << HexSubstr(node_id.string());
   routing_table_.DropNode(node_id, false);
+  // The peer has evicted this node, so would only be evicted in turn were it to reconnect.
+  routing_table_.RecordEviction(node_id);
 }
 
 bool RemoveFurthestNode::IsRemovable(const NodeId& node_id) {
@@ -70,9 +74,9 @@ bool RemoveFurthestNode::IsRemovable(const NodeId& node_id) {
 
 void RemoveFurthestNode::RejectRemoval(protobuf::Message& message) {
   protobuf::RemoveResponse remove_response;
-  remove_response.set_original_request(message.data(0));
+  SetOriginalRequest(message, remove_response);
   message.clear_data();
-  message.clear_route_history();
+  message.clear_route_history_tags();
   message.set_request(false);
   remove_response.set_success(false);
   remove_response.set_peer_id(routing_table_.kNodeId().string());
@@ -80,7 +84,7 @@ void RemoveFurthestNode::RejectRemoval(protobuf::Message& message) {
   message.set_destination_id(message.source_id());
   message.set_source_id(routing_table_.kNodeId().string());
   assert(remove_response.IsInitialized() && "Remove Response is not initialised");
-  message.add_data(remove_response.SerializeAsString());
+  remove_response.SerializeToString(message.add_data());
   assert(message.IsInitialized() && "Message is not initialised");
 }
 
@@ -94,15 +98,30 @@ void RemoveFurthestNode::RemoveResponse(protobuf::Message& message) {
   if (!remove_response.success()) {
     LOG(kInfo) << "Request to remove " << HexSubstr(message.source_id())
                << " failed, another node will be tried";
-    if (!remove_request.ParseFromString(remove_response.original_request())) {
+    if (!network_.pending_requests().Parse(message, remove_response, remove_request)) {
       LOG(kError) << "Could not parse remove node request";
       return;
     }
     NodeInfo next_node;
     std::vector<std::string> attempted_nodes(remove_request.attempted_nodes().begin(),
                                              remove_request.attempted_nodes().end());
-    next_node = routing_table_.GetRemovableNode(attempted_nodes);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.erase(NodeId(message.source_id()));
+      // Nodes already asked by another request of the batch aren't asked twice.
+      auto pending_ids(PendingIds());
+      pending_ids.insert(pending_ids.end(), attempted_nodes.begin(), attempted_nodes.end());
+      pending_ids.push_back(remove_response.peer_id());
+      next_node = routing_table_.GetRemovableNode(pending_ids);
+      if (next_node.node_id != NodeInfo().node_id &&
+          std::find(pending_ids.begin(), pending_ids.end(), next_node.node_id.string()) !=
+              pending_ids.end())
+        next_node = NodeInfo();
+      if (next_node.node_id != NodeInfo().node_id)
+        pending_[next_node.node_id] = RoutingClock::now();
+    }
     if (next_node.node_id != NodeInfo().node_id) {
+      routing_table_.RecordEviction(next_node.node_id);
       attempted_nodes.push_back(remove_response.peer_id());
       protobuf::Message remove_request(rpcs::Remove(next_node.node_id, routing_table_.kNodeId(),
                                                     routing_table_.kConnectionId(),
@@ -110,6 +129,7 @@ void RemoveFurthestNode::RemoveResponse(protobuf::Message& message) {
       LOG(kInfo) << "Request to remove " << HexSubstr(remove_request.destination_id())
                  << " is re-prepared, message id:" << message.id();
       remove_request.set_id(message.id());
+      network_.pending_requests().Add(remove_request);
       network_.SendToDirect(remove_request, next_node.node_id, next_node.connection_id);
     } else {
       LOG(kInfo) << "Request to remove " << HexSubstr(message.source_id()) << " succeeded";
@@ -118,15 +138,54 @@ void RemoveFurthestNode::RemoveResponse(protobuf::Message& message) {
 }
 
 void RemoveFurthestNode::RemoveNodeRequest() {
-  NodeInfo furthest_node(routing_table_.GetRemovableNode(std::vector<std::string>()));
-  if (furthest_node.node_id == NodeInfo().node_id)
-    return;
-  protobuf::Message message(rpcs::Remove(furthest_node.node_id, routing_table_.kNodeId(),
-                                         routing_table_.kConnectionId(),
-                                         std::vector<std::string>()));
-  LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] Request to remove "
-             << HexSubstr(message.destination_id()) << " is prepared, message id: " << message.id();
-  network_.SendToDirect(message, furthest_node.node_id, furthest_node.connection_id);
+  std::vector<NodeInfo> removable_nodes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto kNow(RoutingClock::now());
+    ExpirePending(kNow);
+    size_t target(static_cast<size_t>(routing_table_.removal_low_watermark()) + pending_.size());
+    size_t size(routing_table_.size());
+    if (size <= target)
+      return;
+    auto attempted(PendingIds());
+    for (size_t count(size - target); count != 0; --count) {
+      NodeInfo furthest_node(routing_table_.GetRemovableNode(attempted));
+      if (furthest_node.node_id == NodeInfo().node_id ||
+          std::find(attempted.begin(), attempted.end(), furthest_node.node_id.string()) !=
+              attempted.end())
+        break;
+      attempted.push_back(furthest_node.node_id.string());
+      pending_[furthest_node.node_id] = kNow;
+      removable_nodes.push_back(furthest_node);
+    }
+  }
+  for (const auto& furthest_node : removable_nodes) {
+    routing_table_.RecordEviction(furthest_node.node_id);
+    protobuf::Message message(rpcs::Remove(furthest_node.node_id, routing_table_.kNodeId(),
+                                           routing_table_.kConnectionId(),
+                                           std::vector<std::string>()));
+    LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] Request to remove "
+               << HexSubstr(message.destination_id())
+               << " is prepared, message id: " << message.id();
+    network_.pending_requests().Add(message);
+    network_.SendToDirect(message, furthest_node.node_id, furthest_node.connection_id);
+  }
+}
+
+void RemoveFurthestNode::ExpirePending(std::chrono::steady_clock::time_point now) {
+  for (auto itr(pending_.begin()); itr != pending_.end();) {
+    if (now - itr->second >= Parameters::default_response_timeout)
+      itr = pending_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+std::vector<std::string> RemoveFurthestNode::PendingIds() const {
+  std::vector<std::string> pending_ids;
+  for (const auto& pending : pending_)
+    pending_ids.push_back(pending.first.string());
+  return pending_ids;
 }
 
 }  // namespace routing
@@ -20,10 +20,15 @@
 #define MAIDSAFE_ROUTING_REMOVE_FURTHEST_NODE_H_
 
 #include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
 
-namespace maidsafe {
+#include "maidsafe/common/node_id.h"
 
-class NodeId;
+namespace maidsafe {
 
 namespace routing {
 
@@ -41,6 +46,8 @@ class RemoveFurthestNode {
   void RemoveRequest(protobuf::Message& message);
   void RejectRemoval(protobuf::Message& message);
   void RemoveResponse(protobuf::Message& message);
+  // Asks enough of the furthest removable nodes to drop this node to bring the routing table down
+  // to Parameters::removal_low_watermark, counting those already asked.
   void RemoveNodeRequest();
 
  private:
@@ -49,9 +56,17 @@ class RemoveFurthestNode {
   RemoveFurthestNode& operator=(const RemoveFurthestNode&);
   bool IsRemovable(const NodeId& node_id);
   void HandleRemoveRequest(const NodeId& node_id);
+  // Must be called with mutex_ held.  Forgets requests unanswered for longer than the default
+  // response timeout, which have either been accepted or lost.
+  void ExpirePending(std::chrono::steady_clock::time_point now);
+  // Must be called with mutex_ held.
+  std::vector<std::string> PendingIds() const;
 
   RoutingTable& routing_table_;
   NetworkUtils& network_;
+  std::mutex mutex_;
+  // Nodes asked to drop this node, to the times they were asked
+  std::map<NodeId, std::chrono::steady_clock::time_point> pending_;
 };
 
 }  // namespace routing
@@ -18,6 +18,7 @@
 
 #include "maidsafe/routing/response_handler.h"
 
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <string>
@@ -30,9 +31,12 @@
 
 #include "maidsafe/routing/client_routing_table.h"
 #include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/network_coordinates.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/utils.h"
@@ -51,6 +55,32 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
   const int kMaxUnvalidatedUpdates(64);
 #endif
 
+// A response which came straight back from its sender times the round trip to that peer, and
+// carries the sender's network coordinate if it has one.  The timestamp is this node's own, set
+// when the request was composed.
+void RecordRoundTrip(RoutingTable& routing_table, const protobuf::Message& message,
+                     uint64_t request_timestamp,
+                     const std::vector<int32_t>& coordinates = std::vector<int32_t>()) {
+  if (!message.has_source_id() || message.hops_to_live() != Parameters::hops_to_live - 1)
+    return;
+  uint64_t now(GetTimeStamp());
+  std::chrono::milliseconds round_trip(-1);
+  if (request_timestamp != 0 && now >= request_timestamp)
+    round_trip = std::chrono::milliseconds(
+        static_cast<std::chrono::milliseconds::rep>(now - request_timestamp));
+  else if (coordinates.empty())
+    return;
+  routing_table.RecordRoundTrip(NodeId(message.source_id()), round_trip, coordinates);
+}
+
+// Loads are advertised from 0 to 255, but carried as uint32.
+uint8_t AdvertisedLoad(uint32_t load) { return static_cast<uint8_t>(std::min(load, 255U)); }
+
+void RecordLoad(NetworkUtils& network, const Endpoint& endpoint, uint32_t load) {
+  if (!endpoint.address().is_unspecified())
+    network.RecordLoad(endpoint, AdvertisedLoad(load));
+}
+
 }  // unnamed namespace
 
 ResponseHandler::ResponseHandler(RoutingTable& routing_table,
@@ -58,7 +88,11 @@ ResponseHandler::ResponseHandler(RoutingTable& routing_table,
                                  GroupChangeHandler& group_change_handler)
     : mutex_(), routing_table_(routing_table), client_routing_table_(client_routing_table),
       network_(network), group_change_handler_(group_change_handler), request_public_key_functor_(),
-      unvalidated_matrix_updates_() {}
+      public_key_prefetch_(std::make_shared<PublicKeyPrefetch>(
+          routing_table.kMaxSize(), Parameters::default_response_timeout)),
+      standby_key_prefetch_(std::make_shared<PublicKeyPrefetch>(
+          Parameters::standby_cache_size, Parameters::default_response_timeout)),
+      find_nodes_response_functor_(), unvalidated_matrix_updates_() {}
 
 ResponseHandler::~ResponseHandler() {}
 
@@ -67,8 +101,17 @@ void ResponseHandler::Ping(protobuf::Message& message) {
 
   // TODO(dirvine): do we need this and where and how can I update the response
   protobuf::PingResponse ping_response;
-  if (ping_response.ParseFromString(message.data(0))) {
-    // do stuff here
+  protobuf::PingRequest ping_request;
+  if (ping_response.ParseFromString(message.data(0)) &&
+      network_.pending_requests().Parse(message, ping_response, ping_request)) {
+    RecordRoundTrip(routing_table_, message, ping_request.timestamp(),
+                    CoordinatesFrom(ping_response.coordinates()));
+    if (Parameters::lookahead_routing && ping_response.table_summary_size() != 0 &&
+        message.source_id().size() == NodeId::kSize) {
+      routing_table_.RecordTableSummary(NodeId(message.source_id()),
+                                        std::vector<uint64_t>(ping_response.table_summary().begin(),
+                                                              ping_response.table_summary().end()));
+    }
   }
 }
 
@@ -80,12 +123,18 @@ void ResponseHandler::Connect(protobuf::Message& message) {
     return;
   }
 
-  if (!connect_request.ParseFromString(connect_response.original_request())) {
+  if (!network_.pending_requests().Parse(message, connect_response, connect_request)) {
     LOG(kError) << "Could not parse original connect request"
                 << " id: " << message.id();
     return;
   }
 
+  RecordRoundTrip(routing_table_, message, connect_request.timestamp(),
+                  CoordinatesFrom(connect_response.contact().coordinates()));
+  const bool kShortcut(connect_request.shortcut());
+  if (kShortcut && connect_response.answer() != protobuf::ConnectResponseType::kAccepted)
+    network_.shortcuts().Abandon(NodeId(connect_request.peer_id()));
+
   if (connect_response.answer() == protobuf::ConnectResponseType::kRejected) {
     LOG(kInfo) << "Peer rejected this node's connection request."
                << " id: " << message.id();
@@ -100,12 +149,23 @@ void ResponseHandler::Connect(protobuf::Message& message) {
 
   if (NodeId(connect_response.contact().node_id()).IsZero()) {
     LOG(kError) << "Invalid contact details";
+    if (kShortcut)
+      network_.shortcuts().Abandon(NodeId(connect_request.peer_id()));
     return;
   }
+  if (connect_response.has_load() && connect_response.contact().has_public_endpoint()) {
+    RecordLoad(network_, GetEndpointFromProtobuf(connect_response.contact().public_endpoint()),
+               connect_response.load());
+  }
 
   NodeInfo node_to_add;
   node_to_add.node_id = NodeId(connect_response.contact().node_id());
-  if (routing_table_.CheckNode(node_to_add) ||
+  if (kShortcut && node_to_add.node_id != NodeId(connect_request.peer_id())) {
+    LOG(kError) << "Shortcut accepted by a node other than the one asked";
+    network_.shortcuts().Abandon(NodeId(connect_request.peer_id()));
+    return;
+  }
+  if (kShortcut || routing_table_.CheckNode(node_to_add) ||
       (node_to_add.node_id == network_.bootstrap_connection_id())) {
     rudp::EndpointPair peer_endpoint_pair;
     peer_endpoint_pair.external =
@@ -116,6 +176,8 @@ void ResponseHandler::Connect(protobuf::Message& message) {
     if (peer_endpoint_pair.external.address().is_unspecified() &&
         peer_endpoint_pair.local.address().is_unspecified()) {
       LOG(kError) << "Invalid peer endpoint details";
+      if (kShortcut)
+        network_.shortcuts().Abandon(node_to_add.node_id);
       return;
     }
 
@@ -126,10 +188,19 @@ void ResponseHandler::Connect(protobuf::Message& message) {
                   << "] received connect response from " << DebugId(peer_node_id)
                   << " id: " << message.id();
 
+    bool streamlined(!kShortcut &&
+                     OffersStreamlinedHandshake(network_, peer_node_id, peer_connection_id));
+    if ((streamlined || kShortcut) && !message.client_node())
+      public_key_prefetch_->Prefetch(peer_node_id);
     int result = AddToRudp(network_, routing_table_.kNodeId(), routing_table_.kConnectionId(),
                            peer_node_id, peer_connection_id, peer_endpoint_pair, true,  // requestor
-                           routing_table_.client_mode());
+                           routing_table_.client_mode(), streamlined, std::vector<NodeId>(),
+                           kShortcut);
+    if (result != kSuccess && kShortcut)
+      network_.shortcuts().Abandon(peer_node_id);
     if (result == kSuccess) {
+      network_.SetDecodableCompression(peer_connection_id,
+                                       connect_response.contact().decodable_compression());
       // Special case with bootstrapping peer in which kSuccess comes before connect response
       if (peer_node_id == network_.bootstrap_connection_id()) {
         LOG(kInfo) << "Special case with bootstrapping peer : " << DebugId(peer_node_id);
@@ -153,11 +224,32 @@ void ResponseHandler::FindNodes(const protobuf::Message& message) {
     LOG(kError) << "Could not parse find node response";
     return;
   }
-  if (!find_nodes_request.ParseFromString(find_nodes_response.original_request())) {
+  if (!network_.pending_requests().Parse(message, find_nodes_response, find_nodes_request)) {
     LOG(kError) << "Could not parse original find node request";
     return;
   }
 
+  RecordRoundTrip(routing_table_, message, find_nodes_request.timestamp());
+  if (message.has_request_hops() && message.has_source_id())
+    routing_table_.RecordRouteHops(NodeId(message.source_id()), message.request_hops());
+
+  // An overloaded bootstrap node turns a joiner away to its peers rather than relaying for it.
+  if (find_nodes_response.redirect_endpoints_size() != 0) {
+    if (routing_table_.size() != 0)
+      return;
+    BootstrapContacts contacts;
+    for (const auto& endpoint : find_nodes_response.redirect_endpoints())
+      contacts.push_back(GetEndpointFromProtobuf(endpoint));
+    network_.Redirect(contacts, AdvertisedLoad(find_nodes_response.load()));
+    return;
+  }
+  NodeInfo responder;
+  if (find_nodes_response.has_load() && message.has_source_id() &&
+      routing_table_.GetNodeInfo(NodeId(message.source_id()), responder)) {
+    RecordLoad(network_, network_.PeerEndpoint(responder.connection_id),
+               find_nodes_response.load());
+  }
+
   if (find_nodes_request.num_nodes_requested() == 1) {  // detect collision
     if ((find_nodes_response.nodes_size() == 1) &&
         find_nodes_response.nodes(0) == routing_table_.kNodeId().string()) {
@@ -183,10 +275,16 @@ void ResponseHandler::FindNodes(const protobuf::Message& message) {
 
   LOG(kVerbose) << find_node_result;
 
+  std::vector<NodeId> nodes;
+  nodes.reserve(find_nodes_response.nodes_size());
   for (int i = 0; i < find_nodes_response.nodes_size(); ++i) {
-    if (!find_nodes_response.nodes(i).empty())
-      CheckAndSendConnectRequest(NodeId(find_nodes_response.nodes(i)));
+    if (!find_nodes_response.nodes(i).empty()) {
+      nodes.push_back(NodeId(find_nodes_response.nodes(i)));
+      CheckAndSendConnectRequest(nodes.back());
+    }
   }
+  if (find_nodes_response_functor_ && message.has_source_id())
+    find_nodes_response_functor_(NodeId(message.source_id()), nodes);
 }
 
 void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
@@ -236,9 +334,11 @@ void ResponseHandler::SendConnectRequest(const NodeId peer_node_id) {
     }
     protobuf::Message connect_rpc(rpcs::Connect(
         peer.node_id, this_endpoint_pair, routing_table_.kNodeId(), routing_table_.kConnectionId(),
-        routing_table_.client_mode(), this_nat_type, relay_message, relay_connection_id));
+        routing_table_.client_mode(), this_nat_type, relay_message, relay_connection_id, false,
+        routing_table_.network_coordinates().Local()));
     LOG(kVerbose) << "Sending Connect RPC to " << DebugId(peer.node_id)
                   << " message id : " << connect_rpc.id();
+    network_.pending_requests().Add(connect_rpc);
     if (send_to_bootstrap_connection)
       network_.SendToDirect(connect_rpc, network_.bootstrap_connection_id(),
                             network_.bootstrap_connection_id());
@@ -287,13 +387,78 @@ void ResponseHandler::ConnectSuccessAcknowledgement(protobuf::Message& message)
   }
 }
 
+bool ResponseHandler::StreamlinedConnectSuccess(const protobuf::Message& message) {
+  protobuf::ConnectSuccess connect_success;
+  if (message.data_size() != 1 || !connect_success.ParseFromString(message.data(0)) ||
+      !connect_success.streamlined()) {
+    return false;
+  }
+  if (!CheckId(connect_success.node_id()) || !CheckId(connect_success.connection_id()))
+    return false;
+  NodeInfo peer;
+  peer.node_id = NodeId(connect_success.node_id());
+  peer.connection_id = NodeId(connect_success.connection_id());
+  // Both peers decide alike, each having offered the handshake only if it would accept it.
+  if (!OffersStreamlinedHandshake(network_, peer.node_id, peer.connection_id))
+    return false;
+
+  std::vector<NodeId> close_ids;
+  for (const auto& close_id : connect_success.close_ids()) {
+    if (CheckId(close_id))
+      close_ids.push_back(NodeId(close_id));
+  }
+  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] streamlined connect success from "
+                << DebugId(peer.node_id);
+  if (message.client_node())
+    ValidateAndCompleteConnectionToClient(peer, connect_success.requestor(), close_ids, true);
+  else
+    ValidateAndCompleteConnectionToNonClient(peer, connect_success.requestor(), close_ids, true);
+  return true;
+}
+
+bool ResponseHandler::ShortcutConnectSuccess(const protobuf::Message& message) {
+  protobuf::ConnectSuccess connect_success;
+  if (message.data_size() != 1 || !connect_success.ParseFromString(message.data(0)) ||
+      !connect_success.shortcut()) {
+    return false;
+  }
+  if (!CheckId(connect_success.node_id()) || !CheckId(connect_success.connection_id()) ||
+      message.client_node() || routing_table_.client_mode())
+    return true;
+  NodeInfo peer;
+  peer.node_id = NodeId(connect_success.node_id());
+  peer.connection_id = NodeId(connect_success.connection_id());
+  LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] shortcut connect success from "
+                << DebugId(peer.node_id);
+  // Like a routing table peer, the shortcut is only used once the peer's key has been given.
+  std::weak_ptr<ResponseHandler> response_handler_weak_ptr = shared_from_this();
+  TakePublicKey(peer.node_id, [=](const asymm::PublicKey& key) {
+    std::shared_ptr<ResponseHandler> response_handler(response_handler_weak_ptr.lock());
+    if (!response_handler)
+      return;
+    NodeInfo shortcut(peer);
+    shortcut.public_key = key;
+    if (response_handler->network_.MarkConnectionAsValid(peer.connection_id) != kSuccess) {
+      LOG(kError) << "Rudp failed to validate shortcut to " << DebugId(peer.node_id);
+      response_handler->network_.shortcuts().Abandon(peer.node_id);
+    } else if (!response_handler->network_.shortcuts().Add(shortcut,
+                                                           RoutingClock::now())) {
+      LOG(kInfo) << "No room for a shortcut to " << DebugId(peer.node_id);
+      response_handler->network_.Remove(peer.connection_id);
+    }
+  });
+  return true;
+}
+
 void ResponseHandler::ValidateAndCompleteConnectionToClient(const NodeInfo& peer,
                                                             bool from_requestor,
-                                                            const std::vector<NodeId>& close_ids) {
+                                                            const std::vector<NodeId>& close_ids,
+                                                            bool streamlined) {
   if (ValidateAndAddToRoutingTable(network_, routing_table_, client_routing_table_, peer.node_id,
                                    peer.connection_id, asymm::PublicKey(), true)) {
     if (from_requestor) {
-      HandleSuccessAcknowledgementAsReponder(peer, true);
+      if (!streamlined)
+        HandleSuccessAcknowledgementAsReponder(peer, true);
     } else {
       HandleSuccessAcknowledgementAsRequestor(close_ids);
     }
@@ -301,7 +466,8 @@ void ResponseHandler::ValidateAndCompleteConnectionToClient(const NodeInfo& peer
 }
 
 void ResponseHandler::ValidateAndCompleteConnectionToNonClient(
-    const NodeInfo& peer, bool from_requestor, const std::vector<NodeId>& close_ids) {
+    const NodeInfo& peer, bool from_requestor, const std::vector<NodeId>& close_ids,
+    bool streamlined) {
   std::weak_ptr<ResponseHandler> response_handler_weak_ptr = shared_from_this();
   if (request_public_key_functor_) {
     auto validate_node([=](const asymm::PublicKey& key) {
@@ -325,28 +491,20 @@ void ResponseHandler::ValidateAndCompleteConnectionToNonClient(
                                          response_handler->client_routing_table_, peer.node_id,
                                          peer.connection_id, key, false, matrix_update)) {
           if (from_requestor) {
-            response_handler->HandleSuccessAcknowledgementAsReponder(peer, false);
+            if (!streamlined)
+              response_handler->HandleSuccessAcknowledgementAsReponder(peer, false);
           } else {
             response_handler->HandleSuccessAcknowledgementAsRequestor(close_ids);
           }
         }
       }
     });
-    request_public_key_functor_(peer.node_id, validate_node);
+    TakePublicKey(peer.node_id, validate_node);
   }
 }
 
 void ResponseHandler::HandleSuccessAcknowledgementAsReponder(NodeInfo peer, bool client) {
-  auto count =
-      (client ? Parameters::max_routing_table_size_for_client : Parameters::max_routing_table_size);
-  std::vector<NodeId> close_ids_for_peer(routing_table_.GetClosestNodes(peer.node_id, count));
-  auto itr(std::find_if(close_ids_for_peer.begin(), close_ids_for_peer.end(),
-                        [=](const NodeId & node_id)->bool {
-                          return (peer.node_id == node_id);
-                        }));
-  if (itr != close_ids_for_peer.end())
-    close_ids_for_peer.erase(itr);
-
+  std::vector<NodeId> close_ids_for_peer(CloseIdsForPeer(routing_table_, peer.node_id, client));
   protobuf::Message connect_success_ack(rpcs::ConnectSuccessAcknowledgement(
       peer.node_id, routing_table_.kNodeId(), routing_table_.kConnectionId(),
       false,  // this node is responder
@@ -363,9 +521,39 @@ void ResponseHandler::HandleSuccessAcknowledgementAsRequestor(
   }
 }
 
+void ResponseHandler::SendConnectRequests(const std::vector<NodeId>& node_ids) {
+  for (const auto& node_id : node_ids)
+    CheckAndSendConnectRequest(node_id);
+}
+
+void ResponseHandler::SendShortcutRequest(const NodeId& peer_id) {
+  if (routing_table_.size() == 0 || routing_table_.Contains(peer_id) ||
+      peer_id == routing_table_.kNodeId()) {
+    network_.shortcuts().Abandon(peer_id);
+    return;
+  }
+  rudp::EndpointPair this_endpoint_pair, peer_endpoint_pair;
+  rudp::NatType this_nat_type(rudp::NatType::kUnknown);
+  int ret_val = network_.GetAvailableEndpoint(peer_id, peer_endpoint_pair, this_endpoint_pair,
+                                              this_nat_type);
+  if (rudp::kSuccess != ret_val) {
+    LOG(kVerbose) << "No endpoint for a shortcut to " << DebugId(peer_id)
+                  << ".  Rudp returned :" << ret_val;
+    network_.shortcuts().Abandon(peer_id);
+    return;
+  }
+  protobuf::Message connect_rpc(rpcs::Connect(
+      peer_id, this_endpoint_pair, routing_table_.kNodeId(), routing_table_.kConnectionId(),
+      routing_table_.client_mode(), this_nat_type, false, NodeId(), true,
+      routing_table_.network_coordinates().Local()));
+  LOG(kVerbose) << "Sending shortcut Connect RPC to " << DebugId(peer_id)
+                << " message id : " << connect_rpc.id();
+  network_.pending_requests().Add(connect_rpc);
+  network_.SendToClosestNode(connect_rpc);
+}
+
 void ResponseHandler::CheckAndSendConnectRequest(const NodeId& node_id) {
-  uint16_t limit(routing_table_.client_mode() ? Parameters::max_routing_table_size_for_client
-                                              : Parameters::greedy_fraction);
+  uint16_t limit(routing_table_.kGreedyFraction());
   if ((routing_table_.size() < limit) ||
       NodeId::CloserToTarget(
           node_id, routing_table_.GetNthClosestNode(routing_table_.kNodeId(), limit).node_id,
@@ -398,8 +586,9 @@ void ResponseHandler::CloseNodeUpdateForClient(protobuf::Message& message) {
       closest_nodes.push_back(NodeId(basic_info.node_id()));
     }
   }
-  assert(!closest_nodes.empty());
-  HandleSuccessAcknowledgementAsRequestor(closest_nodes);
+  // a delta update may consist only of removals, which need no new connections
+  if (!closest_nodes.empty())
+    HandleSuccessAcknowledgementAsRequestor(closest_nodes);
   message.Clear();
 }
 
@@ -425,7 +614,7 @@ void ResponseHandler::GetGroup(Timer<std::string>& timer, protobuf::Message& mes
   try {
     if (!message.has_id() || message.data_size() != 1)
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
-    timer.AddResponse(message.id(), message.data(0));
+    timer.AddResponse(message.id(), std::move(*message.mutable_data(0)));
   }
   catch (const maidsafe_error& e) {
     LOG(kError) << e.what();
@@ -435,12 +624,26 @@ void ResponseHandler::GetGroup(Timer<std::string>& timer, protobuf::Message& mes
 
 void ResponseHandler::set_request_public_key_functor(RequestPublicKeyFunctor request_public_key) {
   request_public_key_functor_ = request_public_key;
+  public_key_prefetch_->set_request_public_key_functor(request_public_key);
+  standby_key_prefetch_->set_request_public_key_functor(request_public_key);
+}
+
+void ResponseHandler::TakePublicKey(const NodeId& node_id, GivePublicKeyFunctor give_key) {
+  if (standby_key_prefetch_->Holds(node_id))
+    standby_key_prefetch_->Take(node_id, give_key);
+  else
+    public_key_prefetch_->Take(node_id, give_key);
 }
 
 RequestPublicKeyFunctor ResponseHandler::request_public_key_functor() const {
   return request_public_key_functor_;
 }
 
+void ResponseHandler::set_find_nodes_response_functor(
+    FindNodesResponseFunctor find_nodes_response_functor) {
+  find_nodes_response_functor_ = find_nodes_response_functor;
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
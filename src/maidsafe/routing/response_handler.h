@@ -19,11 +19,13 @@
 #ifndef MAIDSAFE_ROUTING_RESPONSE_HANDLER_H_
 #define MAIDSAFE_ROUTING_RESPONSE_HANDLER_H_
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 #include <utility>
 #include <deque>
+#include <functional>
 
 #include "boost/asio/deadline_timer.hpp"
 #include "boost/date_time/posix_time/ptime.hpp"
@@ -32,6 +34,7 @@
 #include "maidsafe/rudp/managed_connections.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/public_key_prefetch.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
@@ -53,6 +56,9 @@ class GroupChangeHandler;
 
 class ResponseHandler : public std::enable_shared_from_this<ResponseHandler> {
  public:
+  // Given the responder and the node IDs of each FindNodes response received
+  typedef std::function<void(const NodeId&, const std::vector<NodeId>&)> FindNodesResponseFunctor;
+
   ResponseHandler(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
                   NetworkUtils& network, GroupChangeHandler& group_change_handler);
   virtual ~ResponseHandler();
@@ -60,24 +66,43 @@ class ResponseHandler : public std::enable_shared_from_this<ResponseHandler> {
   virtual void Connect(protobuf::Message& message);
   virtual void FindNodes(const protobuf::Message& message);
   virtual void ConnectSuccessAcknowledgement(protobuf::Message& message);
+  // Completes the connection if |message| is a ConnectSuccess for the streamlined handshake (see
+  // Parameters::streamlined_handshake), else returns false having done nothing.
+  bool StreamlinedConnectSuccess(const protobuf::Message& message);
+  // As above, for a ConnectSuccess completing a shortcut (see shortcut_table.h).
+  bool ShortcutConnectSuccess(const protobuf::Message& message);
   void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key);
   RequestPublicKeyFunctor request_public_key_functor() const;
+  std::shared_ptr<PublicKeyPrefetch> public_key_prefetch() const { return public_key_prefetch_; }
+  // For keys of standby nodes (see Parameters::standby_cache_size), which are held apart so that
+  // they can't crowd out those of connections under way.
+  std::shared_ptr<PublicKeyPrefetch> standby_key_prefetch() const { return standby_key_prefetch_; }
+  void set_find_nodes_response_functor(FindNodesResponseFunctor find_nodes_response_functor);
   void GetGroup(Timer<std::string>& timer, protobuf::Message& message);
   void CloseNodeUpdateForClient(protobuf::Message& message);
+  // Asks each of |node_ids| which the routing table would take to connect.
+  void SendConnectRequests(const std::vector<NodeId>& node_ids);
+  // Asks |peer_id|, which needn't be one the routing table would take, for a shortcut.
+  void SendShortcutRequest(const NodeId& peer_id);
   void AddMatrixUpdateFromUnvalidatedPeer(const NodeId& node_id,
                                           const std::vector<NodeInfo>& matrix_update);
 
   friend class test::ResponseHandlerTest_BEH_ConnectAttempts_Test;
 
  private:
+  // Takes |node_id|'s key from whichever prefetch holds it, or asks for it.
+  void TakePublicKey(const NodeId& node_id, GivePublicKeyFunctor give_key);
   void SendConnectRequest(const NodeId peer_node_id);
   void CheckAndSendConnectRequest(const NodeId& node_id);
   void HandleSuccessAcknowledgementAsRequestor(const std::vector<NodeId>& close_ids);
   void HandleSuccessAcknowledgementAsReponder(NodeInfo peer, bool client);
+  // Unless |streamlined|, a peer which requested the connection is sent an acknowledgement.
   void ValidateAndCompleteConnectionToClient(const NodeInfo& peer, bool from_requestor,
-                                             const std::vector<NodeId>& close_ids);
+                                             const std::vector<NodeId>& close_ids,
+                                             bool streamlined = false);
   void ValidateAndCompleteConnectionToNonClient(const NodeInfo& peer, bool from_requestor,
-                                                const std::vector<NodeId>& close_ids);
+                                                const std::vector<NodeId>& close_ids,
+                                                bool streamlined = false);
 
   mutable std::mutex mutex_;
   RoutingTable& routing_table_;
@@ -85,6 +110,8 @@ class ResponseHandler : public std::enable_shared_from_this<ResponseHandler> {
   NetworkUtils& network_;
   GroupChangeHandler& group_change_handler_;
   RequestPublicKeyFunctor request_public_key_functor_;
+  std::shared_ptr<PublicKeyPrefetch> public_key_prefetch_, standby_key_prefetch_;
+  FindNodesResponseFunctor find_nodes_response_functor_;
   std::deque<std::pair<NodeId, std::vector<NodeInfo>>> unvalidated_matrix_updates_;
 };
 
@@ -0,0 +1,182 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/route_history.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const std::vector<std::string>& NoNodeIds() {
+  static const std::vector<std::string> kNoNodeIds;
+  return kNoNodeIds;
+}
+
+// |raw_id| is a full node ID, or at least its trailing kRouteHistoryTagSize bytes.
+bool TagsContain(const std::string& route_history, size_t tag_count, const std::string& raw_id) {
+  if (raw_id.size() < kRouteHistoryTagSize)
+    return false;
+  const char* const kTag(raw_id.data() + raw_id.size() - kRouteHistoryTagSize);
+  tag_count = std::min(tag_count, route_history.size() / kRouteHistoryTagSize);
+  for (size_t i(0); i != tag_count; ++i) {
+    if (route_history.compare(i * kRouteHistoryTagSize, kRouteHistoryTagSize, kTag,
+                              kRouteHistoryTagSize) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool TagsContain(const std::string& route_history, size_t tag_count, const NodeId& node_id) {
+  return TagsContain(route_history, tag_count, node_id.string());
+}
+
+void AppendTag(std::string& route_history, const std::string& raw_id) {
+  if (raw_id.size() < kRouteHistoryTagSize ||
+      TagsContain(route_history, route_history.size() / kRouteHistoryTagSize, raw_id))
+    return;
+  route_history.append(raw_id, raw_id.size() - kRouteHistoryTagSize, kRouteHistoryTagSize);
+  const size_t kMaxSize(Parameters::max_route_history * kRouteHistoryTagSize);
+  if (route_history.size() > kMaxSize)
+    route_history.erase(0, route_history.size() - kMaxSize);
+}
+
+// The most recent hop stays eligible unless |exclude_last_hop|, and a lone tag of this node's own
+// is ignored.
+size_t ExcludedTagCount(const std::string& route_history, const NodeId& this_node_id,
+                        bool exclude_last_hop) {
+  size_t tag_count(route_history.size() / kRouteHistoryTagSize);
+  if (tag_count > 1) {
+    if (!exclude_last_hop)
+      --tag_count;
+  } else if (tag_count == 1 && TagsContain(route_history, 1, this_node_id)) {
+    tag_count = 0;
+  }
+  return tag_count;
+}
+
+}  // unnamed namespace
+
+std::string RouteHistoryTag(const NodeId& node_id) {
+  const std::string kRawId(node_id.string());
+  return kRawId.substr(kRawId.size() - std::min(kRawId.size(), kRouteHistoryTagSize));
+}
+
+size_t RouteHistorySize(const protobuf::Message& message) {
+  return message.route_history_tags().size() / kRouteHistoryTagSize;
+}
+
+bool RouteHistoryContains(const protobuf::Message& message, const NodeId& node_id) {
+  return TagsContain(message.route_history_tags(), RouteHistorySize(message), node_id);
+}
+
+void AddToRouteHistory(protobuf::Message& message, const NodeId& node_id) {
+  AddToRouteHistory(*message.mutable_route_history_tags(), node_id);
+}
+
+void AddToRouteHistory(std::string& route_history, const NodeId& node_id) {
+  AppendTag(route_history, node_id.string());
+}
+
+void UpgradeRouteHistory(protobuf::Message& message) {
+  if (message.route_history_size() == 0)
+    return;
+  std::string route_history;
+  for (const auto& node_id : message.route_history())
+    AppendTag(route_history, node_id);
+  for (size_t i(0); i != RouteHistorySize(message); ++i)
+    AppendTag(route_history, message.route_history_tags().substr(i * kRouteHistoryTagSize,
+                                                                 kRouteHistoryTagSize));
+  message.clear_route_history();
+  message.set_route_history_tags(route_history);
+}
+
+std::string RouteHistoryDebugString(const protobuf::Message& message) {
+  std::string debug_string;
+  for (size_t i(0); i != RouteHistorySize(message); ++i) {
+    debug_string += HexEncode(message.route_history_tags().substr(i * kRouteHistoryTagSize,
+                                                             kRouteHistoryTagSize)) + ", ";
+  }
+  return debug_string;
+}
+
+ExcludedNodes::ExcludedNodes() : route_history_(nullptr), tag_count_(0), node_ids_(&NoNodeIds()) {}
+
+ExcludedNodes::ExcludedNodes(const std::vector<std::string>& node_ids)
+    : route_history_(nullptr), tag_count_(0), node_ids_(&node_ids) {}
+
+ExcludedNodes::ExcludedNodes(const std::string& route_history, size_t tag_count,
+                             const std::vector<std::string>& node_ids)
+    : route_history_(&route_history),
+      tag_count_(std::min(tag_count, route_history.size() / kRouteHistoryTagSize)),
+      node_ids_(&node_ids) {}
+
+bool ExcludedNodes::Contains(const NodeId& node_id) const {
+  return ContainsTag(node_id) ||
+         std::find(node_ids_->begin(), node_ids_->end(), node_id.string()) != node_ids_->end();
+}
+
+bool ExcludedNodes::ContainsTag(const NodeId& node_id) const {
+  return tag_count_ != 0 && TagsContain(*route_history_, tag_count_, node_id);
+}
+
+std::string ExcludedNodes::DebugString() const {
+  std::string debug_string;
+  for (size_t i(0); i != tag_count_; ++i) {
+    debug_string.append("\t");
+    debug_string.append(
+        HexEncode(route_history_->substr(i * kRouteHistoryTagSize, kRouteHistoryTagSize)));
+  }
+  for (const auto& node_id : *node_ids_) {
+    debug_string.append("\t");
+    debug_string.append(HexSubstr(node_id));
+  }
+  return debug_string;
+}
+
+ExcludedNodes RouteHistoryExclusions(const protobuf::Message& message, const NodeId& this_node_id,
+                                     bool exclude_last_hop,
+                                     const std::vector<std::string>& node_ids) {
+  return ExcludedNodes(
+      message.route_history_tags(),
+      ExcludedTagCount(message.route_history_tags(), this_node_id, exclude_last_hop), node_ids);
+}
+
+ExcludedNodes RouteHistoryExclusions(const protobuf::Message& message, const NodeId& this_node_id,
+                                     bool exclude_last_hop) {
+  return RouteHistoryExclusions(message, this_node_id, exclude_last_hop, NoNodeIds());
+}
+
+ExcludedNodes RouteHistoryExclusions(const std::string& route_history, const NodeId& this_node_id,
+                                     bool exclude_last_hop) {
+  return ExcludedNodes(route_history,
+                       ExcludedTagCount(route_history, this_node_id, exclude_last_hop),
+                       NoNodeIds());
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
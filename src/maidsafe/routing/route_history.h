@@ -0,0 +1,92 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
+#define MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// protobuf::Message::route_history_tags holds the last few hops a message visited as concatenated
+// fixed-size tags, oldest first.  A tag is the trailing bytes of a node ID; the leading bytes are
+// avoided since the nodes along a route share ever longer prefixes with its destination.  Older
+// nodes send the full IDs in protobuf::Message::route_history instead.
+const size_t kRouteHistoryTagSize = 8;
+
+std::string RouteHistoryTag(const NodeId& node_id);
+size_t RouteHistorySize(const protobuf::Message& message);
+bool RouteHistoryContains(const protobuf::Message& message, const NodeId& node_id);
+// Appends |node_id| unless already present, discarding the oldest tags beyond
+// Parameters::max_route_history.
+void AddToRouteHistory(protobuf::Message& message, const NodeId& node_id);
+void AddToRouteHistory(std::string& route_history, const NodeId& node_id);
+// Folds any full IDs in a received message's route_history into its tags.
+void UpgradeRouteHistory(protobuf::Message& message);
+std::string RouteHistoryDebugString(const protobuf::Message& message);
+
+// Non-owning set of nodes to skip when choosing a next hop: the first |tag_count| tags of a
+// message's route history and a list of full node IDs, e.g. peers a send has failed to.  Both
+// referenced containers must outlive the ExcludedNodes.
+class ExcludedNodes {
+ public:
+  ExcludedNodes();
+  // Implicit so that a plain list of full IDs can be passed wherever exclusions are expected.
+  ExcludedNodes(const std::vector<std::string>& node_ids);  // NOLINT
+  ExcludedNodes(const std::string& route_history, size_t tag_count,
+                const std::vector<std::string>& node_ids);
+
+  bool Contains(const NodeId& node_id) const;
+  bool ContainsTag(const NodeId& node_id) const;
+  bool empty() const { return tag_count_ == 0 && node_ids_->empty(); }
+  size_t size() const { return tag_count_ + node_ids_->size(); }
+  const std::vector<std::string>& node_ids() const { return *node_ids_; }
+  std::string DebugString() const;
+
+ private:
+  const std::string* route_history_;
+  size_t tag_count_;
+  const std::vector<std::string>* node_ids_;
+};
+
+// The route history of |message| to exclude when forwarding it, plus |node_ids|.  Unless
+// |exclude_last_hop| is set, the most recent hop stays eligible when there are several.
+ExcludedNodes RouteHistoryExclusions(const protobuf::Message& message, const NodeId& this_node_id,
+                                     bool exclude_last_hop,
+                                     const std::vector<std::string>& node_ids);
+ExcludedNodes RouteHistoryExclusions(const protobuf::Message& message, const NodeId& this_node_id,
+                                     bool exclude_last_hop);
+// As above, for a route history read by MessageHeader.
+ExcludedNodes RouteHistoryExclusions(const std::string& route_history, const NodeId& this_node_id,
+                                     bool exclude_last_hop);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTE_HISTORY_H_
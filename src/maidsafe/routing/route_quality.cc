@@ -0,0 +1,87 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/route_quality.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Each new sample contributes this much of the mean, so that roughly the last few dozen count.
+const double kDecay(1.0 / 8);
+// A bucket with fewer samples than this has no allowance, as its mean may just be noise.
+const uint16_t kMinSamples(8);
+
+bool InRange(int32_t bucket) { return bucket >= 0 && bucket < RouteQuality::kBucketCount; }
+
+}  // unnamed namespace
+
+const int32_t RouteQuality::kBucketCount;
+
+RouteQuality::RouteQuality()
+    : mutex_(), mean_hops_(), samples_(), counted_mean_hops_total_(0), counted_buckets_(0) {
+  mean_hops_.fill(0);
+  samples_.fill(0);
+}
+
+void RouteQuality::RecordHops(int32_t bucket, int32_t hops) {
+  if (!InRange(bucket) || hops < 1)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  double& mean(mean_hops_[bucket]);
+  uint16_t& samples(samples_[bucket]);
+  if (samples >= kMinSamples)
+    counted_mean_hops_total_ -= mean;
+  mean = samples == 0 ? hops : mean + (hops - mean) * kDecay;
+  if (samples < kMinSamples && ++samples == kMinSamples)
+    ++counted_buckets_;
+  if (samples >= kMinSamples)
+    counted_mean_hops_total_ += mean;
+}
+
+uint16_t RouteQuality::BucketAllowance(int32_t bucket) const {
+  if (!InRange(bucket) || Parameters::route_quality_max_bucket_bias == 0)
+    return 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (samples_[bucket] < kMinSamples)
+    return 0;
+  const double kExcess(
+      std::floor(mean_hops_[bucket] - counted_mean_hops_total_ / counted_buckets_));
+  if (kExcess < 1)
+    return 0;
+  return static_cast<uint16_t>(
+      std::min<double>(kExcess, Parameters::route_quality_max_bucket_bias));
+}
+
+double RouteQuality::MeanHops(int32_t bucket) const {
+  if (!InRange(bucket))
+    return 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return mean_hops_[bucket];
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
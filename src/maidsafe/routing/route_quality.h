@@ -0,0 +1,67 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTE_QUALITY_H_
+#define MAIDSAFE_ROUTING_ROUTE_QUALITY_H_
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Learns how well this node's routing table serves each of its buckets from the hops its requests
+// took to reach their destinations, as the destinations report back in their replies.  A bucket
+// whose requests take longer than the average over buckets by at least a hop is allowed that many
+// (up to Parameters::route_quality_max_bucket_bias) more peers than Parameters::bucket_target_size
+// before its peers become candidates for replacement, so that the table fills towards the distance
+// ranges it reaches worst.  Hop counts are averaged with a decay so that the allowance follows the
+// table.
+class RouteQuality {
+ public:
+  static const int32_t kBucketCount = static_cast<int32_t>(NodeId::kSize) * 8;
+
+  RouteQuality();
+  // Counts a request to a destination in |bucket| which was delivered after |hops| hops.
+  void RecordHops(int32_t bucket, int32_t hops);
+  // Number of peers |bucket| may hold beyond Parameters::bucket_target_size.
+  uint16_t BucketAllowance(int32_t bucket) const;
+  // Decayed mean of the hops recorded for |bucket|, or zero if there are none.
+  double MeanHops(int32_t bucket) const;
+
+ private:
+  RouteQuality(const RouteQuality&);
+  RouteQuality& operator=(const RouteQuality&);
+
+  mutable std::mutex mutex_;
+  std::array<double, kBucketCount> mean_hops_;
+  std::array<uint16_t, kBucketCount> samples_;
+  // Sum of mean_hops_ over the buckets with enough samples to be counted, and their number
+  double counted_mean_hops_total_;
+  int32_t counted_buckets_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTE_QUALITY_H_
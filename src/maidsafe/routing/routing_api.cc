@@ -29,15 +29,29 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 
 Routing::Routing()
     : pimpl_() {
-  InitialisePimpl(true, NodeId(NodeId::kRandomId), asymm::GenerateKeyPair());
+  InitialisePimpl(true, NodeId(NodeId::kRandomId), asymm::GenerateKeyPair(), nullptr,
+                  NodeParameters());
 }
 
-void Routing::InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys) {
-  pimpl_.reset(new Impl(client_mode, node_id, keys));
+Routing::Routing(std::shared_ptr<AsioService> asio_service,
+                 const NodeParameters& node_parameters)
+    : pimpl_() {
+  InitialisePimpl(true, NodeId(NodeId::kRandomId), asymm::GenerateKeyPair(), asio_service,
+                  node_parameters);
+}
+
+Routing::Routing(const RoutingContext& context, const NodeParameters& node_parameters)
+    : Routing(context.asio_service(), node_parameters) {}
+
+void Routing::InitialisePimpl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                              std::shared_ptr<AsioService> asio_service,
+                              const NodeParameters& node_parameters) {
+  pimpl_.reset(new Impl(client_mode, node_id, keys, asio_service, node_parameters));
 }
 
-void Routing::Join(Functors functors, BootstrapContacts bootstrap_contacts) {
-  pimpl_->Join(functors, bootstrap_contacts);
+void Routing::Join(Functors functors, BootstrapContacts bootstrap_contacts,
+                   std::string routing_table_snapshot) {
+  pimpl_->Join(functors, bootstrap_contacts, routing_table_snapshot);
 }
 
 int Routing::ZeroStateJoin(Functors functors, const Endpoint& local_endpoint,
@@ -47,34 +61,59 @@ int Routing::ZeroStateJoin(Functors functors, const Endpoint& local_endpoint,
 
 // Send methods
 template <>
-void Routing::Send(const SingleToSingleMessage& message) {
-  pimpl_->Send(message);
+void Routing::Send(const SingleToSingleMessage& message, bool race) {
+  pimpl_->Send(message, race);
 }
 
 template <>
-void Routing::Send(const SingleToGroupMessage& message) {
-  pimpl_->Send(message);
+void Routing::Send(const SingleToGroupMessage& message, bool race) {
+  pimpl_->Send(message, race);
 }
 
 template <>
-void Routing::Send(const GroupToSingleMessage& message) {
-  pimpl_->Send(message);
+void Routing::Send(const GroupToSingleMessage& message, bool race) {
+  pimpl_->Send(message, race);
 }
 
 template <>
-void Routing::Send(const GroupToGroupMessage& message) {
-  pimpl_->Send(message);
+void Routing::Send(const GroupToGroupMessage& message, bool race) {
+  pimpl_->Send(message, race);
 }
 
 template <>
-void Routing::Send(const GroupToSingleRelayMessage& message) {
-  pimpl_->Send(message);
+void Routing::Send(const GroupToSingleRelayMessage& message, bool race) {
+  pimpl_->Send(message, race);
+}
+
+void Routing::Send(SingleToSingleMessage&& message, bool race) {
+  pimpl_->Send(std::move(message), race);
+}
+
+void Routing::Send(SingleToGroupMessage&& message, bool race) {
+  pimpl_->Send(std::move(message), race);
+}
+
+void Routing::Send(GroupToSingleMessage&& message, bool race) {
+  pimpl_->Send(std::move(message), race);
+}
+
+void Routing::Send(GroupToGroupMessage&& message, bool race) {
+  pimpl_->Send(std::move(message), race);
+}
+
+void Routing::Send(GroupToSingleRelayMessage&& message, bool race) {
+  pimpl_->Send(std::move(message), race);
 }
 
 
 void Routing::SendDirect(const NodeId& destination_id, const std::string& message,
-                         bool cacheable, ResponseFunctor response_functor) {
-  return pimpl_->SendDirect(destination_id, message, cacheable, response_functor);
+                         bool cacheable, ResponseFunctor response_functor, bool race) {
+  return pimpl_->SendDirect(destination_id, message, cacheable, response_functor, race);
+}
+
+void Routing::SendDirect(const NodeId& destination_id, std::string&& message, bool cacheable,
+                         ResponseFunctor response_functor, bool race) {
+  return pimpl_->SendDirect(destination_id, std::move(message), cacheable, response_functor, race);
 }
 
 void Routing::SendGroup(const NodeId& destination_id, const std::string& message,
@@ -82,6 +121,61 @@ void Routing::SendGroup(const NodeId& destination_id, const std::string& message
   return pimpl_->SendGroup(destination_id, message, cacheable, response_functor);
 }
 
+void Routing::SendGroup(const NodeId& destination_id, std::string&& message, bool cacheable,
+                        ResponseFunctor response_functor) {
+  return pimpl_->SendGroup(destination_id, std::move(message), cacheable, response_functor);
+}
+
+void Routing::SendDirect(const NodeId& destination_id, std::string message, bool cacheable,
+                         SendMode send_mode, DeliveryFunctor delivery_functor) {
+  pimpl_->SendDirect(destination_id, std::move(message), cacheable, send_mode, delivery_functor);
+}
+
+void Routing::SendGroup(const NodeId& destination_id, std::string message, bool cacheable,
+                        SendMode send_mode, DeliveryFunctor delivery_functor) {
+  pimpl_->SendGroup(destination_id, std::move(message), cacheable, send_mode, delivery_functor);
+}
+
+std::future<std::vector<std::string>> Routing::SendGroup(const NodeId& destination_id,
+                                                         std::string message, bool cacheable,
+                                                         uint16_t quorum) {
+  return pimpl_->SendGroup(destination_id, std::move(message), cacheable, quorum);
+}
+
+void Routing::SendBatch(std::vector<BatchedMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+template <>
+void Routing::SendBatch(std::vector<SingleToSingleMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+template <>
+void Routing::SendBatch(std::vector<SingleToGroupMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+template <>
+void Routing::SendBatch(std::vector<GroupToSingleMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+template <>
+void Routing::SendBatch(std::vector<GroupToGroupMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+template <>
+void Routing::SendBatch(std::vector<GroupToSingleRelayMessage> messages) {
+  pimpl_->SendBatch(std::move(messages));
+}
+
+void Routing::SendStream(const NodeId& destination_id, std::string data,
+                         StreamSentFunctor stream_sent) {
+  pimpl_->SendStream(destination_id, std::move(data), stream_sent);
+}
+
 bool Routing::ClosestToId(const NodeId& target_id) { return pimpl_->ClosestToId(target_id); }
 
 GroupRangeStatus Routing::IsNodeIdInGroupRange(const NodeId& group_id) const {
@@ -93,6 +187,14 @@ GroupRangeStatus Routing::IsNodeIdInGroupRange(const NodeId& group_id,
   return pimpl_->IsNodeIdInGroupRange(group_id, node_id);
 }
 
+GroupRangeView Routing::GetGroupRangeView() const { return pimpl_->GetGroupRangeView(); }
+
+ResponsibilityRanges Routing::GetResponsibilityRanges() const {
+  return pimpl_->GetResponsibilityRanges();
+}
+
+void Routing::InvalidatePublicKey(const NodeId& node_id) { pimpl_->InvalidatePublicKey(node_id); }
+
 NodeId Routing::RandomConnectedNode() { return pimpl_->RandomConnectedNode(); }
 
 bool Routing::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) const {
@@ -109,12 +211,35 @@ int Routing::network_status() { return pimpl_->network_status(); }
 
 std::vector<NodeInfo> Routing::ClosestNodes() { return pimpl_->ClosestNodes(); }
 
+std::vector<size_t> Routing::InboundQueueDepths() const { return pimpl_->InboundQueueDepths(); }
+
+std::vector<ReceivedMessage> Routing::ReceiveMessages(size_t max_count,
+                                                      std::chrono::milliseconds timeout) {
+  return pimpl_->ReceiveMessages(max_count, timeout);
+}
+
+CacheStatistics Routing::GetCacheStatistics() const { return pimpl_->GetCacheStatistics(); }
+
+RoutingStatistics Routing::GetStatistics() const { return pimpl_->GetStatistics(); }
+
+TableTuningStatistics Routing::GetTableTuningStatistics() const {
+  return pimpl_->GetTableTuningStatistics();
+}
+
+MemoryStatistics Routing::GetMemoryStatistics() const { return pimpl_->GetMemoryStatistics(); }
+
+void Routing::RecordInboundTrace(const boost::filesystem::path& path) {
+  pimpl_->RecordInboundTrace(path);
+}
+
 bool Routing::IsConnectedVault(const NodeId& node_id) { return pimpl_->IsConnectedVault(node_id); }
 
 bool Routing::IsConnectedClient(const NodeId& node_id) {
   return pimpl_->IsConnectedClient(node_id);
 }
 
+void Routing::Leave() { pimpl_->Leave(); }
+
 void UpdateNetworkHealth(int updated_health, int& current_health, std::mutex& mutex,
                          std::condition_variable& cond_var, const NodeId& this_node_id) {
   {
@@ -0,0 +1,51 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/routing_clock.h"
+
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+RoutingClock::TimeSource& VirtualTime() {
+  static RoutingClock::TimeSource time_source;
+  return time_source;
+}
+
+}  // unnamed namespace
+
+const bool RoutingClock::is_steady;
+
+RoutingClock::time_point RoutingClock::now() {
+  const TimeSource& time_source(VirtualTime());
+  return time_source ? time_source() : std::chrono::steady_clock::now();
+}
+
+void RoutingClock::set_virtual_time(TimeSource time_source) {
+  VirtualTime() = std::move(time_source);
+}
+
+bool RoutingClock::is_virtual() { return static_cast<bool>(VirtualTime()); }
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -18,8 +18,15 @@
 
 #include "maidsafe/routing/routing_impl.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <exception>
+#include <limits>
+#include <set>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "maidsafe/common/log.h"
 
@@ -29,12 +36,21 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/bootstrap_file_operations.h"
+#include "maidsafe/routing/data_compression.h"
+#include "maidsafe/routing/matrix_change.h"
 #include "maidsafe/routing/message.h"
 #include "maidsafe/routing/message_handler.h"
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/object_pool.h"
+#include "maidsafe/routing/path_trace.h"
 #include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_metrics.h"
+#include "maidsafe/routing/routing_table_snapshot.h"
 #include "maidsafe/routing/rpcs.h"
+#include "maidsafe/routing/stream_transfer.h"
+#include "maidsafe/routing/trace.h"
 #include "maidsafe/routing/utils.h"
 #include "maidsafe/routing/network_statistics.h"
 
@@ -48,25 +64,30 @@ namespace {
 
 typedef boost::asio::ip::udp::endpoint Endpoint;
 
+// Parsed messages are recycled, keeping the capacity of their fields for the next datagram.  The
+// pool's thread_local caches stand in for per-worker arenas, which need protobuf 3.
+typedef ObjectPool<protobuf::Message> MessagePool;
+
 }  // unnamed namespace
 
 namespace detail {}  // namespace detail
 
 template <>
-void Routing::Impl::Send(const GroupToSingleRelayMessage& message) {
+void Routing::Impl::Send(GroupToSingleRelayMessage message, bool race) {
   assert(!functors_.message_and_caching.message_received &&
          "Not allowed with string type message API");
-  protobuf::Message proto_message = CreateNodeLevelMessage(message);
+  SingleId relay_node(message.receiver.relay_node);
+  protobuf::Message proto_message = CreateNodeLevelMessage(std::move(message));
   // append relay information
-  SendMessage(message.receiver.relay_node, proto_message);
+  SendMessage(relay_node, proto_message, race);
 }
 
 template <>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelayMessage& message) {
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(GroupToSingleRelayMessage message) {
   protobuf::Message proto_message;
   proto_message.set_destination_id(message.receiver.relay_node->string());
   proto_message.set_routing_message(false);
-  proto_message.add_data(message.contents);
+  proto_message.add_data()->swap(message.contents);
   proto_message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
 
   proto_message.set_cacheable(static_cast<int32_t>(message.cacheable));
@@ -89,30 +110,116 @@ protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelay
   return proto_message;
 }
 
-Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys)
+Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+                    std::shared_ptr<AsioService> asio_service,
+                    const NodeParameters& node_parameters)
     : network_status_mutex_(),
       network_status_(kNotJoined),
       network_statistics_(node_id),
-      routing_table_(client_mode, node_id, keys, network_statistics_),
+      routing_table_(client_mode, node_id, keys, network_statistics_, node_parameters),
       kNodeId_(node_id),
       running_(true),
+      left_(false),
       running_mutex_(),
+      lifetime_guard_(),
+      inbound_trace_(),
       functors_(),
+      notifications_(),
+      application_queue_(Parameters::application_queue_size == 0
+                             ? nullptr
+                             : std::make_shared<ApplicationQueue>(
+                                   Parameters::application_queue_size)),
       random_node_helper_(),
       // TODO(Prakash) : don't create client_routing_table for client nodes (wrap both)
-      client_routing_table_(node_id),
+      client_routing_table_(node_id, node_parameters.max_client_routing_table_size),
       remove_furthest_node_(routing_table_, network_),
       group_change_handler_(routing_table_, client_routing_table_, network_),
+      duplicate_filter_(Parameters::duplicate_filter_capacity, Parameters::duplicate_filter_window),
+      group_cache_(),
+      signature_verifier_(Parameters::verify_signatures
+                              ? new SignatureVerifier(Parameters::signature_verification_threads,
+                                                      Parameters::signature_verification_batch_size,
+                                                      Parameters::verified_signature_cache_size)
+                              : nullptr),
+      lookup_mutex_(),
+      lookup_(),
+      warm_peers_mutex_(),
+      warm_peers_(),
+      public_key_cache_(),
+      standby_cache_(node_id, Parameters::standby_cache_size),
+      responsibility_ranges_mutex_(),
+      responsibility_ranges_(),
+      table_size_tuner_(Parameters::auto_tune_min_table_size, routing_table_.kMaxSize(),
+                        node_parameters.removal_high_watermark),
+      kRemovalWatermarkGap_(node_parameters.removal_high_watermark >
+                                    node_parameters.removal_low_watermark
+                                ? node_parameters.removal_high_watermark -
+                                      node_parameters.removal_low_watermark
+                                : 0),
+      memory_budget_(std::make_shared<MemoryBudget>(Parameters::memory_soft_budget,
+                                                    Parameters::memory_hard_budget)),
+      relayed_requests_mutex_(),
+      relayed_requests_(),
       message_handler_(),
-      asio_service_(2),
-      network_(routing_table_, client_routing_table_),
-      timer_(asio_service_),
-      re_bootstrap_timer_(asio_service_.service()),
-      recovery_timer_(asio_service_.service()),
-      setup_timer_(asio_service_.service()) {
+      asio_service_(asio_service ? asio_service : std::make_shared<AsioService>(2)),
+      network_(routing_table_, client_routing_table_, *asio_service_),
+      timer_(*asio_service_),
+      re_bootstrap_timer_(asio_service_->service()),
+      recovery_timer_(asio_service_->service()),
+      setup_timer_(asio_service_->service()),
+      lookup_timer_(asio_service_->service()),
+      snapshot_timer_(asio_service_->service()),
+      tuning_timer_(asio_service_->service()),
+      memory_timer_(asio_service_->service()),
+      core_executors_(Parameters::dispatch_cores == 0
+                          ? nullptr
+                          : new CoreExecutors(Parameters::dispatch_cores,
+                                              Parameters::pin_dispatch_threads)),
+      inbound_dispatcher_(asio_service_->service(), Parameters::inbound_dispatch_shards,
+                          Parameters::max_inbound_queued_per_shard, core_executors_.get()) {
   message_handler_.reset(new MessageHandler(routing_table_, client_routing_table_, network_, timer_,
                                             remove_furthest_node_, group_change_handler_,
-                                            network_statistics_));
+                                            network_statistics_, group_cache_));
+  message_handler_->set_memory_budget(memory_budget_);
+  // A cache miss resumes in order with the sender's other messages, and not once stopping.
+  message_handler_->set_resume_functor([this](const std::string& key,
+                                              const std::function<void()>& handler) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    std::function<void()> resume([this, handler]() {
+      {
+        std::lock_guard<std::mutex> lock(running_mutex_);
+        if (!running_)
+          return;
+      }
+      handler();
+    });
+    if (!inbound_dispatcher_.Post(key, lifetime_guard_.Wrap(resume))) {
+      LOG(kWarning) << "[" << DebugId(kNodeId_) << "] inbound queue full; dropping cache miss from "
+                    << HexSubstr(key);
+    }
+  });
+  // Queued connect requests are answered on the control shard, after the handler freeing them.
+  message_handler_->set_service_post_functor([this](const std::function<void()>& handler) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+    inbound_dispatcher_.PostControl(lifetime_guard_.Wrap([this, handler]() {
+      {
+        std::lock_guard<std::mutex> lock(running_mutex_);
+        if (!running_)
+          return;
+      }
+      handler();
+    }));
+  });
+  timer_.set_response_latency_observer([this](std::chrono::steady_clock::duration latency) {
+    network_.metrics().RecordResponseLatency(latency);
+  });
+  timer_.set_task_outcome_observer([this](const TaskOutcome& outcome) {
+    network_.metrics().RecordRequestOutcome(outcome);
+  });
   LOG(kInfo) << (client_mode ? "client " : "non-client ") << "node. Id : " << DebugId(kNodeId_);
   assert((client_mode || !node_id.IsZero()) && "Server Nodes cannot be created without valid keys");
 }
@@ -120,28 +227,59 @@ Routing::Impl::Impl(bool client_mode, const NodeId& node_id, const asymm::Keys&
 Routing::Impl::~Impl() {
   LOG(kVerbose) << "~Impl " << DebugId(kNodeId_) << ", connection id "
                 << DebugId(routing_table_.kConnectionId());
-  std::lock_guard<std::mutex> lock(running_mutex_);
-  running_ = false;
+  try {
+    PublishSnapshot();
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to publish routing table snapshot : " << e.what();
+  }
+  Leave();
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    running_ = false;
+  }
+  // Waits for handlers already running on other threads of a shared service.
+  lifetime_guard_.Revoke();
+  notifications_.Stop();
+  if (core_executors_)
+    core_executors_->Stop();
+  if (application_queue_)
+    application_queue_->Stop();
+  // Outstanding results must not reach the dispatcher or handler once they're destroyed.
+  if (signature_verifier_)
+    signature_verifier_->Stop();
 }
 
-void Routing::Impl::Join(const Functors& functors, const BootstrapContacts& bootstrap_contacts) {
+void Routing::Impl::Join(const Functors& functors, const BootstrapContacts& bootstrap_contacts,
+                         const std::string& routing_table_snapshot) {
   ConnectFunctors(functors);
-  if (!bootstrap_contacts.empty()) {
-    BootstrapFromTheseEndpoints(bootstrap_contacts);
+  BootstrapContacts contacts(routing_table_snapshot.empty()
+                                 ? bootstrap_contacts
+                                 : LoadSnapshot(routing_table_snapshot, bootstrap_contacts));
+  if (!contacts.empty()) {
+    BootstrapFromTheseEndpoints(contacts);
   } else {
     LOG(kInfo) << "Doing a default join";
-    DoJoin(bootstrap_contacts);
+    DoJoin(contacts);
   }
 }
 
 void Routing::Impl::ConnectFunctors(const Functors& functors) {
   functors_ = functors;
+  // Nodes newly in the group matrix are the likeliest replacements for a lost close node.
+  MatrixChangedFunctor matrix_changed([this](std::shared_ptr<MatrixChange> matrix_change) {
+    UpdateResponsibilityRanges();
+    AddStandbyNodes(matrix_change->new_nodes());
+    notifications_.PostMatrixChange(matrix_change, functors_.matrix_changed);
+  });
   routing_table_.InitialiseFunctors([this](int network_status_in) {
                                       {
                                         std::lock_guard<std::mutex> lock(network_status_mutex_);
                                         network_status_ = network_status_in;
                                       }
                                       NotifyNetworkStatus(network_status_in);
+                                      asio_service_->service().post(
+                                          lifetime_guard_.Wrap([this] { RetireRelay(); }));
                                     },
                                     [this](const NodeInfo & node, bool internal_rudp_only) {
                                       RemoveNode(node, internal_rudp_only);
@@ -153,27 +291,214 @@ void Routing::Impl::ConnectFunctors(const Functors& functors) {
                                       if (running_)
                                         group_change_handler_.SendClosestNodesUpdateRpcs(new_nodes,
                                                                                          old_nodes);
-                                    }, functors.matrix_changed);
-  // only one of MessageAndCachingFunctors or TypedMessageAndCachingFunctor should be provided
-  assert(!functors.message_and_caching.message_received !=
-         !functors.typed_message_and_caching.single_to_single.message_received);
-  assert(!functors.message_and_caching.message_received !=
-         !functors.typed_message_and_caching.single_to_group.message_received);
-  assert(!functors.message_and_caching.message_received !=
-         !functors.typed_message_and_caching.group_to_single.message_received);
-  assert(!functors.message_and_caching.message_received !=
-         !functors.typed_message_and_caching.group_to_group.message_received);
+                                    }, matrix_changed);
+  // only one of MessageAndCachingFunctors or TypedMessageAndCachingFunctor should be provided,
+  // unless the application queue or a node-level handler takes the place of message_received
+  const bool kStringMessages(functors.message_and_caching.message_received || application_queue_ ||
+                             functors.node_level_handler);
+  assert(!kStringMessages != !functors.typed_message_and_caching.single_to_single.message_received);
+  assert(!kStringMessages != !functors.typed_message_and_caching.single_to_group.message_received);
+  assert(!kStringMessages != !functors.typed_message_and_caching.group_to_single.message_received);
+  assert(!kStringMessages != !functors.typed_message_and_caching.group_to_group.message_received);
   if (!routing_table_.client_mode()) {
-    assert(!functors.message_and_caching.message_received !=
+    assert(!kStringMessages !=
            !functors.typed_message_and_caching.single_to_group_relay.message_received);
   }
-  if (functors.message_and_caching.message_received)
+  if (kStringMessages) {
     message_handler_->set_message_and_caching_functor(functors.message_and_caching);
-  else
+    if (application_queue_)
+      message_handler_->set_application_queue(application_queue_);
+    else if (functors.node_level_handler)
+      message_handler_->set_node_level_handler(functors.node_level_handler);
+  } else {
     message_handler_->set_typed_message_and_caching_functor(functors.typed_message_and_caching);
+  }
 
-  message_handler_->set_request_public_key_functor(functors.request_public_key);
+  RequestPublicKeyFunctor request_public_key;
+  if (functors.request_public_key) {
+    request_public_key = [this](NodeId node_id, GivePublicKeyFunctor give_key) {
+      RequestPublicKey(node_id, give_key);
+    };
+  }
+  message_handler_->set_request_public_key_functor(request_public_key);
+  message_handler_->set_stream_received_functor(functors.stream_received);
+  message_handler_->set_path_trace_functor(functors.path_trace);
+  message_handler_->set_find_nodes_response_functor(
+      [this](const NodeId& responder, const std::vector<NodeId>& nodes) {
+        HandleFindNodesResponse(responder, nodes);
+      });
+  message_handler_->set_leave_functor(
+      [this](const NodeId& leaver_id, const std::vector<NodeId>& replacement_ids) {
+        DoOnPeerLeft(leaver_id, replacement_ids);
+      });
   network_.set_new_bootstrap_contact_functor(functors.new_bootstrap_contact);
+  network_.set_congestion_functor(functors.congestion);
+  network_.set_suspected_dead_functor([this](const NodeId& connection_id) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (running_)
+      inbound_dispatcher_.PostControl(
+          lifetime_guard_.Wrap([=]() { DoOnSuspectedDead(connection_id); }));  // NOLINT
+  });
+  if (!routing_table_.client_mode()) {
+    network_.set_shortcut_functor([this](const NodeId& destination_id) {
+      std::lock_guard<std::mutex> lock(running_mutex_);
+      if (running_) {
+        inbound_dispatcher_.PostControl(lifetime_guard_.Wrap([=]() {  // NOLINT
+          message_handler_->SendShortcutRequest(destination_id);
+        }));
+      }
+    });
+  }
+  if (functors.routing_table_snapshot)
+    ScheduleSnapshot();
+  if (Parameters::auto_tune_table_size && !routing_table_.client_mode())
+    ScheduleTableTuning();
+  if (Parameters::memory_soft_budget != 0 || Parameters::memory_hard_budget != 0)
+    ScheduleMemoryCheck();
+}
+
+BootstrapContacts Routing::Impl::LoadSnapshot(const std::string& routing_table_snapshot,
+                                              const BootstrapContacts& bootstrap_contacts) {
+  std::vector<SnapshotPeer> peers;
+  try {
+    peers = ParseRoutingTableSnapshot(routing_table_snapshot, routing_table_.kPublicKey());
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Ignoring routing table snapshot : " << e.what();
+    return bootstrap_contacts;
+  }
+  BootstrapContacts contacts;
+  std::vector<NodeInfo> warm_peers;
+  for (const auto& peer : peers) {
+    if (peer.node.node_id == kNodeId_)
+      continue;
+    warm_peers.push_back(peer.node);
+    if (!peer.endpoint.address().is_unspecified() &&
+        std::find(contacts.begin(), contacts.end(), peer.endpoint) == contacts.end())
+      contacts.push_back(peer.endpoint);
+  }
+  for (const auto& contact : bootstrap_contacts) {
+    if (std::find(contacts.begin(), contacts.end(), contact) == contacts.end())
+      contacts.push_back(contact);
+  }
+  LOG(kInfo) << "[" << DebugId(kNodeId_) << "] rejoining " << warm_peers.size()
+             << " peers from routing table snapshot";
+  std::lock_guard<std::mutex> lock(warm_peers_mutex_);
+  warm_peers_.swap(warm_peers);
+  return contacts;
+}
+
+std::vector<NodeId> Routing::Impl::WarmPeerIds() const {
+  std::lock_guard<std::mutex> lock(warm_peers_mutex_);
+  std::vector<NodeId> node_ids;
+  node_ids.reserve(warm_peers_.size());
+  for (const auto& peer : warm_peers_)
+    node_ids.push_back(peer.node_id);
+  return node_ids;
+}
+
+bool Routing::Impl::GetWarmPublicKey(const NodeId& node_id, asymm::PublicKey& public_key) const {
+  std::lock_guard<std::mutex> lock(warm_peers_mutex_);
+  auto itr(std::find_if(warm_peers_.begin(), warm_peers_.end(),
+                        [&](const NodeInfo& peer) { return peer.node_id == node_id; }));
+  if (itr == warm_peers_.end())
+    return false;
+  public_key = itr->public_key;
+  return true;
+}
+
+void Routing::Impl::RequestPublicKey(const NodeId& node_id, GivePublicKeyFunctor give_key) {
+  // Keys kept in the cache, or in a snapshot this node signed, were validated when first given, so
+  // needn't be asked for again.
+  asymm::PublicKey public_key;
+  if (GetWarmPublicKey(node_id, public_key) || public_key_cache_.Get(node_id, public_key))
+    return give_key(public_key);
+  functors_.request_public_key(node_id, [this, node_id, give_key](asymm::PublicKey given_key) {
+    public_key_cache_.Add(node_id, given_key);
+    give_key(given_key);
+  });
+}
+
+void Routing::Impl::ScheduleSnapshot() {
+  if (Parameters::routing_table_snapshot_interval == std::chrono::seconds(0))
+    return;
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  snapshot_timer_.expires_from_now(Parameters::routing_table_snapshot_interval);
+  snapshot_timer_.async_wait(lifetime_guard_.Wrap([=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    PublishSnapshot();
+    ScheduleSnapshot();
+  }));
+}
+
+void Routing::Impl::ScheduleTableTuning() {
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  tuning_timer_.expires_from_now(Parameters::auto_tune_interval);
+  tuning_timer_.async_wait(lifetime_guard_.Wrap([=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    if (table_size_tuner_.Update(network_statistics_.GetDistance())) {
+      const uint16_t kHigh(table_size_tuner_.target());
+      const uint16_t kLow(std::max<uint16_t>(
+          kHigh > kRemovalWatermarkGap_ ? kHigh - kRemovalWatermarkGap_ : 0,
+          std::min(kHigh, Parameters::closest_nodes_size)));
+      LOG(kInfo) << "[" << DebugId(kNodeId_) << "] routing table target now " << kHigh
+                 << " peers, about " << table_size_tuner_.Statistics().estimated_network_size
+                 << " nodes estimated";
+      routing_table_.SetRemovalWatermarks(kHigh, kLow);
+    }
+    ScheduleTableTuning();
+  }));
+}
+
+void Routing::Impl::ScheduleMemoryCheck() {
+  std::lock_guard<std::mutex> lock(running_mutex_);
+  if (!running_)
+    return;
+  memory_timer_.expires_from_now(Parameters::memory_check_interval);
+  memory_timer_.async_wait(lifetime_guard_.Wrap([=](const boost::system::error_code& error_code) {
+    if (error_code == boost::asio::error::operation_aborted)
+      return;
+    MemoryStatistics statistics(GetMemoryStatistics());
+    const MemoryStatistics::Pressure kPressure(memory_budget_->Update(
+        statistics.Total() - statistics.bytes[MemoryStatistics::kInboundQueues]));
+    // Set each time, rather than on a change of pressure, so the cache is restored after a spike.
+    uint64_t cache_limit(std::numeric_limits<uint64_t>::max());
+    if (kPressure == MemoryStatistics::kSoft)
+      cache_limit = Parameters::chunk_cache_bytes / 2;
+    else if (kPressure == MemoryStatistics::kHard)
+      cache_limit = 0;
+    const size_t kEvicted(message_handler_->LimitCache(cache_limit));
+    memory_budget_->AddCacheEvictions(kEvicted);
+    if (kPressure != MemoryStatistics::kNormal) {
+      LOG(kWarning) << "[" << DebugId(kNodeId_) << "] holding about " << statistics.Total()
+                    << " bytes, over the "
+                    << (kPressure == MemoryStatistics::kHard ? "hard" : "soft")
+                    << " memory budget; evicted " << kEvicted << " cache entries";
+    }
+    ScheduleMemoryCheck();
+  }));
+}
+
+void Routing::Impl::PublishSnapshot() {
+  if (!functors_.routing_table_snapshot || routing_table_.size() == 0)
+    return;
+  std::vector<SnapshotPeer> peers;
+  routing_table_.VisitClosestNodes(kNodeId_, static_cast<uint16_t>(routing_table_.size()),
+                                   [&](const NodeInfo& node) {
+    SnapshotPeer peer;
+    peer.node = node;
+    peer.endpoint = network_.PeerEndpoint(node.connection_id);
+    peers.push_back(peer);
+    return true;
+  });
+  functors_.routing_table_snapshot(
+      SerialiseRoutingTableSnapshot(peers, routing_table_.kPrivateKey()));
 }
 
 void Routing::Impl::BootstrapFromTheseEndpoints(const BootstrapContacts& bootstrap_contacts) {
@@ -181,11 +506,15 @@ void Routing::Impl::BootstrapFromTheseEndpoints(const BootstrapContacts& bootstr
              << bootstrap_contacts[0] << ", this node's ID: " << DebugId(kNodeId_)
              << (routing_table_.client_mode() ? " Client" : "");
   if (routing_table_.size() > 0) {
-    for (uint16_t i = 0; i < routing_table_.size(); ++i) {
-      NodeInfo remove_node = routing_table_.GetClosestNode(kNodeId_);
-      network_.Remove(remove_node.connection_id);
-      routing_table_.DropNode(remove_node.node_id, true);
+    std::vector<NodeId> remove_nodes;
+    NodeInfo remove_node;
+    for (const auto& node_id : routing_table_.GetClosestNodes(
+             kNodeId_, static_cast<uint16_t>(routing_table_.size()))) {
+      if (routing_table_.GetNodeInfo(node_id, remove_node))
+        network_.Remove(remove_node.connection_id);
+      remove_nodes.push_back(node_id);
     }
+    routing_table_.DropNodes(remove_nodes, true);
     NotifyNetworkStatus(static_cast<int>(routing_table_.size()));
   }
   DoJoin(bootstrap_contacts);
@@ -207,6 +536,7 @@ int Routing::Impl::DoBootstrap(const BootstrapContacts& bootstrap_contacts) {
   assert(routing_table_.size() == 0);
   recovery_timer_.cancel();
   setup_timer_.cancel();
+  lookup_timer_.cancel();
   std::lock_guard<std::mutex> lock(running_mutex_);
   if (!running_)
     return kNetworkShuttingDown;
@@ -235,6 +565,12 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
     assert(!network_.bootstrap_connection_id().IsZero() && "Only after bootstrapping succeeds");
     assert(!network_.this_node_relay_connection_id().IsZero() &&
            "Relay connection id should be set after bootstrapping succeeds");
+    // Peers from a snapshot are asked straight away, alongside the usual FindNodes to the
+    // bootstrap peer in case they've gone.
+    auto warm_peer_ids(WarmPeerIds());
+    StartLookup(warm_peer_ids);
+    if (!warm_peer_ids.empty())
+      message_handler_->SendConnectRequests(warm_peer_ids);
   } else {
     if (routing_table_.size() > 0) {
       std::lock_guard<std::mutex> lock(running_mutex_);
@@ -244,10 +580,11 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
       LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Added a node in routing table."
                     << " Terminating setup loop & Scheduling recovery loop.";
       recovery_timer_.expires_from_now(Parameters::find_node_interval);
-      recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
-        if (error_code != boost::asio::error::operation_aborted)
-          ReSendFindNodeRequest(error_code, false);
-      });
+      recovery_timer_.async_wait(
+          lifetime_guard_.Wrap([=](const boost::system::error_code & error_code) {
+            if (error_code != boost::asio::error::operation_aborted)
+              ReSendFindNodeRequest(error_code, false);
+          }));
       return;
     }
 
@@ -261,6 +598,7 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
   int num_nodes_requested(1 + attempts / Parameters::find_node_repeats_per_num_requested);
   protobuf::Message find_node_rpc(rpcs::FindNodes(kNodeId_, kNodeId_, num_nodes_requested, true,
                                                   network_.this_node_relay_connection_id()));
+  network_.pending_requests().Add(find_node_rpc);
   LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] (attempt " << attempts << ")"
                 << " requesting " << num_nodes_requested << " nodes"
                 << "   (id: " << find_node_rpc.id() << ")";
@@ -283,10 +621,10 @@ void Routing::Impl::FindClosestNode(const boost::system::error_code& error_code,
   if (!running_)
     return;
   setup_timer_.expires_from_now(Parameters::find_close_node_interval);
-  setup_timer_.async_wait([=](boost::system::error_code error_code_local) {
+  setup_timer_.async_wait(lifetime_guard_.Wrap([=](boost::system::error_code error_code_local) {
     if (error_code_local != boost::asio::error::operation_aborted)
       FindClosestNode(error_code_local, attempts);
-  });
+  }));
 }
 
 int Routing::Impl::ZeroStateJoin(const Functors& functors, const Endpoint& local_endpoint,
@@ -347,10 +685,11 @@ int Routing::Impl::ZeroStateJoin(const Functors& functors, const Endpoint& local
     if (!running_)
       return kNetworkShuttingDown;
     recovery_timer_.expires_from_now(Parameters::find_node_interval);
-    recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
-      if (error_code != boost::asio::error::operation_aborted)
-        ReSendFindNodeRequest(error_code, false);
-    });
+    recovery_timer_.async_wait(
+        lifetime_guard_.Wrap([=](const boost::system::error_code & error_code) {
+          if (error_code != boost::asio::error::operation_aborted)
+            ReSendFindNodeRequest(error_code, false);
+        }));
     return kSuccess;
   } else {
     LOG(kError) << "Failed to join zero state network, with bootstrap_endpoint " << peer_endpoint;
@@ -358,26 +697,97 @@ int Routing::Impl::ZeroStateJoin(const Functors& functors, const Endpoint& local
   }
 }
 
-void Routing::Impl::SendDirect(const NodeId& destination_id, const std::string& data,
-                               bool cacheable, ResponseFunctor response_functor) {
+void Routing::Impl::SendDirect(const NodeId& destination_id, std::string data,
+                               bool cacheable, ResponseFunctor response_functor, bool race) {
   assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
          "Not allowed with typed Message API");
-  Send(destination_id, data, DestinationType::kDirect, cacheable, response_functor);
+  Send(destination_id, std::move(data), DestinationType::kDirect, cacheable, response_functor,
+       race);
 }
 
-void Routing::Impl::SendGroup(const NodeId& destination_id, const std::string& data,
+void Routing::Impl::SendGroup(const NodeId& destination_id, std::string data,
                               bool cacheable, ResponseFunctor response_functor) {
   assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
          "Not allowed with typed Message API");
-  Send(destination_id, data, DestinationType::kGroup, cacheable, response_functor);
+  Send(destination_id, std::move(data), DestinationType::kGroup, cacheable, response_functor,
+       false);
+}
+
+void Routing::Impl::SendDirect(const NodeId& destination_id, std::string data, bool cacheable,
+                               SendMode send_mode, DeliveryFunctor delivery_functor) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  SendOneWay(destination_id, std::move(data), DestinationType::kDirect, cacheable, send_mode,
+             delivery_functor);
+}
+
+void Routing::Impl::SendGroup(const NodeId& destination_id, std::string data, bool cacheable,
+                              SendMode send_mode, DeliveryFunctor delivery_functor) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  SendOneWay(destination_id, std::move(data), DestinationType::kGroup, cacheable, send_mode,
+             delivery_functor);
+}
+
+std::future<std::vector<std::string>> Routing::Impl::SendGroup(const NodeId& destination_id,
+                                                               std::string data, bool cacheable,
+                                                               uint16_t quorum) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  LOG(kVerbose) << "Routing::Impl::SendGroup from " << DebugId(kNodeId_) << " to "
+                << DebugId(destination_id) << " for a quorum of " << quorum;
+  CheckSendParameters(destination_id, data);
+  const int kGroupSize(Parameters::group_size);
+  const uint32_t kRequestTag(RoutingMetrics::RequestTag(DestinationType::kGroup, data.size()));
+  protobuf::Message proto_message(
+      CreateNodeLevelPartialMessage(destination_id, DestinationType::kGroup, data, cacheable));
+  proto_message.set_id(timer_.NewTaskId());
+  SetDeadline(proto_message, Parameters::default_response_timeout);
+  auto responses(timer_.AddQuorumTask(Parameters::default_response_timeout,
+                                      quorum == 0 ? kGroupSize : std::min<int>(quorum, kGroupSize),
+                                      kGroupSize, proto_message.id(), kRequestTag));
+  SendMessage(destination_id, proto_message, false);
+  return responses;
+}
+
+void Routing::Impl::SendOneWay(const NodeId& destination_id, std::string data,
+                               const DestinationType& destination_type, bool cacheable,
+                               SendMode send_mode, DeliveryFunctor delivery_functor) {
+  LOG(kVerbose) << "Routing::Impl::SendOneWay from " << DebugId(kNodeId_)
+                << " to " << DebugId(destination_id);
+  CheckSendParameters(destination_id, data);
+  if (SendMode::kFireAndForget == send_mode) {
+    delivery_functor = nullptr;
+  } else if (!delivery_functor) {
+    LOG(kError) << "No delivery functor for delivery-acknowledged send, aborted send";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  protobuf::Message proto_message(
+      CreateNodeLevelPartialMessage(destination_id, destination_type, data, cacheable));
+  proto_message.set_id(0);
+  proto_message.set_one_way(true);
+  if (routing_table_.size() == 0) {  // Partial join state
+    PartiallyJoinedSend(proto_message, delivery_functor);
+    return;
+  }
+  PrepareToSend(proto_message);
+  if (kNodeId_ != destination_id || routing_table_.client_mode()) {
+    network_.SendToClosestNode(proto_message, delivery_functor);
+    return;
+  }
+  LOG(kInfo) << "Sending one-way message to self";
+  OnMessageReceived(proto_message.SerializeAsString());
+  if (delivery_functor)
+    asio_service_->service().post([delivery_functor] { delivery_functor(true); });
 }
 
-void Routing::Impl::Send(const NodeId& destination_id, const std::string& data,
+void Routing::Impl::Send(const NodeId& destination_id, std::string data,
                          const DestinationType& destination_type, bool cacheable,
-                         ResponseFunctor response_functor) {
+                         ResponseFunctor response_functor, bool race) {
   LOG(kVerbose) << "Routing::Impl::Send from " << DebugId(kNodeId_)
                 << " to " << DebugId(destination_id);
   CheckSendParameters(destination_id, data);
+  const uint32_t kRequestTag(RoutingMetrics::RequestTag(destination_type, data.size()));
   protobuf::Message proto_message =
       CreateNodeLevelPartialMessage(destination_id, destination_type, data, cacheable);
   uint16_t expected_response_count(1);
@@ -385,21 +795,130 @@ void Routing::Impl::Send(const NodeId& destination_id, const std::string& data,
     if (DestinationType::kGroup == destination_type)
       expected_response_count = 4;
     proto_message.set_id(timer_.NewTaskId());
+    SetDeadline(proto_message, Parameters::default_response_timeout);
     timer_.AddTask(Parameters::default_response_timeout, response_functor, expected_response_count,
-                   proto_message.id());
+                   proto_message.id(), kRequestTag);
   } else {
     proto_message.set_id(0);
+    proto_message.set_one_way(true);
+  }
+  SendMessage(destination_id, proto_message, race);
+}
+
+void Routing::Impl::SendStream(const NodeId& destination_id, std::string data,
+                               StreamSentFunctor stream_sent) {
+  if (destination_id.IsZero()) {
+    LOG(kError) << "Invalid destination ID, aborted stream";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_node_id));
+  }
+  if (data.empty() || data.size() > Parameters::max_stream_size) {
+    LOG(kError) << "Stream size not allowed : " << data.size();
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  const uint32_t kStreamId(RandomUint32());
+  auto send_fragment([this, destination_id, kStreamId](uint32_t index, uint32_t count,
+                                                       std::string fragment,
+                                                       ResponseFunctor acknowledged) {
+    protobuf::Message proto_message(CreateNodeLevelPartialMessage(
+        destination_id, DestinationType::kDirect, fragment, false));
+    proto_message.set_stream_id(kStreamId);
+    proto_message.set_fragment_index(index);
+    proto_message.set_fragment_count(count);
+    proto_message.set_id(timer_.NewTaskId());
+    SetDeadline(proto_message, Parameters::default_response_timeout);
+    timer_.AddTask(Parameters::default_response_timeout, acknowledged, 1, proto_message.id());
+    SendMessage(destination_id, proto_message);
+  });
+  std::shared_ptr<StreamSender> stream_sender(std::make_shared<StreamSender>(
+      std::move(data), std::min(Parameters::stream_fragment_size, Parameters::max_data_size),
+      Parameters::stream_window, Parameters::stream_fragment_attempts, send_fragment,
+      stream_sent));
+  LOG(kVerbose) << "Streaming " << stream_sender->fragment_count() << " fragments to "
+                << DebugId(destination_id);
+  stream_sender->Start();
+}
+
+void Routing::Impl::SendBatch(std::vector<BatchedMessage> messages) {
+  assert(!functors_.typed_message_and_caching.single_to_single.message_received &&
+         "Not allowed with typed Message API");
+  LOG(kVerbose) << "Routing::Impl::SendBatch from " << DebugId(kNodeId_) << " of "
+                << messages.size() << " messages";
+  int task_count(0);
+  for (const auto& message : messages) {
+    CheckSendParameters(message.destination_id, message.data);
+    if (message.response_functor)
+      ++task_count;
+  }
+  TaskId task_id(task_count == 0 ? 0 : timer_.NewTaskIds(task_count));
+  std::vector<Timer<std::string>::NewTask> tasks;
+  tasks.reserve(task_count);
+  std::vector<protobuf::Message> proto_messages(messages.size());
+  for (size_t i(0); i != messages.size(); ++i) {
+    BatchedMessage& message(messages[i]);
+    const uint32_t kRequestTag(RoutingMetrics::RequestTag(message.destination_type,
+                                                          message.data.size()));
+    protobuf::Message proto_message(CreateNodeLevelPartialMessage(
+        message.destination_id, message.destination_type, message.data, message.cacheable));
+    if (message.response_functor) {
+      proto_message.set_id(task_id);
+      SetDeadline(proto_message, Parameters::default_response_timeout);
+      tasks.emplace_back(task_id++, std::move(message.response_functor),
+                         DestinationType::kGroup == message.destination_type ? 4 : 1,
+                         kRequestTag);
+    } else {
+      proto_message.set_id(0);
+      proto_message.set_one_way(true);
+    }
+    proto_messages[i].Swap(&proto_message);
   }
-  SendMessage(destination_id, proto_message);
+  if (!tasks.empty())
+    timer_.AddTasks(Parameters::default_response_timeout, std::move(tasks));
+  SendMessages(std::move(proto_messages));
 }
 
-void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message& proto_message) {
+void Routing::Impl::SendMessages(std::vector<protobuf::Message> proto_messages) {
+  if (routing_table_.size() == 0) {  // Partial join state
+    for (auto& proto_message : proto_messages)
+      PartiallyJoinedSend(proto_message);
+    return;
+  }
+  std::vector<protobuf::Message> to_network;
+  to_network.reserve(proto_messages.size());
+  for (auto& proto_message : proto_messages) {
+    PrepareToSend(proto_message);
+    if (kNodeId_ != NodeId(proto_message.destination_id()) || routing_table_.client_mode()) {
+      to_network.push_back(protobuf::Message());
+      to_network.back().Swap(&proto_message);
+    } else {
+      LOG(kInfo) << "Sending request to self";
+      OnMessageReceived(proto_message.SerializeAsString());
+    }
+  }
+  network_.SendToClosestNodes(std::move(to_network));
+}
+
+void Routing::Impl::PrepareToSend(protobuf::Message& proto_message) {
+  proto_message.set_source_id(kNodeId_.string());
+  if (!proto_message.has_unique_id())
+    proto_message.set_unique_id(NewMessageId(kNodeId_));
+  if (Parameters::sign_node_level_messages && !proto_message.has_signature())
+    SignMessage(proto_message, routing_table_.kPrivateKey());
+  // The trace isn't signed, being added to at each hop.
+  if (!proto_message.has_path_trace() && SamplePathTrace())
+    proto_message.set_path_trace(std::string());
+}
+
+void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message& proto_message,
+                                bool race) {
   if (routing_table_.size() == 0) {  // Partial join state
     PartiallyJoinedSend(proto_message);
   } else {  // Normal node
-    proto_message.set_source_id(kNodeId_.string());
+    PrepareToSend(proto_message);
     if (kNodeId_ != destination_id) {
-      network_.SendToClosestNode(proto_message);
+      if (race)
+        network_.RaceToClosestNodes(proto_message, Parameters::race_send_width);
+      else
+        network_.SendToClosestNode(proto_message);
     } else if (routing_table_.client_mode()) {
       LOG(kVerbose) << "Client sending request to self id";
       network_.SendToClosestNode(proto_message);
@@ -411,7 +930,17 @@ void Routing::Impl::SendMessage(const NodeId& destination_id, protobuf::Message&
 }
 
 // Partial join state
-void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
+void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message,
+                                        DeliveryFunctor delivery_functor) {
+  if (Parameters::relay_retirement_threshold != 0 && proto_message.direct() &&
+      proto_message.id() != 0 && !proto_message.one_way()) {
+    const auto kNow(RoutingClock::now());
+    std::lock_guard<std::mutex> lock(relayed_requests_mutex_);
+    while (!relayed_requests_.empty() &&
+           relayed_requests_.front().first + Parameters::default_response_timeout < kNow)
+      relayed_requests_.pop_front();
+    relayed_requests_.push_back(std::make_pair(kNow, proto_message));
+  }
   proto_message.set_relay_id(kNodeId_.string());
   proto_message.set_relay_connection_id(network_.this_node_relay_connection_id().string());
   NodeId bootstrap_connection_id(network_.bootstrap_connection_id());
@@ -420,7 +949,7 @@ void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
-    asio_service_.service().post([=]() {
+    asio_service_->service().post(lifetime_guard_.Wrap([=]() {
       if (rudp::kSuccess != result) {
         if (proto_message.id() != 0) {
           try {
@@ -441,18 +970,46 @@ void Routing::Impl::PartiallyJoinedSend(protobuf::Message& proto_message) {
                       << " dst : " << HexSubstr(proto_message.destination_id())
                       << " --Partial-joined--";
       }
-    });
+      if (delivery_functor)
+        delivery_functor(rudp::kSuccess == result);
+    }));
   });
   network_.SendToDirect(proto_message, bootstrap_connection_id, message_sent);
 }
 
+void Routing::Impl::RetireRelay() {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  if (Parameters::relay_retirement_threshold == 0 ||
+      routing_table_.size() < Parameters::relay_retirement_threshold)
+    return;
+  std::deque<std::pair<std::chrono::steady_clock::time_point, protobuf::Message>> relayed_requests;
+  {
+    std::lock_guard<std::mutex> lock(relayed_requests_mutex_);
+    relayed_requests.swap(relayed_requests_);
+  }
+  // Replies to both copies are harmless: the Timer task takes the first and ignores the other.
+  const auto kNow(RoutingClock::now());
+  for (auto& relayed_request : relayed_requests) {
+    if (relayed_request.first + Parameters::default_response_timeout < kNow)
+      continue;
+    LOG(kVerbose) << "Retiring relay for request to "
+                  << HexSubstr(relayed_request.second.destination_id())
+                  << " id: " << relayed_request.second.id();
+    SendMessage(NodeId(relayed_request.second.destination_id()), relayed_request.second);
+  }
+}
+
 protobuf::Message Routing::Impl::CreateNodeLevelPartialMessage(
-    const NodeId& destination_id, const DestinationType& destination_type, const std::string& data,
+    const NodeId& destination_id, const DestinationType& destination_type, std::string& data,
     bool cacheable) {
   protobuf::Message proto_message;
   proto_message.set_destination_id(destination_id.string());
   proto_message.set_routing_message(false);
-  proto_message.add_data(data);
+  proto_message.add_data()->swap(data);
   proto_message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
   if (cacheable)
     proto_message.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
@@ -497,6 +1054,27 @@ GroupRangeStatus Routing::Impl::IsNodeIdInGroupRange(const NodeId& group_id,
   return routing_table_.IsNodeIdInGroupRange(group_id, node_id);
 }
 
+GroupRangeView Routing::Impl::GetGroupRangeView() const {
+  return routing_table_.GetGroupRangeView();
+}
+
+ResponsibilityRanges Routing::Impl::GetResponsibilityRanges() const {
+  std::lock_guard<std::mutex> lock(responsibility_ranges_mutex_);
+  return responsibility_ranges_;
+}
+
+void Routing::Impl::InvalidatePublicKey(const NodeId& node_id) {
+  public_key_cache_.Remove(node_id);
+}
+
+void Routing::Impl::UpdateResponsibilityRanges() {
+  // Held throughout so that concurrent matrix changes are diffed against each other in turn.
+  std::lock_guard<std::mutex> lock(responsibility_ranges_mutex_);
+  ResponsibilityRanges ranges(routing_table_.GetGroupRangeView().GetResponsibilityRanges());
+  SetRangeChanges(responsibility_ranges_, ranges);
+  responsibility_ranges_ = ranges;
+}
+
 NodeId Routing::Impl::RandomConnectedNode() { return routing_table_.RandomConnectedNode(); }
 
 bool Routing::Impl::EstimateInGroup(const NodeId& sender_id, const NodeId& info_id) {
@@ -507,7 +1085,13 @@ bool Routing::Impl::EstimateInGroup(const NodeId& sender_id, const NodeId& info_
 std::future<std::vector<NodeId>> Routing::Impl::GetGroup(const NodeId& group_id) {
   auto promise(std::make_shared<std::promise<std::vector<NodeId>>>());
   auto future(promise->get_future());
-  auto callback = [promise](const std::string & response) {
+  GroupCache* group_cache(routing_table_.client_mode() ? &group_cache_ : nullptr);
+  std::vector<NodeId> cached_group;
+  if (group_cache && group_cache->Get(group_id, cached_group)) {
+    promise->set_value(std::move(cached_group));
+    return std::move(future);
+  }
+  auto callback = [promise, group_cache, group_id](const std::string & response) mutable {
     std::vector<NodeId> nodes_id;
     if (!response.empty()) {
       protobuf::GetGroup get_group;
@@ -518,13 +1102,17 @@ std::future<std::vector<NodeId>> Routing::Impl::GetGroup(const NodeId& group_id)
         }
         catch (std::exception& ex) {
           LOG(kError) << "Failed to parse response of GetGroup : " << ex.what();
+          group_cache = nullptr;
         }
       }
     }
+    if (group_cache && !nodes_id.empty())
+      group_cache->Add(group_id, nodes_id);
     promise->set_value(nodes_id);
   };
   protobuf::Message get_group_message(rpcs::GetGroup(group_id, kNodeId_));
   get_group_message.set_id(timer_.NewTaskId());
+  SetDeadline(get_group_message, Parameters::default_response_timeout);
   timer_.AddTask(Parameters::default_response_timeout, callback, 1, get_group_message.id());
   network_.SendToClosestNode(get_group_message);
   return std::move(future);
@@ -532,19 +1120,123 @@ std::future<std::vector<NodeId>> Routing::Impl::GetGroup(const NodeId& group_id)
 
 void Routing::Impl::OnMessageReceived(const std::string& message) {
   std::lock_guard<std::mutex> lock(running_mutex_);
-  if (running_)
-    asio_service_.service().post([=]() { DoOnMessageReceived(message); });  // NOLINT (Fraser)
+  if (!running_)
+    return;
+  if (inbound_trace_)
+    inbound_trace_->RecordMessage(message);
+  if (IsMessageBatch(message)) {
+    // Unpacked here so that each message joins the queue for its own source.
+    std::vector<std::string> messages;
+    if (!ParseMessageBatch(message, messages)) {
+      LOG(kWarning) << "Message batch received, failed to parse";
+      return;
+    }
+    for (auto& batched_message : messages) {
+      if (IsMessageBatch(batched_message))  // batches are never nested
+        continue;
+      auto inbound_message(std::make_shared<InboundMessage>());
+      inbound_message->serialised.swap(batched_message);
+      DispatchMessage(inbound_message);
+    }
+    return;
+  }
+  // rudp only lends the datagram, so it is copied once here and then shared by however many
+  // copies of the handler asio makes.
+  auto inbound_message(std::make_shared<InboundMessage>());
+  inbound_message->serialised = message;
+  DispatchMessage(inbound_message);
+}
+
+void Routing::Impl::DispatchMessage(const std::shared_ptr<InboundMessage>& message) {
+  message->header_decoded = message->header.Decode(message->serialised);
+  if (message->header_decoded && message->header.has_path_trace)
+    message->received = RoutingClock::now();
+  if (message->header_decoded) {
+    network_.RecordReceived(message->header);
+    if (Parameters::auto_tune_table_size &&
+        message->header.destination_id == kNodeId_.string()) {
+      // hops_to_live is only decremented when a message is forwarded, so not on the first hop.
+      table_size_tuner_.RecordHops(Parameters::hops_to_live - message->header.hops_to_live + 1);
+    }
+  }
+  std::shared_ptr<const InboundMessage> inbound_message(message);
+  const MessageHeader& header(message->header);
+  const bool kRoutingMessage(header.routing_message && message->header_decoded);
+  const uint64_t kBytes(message->serialised.size());
+  // Routing's own messages keep the node joined, so are never shed.
+  if (!memory_budget_->Enqueue(kBytes, !kRoutingMessage)) {
+    LOG(kWarning) << "[" << DebugId(kNodeId_) << "] over hard memory budget; dropping message";
+    return;
+  }
+  std::function<void()> handler([=]() {
+    memory_budget_->Dequeue(kBytes);
+    DoOnMessageReceived(*inbound_message);
+  });
+  if (kRoutingMessage) {
+    inbound_dispatcher_.PostControl(lifetime_guard_.Wrap(handler));
+    return;
+  }
+  // Undecodable messages share the empty key; they are dropped when they fail to parse.
+  std::string key;
+  if (message->header_decoded)
+    key = header.has_source_id ? header.source_id : header.relay_id;
+  if (!inbound_dispatcher_.Post(key, lifetime_guard_.Wrap(handler))) {
+    memory_budget_->Dequeue(kBytes);
+    LOG(kWarning) << "[" << DebugId(kNodeId_) << "] inbound queue full; dropping message from "
+                  << HexSubstr(key);
+  }
 }
 
-void Routing::Impl::DoOnMessageReceived(const std::string& message) {
-  protobuf::Message pb_message;
+void Routing::Impl::DoOnMessageReceived(const InboundMessage& inbound_message) {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_)
+      return;
+  }
+  const std::string& message(inbound_message.serialised);
+  const MessageHeader& header(inbound_message.header);
+  RoutingMetrics& metrics(network_.metrics());
+  const int32_t kType(inbound_message.header_decoded ? header.type : 0);
+  metrics.Add(RoutingMetrics::kReceived, kType);
+  metrics.Add(RoutingMetrics::kBytesReceived, kType, message.size());
+  // The origin has stopped waiting for an expired message, so it isn't worth parsing.
+  if (inbound_message.header_decoded && header.has_deadline && DeadlinePassed(header.deadline)) {
+    metrics.Add(RoutingMetrics::kDroppedExpired, kType);
+    LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] dropping expired message to "
+                  << HexSubstr(header.destination_id) << "   (id: " << header.id << ")";
+    return;
+  }
+  if (inbound_message.header_decoded && header.has_unique_id &&
+      !duplicate_filter_.Insert(DuplicateKey(header.unique_id, header.destination_id,
+                                             header.request, header.visited))) {
+    metrics.Add(RoutingMetrics::kDroppedDuplicate, kType);
+    LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] dropping duplicate message to "
+                  << HexSubstr(header.destination_id) << "   (id: " << header.id << ")";
+    return;
+  }
+  if (inbound_message.header_decoded && message_handler_->ForwardAsFarNode(header, message))
+    return;
+
+  MessagePool::Pointer parsed_message(MessagePool::Acquire());
+  protobuf::Message& pb_message(*parsed_message);
   if (pb_message.ParseFromString(message)) {
+    UpgradeRouteHistory(pb_message);
+    if (pb_message.has_path_trace()) {
+      const auto kQueueDelay(RoutingClock::now() - inbound_message.received);
+      AddPathTraceHop(pb_message, kNodeId_, std::chrono::system_clock::now() -
+                          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                              kQueueDelay), kQueueDelay);
+    }
     bool relay_message(!pb_message.has_source_id());
-    LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] rcvd : " << MessageTypeString(pb_message)
-                  << " from " << (relay_message ? HexSubstr(pb_message.relay_id())
-                                                : HexSubstr(pb_message.source_id())) << " to "
-                  << HexSubstr(pb_message.destination_id()) << "   (id: " << pb_message.id() << ")"
-                  << (relay_message ? " --Relay--" : "");
+    ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kReceived, pb_message,
+                  relay_message ? pb_message.relay_id() : pb_message.source_id());
+    if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+      LOG(kVerbose) << "   [" << DebugId(kNodeId_) << "] rcvd : " << MessageTypeString(pb_message)
+                    << " from " << (relay_message ? HexSubstr(pb_message.relay_id())
+                                                  : HexSubstr(pb_message.source_id())) << " to "
+                    << HexSubstr(pb_message.destination_id()) << "   (id: " << pb_message.id()
+                    << ")" << (relay_message ? " --Relay--" : "");
+    }
     if ((!pb_message.client_node() && pb_message.has_source_id()) ||
         (!pb_message.direct() && !pb_message.request())) {
       NodeId source_id(pb_message.source_id());
@@ -556,17 +1248,169 @@ void Routing::Impl::DoOnMessageReceived(const std::string& message) {
       if (!running_)
         return;
     }
-    message_handler_->HandleMessage(pb_message);
+    // Only messages which this node may act on are uncompressed and verified, not those it merely
+    // passes on.
+    const bool kActsOn(pb_message.destination_id() == kNodeId_.string() ||
+                       routing_table_.IsThisNodeInRange(NodeId(pb_message.destination_id()),
+                                                        Parameters::group_size) ||
+                       client_routing_table_.Contains(NodeId(pb_message.destination_id())));
+    if (kActsOn && !UncompressData(pb_message))
+      return;
+    if (signature_verifier_ && IsNodeLevelMessage(pb_message) && pb_message.has_source_id() &&
+        kActsOn) {
+      VerifyThenHandle(pb_message);
+    } else {
+      // Unless verified, nothing vouches for the other senders of a merged group reply.
+      if (kActsOn) {
+        pb_message.clear_aggregated_source_ids();
+        pb_message.clear_aggregated_signatures();
+      }
+      message_handler_->HandleMessage(pb_message);
+    }
   } else {
     LOG(kWarning) << "Message received, failed to parse";
+    metrics.Add(RoutingMetrics::kDroppedInvalid, kType);
   }
 }
 
+void Routing::Impl::VerifyThenHandle(protobuf::Message& message) {
+  std::shared_ptr<protobuf::Message> verified_message(MessagePool::AcquireShared());
+  verified_message->Swap(&message);
+  const NodeId kSourceId(verified_message->source_id());
+  auto verify_others([this, verified_message](bool valid) {
+    if (!valid) {
+      LOG(kWarning) << "[" << DebugId(kNodeId_) << "] dropping message from "
+                    << HexSubstr(verified_message->source_id()) << " with an invalid signature"
+                    << "   (id: " << verified_message->id() << ")";
+      return;
+    }
+    VerifyAggregatedThenHandle(verified_message);
+  });
+  bool has_key(WithPublicKey(
+      kSourceId, [this, verified_message, verify_others](const asymm::PublicKey& public_key) {
+        signature_verifier_->Verify(SignedContent(*verified_message), verified_message->signature(),
+                                    public_key, verify_others);
+      }));
+  if (!has_key) {
+    LOG(kWarning) << "[" << DebugId(kNodeId_) << "] no public key to verify message from "
+                  << DebugId(kSourceId) << "; dropping it.";
+  }
+}
+
+void Routing::Impl::VerifyAggregatedThenHandle(const std::shared_ptr<protobuf::Message>& message) {
+  // Each other sender is checked once, and no more are kept than could answer a group request.
+  typedef std::pair<std::string, std::string> Sender;  // source ID and signature
+  auto others(std::make_shared<std::vector<Sender>>());
+  std::set<std::string> seen;
+  seen.insert(message->source_id());
+  const int kCount(
+      std::min(message->aggregated_source_ids_size(), message->aggregated_signatures_size()));
+  for (int i(0); i != kCount && seen.size() < Parameters::group_size; ++i) {
+    const std::string& kOtherId(message->aggregated_source_ids(i));
+    if (seen.insert(kOtherId).second)
+      others->push_back(Sender(kOtherId, message->aggregated_signatures(i)));
+  }
+  message->clear_aggregated_source_ids();
+  message->clear_aggregated_signatures();
+  if (others->empty())
+    return HandleVerified(message);
+
+  auto valid(std::make_shared<std::vector<char>>(others->size(), 0));
+  auto remaining(std::make_shared<std::atomic<size_t>>(others->size()));
+  for (size_t i(0); i != others->size(); ++i) {
+    std::function<void(bool)> done([this, message, others, valid, remaining, i](bool is_valid) {
+      (*valid)[i] = is_valid;
+      if (--*remaining != 0)
+        return;
+      for (size_t j(0); j != others->size(); ++j) {
+        if (!(*valid)[j])
+          continue;
+        message->add_aggregated_source_ids((*others)[j].first);
+        message->add_aggregated_signatures((*others)[j].second);
+      }
+      HandleVerified(message);
+    });
+    const Sender kSender((*others)[i]);
+    bool has_key(WithPublicKey(
+        NodeId(kSender.first), [this, message, kSender, done](const asymm::PublicKey& public_key) {
+          signature_verifier_->Verify(SignedContent(*message, kSender.first), kSender.second,
+                                      public_key, done);
+        }));
+    if (!has_key)
+      done(false);
+  }
+}
+
+void Routing::Impl::HandleVerified(const std::shared_ptr<protobuf::Message>& message) {
+  // Results arrive in the order verification was asked for, and posting each to its source's
+  // shard keeps that order through to the handler.
+  std::function<void()> handle([this, message]() {
+    {
+      std::lock_guard<std::mutex> lock(running_mutex_);
+      if (!running_)
+        return;
+    }
+    message_handler_->HandleMessage(*message);
+  });
+  bool posted(inbound_dispatcher_.Post(message->source_id(), lifetime_guard_.Wrap(handle)));
+  if (!posted)
+    LOG(kWarning) << "[" << DebugId(kNodeId_) << "] inbound queue full; dropping message.";
+}
+
+bool Routing::Impl::WithPublicKey(const NodeId& node_id,
+                                  const std::function<void(const asymm::PublicKey&)>& functor) {
+  NodeInfo node_info;
+  if (routing_table_.GetNodeInfo(node_id, node_info)) {
+    functor(node_info.public_key);
+    return true;
+  }
+  auto client_nodes(client_routing_table_.GetNodesInfo(node_id));
+  if (!client_nodes.empty()) {
+    functor(client_nodes.front().public_key);
+    return true;
+  }
+  if (!functors_.request_public_key)
+    return false;
+  RequestPublicKey(node_id, [this, functor](asymm::PublicKey public_key) {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (running_)
+      functor(public_key);
+  });
+  return true;
+}
+
 void Routing::Impl::OnConnectionLost(const NodeId& lost_connection_id) {
   std::lock_guard<std::mutex> lock(running_mutex_);
-  if (running_)
-    asio_service_.service().post([=]() { DoOnConnectionLost(lost_connection_id); });  // NOLINT
-                                                                                      // (Fraser)
+  if (!running_)
+    return;
+  if (inbound_trace_)
+    inbound_trace_->RecordConnectionLost(lost_connection_id);
+  inbound_dispatcher_.PostControl(
+      lifetime_guard_.Wrap([=]() { DoOnConnectionLost(lost_connection_id); }));  // NOLINT
+}
+
+MemoryStatistics Routing::Impl::GetMemoryStatistics() const {
+  MemoryStatistics statistics;
+  statistics.bytes[MemoryStatistics::kRoutingTable] = routing_table_.MemoryBytes();
+  statistics.bytes[MemoryStatistics::kClientRoutingTable] = client_routing_table_.MemoryBytes();
+  statistics.bytes[MemoryStatistics::kGroupMatrix] = routing_table_.GroupMatrixMemoryBytes();
+  statistics.bytes[MemoryStatistics::kPublicKeys] =
+      SharedPublicKey::InternedCount() * kPublicKeyBytes;
+  statistics.bytes[MemoryStatistics::kTimerTasks] = timer_.MemoryBytes();
+  statistics.bytes[MemoryStatistics::kCache] = message_handler_->CachedBytes();
+  memory_budget_->FillStatistics(statistics);
+  return statistics;
+}
+
+void Routing::Impl::RecordInboundTrace(const boost::filesystem::path& path) {
+  std::shared_ptr<InboundTraceRecorder> recorder;
+  if (!path.empty())
+    recorder = std::make_shared<InboundTraceRecorder>(path, Parameters::inbound_trace_buffer_size);
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    inbound_trace_.swap(recorder);
+  }
+  // The previous recorder, if any, finishes writing here rather than under running_mutex_.
 }
 
 void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
@@ -578,6 +1422,8 @@ void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
       return;
   }
 
+  // A shortcut's peer may since have joined a routing table over the same connection.
+  const bool kShortcut(network_.shortcuts().Remove(lost_connection_id));
   NodeInfo dropped_node;
   bool resend(
       routing_table_.GetNodeInfo(lost_connection_id, dropped_node) &&
@@ -613,6 +1459,9 @@ void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
 
       if (routing_table_.size() == 0)
         resend = true;  // This will trigger rebootstrap
+    } else if (kShortcut) {
+      LOG(kInfo) << "[" << DebugId(kNodeId_) << "]"
+                 << "Lost shortcut connection " << DebugId(lost_connection_id);
     } else {
       LOG(kWarning) << "[" << DebugId(kNodeId_) << "]"
                     << "Lost connection with unknown/internal connection id "
@@ -626,11 +1475,70 @@ void Routing::Impl::DoOnConnectionLost(const NodeId& lost_connection_id) {
       return;
     // Close node lost, get more nodes
     LOG(kWarning) << "Lost close node, getting more.";
+    if (!dropped_node.node_id.IsZero())
+      ConnectToStandby();
     recovery_timer_.expires_from_now(Parameters::recovery_time_lag);
-    recovery_timer_.async_wait([=](const boost::system::error_code &error_code) {
-      if (error_code != boost::asio::error::operation_aborted)
-        ReSendFindNodeRequest(error_code, true);
-    });
+    recovery_timer_.async_wait(
+        lifetime_guard_.Wrap([=](const boost::system::error_code &error_code) {
+          if (error_code != boost::asio::error::operation_aborted)
+            ReSendFindNodeRequest(error_code, true);
+        }));
+  }
+}
+
+void Routing::Impl::DoOnSuspectedDead(const NodeId& connection_id) {
+  NodeInfo node;
+  if (!routing_table_.GetNodeInfo(connection_id, node))
+    return;
+  LOG(kWarning) << "[" << DebugId(kNodeId_) << "] dropping unresponsive node "
+                << DebugId(node.node_id);
+  // rudp may yet report the loss itself, by which time the node is gone from the routing table.
+  network_.Remove(connection_id);
+  DoOnConnectionLost(connection_id);
+}
+
+void Routing::Impl::DoOnPeerLeft(const NodeId& leaver_id,
+                                 const std::vector<NodeId>& replacement_ids) {
+  NodeInfo node;
+  if (!routing_table_.GetNodeInfo(leaver_id, node)) {
+    auto clients(client_routing_table_.GetNodesInfo(leaver_id));
+    if (clients.empty())
+      return;
+    node = clients.front();
+  }
+  LOG(kInfo) << "[" << DebugId(kNodeId_) << "] dropping leaving node " << DebugId(leaver_id);
+  network_.Remove(node.connection_id);
+  DoOnConnectionLost(node.connection_id);
+  if (!replacement_ids.empty())
+    message_handler_->SendConnectRequests(replacement_ids);
+}
+
+void Routing::Impl::Leave() {
+  {
+    std::lock_guard<std::mutex> lock(running_mutex_);
+    if (!running_ || left_)
+      return;
+    left_ = true;
+  }
+  std::vector<NodeInfo> recipients;
+  const std::vector<NodeId> kCloseIds(
+      routing_table_.GetClosestNodes(kNodeId_, Parameters::closest_nodes_size));
+  for (const auto& close_id : kCloseIds) {
+    NodeInfo close_node;
+    if (routing_table_.GetNodeInfo(close_id, close_node))
+      recipients.push_back(close_node);
+  }
+  auto clients(client_routing_table_.nodes());
+  recipients.insert(recipients.end(), clients.begin(), clients.end());
+  // A client is in no one's close group, so has no replacements to suggest.
+  const std::vector<NodeId> kReplacementIds(routing_table_.client_mode() ? std::vector<NodeId>()
+                                                                         : kCloseIds);
+  LOG(kInfo) << "[" << DebugId(kNodeId_) << "] leaving, telling " << recipients.size()
+             << " peers";
+  for (const auto& recipient : recipients) {
+    network_.SendToDirect(rpcs::Leave(recipient.node_id, kNodeId_, kReplacementIds,
+                                      routing_table_.client_mode()),
+                          recipient.node_id, recipient.connection_id);
   }
 }
 
@@ -658,11 +1566,13 @@ void Routing::Impl::RemoveNode(const NodeInfo& node, bool internal_rudp_only) {
     // Close node removed by routing, get more nodes
     LOG(kWarning) << "[" << DebugId(kNodeId_)
                   << "] Removed close node, sending find node to get more nodes.";
+    ConnectToStandby();
     recovery_timer_.expires_from_now(Parameters::recovery_time_lag);
-    recovery_timer_.async_wait([=](const boost::system::error_code & error_code) {
-      if (error_code != boost::asio::error::operation_aborted)
-        ReSendFindNodeRequest(error_code, true);
-    });
+    recovery_timer_.async_wait(
+        lifetime_guard_.Wrap([=](const boost::system::error_code & error_code) {
+          if (error_code != boost::asio::error::operation_aborted)
+            ReSendFindNodeRequest(error_code, true);
+        }));
   }
 }
 
@@ -677,6 +1587,11 @@ void Routing::Impl::ReSendFindNodeRequest(const boost::system::error_code& error
     if (error_code == boost::asio::error::operation_aborted || !running_)
       return;
   }
+  {
+    // The join they were kept for is over.
+    std::lock_guard<std::mutex> lock(warm_peers_mutex_);
+    warm_peers_.clear();
+  }
 
   if (routing_table_.size() == 0) {
     LOG(kError) << "[" << DebugId(kNodeId_) << "]'s' Routing table is empty."
@@ -698,20 +1613,119 @@ void Routing::Impl::ReSendFindNodeRequest(const boost::system::error_code& error
     if (ignore_size && (routing_table_.size() > routing_table_.kThresholdSize()))
       num_nodes_requested = static_cast<int>(Parameters::closest_nodes_size);
     else
-      num_nodes_requested = static_cast<int>(Parameters::greedy_fraction);
+      num_nodes_requested = static_cast<int>(routing_table_.kGreedyFraction());
 
     protobuf::Message find_node_rpc(rpcs::FindNodes(kNodeId_, kNodeId_, num_nodes_requested));
+    network_.pending_requests().Add(find_node_rpc);
     network_.SendToClosestNode(find_node_rpc);
+    StartLookup(routing_table_.GetClosestNodes(kNodeId_, Parameters::closest_nodes_size));
 
     std::lock_guard<std::mutex> lock(running_mutex_);
     if (!running_)
       return;
     recovery_timer_.expires_from_now(Parameters::find_node_interval);
-    recovery_timer_.async_wait([=](boost::system::error_code error_code_local) {
-      if (error_code != boost::asio::error::operation_aborted)
-        ReSendFindNodeRequest(error_code_local, false);
-    });
+    recovery_timer_.async_wait(
+        lifetime_guard_.Wrap([=](boost::system::error_code error_code_local) {
+          if (error_code != boost::asio::error::operation_aborted)
+            ReSendFindNodeRequest(error_code_local, false);
+        }));
+  }
+}
+
+void Routing::Impl::StartLookup(const std::vector<NodeId>& seeds) {
+  if (Parameters::find_nodes_alpha == 0)
+    return;
+  std::unique_lock<std::mutex> lock(lookup_mutex_);
+  lookup_.reset(new IterativeLookup(kNodeId_, kNodeId_, Parameters::closest_nodes_size,
+                                    Parameters::find_nodes_alpha));
+  lookup_->AddCandidates(seeds);
+  ContinueLookup(lock);
+}
+
+void Routing::Impl::HandleFindNodesResponse(const NodeId& responder,
+                                            const std::vector<NodeId>& nodes) {
+  AddStandbyNodes(nodes);
+  std::unique_lock<std::mutex> lock(lookup_mutex_);
+  if (!lookup_)
+    return;
+  lookup_->HandleResponse(responder, nodes);
+  ContinueLookup(lock);
+}
+
+void Routing::Impl::AddStandbyNodes(const std::vector<NodeId>& node_ids) {
+  if (Parameters::standby_cache_size == 0 || routing_table_.client_mode())
+    return;
+  std::vector<NodeId> candidates;
+  for (const auto& node_id : node_ids) {
+    if (!routing_table_.Contains(node_id))
+      candidates.push_back(node_id);
   }
+  auto added(standby_cache_.Add(candidates));
+  if (!added.empty())
+    message_handler_->PrefetchPublicKeys(added);
+}
+
+void Routing::Impl::ConnectToStandby() {
+  if (Parameters::standby_cache_size == 0 || routing_table_.client_mode())
+    return;
+  auto standby(standby_cache_.Take(1, [this](const NodeId& node_id) {
+    return !routing_table_.Contains(node_id);
+  }));
+  if (standby.empty())
+    return;
+  LOG(kInfo) << "[" << DebugId(kNodeId_) << "] connecting to standby " << DebugId(standby.front())
+             << " in place of lost close node.";
+  message_handler_->SendConnectRequests(standby);
+}
+
+void Routing::Impl::OnLookupTimeout(const boost::system::error_code& error_code) {
+  if (error_code == boost::asio::error::operation_aborted)
+    return;
+  std::unique_lock<std::mutex> lock(lookup_mutex_);
+  if (!lookup_)
+    return;
+  lookup_->ExpireQueries(RoutingClock::now() - Parameters::find_nodes_query_timeout);
+  ContinueLookup(lock);
+}
+
+void Routing::Impl::ContinueLookup(std::unique_lock<std::mutex>& lock) {
+  assert(lock.owns_lock());
+  if (lookup_->Done()) {
+    LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] lookup settled on "
+                  << lookup_->Closest().size() << " closest nodes.";
+    lookup_.reset();
+    return;
+  }
+  auto queries(lookup_->NextQueries(RoutingClock::now()));
+  lock.unlock();
+  if (queries.empty())
+    return;
+
+  // Until this node is in a peer's routing table, its queries are relayed by the bootstrap peer.
+  bool relay(routing_table_.size() == 0);
+  for (const auto& peer : queries) {
+    protobuf::Message find_node_rpc(
+        rpcs::FindNodes(kNodeId_, kNodeId_, Parameters::closest_nodes_size, relay,
+                        network_.this_node_relay_connection_id()));
+    find_node_rpc.set_destination_id(peer.string());
+    find_node_rpc.set_direct(true);
+    network_.pending_requests().Add(find_node_rpc);
+    LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] lookup querying " << DebugId(peer)
+                  << "   (id: " << find_node_rpc.id() << ")";
+    if (relay)
+      network_.SendToDirect(find_node_rpc, network_.bootstrap_connection_id(),
+                            rudp::MessageSentFunctor());
+    else
+      network_.SendToClosestNode(find_node_rpc);
+  }
+
+  std::lock_guard<std::mutex> running_lock(running_mutex_);
+  if (!running_)
+    return;
+  lookup_timer_.expires_from_now(Parameters::find_nodes_query_timeout);
+  lookup_timer_.async_wait(lifetime_guard_.Wrap([=](const boost::system::error_code& error_code) {
+    OnLookupTimeout(error_code);
+  }));
 }
 
 void Routing::Impl::ReBootstrap() {
@@ -719,10 +1733,11 @@ void Routing::Impl::ReBootstrap() {
   if (!running_)
     return;
   re_bootstrap_timer_.expires_from_now(Parameters::re_bootstrap_time_lag);
-  re_bootstrap_timer_.async_wait([=](boost::system::error_code error_code_local) {
-    if (error_code_local != boost::asio::error::operation_aborted)
-      DoReBootstrap(error_code_local);
-  });
+  re_bootstrap_timer_.async_wait(
+      lifetime_guard_.Wrap([=](boost::system::error_code error_code_local) {
+        if (error_code_local != boost::asio::error::operation_aborted)
+          DoReBootstrap(error_code_local);
+      }));
 }
 
 void Routing::Impl::DoReBootstrap(const boost::system::error_code& error_code) {
@@ -740,9 +1755,8 @@ void Routing::Impl::DoReBootstrap(const boost::system::error_code& error_code) {
   DoJoin(BootstrapContacts());
 }
 
-void Routing::Impl::NotifyNetworkStatus(int return_code) const {
-  if (functors_.network_status)
-    functors_.network_status(return_code);
+void Routing::Impl::NotifyNetworkStatus(int return_code) {
+  notifications_.PostNetworkStatus(return_code, functors_.network_status);
 }
 
 NodeId Routing::Impl::kNodeId() const { return kNodeId_; }
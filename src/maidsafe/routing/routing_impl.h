@@ -19,13 +19,17 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_IMPL_H_
 #define MAIDSAFE_ROUTING_ROUTING_IMPL_H_
 
+#include <chrono>
+#include <deque>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "boost/asio/steady_timer.hpp"
 #include "boost/asio/ip/udp.hpp"
+#include "boost/filesystem/path.hpp"
 #include "boost/system/error_code.hpp"
 
 #include "maidsafe/common/asio_service.h"
@@ -34,61 +38,37 @@
 #include "maidsafe/common/rsa.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/application_queue.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/core_executors.h"
+#include "maidsafe/routing/duplicate_filter.h"
+#include "maidsafe/routing/group_cache.h"
 #include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/inbound_dispatcher.h"
+#include "maidsafe/routing/inbound_trace.h"
+#include "maidsafe/routing/iterative_lookup.h"
+#include "maidsafe/routing/lifetime_guard.h"
+#include "maidsafe/routing/memory_budget.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_traits.h"
 #include "maidsafe/routing/network_utils.h"
+#include "maidsafe/routing/notification_executor.h"
+#include "maidsafe/routing/public_key_cache.h"
 #include "maidsafe/routing/random_node_helper.h"
 #include "maidsafe/routing/remove_furthest_node.h"
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
 #include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/signature_verifier.h"
+#include "maidsafe/routing/standby_cache.h"
+#include "maidsafe/routing/table_size_tuner.h"
 #include "maidsafe/routing/timer.h"
 
 namespace maidsafe {
 
 namespace routing {
 
-namespace detail {
-
-// Group Source
-template <typename Messsage>
-struct is_group_source;
-
-template <typename Messsage>
-struct is_group_source : public std::true_type {};
-
-template <>
-struct is_group_source<SingleToSingleMessage> : public std::false_type {};
-template <>
-struct is_group_source<SingleToGroupMessage> : public std::false_type {};
-template <>
-struct is_group_source<GroupToSingleMessage> : public std::true_type {};
-template <>
-struct is_group_source<GroupToGroupMessage> : public std::true_type {};
-template <>
-struct is_group_source<GroupToSingleRelayMessage> : public std::true_type {};
-
-// Group Destination
-template <typename Messsage>
-struct is_group_destination;
-
-template <typename Messsage>
-struct is_group_destination : public std::true_type {};
-
-template <>
-struct is_group_destination<SingleToSingleMessage> : public std::false_type {};
-template <>
-struct is_group_destination<SingleToGroupMessage> : public std::true_type {};
-template <>
-struct is_group_destination<GroupToSingleMessage> : public std::false_type {};
-template <>
-struct is_group_destination<GroupToGroupMessage> : public std::true_type {};
-template <>
-struct is_group_destination<GroupToSingleRelayMessage> : public std::false_type {};
-
-}  // namespace detail
-
 //  class MessageHandler;
 struct NodeInfo;
 
@@ -98,24 +78,45 @@ class GenericNode;
 
 class Routing::Impl {
  public:
-  Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys);
+  // |asio_service| is shared with other Impls if non-null, otherwise one is created for this node.
+  Impl(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
+       std::shared_ptr<AsioService> asio_service, const NodeParameters& node_parameters);
   ~Impl();
 
   void Join(const Functors& functors,
-            const BootstrapContacts& bootstrap_contacts = BootstrapContacts());
+            const BootstrapContacts& bootstrap_contacts = BootstrapContacts(),
+            const std::string& routing_table_snapshot = std::string());
 
   int ZeroStateJoin(const Functors& functors, const boost::asio::ip::udp::endpoint& local_endpoint,
                     const boost::asio::ip::udp::endpoint& peer_endpoint, const NodeInfo& peer_info);
 
+  // The payload is taken by value throughout, so that a caller which moves it in isn't charged a
+  // copy before it is serialised.
   template <typename T>
-  void Send(const T& message);  // New API
+  void Send(T message, bool race);  // New API
 
-  void SendDirect(const NodeId& destination_id, const std::string& data, bool cacheable,
-                  ResponseFunctor response_functor);
+  void SendDirect(const NodeId& destination_id, std::string data, bool cacheable,
+                  ResponseFunctor response_functor, bool race);
 
-  void SendGroup(const NodeId& destination_id, const std::string& data, bool cacheable,
+  void SendGroup(const NodeId& destination_id, std::string data, bool cacheable,
                  ResponseFunctor response_functor);
 
+  void SendDirect(const NodeId& destination_id, std::string data, bool cacheable,
+                  SendMode send_mode, DeliveryFunctor delivery_functor);
+
+  void SendGroup(const NodeId& destination_id, std::string data, bool cacheable,
+                 SendMode send_mode, DeliveryFunctor delivery_functor);
+
+  std::future<std::vector<std::string>> SendGroup(const NodeId& destination_id, std::string data,
+                                                  bool cacheable, uint16_t quorum);
+
+  void SendBatch(std::vector<BatchedMessage> messages);
+
+  template <typename T>
+  void SendBatch(std::vector<T> messages);
+
+  void SendStream(const NodeId& destination_id, std::string data, StreamSentFunctor stream_sent);
+
   NodeId GetRandomExistingNode() const { return random_node_helper_.Get(); }
 
   bool ClosestToId(const NodeId& node_id);
@@ -124,6 +125,12 @@ class Routing::Impl {
 
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id);
 
+  GroupRangeView GetGroupRangeView() const;
+
+  ResponsibilityRanges GetResponsibilityRanges() const;
+
+  void InvalidatePublicKey(const NodeId& node_id);
+
   NodeId RandomConnectedNode();
 
   bool EstimateInGroup(const NodeId& sender_id, const NodeId& info_id);
@@ -136,9 +143,29 @@ class Routing::Impl {
 
   std::vector<NodeInfo> ClosestNodes();
 
+  std::vector<size_t> InboundQueueDepths() const { return inbound_dispatcher_.QueueDepths(); }
+
+  std::vector<ReceivedMessage> ReceiveMessages(size_t max_count,
+                                               std::chrono::milliseconds timeout) {
+    return application_queue_ ? application_queue_->Take(max_count, timeout)
+                              : std::vector<ReceivedMessage>();
+  }
+
+  CacheStatistics GetCacheStatistics() const { return message_handler_->GetCacheStatistics(); }
+  RoutingStatistics GetStatistics() { return network_.metrics().Snapshot(); }
+  TableTuningStatistics GetTableTuningStatistics() const {
+    return table_size_tuner_.Statistics();
+  }
+  MemoryStatistics GetMemoryStatistics() const;
+
+  void RecordInboundTrace(const boost::filesystem::path& path);
+
   bool IsConnectedVault(const NodeId& node_id);
   bool IsConnectedClient(const NodeId& node_id);
 
+  // Tells this node's close nodes and clients it is leaving, once only.  Also done on destruction.
+  void Leave();
+
   friend class test::GenericNode;
 
  private:
@@ -147,6 +174,24 @@ class Routing::Impl {
   Impl& operator=(const Impl&);
 
   void ConnectFunctors(const Functors& functors);
+  // Keeps the peers in |routing_table_snapshot| to reconnect to, returning |bootstrap_contacts|
+  // with theirs put first.
+  BootstrapContacts LoadSnapshot(const std::string& routing_table_snapshot,
+                                 const BootstrapContacts& bootstrap_contacts);
+  std::vector<NodeId> WarmPeerIds() const;
+  bool GetWarmPublicKey(const NodeId& node_id, asymm::PublicKey& public_key) const;
+  // Gives |node_id|'s key from the snapshot or public_key_cache_ if held there, otherwise asks
+  // functors_.request_public_key for it and caches the answer.
+  void RequestPublicKey(const NodeId& node_id, GivePublicKeyFunctor give_key);
+  void ScheduleSnapshot();
+  // Every Parameters::auto_tune_interval, moves the routing table's removal watermarks to the
+  // target table_size_tuner_ chooses.
+  void ScheduleTableTuning();
+  // Every Parameters::memory_check_interval, weighs the bytes held against the memory budgets and
+  // shrinks or restores the chunk cache to suit.
+  void ScheduleMemoryCheck();
+  // Fires functors_.routing_table_snapshot, unless the routing table is empty.
+  void PublishSnapshot();
   void BootstrapFromTheseEndpoints(const BootstrapContacts& bootstrap_contacts);
   void DoJoin(const BootstrapContacts& bootstrap_contacts);
   int DoBootstrap(const BootstrapContacts& bootstrap_contacts);
@@ -154,25 +199,77 @@ class Routing::Impl {
   void DoReBootstrap(const boost::system::error_code& error_code);
   void FindClosestNode(const boost::system::error_code& error_code, int attempts);
   void ReSendFindNodeRequest(const boost::system::error_code& error_code, bool ignore_size);
+  // Starts an iterative lookup of this node's closest nodes seeded with |seeds|, replacing any
+  // already running.  When joining there are no seeds; the first FindNodes response gives them.
+  void StartLookup(const std::vector<NodeId>& seeds);
+  void HandleFindNodesResponse(const NodeId& responder, const std::vector<NodeId>& nodes);
+  void OnLookupTimeout(const boost::system::error_code& error_code);
+  // Sends the queries lookup_ is ready for, or ends the lookup once its closest nodes are settled.
+  void ContinueLookup(std::unique_lock<std::mutex>& lock);
+  // Caches those of |node_ids| not in the routing table as standbys, prefetching their keys.
+  void AddStandbyNodes(const std::vector<NodeId>& node_ids);
+  // Connects at once to the closest standby not yet in the routing table, after a close node loss.
+  void ConnectToStandby();
+  // Recomputes responsibility_ranges_, with the IDs gained and lost since it was last computed.
+  void UpdateResponsibilityRanges();
+  // A received message, with its header if that could be decoded.
+  struct InboundMessage {
+    std::string serialised;
+    MessageHeader header;
+    bool header_decoded;
+    std::chrono::steady_clock::time_point received;  // only for sampled messages
+  };
+
   void OnMessageReceived(const std::string& message);
-  void DoOnMessageReceived(const std::string& message);
+  // Queues |message| on the dispatch shard for its source, or the control shard for routing
+  // messages.
+  void DispatchMessage(const std::shared_ptr<InboundMessage>& message);
+  void DoOnMessageReceived(const InboundMessage& message);
+  // Takes the contents of |message|, which is handled once its signature has been verified.
+  void VerifyThenHandle(protobuf::Message& message);
+  // Drops those other senders of a merged group reply whose signatures don't check out, then
+  // handles |message|.
+  void VerifyAggregatedThenHandle(const std::shared_ptr<protobuf::Message>& message);
+  void HandleVerified(const std::shared_ptr<protobuf::Message>& message);
+  // Gives |functor| the public key of |node_id|, now or once asked for; false if it can't be had.
+  bool WithPublicKey(const NodeId& node_id,
+                     const std::function<void(const asymm::PublicKey&)>& functor);
   void OnConnectionLost(const NodeId& lost_connection_id);
   void DoOnConnectionLost(const NodeId& lost_connection_id);
+  // Drops a routing table peer which hasn't answered a liveness probe, as though rudp had lost it.
+  void DoOnSuspectedDead(const NodeId& connection_id);
+  // Drops |leaver_id| as though rudp had lost it, and connects to those of |replacement_ids| the
+  // routing table would accept in its place.
+  void DoOnPeerLeft(const NodeId& leaver_id, const std::vector<NodeId>& replacement_ids);
   void RemoveNode(const NodeInfo& node, bool internal_rudp_only);
   bool ConfirmGroupMembers(const NodeId& node1, const NodeId& node2);
-  void NotifyNetworkStatus(int return_code) const;
-  void Send(const NodeId& destination_id, const std::string& data,
+  void NotifyNetworkStatus(int return_code);
+  void Send(const NodeId& destination_id, std::string data,
             const DestinationType& destination_type, bool cacheable,
-            ResponseFunctor response_functor);
-  void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message);
-  void PartiallyJoinedSend(protobuf::Message& proto_message);
+            ResponseFunctor response_functor, bool race);
+  // Sends a message no reply is wanted for, keeping no Timer task for it.
+  void SendOneWay(const NodeId& destination_id, std::string data,
+                  const DestinationType& destination_type, bool cacheable, SendMode send_mode,
+                  DeliveryFunctor delivery_functor);
+  void SendMessage(const NodeId& destination_id, protobuf::Message& proto_message,
+                   bool race = false);
+  // As SendMessage for each of |proto_messages|, to its destination ID.
+  void SendMessages(std::vector<protobuf::Message> proto_messages);
+  // Stamps this node's ID, a unique ID and, if enabled, a signature on an outgoing message.
+  void PrepareToSend(protobuf::Message& proto_message);
+  void PartiallyJoinedSend(protobuf::Message& proto_message,
+                           DeliveryFunctor delivery_functor = DeliveryFunctor());
+  // Resends over the routing table the relayed direct requests which may still be awaiting replies,
+  // once the table holds Parameters::relay_retirement_threshold peers.
+  void RetireRelay();
+  // Leaves |data| empty.
   protobuf::Message CreateNodeLevelPartialMessage(const NodeId& destination_id,
                                                   const DestinationType& destination_type,
-                                                  const std::string& data, bool cacheable);
+                                                  std::string& data, bool cacheable);
   void CheckSendParameters(const NodeId& destination_id, const std::string& data);
 
   template <typename T>
-  protobuf::Message CreateNodeLevelMessage(const T& message);
+  protobuf::Message CreateNodeLevelMessage(T message);
   template <typename T>
   void AddGroupSourceRelatedFields(const T& message, protobuf::Message& proto_message,
                                    std::true_type);
@@ -189,35 +286,82 @@ class Routing::Impl {
   RoutingTable routing_table_;
   const NodeId kNodeId_;
   bool running_;
+  bool left_;  // guarded by running_mutex_
   std::mutex running_mutex_;
+  // Revoked once stopping, after which handlers still queued on a shared asio service do nothing.
+  LifetimeGuard lifetime_guard_;
+  // Guarded by running_mutex_; null unless RecordInboundTrace is recording.
+  std::shared_ptr<InboundTraceRecorder> inbound_trace_;
   Functors functors_;
+  // Runs functors_.network_status and functors_.matrix_changed, off the routing threads.
+  NotificationExecutor notifications_;
+  std::shared_ptr<ApplicationQueue> application_queue_;  // null unless application_queue_size set
   RandomNodeHelper random_node_helper_;
   ClientRoutingTable client_routing_table_;
   RemoveFurthestNode remove_furthest_node_;
   GroupChangeHandler group_change_handler_;
+  DuplicateFilter duplicate_filter_;
+  std::unique_ptr<SignatureVerifier> signature_verifier_;  // null unless verify_signatures is set
+  std::mutex lookup_mutex_;
+  std::unique_ptr<IterativeLookup> lookup_;  // null unless a lookup is running
+  mutable std::mutex warm_peers_mutex_;
+  // From the snapshot Join was given, until the recovery loop starts.
+  std::vector<NodeInfo> warm_peers_;
+  PublicKeyCache public_key_cache_;
+  StandbyCache standby_cache_;
+  mutable std::mutex responsibility_ranges_mutex_;
+  ResponsibilityRanges responsibility_ranges_;  // as of the last matrix change
+  TableSizeTuner table_size_tuner_;
+  const uint16_t kRemovalWatermarkGap_;  // kept between the tuned watermarks
+  // Shared with the Service, which refuses clients over the soft budget.
+  std::shared_ptr<MemoryBudget> memory_budget_;
+  std::mutex relayed_requests_mutex_;
+  // Direct requests sent through the bootstrap relay, with the time each was sent.
+  std::deque<std::pair<std::chrono::steady_clock::time_point, protobuf::Message>>
+      relayed_requests_;
+  // Outlives the timer, whose GetGroup tasks fill it.
+  GroupCache group_cache_;
   // The following variables' declarations should remain the last ones in this class and should stay
   // in the order: message_handler_, asio_service_, network_, all timers.  This is important for the
   // proper destruction of the routing library, i.e. to avoid segmentation faults.
   std::unique_ptr<MessageHandler> message_handler_;
-  AsioService asio_service_;
+  // Only stopped on destruction if no other node shares it.
+  std::shared_ptr<AsioService> asio_service_;
   NetworkUtils network_;
   Timer<std::string> timer_;
-  boost::asio::steady_timer re_bootstrap_timer_, recovery_timer_, setup_timer_;
+  RoutingTimer re_bootstrap_timer_, recovery_timer_, setup_timer_, lookup_timer_,
+      snapshot_timer_, tuning_timer_, memory_timer_;
+  // Null unless Parameters::dispatch_cores is set; runs inbound_dispatcher_'s data shards.
+  std::unique_ptr<CoreExecutors> core_executors_;
+  InboundDispatcher inbound_dispatcher_;
 };
 
 template <>
-void Routing::Impl::Send(const GroupToSingleRelayMessage& message);
+void Routing::Impl::Send(GroupToSingleRelayMessage message, bool race);
 
 template <>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const GroupToSingleRelayMessage& message);
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(GroupToSingleRelayMessage message);
 
 // Implementations
 template <typename T>
-void Routing::Impl::Send(const T& message) {  // FIXME(Fix caching)
+void Routing::Impl::Send(T message, bool race) {  // FIXME(Fix caching)
+  assert(!functors_.message_and_caching.message_received &&
+         "Not allowed with string type message API");
+  auto receiver(message.receiver);
+  protobuf::Message proto_message = CreateNodeLevelMessage(std::move(message));
+  SendMessage(receiver, proto_message, race);
+}
+
+template <typename T>
+void Routing::Impl::SendBatch(std::vector<T> messages) {
   assert(!functors_.message_and_caching.message_received &&
          "Not allowed with string type message API");
-  protobuf::Message proto_message = CreateNodeLevelMessage(message);
-  SendMessage(message.receiver, proto_message);
+  std::vector<protobuf::Message> proto_messages(messages.size());
+  for (size_t i(0); i != messages.size(); ++i) {
+    protobuf::Message proto_message(CreateNodeLevelMessage(std::move(messages[i])));
+    proto_messages[i].Swap(&proto_message);
+  }
+  SendMessages(std::move(proto_messages));
 }
 
 template <typename T>
@@ -231,11 +375,11 @@ template <typename T>
 void Routing::Impl::AddGroupSourceRelatedFields(const T&, protobuf::Message&, std::false_type) {}
 
 template <typename T>
-protobuf::Message Routing::Impl::CreateNodeLevelMessage(const T& message) {
+protobuf::Message Routing::Impl::CreateNodeLevelMessage(T message) {
   protobuf::Message proto_message;
   proto_message.set_destination_id(message.receiver->string());
   proto_message.set_routing_message(false);
-  proto_message.add_data(message.contents);
+  proto_message.add_data()->swap(message.contents);
   proto_message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
 
   proto_message.set_cacheable(static_cast<int32_t>(message.cacheable));
@@ -0,0 +1,241 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/routing_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <thread>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const int kSubBuckets(1 << LatencyHistogram::kSubBucketBits);
+
+}  // unnamed namespace
+
+// Bound to references, so need definitions.
+const int LatencyHistogram::kSubBucketBits;
+const int LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() : count(0), buckets() {}
+
+int LatencyHistogram::BucketIndex(std::chrono::microseconds latency) {
+  if (latency.count() < kSubBuckets)
+    return latency.count() < 0 ? 0 : static_cast<int>(latency.count());
+  const uint64_t kValue(static_cast<uint64_t>(latency.count()));
+  int top_bit(kSubBucketBits);
+  while (top_bit < 63 && (kValue >> (top_bit + 1)) != 0)
+    ++top_bit;
+  const int kIndex((top_bit - kSubBucketBits + 1) * kSubBuckets +
+                   static_cast<int>((kValue >> (top_bit - kSubBucketBits)) & (kSubBuckets - 1)));
+  return std::min(kIndex, kBucketCount - 1);
+}
+
+std::chrono::microseconds LatencyHistogram::BucketUpperBound(int index) {
+  if (index < kSubBuckets)
+    return std::chrono::microseconds(index);
+  const int kShift(index / kSubBuckets - 1);
+  const int64_t kLowest(static_cast<int64_t>(kSubBuckets + index % kSubBuckets) << kShift);
+  return std::chrono::microseconds(kLowest + (int64_t(1) << kShift) - 1);
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double percent) const {
+  if (count == 0)
+    return std::chrono::microseconds(0);
+  // Nearest rank, allowing for e.g. 99.9% of 1000 not being exactly 999 in floating point
+  const uint64_t kRank(std::max(
+      uint64_t(1), static_cast<uint64_t>(std::ceil(percent / 100.0 * count - 1e-9))));
+  uint64_t seen(0);
+  for (int index(0); index != kBucketCount; ++index) {
+    seen += buckets[index];
+    if (seen >= kRank)
+      return BucketUpperBound(index);
+  }
+  return BucketUpperBound(kBucketCount - 1);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  count += other.count;
+  for (int index(0); index != kBucketCount; ++index)
+    buckets[index] += other.buckets[index];
+}
+
+void MessageTypeCounters::Merge(const MessageTypeCounters& other) {
+  received += other.received;
+  bytes_received += other.bytes_received;
+  dropped_duplicate += other.dropped_duplicate;
+  dropped_hops_to_live += other.dropped_hops_to_live;
+  dropped_expired += other.dropped_expired;
+  dropped_invalid += other.dropped_invalid;
+  handled_locally += other.handled_locally;
+  forwarded += other.forwarded;
+  sent += other.sent;
+  bytes_sent += other.bytes_sent;
+  send_failures += other.send_failures;
+}
+
+const int RoutingStatistics::kRequestSizeClassCount;
+
+int RoutingStatistics::RequestSizeClass(size_t data_size) {
+  if (data_size <= 1024)
+    return 0;
+  if (data_size <= 16 * 1024)
+    return 1;
+  return data_size <= 256 * 1024 ? 2 : 3;
+}
+
+void RequestStatistics::Merge(const RequestStatistics& other) {
+  completed += other.completed;
+  timed_out += other.timed_out;
+  timed_out_partially_answered += other.timed_out_partially_answered;
+  cancelled += other.cancelled;
+  responses += other.responses;
+  expected_responses += other.expected_responses;
+  completion_latency.Merge(other.completion_latency);
+}
+
+const int RoutingMetrics::kTypeSlots;
+const int RoutingMetrics::kShardCount;
+const int32_t RoutingMetrics::kNodeLevelType;
+
+RoutingMetrics::Shard::Shard() {
+  for (auto& type_counters : counters) {
+    for (auto& counter : type_counters)
+      counter.store(0, std::memory_order_relaxed);
+  }
+  for (auto& bucket : latency_buckets)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+RoutingMetrics::RequestCounters::RequestCounters() {
+  for (auto* counter : {&completed, &timed_out, &timed_out_partially_answered, &cancelled,
+                        &responses, &expected_responses})
+    counter->store(0, std::memory_order_relaxed);
+  for (auto& bucket : latency_buckets)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+RoutingMetrics::RoutingMetrics() : shards_(), requests_() {}
+
+RoutingMetrics::Shard& RoutingMetrics::ShardForThisThread() {
+  return shards_[std::hash<std::thread::id>()(std::this_thread::get_id()) % kShardCount];
+}
+
+void RoutingMetrics::RecordResponseLatency(std::chrono::steady_clock::duration latency) {
+  ShardForThisThread().latency_buckets[LatencyHistogram::BucketIndex(
+      std::chrono::duration_cast<std::chrono::microseconds>(latency))].fetch_add(
+          1, std::memory_order_relaxed);
+}
+
+uint32_t RoutingMetrics::RequestTag(DestinationType destination_type, size_t data_size) {
+  const int kGroupOffset(destination_type == DestinationType::kGroup ?
+                         RoutingStatistics::kRequestSizeClassCount : 0);
+  return static_cast<uint32_t>(kGroupOffset + RoutingStatistics::RequestSizeClass(data_size) + 1);
+}
+
+void RoutingMetrics::RecordRequestOutcome(const TaskOutcome& outcome) {
+  if (outcome.tag == 0 || outcome.tag > 2 * RoutingStatistics::kRequestSizeClassCount)
+    return;
+  RequestCounters& counters(requests_[outcome.tag - 1]);
+  switch (outcome.ending) {
+    case TaskOutcome::kCompleted:
+      counters.completed.fetch_add(1, std::memory_order_relaxed);
+      counters.latency_buckets[LatencyHistogram::BucketIndex(
+          std::chrono::duration_cast<std::chrono::microseconds>(outcome.elapsed))].fetch_add(
+              1, std::memory_order_relaxed);
+      break;
+    case TaskOutcome::kTimedOut:
+      counters.timed_out.fetch_add(1, std::memory_order_relaxed);
+      if (outcome.response_count != 0)
+        counters.timed_out_partially_answered.fetch_add(1, std::memory_order_relaxed);
+      break;
+    case TaskOutcome::kCancelled:
+      counters.cancelled.fetch_add(1, std::memory_order_relaxed);
+      break;
+  }
+  counters.responses.fetch_add(outcome.response_count, std::memory_order_relaxed);
+  counters.expected_responses.fetch_add(outcome.expected_response_count,
+                                        std::memory_order_relaxed);
+}
+
+RoutingStatistics RoutingMetrics::Snapshot() const {
+  RoutingStatistics statistics;
+  for (int slot(0); slot != kTypeSlots; ++slot) {
+    uint64_t totals[kCounterCount] = {};
+    for (const auto& shard : shards_) {
+      for (int counter(0); counter != kCounterCount; ++counter)
+        totals[counter] += shard.counters[slot][counter].load(std::memory_order_relaxed);
+    }
+    if (std::all_of(std::begin(totals), std::end(totals), [](uint64_t total) {
+          return total == 0;
+        }))
+      continue;
+    MessageTypeCounters& type_counters(statistics.by_type[SlotType(slot)]);
+    type_counters.received = totals[kReceived];
+    type_counters.bytes_received = totals[kBytesReceived];
+    type_counters.dropped_duplicate = totals[kDroppedDuplicate];
+    type_counters.dropped_hops_to_live = totals[kDroppedHopsToLive];
+    type_counters.dropped_expired = totals[kDroppedExpired];
+    type_counters.dropped_invalid = totals[kDroppedInvalid];
+    type_counters.handled_locally = totals[kHandledLocally];
+    type_counters.forwarded = totals[kForwarded];
+    type_counters.sent = totals[kSent];
+    type_counters.bytes_sent = totals[kBytesSent];
+    type_counters.send_failures = totals[kSendFailures];
+  }
+  LatencyHistogram& latency(statistics.response_latency);
+  for (const auto& shard : shards_) {
+    for (int index(0); index != LatencyHistogram::kBucketCount; ++index) {
+      const uint64_t kCount(shard.latency_buckets[index].load(std::memory_order_relaxed));
+      latency.buckets[index] += kCount;
+      latency.count += kCount;
+    }
+  }
+  for (int i(0); i != 2 * RoutingStatistics::kRequestSizeClassCount; ++i) {
+    const RequestCounters& counters(requests_[i]);
+    RequestStatistics& requests(i < RoutingStatistics::kRequestSizeClassCount ?
+        statistics.direct_requests[i] :
+        statistics.group_requests[i - RoutingStatistics::kRequestSizeClassCount]);
+    requests.completed = counters.completed.load(std::memory_order_relaxed);
+    requests.timed_out = counters.timed_out.load(std::memory_order_relaxed);
+    requests.timed_out_partially_answered =
+        counters.timed_out_partially_answered.load(std::memory_order_relaxed);
+    requests.cancelled = counters.cancelled.load(std::memory_order_relaxed);
+    requests.responses = counters.responses.load(std::memory_order_relaxed);
+    requests.expected_responses = counters.expected_responses.load(std::memory_order_relaxed);
+    for (int index(0); index != LatencyHistogram::kBucketCount; ++index) {
+      const uint64_t kCount(counters.latency_buckets[index].load(std::memory_order_relaxed));
+      requests.completion_latency.buckets[index] = kCount;
+      requests.completion_latency.count += kCount;
+    }
+  }
+#ifdef MAIDSAFE_ROUTING_LOCK_PROFILING
+  statistics.locks = LockProfiler::Snapshot();
+#endif
+  return statistics;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,105 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTING_METRICS_H_
+#define MAIDSAFE_ROUTING_ROUTING_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/timer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Counts the messages a node handles, for Routing::GetStatistics.  Updates are relaxed atomic
+// adds to one of a few shards picked by the calling thread, so threads seldom share a cache line
+// and nothing is locked; Snapshot merges the shards.
+class RoutingMetrics {
+ public:
+  enum Counter {
+    kReceived = 0,
+    kBytesReceived,
+    kDroppedDuplicate,
+    kDroppedHopsToLive,
+    kDroppedExpired,
+    kDroppedInvalid,
+    kHandledLocally,
+    kForwarded,
+    kSent,
+    kBytesSent,
+    kSendFailures,
+    kCounterCount
+  };
+
+  RoutingMetrics();
+  void Add(Counter counter, int32_t message_type, uint64_t amount = 1) {
+    ShardForThisThread().counters[TypeSlot(message_type)][counter].fetch_add(
+        amount, std::memory_order_relaxed);
+  }
+  void RecordResponseLatency(std::chrono::steady_clock::duration latency);
+  // The Timer tag under which a request's outcome is recorded by RecordRequestOutcome.
+  static uint32_t RequestTag(DestinationType destination_type, size_t data_size);
+  // Ignores tasks not tagged by RequestTag.
+  void RecordRequestOutcome(const TaskOutcome& outcome);
+  RoutingStatistics Snapshot() const;
+
+ private:
+  // Slot 0 is for unknown types, 1 to 8 for routing's own and the last for node-level messages.
+  static const int kTypeSlots = 10;
+  static const int kShardCount = 8;
+
+  struct Shard {
+    Shard();
+    std::atomic<uint64_t> counters[kTypeSlots][kCounterCount];
+    std::atomic<uint64_t> latency_buckets[LatencyHistogram::kBucketCount];
+  };
+
+  // Requests complete far less often than messages pass, so these aren't sharded.
+  struct RequestCounters {
+    RequestCounters();
+    std::atomic<uint64_t> completed, timed_out, timed_out_partially_answered, cancelled,
+        responses, expected_responses;
+    std::atomic<uint64_t> latency_buckets[LatencyHistogram::kBucketCount];
+  };
+
+  RoutingMetrics(const RoutingMetrics&);
+  RoutingMetrics& operator=(const RoutingMetrics&);
+
+  static int TypeSlot(int32_t message_type) {
+    if (message_type > 0 && message_type < kTypeSlots - 1)
+      return message_type;
+    return message_type == kNodeLevelType ? kTypeSlots - 1 : 0;
+  }
+  static int32_t SlotType(int slot) { return slot == kTypeSlots - 1 ? kNodeLevelType : slot; }
+  Shard& ShardForThisThread();
+
+  static const int32_t kNodeLevelType = 101;
+  Shard shards_[kShardCount];
+  // Direct then group, by size class; tag 0 is left for tasks which aren't requests.
+  RequestCounters requests_[2 * RoutingStatistics::kRequestSizeClassCount];
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTING_METRICS_H_
@@ -19,63 +19,120 @@
 #include "maidsafe/routing/routing_table.h"
 
 #include <algorithm>
-#include <bitset>
 #include <limits>
 #include <map>
 
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/tools/network_viewer.h"
 
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/memory_budget.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
+#include "maidsafe/routing/trace.h"
+#include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
 namespace routing {
 
+namespace {
+
+// How often a pending group change's deadline is checked under virtual time, which can't be waited
+// for directly.
+const std::chrono::milliseconds kVirtualTimePollInterval(10);
+
+bool SameNodeIds(const std::vector<NodeInfo>& lhs, const std::vector<NodeInfo>& rhs) {
+  return lhs.size() == rhs.size() &&
+         std::equal(std::begin(lhs), std::end(lhs), std::begin(rhs),
+                    [](const NodeInfo& lhs, const NodeInfo& rhs) {
+                      return lhs.node_id == rhs.node_id;
+                    });
+}
+
+}  // unnamed namespace
+
 RoutingTable::RoutingTable(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
-                           NetworkStatistics& network_statistics)
+                           NetworkStatistics& network_statistics,
+                           const NodeParameters& node_parameters)
     : kClientMode_(client_mode),
       kNodeId_(node_id),
       kConnectionId_(kClientMode_ ? NodeId(NodeId::kRandomId) : kNodeId_),
       kKeys_(keys),
-      kMaxSize_(kClientMode_ ? Parameters::max_routing_table_size_for_client
-                             : Parameters::max_routing_table_size),
-      kThresholdSize_(kClientMode_ ? Parameters::max_routing_table_size_for_client
-                                   : Parameters::routing_table_size_threshold),
-      mutex_(),
+      kMaxSize_(kClientMode_ ? node_parameters.max_routing_table_size_for_client
+                             : node_parameters.max_routing_table_size),
+      kThresholdSize_(kClientMode_ ? node_parameters.max_routing_table_size_for_client
+                                   : node_parameters.routing_table_size_threshold),
+      kGreedyFraction_(kClientMode_ ? node_parameters.max_routing_table_size_for_client
+                                    : node_parameters.greedy_fraction),
+      removal_high_watermark_(node_parameters.removal_high_watermark),
+      removal_low_watermark_(node_parameters.removal_low_watermark),
+      mutex_("RoutingTable::mutex_"),
       furthest_closest_node_id_((NodeId(NodeId::kMaxId) ^ node_id)),
+      furthest_client_range_node_id_((NodeId(NodeId::kMaxId) ^ node_id)),
       remove_node_functor_(),
       network_status_functor_(),
       remove_furthest_node_(),
       connected_group_change_functor_(),
       nodes_(),
+      hot_entries_(),
+      node_index_(),
+      public_key_fingerprints_(),
+      snapshot_(std::make_shared<Snapshot>()),
+      routes_version_(0),
       group_matrix_(kNodeId_, client_mode),
+      group_memo_(),
       ipc_message_queue_(),
-      network_statistics_(network_statistics) {
-#ifdef TESTING
-  try {
-    ipc_message_queue_.reset(new boost::interprocess::message_queue(
-        boost::interprocess::open_only, network_viewer::kMessageQueueName.c_str()));
-    if (static_cast<uint16_t>(ipc_message_queue_->get_max_msg_size()) <
-        (Parameters::closest_nodes_size + 1) * Parameters::closest_nodes_size * 2 * NodeId::kSize) {
-      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
-    }
-  }
-  catch (const std::exception&) {
-    ipc_message_queue_.reset();
+      network_statistics_(network_statistics),
+      network_coordinates_(),
+      table_summaries_(),
+      ipc_mutex_(),
+      ipc_cond_var_(),
+      ipc_matrix_changed_(false),
+      ipc_stop_(false),
+      ipc_publisher_(),
+      ipc_sent_row_(),
+      ipc_sequence_(0),
+      ipc_updates_since_snapshot_(Parameters::matrix_snapshot_period),
+      group_change_mutex_(),
+      group_change_fire_mutex_(),
+      group_change_cond_var_(),
+      pending_group_change_(),
+      group_change_stop_(false),
+      group_change_notifier_(),
+      evicted_mutex_(),
+      evicted_(),
+      route_quality_() {
+  {
+    std::unique_lock<HotPathMutex> lock(mutex_);
+    PublishSnapshot(lock);
   }
-#endif
 }
 
 RoutingTable::~RoutingTable() {
+  {
+    std::lock_guard<std::mutex> lock(group_change_mutex_);
+    group_change_stop_ = true;
+  }
+  group_change_cond_var_.notify_one();
+  if (group_change_notifier_.joinable())
+    group_change_notifier_.join();
+  {
+    // Once stopped, IpcSendGroupMatrix no longer starts the publisher.
+    std::lock_guard<std::mutex> lock(ipc_mutex_);
+    ipc_stop_ = true;
+  }
+  ipc_cond_var_.notify_one();
+  if (ipc_publisher_.joinable())
+    ipc_publisher_.join();
   if (ipc_message_queue_) {
-    network_viewer::MatrixRecord matrix_record(kNodeId_);
-    std::string serialised_matrix(matrix_record.Serialise());
-    ipc_message_queue_->try_send(serialised_matrix.c_str(), serialised_matrix.size(), 0);
+    std::string serialised_update(LeftMatrixUpdate(kNodeId_, ++ipc_sequence_).Serialise());
+    ipc_message_queue_->try_send(serialised_update.c_str(), serialised_update.size(), 0);
   }
 }
 
@@ -108,6 +165,90 @@ bool RoutingTable::AddNode(const NodeInfo& peer,
   return AddOrCheckNode(peer, true, matrix_update);
 }
 
+size_t RoutingTable::AddNodes(const std::vector<NodeInfo>& peers) {
+  std::vector<NodeInfo> candidates;
+  for (auto peer : peers) {
+    if (peer.node_id.IsZero() || peer.node_id == kNodeId_) {
+      LOG(kError) << "Attempt to add an invalid node " << DebugId(peer.node_id);
+      continue;
+    }
+    if (!asymm::ValidateKey(peer.public_key)) {
+      LOG(kInfo) << "Invalid public key for node " << DebugId(peer.node_id);
+      continue;
+    }
+    SetBucketIndex(peer);
+    candidates.push_back(peer);
+  }
+
+  std::vector<NodeInfo> added_nodes, removed_nodes;
+  std::vector<NodeInfo> new_connected_close_nodes, old_connected_close_nodes;
+  std::shared_ptr<MatrixChange> matrix_change;
+  std::vector<NodeId> unique_nodes;
+  uint16_t routing_table_size(0);
+  {
+    std::unique_lock<HotPathMutex> lock(mutex_);
+    for (const auto& peer : candidates) {
+      if (Find(peer.node_id, lock).first) {
+        LOG(kVerbose) << "Node " << DebugId(peer.node_id) << " already in routing table.";
+        continue;
+      }
+      NodeInfo removed_node;
+      if (!MakeSpaceForNodeToBeAdded(peer, true, removed_node, lock))
+        continue;
+      if (!removed_node.node_id.IsZero()) {
+        auto itr(std::find_if(added_nodes.begin(), added_nodes.end(),
+                              [&removed_node](const NodeInfo & node_info) {
+          return node_info.node_id == removed_node.node_id;
+        }));
+        if (itr != added_nodes.end())
+          added_nodes.erase(itr);
+        else
+          removed_nodes.push_back(removed_node);
+      }
+      InsertNode(peer, lock);
+      added_nodes.push_back(peer);
+    }
+    if (added_nodes.empty())
+      return 0;
+
+    std::vector<NodeId> removed_ids;
+    for (const auto& removed_node : removed_nodes)
+      removed_ids.push_back(removed_node.node_id);
+    old_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    matrix_change = group_matrix_.UpdateConnectedPeers(GetCloseNodesToConnect(lock), removed_ids);
+    InvalidateGroupMemo(matrix_change, lock);
+    new_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    UpdateCloseGroup(lock);
+    PublishSnapshot(lock);
+    routing_table_size = static_cast<uint16_t>(nodes_.size());
+    unique_nodes = group_matrix_.GetUniqueNodeIds();
+  }
+
+  UpdateNetworkStatus(routing_table_size);
+  for (const auto& removed_node : removed_nodes) {
+    LOG(kVerbose) << "Routing table removed node id : " << DebugId(removed_node.node_id)
+                  << ", connection id : " << DebugId(removed_node.connection_id);
+    if (remove_node_functor_)
+      remove_node_functor_(removed_node, false);
+  }
+
+  if (!matrix_change->OldEqualsToNew()) {
+    network_statistics_.UpdateLocalAverageDistance(unique_nodes);
+    IpcSendGroupMatrix();
+  }
+  NotifyGroupChange(matrix_change, new_connected_close_nodes, old_connected_close_nodes);
+
+  if (routing_table_size > kGreedyFraction_) {
+    LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Removing furthest node....";
+    if (remove_furthest_node_)
+      remove_furthest_node_();
+  }
+  if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+    LOG(kInfo) << PrintRoutingTable();
+  }
+  return added_nodes.size();
+}
+
 bool RoutingTable::CheckNode(const NodeInfo& peer) { return AddOrCheckNode(peer, false); }
 
 bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
@@ -120,6 +261,10 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
     LOG(kInfo) << "Invalid public key for node " << DebugId(peer.node_id);
     return false;
   }
+  if (!remove && RecentlyEvicted(peer.node_id)) {
+    LOG(kVerbose) << "Node " << DebugId(peer.node_id) << " was evicted too recently to reconnect.";
+    return false;
+  }
 
   bool return_value(false), remove_furthest_node(false);
   std::vector<NodeInfo> new_connected_close_nodes, old_connected_close_nodes;
@@ -131,7 +276,7 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
     SetBucketIndex(peer);
   std::vector<NodeId> unique_nodes;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<HotPathMutex> lock(mutex_);
     auto found(Find(peer.node_id, lock));
     if (found.first) {
       LOG(kVerbose) << "Node " << DebugId(peer.node_id) << " already in routing table.";
@@ -141,15 +286,14 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
     if (MakeSpaceForNodeToBeAdded(peer, remove, removed_node, lock)) {
       if (remove) {
         assert(peer.bucket != NodeInfo::kInvalidBucket);
-        nodes_.push_back(peer);
+        InsertNode(peer, lock);
         old_connected_close_nodes = group_matrix_.GetConnectedPeers();
         matrix_change = UpdateCloseNodeChange(lock, peer, new_connected_close_nodes, matrix_update);
-        if (nodes_.size() > Parameters::greedy_fraction)
+        InvalidateGroupMemo(matrix_change, lock);
+        if (nodes_.size() > removal_high_watermark_)
           remove_furthest_node = true;
-        if (nodes_.size() >= Parameters::closest_nodes_size) {
-          NthElementSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
-          furthest_closest_node_id_ = nodes_[Parameters::closest_nodes_size - 1].node_id;
-        }
+        UpdateCloseGroup(lock);
+        PublishSnapshot(lock);
       }
       return_value = true;
     }
@@ -167,14 +311,11 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
         remove_node_functor_(removed_node, false);
     }
 
-    UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
-
     if ((matrix_change != nullptr) && !matrix_change->OldEqualsToNew()) {
       network_statistics_.UpdateLocalAverageDistance(unique_nodes);
-      if (matrix_change_functor_)
-        matrix_change_functor_(matrix_change);
       IpcSendGroupMatrix();
     }
+    NotifyGroupChange(matrix_change, new_connected_close_nodes, old_connected_close_nodes);
 
     if (peer.nat_type == rudp::NatType::kOther) {  // Usable as bootstrap endpoint
                                                    // if (new_bootstrap_endpoint_)
@@ -185,7 +326,9 @@ bool RoutingTable::AddOrCheckNode(NodeInfo peer, bool remove,
       if (remove_furthest_node_)
         remove_furthest_node_();
     }
-    LOG(kInfo) << PrintRoutingTable();
+    if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+      LOG(kInfo) << PrintRoutingTable();
+    }
   }
   return return_value;
 }
@@ -196,36 +339,35 @@ NodeInfo RoutingTable::DropNode(const NodeId& node_to_drop, bool routing_only) {
   std::shared_ptr<MatrixChange> matrix_change;
   std::vector<NodeId> unique_nodes;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<HotPathMutex> lock(mutex_);
     auto found(Find(node_to_drop, lock));
     if (found.first) {
       dropped_node = *found.second;
-      nodes_.erase(found.second);
+      network_statistics_.RemovePeer(dropped_node.node_id);
+      table_summaries_.Remove(dropped_node.node_id);
+      EraseNode(found.second, lock);
       old_connected_close_nodes = group_matrix_.GetConnectedPeers();
       matrix_change = group_matrix_.RemoveConnectedPeer(dropped_node);
+      InvalidateGroupMemo(matrix_change, lock);
       new_connected_close_nodes = group_matrix_.GetConnectedPeers();
       if (new_connected_close_nodes.size() != old_connected_close_nodes.size()) {
         if (nodes_.size() >= Parameters::closest_nodes_size) {
-          PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
-          furthest_closest_node_id_ = nodes_[Parameters::closest_nodes_size - 1].node_id;
-          group_matrix_.AddConnectedPeer(nodes_[Parameters::closest_nodes_size - 1]);
+          InvalidateGroupMemo(
+              group_matrix_.AddConnectedPeer(nodes_[Parameters::closest_nodes_size - 1]), lock);
           new_connected_close_nodes = group_matrix_.GetConnectedPeers();
-        } else {
-          furthest_closest_node_id_ = (NodeId(NodeId::kMaxId) ^ kNodeId_);
         }
       }
+      UpdateCloseGroup(lock);
+      PublishSnapshot(lock);
     }
     unique_nodes = group_matrix_.GetUniqueNodeIds();
   }
 
-  UpdateConnectedPeersMatrix(new_connected_close_nodes, old_connected_close_nodes);
-
   if ((matrix_change != nullptr) && !matrix_change->OldEqualsToNew()) {
     network_statistics_.UpdateLocalAverageDistance(unique_nodes);
-    if (matrix_change_functor_)
-      matrix_change_functor_(matrix_change);
     IpcSendGroupMatrix();
   }
+  NotifyGroupChange(matrix_change, new_connected_close_nodes, old_connected_close_nodes);
 
   if (!dropped_node.node_id.IsZero()) {
     assert(nodes_.size() <= std::numeric_limits<uint16_t>::max());
@@ -239,17 +381,72 @@ NodeInfo RoutingTable::DropNode(const NodeId& node_to_drop, bool routing_only) {
     if (remove_node_functor_ && !routing_only)
       remove_node_functor_(dropped_node, false);
   }
-  LOG(kInfo) << PrintRoutingTable();
+  if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+    LOG(kInfo) << PrintRoutingTable();
+  }
   return dropped_node;
 }
 
+std::vector<NodeInfo> RoutingTable::DropNodes(const std::vector<NodeId>& nodes_to_drop,
+                                              bool routing_only) {
+  std::vector<NodeInfo> new_connected_close_nodes, old_connected_close_nodes;
+  std::vector<NodeInfo> dropped_nodes;
+  std::shared_ptr<MatrixChange> matrix_change;
+  std::vector<NodeId> unique_nodes;
+  uint16_t routing_table_size(0);
+  {
+    std::unique_lock<HotPathMutex> lock(mutex_);
+    std::vector<NodeId> dropped_ids;
+    for (const auto& node_to_drop : nodes_to_drop) {
+      auto found(Find(node_to_drop, lock));
+      if (found.first) {
+        dropped_nodes.push_back(*found.second);
+        dropped_ids.push_back(node_to_drop);
+        table_summaries_.Remove(node_to_drop);
+        EraseNode(found.second, lock);
+      }
+    }
+    if (dropped_nodes.empty())
+      return dropped_nodes;
+
+    old_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    matrix_change = group_matrix_.UpdateConnectedPeers(GetCloseNodesToConnect(lock), dropped_ids);
+    InvalidateGroupMemo(matrix_change, lock);
+    new_connected_close_nodes = group_matrix_.GetConnectedPeers();
+    UpdateCloseGroup(lock);
+    PublishSnapshot(lock);
+    routing_table_size = static_cast<uint16_t>(nodes_.size());
+    unique_nodes = group_matrix_.GetUniqueNodeIds();
+  }
+
+  if (!matrix_change->OldEqualsToNew()) {
+    network_statistics_.UpdateLocalAverageDistance(unique_nodes);
+    IpcSendGroupMatrix();
+  }
+  NotifyGroupChange(matrix_change, new_connected_close_nodes, old_connected_close_nodes);
+
+  UpdateNetworkStatus(routing_table_size);
+
+  for (const auto& dropped_node : dropped_nodes) {
+    LOG(kVerbose) << DebugId(kNodeId()) << "Routing table dropped node id : "
+                  << DebugId(dropped_node.node_id) << ", connection id : "
+                  << DebugId(dropped_node.connection_id);
+    if (remove_node_functor_ && !routing_only)
+      remove_node_functor_(dropped_node, false);
+  }
+  if (ROUTING_TRACE_ENABLED(TraceLevel::kVerbose)) {
+    LOG(kInfo) << PrintRoutingTable();
+  }
+  return dropped_nodes;
+}
+
 bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer) {
   NodeId current_closest_id(kNodeId_);
   NodeId closest_peer_id(GetClosestNode(target_id, true).node_id);
   if (NodeId::CloserToTarget(closest_peer_id, current_closest_id, target_id))
     current_closest_id = closest_peer_id;
 
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<HotPathMutex> lock(mutex_);
   group_matrix_.GetBetterNodeForSendingMessage(target_id, true, current_closest_id);
   if (current_closest_id != kNodeId_) {
     auto found(Find(current_closest_id, lock));
@@ -262,14 +459,14 @@ bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& conn
 }
 
 bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer,
-                                         const std::vector<std::string>& exclude) {
+                                         const ExcludedNodes& exclude) {
   NodeInfo current_closest;
   current_closest.node_id = kNodeId_;
   NodeInfo closest_peer(GetClosestNode(target_id, exclude, true));
   if (NodeId::CloserToTarget(closest_peer.node_id, current_closest.node_id, target_id))
     current_closest = closest_peer;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<HotPathMutex> lock(mutex_);
     group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, true, current_closest);
     if (current_closest.node_id != kNodeId_) {
       auto found(Find(current_closest.node_id, lock));
@@ -278,8 +475,17 @@ bool RoutingTable::IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& conn
         return false;
       }
     }
+    // Route history only holds tags, so earlier hops are resolved against the connected peers.
+    for (const auto& node : nodes_) {
+      if (node.node_id != target_id && exclude.ContainsTag(node.node_id) &&
+          NodeId::CloserToTarget(node.node_id, kNodeId_, target_id)) {
+        if (connected_peer.node_id.IsZero())
+          connected_peer = closest_peer;
+        return false;
+      }
+    }
   }
-  for (const auto& excluded : exclude) {
+  for (const auto& excluded : exclude.node_ids()) {
     try {
       NodeId excluded_id(excluded);
       if (excluded_id != target_id && NodeId::CloserToTarget(excluded_id, kNodeId_, target_id)) {
@@ -299,7 +505,7 @@ bool RoutingTable::ClosestToId(const NodeId& target_id) {
   if (target_id == kNodeId_)
     return false;
 
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<HotPathMutex> lock(mutex_);
   if (nodes_.empty())  // should return false ?
     return true;
 
@@ -310,11 +516,11 @@ bool RoutingTable::ClosestToId(const NodeId& target_id) {
       return NodeId::CloserToTarget(kNodeId_, nodes_.at(0).node_id, target_id);
   }
 
-  PartialSortFromTarget(target_id, 2, lock);
+  auto closest(FindClosest(target_id, 2, lock));
   uint16_t index(0);
-  if (nodes_.at(0).node_id == target_id)
+  if (closest.at(0)->node_id == target_id)
     index = 1;
-  if (!NodeId::CloserToTarget(kNodeId_, nodes_.at(index).node_id, target_id))
+  if (!NodeId::CloserToTarget(kNodeId_, closest.at(index)->node_id, target_id))
     return false;
 
   return group_matrix_.ClosestToId(target_id);
@@ -329,12 +535,24 @@ GroupRangeStatus RoutingTable::IsNodeIdInGroupRange(const NodeId& group_id,
   if (group_id == node_id)
     return GroupRangeStatus::kInRange;
 
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<HotPathMutex> lock(mutex_);
   return group_matrix_.IsNodeIdInGroupRange(group_id, node_id);
 }
 
+GroupRangeView RoutingTable::GetGroupRangeView() const {
+  GroupRangeView group_range_view;
+  {
+    std::lock_guard<HotPathMutex> lock(mutex_);
+    group_range_view = group_matrix_.GetGroupRangeView();
+    group_range_view.ready_to_estimate_ =
+        nodes_.size() > Parameters::routing_table_ready_to_response;
+  }
+  group_range_view.in_group_distance_ = network_statistics_.GetInGroupDistance();
+  return group_range_view;
+}
+
 NodeId RoutingTable::RandomConnectedNode() {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::unique_lock<HotPathMutex> lock(mutex_);
 // Commenting out assert as peer starts treating this node as joined as soon as it adds
 // it into its routing table.
 //  assert(nodes_.size() > Parameters::closest_nodes_size &&
@@ -343,37 +561,36 @@ NodeId RoutingTable::RandomConnectedNode() {
   if (nodes_.empty())
     return NodeId();
 
-  PartialSortFromTarget(kNodeId_, static_cast<uint16_t>(nodes_.size()), lock);
   size_t index(RandomUint32() % (nodes_.size()));
   return nodes_.at(index).node_id;
 }
 
 std::vector<NodeInfo> RoutingTable::GetMatrixNodes() {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<HotPathMutex> lock(mutex_);
   return group_matrix_.GetUniqueNodes();
 }
 
 bool RoutingTable::IsConnected(const NodeId& node_id) {
   if (Contains(node_id))
     return true;
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<HotPathMutex> lock(mutex_);
   return group_matrix_.Contains(node_id);
 }
 
 bool RoutingTable::GetNodeInfo(const NodeId& node_id, NodeInfo& peer) const {
-  std::unique_lock<std::mutex> lock(mutex_);
-  auto found(Find(node_id, lock));
-  if (found.first)
-    peer = *found.second;
-  return found.first;
+  auto snapshot(GetSnapshot());
+  auto found(snapshot->index.find(node_id));
+  if (found == snapshot->index.end())
+    return false;
+  peer = snapshot->nodes[found->second];
+  return true;
 }
 
 bool RoutingTable::IsThisNodeInRange(const NodeId& target_id, const uint16_t range) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  if (nodes_.size() < range)
+  auto snapshot(GetSnapshot());
+  if (snapshot->nodes.size() < range)
     return true;
-  NthElementSortFromTarget(kNodeId_, range, lock);
-  return NodeId::CloserToTarget(target_id, nodes_[range - 1].node_id, kNodeId_);
+  return NodeId::CloserToTarget(target_id, snapshot->nodes[range - 1].node_id, kNodeId_);
 }
 
 bool RoutingTable::IsThisNodeClosestTo(const NodeId& target_id, bool ignore_exact_match) {
@@ -401,13 +618,13 @@ bool RoutingTable::IsThisNodeClosestToIncludingMatrix(const NodeId& target_id,
     return false;
 
   NodeId connected_peer;
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<HotPathMutex> lock(mutex_);
   return group_matrix_.IsThisNodeGroupLeader(target_id, connected_peer);  // use connected peer?
 }
 
 bool RoutingTable::Contains(const NodeId& node_id) const {
-  std::unique_lock<std::mutex> lock(mutex_);
-  return Find(node_id, lock).first;
+  auto snapshot(GetSnapshot());
+  return snapshot->index.count(node_id) != 0;
 }
 
 bool RoutingTable::ConfirmGroupMembers(const NodeId& node1, const NodeId& node2) {
@@ -420,7 +637,7 @@ void RoutingTable::GroupUpdateFromConnectedPeer(const NodeId& peer,
   std::shared_ptr<MatrixChange> matrix_change;
   std::vector<NodeInfo> new_connected_peers, old_connected_peers;
   {
-    std::unique_lock<std::mutex> lock(mutex_);
+    std::unique_lock<HotPathMutex> lock(mutex_);
     std::vector<NodeId> old_unique_ids(group_matrix_.GetUniqueNodeIds());
     old_connected_peers = group_matrix_.GetConnectedPeers();
     if (std::find_if(old_connected_peers.begin(), old_connected_peers.end(),
@@ -432,31 +649,109 @@ void RoutingTable::GroupUpdateFromConnectedPeer(const NodeId& peer,
       group_matrix_.AddConnectedPeer(*found.second, nodes);
     }
     matrix_change = group_matrix_.UpdateFromConnectedPeer(peer, nodes, old_unique_ids);
+    InvalidateGroupMemo(matrix_change, lock);
     new_connected_peers = group_matrix_.GetConnectedPeers();
+    ++routes_version_;
   }
-  if (!matrix_change->OldEqualsToNew() && matrix_change_functor_)
-    matrix_change_functor_(matrix_change);
-  UpdateConnectedPeersMatrix(new_connected_peers, old_connected_peers);
+  NotifyGroupChange(matrix_change, new_connected_peers, old_connected_peers);
 }
 
 void RoutingTable::UpdateConnectedPeersMatrix(const std::vector<NodeInfo>& new_connected_peers,
                                               const std::vector<NodeInfo>& old_connected_peers) {
-  if (new_connected_peers.size() != old_connected_peers.size() ||
-      !std::equal(std::begin(new_connected_peers), std::end(new_connected_peers),
-                  std::begin(old_connected_peers),
-                  [](const NodeInfo& lhs, const NodeInfo& rhs) {
-                    return lhs.node_id == rhs.node_id;
-                  }))
+  if (!SameNodeIds(new_connected_peers, old_connected_peers))
     if (connected_group_change_functor_)
       connected_group_change_functor_(new_connected_peers, old_connected_peers);
 }
 
+void RoutingTable::NotifyGroupChange(std::shared_ptr<MatrixChange> matrix_change,
+                                     const std::vector<NodeInfo>& new_connected_peers,
+                                     const std::vector<NodeInfo>& old_connected_peers) {
+  bool matrix_changed(matrix_change && !matrix_change->OldEqualsToNew());
+  if (!matrix_changed && SameNodeIds(new_connected_peers, old_connected_peers))
+    return;
+  if (Parameters::group_change_settle_window == std::chrono::milliseconds(0)) {
+    UpdateConnectedPeersMatrix(new_connected_peers, old_connected_peers);
+    if (matrix_changed && matrix_change_functor_)
+      matrix_change_functor_(matrix_change);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(group_change_mutex_);
+    if (!pending_group_change_.connected_peers_changed && !pending_group_change_.matrix_changed) {
+      pending_group_change_.deadline =
+          RoutingClock::now() + Parameters::group_change_settle_window;
+    }
+    // The oldest state is kept from the first change in the window and the newest from the last,
+    // so that the functors see only the net change.
+    if (!pending_group_change_.connected_peers_changed) {
+      pending_group_change_.old_connected_peers = old_connected_peers;
+      pending_group_change_.connected_peers_changed = true;
+    }
+    pending_group_change_.new_connected_peers = new_connected_peers;
+    if (matrix_changed) {
+      if (!pending_group_change_.matrix_changed) {
+        pending_group_change_.old_unique_ids = matrix_change->old_matrix_;
+        pending_group_change_.matrix_changed = true;
+      }
+      pending_group_change_.new_unique_ids = matrix_change->new_matrix_;
+    }
+    // A change in the size of the close group isn't held back; it affects this node's own
+    // responsibilities.
+    if (new_connected_peers.size() == old_connected_peers.size()) {
+      if (!group_change_notifier_.joinable())
+        group_change_notifier_ = std::thread([this] { CoalesceGroupChanges(); });
+      group_change_cond_var_.notify_one();
+      return;
+    }
+  }
+  FlushGroupChange();
+}
+
+void RoutingTable::FlushGroupChange() {
+  std::lock_guard<std::mutex> fire_lock(group_change_fire_mutex_);
+  PendingGroupChange group_change;
+  {
+    std::lock_guard<std::mutex> lock(group_change_mutex_);
+    std::swap(group_change, pending_group_change_);
+  }
+  if (group_change.connected_peers_changed)
+    UpdateConnectedPeersMatrix(group_change.new_connected_peers, group_change.old_connected_peers);
+  if (group_change.matrix_changed && matrix_change_functor_) {
+    auto matrix_change(std::make_shared<MatrixChange>(
+        MatrixChange(kNodeId_, group_change.old_unique_ids, group_change.new_unique_ids)));
+    if (!matrix_change->OldEqualsToNew())
+      matrix_change_functor_(matrix_change);
+  }
+}
+
+void RoutingTable::CoalesceGroupChanges() {
+  std::unique_lock<std::mutex> lock(group_change_mutex_);
+  while (!group_change_stop_) {
+    if (!pending_group_change_.connected_peers_changed && !pending_group_change_.matrix_changed) {
+      group_change_cond_var_.wait(lock);
+      continue;
+    }
+    // The deadline is on RoutingClock, so a simulation's virtual time decides when it has passed.
+    RoutingClock::time_point now(RoutingClock::now());
+    if (now < pending_group_change_.deadline) {
+      group_change_cond_var_.wait_for(lock, RoutingClock::is_virtual()
+                                                ? RoutingClock::duration(kVirtualTimePollInterval)
+                                                : pending_group_change_.deadline - now);
+      continue;
+    }
+    lock.unlock();
+    FlushGroupChange();
+    lock.lock();
+  }
+}
+
 std::shared_ptr<MatrixChange> RoutingTable::UpdateCloseNodeChange(
-    std::unique_lock<std::mutex>& lock, const NodeInfo& peer,
+    std::unique_lock<HotPathMutex>& lock, const NodeInfo& peer,
     std::vector<NodeInfo>& new_connected_nodes, const std::vector<NodeInfo>& matrix_update) {
   assert(lock.owns_lock());
+  static_cast<void>(lock);
   std::shared_ptr<MatrixChange> matrix_change;
-  PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
   if (nodes_.size() < Parameters::closest_nodes_size ||
       !NodeId::CloserToTarget(nodes_[Parameters::closest_nodes_size - 1].node_id, peer.node_id,
                               kNodeId_) ||
@@ -467,37 +762,29 @@ std::shared_ptr<MatrixChange> RoutingTable::UpdateCloseNodeChange(
   return matrix_change;
 }
 
-// bucket 0 is us, 511 is furthest bucket (should fill first)
+void RoutingTable::InvalidateGroupMemo(const std::shared_ptr<MatrixChange>& matrix_change,
+                                       std::unique_lock<HotPathMutex>& lock) {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  if (matrix_change && !matrix_change->OldEqualsToNew())
+    group_memo_.HandleMatrixChange(*matrix_change);
+}
+
 void RoutingTable::SetBucketIndex(NodeInfo& node_info) const {
-  std::string holder_raw_id(kNodeId_.string());
-  std::string node_raw_id(node_info.node_id.string());
-  int16_t byte_index(0);
-  while (byte_index != NodeId::kSize) {
-    if (holder_raw_id[byte_index] != node_raw_id[byte_index]) {
-      std::bitset<8> holder_byte(static_cast<int>(holder_raw_id[byte_index]));
-      std::bitset<8> node_byte(static_cast<int>(node_raw_id[byte_index]));
-      int16_t bit_index(0);
-      while (bit_index != 8U) {
-        if (holder_byte[7U - bit_index] != node_byte[7U - bit_index])
-          break;
-        ++bit_index;
-      }
-      node_info.bucket = (8 * (NodeId::kSize - byte_index)) - bit_index - 1;
-      return;
-    }
-    ++byte_index;
-  }
-  node_info.bucket = 0;
+  node_info.bucket = BucketIndex(node_info.node_id);
+}
+
+// bucket 0 is us, 511 is furthest bucket (should fill first)
+int32_t RoutingTable::BucketIndex(const NodeId& node_id) const {
+  return Distance(node_id, kNodeId_).HighestBit();
 }
 
 bool RoutingTable::CheckPublicKeyIsUnique(const NodeInfo& node,
-                                          std::unique_lock<std::mutex>& lock) const {
+                                          std::unique_lock<HotPathMutex>& lock) const {
   assert(lock.owns_lock());
   static_cast<void>(lock);
   // If we already have a duplicate public key return false
-  if (std::find_if(nodes_.begin(), nodes_.end(), [node](const NodeInfo & node_info) {
-        return asymm::MatchingKeys(node_info.public_key, node.public_key);
-      }) != nodes_.end()) {
+  if (public_key_fingerprints_.count(PublicKeyFingerprint(node.public_key)) != 0) {
     LOG(kInfo) << "Already have node with this public key";
     return false;
   }
@@ -520,7 +807,7 @@ bool RoutingTable::CheckPublicKeyIsUnique(const NodeInfo& node,
 
 bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
                                              NodeInfo& removed_node,
-                                             std::unique_lock<std::mutex>& lock) {
+                                             std::unique_lock<HotPathMutex>& lock) {
   assert(lock.owns_lock());
 
   if (remove && !CheckPublicKeyIsUnique(node, lock))
@@ -529,7 +816,6 @@ bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
   if (nodes_.size() < kMaxSize_)
     return true;
 
-  PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock);
   NodeInfo furthest_close_node = nodes_[Parameters::closest_nodes_size - 1];
   auto const furthest_close_node_iter = nodes_.begin() + (Parameters::closest_nodes_size - 1);
 
@@ -538,18 +824,20 @@ bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
       assert(node.bucket <= furthest_close_node.bucket &&
              "close node replacement to higher bucket");
       removed_node = *furthest_close_node_iter;
-      nodes_.erase(furthest_close_node_iter);
+      EraseNode(furthest_close_node_iter, lock);
     }
     return true;
   }
 
-  uint16_t size(Parameters::bucket_target_size + 1);
   for (auto it = furthest_close_node_iter; it != nodes_.end(); ++it) {
     if (node.bucket >= (*it).bucket)  // Stop searching as it's worthless
-      return false;
+      break;
+    // Buckets whose routes are long keep more peers (see route_quality.h)
+    const uint16_t size(Parameters::bucket_target_size + 1 +
+                        route_quality_.BucketAllowance((*it).bucket));
     // Safety net
     if ((nodes_.end() - it) < size)  // Reached end of checkable area
-      return false;
+      break;
 
     if ((*it).bucket == (*(it + size)).bucket) {
       // Here we know the node should fit into a bucket if the bucket has too many nodes AND node to
@@ -557,73 +845,285 @@ bool RoutingTable::MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove,
       assert(node.bucket < (*it).bucket);
       if (remove) {
         removed_node = *it;
-        nodes_.erase(it);
+        EraseNode(it, lock);
       }
       return true;
     }
   }
-  return false;
+  return MakeSpaceByProximity(node, remove, removed_node, lock);
 }
 
-uint16_t RoutingTable::PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                             std::unique_lock<std::mutex>& lock) {
+// Swapping peers within the candidate's own bucket leaves every bucket's size, and the close group,
+// as they were.
+bool RoutingTable::MakeSpaceByProximity(const NodeInfo& node, bool remove, NodeInfo& removed_node,
+                                        std::unique_lock<HotPathMutex>& lock) {
+  assert(lock.owns_lock());
+  if (Parameters::proximity_replacement_percent == 0)
+    return false;
+  const double kCandidateRoundTrip(ExpectedRoundTrip(node.node_id));
+  if (kCandidateRoundTrip < 0)
+    return false;
+
+  // A node only being checked has no bucket set yet.
+  const int32_t kBucket(BucketIndex(node.node_id));
+  auto slowest(nodes_.end());
+  double slowest_round_trip(-1.0);
+  for (auto it(nodes_.begin() + Parameters::closest_nodes_size); it != nodes_.end(); ++it) {
+    if ((*it).bucket != kBucket)
+      continue;
+    const double kRoundTrip(ExpectedRoundTrip((*it).node_id));
+    if (kRoundTrip > slowest_round_trip) {
+      slowest = it;
+      slowest_round_trip = kRoundTrip;
+    }
+  }
+  if (slowest == nodes_.end() ||
+      kCandidateRoundTrip * 100 > slowest_round_trip * Parameters::proximity_replacement_percent)
+    return false;
+
+  LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Replacing " << DebugId((*slowest).node_id)
+                << " (" << slowest_round_trip << "ms) with " << DebugId(node.node_id) << " ("
+                << kCandidateRoundTrip << "ms)";
+  if (remove) {
+    removed_node = *slowest;
+    EraseNode(slowest, lock);
+  }
+  return true;
+}
+
+double RoutingTable::ExpectedRoundTrip(const NodeId& peer_id) const {
+  const double kMeasured(network_statistics_.RoundTrip(peer_id));
+  return kMeasured >= 0 ? kMeasured : network_coordinates_.PredictedRoundTrip(peer_id);
+}
+
+void RoutingTable::InsertNode(const NodeInfo& node, std::unique_lock<HotPathMutex>& lock) {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  uint16_t count = std::min(number, static_cast<uint16_t>(nodes_.size()));
-  std::partial_sort(nodes_.begin(), nodes_.begin() + count, nodes_.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-  });
-  return count;
+  HotEntry hot_entry(Distance(node.node_id, kNodeId_), node.bucket);
+  auto hot_itr(hot_entries_.insert(
+      std::upper_bound(hot_entries_.begin(), hot_entries_.end(), hot_entry,
+                       [](const HotEntry & lhs, const HotEntry & rhs) {
+                         return lhs.distance < rhs.distance;
+                       }),
+      hot_entry));
+  auto itr(nodes_.insert(nodes_.begin() + (hot_itr - hot_entries_.begin()), node));
+  ReindexFrom(itr - nodes_.begin(), lock);
+  public_key_fingerprints_.insert(PublicKeyFingerprint(node.public_key));
+}
+
+std::vector<NodeInfo>::iterator RoutingTable::EraseNode(std::vector<NodeInfo>::iterator itr,
+                                                        std::unique_lock<HotPathMutex>& lock) {
+  node_index_.erase(itr->node_id);
+  public_key_fingerprints_.erase(PublicKeyFingerprint(itr->public_key));
+  hot_entries_.erase(hot_entries_.begin() + (itr - nodes_.begin()));
+  auto next(nodes_.erase(itr));
+  ReindexFrom(next - nodes_.begin(), lock);
+  return next;
 }
 
-void RoutingTable::NthElementSortFromTarget(const NodeId& target, uint16_t nth_element,
-                                            std::unique_lock<std::mutex>& lock) {
+void RoutingTable::ReindexFrom(std::vector<NodeInfo>::difference_type index,
+                               std::unique_lock<HotPathMutex>& lock) {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  assert((nodes_.size() >= nth_element) &&
-         "This should only be called when n is at max the size of RT");
-#ifndef __GNUC__
-  std::nth_element(nodes_.begin(), nodes_.begin() + nth_element - 1, nodes_.end(),
-                   [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-                       return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-                   });
-#else
-// BEFORE_RELEASE use std::nth_element() for all platform when min required Gcc version is 4.8.3
-// http://gcc.gnu.org/bugzilla/show_bug.cgi?id=58800 Bug fixed in gcc 4.8.3
-  std::partial_sort(nodes_.begin(), nodes_.begin() + nth_element - 1, nodes_.end(),
-                    [target](const NodeInfo & lhs, const NodeInfo & rhs) {
-                        return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target);
-                    });
-#endif
+  for (auto position(static_cast<size_t>(index)); position < nodes_.size(); ++position)
+    node_index_[nodes_[position].node_id] = position;
+}
+
+std::vector<std::vector<NodeInfo>::const_iterator> RoutingTable::FindClosest(
+    const NodeId& target, uint16_t number, std::unique_lock<HotPathMutex>& lock) const {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  return FindClosest(nodes_, hot_entries_, target, number);
+}
+
+// Since nodes are held sorted by distance from kNodeId_, they are also sorted by bucket.  For a
+// target in bucket b, every node in bucket b is closer to the target than any other node, the nodes
+// in buckets below b all lie in the next distance band, and each bucket above b lies in a band
+// further out again.  Only the bands needed to yield |number| nodes are visited and sorted, and
+// only the contiguous hot entries are touched while doing so.
+std::vector<std::vector<NodeInfo>::const_iterator> RoutingTable::FindClosest(
+    const std::vector<NodeInfo>& nodes, const std::vector<HotEntry>& hot_entries,
+    const NodeId& target, uint16_t number) const {
+  assert(nodes.size() == hot_entries.size());
+  std::vector<std::vector<NodeInfo>::const_iterator> closest;
+  size_t count(std::min(static_cast<size_t>(number), nodes.size()));
+  if (count == 0)
+    return closest;
+  closest.reserve(count);
+
+  if (target == kNodeId_) {
+    for (size_t index(0); index != count; ++index)
+      closest.push_back(nodes.begin() + index);
+    return closest;
+  }
+
+  // A node's distance from the target is its distance from us XORed with the target's.
+  const Distance target_distance(target, kNodeId_);
+  auto append_band([&](size_t first, size_t last) {
+    std::vector<std::pair<Distance, size_t>> band;
+    band.reserve(last - first);
+    for (; first != last; ++first)
+      band.push_back(std::make_pair(hot_entries[first].distance ^ target_distance, first));
+    size_t wanted(std::min(count - closest.size(), band.size()));
+    std::partial_sort(band.begin(), band.begin() + wanted, band.end());
+    for (auto itr(band.begin()); itr != band.begin() + wanted; ++itr)
+      closest.push_back(nodes.begin() + itr->second);
+  });
+  auto bucket_end([&hot_entries](size_t first, int32_t bucket)->size_t {
+    return std::upper_bound(hot_entries.begin() + first, hot_entries.end(), bucket,
+                            [](int32_t lhs, const HotEntry & rhs) { return lhs < rhs.bucket; }) -
+           hot_entries.begin();
+  });
+
+  int32_t target_bucket(target_distance.HighestBit());
+  size_t target_bucket_begin(
+      std::lower_bound(hot_entries.begin(), hot_entries.end(), target_bucket,
+                       [](const HotEntry & lhs, int32_t rhs) { return lhs.bucket < rhs; }) -
+      hot_entries.begin());
+  size_t target_bucket_end(bucket_end(target_bucket_begin, target_bucket));
+  append_band(target_bucket_begin, target_bucket_end);
+  if (closest.size() != count)
+    append_band(0, target_bucket_begin);
+  size_t first(target_bucket_end);
+  while (closest.size() != count) {
+    size_t last(bucket_end(first, hot_entries[first].bucket));
+    append_band(first, last);
+    first = last;
+  }
+  return closest;
 }
 
 NodeId RoutingTable::FurthestCloseNode() {
-  return GetNthClosestNode(kNodeId_, Parameters::closest_nodes_size).node_id;
+  return GetSnapshot()->furthest_close_node_id;
+}
+
+NodeId RoutingTable::FurthestClientRangeNode() const {
+  return GetSnapshot()->furthest_client_range_node_id;
 }
 
 NodeInfo RoutingTable::GetClosestNode(const NodeId& target_id, bool ignore_exact_match) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, 2, lock));
-  if (sorted_count == 0)
+  auto snapshot(GetSnapshot());
+  auto closest(FindClosest(snapshot->nodes, snapshot->hot_entries, target_id, 2));
+  if (closest.empty())
     return NodeInfo();
-  if (ignore_exact_match && (nodes_[0].node_id == target_id))
-    return (sorted_count == 1) ? NodeInfo() : nodes_[1];
-  return nodes_[0];
+  if (ignore_exact_match && (closest[0]->node_id == target_id))
+    return (closest.size() == 1) ? NodeInfo() : *closest[1];
+  return *closest[0];
 }
 
 NodeInfo RoutingTable::GetClosestNode(const NodeId& target_id,
-                                      const std::vector<std::string>& exclude,
+                                      const ExcludedNodes& exclude,
                                       bool ignore_exact_match) {
-  std::vector<NodeInfo> closest_nodes(
-      GetClosestNodeInfo(target_id, Parameters::closest_nodes_size, ignore_exact_match));
+  return GetClosestNode(*GetSnapshot(), target_id, exclude, ignore_exact_match);
+}
+
+NodeInfo RoutingTable::GetClosestNode(const Snapshot& snapshot, const NodeId& target_id,
+                                      const ExcludedNodes& exclude, bool ignore_exact_match) {
+  std::vector<NodeInfo> closest_nodes(GetClosestNodeInfo(
+      snapshot, target_id, Parameters::closest_nodes_size, ignore_exact_match));
   for (const auto& node_info : closest_nodes) {
-    if (std::find(exclude.begin(), exclude.end(), node_info.node_id.string()) == exclude.end())
+    if (!exclude.Contains(node_info.node_id))
       return node_info;
   }
   return NodeInfo();
 }
 
+NodeInfo RoutingTable::GetFastestCloserNode(const Snapshot& snapshot, const NodeId& target_id,
+                                            const ExcludedNodes& exclude,
+                                            bool ignore_exact_match,
+                                            const NodeInfo& closest_peer) {
+  std::vector<NodeInfo> closest_nodes(GetClosestNodeInfo(
+      snapshot, target_id,
+      static_cast<uint16_t>(Parameters::latency_aware_candidates + exclude.size()),
+      ignore_exact_match));
+  std::vector<NodeInfo> candidates;
+  std::vector<NodeId> candidate_ids;
+  for (const auto& node_info : closest_nodes) {
+    if (candidates.size() == Parameters::latency_aware_candidates)
+      break;
+    // Every candidate must make strict progress towards the target.
+    if (!NodeId::CloserToTarget(node_info.node_id, kNodeId_, target_id))
+      break;
+    if (exclude.Contains(node_info.node_id))
+      continue;
+    candidates.push_back(node_info);
+    candidate_ids.push_back(node_info.node_id);
+  }
+  if (candidates.size() < 2)
+    return closest_peer;
+  return candidates.at(network_statistics_.GetFastestPeer(candidate_ids));
+}
+
+NodeInfo RoutingTable::GetLookaheadNode(const Snapshot& snapshot, const NodeId& target_id,
+                                        const ExcludedNodes& exclude, bool ignore_exact_match,
+                                        const NodeInfo& closest_peer) {
+  std::vector<NodeInfo> closest_nodes(GetClosestNodeInfo(
+      snapshot, target_id, static_cast<uint16_t>(Parameters::lookahead_candidates + exclude.size()),
+      ignore_exact_match));
+  NodeInfo best_peer(closest_peer);
+  uint64_t best_distance(table_summaries_.LookaheadDistance(closest_peer.node_id, target_id));
+  uint16_t candidates(0);
+  for (const auto& node_info : closest_nodes) {
+    if (candidates == Parameters::lookahead_candidates)
+      break;
+    // Every candidate must make strict progress towards the target, so no route can loop.
+    if (!NodeId::CloserToTarget(node_info.node_id, kNodeId_, target_id))
+      break;
+    if (exclude.Contains(node_info.node_id))
+      continue;
+    ++candidates;
+    const uint64_t kDistance(table_summaries_.LookaheadDistance(node_info.node_id, target_id));
+    if (kDistance < best_distance) {
+      best_distance = kDistance;
+      best_peer = node_info;
+    }
+  }
+  return best_peer;
+}
+
+std::vector<uint64_t> RoutingTable::TableSummary() const {
+  auto snapshot(GetSnapshot());
+  std::vector<NodeId> peer_ids;
+  peer_ids.reserve(snapshot->nodes.size());
+  for (const auto& node_info : snapshot->nodes)
+    peer_ids.push_back(node_info.node_id);
+  return TableSummaries::Summarise(peer_ids, Parameters::table_summary_size);
+}
+
+void RoutingTable::RecordTableSummary(const NodeId& peer_id,
+                                      const std::vector<uint64_t>& summary) {
+  if (Contains(peer_id))
+    table_summaries_.Update(peer_id, summary);
+}
+
+std::vector<NodeId> RoutingTable::TakeStaleTableSummaries() {
+  auto snapshot(GetSnapshot());
+  std::vector<NodeId> peer_ids;
+  peer_ids.reserve(snapshot->nodes.size());
+  for (const auto& node_info : snapshot->nodes)
+    peer_ids.push_back(node_info.node_id);
+  return table_summaries_.TakeStale(peer_ids, Parameters::table_summary_interval);
+}
+
+// Only peers in the table are tracked, so that DropNode() bounds the set of estimates.  Coordinates
+// are kept for candidates too, NetworkCoordinates bounding them itself.
+void RoutingTable::RecordRoundTrip(const NodeId& peer_id, std::chrono::milliseconds round_trip,
+                                   const std::vector<int32_t>& coordinates) {
+  network_coordinates_.Update(peer_id, coordinates, round_trip);
+  if (Contains(peer_id))
+    network_statistics_.RecordRoundTrip(peer_id, round_trip);
+}
+
+void RoutingTable::RecordSendResult(const NodeId& peer_id, bool success) {
+  if (Contains(peer_id))
+    network_statistics_.RecordSendResult(peer_id, success);
+}
+
+void RoutingTable::RecordRouteHops(const NodeId& destination_id, int32_t hops) {
+  if (!kClientMode_ && destination_id != kNodeId_)
+    route_quality_.RecordHops(BucketIndex(destination_id), hops);
+}
+
 /*
 NodeInfo RoutingTable::GetNodeForSendingMessage(const NodeId& target_id,
                                                 bool ignore_exact_match) {
@@ -641,29 +1141,108 @@ NodeInfo RoutingTable::GetNodeForSendingMessage(const NodeId& target_id,
 */
 
 NodeInfo RoutingTable::GetNodeForSendingMessage(const NodeId& target_id,
-                                                const std::vector<std::string>& exclude,
+                                                const ExcludedNodes& exclude,
                                                 bool ignore_exact_match) {
-  NodeInfo current_peer(GetClosestNode(target_id, exclude, ignore_exact_match));
+  auto snapshot(GetSnapshot());
+  NodeInfo current_peer(GetClosestNode(*snapshot, target_id, exclude, ignore_exact_match));
   if (current_peer.node_id != target_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, ignore_exact_match,
-                                                 current_peer);
-  }
-  std::string excluded_ids;
-  for (const auto& excluded_id : exclude) {
-    excluded_ids.append("\t");
-    excluded_ids.append(HexSubstr(excluded_id));
+    const NodeId kClosestPeerId(current_peer.node_id);
+    {
+      std::lock_guard<HotPathMutex> lock(mutex_);
+      group_matrix_.GetBetterNodeForSendingMessage(target_id, exclude, ignore_exact_match,
+                                                   current_peer);
+    }
+    // A peer chosen via the matrix is a route to a closer node, so is kept as it is.
+    if (Parameters::lookahead_routing && !kClosestPeerId.IsZero() &&
+        current_peer.node_id == kClosestPeerId) {
+      current_peer =
+          GetLookaheadNode(*snapshot, target_id, exclude, ignore_exact_match, current_peer);
+    }
+    if (Parameters::latency_aware_routing && !kClosestPeerId.IsZero() &&
+        current_peer.node_id == kClosestPeerId) {
+      current_peer =
+          GetFastestCloserNode(*snapshot, target_id, exclude, ignore_exact_match, current_peer);
+    }
   }
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] - best node to send to is "
-                << DebugId(current_peer.node_id) << " (Excluded: " << excluded_ids << ")";
+                << DebugId(current_peer.node_id) << " (Excluded: " << exclude.DebugString() << ")";
   return current_peer;
 }
 
+std::vector<NodeInfo> RoutingTable::GetNodesForSendingMessages(
+    const std::vector<NodeId>& target_ids, const ExcludedNodes& exclude,
+    bool ignore_exact_match) {
+  auto snapshot(GetSnapshot());
+  std::vector<NodeInfo> peers;
+  peers.reserve(target_ids.size());
+  for (const auto& target_id : target_ids)
+    peers.push_back(GetClosestNode(*snapshot, target_id, exclude, ignore_exact_match));
+  std::vector<NodeId> closest_peer_ids;
+  closest_peer_ids.reserve(peers.size());
+  {
+    std::lock_guard<HotPathMutex> lock(mutex_);
+    for (size_t i(0); i != peers.size(); ++i) {
+      closest_peer_ids.push_back(peers[i].node_id);
+      if (peers[i].node_id != target_ids[i]) {
+        group_matrix_.GetBetterNodeForSendingMessage(target_ids[i], exclude, ignore_exact_match,
+                                                     peers[i]);
+      }
+    }
+  }
+  if (Parameters::lookahead_routing) {
+    for (size_t i(0); i != peers.size(); ++i) {
+      if (closest_peer_ids[i] != target_ids[i] && !closest_peer_ids[i].IsZero() &&
+          peers[i].node_id == closest_peer_ids[i]) {
+        peers[i] = GetLookaheadNode(*snapshot, target_ids[i], exclude, ignore_exact_match,
+                                    peers[i]);
+      }
+    }
+  }
+  if (Parameters::latency_aware_routing) {
+    for (size_t i(0); i != peers.size(); ++i) {
+      if (closest_peer_ids[i] != target_ids[i] && !closest_peer_ids[i].IsZero() &&
+          peers[i].node_id == closest_peer_ids[i]) {
+        peers[i] = GetFastestCloserNode(*snapshot, target_ids[i], exclude, ignore_exact_match,
+                                        peers[i]);
+      }
+    }
+  }
+  LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] - chose next hops for " << peers.size()
+                << " messages (Excluded: " << exclude.DebugString() << ")";
+  return peers;
+}
+
+void RoutingTable::RecordEviction(const NodeId& node_id) {
+  if (Parameters::eviction_backoff == std::chrono::seconds(0))
+    return;
+  const auto kNow(RoutingClock::now());
+  std::lock_guard<std::mutex> lock(evicted_mutex_);
+  for (auto itr(evicted_.begin()); itr != evicted_.end();) {
+    if (itr->second <= kNow)
+      itr = evicted_.erase(itr);
+    else
+      ++itr;
+  }
+  evicted_[node_id] = kNow + Parameters::eviction_backoff;
+}
+
+bool RoutingTable::RecentlyEvicted(const NodeId& node_id) {
+  {
+    std::lock_guard<std::mutex> lock(evicted_mutex_);
+    auto itr(evicted_.find(node_id));
+    if (itr == evicted_.end())
+      return false;
+    if (itr->second <= RoutingClock::now()) {
+      evicted_.erase(itr);
+      return false;
+    }
+  }
+  return !IsThisNodeInRange(node_id, Parameters::closest_nodes_size);
+}
+
 NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
   std::map<uint32_t, uint16_t> bucket_rank_map;
-  std::unique_lock<std::mutex> lock(mutex_);
-  PartialSortFromTarget(kNodeId_, static_cast<uint16_t>(nodes_.size()), lock);
-
+  std::lock_guard<HotPathMutex> lock(mutex_);
   auto const from_iterator(nodes_.begin() + Parameters::closest_nodes_size);
 
   for (auto it = from_iterator; it != nodes_.end(); ++it) {
@@ -692,12 +1271,20 @@ NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
     return nodes_[Parameters::closest_nodes_size + Parameters::group_size];
   }
 
+  // The slowest of the fullest bucket's nodes goes first, as proximity neighbour selection would
+  // have it.  Of those with no known latency, the first in the bucket goes.
   NodeInfo removable_node;
+  double slowest_round_trip(-2.0);
   for (auto it(from_iterator); it != nodes_.end(); ++it) {
     if (((*it).bucket == max_bucket) &&
         std::find(attempted.begin(), attempted.end(), (*it).node_id.string()) == attempted.end()) {
-      removable_node = (*it);
-      break;
+      const double kRoundTrip(Parameters::proximity_replacement_percent == 0
+                                  ? -1.0
+                                  : ExpectedRoundTrip((*it).node_id));
+      if (kRoundTrip > slowest_round_trip) {
+        removable_node = (*it);
+        slowest_round_trip = kRoundTrip;
+      }
     }
   }
   LOG(kVerbose) << "[" << DebugId(kNodeId_) << "] Proposed removable ["
@@ -706,10 +1293,7 @@ NodeInfo RoutingTable::GetRemovableNode(std::vector<std::string> attempted) {
 }
 
 void RoutingTable::GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_needing_update) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(kNodeId_, Parameters::closest_nodes_size, lock));
-  if (sorted_count == 0)
-    return;
+  std::lock_guard<HotPathMutex> lock(mutex_);
   for (auto iter(nodes_.begin());
        iter != (nodes_.begin() +
                 std::min(Parameters::closest_nodes_size, static_cast<uint16_t>(nodes_.size())));
@@ -721,88 +1305,89 @@ void RoutingTable::GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_need
 
 NodeInfo RoutingTable::GetNthClosestNode(const NodeId& target_id, uint16_t node_number) {
   assert((node_number > 0) && "Node number starts with position 1");
-  std::unique_lock<std::mutex> lock(mutex_);
-  if (nodes_.size() < node_number) {
+  auto snapshot(GetSnapshot());
+  if (snapshot->nodes.size() < node_number) {
     NodeInfo node_info;
     node_info.node_id = (NodeId(NodeId::kMaxId) ^ kNodeId_);
     return node_info;
   }
-  NthElementSortFromTarget(target_id, node_number, lock);
-  return nodes_[node_number - 1];
+  return *FindClosest(snapshot->nodes, snapshot->hot_entries, target_id, node_number).back();
 }
 
 std::vector<NodeId> RoutingTable::GetClosestNodes(const NodeId& target_id, uint16_t number_to_get) {
   std::vector<NodeId> close_nodes;
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, number_to_get, lock));
-
-  for (int i = 0; i != sorted_count; ++i)
-    close_nodes.push_back(nodes_[i].node_id);
+  auto snapshot(GetSnapshot());
+  for (const auto& closest :
+       FindClosest(snapshot->nodes, snapshot->hot_entries, target_id, number_to_get))
+    close_nodes.push_back(closest->node_id);
   return close_nodes;
 }
 
 std::vector<NodeInfo> RoutingTable::GetClosestMatrixNodes(const NodeId& target_id,
                                                           uint16_t number_to_get) {
-  std::vector<NodeInfo> closest_matrix_nodes(GetMatrixNodes());
-  size_t sorting_size(std::min(static_cast<size_t>(number_to_get), closest_matrix_nodes.size()));
-  std::partial_sort(closest_matrix_nodes.begin(), closest_matrix_nodes.begin() + sorting_size,
-                    closest_matrix_nodes.end(),
-                    [&target_id](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target_id);
-  });
-  closest_matrix_nodes.resize(sorting_size);
-  return closest_matrix_nodes;
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  return group_matrix_.GetClosestUniqueNodes(target_id, number_to_get);
 }
 
 std::vector<NodeId> RoutingTable::GetGroup(const NodeId& target_id) {
-  std::vector<NodeInfo> nodes(GetMatrixNodes());
   std::vector<NodeId> group;
-  std::partial_sort(nodes.begin(), nodes.begin() + Parameters::group_size, nodes.end(),
-                    [&](const NodeInfo & lhs, const NodeInfo & rhs) {
-    return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, target_id);
-  });
-  for (auto iter(nodes.begin()); iter != nodes.begin() + Parameters::group_size; ++iter)
-    group.push_back(iter->node_id);
+  if (group_memo_.Get(target_id, group))
+    return group;
+  // Worked out and memoised under mutex_, so that no matrix change can fall between the two and
+  // leave a stale answer behind.
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  group = group_matrix_.GetUniqueNodeIds();
+  PartialSortByDistance(group, target_id, Parameters::group_size);
+  group.resize(std::min(group.size(), static_cast<size_t>(Parameters::group_size)));
+  group_memo_.Add(target_id, group);
   return group;
 }
 
-std::vector<NodeInfo> RoutingTable::GetClosestNodeInfo(const NodeId& target_id,
+std::vector<NodeInfo> RoutingTable::GetClosestNodeInfo(const Snapshot& snapshot,
+                                                       const NodeId& target_id,
                                                        uint16_t number_to_get,
                                                        bool ignore_exact_match) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  int sorted_count(PartialSortFromTarget(target_id, number_to_get + 1, lock));
-  if (sorted_count == 0)
-    return std::vector<NodeInfo>();
-
-  auto itr(nodes_.begin());
-  if (ignore_exact_match && ((*itr).node_id == target_id)) {
-    return (sorted_count == 1)
-               ? std::vector<NodeInfo>()
-               : std::vector<NodeInfo>(nodes_.begin() + 1, nodes_.begin() + sorted_count);
-  }
-
-  return std::vector<NodeInfo>(
-      nodes_.begin(), nodes_.begin() + std::min(sorted_count, static_cast<int>(number_to_get)));
+  std::vector<NodeInfo> closest_nodes;
+  auto closest(FindClosest(snapshot.nodes, snapshot.hot_entries, target_id, number_to_get + 1));
+  if (closest.empty())
+    return closest_nodes;
+
+  auto itr(closest.begin());
+  if (ignore_exact_match && ((*itr)->node_id == target_id))
+    ++itr;
+  for (; itr != closest.end() && closest_nodes.size() < number_to_get; ++itr)
+    closest_nodes.push_back(**itr);
+  return closest_nodes;
 }
 
 std::pair<bool, std::vector<NodeInfo>::iterator> RoutingTable::Find(
-    const NodeId& node_id, std::unique_lock<std::mutex>& lock) {
+    const NodeId& node_id, std::unique_lock<HotPathMutex>& lock) {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  auto itr(std::find_if(nodes_.begin(), nodes_.end(), [&node_id](const NodeInfo & node_info) {
-    return node_info.node_id == node_id;
-  }));
-  return std::make_pair(itr != nodes_.end(), itr);
+  auto found(node_index_.find(node_id));
+  if (found == node_index_.end())
+    return std::make_pair(false, nodes_.end());
+  return std::make_pair(true, nodes_.begin() + found->second);
 }
 
 std::pair<bool, std::vector<NodeInfo>::const_iterator> RoutingTable::Find(
-    const NodeId& node_id, std::unique_lock<std::mutex>& lock) const {
+    const NodeId& node_id, std::unique_lock<HotPathMutex>& lock) const {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  auto found(node_index_.find(node_id));
+  if (found == node_index_.end())
+    return std::make_pair(false, nodes_.cend());
+  return std::make_pair(true, nodes_.cbegin() + found->second);
+}
+
+std::vector<NodeInfo> RoutingTable::GetCloseNodesToConnect(
+    std::unique_lock<HotPathMutex>& lock) const {
   assert(lock.owns_lock());
   static_cast<void>(lock);
-  auto itr(std::find_if(nodes_.begin(), nodes_.end(), [&node_id](const NodeInfo & node_info) {
-    return node_info.node_id == node_id;
-  }));
-  return std::make_pair(itr != nodes_.end(), itr);
+  return std::vector<NodeInfo>(
+      nodes_.begin(),
+      nodes_.begin() +
+          std::min(static_cast<size_t>(Parameters::closest_nodes_size), nodes_.size()));
 }
 
 void RoutingTable::UpdateNetworkStatus(uint16_t size) const {
@@ -816,54 +1401,147 @@ void RoutingTable::UpdateNetworkStatus(uint16_t size) const {
   LOG(kVerbose) << DebugId(kNodeId_) << " Updating network status !!! " << (size * 100) / kMaxSize_;
 }
 
-size_t RoutingTable::size() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return nodes_.size();
+size_t RoutingTable::size() const { return GetSnapshot()->nodes.size(); }
+
+uint64_t RoutingTable::MemoryBytes() const {
+  std::shared_ptr<const Snapshot> snapshot(GetSnapshot());
+  uint64_t bytes(NodeInfoBytes(snapshot->nodes) + ContainerBytes(snapshot->hot_entries) +
+                 HashedContainerBytes(snapshot->index));
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  bytes += NodeInfoBytes(nodes_) + ContainerBytes(hot_entries_) +
+           HashedContainerBytes(node_index_) + HashedContainerBytes(public_key_fingerprints_);
+  for (const auto& fingerprint : public_key_fingerprints_)
+    bytes += fingerprint.capacity();
+  return bytes;
 }
 
-void RoutingTable::IpcSendGroupMatrix() const {
-  if (ipc_message_queue_) {
-    network_viewer::MatrixRecord matrix_record(kNodeId_);
-    std::vector<NodeInfo> matrix, close;
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      matrix = group_matrix_.GetUniqueNodes();
-      close = group_matrix_.GetConnectedPeers();
-    }
-    std::string printout("\tMatrix sent by: " + DebugId(kNodeId_) + "\n");
-    for (const auto& matrix_element : matrix) {
-      matrix_record.AddElement(matrix_element.node_id, network_viewer::ChildType::kMatrix);
-      printout += "\t\t" + DebugId(matrix_element.node_id) + " - kMatrix\n";
-    }
+uint64_t RoutingTable::GroupMatrixMemoryBytes() const {
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  return group_matrix_.MemoryBytes();
+}
 
-    std::sort(std::begin(close), std::end(close),
-              [this](const NodeInfo & lhs, const NodeInfo & rhs) {
-      return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
-    });
+void RoutingTable::SetRemovalWatermarks(uint16_t high, uint16_t low) {
+  removal_low_watermark_ = std::min(low, high);
+  removal_high_watermark_ = high;
+}
 
-    size_t index(0);
-    size_t limit(std::min(static_cast<size_t>(Parameters::group_size), close.size()));
-    for (; index < limit; ++index) {
-      matrix_record.AddElement(close[index].node_id, network_viewer::ChildType::kGroup);
-      printout += "\t\t" + DebugId(close[index].node_id) + " - kGroup\n";
-    }
-    for (; index < close.size(); ++index) {
-      matrix_record.AddElement(close[index].node_id, network_viewer::ChildType::kClosest);
-      printout += "\t\t" + DebugId(close[index].node_id) + " - kClosest\n";
+std::shared_ptr<const RoutingTable::Snapshot> RoutingTable::GetSnapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+void RoutingTable::PublishSnapshot(std::unique_lock<HotPathMutex>& lock) {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  auto snapshot(std::make_shared<Snapshot>());
+  snapshot->version = snapshot_->version + 1;
+  snapshot->nodes = nodes_;
+  snapshot->hot_entries = hot_entries_;
+  snapshot->index = node_index_;
+  snapshot->furthest_close_node_id = furthest_closest_node_id_;
+  snapshot->furthest_client_range_node_id = furthest_client_range_node_id_;
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(snapshot));
+  ++routes_version_;
+}
+
+void RoutingTable::UpdateCloseGroup(std::unique_lock<HotPathMutex>& lock) {
+  assert(lock.owns_lock());
+  static_cast<void>(lock);
+  // nodes_ is held sorted from kNodeId_, so the close group is its leading entries.
+  furthest_closest_node_id_ = (nodes_.size() >= Parameters::closest_nodes_size)
+                                  ? nodes_[Parameters::closest_nodes_size - 1].node_id
+                                  : (NodeId(NodeId::kMaxId) ^ kNodeId_);
+  furthest_client_range_node_id_ = (nodes_.size() >= 2U * Parameters::closest_nodes_size)
+                                       ? nodes_[2 * Parameters::closest_nodes_size - 1].node_id
+                                       : (NodeId(NodeId::kMaxId) ^ kNodeId_);
+}
+
+void RoutingTable::IpcSendGroupMatrix() {
+#ifdef TESTING
+  std::lock_guard<std::mutex> lock(ipc_mutex_);
+  ipc_matrix_changed_ = true;
+  // Started on the first change, so that a table which never changes costs no thread.
+  if (!ipc_publisher_.joinable() && !ipc_stop_)
+    ipc_publisher_ = std::thread([this] { IpcPublishGroupMatrix(); });
+#endif
+}
+
+void RoutingTable::IpcPublishGroupMatrix() {
+  std::unique_lock<std::mutex> lock(ipc_mutex_);
+  while (!ipc_stop_) {
+    ipc_cond_var_.wait_for(lock, Parameters::matrix_publish_interval, [this] { return ipc_stop_; });
+    // The changed flag is left set while no viewer is attached, so that the current matrix is sent
+    // as soon as one is.
+    if (ipc_stop_ || !ipc_matrix_changed_ || !OpenIpcMessageQueue())
+      continue;
+    ipc_matrix_changed_ = false;
+    lock.unlock();
+    bool sent(IpcSerialiseAndSendGroupMatrix());
+    lock.lock();
+    // The viewer has missed this update, so the next one is a snapshot, retried next interval.
+    if (!sent)
+      ipc_matrix_changed_ = true;
+  }
+}
+
+bool RoutingTable::OpenIpcMessageQueue() {
+  if (ipc_message_queue_)
+    return true;
+  try {
+    ipc_message_queue_.reset(new boost::interprocess::message_queue(
+        boost::interprocess::open_only, kMatrixUpdateQueueName));
+    if (static_cast<uint16_t>(ipc_message_queue_->get_max_msg_size()) <
+        (Parameters::closest_nodes_size + 1) * Parameters::closest_nodes_size * 2 * NodeId::kSize) {
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
     }
-    LOG(kInfo) << printout << '\n';
-    std::string serialised_matrix(matrix_record.Serialise());
-    ipc_message_queue_->try_send(serialised_matrix.c_str(), serialised_matrix.size(), 0);
   }
+  catch (const std::exception&) {
+    ipc_message_queue_.reset();
+  }
+  // A viewer which has only just attached has seen none of this node's updates.
+  ipc_updates_since_snapshot_ = Parameters::matrix_snapshot_period;
+  return static_cast<bool>(ipc_message_queue_);
+}
+
+bool RoutingTable::IpcSerialiseAndSendGroupMatrix() {
+  std::vector<NodeInfo> matrix, close;
+  {
+    std::lock_guard<HotPathMutex> lock(mutex_);
+    matrix = group_matrix_.GetUniqueNodes();
+    close = group_matrix_.GetConnectedPeers();
+  }
+  // Connected peers are also in the matrix, so their group or closest type overrides kMatrix.
+  MatrixRow row;
+  for (const auto& matrix_element : matrix)
+    row[matrix_element.node_id] = network_viewer::ChildType::kMatrix;
+  size_t limit(std::min(static_cast<size_t>(Parameters::group_size), close.size()));
+  for (size_t index(0); index < close.size(); ++index) {
+    row[close[index].node_id] =
+        index < limit ? network_viewer::ChildType::kGroup : network_viewer::ChildType::kClosest;
+  }
+
+  bool snapshot(ipc_updates_since_snapshot_ >= Parameters::matrix_snapshot_period);
+  MatrixUpdate update(snapshot ? SnapshotMatrixRow(kNodeId_, ipc_sequence_ + 1, row)
+                               : DiffMatrixRows(kNodeId_, ipc_sequence_ + 1, ipc_sent_row_, row));
+  if (!snapshot && update.changed.empty() && update.removed.empty())
+    return true;
+  std::string serialised_update(update.Serialise());
+  if (!ipc_message_queue_->try_send(serialised_update.c_str(), serialised_update.size(), 0)) {
+    ipc_updates_since_snapshot_ = Parameters::matrix_snapshot_period;
+    return false;
+  }
+  LOG(kVerbose) << "\tMatrix " << (snapshot ? "snapshot " : "diff ") << update.sequence
+                << " sent by: " << DebugId(kNodeId_) << " with " << update.changed.size()
+                << " changed, " << update.removed.size() << " removed";
+  ++ipc_sequence_;
+  ipc_updates_since_snapshot_ = snapshot ? 1 : ipc_updates_since_snapshot_ + 1;
+  ipc_sent_row_.swap(row);
+  return true;
 }
 
 std::string RoutingTable::PrintRoutingTable() {
   std::vector<NodeInfo> rt;
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::sort(nodes_.begin(), nodes_.end(), [&](const NodeInfo & lhs, const NodeInfo & rhs) {
-      return NodeId::CloserToTarget(lhs.node_id, rhs.node_id, kNodeId_);
-    });
+    std::lock_guard<HotPathMutex> lock(mutex_);
     rt = nodes_;
   }
   std::string s = "\n\n[" + DebugId(kNodeId_) +
@@ -19,10 +19,16 @@
 #ifndef MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 #define MAIDSAFE_ROUTING_ROUTING_TABLE_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -36,9 +42,19 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/group_cache.h"
 #include "maidsafe/routing/group_matrix.h"
+#include "maidsafe/routing/matrix_update.h"
+#include "maidsafe/routing/network_coordinates.h"
 #include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/node_id_hash.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/profiled_mutex.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/route_quality.h"
+#include "maidsafe/routing/routing_clock.h"
+#include "maidsafe/routing/table_summaries.h"
 
 namespace maidsafe {
 
@@ -55,6 +71,7 @@ class RoutingTableTest_BEH_CheckMockSendGroupChangeRpcs_Test;
 class RoutingTableTest_BEH_GroupUpdateFromConnectedPeer_Test;
 class NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
 class RoutingTableTest_FUNC_IsNodeIdInGroupRange_Test;
+class RoutingTableTest_BEH_GroupRangeView_Test;
 }
 
 namespace protobuf {
@@ -70,7 +87,8 @@ typedef std::function<void(std::vector<NodeInfo> /*new*/, std::vector<NodeInfo>
 class RoutingTable {
  public:
   RoutingTable(bool client_mode, const NodeId& node_id, const asymm::Keys& keys,
-               NetworkStatistics& network_statistics);
+               NetworkStatistics& network_statistics,
+               const NodeParameters& node_parameters = NodeParameters());
   virtual ~RoutingTable();
   void InitialiseFunctors(NetworkStatusFunctor network_status_functor,
                           std::function<void(const NodeInfo&, bool)> remove_node_functor,
@@ -79,16 +97,23 @@ class RoutingTable {
                           MatrixChangedFunctor matrix_change_functor);
   bool AddNode(const NodeInfo& peer,
                const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
+  // Adds all valid |peers| under a single lock acquisition, firing the matrix change, connected
+  // group change and network status functors at most once for the whole batch.  Returns the number
+  // of peers added.
+  size_t AddNodes(const std::vector<NodeInfo>& peers);
   bool CheckNode(const NodeInfo& peer);
   NodeInfo DropNode(const NodeId& node_to_drop, bool routing_only);
+  // Batch equivalent of DropNode.  Returns the nodes which were actually dropped.
+  std::vector<NodeInfo> DropNodes(const std::vector<NodeId>& nodes_to_drop, bool routing_only);
   bool ClosestToId(const NodeId& target_id);
 
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id) const;
   GroupRangeStatus IsNodeIdInGroupRange(const NodeId& group_id, const NodeId& node_id) const;
+  GroupRangeView GetGroupRangeView() const;
 
   bool IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer);
   bool IsThisNodeGroupLeader(const NodeId& target_id, NodeInfo& connected_peer,
-                             const std::vector<std::string>& exclude);
+                             const ExcludedNodes& exclude);
   bool GetNodeInfo(const NodeId& node_id, NodeInfo& node_info) const;
   bool IsThisNodeInRange(const NodeId& target_id, uint16_t range);
   bool IsThisNodeClosestTo(const NodeId& target_id, bool ignore_exact_match = false);
@@ -102,26 +127,77 @@ class RoutingTable {
   bool IsConnected(const NodeId& node_id);
   // Returns default-constructed NodeId if routing table size is zero
   NodeInfo GetClosestNode(const NodeId& target_id, bool ignore_exact_match = false);
-  NodeInfo GetClosestNode(const NodeId& target_id, const std::vector<std::string>& exclude,
+  NodeInfo GetClosestNode(const NodeId& target_id, const ExcludedNodes& exclude,
                           bool ignore_exact_match = false);
   //  NodeInfo GetNodeForSendingMessage(const NodeId& target_id, bool ignore_exact_match = false);
-  NodeInfo GetNodeForSendingMessage(const NodeId& target_id,
-                                    const std::vector<std::string>& exclude,
+  NodeInfo GetNodeForSendingMessage(const NodeId& target_id, const ExcludedNodes& exclude,
                                     bool ignore_exact_match = false);
+  // As GetNodeForSendingMessage for each of |target_ids|, but with every choice made from the same
+  // copy of the table and under a single hold of the group matrix's lock.
+  std::vector<NodeInfo> GetNodesForSendingMessages(const std::vector<NodeId>& target_ids,
+                                                   const ExcludedNodes& exclude,
+                                                   bool ignore_exact_match = false);
+  // Feed the per-peer latency estimates used when Parameters::latency_aware_routing is set and,
+  // given the peer's network coordinate, this node's own.  A negative |round_trip| only records
+  // the coordinate.
+  void RecordRoundTrip(const NodeId& peer_id, std::chrono::milliseconds round_trip,
+                       const std::vector<int32_t>& coordinates = std::vector<int32_t>());
+  void RecordSendResult(const NodeId& peer_id, bool success);
+  // For Parameters::lookahead_routing: this node's summary of its table, to give peers; a peer's
+  // summary of its own; and the peers whose summaries are due a refresh, once each per interval.
+  std::vector<uint64_t> TableSummary() const;
+  void RecordTableSummary(const NodeId& peer_id, const std::vector<uint64_t>& summary);
+  std::vector<NodeId> TakeStaleTableSummaries();
+  // Feeds route_quality_ with the hops a request to |destination_id| took, as its reply reported.
+  void RecordRouteHops(const NodeId& destination_id, int32_t hops);
   // Returns max NodeId if routing table size is less than requested node_number
   NodeInfo GetNthClosestNode(const NodeId& target_id, uint16_t node_number);
+  // As GetNthClosestNode(kNodeId(), 2 * Parameters::closest_nodes_size).node_id, the bound for
+  // clients this node will accept, but kept up to date as the table changes rather than searched
+  // for each time.
+  NodeId FurthestClientRangeNode() const;
   std::vector<NodeId> GetClosestNodes(const NodeId& target_id, uint16_t number_to_get);
   std::vector<NodeInfo> GetClosestMatrixNodes(const NodeId& target_id, uint16_t number_to_get);
+  // Allocation-free alternatives to the above.  Each calls |visitor| with up to |number_to_get|
+  // nodes in turn, closest to |target_id| first, stopping early if |visitor| returns false.
+  // VisitClosestNodes works from a snapshot held for the duration, so |visitor| may call back into
+  // the table; the matrix visitors run under mutex_, so theirs must not.
+  template <typename Visitor>
+  void VisitClosestNodes(const NodeId& target_id, uint16_t number_to_get, Visitor visitor) const;
+  template <typename Visitor>
+  void VisitClosestMatrixNodes(const NodeId& target_id, uint16_t number_to_get,
+                               Visitor visitor) const;
+  // Calls |visitor| with each node of the group matrix, as GetMatrixNodes() returns them.
+  template <typename Visitor>
+  void VisitMatrixNodes(Visitor visitor) const;
   std::vector<NodeId> GetGroup(const NodeId& target_id);
   NodeInfo GetRemovableNode(std::vector<std::string> attempted = std::vector<std::string>());
+  // Keeps |node_id| from being connected to again for Parameters::eviction_backoff, unless it's
+  // among this node's closest.
+  void RecordEviction(const NodeId& node_id);
   void GetNodesNeedingGroupUpdates(std::vector<NodeInfo>& nodes_needing_update);
   size_t size() const;
+  // Estimated heap bytes held by the table and its published snapshot, and by the group matrix,
+  // less the nodes' public keys (see MemoryStatistics).
+  uint64_t MemoryBytes() const;
+  uint64_t GroupMatrixMemoryBytes() const;
+  // Changes whenever a peer is added or dropped or the group matrix is updated, so that a cached
+  // result of GetNodeForSendingMessage can be checked for staleness.
+  uint64_t routes_version() const { return routes_version_; }
+  uint16_t kMaxSize() const { return kMaxSize_; }
   uint16_t kThresholdSize() const { return kThresholdSize_; }
+  // How many peers this node seeks to connect to (see Parameters::greedy_fraction).
+  uint16_t kGreedyFraction() const { return kGreedyFraction_; }
+  uint16_t removal_low_watermark() const { return removal_low_watermark_; }
+  uint16_t removal_high_watermark() const { return removal_high_watermark_; }
+  // Used by the table size tuning; |low| is capped at |high|.
+  void SetRemovalWatermarks(uint16_t high, uint16_t low);
   NodeId kNodeId() const { return kNodeId_; }
   asymm::PrivateKey kPrivateKey() const { return kKeys_.private_key; }
   asymm::PublicKey kPublicKey() const { return kKeys_.public_key; }
   NodeId kConnectionId() const { return kConnectionId_; }
   bool client_mode() const { return kClientMode_; }
+  NetworkCoordinates& network_coordinates() { return network_coordinates_; }
 
   friend class test::GenericNode;
   friend class GroupChangeHandler;
@@ -132,38 +208,130 @@ class RoutingTable {
   friend class test::RoutingTableTest_BEH_GroupUpdateFromConnectedPeer_Test;
   friend class test::NetworkStatisticsTest_BEH_IsIdInGroupRange_Test;
   friend class test::RoutingTableTest_FUNC_IsNodeIdInGroupRange_Test;
+  friend class test::RoutingTableTest_BEH_GroupRangeView_Test;
 
  private:
+  // The parts of a routing table entry read by closeness scans, held contiguously and parallel to
+  // nodes_ so that scans don't touch the keys and other metadata of each NodeInfo.
+  struct HotEntry {
+    HotEntry(Distance distance_in, int32_t bucket_in) : distance(distance_in), bucket(bucket_in) {}
+    Distance distance;  // from kNodeId_
+    int32_t bucket;
+  };
+
+  // Net group change accumulated over a settle window
+  struct PendingGroupChange {
+    PendingGroupChange()
+        : connected_peers_changed(false),
+          matrix_changed(false),
+          old_connected_peers(),
+          new_connected_peers(),
+          old_unique_ids(),
+          new_unique_ids(),
+          deadline() {}
+    bool connected_peers_changed, matrix_changed;
+    std::vector<NodeInfo> old_connected_peers, new_connected_peers;
+    std::vector<NodeId> old_unique_ids, new_unique_ids;
+    RoutingClock::time_point deadline;
+  };
+
+  // Immutable copy of nodes_, republished after every mutation so that the forwarding and
+  // range-check paths can read the table without taking mutex_.
+  struct Snapshot {
+    Snapshot()
+        : version(0), nodes(), hot_entries(), index(), furthest_close_node_id(),
+          furthest_client_range_node_id() {}
+    uint64_t version;
+    std::vector<NodeInfo> nodes;
+    std::vector<HotEntry> hot_entries;
+    std::unordered_map<NodeId, size_t, NodeIdHash> index;
+    NodeId furthest_close_node_id;
+    NodeId furthest_client_range_node_id;
+  };
+
   RoutingTable(const RoutingTable&);
   RoutingTable& operator=(const RoutingTable&);
   bool AddOrCheckNode(NodeInfo node, bool remove,
                       const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
   void SetBucketIndex(NodeInfo& node_info) const;
-  bool CheckPublicKeyIsUnique(const NodeInfo& node, std::unique_lock<std::mutex>& lock) const;
+  int32_t BucketIndex(const NodeId& node_id) const;
+  bool RecentlyEvicted(const NodeId& node_id);
+  bool CheckPublicKeyIsUnique(const NodeInfo& node, std::unique_lock<HotPathMutex>& lock) const;
   NodeInfo ResolveConnectionDuplication(const NodeInfo& new_duplicate_node, bool local_endpoint,
                                         NodeInfo& existing_node);
   std::shared_ptr<MatrixChange> UpdateCloseNodeChange(
-      std::unique_lock<std::mutex>& lock, const NodeInfo& peer,
+      std::unique_lock<HotPathMutex>& lock, const NodeInfo& peer,
       std::vector<NodeInfo>& new_connected_nodes,
       const std::vector<NodeInfo>& matrix_update = std::vector<NodeInfo>());
   bool MakeSpaceForNodeToBeAdded(const NodeInfo& node, bool remove, NodeInfo& removed_node,
-                                 std::unique_lock<std::mutex>& lock);
-  uint16_t PartialSortFromTarget(const NodeId& target, uint16_t number,
-                                 std::unique_lock<std::mutex>& lock);
-  void NthElementSortFromTarget(const NodeId& target, uint16_t nth_element,
-                                std::unique_lock<std::mutex>& lock);
+                                 std::unique_lock<HotPathMutex>& lock);
+  // See Parameters::proximity_replacement_percent
+  bool MakeSpaceByProximity(const NodeInfo& node, bool remove, NodeInfo& removed_node,
+                            std::unique_lock<HotPathMutex>& lock);
+  // Measured if possible, else predicted from network coordinates; negative if neither is known
+  double ExpectedRoundTrip(const NodeId& peer_id) const;
+  void InsertNode(const NodeInfo& node, std::unique_lock<HotPathMutex>& lock);
+  std::vector<NodeInfo>::iterator EraseNode(std::vector<NodeInfo>::iterator itr,
+                                            std::unique_lock<HotPathMutex>& lock);
+  void ReindexFrom(std::vector<NodeInfo>::difference_type index,
+                   std::unique_lock<HotPathMutex>& lock);
+  // Returns up to |number| iterators into nodes_, ordered by closeness to |target|.  Doesn't
+  // reorder nodes_.
+  std::vector<std::vector<NodeInfo>::const_iterator> FindClosest(
+      const NodeId& target, uint16_t number, std::unique_lock<HotPathMutex>& lock) const;
+  std::vector<std::vector<NodeInfo>::const_iterator> FindClosest(
+      const std::vector<NodeInfo>& nodes, const std::vector<HotEntry>& hot_entries,
+      const NodeId& target, uint16_t number) const;
+  std::shared_ptr<const Snapshot> GetSnapshot() const;
+  void PublishSnapshot(std::unique_lock<HotPathMutex>& lock);
+  // Drops the memoised GetGroup answers |matrix_change| affects.  |matrix_change| may be null.
+  void InvalidateGroupMemo(const std::shared_ptr<MatrixChange>& matrix_change,
+                           std::unique_lock<HotPathMutex>& lock);
+  // Refreshes furthest_closest_node_id_ from nodes_.  Must be called after every mutation of
+  // nodes_, before the snapshot is published.
+  void UpdateCloseGroup(std::unique_lock<HotPathMutex>& lock);
   NodeId FurthestCloseNode();
-  std::vector<NodeInfo> GetClosestNodeInfo(const NodeId& target_id, uint16_t number_to_get,
-                                           bool ignore_exact_match = false);
+  std::vector<NodeInfo> GetClosestNodeInfo(const Snapshot& snapshot, const NodeId& target_id,
+                                           uint16_t number_to_get, bool ignore_exact_match = false);
+  NodeInfo GetClosestNode(const Snapshot& snapshot, const NodeId& target_id,
+                          const ExcludedNodes& exclude, bool ignore_exact_match);
+  // Lowest latency peer among those closest to target_id; closest_peer if there's no choice
+  NodeInfo GetFastestCloserNode(const Snapshot& snapshot, const NodeId& target_id,
+                                const ExcludedNodes& exclude, bool ignore_exact_match,
+                                const NodeInfo& closest_peer);
+  // Peer among those closest to target_id which, with the peers it summarised, comes closest to
+  // target_id; closest_peer if none does better
+  NodeInfo GetLookaheadNode(const Snapshot& snapshot, const NodeId& target_id,
+                            const ExcludedNodes& exclude, bool ignore_exact_match,
+                            const NodeInfo& closest_peer);
   std::pair<bool, std::vector<NodeInfo>::iterator> Find(const NodeId& node_id,
-                                                        std::unique_lock<std::mutex>& lock);
+                                                        std::unique_lock<HotPathMutex>& lock);
   std::pair<bool, std::vector<NodeInfo>::const_iterator> Find(
-      const NodeId& node_id, std::unique_lock<std::mutex>& lock) const;
+      const NodeId& node_id, std::unique_lock<HotPathMutex>& lock) const;
   void UpdateNetworkStatus(uint16_t size) const;
+  std::vector<NodeInfo> GetCloseNodesToConnect(std::unique_lock<HotPathMutex>& lock) const;
   void UpdateConnectedPeersMatrix(const std::vector<NodeInfo>& new_connected_peers,
                                   const std::vector<NodeInfo>& old_connected_peers);
+  // Fires the connected group change and matrix change functors, immediately if
+  // Parameters::group_change_settle_window is zero or the close group has changed size, otherwise
+  // one settle window after the first change held back, merged with any which follow it.
+  void NotifyGroupChange(std::shared_ptr<MatrixChange> matrix_change,
+                         const std::vector<NodeInfo>& new_connected_peers,
+                         const std::vector<NodeInfo>& old_connected_peers);
+  void FlushGroupChange();
+  // Run by group_change_notifier_, which is only started once a change has been held back.
+  void CoalesceGroupChanges();
 
-  void IpcSendGroupMatrix() const;
+  // Flags the group matrix as changed for the background publisher, starting it if need be.  A
+  // no-op unless built with TESTING.
+  void IpcSendGroupMatrix();
+  // Run by ipc_publisher_: sends at most one MatrixUpdate per matrix_publish_interval, and only
+  // once a network_viewer has created the message queue.
+  void IpcPublishGroupMatrix();
+  bool OpenIpcMessageQueue();
+  // Sends the changes to the matrix since the last update, or all of it if a snapshot is due.
+  // Returns false if the queue was full.
+  bool IpcSerialiseAndSendGroupMatrix();
   std::string PrintRoutingTable();
   void PrintGroupMatrix();
 
@@ -173,19 +341,79 @@ class RoutingTable {
   const asymm::Keys kKeys_;
   const uint16_t kMaxSize_;
   const uint16_t kThresholdSize_;
-  mutable std::mutex mutex_;
+  const uint16_t kGreedyFraction_;
+  std::atomic<uint16_t> removal_high_watermark_, removal_low_watermark_;
+  mutable HotPathMutex mutex_;
+  // kClosestNodesSize'th closest node to kNodeId_, or the furthest ID if the table isn't full
   NodeId furthest_closest_node_id_;
+  // Likewise for the (2 * kClosestNodesSize)'th, the limit of the range clients are accepted from
+  NodeId furthest_client_range_node_id_;
   std::function<void(const NodeInfo&, bool)> remove_node_functor_;
   NetworkStatusFunctor network_status_functor_;
   RemoveFurthestUnnecessaryNode remove_furthest_node_;
   ConnectedGroupChangeFunctor connected_group_change_functor_;
   MatrixChangedFunctor matrix_change_functor_;
+  // Held sorted by distance from kNodeId_ (and hence by bucket)
   std::vector<NodeInfo> nodes_;
+  std::vector<HotEntry> hot_entries_;
+  // Position of each entry of nodes_, keyed by node ID
+  std::unordered_map<NodeId, size_t, NodeIdHash> node_index_;
+  // SHA1 of the encoded public key of each entry of nodes_
+  std::unordered_set<std::string> public_key_fingerprints_;
+  std::shared_ptr<const Snapshot> snapshot_;
+  std::atomic<uint64_t> routes_version_;
   GroupMatrix group_matrix_;
+  // Recent GetGroup answers, invalidated under mutex_ as each matrix change is made
+  GroupCache group_memo_;
   std::unique_ptr<boost::interprocess::message_queue> ipc_message_queue_;
   NetworkStatistics& network_statistics_;
+  NetworkCoordinates network_coordinates_;
+  TableSummaries table_summaries_;
+  std::mutex ipc_mutex_;
+  std::condition_variable ipc_cond_var_;
+  bool ipc_matrix_changed_, ipc_stop_;
+  std::thread ipc_publisher_;
+  // Only used by ipc_publisher_, and by the destructor once it has stopped.
+  MatrixRow ipc_sent_row_;
+  uint64_t ipc_sequence_;
+  uint16_t ipc_updates_since_snapshot_;
+  std::mutex group_change_mutex_;
+  // Held while firing, so that batches reach the functors in order
+  std::mutex group_change_fire_mutex_;
+  std::condition_variable group_change_cond_var_;
+  PendingGroupChange pending_group_change_;
+  bool group_change_stop_;
+  std::thread group_change_notifier_;
+  std::mutex evicted_mutex_;
+  // Evicted node IDs, to the times they may next be connected to
+  std::unordered_map<NodeId, std::chrono::steady_clock::time_point, NodeIdHash> evicted_;
+  RouteQuality route_quality_;
 };
 
+template <typename Visitor>
+void RoutingTable::VisitClosestNodes(const NodeId& target_id, uint16_t number_to_get,
+                                     Visitor visitor) const {
+  auto snapshot(GetSnapshot());
+  for (const auto& closest :
+       FindClosest(snapshot->nodes, snapshot->hot_entries, target_id, number_to_get)) {
+    if (!visitor(*closest))
+      return;
+  }
+}
+
+template <typename Visitor>
+void RoutingTable::VisitClosestMatrixNodes(const NodeId& target_id, uint16_t number_to_get,
+                                           Visitor visitor) const {
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  group_matrix_.VisitClosestUniqueNodes(target_id, number_to_get, visitor);
+}
+
+template <typename Visitor>
+void RoutingTable::VisitMatrixNodes(Visitor visitor) const {
+  std::lock_guard<HotPathMutex> lock(mutex_);
+  group_matrix_.VisitUniqueNodes(visitor);
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
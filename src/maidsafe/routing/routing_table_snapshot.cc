@@ -0,0 +1,98 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/routing_table_snapshot.h"
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+asymm::PlainText SignedPeerContent(const protobuf::RoutingTableSnapshot::Peer& protobuf_peer) {
+  return asymm::PlainText(protobuf_peer.node_id() + protobuf_peer.connection_id() +
+                          protobuf_peer.public_key());
+}
+
+}  // unnamed namespace
+
+std::string SerialiseRoutingTableSnapshot(const std::vector<SnapshotPeer>& peers,
+                                          const asymm::PrivateKey& private_key) {
+  protobuf::RoutingTableSnapshot protobuf_snapshot;
+  for (const auto& peer : peers) {
+    auto protobuf_peer(protobuf_snapshot.add_peers());
+    protobuf_peer->set_node_id(peer.node.node_id.string());
+    protobuf_peer->set_connection_id(peer.node.connection_id.string());
+    protobuf_peer->set_public_key(asymm::EncodeKey(peer.node.public_key).string());
+    protobuf_peer->set_nat_type(NatTypeProtobuf(peer.node.nat_type));
+    if (!peer.endpoint.address().is_unspecified())
+      SetProtobufEndpoint(peer.endpoint, protobuf_peer->mutable_endpoint());
+    protobuf_peer->set_signature(
+        asymm::Sign(SignedPeerContent(*protobuf_peer), private_key).string());
+  }
+  std::string serialised_snapshot;
+  if (!protobuf_snapshot.SerializeToString(&serialised_snapshot)) {
+    LOG(kError) << "Failed to serialise routing table snapshot.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  }
+  return serialised_snapshot;
+}
+
+std::vector<SnapshotPeer> ParseRoutingTableSnapshot(const std::string& serialised_snapshot,
+                                                    const asymm::PublicKey& public_key) {
+  protobuf::RoutingTableSnapshot protobuf_snapshot;
+  if (!protobuf_snapshot.ParseFromString(serialised_snapshot)) {
+    LOG(kError) << "Could not parse routing table snapshot.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  std::vector<SnapshotPeer> peers;
+  peers.reserve(protobuf_snapshot.peers_size());
+  for (const auto& protobuf_peer : protobuf_snapshot.peers()) {
+    if (!CheckId(protobuf_peer.node_id()) || !CheckId(protobuf_peer.connection_id())) {
+      LOG(kWarning) << "Skipping routing table snapshot entry with an invalid ID.";
+      continue;
+    }
+    if (!protobuf_peer.has_signature() || protobuf_peer.signature().empty() ||
+        !asymm::CheckSignature(SignedPeerContent(protobuf_peer),
+                               asymm::Signature(protobuf_peer.signature()), public_key)) {
+      LOG(kWarning) << "Skipping routing table snapshot entry which isn't signed by this node.";
+      continue;
+    }
+    SnapshotPeer peer;
+    peer.node.node_id = NodeId(protobuf_peer.node_id());
+    peer.node.connection_id = NodeId(protobuf_peer.connection_id());
+    peer.node.public_key =
+        asymm::DecodeKey(asymm::EncodedPublicKey(protobuf_peer.public_key()));
+    peer.node.nat_type = NatTypeFromProtobuf(protobuf_peer.nat_type());
+    if (protobuf_peer.has_endpoint())
+      peer.endpoint = GetEndpointFromProtobuf(protobuf_peer.endpoint());
+    peers.push_back(peer);
+  }
+  return peers;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
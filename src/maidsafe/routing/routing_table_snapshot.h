@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_ROUTING_TABLE_SNAPSHOT_H_
+#define MAIDSAFE_ROUTING_ROUTING_TABLE_SNAPSHOT_H_
+
+#include <string>
+#include <vector>
+
+#include "boost/asio/ip/udp.hpp"
+
+#include "maidsafe/common/rsa.h"
+
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// A routing table entry as kept across a restart.  |endpoint| is unspecified unless the peer could
+// be bootstrapped off directly.
+struct SnapshotPeer {
+  SnapshotPeer() : node(), endpoint() {}
+  NodeInfo node;
+  boost::asio::ip::udp::endpoint endpoint;
+};
+
+// Each peer is signed with |private_key|, binding its public key to its IDs.
+std::string SerialiseRoutingTableSnapshot(const std::vector<SnapshotPeer>& peers,
+                                          const asymm::PrivateKey& private_key);
+// Throws if |serialised_snapshot| can't be parsed.  Peers whose signature doesn't verify against
+// |public_key| are skipped, so a snapshot altered since is never trusted for its keys.
+std::vector<SnapshotPeer> ParseRoutingTableSnapshot(const std::string& serialised_snapshot,
+                                                    const asymm::PublicKey& public_key);
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_ROUTING_TABLE_SNAPSHOT_H_
@@ -23,7 +23,9 @@
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/routing/data_compression.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/utils.h"
 
@@ -60,7 +62,8 @@ protobuf::Message Ping(const NodeId& node_id, const std::string& identity) {
 protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_endpoint,
                           const NodeId& this_node_id, const NodeId& this_connection_id,
                           bool client_node, rudp::NatType nat_type, bool relay_message,
-                          NodeId relay_connection_id) {
+                          NodeId relay_connection_id, bool shortcut,
+                          const std::vector<int32_t>& coordinates) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!this_node_id.IsZero() && "Invalid my node_id");
   assert(!this_connection_id.IsZero() && "Invalid this_connection_id");
@@ -76,6 +79,11 @@ protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_e
   contact->set_node_id(this_node_id.string());
   contact->set_connection_id(this_connection_id.string());
   contact->set_nat_type(NatTypeProtobuf(nat_type));
+  contact->set_decodable_compression(DecodableCompression());
+  for (const auto& coordinate : coordinates)
+    contact->add_coordinates(coordinate);
+  if (shortcut)
+    protobuf_connect_request.set_shortcut(true);
 #ifdef TESTING
   protobuf_connect_request.set_timestamp(GetTimeStamp());
 #endif
@@ -150,7 +158,7 @@ protobuf::Message FindNodes(const NodeId& node_id, const NodeId& this_node_id,
   message.set_replication(1);
   message.set_type(static_cast<int32_t>(MessageType::kFindNodes));
   message.set_request(true);
-  message.add_route_history(this_node_id.string());
+  AddToRouteHistory(message, this_node_id);
   message.set_client_node(false);
   message.set_visited(false);
   message.set_id(RandomUint32() % 10000);
@@ -170,7 +178,8 @@ protobuf::Message FindNodes(const NodeId& node_id, const NodeId& this_node_id,
 
 protobuf::Message ConnectSuccess(const NodeId& node_id, const NodeId& this_node_id,
                                  const NodeId& this_connection_id, bool requestor,
-                                 bool client_node) {
+                                 bool client_node, bool streamlined,
+                                 const std::vector<NodeId>& close_ids, bool shortcut) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!this_node_id.IsZero() && "Invalid my node_id");
   assert(!this_connection_id.IsZero() && "Invalid this_connection_id");
@@ -179,6 +188,13 @@ protobuf::Message ConnectSuccess(const NodeId& node_id, const NodeId& this_node_
   protobuf_connect_success.set_node_id(this_node_id.string());
   protobuf_connect_success.set_connection_id(this_connection_id.string());
   protobuf_connect_success.set_requestor(requestor);
+  if (streamlined) {
+    protobuf_connect_success.set_streamlined(true);
+    for (const auto& close_id : close_ids)
+      protobuf_connect_success.add_close_ids(close_id.string());
+  }
+  if (shortcut)
+    protobuf_connect_success.set_shortcut(true);
   message.set_destination_id(node_id.string());
   message.set_routing_message(true);
   message.add_data(protobuf_connect_success.SerializeAsString());
@@ -225,20 +241,12 @@ protobuf::Message ConnectSuccessAcknowledgement(const NodeId& node_id, const Nod
   return message;
 }
 
-protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
-                                     const std::vector<NodeInfo>& closest_nodes) {
-  assert(!node_id.IsZero() && "Invalid node_id");
-  assert(!my_node_id.IsZero() && "Invalid my node_id");
-  // assert(!close_nodes.empty() && "Empty close nodes");
+namespace {
+
+protobuf::Message ClosestNodesUpdateMessage(
+    const NodeId& node_id, const NodeId& my_node_id,
+    const protobuf::ClosestNodesUpdate& closest_nodes_update) {
   protobuf::Message message;
-  protobuf::ClosestNodesUpdate closest_nodes_update;
-  closest_nodes_update.set_node(my_node_id.string());
-  for (const auto& i : closest_nodes) {
-    protobuf::BasicNodeInfo* basic_node_info;
-    basic_node_info = closest_nodes_update.add_nodes_info();
-    basic_node_info->set_node_id(i.node_id.string());
-    basic_node_info->set_rank(i.rank);
-  }
   message.set_destination_id(node_id.string());
   message.set_source_id(my_node_id.string());
   message.set_routing_message(true);
@@ -254,6 +262,57 @@ protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_nod
   return message;
 }
 
+}  // unnamed namespace
+
+protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
+                                     const std::vector<NodeInfo>& closest_nodes,
+                                     uint32_t sequence) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  // assert(!close_nodes.empty() && "Empty close nodes");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  for (const auto& i : closest_nodes) {
+    protobuf::BasicNodeInfo* basic_node_info;
+    basic_node_info = closest_nodes_update.add_nodes_info();
+    basic_node_info->set_node_id(i.node_id.string());
+    basic_node_info->set_rank(i.rank);
+  }
+  closest_nodes_update.set_sequence(sequence);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
+protobuf::Message ClosestNodesUpdateDelta(const NodeId& node_id, const NodeId& my_node_id,
+                                          const std::vector<NodeInfo>& added_nodes,
+                                          const std::vector<NodeId>& removed_nodes,
+                                          uint32_t sequence) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  for (const auto& i : added_nodes) {
+    protobuf::BasicNodeInfo* basic_node_info;
+    basic_node_info = closest_nodes_update.add_nodes_info();
+    basic_node_info->set_node_id(i.node_id.string());
+    basic_node_info->set_rank(i.rank);
+  }
+  for (const auto& i : removed_nodes)
+    closest_nodes_update.add_removed_nodes(i.string());
+  closest_nodes_update.set_sequence(sequence);
+  closest_nodes_update.set_delta(true);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
+protobuf::Message ClosestNodesUpdateFullStateRequest(const NodeId& node_id,
+                                                     const NodeId& my_node_id) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  closest_nodes_update.set_node(my_node_id.string());
+  closest_nodes_update.set_request_full_state(true);
+  return ClosestNodesUpdateMessage(node_id, my_node_id, closest_nodes_update);
+}
+
 protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id) {
   assert(!node_id.IsZero() && "Invalid node_id");
   assert(!my_node_id.IsZero() && "Invalid my node_id");
@@ -276,6 +335,32 @@ protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id) {
   return message;
 }
 
+protobuf::Message Leave(const NodeId& node_id, const NodeId& my_node_id,
+                        const std::vector<NodeId>& replacement_ids, bool client_node) {
+  assert(!node_id.IsZero() && "Invalid node_id");
+  assert(!my_node_id.IsZero() && "Invalid my node_id");
+  protobuf::Message message;
+  protobuf::LeaveRequest leave_request;
+  for (const auto& replacement_id : replacement_ids) {
+    if (replacement_id != node_id)
+      leave_request.add_replacement_ids(replacement_id.string());
+  }
+  message.add_data(leave_request.SerializeAsString());
+  message.set_destination_id(node_id.string());
+  message.set_source_id(my_node_id.string());
+  message.set_routing_message(true);
+  message.set_direct(true);
+  message.set_replication(1);
+  message.set_type(static_cast<int32_t>(MessageType::kLeave));
+  message.set_request(true);
+  message.set_one_way(true);
+  message.set_client_node(client_node);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  message.set_id(RandomUint32() % 10000);
+  assert(message.IsInitialized() && "Unintialised message");
+  return message;
+}
+
 }  // namespace rpcs
 
 }  // namespace routing
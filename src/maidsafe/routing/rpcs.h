@@ -46,7 +46,9 @@ protobuf::Message Connect(const NodeId& node_id, const rudp::EndpointPair& our_e
                           const NodeId& this_node_id, const NodeId& this_connection_id,
                           bool client_node = false,
                           rudp::NatType nat_type = rudp::NatType::kUnknown,
-                          bool relay_message = false, NodeId relay_connection_id = NodeId());
+                          bool relay_message = false, NodeId relay_connection_id = NodeId(),
+                          bool shortcut = false,
+                          const std::vector<int32_t>& coordinates = std::vector<int32_t>());
 
 protobuf::Message Remove(const NodeId& node_id, const NodeId& this_node_id,
                          const NodeId& this_connection_id,
@@ -62,7 +64,9 @@ protobuf::Message ProxyConnect(const NodeId& node_id, const NodeId& this_node_id
 
 protobuf::Message ConnectSuccess(const NodeId& node_id, const NodeId& this_node_id,
                                  const NodeId& this_connection_id, bool requestor,
-                                 bool client_node);
+                                 bool client_node, bool streamlined = false,
+                                 const std::vector<NodeId>& close_ids = std::vector<NodeId>(),
+                                 bool shortcut = false);
 
 protobuf::Message ConnectSuccessAcknowledgement(const NodeId& node_id, const NodeId& this_node_id,
                                                 const NodeId& this_connection_id,
@@ -71,10 +75,23 @@ protobuf::Message ConnectSuccessAcknowledgement(const NodeId& node_id, const Nod
                                                 bool client_node);
 
 protobuf::Message ClosestNodesUpdate(const NodeId& node_id, const NodeId& my_node_id,
-                                     const std::vector<NodeInfo>& closest_nodes);
+                                     const std::vector<NodeInfo>& closest_nodes,
+                                     uint32_t sequence = 0);
+
+protobuf::Message ClosestNodesUpdateDelta(const NodeId& node_id, const NodeId& my_node_id,
+                                          const std::vector<NodeInfo>& added_nodes,
+                                          const std::vector<NodeId>& removed_nodes,
+                                          uint32_t sequence);
+
+protobuf::Message ClosestNodesUpdateFullStateRequest(const NodeId& node_id,
+                                                     const NodeId& my_node_id);
 
 protobuf::Message GetGroup(const NodeId& node_id, const NodeId& my_node_id);
 
+// Tells the peer |node_id| that this node is leaving, suggesting |replacement_ids| to connect to.
+protobuf::Message Leave(const NodeId& node_id, const NodeId& my_node_id,
+                        const std::vector<NodeId>& replacement_ids, bool client_node);
+
 }  // namespace rpcs
 
 }  // namespace routing
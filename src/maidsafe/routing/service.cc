@@ -20,6 +20,7 @@
 
 #include <string>
 #include <algorithm>
+#include <chrono>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -30,11 +31,15 @@
 #include "maidsafe/rudp/return_codes.h"
 
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/data_compression.h"
 #include "maidsafe/routing/group_change_handler.h"
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/network_coordinates.h"
 #include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/pending_requests.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/utils.h"
@@ -54,7 +59,14 @@ Service::Service(RoutingTable& routing_table, ClientRoutingTable& client_routing
     : routing_table_(routing_table),
       client_routing_table_(client_routing_table),
       network_(network),
-      request_public_key_functor_() {}
+      request_public_key_functor_(),
+      public_key_prefetch_(),
+      memory_budget_(),
+      connect_admission_(Parameters::max_concurrent_connect_attempts,
+                         Parameters::max_queued_connect_requests,
+                         Parameters::connect_attempt_timeout),
+      post_functor_(),
+      retry_posted_(false) {}
 
 Service::~Service() {}
 
@@ -73,15 +85,20 @@ void Service::Ping(protobuf::Message& message) {
     return;
   }
   ping_response.set_pong(true);
-  ping_response.set_original_request(message.data(0));
-  ping_response.set_original_signature(message.signature());
+  for (const auto& coordinate : routing_table_.network_coordinates().Local())
+    ping_response.add_coordinates(coordinate);
+  if (Parameters::lookahead_routing && !routing_table_.client_mode()) {
+    for (const auto& prefix : routing_table_.TableSummary())
+      ping_response.add_table_summary(prefix);
+  }
+  TakeSignedOriginalRequest(message, ping_response);
 #ifdef TESTING
   ping_response.set_timestamp(GetTimeStamp());
 #endif
   message.set_request(false);
-  message.clear_route_history();
+  message.clear_route_history_tags();
   message.clear_data();
-  message.add_data(ping_response.SerializeAsString());
+  ping_response.SerializeToString(message.add_data());
   message.set_destination_id(message.source_id());
   message.set_source_id(routing_table_.kNodeId().string());
   message.set_hops_to_live(Parameters::hops_to_live);
@@ -89,6 +106,13 @@ void Service::Ping(protobuf::Message& message) {
 }
 
 void Service::Connect(protobuf::Message& message) {
+  DoConnect(message, false);
+  // Attempts may have timed out, freeing turns for requests already waiting.
+  if (connect_admission_.queued() != 0)
+    ScheduleRetryQueuedConnects();
+}
+
+void Service::DoConnect(protobuf::Message& message, bool from_queue) {
   if (message.destination_id() != routing_table_.kNodeId().string()) {
     // Message not for this node and we should not pass it on.
     LOG(kError) << "Message not for this node.";
@@ -112,6 +136,10 @@ void Service::Connect(protobuf::Message& message) {
   NodeInfo peer_node;
   peer_node.node_id = NodeId(connect_request.contact().node_id());
   peer_node.connection_id = NodeId(connect_request.contact().connection_id());
+  // Remembered so that the checks below can weigh the requester's predicted latency.
+  peer_node.dimension_list = CoordinatesFrom(connect_request.contact().coordinates());
+  routing_table_.network_coordinates().Update(peer_node.node_id, peer_node.dimension_list,
+                                              std::chrono::milliseconds(-1));
   LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "]"
                 << " received Connect request from " << DebugId(peer_node.node_id);
   rudp::EndpointPair this_endpoint_pair, peer_endpoint_pair;
@@ -126,38 +154,49 @@ void Service::Connect(protobuf::Message& message) {
     return;
   }
 
+  // Requests already waiting are answered first.
+  const bool kAdmitted((from_queue || connect_admission_.queued() == 0) &&
+                       connect_admission_.TryAdmit(peer_node.node_id, RoutingClock::now()));
+  if (!kAdmitted && connect_admission_.Queue(message, RoutingClock::now())) {
+    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] queued Connect request from "
+                  << DebugId(peer_node.node_id);
+    message.Clear();
+    return;
+  }
+
   // Prepare response
   connect_response.set_answer(protobuf::ConnectResponseType::kRejected);
-#ifdef TESTING
-  connect_response.set_timestamp(GetTimeStamp());
-#endif
-  connect_response.set_original_request(message.data(0));
-  connect_response.set_original_signature(message.signature());
-
-  message.clear_route_history();
-  message.clear_data();
-  message.set_direct(true);
-  message.set_replication(1);
-  message.set_client_node(routing_table_.client_mode());
-  message.set_request(false);
-  message.set_hops_to_live(Parameters::hops_to_live);
-  if (message.has_source_id())
-    message.set_destination_id(message.source_id());
-  else
-    message.clear_destination_id();
-  message.set_source_id(routing_table_.kNodeId().string());
+  const bool kPeerIsClient(message.client_node());
+  const bool kShortcut(connect_request.shortcut());
+  MakeConnectReply(message, connect_response);
+
+  if (!kAdmitted) {
+    LOG(kInfo) << "Too many connect attempts running to answer " << DebugId(peer_node.node_id);
+    connect_response.set_answer(protobuf::ConnectResponseType::kConnectAttemptAlreadyRunning);
+    connect_response.SerializeToString(message.add_data());
+    return;
+  }
 
   // Check rudp & routing
   bool check_node_succeeded(false);
-  if (message.client_node()) {  // Client node, check non-routing table
+  if (kPeerIsClient && memory_budget_ && !memory_budget_->AdmitClient()) {
+    LOG(kInfo) << "[" << DebugId(routing_table_.kNodeId()) << "] over memory budget; refusing "
+               << "client " << DebugId(peer_node.node_id);
+  } else if (kShortcut) {
+    // Shortcuts are only made between vaults, and aren't held in the routing table.
+    check_node_succeeded = !kPeerIsClient && !routing_table_.client_mode() &&
+                           !routing_table_.Contains(peer_node.node_id) &&
+                           network_.shortcuts().Admits(peer_node.node_id);
+    LOG(kVerbose) << "Shortcut connect request - "
+                  << (check_node_succeeded ? "admitted." : "refused.");
+  } else if (message.client_node()) {  // Client node, check non-routing table
     LOG(kVerbose) << "Client connect request - will check non-routing table.";
-    NodeId furthest_close_node_id =
-        routing_table_.GetNthClosestNode(routing_table_.kNodeId(),
-                                         2 * Parameters::closest_nodes_size).node_id;
-    check_node_succeeded = client_routing_table_.CheckNode(peer_node, furthest_close_node_id);
+    check_node_succeeded =
+        client_routing_table_.CheckNode(peer_node, routing_table_.FurthestClientRangeNode());
   } else {
     LOG(kVerbose) << "Server connect request - will check routing table.";
-    check_node_succeeded = routing_table_.CheckNode(peer_node);
+    check_node_succeeded = routing_table_.CheckNode(peer_node) &&
+                           (kPeerIsClient || WouldBeKept(peer_node.node_id));
   }
 
   if (check_node_succeeded) {
@@ -176,13 +215,15 @@ void Service::Connect(protobuf::Message& message) {
                     << ". peer_endpoint_pair.external = " << peer_endpoint_pair.external
                     << ", peer_endpoint_pair.local = " << peer_endpoint_pair.local
                     << ". Rudp returned :" << ret_val;
-        message.add_data(connect_response.SerializeAsString());
+        connect_admission_.Release(peer_node.node_id);
+        connect_response.SerializeToString(message.add_data());
         return;
       } else {  // Resolving collision by giving priority to lesser node id.
         if (!CheckPriority(peer_node.node_id, routing_table_.kNodeId())) {
           LOG(kInfo) << "Already ongoing attempt with : " << DebugId(peer_node.connection_id);
           connect_response.set_answer(protobuf::ConnectResponseType::kConnectAttemptAlreadyRunning);
-          message.add_data(connect_response.SerializeAsString());
+          connect_admission_.Release(peer_node.node_id);
+          connect_response.SerializeToString(message.add_data());
           return;
         }
       }
@@ -192,9 +233,18 @@ void Service::Connect(protobuf::Message& message) {
             !this_endpoint_pair.local.address().is_unspecified()) &&
            "Unspecified endpoint after GetAvailableEndpoint success.");
 
+    bool streamlined(!kShortcut && OffersStreamlinedHandshake(network_, peer_node.node_id,
+                                                              peer_node.connection_id));
+    std::vector<NodeId> close_ids;
+    if (streamlined) {
+      // The close IDs which would otherwise follow in this node's acknowledgement
+      close_ids = CloseIdsForPeer(routing_table_, peer_node.node_id, kPeerIsClient);
+      if (!kPeerIsClient && public_key_prefetch_)
+        public_key_prefetch_->Prefetch(peer_node.node_id);
+    }
     int add_result(AddToRudp(network_, routing_table_.kNodeId(), routing_table_.kConnectionId(),
                              peer_node.node_id, peer_node.connection_id, peer_endpoint_pair, false,
-                             routing_table_.client_mode()));
+                             routing_table_.client_mode(), streamlined, close_ids, kShortcut));
     if (rudp::kSuccess == add_result) {
       connect_response.set_answer(protobuf::ConnectResponseType::kAccepted);
 
@@ -202,6 +252,11 @@ void Service::Connect(protobuf::Message& message) {
       connect_response.mutable_contact()->set_connection_id(
           routing_table_.kConnectionId().string());
       connect_response.mutable_contact()->set_nat_type(NatTypeProtobuf(this_nat_type));
+      connect_response.mutable_contact()->set_decodable_compression(DecodableCompression());
+      for (const auto& coordinate : routing_table_.network_coordinates().Local())
+        connect_response.mutable_contact()->add_coordinates(coordinate);
+      network_.SetDecodableCompression(peer_node.connection_id,
+                                       connect_request.contact().decodable_compression());
 
       SetProtobufEndpoint(this_endpoint_pair.local,
                           connect_response.mutable_contact()->mutable_private_endpoint());
@@ -213,10 +268,93 @@ void Service::Connect(protobuf::Message& message) {
                   << " node failed.";
   }
 
-  message.add_data(connect_response.SerializeAsString());
+  if (connect_response.answer() != protobuf::ConnectResponseType::kAccepted)
+    connect_admission_.Release(peer_node.node_id);
+  connect_response.SerializeToString(message.add_data());
   assert(message.IsInitialized() && "unintialised message");
 }
 
+void Service::MakeConnectReply(protobuf::Message& message,
+                               protobuf::ConnectResponse& connect_response) {
+  connect_response.set_load(network_.Load());
+#ifdef TESTING
+  connect_response.set_timestamp(GetTimeStamp());
+#endif
+  TakeSignedOriginalRequest(message, connect_response);
+  message.clear_route_history_tags();
+  message.clear_data();
+  message.set_direct(true);
+  message.set_replication(1);
+  message.set_client_node(routing_table_.client_mode());
+  message.set_request(false);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  if (message.has_source_id())
+    message.set_destination_id(message.source_id());
+  else
+    message.clear_destination_id();
+  message.set_source_id(routing_table_.kNodeId().string());
+}
+
+void Service::SendConnectReply(protobuf::Message& message) {
+  if (!message.IsInitialized())
+    return;
+  if (routing_table_.size() == 0)
+    network_.SendToDirect(message, network_.bootstrap_connection_id(),
+                          network_.bootstrap_connection_id());
+  else
+    network_.SendToClosestNode(message);
+}
+
+void Service::EndConnectAttempt(const NodeId& peer_id) {
+  connect_admission_.Release(peer_id);
+  ScheduleRetryQueuedConnects();
+}
+
+void Service::set_post_functor(PostFunctor post_functor) { post_functor_ = post_functor; }
+
+void Service::ScheduleRetryQueuedConnects() {
+  if (!post_functor_) {
+    RetryQueuedConnects();
+    return;
+  }
+  // One retry waiting is enough; it answers everything which can be answered when it runs.
+  if (retry_posted_.exchange(true))
+    return;
+  post_functor_([this]() {
+    retry_posted_ = false;
+    RetryQueuedConnects();
+  });
+}
+
+void Service::RetryQueuedConnects() {
+  protobuf::Message message;
+  while (connect_admission_.NextQueued(message, RoutingClock::now())) {
+    DoConnect(message, true);
+    SendConnectReply(message);
+    message.Clear();
+  }
+  while (connect_admission_.NextExpired(message)) {
+    LOG(kVerbose) << "[" << DebugId(routing_table_.kNodeId()) << "] refusing Connect request "
+                  << "queued for too long";
+    protobuf::ConnectResponse connect_response;
+    connect_response.set_answer(protobuf::ConnectResponseType::kRejected);
+    MakeConnectReply(message, connect_response);
+    connect_response.SerializeToString(message.add_data());
+    SendConnectReply(message);
+    message.Clear();
+  }
+}
+
+bool Service::WouldBeKept(const NodeId& peer_id) {
+  // Counting the other attempts running as though they had all joined the routing table
+  size_t attempts(connect_admission_.attempts());
+  if (attempts != 0)
+    --attempts;  // the attempt admitted for |peer_id|
+  size_t kept(routing_table_.kMaxSize() > attempts ? routing_table_.kMaxSize() - attempts : 0);
+  kept = std::max(kept, static_cast<size_t>(Parameters::closest_nodes_size));
+  return routing_table_.IsThisNodeInRange(peer_id, static_cast<uint16_t>(kept));
+}
+
 bool Service::CheckPriority(const NodeId& this_node, const NodeId& peer_node) {
   assert(this_node != peer_node);
   return (this_node > peer_node);
@@ -239,18 +377,18 @@ void Service::FindNodes(protobuf::Message& message) {
                 << " parsed find node request for target id : "
                 << HexSubstr(find_nodes.target_node());
   protobuf::FindNodesResponse found_nodes;
-  std::vector<NodeId> nodes(
-      routing_table_.GetClosestNodes(NodeId(find_nodes.target_node()),
-                                     static_cast<uint16_t>(find_nodes.num_nodes_requested() - 1)));
   found_nodes.add_nodes(routing_table_.kNodeId().string());
-
-  for (const auto& node : nodes)
-    found_nodes.add_nodes(node.string());
+  routing_table_.VisitClosestNodes(
+      NodeId(find_nodes.target_node()), static_cast<uint16_t>(find_nodes.num_nodes_requested() - 1),
+      [&found_nodes](const NodeInfo& node_info) {
+        found_nodes.add_nodes(node_info.node_id.string());
+        return true;
+      });
 
   LOG(kVerbose) << "Responding Find node with " << found_nodes.nodes_size() << " contacts.";
 
-  found_nodes.set_original_request(message.data(0));
-  found_nodes.set_original_signature(message.signature());
+  TakeSignedOriginalRequest(message, found_nodes);
+  found_nodes.set_load(network_.Load());
 #ifdef TESTING
   found_nodes.set_timestamp(GetTimeStamp());
 #endif
@@ -262,13 +400,14 @@ void Service::FindNodes(protobuf::Message& message) {
     LOG(kVerbose) << "Relay message, so not setting destination ID.";
   }
   message.set_source_id(routing_table_.kNodeId().string());
-  message.clear_route_history();
+  message.clear_route_history_tags();
   message.clear_data();
-  message.add_data(found_nodes.SerializeAsString());
+  found_nodes.SerializeToString(message.add_data());
   message.set_direct(true);
   message.set_replication(1);
   message.set_client_node(routing_table_.client_mode());
   message.set_request(false);
+  message.set_request_hops(Parameters::hops_to_live - message.hops_to_live());
   message.set_hops_to_live(Parameters::hops_to_live);
   assert(message.IsInitialized() && "unintialised message");
 }
@@ -307,17 +446,7 @@ void Service::ConnectSuccessFromResponder(NodeInfo& peer, bool client) {
                   << DebugId(peer.node_id);
     return;
   }
-  auto count =
-      (client ? Parameters::max_routing_table_size_for_client : Parameters::greedy_fraction);
-  std::vector<NodeId> close_ids_for_peer(routing_table_.GetClosestNodes(peer.node_id, count));
-
-  auto itr(std::find_if(close_ids_for_peer.begin(), close_ids_for_peer.end(),
-                                                        [=](const NodeId & node_id)->bool {
-    return (peer.node_id == node_id);
-  }));
-  if (itr != close_ids_for_peer.end())
-    close_ids_for_peer.erase(itr);
-
+  std::vector<NodeId> close_ids_for_peer(CloseIdsForPeer(routing_table_, peer.node_id, client));
   protobuf::Message connect_success_ack(rpcs::ConnectSuccessAcknowledgement(
       peer.node_id, routing_table_.kNodeId(), routing_table_.kConnectionId(),
       true,  // this node is requestor
@@ -333,12 +462,12 @@ void Service::GetGroup(protobuf::Message& message) {
   get_group.set_node_id(routing_table_.kNodeId().string());
   for (const auto& node_id : close_nodes_id)
     get_group.add_group_nodes_id(node_id.string());
-  message.clear_route_history();
+  message.clear_route_history_tags();
   message.set_destination_id(message.source_id());
   message.set_source_id(routing_table_.kNodeId().string());
-  message.clear_route_history();
+  message.clear_route_history_tags();
   message.clear_data();
-  message.add_data(get_group.SerializeAsString());
+  get_group.SerializeToString(message.add_data());
   message.set_direct(true);
   message.set_replication(1);
   message.set_client_node(routing_table_.client_mode());
@@ -355,6 +484,14 @@ RequestPublicKeyFunctor Service::request_public_key_functor() const {
   return request_public_key_functor_;
 }
 
+void Service::set_public_key_prefetch(std::shared_ptr<PublicKeyPrefetch> public_key_prefetch) {
+  public_key_prefetch_ = public_key_prefetch;
+}
+
+void Service::set_memory_budget(std::shared_ptr<MemoryBudget> memory_budget) {
+  memory_budget_ = memory_budget;
+}
+
 }  // namespace routing
 
 }  // namespace maidsafe
@@ -19,15 +19,21 @@
 #ifndef MAIDSAFE_ROUTING_SERVICE_H_
 #define MAIDSAFE_ROUTING_SERVICE_H_
 
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/connect_admission.h"
+#include "maidsafe/routing/memory_budget.h"
+#include "maidsafe/routing/public_key_prefetch.h"
 
 namespace maidsafe {
 
 namespace routing {
 
 namespace protobuf {
+class ConnectResponse;
 class Message;
 }
 
@@ -37,6 +43,7 @@ class RoutingTable;
 
 class Service {
  public:
+  typedef std::function<void(const std::function<void()>& /*handler*/)> PostFunctor;
   Service(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
           NetworkUtils& network);
   virtual ~Service();
@@ -48,8 +55,28 @@ class Service {
   virtual void GetGroup(protobuf::Message& message);
   void set_request_public_key_functor(RequestPublicKeyFunctor request_public_key);
   RequestPublicKeyFunctor request_public_key_functor() const;
+  // Where keys of peers accepting the streamlined handshake are asked for in advance.
+  void set_public_key_prefetch(std::shared_ptr<PublicKeyPrefetch> public_key_prefetch);
+  // Clients' connect requests are refused while |memory_budget| is over its soft budget.
+  void set_memory_budget(std::shared_ptr<MemoryBudget> memory_budget);
+  // Frees the connect attempt admitted for |peer_id|, if any, and answers queued requests which
+  // can now be started.
+  void EndConnectAttempt(const NodeId& peer_id);
+  // Used to answer queued connect requests after the handler which freed their turn has returned.
+  // They are answered inline if this isn't set.
+  void set_post_functor(PostFunctor post_functor);
 
  private:
+  // A request taken from the queue isn't queued again behind those still waiting.
+  void DoConnect(protobuf::Message& message, bool from_queue);
+  // Turns |message| into the reply to its connect request, carrying |connect_response|'s answer.
+  void MakeConnectReply(protobuf::Message& message, protobuf::ConnectResponse& connect_response);
+  void SendConnectReply(protobuf::Message& message);
+  void ScheduleRetryQueuedConnects();
+  // Refuses requests queued for too long, then answers those which can now be started.
+  void RetryQueuedConnects();
+  // Whether |peer_id| would still be in the routing table once the connects running have completed
+  bool WouldBeKept(const NodeId& peer_id);
   void ConnectSuccessFromRequester(NodeInfo& peer);
   void ConnectSuccessFromResponder(NodeInfo& peer, bool client);
   bool CheckPriority(const NodeId& this_node, const NodeId& peer_node);
@@ -58,6 +85,11 @@ class Service {
   ClientRoutingTable& client_routing_table_;
   NetworkUtils& network_;
   RequestPublicKeyFunctor request_public_key_functor_;
+  std::shared_ptr<PublicKeyPrefetch> public_key_prefetch_;
+  std::shared_ptr<MemoryBudget> memory_budget_;
+  ConnectAdmission connect_admission_;
+  PostFunctor post_functor_;
+  std::atomic<bool> retry_posted_;
 };
 
 }  // namespace routing
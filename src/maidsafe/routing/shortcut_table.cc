@@ -0,0 +1,174 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/shortcut_table.h"
+
+#include <utility>
+
+namespace maidsafe {
+
+namespace routing {
+
+const size_t ShortcutTable::kMaxFlows;
+
+ShortcutTable::ShortcutTable(size_t max_shortcuts, uint32_t message_threshold,
+                             std::chrono::steady_clock::duration window)
+    : kMaxShortcuts_(max_shortcuts),
+      kMessageThreshold_(message_threshold),
+      kWindow_(window),
+      mutex_(),
+      flows_(),
+      shortcuts_(),
+      pending_count_(0) {}
+
+bool ShortcutTable::RecordSend(const NodeId& destination_id,
+                               std::chrono::steady_clock::time_point now) {
+  if (kMessageThreshold_ == 0 || kMaxShortcuts_ == 0)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (shortcuts_.count(destination_id) != 0)
+    return false;
+  auto itr(flows_.find(destination_id));
+  if (itr == flows_.end()) {
+    if (flows_.size() >= kMaxFlows)
+      return false;
+    itr = flows_.insert(std::make_pair(destination_id, Flow(now))).first;
+  }
+  Flow& flow(itr->second);
+  if (flow.pending)
+    return false;
+  if (now - flow.window_start >= kWindow_) {
+    flow.window_start = now;
+    flow.count = 0;
+  }
+  if (++flow.count < kMessageThreshold_ || !HasRoom())
+    return false;
+  flow.pending = true;
+  flow.pending_since = now;
+  ++pending_count_;
+  return true;
+}
+
+bool ShortcutTable::Admits(const NodeId& peer_id) const {
+  if (kMessageThreshold_ == 0)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shortcuts_.count(peer_id) == 0 && HasRoom();
+}
+
+bool ShortcutTable::Add(const NodeInfo& peer, std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto flow(flows_.find(peer.node_id));
+  if (flow != flows_.end()) {
+    if (flow->second.pending)
+      --pending_count_;
+    flows_.erase(flow);
+  }
+  auto itr(shortcuts_.find(peer.node_id));
+  if (itr != shortcuts_.end()) {
+    itr->second = Shortcut(peer, now);
+    return true;
+  }
+  if (!HasRoom())
+    return false;
+  shortcuts_.insert(std::make_pair(peer.node_id, Shortcut(peer, now)));
+  return true;
+}
+
+void ShortcutTable::Abandon(const NodeId& peer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(flows_.find(peer_id));
+  if (itr == flows_.end() || !itr->second.pending)
+    return;
+  --pending_count_;
+  flows_.erase(itr);
+}
+
+NodeInfo ShortcutTable::Get(const NodeId& destination_id,
+                            std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(shortcuts_.find(destination_id));
+  if (itr == shortcuts_.end())
+    return NodeInfo();
+  itr->second.last_used = now;
+  return itr->second.peer;
+}
+
+void ShortcutTable::MarkUsed(const NodeId& peer_id, std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(shortcuts_.find(peer_id));
+  if (itr != shortcuts_.end())
+    itr->second.last_used = now;
+}
+
+bool ShortcutTable::Remove(const NodeId& connection_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto itr(shortcuts_.begin()); itr != shortcuts_.end(); ++itr) {
+    if (itr->second.peer.connection_id == connection_id) {
+      shortcuts_.erase(itr);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ShortcutTable::Contains(const NodeId& connection_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& shortcut : shortcuts_) {
+    if (shortcut.second.peer.connection_id == connection_id)
+      return true;
+  }
+  return false;
+}
+
+std::vector<NodeInfo> ShortcutTable::TakeIdle(std::chrono::steady_clock::duration idle_time,
+                                              std::chrono::steady_clock::time_point now) {
+  std::vector<NodeInfo> idle;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto itr(shortcuts_.begin()); itr != shortcuts_.end();) {
+    if (now - itr->second.last_used >= idle_time) {
+      idle.push_back(itr->second.peer);
+      itr = shortcuts_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  for (auto itr(flows_.begin()); itr != flows_.end();) {
+    bool expired(itr->second.pending ? now - itr->second.pending_since >= idle_time
+                                     : now - itr->second.window_start >= kWindow_);
+    if (!expired) {
+      ++itr;
+      continue;
+    }
+    if (itr->second.pending)
+      --pending_count_;
+    itr = flows_.erase(itr);
+  }
+  return idle;
+}
+
+size_t ShortcutTable::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shortcuts_.size();
+}
+
+bool ShortcutTable::HasRoom() const { return shortcuts_.size() + pending_count_ < kMaxShortcuts_; }
+
+}  // namespace routing
+
+}  // namespace maidsafe
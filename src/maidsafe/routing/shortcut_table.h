@@ -0,0 +1,106 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
+#define MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/node_info.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Direct connections to destinations outside the routing and client routing tables which this
+// node exchanges sustained traffic with, and the message counts which pick those destinations.  A
+// shortcut carries messages for its destination in one hop; without one they are routed as usual.
+class ShortcutTable {
+ public:
+  // Up to |max_shortcuts| are held or being made at once.  A destination sent
+  // |message_threshold| messages within |window| is due one; zero disables shortcuts.
+  ShortcutTable(size_t max_shortcuts, uint32_t message_threshold,
+                std::chrono::steady_clock::duration window);
+  // Counts a message sent to |destination_id|.  Returns true, with an attempt to make a shortcut
+  // to it then pending, when the destination is due one and there is room.  The attempt ends with
+  // Add or Abandon.
+  bool RecordSend(const NodeId& destination_id, std::chrono::steady_clock::time_point now);
+  // Whether there is room for a shortcut which |peer_id| asks this node for.
+  bool Admits(const NodeId& peer_id) const;
+  // Returns false, holding nothing, if there is no room for |peer|.
+  bool Add(const NodeInfo& peer, std::chrono::steady_clock::time_point now);
+  void Abandon(const NodeId& peer_id);
+  // Returns the shortcut to |destination_id|, marking it used at |now|, else a default NodeInfo.
+  NodeInfo Get(const NodeId& destination_id, std::chrono::steady_clock::time_point now);
+  // Marks the shortcut to |peer_id|, if there is one, used at |now|, for a message received from
+  // the peer, so that a one-way flow doesn't leave the receiving side's shortcut idle.
+  void MarkUsed(const NodeId& peer_id, std::chrono::steady_clock::time_point now);
+  // Returns false if no shortcut is held over |connection_id|.
+  bool Remove(const NodeId& connection_id);
+  bool Contains(const NodeId& connection_id) const;
+  // Removes and returns the shortcuts unused for |idle_time|.  Attempts pending for as long are
+  // given up, and counts from windows since ended forgotten.
+  std::vector<NodeInfo> TakeIdle(std::chrono::steady_clock::duration idle_time,
+                                 std::chrono::steady_clock::time_point now);
+  size_t size() const;
+
+ private:
+  struct Flow {
+    explicit Flow(std::chrono::steady_clock::time_point now)
+        : window_start(now), pending_since(), count(0), pending(false) {}
+    std::chrono::steady_clock::time_point window_start, pending_since;
+    uint32_t count;
+    bool pending;
+  };
+
+  struct Shortcut {
+    Shortcut(const NodeInfo& peer_in, std::chrono::steady_clock::time_point now)
+        : peer(peer_in), last_used(now) {}
+    NodeInfo peer;
+    std::chrono::steady_clock::time_point last_used;
+  };
+
+  // Destinations counted at once, so that a node sending to many can't grow the counts unbounded.
+  static const size_t kMaxFlows = 1024;
+
+  ShortcutTable(const ShortcutTable&);
+  ShortcutTable& operator=(const ShortcutTable&);
+
+  bool HasRoom() const;
+
+  const size_t kMaxShortcuts_;
+  const uint32_t kMessageThreshold_;
+  const std::chrono::steady_clock::duration kWindow_;
+  mutable std::mutex mutex_;
+  std::unordered_map<NodeId, Flow, NodeIdHash> flows_;
+  std::unordered_map<NodeId, Shortcut, NodeIdHash> shortcuts_;
+  size_t pending_count_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SHORTCUT_TABLE_H_
@@ -0,0 +1,204 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/signature_verifier.h"
+
+#include <algorithm>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/log.h"
+
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+std::string SignedContent(const protobuf::Message& message) {
+  return SignedContent(message, message.source_id());
+}
+
+std::string SignedContent(const protobuf::Message& message, const std::string& source_id) {
+  std::string content(source_id);
+  // Each data item is length prefixed, so that the content can't be reinterpreted.
+  for (const auto& data : message.data())
+    content.append(std::to_string(data.size())).append(1, ':').append(data);
+  return content;
+}
+
+void SignMessage(protobuf::Message& message, const asymm::PrivateKey& private_key) {
+  try {
+    message.set_signature(
+        asymm::Sign(asymm::PlainText(SignedContent(message)), private_key).string());
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to sign message: " << e.what();
+  }
+}
+
+SignatureVerifier::Request::Request(const std::string& data_in, const std::string& signature_in,
+                                    const asymm::PublicKey& public_key_in,
+                                    const ResultFunctor& result_functor_in)
+    : data(data_in),
+      signature(signature_in),
+      public_key(public_key_in),
+      result_functor(result_functor_in),
+      done(false),
+      valid(false) {}
+
+SignatureVerifier::SignatureVerifier(uint16_t thread_count, uint16_t batch_size,
+                                     uint32_t cache_size)
+    : kBatchSize_(std::max<uint16_t>(batch_size, 1)),
+      kCacheSize_(cache_size),
+      mutex_(),
+      condition_(),
+      running_(true),
+      delivering_(false),
+      worker_queues_(std::max<uint16_t>(thread_count, 1)),
+      next_worker_(0),
+      next_worker_batch_size_(0),
+      requests_(),
+      cache_mutex_(),
+      cache_(),
+      cache_order_(),
+      workers_() {
+  for (size_t i(0); i != worker_queues_.size(); ++i)
+    workers_.push_back(std::thread([this, i]() { Work(i); }));
+}
+
+SignatureVerifier::~SignatureVerifier() { Stop(); }
+
+void SignatureVerifier::Verify(const std::string& data, const std::string& signature,
+                               const asymm::PublicKey& public_key,
+                               const ResultFunctor& result_functor) {
+  auto request(std::make_shared<Request>(data, signature, public_key, result_functor));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    requests_.push_back(request);
+    worker_queues_[next_worker_].push_back(request);
+    if (++next_worker_batch_size_ == kBatchSize_) {
+      next_worker_ = (next_worker_ + 1) % worker_queues_.size();
+      next_worker_batch_size_ = 0;
+    }
+  }
+  condition_.notify_all();
+}
+
+void SignatureVerifier::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  condition_.notify_all();
+  for (auto& worker : workers_)
+    worker.join();
+  workers_.clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  requests_.clear();
+}
+
+void SignatureVerifier::Work(size_t worker_index) {
+  std::deque<std::shared_ptr<Request>>& queue(worker_queues_[worker_index]);
+  std::vector<std::shared_ptr<Request>> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [&] { return !running_ || !queue.empty(); });  // NOLINT
+      if (!running_)
+        return;
+      while (!queue.empty() && batch.size() != kBatchSize_) {
+        batch.push_back(queue.front());
+        queue.pop_front();
+      }
+    }
+
+    std::vector<bool> results;
+    for (const auto& request : batch)
+      results.push_back(Check(*request));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i(0); i != batch.size(); ++i) {
+      batch[i]->valid = results[i];
+      batch[i]->done = true;
+    }
+    batch.clear();
+    Deliver(lock);
+  }
+}
+
+bool SignatureVerifier::Check(const Request& request) {
+  std::string cache_key;
+  try {
+    cache_key = crypto::Hash<crypto::SHA512>(asymm::EncodeKey(request.public_key)).string() +
+                crypto::Hash<crypto::SHA512>(request.data + request.signature).string();
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to fingerprint public key: " << e.what();
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_.count(cache_key) != 0)
+      return true;
+  }
+
+  bool valid(false);
+  try {
+    valid = !request.data.empty() && !request.signature.empty() &&
+            asymm::CheckSignature(asymm::PlainText(request.data),
+                                  asymm::Signature(request.signature), request.public_key);
+  }
+  catch (const std::exception& e) {
+    LOG(kWarning) << "Failed to check signature: " << e.what();
+  }
+  if (!valid || kCacheSize_ == 0)
+    return valid;
+
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  if (cache_.insert(cache_key).second) {
+    cache_order_.push_back(cache_key);
+    if (cache_order_.size() > kCacheSize_) {
+      cache_.erase(cache_order_.front());
+      cache_order_.pop_front();
+    }
+  }
+  return true;
+}
+
+void SignatureVerifier::Deliver(std::unique_lock<std::mutex>& lock) {
+  if (delivering_)
+    return;
+  delivering_ = true;
+  while (running_ && !requests_.empty() && requests_.front()->done) {
+    std::shared_ptr<Request> request(requests_.front());
+    requests_.pop_front();
+    lock.unlock();
+    if (request->result_functor)
+      request->result_functor(request->valid);
+    lock.lock();
+  }
+  delivering_ = false;
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
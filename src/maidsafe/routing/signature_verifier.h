@@ -0,0 +1,101 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
+#define MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "maidsafe/common/rsa.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace protobuf {
+class Message;
+}
+
+// The bytes covered by a node-level message's signature: its source ID and data, which no node
+// on the route changes.
+std::string SignedContent(const protobuf::Message& message);
+// As above, but as signed by |source_id|, one of the other senders of a merged group reply.
+std::string SignedContent(const protobuf::Message& message, const std::string& source_id);
+void SignMessage(protobuf::Message& message, const asymm::PrivateKey& private_key);
+
+// Checks signatures on a pool of worker threads, keeping RSA verification off the receive path.
+// Consecutive requests are handed to the same worker in batches of up to |batch_size|, and
+// results are delivered in the order the requests were made.  Up to |cache_size| recently verified
+// (key fingerprint, digest) pairs are remembered and not checked again.
+class SignatureVerifier {
+ public:
+  typedef std::function<void(bool /*valid*/)> ResultFunctor;
+
+  SignatureVerifier(uint16_t thread_count, uint16_t batch_size, uint32_t cache_size);
+  ~SignatureVerifier();
+  void Verify(const std::string& data, const std::string& signature,
+              const asymm::PublicKey& public_key, const ResultFunctor& result_functor);
+  // Joins the workers.  Results not yet delivered are discarded.
+  void Stop();
+
+ private:
+  SignatureVerifier(const SignatureVerifier&);
+  SignatureVerifier(const SignatureVerifier&&);
+  SignatureVerifier& operator=(const SignatureVerifier&);
+
+  struct Request {
+    Request(const std::string& data_in, const std::string& signature_in,
+            const asymm::PublicKey& public_key_in, const ResultFunctor& result_functor_in);
+    std::string data, signature;
+    asymm::PublicKey public_key;
+    ResultFunctor result_functor;
+    bool done, valid;
+  };
+
+  void Work(size_t worker_index);
+  bool Check(const Request& request);
+  // Delivers the results at the head of requests_ which are ready, unless another thread is.
+  void Deliver(std::unique_lock<std::mutex>& lock);
+
+  const size_t kBatchSize_, kCacheSize_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_, delivering_;
+  std::vector<std::deque<std::shared_ptr<Request>>> worker_queues_;
+  size_t next_worker_, next_worker_batch_size_;
+  std::deque<std::shared_ptr<Request>> requests_;  // not yet delivered, in order made
+  std::mutex cache_mutex_;
+  std::unordered_set<std::string> cache_;
+  std::deque<std::string> cache_order_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SIGNATURE_VERIFIER_H_
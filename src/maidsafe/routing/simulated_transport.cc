@@ -0,0 +1,467 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/simulated_transport.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "maidsafe/rudp/return_codes.h"
+
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+typedef boost::asio::ip::udp::endpoint Endpoint;
+
+// Every simulated node listens on this port of an address of its own in 10.0.0.0/8.
+const uint16_t kSimulatedPort(5483);
+// How long Bootstrap waits for a node which has been created but not yet bootstrapped to do so, as
+// the two zero state nodes need of each other.
+const std::chrono::seconds kBootstrapWait(10);
+// How long the real time clock sleeps for at most with no event due.
+const std::chrono::milliseconds kIdleTick(10);
+// Where the virtual clock starts as seen through RoutingClock, clear of a time point's zero value.
+const std::chrono::hours kVirtualEpoch(24);
+
+}  // unnamed namespace
+
+SimulatedNetworkConfig::SimulatedNetworkConfig()
+    : latency(std::chrono::milliseconds(20)),
+      jitter(std::chrono::milliseconds(5)),
+      loss(0),
+      max_attempts(5),
+      bandwidth(0),
+      seed(0) {}
+
+SimulatedNetwork::SimulatedNetwork(const SimulatedNetworkConfig& config)
+    : kConfig_(config),
+      mutex_(),
+      bootstrap_cond_var_(),
+      now_(Duration::zero()),
+      next_sequence_(0),
+      next_address_(0),
+      events_(),
+      nodes_(),
+      random_(config.seed),
+      statistics_(),
+      message_observer_(),
+      running_(false),
+      driven_(false),
+      clock_cond_var_(),
+      clock_() {}
+
+SimulatedNetwork::~SimulatedNetwork() {
+  Stop();
+  assert(nodes_.empty() && "Simulated transports must be destroyed before their network");
+}
+
+std::unique_ptr<SimulatedTransport> SimulatedNetwork::CreateTransport() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t kAddress((10U << 24) | (++next_address_ & 0xffffff));
+  const Endpoint kEndpoint(boost::asio::ip::address_v4(kAddress), kSimulatedPort);
+  nodes_[kEndpoint];
+  return std::unique_ptr<SimulatedTransport>(new SimulatedTransport(*this, kEndpoint));
+}
+
+void SimulatedNetwork::AdvanceBy(Duration duration) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  RunUntil(now_ + duration, lock);
+}
+
+void SimulatedNetwork::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_)
+    return;
+  running_ = true;
+  clock_ = std::thread([this] {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto kRealStart(std::chrono::steady_clock::now());
+    const Duration kVirtualStart(now_);
+    while (running_) {
+      RunUntil(kVirtualStart + (std::chrono::steady_clock::now() - kRealStart), lock);
+      auto wake(std::chrono::steady_clock::now() + kIdleTick);
+      if (!events_.empty())
+        wake = std::min(wake, kRealStart + (events_.top().time - kVirtualStart));
+      clock_cond_var_.wait_until(lock, wake);
+    }
+  });
+}
+
+void SimulatedNetwork::StartOn(boost::asio::io_service& io_service, Duration step) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_)
+      return;
+    running_ = true;
+    driven_ = true;
+  }
+  RoutingClock::set_virtual_time(
+      [this] { return RoutingClock::time_point(kVirtualEpoch + now()); });
+  io_service.post([this, &io_service, step] { Step(io_service, step); });
+}
+
+void SimulatedNetwork::Stop() {
+  bool driven(false);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    std::swap(driven, driven_);
+  }
+  if (driven)
+    RoutingClock::set_virtual_time(RoutingClock::TimeSource());
+  clock_cond_var_.notify_one();
+  if (clock_.joinable())
+    clock_.join();
+}
+
+SimulatedNetwork::Duration SimulatedNetwork::now() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return now_;
+}
+
+size_t SimulatedNetwork::pending_events() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_.size();
+}
+
+SimulatedNetworkStatistics SimulatedNetwork::Statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+void SimulatedNetwork::set_message_observer(MessageObserver message_observer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  message_observer_ = std::move(message_observer);
+}
+
+void SimulatedNetwork::RunUntil(Duration end, std::unique_lock<std::mutex>& lock) {
+  while (!events_.empty() && events_.top().time <= end) {
+    std::function<void()> action(std::move(const_cast<Event&>(events_.top()).action));
+    now_ = std::max(now_, events_.top().time);
+    events_.pop();
+    lock.unlock();
+    action();
+    lock.lock();
+  }
+  now_ = std::max(now_, end);
+}
+
+void SimulatedNetwork::Step(boost::asio::io_service& io_service, Duration step) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!driven_)
+      return;
+    RunUntil(now_ + step, lock);
+  }
+  // Posted rather than looped, so that routing's handlers queued meanwhile, and its timers now
+  // expired, run before the clock moves on again.
+  io_service.post([this, &io_service, step] { Step(io_service, step); });
+}
+
+void SimulatedNetwork::Schedule(Duration time, std::function<void()> action) {
+  events_.push(Event(time, next_sequence_++, std::move(action)));
+  clock_cond_var_.notify_one();
+}
+
+SimulatedNetwork::Node* SimulatedNetwork::FindNode(const Endpoint& endpoint) {
+  auto itr(nodes_.find(endpoint));
+  return itr == nodes_.end() ? nullptr : &itr->second;
+}
+
+SimulatedNetwork::Node* SimulatedNetwork::FindNode(const NodeId& node_id,
+                                                   const Endpoint& endpoint) {
+  Node* node(FindNode(endpoint));
+  return node && node->node_id == node_id ? node : nullptr;
+}
+
+void SimulatedNetwork::Transmit(Node& sender, Connection& connection, const std::string& message,
+                                const rudp::MessageSentFunctor& message_sent_functor) {
+  ++statistics_.messages_sent;
+  statistics_.bytes_sent += message.size();
+  if (message_observer_)
+    message_observer_(message);
+  Duration sent(std::max(now_, sender.uplink_free));
+  if (kConfig_.bandwidth != 0) {
+    sent += std::chrono::duration_cast<Duration>(std::chrono::nanoseconds(
+        message.size() * UINT64_C(1000000000) / kConfig_.bandwidth));
+  }
+  sender.uplink_free = sent;
+  const Duration kRetransmitDelay(2 * kConfig_.latency);
+  auto callbacks(sender.callbacks);
+  for (uint16_t attempt(1);
+       kConfig_.loss > 0 && std::bernoulli_distribution(kConfig_.loss)(random_); ++attempt) {
+    ++statistics_.transmissions_lost;
+    if (attempt >= kConfig_.max_attempts) {
+      ++statistics_.send_failures;
+      if (message_sent_functor) {
+        Schedule(sent + kRetransmitDelay, [callbacks, message_sent_functor] {
+          Invoke(callbacks, [&](Callbacks&) { message_sent_functor(rudp::kSendFailure); });
+        });
+      }
+      return;
+    }
+    sent += kRetransmitDelay;
+  }
+  const Duration kArrival(std::max(sent + LinkDelay(), connection.last_arrival));
+  connection.last_arrival = kArrival;
+  const Endpoint kTo(connection.endpoint);
+  const NodeId kFromId(sender.node_id);
+  Schedule(kArrival, [this, kTo, kFromId, message] { Deliver(kTo, kFromId, message); });
+  if (message_sent_functor) {
+    Schedule(kArrival + kConfig_.latency, [callbacks, message_sent_functor] {
+      Invoke(callbacks, [&](Callbacks&) { message_sent_functor(rudp::kSuccess); });
+    });
+  }
+}
+
+void SimulatedNetwork::ReportConnectionLost(const Endpoint& to, const NodeId& lost_id) {
+  Schedule(now_ + kConfig_.latency, [this, to, lost_id] {
+    std::shared_ptr<Callbacks> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Node* node(FindNode(to));
+      if (!node)
+        return;
+      callbacks = node->callbacks;
+    }
+    Invoke(callbacks, [&](Callbacks& node_callbacks) {
+      if (node_callbacks.connection_lost)
+        node_callbacks.connection_lost(lost_id);
+    });
+  });
+}
+
+SimulatedNetwork::Duration SimulatedNetwork::LinkDelay() {
+  Duration delay(kConfig_.latency);
+  if (kConfig_.jitter.count() > 0) {
+    delay += std::chrono::microseconds(
+        std::uniform_int_distribution<int64_t>(0, kConfig_.jitter.count())(random_));
+  }
+  return delay;
+}
+
+void SimulatedNetwork::Deliver(const Endpoint& to, const NodeId& from_id,
+                               const std::string& message) {
+  std::shared_ptr<Callbacks> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Node* node(FindNode(to));
+    // Nothing arrives over a connection which has since been removed.
+    if (!node || node->connections.count(from_id) == 0)
+      return;
+    ++statistics_.messages_delivered;
+    callbacks = node->callbacks;
+  }
+  Invoke(callbacks, [&](Callbacks& node_callbacks) {
+    if (node_callbacks.message_received)
+      node_callbacks.message_received(message);
+  });
+}
+
+void SimulatedNetwork::Invoke(const std::shared_ptr<Callbacks>& callbacks,
+                              const std::function<void(Callbacks&)>& call) {
+  std::lock_guard<std::mutex> lock(callbacks->mutex);
+  call(*callbacks);
+}
+
+SimulatedTransport::SimulatedTransport(SimulatedNetwork& network, const Endpoint& endpoint)
+    : network_(network), kEndpoint_(endpoint) {}
+
+SimulatedTransport::~SimulatedTransport() {
+  std::shared_ptr<SimulatedNetwork::Callbacks> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(network_.mutex_);
+    callbacks = network_.nodes_.at(kEndpoint_).callbacks;
+  }
+  {
+    // Waits for any callback of this transport already running.
+    std::lock_guard<std::mutex> lock(callbacks->mutex);
+    callbacks->message_received = rudp::MessageReceivedFunctor();
+    callbacks->connection_lost = rudp::ConnectionLostFunctor();
+  }
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  auto& node(network_.nodes_.at(kEndpoint_));
+  for (const auto& connection : node.connections) {
+    SimulatedNetwork::Node* peer(network_.FindNode(connection.first, connection.second.endpoint));
+    if (peer && peer->connections.erase(node.node_id) != 0)
+      network_.ReportConnectionLost(connection.second.endpoint, node.node_id);
+  }
+  network_.nodes_.erase(kEndpoint_);
+}
+
+int SimulatedTransport::Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
+                                  const rudp::MessageReceivedFunctor& message_received_functor,
+                                  const rudp::ConnectionLostFunctor& connection_lost_functor,
+                                  const NodeId& this_node_id,
+                                  std::shared_ptr<asymm::PrivateKey> /*private_key*/,
+                                  std::shared_ptr<asymm::PublicKey> /*public_key*/,
+                                  NodeId& chosen_bootstrap_peer, rudp::NatType& nat_type,
+                                  Endpoint /*local_endpoint*/) {
+  std::shared_ptr<SimulatedNetwork::Callbacks> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(network_.mutex_);
+    callbacks = network_.nodes_.at(kEndpoint_).callbacks;
+  }
+  {
+    std::lock_guard<std::mutex> lock(callbacks->mutex);
+    callbacks->message_received = message_received_functor;
+    callbacks->connection_lost = connection_lost_functor;
+  }
+  std::unique_lock<std::mutex> lock(network_.mutex_);
+  network_.nodes_.at(kEndpoint_).node_id = this_node_id;
+  network_.bootstrap_cond_var_.notify_all();
+  for (const auto& endpoint : bootstrap_endpoints) {
+    if (endpoint == kEndpoint_ || !network_.FindNode(endpoint))
+      continue;
+    network_.bootstrap_cond_var_.wait_for(lock, kBootstrapWait, [&] {
+      SimulatedNetwork::Node* peer(network_.FindNode(endpoint));
+      return !peer || !peer->node_id.IsZero();
+    });
+    SimulatedNetwork::Node* peer(network_.FindNode(endpoint));
+    if (!peer || peer->node_id.IsZero())
+      continue;
+    auto& self(network_.nodes_.at(kEndpoint_));
+    auto& connection(self.connections[peer->node_id]);
+    connection.endpoint = endpoint;
+    connection.state = SimulatedNetwork::ConnectionState::kBootstrap;
+    auto inserted(peer->connections.insert(std::make_pair(this_node_id,
+                                                          SimulatedNetwork::Connection())));
+    if (inserted.second) {
+      inserted.first->second.endpoint = kEndpoint_;
+      inserted.first->second.state = SimulatedNetwork::ConnectionState::kBootstrap;
+    }
+    chosen_bootstrap_peer = peer->node_id;
+    nat_type = rudp::NatType::kOther;
+    return kSuccess;
+  }
+  return kNoOnlineBootstrapContacts;
+}
+
+int SimulatedTransport::GetAvailableEndpoint(const NodeId& peer_id,
+                                             const rudp::EndpointPair& peer_endpoint_pair,
+                                             rudp::EndpointPair& this_endpoint_pair,
+                                             rudp::NatType& this_nat_type) {
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  this_endpoint_pair.local = kEndpoint_;
+  this_endpoint_pair.external = kEndpoint_;
+  this_nat_type = rudp::NatType::kOther;
+  auto& connections(network_.nodes_.at(kEndpoint_).connections);
+  auto itr(connections.find(peer_id));
+  if (itr == connections.end()) {
+    connections[peer_id].endpoint = peer_endpoint_pair.external;
+    return kSuccess;
+  }
+  switch (itr->second.state) {
+    case SimulatedNetwork::ConnectionState::kBootstrap:
+      return rudp::kBootstrapConnectionAlreadyExists;
+    case SimulatedNetwork::ConnectionState::kUnvalidated:
+      return rudp::kUnvalidatedConnectionAlreadyExists;
+    case SimulatedNetwork::ConnectionState::kPending:
+      return rudp::kConnectAttemptAlreadyRunning;
+    default:
+      return rudp::kConnectionAlreadyExists;
+  }
+}
+
+int SimulatedTransport::Add(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+                            const std::string& validation_data) {
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  auto& self(network_.nodes_.at(kEndpoint_));
+  auto itr(self.connections.find(peer_id));
+  Endpoint peer_endpoint(peer_endpoint_pair.external);
+  if (itr != self.connections.end() &&
+      itr->second.state == SimulatedNetwork::ConnectionState::kBootstrap)
+    peer_endpoint = itr->second.endpoint;
+  SimulatedNetwork::Node* peer(network_.FindNode(peer_id, peer_endpoint));
+  if (!peer) {
+    peer_endpoint = peer_endpoint_pair.local;
+    peer = network_.FindNode(peer_id, peer_endpoint);
+  }
+  if (!peer) {
+    if (itr != self.connections.end() &&
+        itr->second.state == SimulatedNetwork::ConnectionState::kPending)
+      self.connections.erase(itr);
+    return rudp::kInvalidAddress;
+  }
+  auto& connection(self.connections[peer_id]);
+  connection.endpoint = peer_endpoint;
+  if (connection.state != SimulatedNetwork::ConnectionState::kValid)
+    connection.state = SimulatedNetwork::ConnectionState::kUnvalidated;
+  auto& reverse(peer->connections[self.node_id]);
+  reverse.endpoint = kEndpoint_;
+  if (reverse.state == SimulatedNetwork::ConnectionState::kPending)
+    reverse.state = SimulatedNetwork::ConnectionState::kUnvalidated;
+  network_.Transmit(self, connection, validation_data, rudp::MessageSentFunctor());
+  return kSuccess;
+}
+
+int SimulatedTransport::MarkConnectionAsValid(const NodeId& peer_id, Endpoint& new_endpoint) {
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  new_endpoint = Endpoint();
+  auto& connections(network_.nodes_.at(kEndpoint_).connections);
+  auto itr(connections.find(peer_id));
+  if (itr == connections.end() ||
+      itr->second.state == SimulatedNetwork::ConnectionState::kPending)
+    return rudp::kInvalidConnection;
+  itr->second.state = SimulatedNetwork::ConnectionState::kValid;
+  return kSuccess;
+}
+
+void SimulatedTransport::Remove(const NodeId& peer_id) {
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  auto& self(network_.nodes_.at(kEndpoint_));
+  auto itr(self.connections.find(peer_id));
+  if (itr == self.connections.end())
+    return;
+  const Endpoint kPeerEndpoint(itr->second.endpoint);
+  self.connections.erase(itr);
+  SimulatedNetwork::Node* peer(network_.FindNode(peer_id, kPeerEndpoint));
+  if (peer && peer->connections.erase(self.node_id) != 0)
+    network_.ReportConnectionLost(kPeerEndpoint, self.node_id);
+}
+
+void SimulatedTransport::Send(const NodeId& peer_id, const std::string& message,
+                              const rudp::MessageSentFunctor& message_sent_functor) {
+  std::lock_guard<std::mutex> lock(network_.mutex_);
+  auto& self(network_.nodes_.at(kEndpoint_));
+  auto itr(self.connections.find(peer_id));
+  if (itr == self.connections.end() ||
+      itr->second.state == SimulatedNetwork::ConnectionState::kPending) {
+    if (message_sent_functor) {
+      auto callbacks(self.callbacks);
+      network_.Schedule(network_.now_, [callbacks, message_sent_functor] {
+        SimulatedNetwork::Invoke(callbacks,
+                                 [&](SimulatedNetwork::Callbacks&) {
+                                   message_sent_functor(rudp::kSendFailure);
+                                 });
+      });
+    }
+    return;
+  }
+  network_.Transmit(self, itr->second, message, message_sent_functor);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
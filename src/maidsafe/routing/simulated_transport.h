@@ -0,0 +1,235 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_SIMULATED_TRANSPORT_H_
+#define MAIDSAFE_ROUTING_SIMULATED_TRANSPORT_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/ip/udp.hpp"
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/transport.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+struct SimulatedNetworkConfig {
+  SimulatedNetworkConfig();
+  // One-way delay of every link, to which up to |jitter| more is added at random.  Messages
+  // between two nodes are still delivered in the order they were sent, as rudp delivers them.
+  std::chrono::microseconds latency, jitter;
+  // Chance of each transmission being lost.  A lost message is sent again after twice the latency,
+  // up to |max_attempts| times in all before its send is reported as failed.
+  double loss;
+  uint16_t max_attempts;
+  // Bytes per second each node can send, shared by all its links.  Zero is unlimited.
+  uint64_t bandwidth;
+  uint32_t seed;
+};
+
+struct SimulatedNetworkStatistics {
+  SimulatedNetworkStatistics()
+      : messages_sent(0), bytes_sent(0), transmissions_lost(0), send_failures(0),
+        messages_delivered(0) {}
+  uint64_t messages_sent, bytes_sent, transmissions_lost, send_failures, messages_delivered;
+};
+
+class SimulatedTransport;
+
+// Carries messages between the SimulatedTransports it creates, all in one process, on a virtual
+// clock: each message is delivered once the clock passes its arrival time, which the config's
+// latency, loss and bandwidth decide.  The clock is moved on by AdvanceBy, by Start() in step with
+// real time, which routing's own timers then still follow, or by StartOn() as fast as routing can
+// keep up, with routing's timers following the virtual clock too.  Callbacks run on whichever
+// thread moves the clock, not holding the network's lock.
+//
+// Connections follow rudp's lifecycle closely enough for routing: Bootstrap opens a bootstrap
+// connection to the first listed endpoint with a node on it, Add opens a connection to the peer
+// and delivers |validation_data| to it, and Remove, or the destruction of a transport, is reported
+// to the peers through their ConnectionLostFunctors.  Unlike rudp, connections never time out and
+// MarkConnectionAsValid never offers a new bootstrap endpoint.
+class SimulatedNetwork {
+ public:
+  // Called with each message a transport sends, once however often it's retransmitted.  It's
+  // called holding the network's lock, so mustn't call back into the network.
+  typedef std::function<void(const std::string& message)> MessageObserver;
+
+  explicit SimulatedNetwork(const SimulatedNetworkConfig& config = SimulatedNetworkConfig());
+  ~SimulatedNetwork();
+
+  // Each transport gets an endpoint of its own, and must be destroyed before the network is.
+  std::unique_ptr<SimulatedTransport> CreateTransport();
+  // Runs every event due in the next |duration| of virtual time, then sets the clock to its end.
+  void AdvanceBy(std::chrono::steady_clock::duration duration);
+  // Moves the clock on in step with real time on a thread of its own, until Stop().
+  void Start();
+  // Moves the clock on by |step| at a time from |io_service|, each step once the handlers already
+  // queued have run, until Stop().  RoutingClock follows the virtual clock meanwhile, so this must
+  // be called before any Routing object is created.  If |io_service| is run by a single thread,
+  // which the nodes' executor then shares, every run from the same seed takes the same course.
+  // The io_service must be stopped before the network is destroyed.
+  void StartOn(boost::asio::io_service& io_service, std::chrono::steady_clock::duration step);
+  // Stops the clock, restoring real time after StartOn().
+  void Stop();
+  std::chrono::steady_clock::duration now() const;
+  size_t pending_events() const;
+  SimulatedNetworkStatistics Statistics() const;
+  void set_message_observer(MessageObserver message_observer);
+
+  friend class SimulatedTransport;
+
+ private:
+  enum class ConnectionState { kBootstrap, kPending, kUnvalidated, kValid };
+
+  struct Connection {
+    Connection() : endpoint(), state(ConnectionState::kPending), last_arrival() {}
+    boost::asio::ip::udp::endpoint endpoint;
+    ConnectionState state;
+    // Latest arrival time of a message sent over this connection, to keep the order they were
+    // sent in
+    std::chrono::steady_clock::duration last_arrival;
+  };
+
+  // A transport's callbacks.  |mutex| is held while they run and while they are cleared, so that a
+  // transport's destruction waits for any of its callbacks already running.
+  struct Callbacks {
+    Callbacks() : mutex(), message_received(), connection_lost() {}
+    std::mutex mutex;
+    rudp::MessageReceivedFunctor message_received;
+    rudp::ConnectionLostFunctor connection_lost;
+  };
+
+  struct Node {
+    Node() : node_id(), callbacks(std::make_shared<Callbacks>()), connections(), uplink_free() {}
+    NodeId node_id;  // zero until bootstrapped
+    std::shared_ptr<Callbacks> callbacks;
+    std::unordered_map<NodeId, Connection, NodeIdHash> connections;
+    std::chrono::steady_clock::duration uplink_free;  // when the node's uplink is next idle
+  };
+
+  struct Event {
+    Event(std::chrono::steady_clock::duration time_in, uint64_t sequence_in,
+          std::function<void()> action_in)
+        : time(time_in), sequence(sequence_in), action(std::move(action_in)) {}
+    bool operator>(const Event& other) const {
+      return time != other.time ? time > other.time : sequence > other.sequence;
+    }
+    std::chrono::steady_clock::duration time;
+    uint64_t sequence;
+    std::function<void()> action;
+  };
+
+  typedef std::chrono::steady_clock::duration Duration;
+
+  SimulatedNetwork(const SimulatedNetwork&);
+  SimulatedNetwork& operator=(const SimulatedNetwork&);
+
+  // Runs the events due by |end| in order, releasing |lock| while each runs.
+  void RunUntil(Duration end, std::unique_lock<std::mutex>& lock);
+  // One step of StartOn(), which queues the next.
+  void Step(boost::asio::io_service& io_service, Duration step);
+  // All the following must be called with mutex_ held.
+  void Schedule(Duration time, std::function<void()> action);
+  Node* FindNode(const boost::asio::ip::udp::endpoint& endpoint);
+  Node* FindNode(const NodeId& node_id, const boost::asio::ip::udp::endpoint& endpoint);
+  // Sends |message| over |connection|, calling |message_sent_functor| once it has arrived or has
+  // been given up on.
+  void Transmit(Node& sender, Connection& connection, const std::string& message,
+                const rudp::MessageSentFunctor& message_sent_functor);
+  void ReportConnectionLost(const boost::asio::ip::udp::endpoint& to, const NodeId& lost_id);
+  Duration LinkDelay();
+
+  // Delivery to a transport which has gone, or dropped the connection, since the message was sent
+  // is silently dropped.
+  void Deliver(const boost::asio::ip::udp::endpoint& to, const NodeId& from_id,
+               const std::string& message);
+  static void Invoke(const std::shared_ptr<Callbacks>& callbacks,
+                     const std::function<void(Callbacks&)>& call);
+
+  const SimulatedNetworkConfig kConfig_;
+  mutable std::mutex mutex_;
+  std::condition_variable bootstrap_cond_var_;
+  Duration now_;
+  uint64_t next_sequence_;
+  uint32_t next_address_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  std::map<boost::asio::ip::udp::endpoint, Node> nodes_;
+  std::mt19937 random_;
+  SimulatedNetworkStatistics statistics_;
+  MessageObserver message_observer_;
+  bool running_, driven_;
+  std::condition_variable clock_cond_var_;
+  std::thread clock_;
+};
+
+class SimulatedTransport : public Transport {
+ public:
+  ~SimulatedTransport();
+  boost::asio::ip::udp::endpoint endpoint() const { return kEndpoint_; }
+
+  int Bootstrap(const std::vector<boost::asio::ip::udp::endpoint>& bootstrap_endpoints,
+                const rudp::MessageReceivedFunctor& message_received_functor,
+                const rudp::ConnectionLostFunctor& connection_lost_functor,
+                const NodeId& this_node_id, std::shared_ptr<asymm::PrivateKey> private_key,
+                std::shared_ptr<asymm::PublicKey> public_key, NodeId& chosen_bootstrap_peer,
+                rudp::NatType& nat_type, boost::asio::ip::udp::endpoint local_endpoint) override;
+  int GetAvailableEndpoint(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+                           rudp::EndpointPair& this_endpoint_pair,
+                           rudp::NatType& this_nat_type) override;
+  int Add(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+          const std::string& validation_data) override;
+  int MarkConnectionAsValid(const NodeId& peer_id,
+                            boost::asio::ip::udp::endpoint& new_endpoint) override;
+  void Remove(const NodeId& peer_id) override;
+  void Send(const NodeId& peer_id, const std::string& message,
+            const rudp::MessageSentFunctor& message_sent_functor) override;
+
+  friend class SimulatedNetwork;
+
+ private:
+  SimulatedTransport(SimulatedNetwork& network, const boost::asio::ip::udp::endpoint& endpoint);
+  SimulatedTransport(const SimulatedTransport&);
+  SimulatedTransport& operator=(const SimulatedTransport&);
+
+  SimulatedNetwork& network_;
+  const boost::asio::ip::udp::endpoint kEndpoint_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_SIMULATED_TRANSPORT_H_
@@ -0,0 +1,81 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/standby_cache.h"
+
+#include <algorithm>
+
+#include "maidsafe/routing/distance.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+StandbyCache::StandbyCache(const NodeId& this_node_id, size_t capacity)
+    : kThisNodeId_(this_node_id), kCapacity_(capacity), mutex_(), nodes_() {}
+
+std::vector<NodeId> StandbyCache::Add(const std::vector<NodeId>& node_ids) {
+  std::vector<NodeId> added;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& node_id : node_ids) {
+    if (node_id.IsZero() || node_id == kThisNodeId_)
+      continue;
+    const Distance kDistance(node_id, kThisNodeId_);
+    auto position(std::lower_bound(nodes_.begin(), nodes_.end(), kDistance,
+                                   [this](const NodeId& held, const Distance& distance) {
+      return Distance(held, kThisNodeId_) < distance;
+    }));
+    if (static_cast<size_t>(position - nodes_.begin()) >= kCapacity_ ||
+        (position != nodes_.end() && *position == node_id))
+      continue;
+    nodes_.insert(position, node_id);
+    added.push_back(node_id);
+    if (nodes_.size() > kCapacity_) {
+      added.erase(std::remove(added.begin(), added.end(), nodes_.back()), added.end());
+      nodes_.pop_back();
+    }
+  }
+  return added;
+}
+
+void StandbyCache::Remove(const NodeId& node_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  nodes_.erase(std::remove(nodes_.begin(), nodes_.end(), node_id), nodes_.end());
+}
+
+std::vector<NodeId> StandbyCache::Take(size_t count,
+                                       const std::function<bool(const NodeId&)>& usable) {
+  std::vector<NodeId> taken;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(nodes_.begin());
+  while (itr != nodes_.end() && taken.size() < count) {
+    if (usable(*itr))
+      taken.push_back(*itr);
+    itr = nodes_.erase(itr);
+  }
+  return taken;
+}
+
+size_t StandbyCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nodes_.size();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,62 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_STANDBY_CACHE_H_
+#define MAIDSAFE_ROUTING_STANDBY_CACHE_H_
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Nodes heard of from FindNodes responses and the group matrix but not in the routing table, the
+// closest to this node kept up to |capacity|.  When a close node is lost the best of them are
+// connected to at once, rather than waiting for a recovery lookup to find replacements.
+class StandbyCache {
+ public:
+  StandbyCache(const NodeId& this_node_id, size_t capacity);
+  // Adds any of |node_ids| not already held, other than this node, and returns those added which
+  // are close enough to be kept.
+  std::vector<NodeId> Add(const std::vector<NodeId>& node_ids);
+  void Remove(const NodeId& node_id);
+  // Removes and returns up to |count| of the closest nodes for which |usable| holds.  Nodes passed
+  // over as unusable are removed too.
+  std::vector<NodeId> Take(size_t count, const std::function<bool(const NodeId&)>& usable);
+  size_t size() const;
+
+ private:
+  StandbyCache(const StandbyCache&);
+  StandbyCache& operator=(const StandbyCache&);
+
+  const NodeId kThisNodeId_;
+  const size_t kCapacity_;
+  mutable std::mutex mutex_;
+  // Held closest to kThisNodeId_ first
+  std::vector<NodeId> nodes_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_STANDBY_CACHE_H_
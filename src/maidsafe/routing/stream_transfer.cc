@@ -0,0 +1,191 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/stream_transfer.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+StreamSender::StreamSender(std::string payload, uint32_t fragment_size, uint16_t window,
+                           uint16_t max_attempts, SendFragmentFunctor send_fragment,
+                           StreamSentFunctor stream_sent)
+    : kPayload_(std::move(payload)),
+      kFragmentSize_(std::max(fragment_size, 1U)),
+      kFragmentCount_(static_cast<uint32_t>((kPayload_.size() + kFragmentSize_ - 1) /
+                                            kFragmentSize_)),
+      kWindow_(std::max(window, static_cast<uint16_t>(1))),
+      kMaxAttempts_(std::max(max_attempts, static_cast<uint16_t>(1))),
+      send_fragment_(std::move(send_fragment)),
+      stream_sent_(std::move(stream_sent)),
+      mutex_(),
+      next_index_(0),
+      acknowledged_count_(0),
+      done_(false) {
+  assert(kFragmentCount_ != 0 && "Nothing to stream");
+  assert(send_fragment_);
+}
+
+void StreamSender::Start() {
+  uint32_t first_count(0);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    first_count = std::min(static_cast<uint32_t>(kWindow_), kFragmentCount_);
+    next_index_ = first_count;
+  }
+  for (uint32_t index(0); index != first_count; ++index)
+    Send(index, 1);
+}
+
+void StreamSender::Send(uint32_t index, int attempt) {
+  std::shared_ptr<StreamSender> self(shared_from_this());
+  send_fragment_(index, kFragmentCount_, kPayload_.substr(index * kFragmentSize_, kFragmentSize_),
+                 [self, index, attempt](std::string acknowledgement) {
+                   self->OnAcknowledged(index, attempt, acknowledgement);
+                 });
+}
+
+void StreamSender::OnAcknowledged(uint32_t index, int attempt,
+                                  const std::string& acknowledgement) {
+  uint32_t next_index(kFragmentCount_);
+  int result(kPendingResult);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (done_)
+      return;
+    if (acknowledgement.empty()) {
+      if (attempt >= kMaxAttempts_) {
+        done_ = true;
+        result = kResponseTimeout;
+      }
+    } else if (++acknowledged_count_ == kFragmentCount_) {
+      done_ = true;
+      result = kSuccess;
+    } else if (next_index_ != kFragmentCount_) {
+      next_index = next_index_++;
+    }
+  }
+
+  if (result != kPendingResult) {
+    LOG(kVerbose) << "Stream of " << kFragmentCount_ << " fragments finished with " << result;
+    if (stream_sent_)
+      stream_sent_(result);
+  } else if (acknowledgement.empty()) {
+    LOG(kInfo) << "Resending stream fragment " << index << ", attempt " << attempt + 1;
+    Send(index, attempt + 1);
+  } else if (next_index != kFragmentCount_) {
+    Send(next_index, 1);
+  }
+}
+
+StreamReassembler::StreamReassembler(uint32_t max_stream_size, uint32_t fragment_size,
+                                     uint16_t max_streams,
+                                     std::chrono::steady_clock::duration timeout)
+    : kMaxStreamSize_(max_stream_size),
+      kFragmentSize_(std::max(fragment_size, 1U)),
+      kMaxFragmentCount_(static_cast<uint32_t>(
+          (static_cast<uint64_t>(kMaxStreamSize_) + kFragmentSize_ - 1) / kFragmentSize_)),
+      kMaxStreams_(max_streams),
+      kTimeout_(timeout),
+      mutex_(),
+      streams_(),
+      completed_() {}
+
+StreamReassembler::Result StreamReassembler::Add(const std::string& source_id,
+                                                 uint32_t stream_id, uint32_t index,
+                                                 uint32_t count, std::string fragment,
+                                                 std::string& payload) {
+  if (index >= count || count > kMaxFragmentCount_ || fragment.empty() ||
+      fragment.size() > kFragmentSize_ || (index + 1 != count && fragment.size() != kFragmentSize_))
+    return Result::kRejected;
+
+  const auto kNow(RoutingClock::now());
+  const StreamKey kKey(source_id, stream_id);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Prune(kNow);
+  if (completed_.count(kKey) != 0)
+    return Result::kAccepted;
+
+  auto itr(streams_.find(kKey));
+  if (itr == streams_.end()) {
+    if (streams_.size() >= kMaxStreams_) {
+      LOG(kWarning) << "Rejecting new stream from " << HexSubstr(source_id) << " as "
+                    << streams_.size() << " are being reassembled";
+      return Result::kRejected;
+    }
+    itr = streams_.insert(std::make_pair(kKey, Stream(count))).first;
+  }
+
+  Stream& stream(itr->second);
+  if (stream.count != count)
+    return Result::kRejected;
+  stream.last_arrival = kNow;
+  if (stream.fragments.count(index) != 0)
+    return Result::kAccepted;
+  if (stream.size + fragment.size() > kMaxStreamSize_) {
+    LOG(kWarning) << "Dropping stream from " << HexSubstr(source_id) << " over "
+                  << kMaxStreamSize_ << " bytes";
+    streams_.erase(itr);
+    return Result::kRejected;
+  }
+  stream.size += fragment.size();
+  stream.fragments[index].swap(fragment);
+  if (stream.fragments.size() != count)
+    return Result::kAccepted;
+
+  payload.clear();
+  payload.reserve(stream.size);
+  for (const auto& stream_fragment : stream.fragments)
+    payload.append(stream_fragment.second);
+  streams_.erase(itr);
+  completed_.insert(std::make_pair(kKey, kNow));
+  return Result::kComplete;
+}
+
+size_t StreamReassembler::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.size();
+}
+
+void StreamReassembler::Prune(const std::chrono::steady_clock::time_point& now) {
+  for (auto itr(streams_.begin()); itr != streams_.end();) {
+    if (itr->second.last_arrival + kTimeout_ < now)
+      itr = streams_.erase(itr);
+    else
+      ++itr;
+  }
+  for (auto itr(completed_.begin()); itr != completed_.end();) {
+    if (itr->second + kTimeout_ < now)
+      itr = completed_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
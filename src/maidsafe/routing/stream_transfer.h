@@ -0,0 +1,122 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_STREAM_TRANSFER_H_
+#define MAIDSAFE_ROUTING_STREAM_TRANSFER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Sends a payload for Routing::SendStream as fragments of at most |fragment_size| bytes, of which
+// at most |window| are awaiting acknowledgement at once.  Each fragment is routed on its own, so
+// transit nodes only ever hold the fragments in flight.  Must be owned by a std::shared_ptr.
+class StreamSender : public std::enable_shared_from_this<StreamSender> {
+ public:
+  // Sends fragment |index| of |count|.  |acknowledged| is to be called with a non-empty string
+  // once the destination acknowledges it, or with an empty one if it doesn't in time.
+  typedef std::function<void(uint32_t /*index*/, uint32_t /*count*/, std::string /*fragment*/,
+                             ResponseFunctor /*acknowledged*/)> SendFragmentFunctor;
+
+  StreamSender(std::string payload, uint32_t fragment_size, uint16_t window, uint16_t max_attempts,
+               SendFragmentFunctor send_fragment, StreamSentFunctor stream_sent);
+
+  void Start();
+  uint32_t fragment_count() const { return kFragmentCount_; }
+
+ private:
+  StreamSender(const StreamSender&);
+  StreamSender(const StreamSender&&);
+  StreamSender& operator=(const StreamSender&);
+
+  void Send(uint32_t index, int attempt);
+  void OnAcknowledged(uint32_t index, int attempt, const std::string& acknowledgement);
+
+  const std::string kPayload_;
+  const uint32_t kFragmentSize_, kFragmentCount_;
+  const uint16_t kWindow_, kMaxAttempts_;
+  SendFragmentFunctor send_fragment_;
+  StreamSentFunctor stream_sent_;
+  std::mutex mutex_;
+  uint32_t next_index_, acknowledged_count_;
+  bool done_;
+};
+
+// Reassembles streamed payloads at their destination.  At most |max_streams| are held at once,
+// none bigger than |max_stream_size|, and one is dropped once |timeout| passes without a fragment
+// of it arriving.  Every fragment but a stream's last must be |fragment_size| bytes, so that a
+// stream can't claim more fragments than its size allows.
+class StreamReassembler {
+ public:
+  enum class Result {
+    kAccepted,  // to be acknowledged, though the payload is not yet complete
+    kComplete,  // to be acknowledged, and the payload delivered
+    kRejected   // not to be acknowledged
+  };
+
+  StreamReassembler(uint32_t max_stream_size, uint32_t fragment_size, uint16_t max_streams,
+                    std::chrono::steady_clock::duration timeout);
+
+  // Moves the whole payload into |payload| when returning kComplete.  A fragment which arrives
+  // again, once its acknowledgement was lost, is accepted without being counted twice.
+  Result Add(const std::string& source_id, uint32_t stream_id, uint32_t index, uint32_t count,
+             std::string fragment, std::string& payload);
+  size_t size() const;
+
+ private:
+  StreamReassembler(const StreamReassembler&);
+  StreamReassembler(const StreamReassembler&&);
+  StreamReassembler& operator=(const StreamReassembler&);
+
+  typedef std::pair<std::string, uint32_t> StreamKey;  // sender's ID and stream ID
+  struct Stream {
+    explicit Stream(uint32_t count_in) : count(count_in), fragments(), size(0), last_arrival() {}
+    uint32_t count;
+    std::map<uint32_t, std::string> fragments;  // by index, only those which have arrived
+    size_t size;
+    std::chrono::steady_clock::time_point last_arrival;
+  };
+
+  void Prune(const std::chrono::steady_clock::time_point& now);
+
+  const uint32_t kMaxStreamSize_, kFragmentSize_, kMaxFragmentCount_;
+  const uint16_t kMaxStreams_;
+  const std::chrono::steady_clock::duration kTimeout_;
+  mutable std::mutex mutex_;
+  std::map<StreamKey, Stream> streams_;
+  // Streams recently delivered, so that their resent fragments are acknowledged but not delivered.
+  std::map<StreamKey, std::chrono::steady_clock::time_point> completed_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_STREAM_TRANSFER_H_
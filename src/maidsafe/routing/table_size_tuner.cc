@@ -0,0 +1,127 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/table_size_tuner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+// Fewer hop samples than this in an interval are too few to move the target on.
+const uint64_t kMinHopSamples(16);
+// Beyond 2^48 times the node count the estimate is meaningless anyway.
+const int kMaxSizeShift(48);
+
+int BitLength(uint64_t value) {
+  int length(0);
+  for (; value != 0; value >>= 1)
+    ++length;
+  return length;
+}
+
+}  // unnamed namespace
+
+TableSizeTuner::TableSizeTuner(uint16_t min_size, uint16_t max_size, uint16_t initial_target)
+    : kMinSize_(std::min(min_size, max_size)),
+      kMaxSize_(max_size),
+      kHysteresis_(std::max<uint16_t>(Parameters::auto_tune_hysteresis, 1)),
+      kEntriesPerLevel_(Parameters::auto_tune_entries_per_level),
+      kClosestNodesSize_(Parameters::closest_nodes_size),
+      kGroupSize_(Parameters::group_size),
+      mutex_(),
+      hop_total_(0),
+      hop_count_(0),
+      hop_bias_(0),
+      target_(std::min(std::max(initial_target, kMinSize_), kMaxSize_)),
+      statistics_() {
+  statistics_.target_table_size = target_;
+}
+
+void TableSizeTuner::RecordHops(int32_t hops) {
+  if (hops < 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  hop_total_ += static_cast<uint64_t>(hops);
+  ++hop_count_;
+}
+
+bool TableSizeTuner::Update(const NodeId& group_distance) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t kNetworkSize(EstimateNetworkSize(group_distance, kGroupSize_));
+  const int kLevels(BitLength(kNetworkSize / std::max<uint16_t>(kClosestNodesSize_, 1)) - 1);
+  const double kHopGoal(std::max(1.0, std::log2(static_cast<double>(kNetworkSize))));
+  const int32_t kBase(kClosestNodesSize_ + kEntriesPerLevel_ * std::max(kLevels, 0));
+  statistics_.estimated_network_size = kNetworkSize;
+  if (hop_count_ >= kMinHopSamples) {
+    statistics_.mean_hops = static_cast<double>(hop_total_) / static_cast<double>(hop_count_);
+    if (statistics_.mean_hops > kHopGoal)
+      hop_bias_ += kHysteresis_;
+    else if (statistics_.mean_hops < kHopGoal / 2)
+      hop_bias_ -= kHysteresis_;
+    // Kept where it can still move the target, so that it doesn't wind up past a bound.
+    hop_bias_ = std::min(std::max(hop_bias_, kMinSize_ - kBase), kMaxSize_ - kBase);
+    hop_total_ = 0;
+    hop_count_ = 0;
+  }
+  const int32_t kDesired(std::min(std::max(kBase + hop_bias_, static_cast<int32_t>(kMinSize_)),
+                                  static_cast<int32_t>(kMaxSize_)));
+  if (std::abs(kDesired - static_cast<int32_t>(target_)) < kHysteresis_)
+    return false;
+  target_ = static_cast<uint16_t>(kDesired);
+  statistics_.target_table_size = target_;
+  ++statistics_.adjustments;
+  return true;
+}
+
+uint16_t TableSizeTuner::target() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return target_;
+}
+
+TableTuningStatistics TableSizeTuner::Statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statistics_;
+}
+
+uint64_t TableSizeTuner::EstimateNetworkSize(const NodeId& distance, uint16_t node_count) {
+  const std::string kRaw(distance.string());
+  int leading_zeros(0);
+  for (const char byte : kRaw) {
+    if (byte != 0) {
+      leading_zeros += 8 - BitLength(static_cast<unsigned char>(byte));
+      break;
+    }
+    leading_zeros += 8;
+  }
+  if (leading_zeros == static_cast<int>(kRaw.size()) * 8)  // no peers yet
+    return node_count;
+  return static_cast<uint64_t>(node_count) << std::min(leading_zeros, kMaxSizeShift);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
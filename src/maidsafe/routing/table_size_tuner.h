@@ -0,0 +1,73 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TABLE_SIZE_TUNER_H_
+#define MAIDSAFE_ROUTING_TABLE_SIZE_TUNER_H_
+
+#include <cstdint>
+#include <mutex>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// Chooses how many peers a vault's routing table should settle at from the estimated network size
+// and the hop counts of messages delivered to it, aiming for delivery in about log2(network size)
+// hops.  The target grows by Parameters::auto_tune_entries_per_level peers per doubling of the
+// network, and is moved further up for as long as messages take more hops than that, or down once
+// they take fewer than half.  It only changes by at least Parameters::auto_tune_hysteresis peers at
+// a time, and stays within [|min_size|, |max_size|].
+class TableSizeTuner {
+ public:
+  TableSizeTuner(uint16_t min_size, uint16_t max_size, uint16_t initial_target);
+
+  // Counts a message delivered to this node after |hops| hops.
+  void RecordHops(int32_t hops);
+  // Re-estimates from |group_distance|, the distance from this node to the furthest of its group
+  // (see NetworkStatistics::GetDistance), and the hops recorded since the last call.  Returns true
+  // if the target changed.
+  bool Update(const NodeId& group_distance);
+  uint16_t target() const;
+  TableTuningStatistics Statistics() const;
+
+  // |node_count| nodes are known to lie within |distance| of a node, so the network holds about
+  // that many for each range of that size in the ID space.
+  static uint64_t EstimateNetworkSize(const NodeId& distance, uint16_t node_count);
+
+ private:
+  TableSizeTuner(const TableSizeTuner&);
+  TableSizeTuner& operator=(const TableSizeTuner&);
+
+  const uint16_t kMinSize_, kMaxSize_, kHysteresis_, kEntriesPerLevel_, kClosestNodesSize_,
+      kGroupSize_;
+  mutable std::mutex mutex_;
+  uint64_t hop_total_, hop_count_;
+  int32_t hop_bias_;
+  uint16_t target_;
+  TableTuningStatistics statistics_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TABLE_SIZE_TUNER_H_
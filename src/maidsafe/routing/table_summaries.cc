@@ -0,0 +1,97 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/table_summaries.h"
+
+#include <algorithm>
+#include <string>
+
+namespace maidsafe {
+
+namespace routing {
+
+TableSummaries::TableSummaries() : mutex_(), summaries_() {}
+
+std::vector<uint64_t> TableSummaries::Summarise(const std::vector<NodeId>& peer_ids,
+                                                size_t max_size) {
+  std::vector<uint64_t> summary;
+  const size_t kSize(std::min(peer_ids.size(), max_size));
+  summary.reserve(kSize);
+  for (size_t i(0); i != kSize; ++i)
+    summary.push_back(Prefix(peer_ids[i * peer_ids.size() / kSize]));
+  return summary;
+}
+
+uint64_t TableSummaries::Prefix(const NodeId& node_id) {
+  const std::string kRawId(node_id.string());
+  uint64_t prefix(0);
+  for (size_t i(0); i != sizeof(prefix) && i != kRawId.size(); ++i)
+    prefix = (prefix << 8) | static_cast<unsigned char>(kRawId[i]);
+  return prefix;
+}
+
+void TableSummaries::Update(const NodeId& peer_id, const std::vector<uint64_t>& summary) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Summary& entry(summaries_[peer_id]);
+  entry.prefixes = summary;
+  entry.refreshed = RoutingClock::now();
+}
+
+void TableSummaries::Remove(const NodeId& peer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  summaries_.erase(peer_id);
+}
+
+std::vector<NodeId> TableSummaries::TakeStale(const std::vector<NodeId>& peer_ids,
+                                              RoutingClock::duration max_age) {
+  const auto kNow(RoutingClock::now());
+  std::vector<NodeId> stale;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& peer_id : peer_ids) {
+    auto found(summaries_.find(peer_id));
+    if (found == summaries_.end()) {
+      summaries_[peer_id].refreshed = kNow;
+      stale.push_back(peer_id);
+    } else if (found->second.refreshed + max_age <= kNow) {
+      found->second.refreshed = kNow;
+      stale.push_back(peer_id);
+    }
+  }
+  return stale;
+}
+
+uint64_t TableSummaries::LookaheadDistance(const NodeId& peer_id, const NodeId& target_id) const {
+  const uint64_t kTarget(Prefix(target_id));
+  uint64_t distance(Prefix(peer_id) ^ kTarget);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found(summaries_.find(peer_id));
+  if (found != summaries_.end()) {
+    for (const auto& prefix : found->second.prefixes)
+      distance = std::min(distance, prefix ^ kTarget);
+  }
+  return distance;
+}
+
+size_t TableSummaries::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return summaries_.size();
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
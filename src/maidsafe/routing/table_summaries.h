@@ -0,0 +1,75 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TABLE_SUMMARIES_H_
+#define MAIDSAFE_ROUTING_TABLE_SUMMARIES_H_
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/node_id_hash.h"
+#include "maidsafe/routing/routing_clock.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// What is known of each routing table peer's own routing table, so that a next hop can be chosen
+// by the progress two hops make rather than one.  A summary is the leading 64 bits of some of a
+// peer's peers' IDs, taken evenly from its table so that every distance from it is represented.
+// Far from the destination, where hops matter, the leading bits are all XOR distance depends on.
+class TableSummaries {
+ public:
+  TableSummaries();
+  // Up to |max_size| entries summarising |peer_ids|, given in order of closeness to their holder.
+  static std::vector<uint64_t> Summarise(const std::vector<NodeId>& peer_ids, size_t max_size);
+  static uint64_t Prefix(const NodeId& node_id);
+  void Update(const NodeId& peer_id, const std::vector<uint64_t>& summary);
+  void Remove(const NodeId& peer_id);
+  // Returns those of |peer_ids| whose summaries are older than |max_age| or missing, treating them
+  // as refreshed now so that each is returned once per |max_age| while a refresh is awaited.
+  std::vector<NodeId> TakeStale(const std::vector<NodeId>& peer_ids,
+                                RoutingClock::duration max_age);
+  // The XOR distance between the leading bits of |target_id| and those of whichever is closer to
+  // it of |peer_id| and the IDs it summarised.
+  uint64_t LookaheadDistance(const NodeId& peer_id, const NodeId& target_id) const;
+  size_t size() const;
+
+ private:
+  struct Summary {
+    Summary() : prefixes(), refreshed() {}
+    std::vector<uint64_t> prefixes;
+    RoutingClock::time_point refreshed;
+  };
+
+  TableSummaries(const TableSummaries&);
+  TableSummaries& operator=(const TableSummaries&);
+
+  mutable std::mutex mutex_;
+  std::unordered_map<NodeId, Summary, NodeIdHash> summaries_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TABLE_SUMMARIES_H_
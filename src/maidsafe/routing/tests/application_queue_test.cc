@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/application_queue.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(ApplicationQueueTest, BEH_BatchesInOrderAndRefusesWhenFull) {
+  ApplicationQueue queue(3);
+  std::vector<std::string> replies;
+  for (int i(0); i != 4; ++i) {
+    ReceivedMessage message(std::to_string(i),
+                            [&replies](const std::string& reply) { replies.push_back(reply); });
+    EXPECT_EQ(i != 3, queue.Push(message));
+  }
+  EXPECT_EQ(3U, queue.size());
+
+  auto batch(queue.Take(2, std::chrono::milliseconds(0)));
+  ASSERT_EQ(2U, batch.size());
+  EXPECT_EQ("0", batch[0].message);
+  EXPECT_EQ("1", batch[1].message);
+  batch[1].reply("reply");
+  ASSERT_EQ(1U, replies.size());
+  EXPECT_EQ("reply", replies.front());
+
+  // The ring wraps around once room is made.
+  ReceivedMessage message("4", [](const std::string&) {});
+  EXPECT_TRUE(queue.Push(message));
+  batch = queue.Take(10, std::chrono::milliseconds(0));
+  ASSERT_EQ(2U, batch.size());
+  EXPECT_EQ("2", batch[0].message);
+  EXPECT_EQ("4", batch[1].message);
+  EXPECT_TRUE(queue.Take(10, std::chrono::milliseconds(10)).empty());
+}
+
+TEST(ApplicationQueueTest, BEH_StopWakesTakers) {
+  ApplicationQueue queue(2);
+  auto taken(std::async(std::launch::async,
+                        [&queue] { return queue.Take(1, std::chrono::seconds(10)); }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  queue.Stop();
+  ASSERT_EQ(std::future_status::ready, taken.wait_for(std::chrono::seconds(5)));
+  EXPECT_TRUE(taken.get().empty());
+  ReceivedMessage message("late", [](const std::string&) {});
+  EXPECT_FALSE(queue.Push(message));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
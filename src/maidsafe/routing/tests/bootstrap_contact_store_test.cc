@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/bootstrap_contact_store.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace fs = boost::filesystem;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+BootstrapContact MakeContact(uint16_t port) {
+  return BootstrapContact(boost::asio::ip::address_v4::loopback(), port);
+}
+
+}  // unnamed namespace
+
+TEST(BootstrapContactStoreTest, BEH_PersistsMetadata) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestUtils"));
+  fs::path bootstrap_file_path(*test_path / "bootstrap");
+  {
+    BootstrapContactStore store(bootstrap_file_path);
+    for (uint16_t port(5000); port != 5010; ++port)
+      store.Add(MakeContact(port));
+    store.Flush();
+    EXPECT_EQ(10U, ReadBootstrapFile(bootstrap_file_path).size());
+    store.RecordSuccess(MakeContact(5002), std::chrono::milliseconds(40));
+    store.RecordSuccess(MakeContact(5005), std::chrono::milliseconds(20));
+    store.RecordFailure(MakeContact(5009));
+    store.Remove(MakeContact(5000));
+  }
+  // The destructor flushed, to the journal rather than a rewritten file.
+  EXPECT_TRUE(fs::exists(fs::path(bootstrap_file_path.string() + ".journal")));
+  auto contacts(ReadBootstrapFile(bootstrap_file_path));
+  ASSERT_EQ(9U, contacts.size());
+  EXPECT_EQ(MakeContact(5009), contacts.front());
+  EXPECT_EQ(MakeContact(5001), contacts.back());
+
+  BootstrapContactStore store(bootstrap_file_path);
+  auto infos(store.GetContacts());
+  ASSERT_EQ(9U, infos.size());
+  EXPECT_EQ(MakeContact(5009), infos.front().contact);
+  EXPECT_EQ(1U, infos.front().failures);
+  auto ranked(store.RankedContacts());
+  ASSERT_EQ(9U, ranked.size());
+  EXPECT_EQ(MakeContact(5005), ranked[0]);
+  EXPECT_EQ(MakeContact(5002), ranked[1]);
+  EXPECT_EQ(MakeContact(5009), ranked.back());
+}
+
+TEST(BootstrapContactStoreTest, BEH_JournalCompacted) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestUtils"));
+  fs::path bootstrap_file_path(*test_path / "bootstrap");
+  fs::path journal_path(bootstrap_file_path.string() + ".journal");
+  WriteBootstrapFile(BootstrapContacts(), bootstrap_file_path);
+  BootstrapContactStore store(bootstrap_file_path);
+  uint16_t port(5000);
+  while (!fs::exists(journal_path) ||
+         fs::file_size(journal_path) <= Parameters::bootstrap_journal_compaction_size / 2) {
+    store.Add(MakeContact(port++));
+    store.Flush();
+  }
+  while (fs::exists(journal_path)) {
+    store.RecordSuccess(MakeContact(5000), std::chrono::milliseconds(10));
+    store.Flush();
+  }
+  auto contacts(ReadBootstrapFile(bootstrap_file_path));
+  ASSERT_EQ(static_cast<size_t>(port - 5000), contacts.size());
+  EXPECT_EQ(MakeContact(5000), contacts.back());
+  EXPECT_LT(0U, BootstrapContactStore(bootstrap_file_path).GetContacts().back().successes);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -16,6 +16,7 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <string>
 #include <vector>
 
 #include "boost/filesystem/operations.hpp"
@@ -66,7 +67,38 @@ TEST(BootstrapFileOperationsTest, BEH_ReadWriteUpdate) {
   }
 
   // Update remove
-  // TODO(Prakash)
+  for (int i(0); i < 10; ++i) {
+    auto itr(std::begin(expected_bootstrap_contacts) + i * 7);
+    EXPECT_NO_THROW(UpdateBootstrapFile(*itr, bootstrap_file_path, true));
+    expected_bootstrap_contacts.erase(itr);
+    auto actual_bootstrap_contacts = ReadBootstrapFile(bootstrap_file_path);
+    EXPECT_EQ(expected_bootstrap_contacts, actual_bootstrap_contacts);
+  }
+
+  // Rewriting the file discards the journal
+  EXPECT_NO_THROW(WriteBootstrapFile(bootstrap_contacts, bootstrap_file_path));
+  EXPECT_FALSE(fs::exists(fs::path(bootstrap_file_path.string() + ".journal")));
+}
+
+TEST(BootstrapFileOperationsTest, BEH_TornJournalAppend) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestUtils"));
+  fs::path bootstrap_file_path(*test_path / "bootstrap");
+  BootstrapContacts bootstrap_contacts;
+  for (int i(0); i < 3; ++i)
+    bootstrap_contacts.emplace_back(maidsafe::GetLocalIp(), maidsafe::test::GetRandomPort());
+  ASSERT_NO_THROW(WriteBootstrapFile(bootstrap_contacts, bootstrap_file_path));
+  BootstrapContact added(maidsafe::GetLocalIp(), maidsafe::test::GetRandomPort());
+  ASSERT_NO_THROW(UpdateBootstrapFile(added, bootstrap_file_path, false));
+  ASSERT_NO_THROW(UpdateBootstrapFile(bootstrap_contacts.front(), bootstrap_file_path, true));
+
+  // An append cut short loses only itself; the records before it are still replayed.
+  const fs::path kJournalPath(bootstrap_file_path.string() + ".journal");
+  std::string journal(ReadFile(kJournalPath).string());
+  ASSERT_TRUE(WriteFile(kJournalPath, journal + journal.substr(0, journal.size() / 2 + 1)));
+  BootstrapContacts expected_bootstrap_contacts(1, added);
+  expected_bootstrap_contacts.push_back(bootstrap_contacts.back());
+  expected_bootstrap_contacts.push_back(bootstrap_contacts[1]);
+  EXPECT_EQ(expected_bootstrap_contacts, ReadBootstrapFile(bootstrap_file_path));
 }
 
 }  // namespace test
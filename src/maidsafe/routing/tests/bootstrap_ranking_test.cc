@@ -0,0 +1,113 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/bootstrap_ranking.h"
+#include "maidsafe/routing/parameters.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+BootstrapContacts MakeContacts(size_t count) {
+  BootstrapContacts contacts;
+  for (size_t i(0); i != count; ++i) {
+    contacts.push_back(BootstrapContact(boost::asio::ip::address_v4::loopback(),
+                                        static_cast<uint16_t>(5000 + i)));
+  }
+  return contacts;
+}
+
+}  // unnamed namespace
+
+TEST(BootstrapRankingTest, BEH_Order) {
+  BootstrapRanking ranking;
+  const BootstrapContacts kContacts(MakeContacts(4));
+  BootstrapContacts ordered(kContacts);
+  ranking.Order(ordered);
+  EXPECT_EQ(kContacts, ordered);
+
+  // Failed contacts sink below untried ones, and of two which succeed the quicker comes first.
+  ranking.RecordFailure(kContacts[0]);
+  ranking.RecordSuccess(kContacts[2], std::chrono::milliseconds(400));
+  ranking.RecordSuccess(kContacts[3], std::chrono::milliseconds(100));
+  ranking.Order(ordered);
+  ASSERT_EQ(4U, ordered.size());
+  EXPECT_EQ(kContacts[3], ordered[0]);
+  EXPECT_EQ(kContacts[2], ordered[1]);
+  EXPECT_EQ(kContacts[1], ordered[2]);
+  EXPECT_EQ(kContacts[0], ordered[3]);
+
+  EXPECT_EQ(1U, ranking.Get(kContacts[0]).failures);
+  EXPECT_EQ(1U, ranking.Get(kContacts[3]).successes);
+  EXPECT_EQ(std::chrono::milliseconds(100), ranking.Get(kContacts[3]).round_trip);
+}
+
+TEST(BootstrapRankingTest, BEH_OrderByLoad) {
+  BootstrapRanking ranking;
+  const BootstrapContacts kContacts(MakeContacts(4));
+  BootstrapContacts ordered(kContacts);
+
+  // An overloaded contact sinks below even a failed one, and of equally reliable contacts the
+  // lighter loaded comes first whatever its round trip.
+  ranking.RecordSuccess(kContacts[0], std::chrono::milliseconds(100));
+  ranking.RecordLoad(kContacts[0], Parameters::relay_overload_load);
+  ranking.RecordSuccess(kContacts[1], std::chrono::milliseconds(100));
+  ranking.RecordLoad(kContacts[1], 128);
+  ranking.RecordSuccess(kContacts[2], std::chrono::milliseconds(400));
+  ranking.RecordLoad(kContacts[2], 10);
+  ranking.RecordFailure(kContacts[3]);
+  ranking.Order(ordered);
+  ASSERT_EQ(4U, ordered.size());
+  EXPECT_EQ(kContacts[2], ordered[0]);
+  EXPECT_EQ(kContacts[1], ordered[1]);
+  EXPECT_EQ(kContacts[3], ordered[2]);
+  EXPECT_EQ(kContacts[0], ordered[3]);
+  EXPECT_EQ(1U, ranking.Get(kContacts[0]).successes);
+}
+
+TEST(BootstrapRankingTest, BEH_Waves) {
+  const BootstrapContacts kContacts(MakeContacts(10));
+  auto waves(BootstrapRanking::Waves(kContacts, 1));
+  ASSERT_EQ(4U, waves.size());
+  EXPECT_EQ(1U, waves[0].size());
+  EXPECT_EQ(2U, waves[1].size());
+  EXPECT_EQ(4U, waves[2].size());
+  EXPECT_EQ(3U, waves[3].size());
+  EXPECT_EQ(kContacts.front(), waves[0].front());
+  EXPECT_EQ(kContacts.back(), waves[3].back());
+
+  waves = BootstrapRanking::Waves(kContacts, 0);
+  ASSERT_EQ(1U, waves.size());
+  EXPECT_EQ(kContacts, waves[0]);
+  EXPECT_TRUE(BootstrapRanking::Waves(BootstrapContacts(), 1).empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
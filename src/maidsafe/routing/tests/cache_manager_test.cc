@@ -0,0 +1,160 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/cache_manager.h"
+#include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/signature_verifier.h"
+#include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/utils.h"
+#include "maidsafe/routing/tests/mock_network_utils.h"
+#include "maidsafe/routing/tests/mock_routing_table.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+class CacheManagerTest : public testing::Test {
+ public:
+  CacheManagerTest()
+      : asio_service_(2),
+        timer_(asio_service_),
+        keys_(asymm::GenerateKeyPair()),
+        network_statistics_(NodeId(NodeId::kRandomId)),
+        table_(false, NodeId(NodeId::kRandomId), keys_, network_statistics_),
+        client_table_(table_.kNodeId()),
+        network_(table_, client_table_, asio_service_),
+        cache_manager_(table_.kNodeId(), keys_.private_key, network_, timer_),
+        destination_id_(NodeId(NodeId::kRandomId)),
+        misses_(0),
+        kOldCoalesceCacheableGets_(Parameters::coalesce_cacheable_gets),
+        kOldSignNodeLevelMessages_(Parameters::sign_node_level_messages) {
+    cache_manager_.InitialiseFunctors(MessageAndCachingFunctors());
+  }
+
+  ~CacheManagerTest() {
+    Parameters::coalesce_cacheable_gets = kOldCoalesceCacheableGets_;
+    Parameters::sign_node_level_messages = kOldSignNodeLevelMessages_;
+  }
+
+ protected:
+  protobuf::Message MakeGet(const NodeId& source_id, const std::string& contents) {
+    protobuf::Message message;
+    message.set_routing_message(false);
+    message.set_direct(true);
+    message.set_request(true);
+    message.set_client_node(false);
+    message.set_hops_to_live(Parameters::hops_to_live - 1);
+    message.set_type(101);
+    message.set_id(RandomUint32());
+    message.set_source_id(source_id.string());
+    message.set_destination_id(destination_id_.string());
+    message.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+    message.add_data(contents);
+    return message;
+  }
+
+  bool HandleGet(protobuf::Message message) {
+    return cache_manager_.HandleGetFromCache(message, [this](protobuf::Message&) { ++misses_; });
+  }
+
+  AsioService asio_service_;
+  Timer<std::string> timer_;
+  asymm::Keys keys_;
+  NetworkStatistics network_statistics_;
+  MockRoutingTable table_;
+  ClientRoutingTable client_table_;
+  MockNetworkUtils network_;
+  CacheManager cache_manager_;
+  NodeId destination_id_;
+  int misses_;
+
+ private:
+  const bool kOldCoalesceCacheableGets_, kOldSignNodeLevelMessages_;
+};
+
+TEST_F(CacheManagerTest, BEH_CoalescingOffByDefault) {
+  EXPECT_CALL(network_, SendToClosestNode(testing::_)).Times(0);
+  EXPECT_FALSE(HandleGet(MakeGet(NodeId(NodeId::kRandomId), "chunk")));
+}
+
+TEST_F(CacheManagerTest, BEH_CoalesceGets) {
+  Parameters::coalesce_cacheable_gets = true;
+  Parameters::sign_node_level_messages = true;
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  std::vector<protobuf::Message> sent;
+  EXPECT_CALL(network_, SendToClosestNode(testing::_))
+      .WillRepeatedly(testing::Invoke([&](const protobuf::Message& message) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          sent.push_back(message);
+        }
+        cond_var.notify_one();
+      }));
+  const NodeId kSourceId(NodeId::kRandomId);
+
+  // Gets only share one in flight if they agree on source, destination and contents.
+  EXPECT_TRUE(HandleGet(MakeGet(kSourceId, "chunk")));
+  EXPECT_TRUE(HandleGet(MakeGet(kSourceId, "chunk")));
+  ASSERT_EQ(1U, sent.size());
+  EXPECT_TRUE(HandleGet(MakeGet(NodeId(NodeId::kRandomId), "chunk")));
+  EXPECT_TRUE(HandleGet(MakeGet(kSourceId, "other chunk")));
+  EXPECT_EQ(3U, sent.size());
+
+  // What is sent on is signed by this node, as its source.
+  const protobuf::Message kCoalesced(sent.front());
+  EXPECT_EQ(table_.kNodeId().string(), kCoalesced.source_id());
+  ASSERT_TRUE(kCoalesced.has_signature());
+  EXPECT_TRUE(asymm::CheckSignature(asymm::PlainText(SignedContent(kCoalesced)),
+                                    asymm::Signature(kCoalesced.signature()), keys_.public_key));
+
+  // Both parked requests are answered with the one reply.
+  std::unique_lock<std::mutex> lock(mutex);
+  sent.clear();
+  timer_.AddResponse(kCoalesced.id(), "reply");
+  ASSERT_TRUE(cond_var.wait_for(lock, std::chrono::seconds(2), [&] { return sent.size() == 2; }));
+  for (const auto& reply : sent) {
+    EXPECT_EQ(kSourceId.string(), reply.destination_id());
+    ASSERT_EQ(1, reply.data_size());
+    EXPECT_EQ("reply", reply.data(0));
+  }
+  EXPECT_EQ(0, misses_);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,126 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/chunk_cache.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(ChunkCacheTest, BEH_GetPut) {
+  ChunkCache cache(1000, 10, 2);
+  EXPECT_EQ(nullptr, cache.Get("key"));
+  EXPECT_TRUE(cache.Put("key", "value"));
+  ASSERT_NE(nullptr, cache.Get("key"));
+  EXPECT_EQ("value", *cache.Get("key"));
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_EQ(8U, cache.bytes());
+  EXPECT_TRUE(cache.Put("key", "other"));
+  EXPECT_EQ("other", *cache.Get("key"));
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_FALSE(cache.Put("big", std::string(600, 'b')));
+  EXPECT_EQ(nullptr, cache.Get("big"));
+}
+
+TEST(ChunkCacheTest, BEH_FewerEntriesThanShards) {
+  // Each shard still holds one entry, rather than three split four ways leaving none.
+  ChunkCache cache(1000, 3, 4);
+  EXPECT_TRUE(cache.Put("key", "value"));
+  EXPECT_EQ(1U, cache.size());
+  EXPECT_NE(nullptr, cache.Get("key"));
+  ChunkCache disabled(1000, 0, 4);
+  EXPECT_FALSE(disabled.Put("key", "value"));
+}
+
+TEST(ChunkCacheTest, BEH_StoresAreNotRequests) {
+  ChunkCache cache(1000, 1, 1);
+  cache.Get("popular");
+  EXPECT_TRUE(cache.Put("popular", "value"));
+  // Storing a key repeatedly doesn't make it more popular than one which was asked for.
+  for (int i(0); i != 4; ++i)
+    EXPECT_FALSE(cache.Put("stored", "value"));
+  EXPECT_NE(nullptr, cache.Get("popular"));
+}
+
+TEST(ChunkCacheTest, BEH_ByteBudget) {
+  const uint64_t kBudget(500);
+  ChunkCache cache(kBudget, 100, 1);
+  for (int i(0); i != 12; ++i) {
+    const std::string kKey("key" + std::to_string(i));
+    // Each newcomer is asked for more often than the entries before it, so is always admitted.
+    for (int j(0); j <= i; ++j)
+      cache.Get(kKey);
+    size_t evicted(0);
+    EXPECT_TRUE(cache.Put(kKey, std::string(95, 'v'), &evicted));
+    EXPECT_EQ(i < 5 ? 0U : 1U, evicted);
+    EXPECT_LE(cache.bytes(), kBudget);
+  }
+  EXPECT_EQ(5U, cache.size());
+  EXPECT_NE(nullptr, cache.Get("key11"));
+  EXPECT_EQ(nullptr, cache.Get("key0"));
+}
+
+TEST(ChunkCacheTest, BEH_ScanResistance) {
+  ChunkCache cache(1000, 1000, 1);
+  for (int i(0); i != 8; ++i) {
+    const std::string kKey("popular" + std::to_string(i));
+    for (int j(0); j != 4; ++j)
+      cache.Get(kKey);
+    EXPECT_TRUE(cache.Put(kKey, std::string(95, 'p')));
+  }
+  int admitted(0);
+  for (int i(0); i != 200; ++i) {
+    const std::string kKey("scan" + std::to_string(i));
+    cache.Get(kKey);
+    if (cache.Put(kKey, std::string(95, 's')))
+      ++admitted;
+  }
+  EXPECT_GE(1, admitted);
+  for (int i(0); i != 8; ++i)
+    EXPECT_NE(nullptr, cache.Get("popular" + std::to_string(i)));
+}
+
+TEST(ChunkCacheTest, BEH_SetByteLimit) {
+  ChunkCache cache(1000, 100, 1);
+  for (int i(0); i != 10; ++i)
+    EXPECT_TRUE(cache.Put("key" + std::to_string(i), std::string(95, 'v')));
+  EXPECT_EQ(5U, cache.SetByteLimit(500));
+  EXPECT_EQ(5U, cache.size());
+  EXPECT_EQ(nullptr, cache.Get("key0"));
+  EXPECT_NE(nullptr, cache.Get("key9"));
+  EXPECT_FALSE(cache.Put("big", std::string(600, 'b')));
+  EXPECT_EQ(5U, cache.SetByteLimit(0));
+  EXPECT_EQ(0U, cache.bytes());
+  EXPECT_FALSE(cache.Put("key0", "v"));
+  // A limit above the budget restores the budget.
+  EXPECT_EQ(0U, cache.SetByteLimit(5000));
+  EXPECT_TRUE(cache.Put("key0", std::string(95, 'v')));
+  EXPECT_FALSE(cache.Put("big", std::string(1001, 'b')));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -127,6 +127,17 @@ TEST_F(ClientRoutingTableTest, FUNC_CheckAddSurplusNodes) {
   EXPECT_EQ(Parameters::max_client_routing_table_size, client_routing_table.size());
 }
 
+TEST_F(ClientRoutingTableTest, BEH_PerInstanceMaxSize) {
+  const uint16_t kMaxSize(4);
+  ClientRoutingTable client_routing_table(node_id_, kMaxSize);
+
+  PopulateNodesSetFurthestCloseNode(kMaxSize + 1, client_routing_table.kNodeId());
+  for (uint16_t i(0); i < kMaxSize; ++i)
+    EXPECT_TRUE(client_routing_table.AddNode(nodes_.at(i), furthest_close_node_.node_id));
+  EXPECT_FALSE(client_routing_table.CheckNode(nodes_.at(kMaxSize), furthest_close_node_.node_id));
+  EXPECT_EQ(kMaxSize, client_routing_table.size());
+}
+
 TEST_F(ClientRoutingTableTest, BEH_CheckAddSameNodeIdTwice) {
   ClientRoutingTable client_routing_table(node_id_);
 
@@ -160,8 +171,7 @@ TEST_F(ClientRoutingTableTest, BEH_CheckAddSameConnectionIdTwice) {
   EXPECT_FALSE(client_routing_table.AddNode(nodes_.at(1), nodes_.at(2).node_id));
 }
 
-// TODO(Alison) - uncomment this test if it becomes relevant again
-/*TEST_F(ClientRoutingTableTest, BEH_CheckAddSameKeysTwice) {
+TEST_F(ClientRoutingTableTest, BEH_CheckAddSameKeysTwice) {
   ClientRoutingTable client_routing_table(node_id_);
 
   PopulateNodes(3);
@@ -175,7 +185,7 @@ TEST_F(ClientRoutingTableTest, BEH_CheckAddSameConnectionIdTwice) {
   EXPECT_TRUE(asymm::MatchingKeys(nodes_.at(0).public_key, nodes_.at(1).public_key));
   EXPECT_TRUE(client_routing_table.CheckNode(nodes_.at(1), nodes_.at(2).node_id));
   EXPECT_FALSE(client_routing_table.AddNode(nodes_.at(1), nodes_.at(2).node_id));
-}*/
+}
 
 TEST_F(ClientRoutingTableTest, BEH_CheckAddSameConnectionAndKeysTwice) {
   ClientRoutingTable client_routing_table(node_id_);
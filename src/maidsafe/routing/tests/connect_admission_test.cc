@@ -0,0 +1,97 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/connect_admission.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message QueueableMessage(int id) {
+  protobuf::Message message;
+  message.set_id(id);
+  return message;
+}
+
+}  // unnamed namespace
+
+TEST(ConnectAdmissionTest, BEH_LimitsAndQueues) {
+  const auto kNow(std::chrono::steady_clock::now());
+  ConnectAdmission admission(2, 1, std::chrono::seconds(10));
+  const NodeId kPeer0(NodeId::kRandomId), kPeer1(NodeId::kRandomId), kPeer2(NodeId::kRandomId);
+  EXPECT_TRUE(admission.TryAdmit(kPeer0, kNow));
+  EXPECT_TRUE(admission.TryAdmit(kPeer1, kNow));
+  // A repeated request from a peer already admitted isn't counted again.
+  EXPECT_TRUE(admission.TryAdmit(kPeer0, kNow));
+  EXPECT_EQ(2U, admission.attempts());
+  EXPECT_FALSE(admission.TryAdmit(kPeer2, kNow));
+
+  auto message(QueueableMessage(1));
+  EXPECT_TRUE(admission.Queue(message, kNow));
+  auto overflow(QueueableMessage(2));
+  EXPECT_FALSE(admission.Queue(overflow, kNow));
+  EXPECT_EQ(1U, admission.queued());
+
+  protobuf::Message next;
+  EXPECT_FALSE(admission.NextQueued(next, kNow));
+  admission.Release(kPeer1);
+  ASSERT_TRUE(admission.NextQueued(next, kNow));
+  EXPECT_EQ(1, next.id());
+  EXPECT_EQ(0U, admission.queued());
+  EXPECT_TRUE(admission.TryAdmit(kPeer2, kNow));
+}
+
+TEST(ConnectAdmissionTest, BEH_Expiry) {
+  const auto kNow(std::chrono::steady_clock::now());
+  const auto kLater(kNow + std::chrono::seconds(10));
+  ConnectAdmission admission(1, 4, std::chrono::seconds(10));
+  EXPECT_TRUE(admission.TryAdmit(NodeId(NodeId::kRandomId), kNow));
+  auto message(QueueableMessage(1));
+  EXPECT_TRUE(admission.Queue(message, kNow));
+
+  // The attempt has timed out, as has the request queued behind it.
+  protobuf::Message next;
+  EXPECT_FALSE(admission.NextQueued(next, kLater));
+  EXPECT_EQ(0U, admission.attempts());
+  EXPECT_EQ(0U, admission.queued());
+  EXPECT_TRUE(admission.TryAdmit(NodeId(NodeId::kRandomId), kLater));
+  // The expired request is handed back once, to be refused.
+  ASSERT_TRUE(admission.NextExpired(next));
+  EXPECT_EQ(1, next.id());
+  EXPECT_FALSE(admission.NextExpired(next));
+
+  ConnectAdmission unlimited(0, 0, std::chrono::seconds(10));
+  for (int i(0); i != 100; ++i)
+    EXPECT_TRUE(unlimited.TryAdmit(NodeId(NodeId::kRandomId), kNow));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,94 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/data_compression.h"
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message NodeLevelMessage(const std::string& data) {
+  protobuf::Message message;
+  message.set_routing_message(false);
+  message.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
+  message.add_data(data);
+  return message;
+}
+
+}  // unnamed namespace
+
+TEST(DataCompressionTest, BEH_CompressesLargeRepetitivePayloads) {
+  const std::string kPayload(std::string(Parameters::compression_threshold * 4, 'a'));
+  protobuf::Message message(NodeLevelMessage(kPayload));
+  EXPECT_TRUE(CompressData(message));
+  EXPECT_TRUE(message.has_data_compression());
+  EXPECT_LT(message.data(0).size(), kPayload.size());
+  EXPECT_FALSE(CompressData(message));  // already compressed
+  EXPECT_TRUE(UncompressData(message));
+  EXPECT_FALSE(message.has_data_compression());
+  EXPECT_EQ(kPayload, message.data(0));
+}
+
+TEST(DataCompressionTest, BEH_LeavesOtherPayloadsAlone) {
+  protobuf::Message small(NodeLevelMessage(std::string(10, 'a')));
+  EXPECT_FALSE(CompressData(small));
+  protobuf::Message incompressible(
+      NodeLevelMessage(RandomString(Parameters::compression_threshold * 2)));
+  EXPECT_FALSE(CompressData(incompressible));
+  EXPECT_FALSE(incompressible.has_data_compression());
+  protobuf::Message cacheable(
+      NodeLevelMessage(std::string(Parameters::compression_threshold, 'a')));
+  cacheable.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+  EXPECT_FALSE(CompressData(cacheable));
+  protobuf::Message corrupt(NodeLevelMessage("not deflated"));
+  corrupt.set_data_compression(protobuf::kDeflate);
+  EXPECT_FALSE(UncompressData(corrupt));
+}
+
+TEST(DataCompressionTest, BEH_RejectsOversizedPayloads) {
+  const uint32_t kOldMaxDataSize(Parameters::max_data_size);
+  const std::string kPayload(std::string(Parameters::compression_threshold * 64, 'a'));
+  protobuf::Message message(NodeLevelMessage(kPayload));
+  ASSERT_TRUE(CompressData(message));
+  protobuf::Message copy(message);
+  Parameters::max_data_size = static_cast<uint32_t>(kPayload.size());
+  EXPECT_TRUE(UncompressData(copy));
+  EXPECT_EQ(kPayload, copy.data(0));
+  // However small it was sent, nothing over max_data_size comes out.
+  Parameters::max_data_size = static_cast<uint32_t>(kPayload.size() - 1);
+  EXPECT_FALSE(UncompressData(message));
+  Parameters::max_data_size = kOldMaxDataSize;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/duplicate_filter.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(DuplicateFilterTest, BEH_NewMessageId) {
+  const NodeId kSourceId(NodeId::kRandomId);
+  const std::string kPrefix(kSourceId.string().substr(0, 4));
+  std::set<uint64_t> ids;
+  for (int i(0); i != 1000; ++i) {
+    uint64_t id(NewMessageId(kSourceId));
+    std::string prefix;
+    for (int shift(56); shift != 24; shift -= 8)
+      prefix.push_back(static_cast<char>((id >> shift) & 0xFF));
+    EXPECT_EQ(kPrefix, prefix);
+    EXPECT_TRUE(ids.insert(id).second);
+  }
+}
+
+TEST(DuplicateFilterTest, BEH_DuplicateKey) {
+  const std::string kDestination(NodeId(NodeId::kRandomId).string());
+  const uint64_t kKey(DuplicateKey(1, kDestination, true, false));
+  EXPECT_EQ(kKey, DuplicateKey(1, kDestination, true, false));
+  EXPECT_NE(kKey, DuplicateKey(2, kDestination, true, false));
+  EXPECT_NE(kKey, DuplicateKey(1, NodeId(NodeId::kRandomId).string(), true, false));
+  EXPECT_NE(kKey, DuplicateKey(1, kDestination, false, false));
+  EXPECT_NE(kKey, DuplicateKey(1, kDestination, true, true));
+}
+
+TEST(DuplicateFilterTest, BEH_Insert) {
+  const uint64_t kCapacity(100);
+  DuplicateFilter filter(kCapacity, std::chrono::hours(1));
+  for (uint64_t key(1); key <= kCapacity / 2; ++key)
+    EXPECT_TRUE(filter.Insert(key));
+  for (uint64_t key(1); key <= kCapacity / 2; ++key)
+    EXPECT_FALSE(filter.Insert(key));
+  // Keys are forgotten once two further generations have been started.
+  for (uint64_t key(kCapacity); key != 2 * kCapacity; ++key)
+    EXPECT_TRUE(filter.Insert(key));
+  EXPECT_TRUE(filter.Insert(1));
+
+  DuplicateFilter zero_filter(kCapacity, std::chrono::hours(1));
+  EXPECT_TRUE(zero_filter.Insert(0));
+  EXPECT_FALSE(zero_filter.Insert(0));
+}
+
+TEST(DuplicateFilterTest, BEH_Window) {
+  DuplicateFilter filter(100, std::chrono::milliseconds(100));
+  EXPECT_TRUE(filter.Insert(7));
+  EXPECT_FALSE(filter.Insert(7));
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_TRUE(filter.Insert(8));
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  EXPECT_TRUE(filter.Insert(7));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
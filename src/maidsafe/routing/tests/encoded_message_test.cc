@@ -0,0 +1,70 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/encoded_message.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(EncodedMessageTest, BEH_ForDestination) {
+  protobuf::Message message;
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.set_routing_message(false);
+  message.add_data("DATA");
+  message.set_direct(true);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.set_hops_to_live(10);
+  message.set_id(123);
+  message.set_type(101);
+
+  EncodedMessage encoded_message(message);
+  EXPECT_EQ(123, encoded_message.id());
+  EXPECT_EQ(101, encoded_message.type());
+  EXPECT_EQ(10, encoded_message.hops_to_live());
+
+  for (int i(0); i != 3; ++i) {
+    NodeId destination_id(NodeId::kRandomId);
+    protobuf::Message decoded;
+    ASSERT_TRUE(decoded.ParseFromString(encoded_message.ForDestination(destination_id)));
+    protobuf::Message expected(message);
+    expected.set_destination_id(destination_id.string());
+    EXPECT_EQ(expected.SerializeAsString(), decoded.SerializeAsString());
+  }
+
+  protobuf::Message decoded;
+  ASSERT_TRUE(decoded.ParseFromString(encoded_message.ForDestination(std::string())));
+  EXPECT_FALSE(decoded.has_destination_id());
+  EXPECT_EQ(message.source_id(), decoded.source_id());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
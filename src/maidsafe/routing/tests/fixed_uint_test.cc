@@ -0,0 +1,76 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/fixed_uint.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+crypto::BigInt ToBigInt(const NodeId& node_id) {
+  return crypto::BigInt((node_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
+}
+
+}  // unnamed namespace
+
+TEST(FixedUintTest, BEH_MatchesBigInt) {
+  for (int i(0); i != 100; ++i) {
+    NodeId lhs(NodeId::kRandomId), rhs(NodeId::kRandomId);
+    uint32_t factor(RandomUint32() % 1000 + 1);
+    DistanceUint lhs_distance(lhs, rhs), rhs_distance(rhs);
+    EXPECT_EQ(lhs ^ rhs, lhs_distance.ToNodeId());
+    EXPECT_EQ(ToBigInt(lhs ^ rhs) < ToBigInt(rhs), lhs_distance < rhs_distance);
+    EXPECT_EQ(ToBigInt(lhs ^ rhs) * factor < ToBigInt(rhs) * factor + ToBigInt(lhs),
+              lhs_distance * factor < rhs_distance * factor + DistanceUint(lhs));
+    EXPECT_EQ(lhs_distance, (lhs_distance * factor) / factor);
+    EXPECT_EQ(lhs_distance, (lhs_distance << 41) >> 41);
+    EXPECT_EQ(lhs_distance, (lhs_distance + rhs_distance) - rhs_distance);
+    EXPECT_EQ(lhs_distance * factor - lhs_distance, lhs_distance * (factor - 1));
+  }
+}
+
+TEST(FixedUintTest, BEH_Headroom) {
+  DistanceUint max_distance(NodeId(NodeId::kMaxId));
+  DistanceUint scaled(max_distance * 65535);
+  EXPECT_GT(scaled, max_distance);
+  EXPECT_EQ(max_distance, scaled / 65535);
+  DistanceUint sum;
+  for (int i(0); i != 1000; ++i)
+    sum += max_distance;
+  EXPECT_EQ(max_distance, sum / 1000);
+  EXPECT_EQ(DistanceUint(1) << 512, max_distance + DistanceUint(1));
+  EXPECT_EQ(max_distance, (DistanceUint(1) << 512) - DistanceUint(1));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,62 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/frequency_sketch.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(FrequencySketchTest, BEH_Estimate) {
+  FrequencySketch sketch(256);
+  const uint64_t kHash(FrequencySketch::HashOf("popular"));
+  EXPECT_EQ(0, sketch.Estimate(kHash));
+  for (int i(0); i != 5; ++i)
+    sketch.Increment(kHash);
+  EXPECT_EQ(5, sketch.Estimate(kHash));
+  sketch.Increment(FrequencySketch::HashOf("other"));
+  EXPECT_EQ(5, sketch.Estimate(kHash));
+  for (int i(0); i != 20; ++i)
+    sketch.Increment(kHash);
+  EXPECT_EQ(FrequencySketch::kMaxFrequency, sketch.Estimate(kHash));
+}
+
+TEST(FrequencySketchTest, BEH_Decay) {
+  // 16 counters per row, so all are halved after 160 increments.
+  FrequencySketch sketch(16);
+  const uint64_t kHash(FrequencySketch::HashOf("popular"));
+  for (int i(0); i != 8; ++i)
+    sketch.Increment(kHash);
+  EXPECT_EQ(8, sketch.Estimate(kHash));
+  for (int i(0); i != 152; ++i)
+    sketch.Increment(FrequencySketch::HashOf("one-off " + std::to_string(i)));
+  EXPECT_GT(8, sketch.Estimate(kHash));
+  EXPECT_LE(4, sketch.Estimate(kHash));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
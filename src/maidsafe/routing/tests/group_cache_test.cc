@@ -0,0 +1,122 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/group_cache.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::vector<NodeId> RandomGroup(const NodeId& group_id) {
+  std::vector<NodeId> group;
+  for (int i(0); i != Parameters::group_size; ++i)
+    group.push_back(NodeId(NodeId::kRandomId));
+  SortByDistance(group, group_id);
+  return group;
+}
+
+}  // unnamed namespace
+
+TEST(GroupCacheTest, BEH_GetAdd) {
+  GroupCache group_cache;
+  const NodeId kGroupId(NodeId::kRandomId);
+  std::vector<NodeId> group;
+  EXPECT_FALSE(group_cache.Get(kGroupId, group));
+  const std::vector<NodeId> kGroup(RandomGroup(kGroupId));
+  group_cache.Add(kGroupId, kGroup);
+  ASSERT_TRUE(group_cache.Get(kGroupId, group));
+  EXPECT_EQ(kGroup, group);
+  EXPECT_EQ(1U, group_cache.size());
+}
+
+TEST(GroupCacheTest, BEH_Expiry) {
+  const auto kOldTtl(Parameters::group_cache_ttl);
+  Parameters::group_cache_ttl = std::chrono::steady_clock::duration::zero();
+  GroupCache group_cache;
+  const NodeId kGroupId(NodeId::kRandomId);
+  group_cache.Add(kGroupId, RandomGroup(kGroupId));
+  std::vector<NodeId> group;
+  EXPECT_FALSE(group_cache.Get(kGroupId, group));
+  Parameters::group_cache_ttl = kOldTtl;
+}
+
+TEST(GroupCacheTest, BEH_Capacity) {
+  GroupCache group_cache;
+  for (int i(0); i != Parameters::group_cache_size + 10; ++i) {
+    const NodeId kGroupId(NodeId::kRandomId);
+    group_cache.Add(kGroupId, RandomGroup(kGroupId));
+  }
+  EXPECT_EQ(Parameters::group_cache_size, group_cache.size());
+}
+
+TEST(GroupCacheTest, BEH_ClosestNodesUpdate) {
+  GroupCache group_cache;
+  const NodeId kGroupId(NodeId::kRandomId);
+  const std::vector<NodeId> kGroup(RandomGroup(kGroupId));
+  const NodeId kOtherGroupId(NodeId::kRandomId);
+  group_cache.Add(kGroupId, kGroup);
+  group_cache.Add(kOtherGroupId, RandomGroup(kOtherGroupId));
+
+  // A member leaving invalidates only the groups it was in.
+  protobuf::ClosestNodesUpdate removal;
+  removal.set_node(NodeId(NodeId::kRandomId).string());
+  removal.set_delta(true);
+  removal.add_removed_nodes(kGroup.front().string());
+  group_cache.HandleClosestNodesUpdate(removal);
+  std::vector<NodeId> group;
+  EXPECT_FALSE(group_cache.Get(kGroupId, group));
+  EXPECT_TRUE(group_cache.Get(kOtherGroupId, group));
+
+  // A node arriving closer than a group's furthest member invalidates it.
+  group_cache.Add(kGroupId, kGroup);
+  protobuf::ClosestNodesUpdate addition;
+  addition.set_node(NodeId(NodeId::kRandomId).string());
+  addition.set_delta(true);
+  addition.add_nodes_info()->set_node_id(kGroupId.string());
+  group_cache.HandleClosestNodesUpdate(addition);
+  EXPECT_FALSE(group_cache.Get(kGroupId, group));
+
+  // A full update gives the group around its sender.
+  const NodeId kSender(NodeId::kRandomId);
+  protobuf::ClosestNodesUpdate full;
+  full.set_node(kSender.string());
+  for (int i(0); i != Parameters::closest_nodes_size; ++i)
+    full.add_nodes_info()->set_node_id(NodeId(NodeId::kRandomId).string());
+  group_cache.HandleClosestNodesUpdate(full);
+  ASSERT_TRUE(group_cache.Get(kSender, group));
+  EXPECT_EQ(Parameters::group_size, group.size());
+  EXPECT_EQ(kSender, group.front());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -863,6 +863,119 @@ TEST_P(GroupMatrixTest, BEH_CheckUniqueNodeList) {
   }
 }
 
+TEST_P(GroupMatrixTest, BEH_UniqueNodesSharedBetweenRows) {
+  // Two rows reporting the same node: it must stay unique until both rows have dropped it.
+  NodeInfo peer_1, peer_2, shared_node;
+  peer_1.node_id = NodeId(NodeId::kRandomId);
+  peer_2.node_id = NodeId(NodeId::kRandomId);
+  shared_node.node_id = NodeId(NodeId::kRandomId);
+  matrix_.AddConnectedPeer(peer_1);
+  matrix_.AddConnectedPeer(peer_2);
+  matrix_.UpdateFromConnectedPeer(peer_1.node_id, std::vector<NodeInfo>(1, shared_node),
+                                  std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(peer_2.node_id, std::vector<NodeInfo>(1, shared_node),
+                                  std::vector<NodeId>());
+  size_t own_entry(client_mode_ ? 0 : 1);
+  EXPECT_EQ(3 + own_entry, matrix_.GetUniqueNodes().size());
+
+  matrix_.RemoveConnectedPeer(peer_1);
+  EXPECT_EQ(2 + own_entry, matrix_.GetUniqueNodes().size());
+  EXPECT_TRUE(matrix_.Contains(shared_node.node_id));
+  EXPECT_FALSE(matrix_.Contains(peer_1.node_id));
+
+  matrix_.UpdateFromConnectedPeer(peer_2.node_id, std::vector<NodeInfo>(), std::vector<NodeId>());
+  EXPECT_EQ(1 + own_entry, matrix_.GetUniqueNodes().size());
+  EXPECT_FALSE(matrix_.Contains(shared_node.node_id));
+
+  auto unique_nodes(matrix_.GetUniqueNodes());
+  auto sorted_nodes(unique_nodes);
+  SortNodeInfosFromTarget(own_node_id_, sorted_nodes);
+  for (size_t i(0); i != unique_nodes.size(); ++i)
+    EXPECT_EQ(sorted_nodes.at(i).node_id, unique_nodes.at(i).node_id);
+}
+
+TEST_P(GroupMatrixTest, BEH_RowHoldersFollowRowChanges) {
+  // Lookups by entry go through the rows recorded as holding it, so must follow every row update.
+  NodeInfo peer_1, peer_2, target;
+  peer_1.node_id = NodeId(NodeId::kRandomId);
+  peer_2.node_id = NodeId(NodeId::kRandomId);
+  target.node_id = NodeId(NodeId::kRandomId);
+  matrix_.AddConnectedPeer(peer_1);
+  matrix_.AddConnectedPeer(peer_2);
+  EXPECT_EQ(0, matrix_.GetAllConnectedPeersFor(target.node_id).size());
+  EXPECT_EQ(NodeId(), matrix_.GetConnectedPeerFor(target.node_id).node_id);
+
+  matrix_.UpdateFromConnectedPeer(peer_1.node_id, std::vector<NodeInfo>(1, target),
+                                  std::vector<NodeId>());
+  matrix_.UpdateFromConnectedPeer(peer_2.node_id, std::vector<NodeInfo>(1, target),
+                                  std::vector<NodeId>());
+  std::vector<NodeInfo> both_peers;
+  both_peers.push_back(peer_1);
+  both_peers.push_back(peer_2);
+  EXPECT_TRUE(CompareListOfNodeInfos(both_peers, matrix_.GetAllConnectedPeersFor(target.node_id)));
+
+  // Dropping the entry from one row leaves only the other as a holder.
+  matrix_.UpdateFromConnectedPeer(peer_1.node_id, std::vector<NodeInfo>(), std::vector<NodeId>());
+  auto holders(matrix_.GetAllConnectedPeersFor(target.node_id));
+  ASSERT_EQ(1, holders.size());
+  EXPECT_EQ(peer_2.node_id, holders.front().node_id);
+  EXPECT_EQ(peer_2.node_id, matrix_.GetConnectedPeerFor(target.node_id).node_id);
+
+  // Re-adding it to the first row and then removing the second peer moves it back.
+  matrix_.UpdateFromConnectedPeer(peer_1.node_id, std::vector<NodeInfo>(1, target),
+                                  std::vector<NodeId>());
+  matrix_.RemoveConnectedPeer(peer_2);
+  holders = matrix_.GetAllConnectedPeersFor(target.node_id);
+  ASSERT_EQ(1, holders.size());
+  EXPECT_EQ(peer_1.node_id, holders.front().node_id);
+  EXPECT_EQ(peer_1.node_id, matrix_.GetConnectedPeerFor(target.node_id).node_id);
+
+  matrix_.RemoveConnectedPeer(peer_1);
+  EXPECT_EQ(0, matrix_.GetAllConnectedPeersFor(target.node_id).size());
+  EXPECT_EQ(NodeId(), matrix_.GetConnectedPeerFor(target.node_id).node_id);
+}
+
+TEST_P(GroupMatrixTest, BEH_RecordsInternedAndReused) {
+  // A connected peer's own entry is held once and preferred over copies reported in other rows.
+  NodeInfo peer_1, peer_2;
+  peer_1.node_id = NodeId(NodeId::kRandomId);
+  peer_1.connection_id = NodeId(NodeId::kRandomId);
+  peer_2.node_id = NodeId(NodeId::kRandomId);
+  NodeInfo reported_peer_1(peer_1);
+  reported_peer_1.connection_id = NodeId(NodeId::kRandomId);
+  matrix_.AddConnectedPeer(peer_2);
+  matrix_.UpdateFromConnectedPeer(peer_2.node_id, std::vector<NodeInfo>(1, reported_peer_1),
+                                  std::vector<NodeId>());
+  matrix_.AddConnectedPeer(peer_1);
+  size_t own_entry(client_mode_ ? 0 : 1);
+  auto unique_nodes(matrix_.GetUniqueNodes());
+  EXPECT_EQ(2 + own_entry, unique_nodes.size());
+  for (const auto& node : unique_nodes) {
+    if (node.node_id == peer_1.node_id)
+      EXPECT_EQ(peer_1.connection_id, node.connection_id);
+  }
+
+  // Records freed by churn are reused, so repeating the same churn doesn't grow the matrix.
+  std::vector<NodeInfo> row_entries;
+  for (uint16_t i(0); i < Parameters::closest_nodes_size; ++i) {
+    NodeInfo node_info;
+    node_info.node_id = NodeId(NodeId::kRandomId);
+    row_entries.push_back(node_info);
+  }
+  auto churn([&] {
+    matrix_.UpdateFromConnectedPeer(peer_1.node_id, row_entries, std::vector<NodeId>());
+    matrix_.UpdateFromConnectedPeer(peer_1.node_id, std::vector<NodeInfo>(),
+                                    std::vector<NodeId>());
+  });
+  churn();
+  const uint64_t kBytesAfterChurn(matrix_.MemoryBytes());
+  EXPECT_EQ(2 + own_entry, matrix_.GetUniqueNodes().size());
+  for (int i(0); i != 10; ++i)
+    churn();
+  EXPECT_EQ(kBytesAfterChurn, matrix_.MemoryBytes());
+  EXPECT_EQ(2 + own_entry, matrix_.GetUniqueNodes().size());
+}
+
 TEST_P(GroupMatrixTest, BEH_GetAllConnectedPeers) {
   // Add rows to matrix and check GetUniqueNodes
   std::vector<NodeInfo> row_ids;
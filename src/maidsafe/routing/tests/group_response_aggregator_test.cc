@@ -0,0 +1,104 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/group_response_aggregator.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/timer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message MakeReply(const std::string& requester_id, int32_t id,
+                            const std::string& payload) {
+  protobuf::Message reply;
+  reply.set_routing_message(false);
+  reply.set_direct(true);
+  reply.set_client_node(false);
+  reply.set_request(false);
+  reply.set_hops_to_live(1);
+  reply.set_source_id(NodeId(NodeId::kRandomId).string());
+  reply.set_signature("signature of " + reply.source_id());
+  reply.set_aggregate_for(requester_id);
+  reply.set_id(id);
+  reply.add_data(payload);
+  return reply;
+}
+
+}  // unnamed namespace
+
+TEST(GroupResponseAggregatorTest, BEH_MergesIdenticalPayloads) {
+  AsioService asio_service(1);
+  Timer<std::string> timer(asio_service);
+  std::mutex mutex;
+  std::condition_variable cond_var;
+  std::vector<protobuf::Message> sent;
+  GroupResponseAggregator aggregator(timer, [&](protobuf::Message& merged) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sent.push_back(merged);
+    cond_var.notify_one();
+  });
+
+  const std::string kRequesterId(NodeId(NodeId::kRandomId).string());
+  protobuf::Message request;
+  request.set_source_id(kRequesterId);
+  request.set_id(7);
+  aggregator.Expect(request, 3);
+
+  EXPECT_FALSE(aggregator.Add(MakeReply(kRequesterId, 8, "agreed")));
+  auto first(MakeReply(kRequesterId, 7, "agreed")), second(MakeReply(kRequesterId, 7, "agreed"));
+  EXPECT_TRUE(aggregator.Add(first));
+  EXPECT_TRUE(aggregator.Add(MakeReply(kRequesterId, 7, "dissent")));
+  EXPECT_TRUE(aggregator.Add(second));
+
+  std::unique_lock<std::mutex> lock(mutex);
+  ASSERT_TRUE(cond_var.wait_for(lock, std::chrono::seconds(5), [&] { return sent.size() == 2; }));
+  for (const auto& merged : sent) {
+    EXPECT_FALSE(merged.has_aggregate_for());
+    if (merged.data(0) == "agreed") {
+      ASSERT_EQ(1, merged.aggregated_source_ids_size());
+      EXPECT_EQ(first.source_id(), merged.source_id());
+      EXPECT_EQ(second.source_id(), merged.aggregated_source_ids(0));
+      EXPECT_EQ(second.signature(), merged.aggregated_signatures(0));
+    } else {
+      EXPECT_EQ("dissent", merged.data(0));
+      EXPECT_EQ(0, merged.aggregated_source_ids_size());
+    }
+  }
+  lock.unlock();
+  EXPECT_FALSE(aggregator.Add(MakeReply(kRequesterId, 7, "agreed")));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,187 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/asio_service.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/core_executors.h"
+#include "maidsafe/routing/inbound_dispatcher.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(InboundDispatcherTest, BEH_PerKeyOrder) {
+  const int kKeyCount(5), kHandlersPerKey(200);
+  AsioService asio_service(4);
+  InboundDispatcher dispatcher(asio_service.service(), 3, kHandlersPerKey * kKeyCount);
+  EXPECT_EQ(4U, dispatcher.QueueDepths().size());
+
+  std::mutex mutex;
+  std::vector<std::vector<int>> handled(kKeyCount);
+  int remaining(kKeyCount * kHandlersPerKey + 1);
+  std::promise<void> done_promise;
+  auto count_down([&]() {
+    if (--remaining == 0)
+      done_promise.set_value();
+  });
+  for (int i(0); i != kHandlersPerKey; ++i) {
+    for (int key(0); key != kKeyCount; ++key) {
+      dispatcher.Post(std::to_string(key), [&, key, i]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        handled[key].push_back(i);
+        count_down();
+      });
+    }
+  }
+  dispatcher.PostControl([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    count_down();
+  });
+  ASSERT_EQ(std::future_status::ready,
+            done_promise.get_future().wait_for(std::chrono::seconds(10)));
+
+  for (const auto& key_handled : handled) {
+    ASSERT_EQ(kHandlersPerKey, static_cast<int>(key_handled.size()));
+    for (int i(0); i != kHandlersPerKey; ++i)
+      EXPECT_EQ(i, key_handled[i]);
+  }
+  for (auto depth : dispatcher.QueueDepths())
+    EXPECT_EQ(0U, depth);
+}
+
+TEST(InboundDispatcherTest, BEH_ControlFirstAndShedding) {
+  const int kDataCount(10);
+  AsioService asio_service(1);
+  InboundDispatcher dispatcher(asio_service.service(), 2, kDataCount);
+
+  // Hold the only thread so that everything below is queued before any of it runs.
+  std::promise<void> blocked_promise, release_promise;
+  std::shared_future<void> release(release_promise.get_future());
+  EXPECT_TRUE(dispatcher.Post("blocker", [&]() {
+    blocked_promise.set_value();
+    release.wait();
+  }));
+  blocked_promise.get_future().wait();
+
+  std::mutex mutex;
+  std::vector<int> handled;
+  std::promise<void> done_promise;
+  int accepted(0);
+  for (int i(0); i != 2 * kDataCount; ++i) {
+    if (dispatcher.Post("data", [&, i]() {
+          std::lock_guard<std::mutex> lock(mutex);
+          handled.push_back(i);
+          if (static_cast<int>(handled.size()) == kDataCount + 1)
+            done_promise.set_value();
+        })) {
+      ++accepted;
+    }
+  }
+  EXPECT_EQ(kDataCount, accepted);
+  dispatcher.PostControl([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    handled.push_back(-1);
+  });
+  release_promise.set_value();
+  ASSERT_EQ(std::future_status::ready,
+            done_promise.get_future().wait_for(std::chrono::seconds(10)));
+
+  ASSERT_EQ(kDataCount + 1, static_cast<int>(handled.size()));
+  EXPECT_EQ(-1, handled.front());
+  for (int i(0); i != kDataCount; ++i)
+    EXPECT_EQ(i, handled[i + 1]);
+}
+
+TEST(InboundDispatcherTest, BEH_ThrowingHandler) {
+  AsioService asio_service(1);
+  InboundDispatcher dispatcher(asio_service.service(), 1, 10);
+  // A handler which throws leaves its shard free for the next, on a thread which keeps running.
+  std::promise<void> data_promise, control_promise;
+  dispatcher.Post("key", []() { throw std::runtime_error("data"); });
+  dispatcher.Post("key", [&]() { data_promise.set_value(); });
+  dispatcher.PostControl([]() { throw std::runtime_error("control"); });
+  dispatcher.PostControl([&]() { control_promise.set_value(); });
+  EXPECT_EQ(std::future_status::ready,
+            data_promise.get_future().wait_for(std::chrono::seconds(10)));
+  EXPECT_EQ(std::future_status::ready,
+            control_promise.get_future().wait_for(std::chrono::seconds(10)));
+}
+
+TEST(InboundDispatcherTest, BEH_PerCoreShards) {
+  const int kKeyCount(4), kHandlersPerKey(100);
+  AsioService asio_service(1);
+  CoreExecutors cores(2, true);
+  InboundDispatcher dispatcher(asio_service.service(), 4, kHandlersPerKey * kKeyCount, &cores);
+
+  std::mutex mutex;
+  std::vector<std::vector<int>> handled(kKeyCount);
+  std::vector<std::vector<std::thread::id>> threads(kKeyCount);
+  std::thread::id control_thread;
+  int remaining(kKeyCount * kHandlersPerKey + 1);
+  std::promise<void> done_promise;
+  auto count_down([&]() {
+    if (--remaining == 0)
+      done_promise.set_value();
+  });
+  for (int i(0); i != kHandlersPerKey; ++i) {
+    for (int key(0); key != kKeyCount; ++key) {
+      dispatcher.Post(std::to_string(key), [&, key, i]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        handled[key].push_back(i);
+        threads[key].push_back(std::this_thread::get_id());
+        count_down();
+      });
+    }
+  }
+  dispatcher.PostControl([&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    control_thread = std::this_thread::get_id();
+    count_down();
+  });
+  ASSERT_EQ(std::future_status::ready,
+            done_promise.get_future().wait_for(std::chrono::seconds(10)));
+
+  // Each key's handlers run in order, all on the same core's thread, and never on the shared one.
+  for (int key(0); key != kKeyCount; ++key) {
+    ASSERT_EQ(kHandlersPerKey, static_cast<int>(handled[key].size()));
+    for (int i(0); i != kHandlersPerKey; ++i) {
+      EXPECT_EQ(i, handled[key][i]);
+      EXPECT_EQ(threads[key].front(), threads[key][i]);
+    }
+    EXPECT_NE(control_thread, threads[key].front());
+  }
+  for (auto depth : dispatcher.QueueDepths())
+    EXPECT_EQ(0U, depth);
+  cores.Stop();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,97 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tests/inbound_trace_replayer.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+
+#include "maidsafe/routing/inbound_trace.h"
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+void ReplayMessage(const std::string& message, MessageHandler& message_handler,
+                   protobuf::Message& pb_message, ReplayResult& result) {
+  ++result.messages;
+  MessageHeader header;
+  if (header.Decode(message) && message_handler.ForwardAsFarNode(header, message))
+    return;
+  pb_message.Clear();
+  if (!pb_message.ParseFromString(message)) {
+    ++result.unparsed;
+    return;
+  }
+  message_handler.HandleMessage(pb_message);
+}
+
+}  // unnamed namespace
+
+ReplayResult ReplayInboundTrace(const boost::filesystem::path& path,
+                                MessageHandler& message_handler, RoutingTable& routing_table,
+                                ReplaySpeed speed) {
+  InboundTraceReader reader(path);
+  ReplayResult result;
+  protobuf::Message pb_message;
+  InboundTraceEvent event;
+  const auto kStart(std::chrono::steady_clock::now());
+  while (reader.Next(event)) {
+    if (speed == ReplaySpeed::kRecorded)
+      std::this_thread::sleep_until(kStart + event.offset);
+    if (event.kind == InboundTraceEvent::kConnectionLost) {
+      ++result.connections_lost;
+      routing_table.DropNode(NodeId(event.payload), true);
+      continue;
+    }
+    if (!IsMessageBatch(event.payload)) {
+      ReplayMessage(event.payload, message_handler, pb_message, result);
+      continue;
+    }
+    std::vector<std::string> messages;
+    if (!ParseMessageBatch(event.payload, messages)) {
+      ++result.unparsed;
+      continue;
+    }
+    for (const auto& message : messages) {
+      if (!IsMessageBatch(message))
+        ReplayMessage(message, message_handler, pb_message, result);
+    }
+  }
+  result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - kStart);
+  return result;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
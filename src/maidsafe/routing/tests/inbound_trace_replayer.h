@@ -0,0 +1,63 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TESTS_INBOUND_TRACE_REPLAYER_H_
+#define MAIDSAFE_ROUTING_TESTS_INBOUND_TRACE_REPLAYER_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "boost/filesystem/path.hpp"
+
+namespace maidsafe {
+
+namespace routing {
+
+class MessageHandler;
+class RoutingTable;
+
+namespace test {
+
+enum class ReplaySpeed {
+  kRecorded,  // each event waits for its recorded offset from the start of the replay
+  kMaximum    // events follow one another as fast as they can be handled
+};
+
+struct ReplayResult {
+  ReplayResult() : messages(0), unparsed(0), connections_lost(0), elapsed(0) {}
+
+  uint64_t messages;  // individual messages, so counting each of a batch's
+  uint64_t unparsed;
+  uint64_t connections_lost;
+  std::chrono::microseconds elapsed;
+};
+
+// Feeds a trace written by Routing::RecordInboundTrace through |message_handler|, the way
+// Routing::Impl hands it what rudp receives, and drops lost connections from |routing_table|.
+// Runs on the calling thread, so replays of the same trace see the same order of events.
+ReplayResult ReplayInboundTrace(const boost::filesystem::path& path,
+                                MessageHandler& message_handler, RoutingTable& routing_table,
+                                ReplaySpeed speed);
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TESTS_INBOUND_TRACE_REPLAYER_H_
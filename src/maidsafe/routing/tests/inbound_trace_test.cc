@@ -0,0 +1,96 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/inbound_trace.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(InboundTraceTest, BEH_RecordAndRead) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestInboundTrace"));
+  const boost::filesystem::path kTrace(*test_path / "inbound.trace");
+  std::vector<std::string> messages;
+  for (int i(0); i != 20; ++i)
+    messages.push_back(RandomString(1 + RandomUint32() % 1000));
+  messages.push_back(std::string());
+  const NodeId kLostId(NodeId::kRandomId);
+  {
+    InboundTraceRecorder recorder(kTrace, 1024 * 1024);
+    for (const auto& message : messages)
+      recorder.RecordMessage(message);
+    recorder.RecordConnectionLost(kLostId);
+    EXPECT_EQ(0U, recorder.dropped());
+  }
+
+  InboundTraceReader reader(kTrace);
+  InboundTraceEvent event;
+  std::chrono::microseconds previous_offset(0);
+  for (const auto& message : messages) {
+    ASSERT_TRUE(reader.Next(event));
+    EXPECT_EQ(InboundTraceEvent::kMessageReceived, event.kind);
+    EXPECT_EQ(message, event.payload);
+    EXPECT_LE(previous_offset, event.offset);
+    previous_offset = event.offset;
+  }
+  ASSERT_TRUE(reader.Next(event));
+  EXPECT_EQ(InboundTraceEvent::kConnectionLost, event.kind);
+  EXPECT_EQ(kLostId, NodeId(event.payload));
+  EXPECT_FALSE(reader.Next(event));
+}
+
+TEST(InboundTraceTest, BEH_DropBeyondBufferSize) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestInboundTrace"));
+  const boost::filesystem::path kTrace(*test_path / "inbound.trace");
+  {
+    InboundTraceRecorder recorder(kTrace, 0);
+    recorder.RecordMessage("message");
+    recorder.RecordConnectionLost(NodeId(NodeId::kRandomId));
+    EXPECT_EQ(2U, recorder.dropped());
+  }
+  InboundTraceReader reader(kTrace);
+  InboundTraceEvent event;
+  EXPECT_FALSE(reader.Next(event));
+}
+
+TEST(InboundTraceTest, BEH_RejectOtherFiles) {
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestInboundTrace"));
+  const boost::filesystem::path kOther(*test_path / "other");
+  ASSERT_TRUE(WriteFile(kOther, "not a trace"));
+  EXPECT_THROW(InboundTraceReader reader(kOther), std::runtime_error);
+  EXPECT_THROW(InboundTraceReader reader(*test_path / "missing"), std::runtime_error);
+  EXPECT_THROW(InboundTraceRecorder recorder(*test_path / "missing" / "inbound.trace", 1),
+               std::runtime_error);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
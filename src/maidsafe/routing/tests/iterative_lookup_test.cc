@@ -0,0 +1,111 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/iterative_lookup.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+std::vector<NodeId> RandomNodeIds(size_t count) {
+  std::vector<NodeId> node_ids;
+  for (size_t i(0); i != count; ++i)
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+  return node_ids;
+}
+
+}  // unnamed namespace
+
+TEST(IterativeLookupTest, BEH_AlphaQueriesInFlight) {
+  const NodeId kTarget(NodeId::kRandomId);
+  IterativeLookup lookup(kTarget, kTarget, 4, 3);
+  EXPECT_FALSE(lookup.Done());
+  EXPECT_TRUE(lookup.NextQueries(std::chrono::steady_clock::now()).empty());
+
+  auto seeds(RandomNodeIds(10));
+  lookup.AddCandidates(seeds);
+  auto queries(lookup.NextQueries(std::chrono::steady_clock::now()));
+  ASSERT_EQ(3U, queries.size());
+  EXPECT_EQ(3U, lookup.in_flight());
+  EXPECT_TRUE(lookup.NextQueries(std::chrono::steady_clock::now()).empty());
+
+  // The closest seeds are asked first.
+  SortByDistance(seeds, kTarget);
+  EXPECT_TRUE(std::equal(queries.begin(), queries.end(), seeds.begin()));
+
+  lookup.HandleResponse(queries.front(), std::vector<NodeId>());
+  EXPECT_EQ(2U, lookup.in_flight());
+  EXPECT_EQ(1U, lookup.NextQueries(std::chrono::steady_clock::now()).size());
+}
+
+TEST(IterativeLookupTest, BEH_ConvergesOnClosest) {
+  const NodeId kTarget(NodeId::kRandomId);
+  const uint16_t kK(4);
+  IterativeLookup lookup(kTarget, kTarget, kK, 2);
+  auto network(RandomNodeIds(50));
+  SortByDistance(network, kTarget);
+  std::vector<NodeId> closest(network.begin(), network.begin() + kK);
+
+  // Each peer answers with the whole network, so the lookup finds the true closest nodes once
+  // they've all been asked.
+  lookup.AddCandidates(std::vector<NodeId>(network.end() - 5, network.end()));
+  int rounds(0);
+  while (!lookup.Done() && rounds++ < 50) {
+    for (const auto& peer : lookup.NextQueries(std::chrono::steady_clock::now()))
+      lookup.HandleResponse(peer, network);
+  }
+  ASSERT_TRUE(lookup.Done());
+  EXPECT_EQ(closest, lookup.Closest());
+}
+
+TEST(IterativeLookupTest, BEH_ExpiredQueriesFail) {
+  const NodeId kTarget(NodeId::kRandomId);
+  IterativeLookup lookup(kTarget, kTarget, 2, 2);
+  auto seeds(RandomNodeIds(3));
+  lookup.AddCandidates(seeds);
+  const auto kSent(std::chrono::steady_clock::now());
+  auto queries(lookup.NextQueries(kSent));
+  ASSERT_EQ(2U, queries.size());
+  lookup.ExpireQueries(kSent + std::chrono::seconds(1));
+  EXPECT_EQ(0U, lookup.in_flight());
+
+  // The remaining seed takes the place of the failed ones.
+  auto retry(lookup.NextQueries(kSent + std::chrono::seconds(1)));
+  ASSERT_EQ(1U, retry.size());
+  lookup.HandleResponse(retry.front(), std::vector<NodeId>());
+  EXPECT_TRUE(lookup.Done());
+  EXPECT_EQ(retry, lookup.Closest());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,90 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/lifetime_guard.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(LifetimeGuardTest, BEH_RevokedHandlersDoNothing) {
+  int calls(0), sum(0);
+  std::function<void()> count;
+  std::function<void(int)> add;
+  {
+    LifetimeGuard guard;
+    count = guard.Wrap([&calls]() { ++calls; });
+    add = guard.Wrap([&sum](int value) { sum += value; });
+    count();
+    add(2);
+    EXPECT_TRUE(guard.alive());
+    guard.Revoke();
+    EXPECT_FALSE(guard.alive());
+    count();
+  }
+  // Nor once the guard itself has gone.
+  count();
+  add(3);
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(2, sum);
+}
+
+TEST(LifetimeGuardTest, BEH_RevokeWaitsForRunningHandlers) {
+  LifetimeGuard guard;
+  std::promise<void> entered;
+  std::atomic<bool> finished(false);
+  auto slow(guard.Wrap([&]() {
+    entered.set_value();
+    Sleep(std::chrono::milliseconds(200));
+    finished = true;
+  }));
+  std::thread runner(slow);
+  entered.get_future().wait();
+  guard.Revoke();
+  EXPECT_TRUE(finished);
+  runner.join();
+}
+
+TEST(LifetimeGuardTest, BEH_RevokeFromWithinHandler) {
+  std::unique_ptr<LifetimeGuard> guard(new LifetimeGuard);
+  bool ran_after(false);
+  auto after(guard->Wrap([&ran_after]() { ran_after = true; }));
+  auto destroy(guard->Wrap([&]() { guard.reset(); }));
+  destroy();
+  EXPECT_FALSE(guard);
+  after();
+  EXPECT_FALSE(ran_after);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,79 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/liveness_tracker.h"
+#include "maidsafe/routing/route_history.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(LivenessTrackerTest, BEH_ProbesIdleThenSuspects) {
+  const auto kStart(std::chrono::steady_clock::now());
+  const std::chrono::seconds kIdleTime(5), kProbeTimeout(3);
+  LivenessTracker liveness;
+  const NodeId kBusy(NodeId::kRandomId), kIdle(NodeId::kRandomId);
+  liveness.Add(kBusy, kStart);
+  liveness.Add(kIdle, kStart);
+  EXPECT_TRUE(liveness.TakeIdle(kIdleTime, kStart + std::chrono::seconds(1)).empty());
+
+  liveness.RecordActivity(kBusy, kStart + std::chrono::seconds(4));
+  auto idle(liveness.TakeIdle(kIdleTime, kStart + kIdleTime));
+  ASSERT_EQ(1U, idle.size());
+  EXPECT_EQ(kIdle, idle.front());
+  // A connection is probed once until it's heard from again.
+  EXPECT_TRUE(liveness.TakeIdle(kIdleTime, kStart + kIdleTime).empty());
+
+  EXPECT_TRUE(liveness.TakeSuspected(kProbeTimeout, kStart + std::chrono::seconds(7)).empty());
+  auto suspected(liveness.TakeSuspected(kProbeTimeout, kStart + std::chrono::seconds(8)));
+  ASSERT_EQ(1U, suspected.size());
+  EXPECT_EQ(kIdle, suspected.front());
+  EXPECT_TRUE(liveness.TakeSuspected(kProbeTimeout, kStart + std::chrono::seconds(9)).empty());
+}
+
+TEST(LivenessTrackerTest, BEH_ActivityAnswersProbe) {
+  const auto kStart(std::chrono::steady_clock::now());
+  const std::chrono::seconds kIdleTime(5), kProbeTimeout(3);
+  LivenessTracker liveness;
+  const NodeId kPeer(NodeId::kRandomId);
+  liveness.Add(kPeer, kStart);
+  ASSERT_EQ(1U, liveness.TakeIdle(kIdleTime, kStart + kIdleTime).size());
+  liveness.RecordActivityByTag(RouteHistoryTag(kPeer), kStart + std::chrono::seconds(6));
+  EXPECT_TRUE(liveness.TakeSuspected(kProbeTimeout, kStart + std::chrono::seconds(9)).empty());
+
+  // Unknown connections are ignored.
+  liveness.RecordActivity(NodeId(NodeId::kRandomId), kStart);
+  EXPECT_EQ(1U, liveness.size());
+  liveness.Remove(kPeer);
+  EXPECT_EQ(0U, liveness.size());
+  liveness.RecordActivityByTag(RouteHistoryTag(kPeer), kStart);
+  EXPECT_EQ(0U, liveness.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -18,6 +18,7 @@
 #include <set>
 #include <vector>
 
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/test.h"
 
@@ -182,6 +183,40 @@ TEST_F(MatrixChangeTest, BEH_CheckHolders) {
     DoCheckHoldersTest(matrix_change);
 }
 
+TEST_F(MatrixChangeTest, BEH_CheckHoldersBatch) {
+  new_matrix_.erase(new_matrix_.begin() + 1, new_matrix_.begin() + 4);
+  for (auto i(0); i != 3; ++i)
+    new_matrix_.push_back(NodeId(NodeId::kRandomId));
+  MatrixChange matrix_change(kNodeId_, old_matrix_, new_matrix_);
+  std::vector<NodeId> targets(old_matrix_);
+  targets.insert(targets.end(), new_matrix_.begin(), new_matrix_.end());
+  for (auto i(0); i != 2000; ++i)
+    targets.push_back(NodeId(NodeId::kRandomId));
+  std::sort(targets.begin(), targets.end());
+
+  auto expect_equal([&](const NodeId& target, const CheckHoldersResult& result) {
+    CheckHoldersResult expected(matrix_change.CheckHolders(target));
+    EXPECT_EQ(expected.proximity_status, result.proximity_status);
+    EXPECT_EQ(expected.old_holders, result.old_holders);
+    EXPECT_EQ(expected.new_holders, result.new_holders);
+  });
+  size_t count(0);
+  matrix_change.CheckHolders(targets.begin(), targets.end(),
+                             [&](const NodeId& target, const CheckHoldersResult& result) {
+                               EXPECT_EQ(targets.at(count++), target);
+                               expect_equal(target, result);
+                             });
+  EXPECT_EQ(targets.size(), count);
+
+  for (unsigned int thread_count(1); thread_count != 5; ++thread_count) {
+    auto results(matrix_change.CheckHolders(targets, thread_count));
+    ASSERT_EQ(targets.size(), results.size());
+    for (size_t index(0); index != targets.size(); ++index)
+      expect_equal(targets.at(index), results.at(index));
+  }
+  EXPECT_TRUE(matrix_change.CheckHolders(std::vector<NodeId>(), 4).empty());
+}
+
 TEST_F(MatrixChangeTest, BEH_GroupMatrixUpdating) {
   GroupMatrix group_matrix(kNodeId_, false);
   for (auto& node : old_matrix_) {
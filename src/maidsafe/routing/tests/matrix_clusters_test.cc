@@ -0,0 +1,108 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/matrix_clusters.h"
+#include "maidsafe/routing/matrix_update.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// An ID whose leading byte is |first_byte|, the rest random.
+NodeId MakeId(unsigned char first_byte) {
+  std::string id(NodeId(NodeId::kRandomId).string());
+  id[0] = static_cast<char>(first_byte);
+  return NodeId(id);
+}
+
+}  // unnamed namespace
+
+TEST(MatrixClustersTest, BEH_HasPrefix) {
+  NodeId node_id(MakeId(0xA0));  // 1010 0000
+  EXPECT_TRUE(HasPrefix(node_id, ""));
+  EXPECT_TRUE(HasPrefix(node_id, "1"));
+  EXPECT_TRUE(HasPrefix(node_id, "1010000"));
+  EXPECT_FALSE(HasPrefix(node_id, "11"));
+  EXPECT_FALSE(HasPrefix(node_id, std::string(NodeId::kSize * 8 + 1, '1')));
+  EXPECT_EQ(0, ClusterPrefixBits(10, 16));
+  EXPECT_EQ(1, ClusterPrefixBits(17, 16));
+  EXPECT_EQ(6, ClusterPrefixBits(1000, 16));
+}
+
+TEST(MatrixClustersTest, BEH_ClusterMatrix) {
+  // Four nodes in each leading quarter of the ID space, each holding the next node as a peer.
+  std::vector<NodeId> nodes;
+  for (int quarter(0); quarter != 4; ++quarter) {
+    for (int i(0); i != 4; ++i)
+      nodes.push_back(MakeId(static_cast<unsigned char>((quarter << 6) | (i << 4))));
+  }
+  MatrixModel model;
+  for (size_t i(0); i != nodes.size(); ++i) {
+    MatrixRow row;
+    row[nodes[(i + 1) % nodes.size()]] = network_viewer::ChildType::kGroup;
+    model.Apply(SnapshotMatrixRow(nodes[i], 1, row));
+  }
+
+  std::vector<MatrixCluster> clusters(ClusterMatrix(model, 2, std::set<std::string>()));
+  ASSERT_EQ(4U, clusters.size());
+  const char* kPrefixes[] = {"00", "01", "10", "11"};
+  for (size_t i(0); i != clusters.size(); ++i) {
+    EXPECT_EQ(kPrefixes[i], clusters[i].prefix);
+    EXPECT_EQ(4U, clusters[i].nodes.size());
+    // Only the last node of each quarter holds one in another cluster: the next quarter's first.
+    ASSERT_EQ(1U, clusters[i].links.size());
+    EXPECT_EQ(1U, clusters[i].links[kPrefixes[(i + 1) % 4]]);
+  }
+
+  // Expanding "01" splits only that cluster, down to its single nodes.
+  std::set<std::string> expanded;
+  expanded.insert("01");
+  expanded.insert("010");
+  expanded.insert("011");
+  clusters = ClusterMatrix(model, 2, expanded);
+  ASSERT_EQ(7U, clusters.size());
+  EXPECT_EQ("00", clusters[0].prefix);
+  EXPECT_EQ("0100", clusters[1].prefix);
+  EXPECT_EQ("0101", clusters[2].prefix);
+  EXPECT_EQ("0110", clusters[3].prefix);
+  EXPECT_EQ("0111", clusters[4].prefix);
+  EXPECT_EQ("10", clusters[5].prefix);
+  for (size_t i(1); i != 5; ++i)
+    EXPECT_EQ(1U, clusters[i].nodes.size());
+  EXPECT_EQ(1U, clusters[0].links["0100"]);
+  EXPECT_EQ(1U, clusters[4].links["10"]);
+
+  EXPECT_TRUE(ClusterMatrix(MatrixModel(), 4, expanded).empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
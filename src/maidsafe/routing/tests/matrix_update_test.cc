@@ -0,0 +1,132 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/matrix_update.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+MatrixRow MakeRow(size_t size) {
+  MatrixRow row;
+  while (row.size() != size)
+    row[NodeId(NodeId::kRandomId)] = network_viewer::ChildType::kMatrix;
+  return row;
+}
+
+}  // unnamed namespace
+
+TEST(MatrixUpdateTest, BEH_SerialiseAndParse) {
+  MatrixUpdate update(DiffMatrixRows(NodeId(NodeId::kRandomId), 7, MakeRow(5), MakeRow(3)));
+  update.changed.back().second = network_viewer::ChildType::kGroup;
+  std::string serialised(update.Serialise());
+  MatrixUpdate parsed;
+  ASSERT_TRUE(MatrixUpdate::Parse(serialised, parsed));
+  EXPECT_EQ(update.node_id, parsed.node_id);
+  EXPECT_EQ(7U, parsed.sequence);
+  EXPECT_FALSE(parsed.snapshot);
+  EXPECT_FALSE(parsed.left);
+  EXPECT_EQ(update.changed, parsed.changed);
+  EXPECT_EQ(update.removed, parsed.removed);
+
+  EXPECT_FALSE(MatrixUpdate::Parse(serialised.substr(0, serialised.size() - 1), parsed));
+  EXPECT_FALSE(MatrixUpdate::Parse(serialised + "x", parsed));
+  EXPECT_FALSE(MatrixUpdate::Parse(std::string(), parsed));
+  serialised[0] = '\x08';
+  EXPECT_FALSE(MatrixUpdate::Parse(serialised, parsed));
+}
+
+TEST(MatrixUpdateTest, BEH_DiffMatrixRows) {
+  MatrixRow previous(MakeRow(10)), current(previous);
+  auto itr(current.begin());
+  NodeId removed((itr++)->first);
+  current.erase(removed);
+  NodeId retyped(itr->first);
+  itr->second = network_viewer::ChildType::kClosest;
+  NodeId added(NodeId::kRandomId);
+  current[added] = network_viewer::ChildType::kGroup;
+
+  MatrixUpdate update(DiffMatrixRows(NodeId(NodeId::kRandomId), 1, previous, current));
+  ASSERT_EQ(1U, update.removed.size());
+  EXPECT_EQ(removed, update.removed.front());
+  ASSERT_EQ(2U, update.changed.size());
+  MatrixRow changed(update.changed.begin(), update.changed.end());
+  EXPECT_EQ(network_viewer::ChildType::kClosest, changed[retyped]);
+  EXPECT_EQ(network_viewer::ChildType::kGroup, changed[added]);
+  update = DiffMatrixRows(NodeId(NodeId::kRandomId), 2, current, current);
+  EXPECT_TRUE(update.changed.empty());
+  EXPECT_TRUE(update.removed.empty());
+}
+
+TEST(MatrixUpdateTest, BEH_ModelFollowsUpdates) {
+  const NodeId kNodeId(NodeId::kRandomId);
+  MatrixModel model;
+  std::vector<MatrixRow> rows;
+  rows.push_back(MakeRow(8));
+  for (int i(0); i != 5; ++i) {
+    MatrixRow row(rows.back());
+    row.erase(row.begin());
+    row[NodeId(NodeId::kRandomId)] = network_viewer::ChildType::kGroup;
+    rows.push_back(row);
+  }
+
+  // Diffs before the first snapshot are ignored.
+  EXPECT_EQ(MatrixModel::ApplyResult::kIgnored,
+            model.Apply(DiffMatrixRows(kNodeId, 1, MatrixRow(), rows[0])));
+  EXPECT_TRUE(model.Nodes().empty());
+  EXPECT_EQ(MatrixModel::ApplyResult::kAdded, model.Apply(SnapshotMatrixRow(kNodeId, 1, rows[0])));
+  EXPECT_EQ(rows[0], model.Row(kNodeId));
+  EXPECT_EQ(MatrixModel::ApplyResult::kApplied,
+            model.Apply(DiffMatrixRows(kNodeId, 2, rows[0], rows[1])));
+  EXPECT_EQ(rows[1], model.Row(kNodeId));
+
+  // A gap leaves the last consistent row until the next snapshot.
+  uint64_t version(model.version());
+  EXPECT_EQ(MatrixModel::ApplyResult::kIgnored,
+            model.Apply(DiffMatrixRows(kNodeId, 4, rows[2], rows[3])));
+  EXPECT_EQ(MatrixModel::ApplyResult::kIgnored,
+            model.Apply(DiffMatrixRows(kNodeId, 5, rows[3], rows[4])));
+  EXPECT_EQ(rows[1], model.Row(kNodeId));
+  EXPECT_EQ(version, model.version());
+  EXPECT_EQ(MatrixModel::ApplyResult::kApplied,
+            model.Apply(SnapshotMatrixRow(kNodeId, 6, rows[4])));
+  EXPECT_EQ(MatrixModel::ApplyResult::kApplied,
+            model.Apply(DiffMatrixRows(kNodeId, 7, rows[4], rows[5])));
+  EXPECT_EQ(rows[5], model.Row(kNodeId));
+  EXPECT_LT(version, model.version());
+
+  EXPECT_EQ(MatrixModel::ApplyResult::kRemoved, model.Apply(LeftMatrixUpdate(kNodeId, 8)));
+  EXPECT_TRUE(model.Nodes().empty());
+  EXPECT_TRUE(model.Row(kNodeId).empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,94 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/memory_budget.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(MemoryBudgetTest, BEH_Unlimited) {
+  MemoryBudget budget(0, 0);
+  EXPECT_EQ(MemoryStatistics::kNormal, budget.Update(1ULL << 40));
+  EXPECT_TRUE(budget.Enqueue(1ULL << 30, true));
+  EXPECT_TRUE(budget.AdmitClient());
+  MemoryStatistics statistics;
+  budget.FillStatistics(statistics);
+  EXPECT_EQ(1ULL << 30, statistics.bytes[MemoryStatistics::kInboundQueues]);
+  EXPECT_EQ(0U, statistics.refused_clients + statistics.dropped_messages);
+}
+
+TEST(MemoryBudgetTest, BEH_Pressure) {
+  MemoryBudget budget(1000, 2000);
+  EXPECT_EQ(MemoryStatistics::kNormal, budget.Update(999));
+  EXPECT_TRUE(budget.AdmitClient());
+  EXPECT_EQ(MemoryStatistics::kSoft, budget.Update(1000));
+  EXPECT_FALSE(budget.AdmitClient());
+  // Over the soft budget, queued messages are still kept.
+  EXPECT_TRUE(budget.Enqueue(999, true));
+  EXPECT_EQ(MemoryStatistics::kSoft, budget.pressure());
+  EXPECT_TRUE(budget.Enqueue(1, true));
+  EXPECT_EQ(MemoryStatistics::kHard, budget.pressure());
+  EXPECT_FALSE(budget.Enqueue(10, true));
+  EXPECT_TRUE(budget.Enqueue(10, false));
+  EXPECT_EQ(1010U, budget.queued_bytes());
+  budget.Dequeue(1010);
+  EXPECT_EQ(MemoryStatistics::kSoft, budget.pressure());
+  EXPECT_EQ(MemoryStatistics::kNormal, budget.Update(0));
+  EXPECT_TRUE(budget.AdmitClient());
+  budget.AddCacheEvictions(3);
+
+  MemoryStatistics statistics;
+  budget.FillStatistics(statistics);
+  EXPECT_EQ(MemoryStatistics::kNormal, statistics.pressure);
+  EXPECT_EQ(0U, statistics.bytes[MemoryStatistics::kInboundQueues]);
+  EXPECT_EQ(1U, statistics.refused_clients);
+  EXPECT_EQ(1U, statistics.dropped_messages);
+  EXPECT_EQ(3U, statistics.cache_evictions);
+}
+
+TEST(MemoryBudgetTest, BEH_HardBudgetOnly) {
+  MemoryBudget budget(0, 1000);
+  EXPECT_EQ(MemoryStatistics::kNormal, budget.Update(999));
+  EXPECT_TRUE(budget.AdmitClient());
+  EXPECT_EQ(MemoryStatistics::kHard, budget.Update(1000));
+  EXPECT_FALSE(budget.AdmitClient());
+  EXPECT_FALSE(budget.Enqueue(1, true));
+}
+
+TEST(MemoryBudgetTest, BEH_NodeInfoBytes) {
+  std::vector<NodeInfo> nodes(2);
+  nodes.reserve(4);
+  nodes[0].dimension_list.assign(8, 0);
+  EXPECT_EQ(4 * sizeof(NodeInfo) + nodes[0].dimension_list.capacity() * sizeof(int32_t),
+            NodeInfoBytes(nodes));
+  EXPECT_EQ(0U, NodeInfoBytes(std::vector<NodeInfo>()));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -17,6 +17,11 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/utils.h"
@@ -26,18 +31,24 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/tests/inbound_trace_replayer.h"
 #include "maidsafe/routing/tests/mock_service.h"
 #include "maidsafe/routing/tests/mock_response_handler.h"
 #include "maidsafe/routing/tests/mock_network_utils.h"
 #include "maidsafe/routing/tests/mock_routing_table.h"
 #include "maidsafe/routing/tests/test_utils.h"
+#include "maidsafe/routing/application_queue.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_cache.h"
 #include "maidsafe/routing/group_change_handler.h"
+#include "maidsafe/routing/inbound_trace.h"
+#include "maidsafe/routing/message_traits.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/remove_furthest_node.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/timer.h"
+#include "maidsafe/routing/utils.h"
 
 namespace maidsafe {
 
@@ -63,6 +74,7 @@ class MessageHandlerTest : public testing::Test {
         service_(),
         response_handler_(),
         network_statistics_(),
+        group_cache_(),
         close_info_() {
     message_and_caching_functor_.message_received = [this](
         const std::string & message, ReplyFunctor reply_functor) {
@@ -74,7 +86,7 @@ class MessageHandlerTest : public testing::Test {
     table_.reset(
         new MockRoutingTable(false, node_id, asymm::GenerateKeyPair(), *network_statistics_));
     ntable_.reset(new ClientRoutingTable(table_->kNodeId()));
-    utils_.reset(new MockNetworkUtils(*table_, *ntable_));
+    utils_.reset(new MockNetworkUtils(*table_, *ntable_, asio_service_));
     remove_furthest_node_.reset(new RemoveFurthestNode(*table_, *utils_));
     group_change_handler_.reset(new GroupChangeHandler(*table_, *ntable_, *utils_));
     service_.reset(new MockService(*table_, *ntable_, *utils_));
@@ -111,12 +123,30 @@ class MessageHandlerTest : public testing::Test {
   std::shared_ptr<MockService> service_;
   std::shared_ptr<MockResponseHandler> response_handler_;
   std::shared_ptr<NetworkStatistics> network_statistics_;
+  GroupCache group_cache_;
   NodeInfo close_info_;
 };
 
+namespace {
+
+// Written as an application's would be, for MakeNodeLevelHandler
+class CountingHandler {
+ public:
+  explicit CountingHandler(MessageHandlerTest* test) : test_(test) {}
+  void MessageReceived(const std::string& message, ReplyFunctor reply) {
+    test_->MessageReceived(message);
+    reply("reply");
+  }
+
+ private:
+  MessageHandlerTest* test_;
+};
+
+}  // unnamed namespace
+
 TEST_F(MessageHandlerTest, BEH_HandleInvalidMessage) {
   MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
-                                 *group_change_handler_, *network_statistics_);
+                                 *group_change_handler_, *network_statistics_, group_cache_);
   // Reset the service and response handler inside the message handler to be mocks
   message_handler.service_ = service_;
   message_handler.response_handler_ = response_handler_;
@@ -145,7 +175,7 @@ TEST_F(MessageHandlerTest, BEH_HandleInvalidMessage) {
 
 TEST_F(MessageHandlerTest, BEH_HandleRelay) {
   MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
-                                 *group_change_handler_, *network_statistics_);
+                                 *group_change_handler_, *network_statistics_, group_cache_);
   message_handler.service_ = service_;
   message_handler.response_handler_ = response_handler_;
 
@@ -231,7 +261,7 @@ TEST_F(MessageHandlerTest, BEH_HandleRelay) {
 
 TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
   MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
-                                 *group_change_handler_, *network_statistics_);
+                                 *group_change_handler_, *network_statistics_, group_cache_);
   bool result(true);
   message_handler.service_ = service_;
   message_handler.response_handler_ = response_handler_;
@@ -584,7 +614,7 @@ TEST_F(MessageHandlerTest, BEH_HandleGroupMessage) {
 
 TEST_F(MessageHandlerTest, BEH_HandleNodeLevelMessage) {
   MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
-                                 *group_change_handler_, *network_statistics_);
+                                 *group_change_handler_, *network_statistics_, group_cache_);
   message_handler.service_ = service_;
   message_handler.response_handler_ = response_handler_;
   protobuf::Message message;
@@ -634,6 +664,166 @@ TEST_F(MessageHandlerTest, BEH_HandleNodeLevelMessage) {
   }
 }
 
+TEST_F(MessageHandlerTest, BEH_OneWayMessage) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_id(0);
+  message.set_one_way(true);
+  message.set_destination_id(table_->kNodeId().string());
+  message.add_data("DATA");
+
+  // The application is handed the message, but its reply goes nowhere.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(0);
+  EXPECT_CALL(*utils_, SendToDirect(testing::_, testing::_, testing::_)).Times(0);
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  message_handler.HandleMessage(message);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+  EXPECT_EQ(messages_received_, 1);
+}
+
+TEST_F(MessageHandlerTest, BEH_MergedGroupReply) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  const TaskId kTaskId(timer_.NewTaskId());
+  auto responses(timer_.AddQuorumTask(std::chrono::seconds(1), Parameters::group_size,
+                                      Parameters::group_size, kTaskId));
+  const NodeId kSourceId(NodeId::kRandomId), kOtherId(NodeId::kRandomId);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(false);
+  message.set_client_node(false);
+  message.set_source_id(kSourceId.string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.set_id(kTaskId);
+  message.add_data("reply");
+
+  // Repeated senders, this reply's own among them, only stand for one group member each.
+  message.add_aggregated_source_ids(kSourceId.string());
+  message.add_aggregated_source_ids(kOtherId.string());
+  message.add_aggregated_source_ids(kOtherId.string());
+  for (int i(0); i != message.aggregated_source_ids_size(); ++i)
+    message.add_aggregated_signatures("signature");
+  message_handler.HandleMessage(message);
+  ASSERT_EQ(std::future_status::ready, responses.wait_for(std::chrono::seconds(3)));
+  EXPECT_EQ(2U, responses.get().size());
+}
+
+TEST_F(MessageHandlerTest, BEH_ResumeCacheMiss) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  // The application has nothing cached, and answers with an empty reply on its own thread.
+  message_and_caching_functor_.have_cache_data = [](const std::string&, ReplyFunctor reply) {
+    std::thread([reply]() { reply(""); }).detach();
+  };
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  std::mutex resume_mutex;
+  std::condition_variable resumed;
+  std::string resumed_key;
+  std::function<void()> resume;
+  message_handler.set_resume_functor([&](const std::string& key,
+                                         const std::function<void()>& handler) {
+    {
+      std::lock_guard<std::mutex> lock(resume_mutex);
+      resumed_key = key;
+      resume = handler;
+    }
+    resumed.notify_all();
+  });
+  protobuf::Message message;
+  const NodeId kSourceId(NodeId::kRandomId);
+  message.set_hops_to_live(2);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(kSourceId.string());
+  message.set_id(0);
+  message.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+  message.set_destination_id(table_->kNodeId().string());
+  message.add_data("DATA");
+  message_handler.HandleMessage(message);
+
+  // The miss is handed back keyed by its sender, and isn't handled until it is resumed.
+  {
+    std::unique_lock<std::mutex> lock(resume_mutex);
+    ASSERT_TRUE(resumed.wait_for(lock, std::chrono::seconds(2), [&]() { return !!resume; }));
+    EXPECT_EQ(kSourceId.string(), resumed_key);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(0, messages_received_);
+  }
+  resume();
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+}
+
+TEST_F(MessageHandlerTest, BEH_ApplicationQueue) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_id(5485);
+  message.set_destination_id(table_->kNodeId().string());
+  message.add_data("DATA");
+
+  // With no message_received functor, requests go to the queue rather than the typed functors.
+  std::shared_ptr<ApplicationQueue> application_queue(std::make_shared<ApplicationQueue>(4));
+  message_handler.set_application_queue(application_queue);
+  message_handler.HandleMessage(message);
+  auto received(application_queue->Take(4, std::chrono::milliseconds(0)));
+  ASSERT_EQ(1U, received.size());
+  EXPECT_EQ("DATA", received.front().message);
+
+  // The reply taken with it is sent back as a message_received functor's would be.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(1);
+  received.front().reply("reply");
+}
+
+TEST_F(MessageHandlerTest, BEH_NodeLevelHandler) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_id(5484);
+  message.set_destination_id(table_->kNodeId().string());
+  message.add_data("DATA");
+
+  // The handler's reply is sent back like a message_received functor's.
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(1);
+  message_handler.set_node_level_handler(MakeNodeLevelHandler(CountingHandler(this)));
+  message_handler.HandleMessage(message);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ != 0;
+  }));  // NOLINT
+  EXPECT_EQ(messages_received_, 1);
+}
+
 TEST_F(MessageHandlerTest, BEH_ClientRoutingTable) {
   auto maid(MakeMaid());
   asymm::Keys keys;
@@ -643,7 +833,7 @@ TEST_F(MessageHandlerTest, BEH_ClientRoutingTable) {
       new MockRoutingTable(true, NodeId(maid.name()->string()), keys, *network_statistics_));
   table_->AddNode(close_info_);
   MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
-                                 *group_change_handler_, *network_statistics_);
+                                 *group_change_handler_, *network_statistics_, group_cache_);
   message_handler.service_ = service_;
   message_handler.response_handler_ = response_handler_;
   protobuf::Message message;
@@ -750,6 +940,134 @@ TEST_F(MessageHandlerTest, BEH_ClientRoutingTable) {
   }
 }
 
+TEST_F(MessageHandlerTest, BEH_PassOnFannedOutGroupMessage) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  message_handler.service_ = service_;
+  message_handler.response_handler_ = response_handler_;
+  const NodeId kUnconnectedId(NodeId::kRandomId);
+  EXPECT_CALL(*utils_,
+              SendToDirect(testing::AllOf(testing::Property(&protobuf::Message::destination_id,
+                                                            close_info_.node_id.string()),
+                                          testing::Property(&protobuf::Message::fan_out_ids_size,
+                                                            0)),
+                           close_info_.node_id, testing::_)).Times(1);
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::Property(&protobuf::Message::destination_id,
+                                                           kUnconnectedId.string()))).Times(1);
+  EXPECT_CALL(*service_, Ping(testing::Property(&protobuf::Message::fan_out_ids_size, 0)))
+      .Times(1);
+  protobuf::Message message;
+  message.set_request(true);
+  message.set_routing_message(true);
+  message.set_hops_to_live(1);
+  message.set_direct(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.set_type(static_cast<int32_t>(MessageType::kPing));
+  message.add_fan_out_ids(close_info_.node_id.string());
+  message.add_fan_out_ids(kUnconnectedId.string());
+  message.add_fan_out_ids(table_->kNodeId().string());
+  const uint16_t kOldGroupFanOut(Parameters::group_fan_out);
+  Parameters::group_fan_out = 2;
+  message_handler.HandleMessage(message);
+  Parameters::group_fan_out = kOldGroupFanOut;
+}
+
+TEST_F(MessageHandlerTest, BEH_ReplayInboundTrace) {
+  MessageHandler message_handler(*table_, *ntable_, *utils_, timer_, *remove_furthest_node_,
+                                 *group_change_handler_, *network_statistics_, group_cache_);
+  message_handler.service_ = service_;
+  message_handler.response_handler_ = response_handler_;
+  message_handler.set_message_and_caching_functor(message_and_caching_functor_);
+  protobuf::Message message;
+  message.set_hops_to_live(1);
+  message.set_routing_message(false);
+  message.set_direct(true);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(table_->kNodeId().string());
+  message.add_data("DATA");
+
+  // Singly received requests, then a batch of two, each answered once replayed.
+  const int kSingles(8);
+  maidsafe::test::TestPath test_path(maidsafe::test::CreateTestPath("MaidSafe_TestInboundTrace"));
+  const boost::filesystem::path kTrace(*test_path / "inbound.trace");
+  {
+    InboundTraceRecorder recorder(kTrace, 1024 * 1024);
+    for (int i(0); i != kSingles; ++i) {
+      message.set_id(i);
+      recorder.RecordMessage(message.SerializeAsString());
+    }
+    std::vector<std::string> batch;
+    for (int i(kSingles); i != kSingles + 2; ++i) {
+      message.set_id(i);
+      batch.push_back(message.SerializeAsString());
+    }
+    recorder.RecordMessage(SerializeMessageBatch(batch));
+    recorder.RecordMessage("not a message");
+    recorder.RecordConnectionLost(NodeId(NodeId::kRandomId));
+  }
+
+  EXPECT_CALL(*utils_, SendToClosestNode(testing::_)).Times(kSingles + 2);
+  EXPECT_CALL(*utils_, SendToDirect(testing::_, testing::_, testing::_)).Times(0);
+  ReplayResult result(ReplayInboundTrace(kTrace, message_handler, *table_, ReplaySpeed::kMaximum));
+  EXPECT_EQ(static_cast<uint64_t>(kSingles + 3), result.messages);
+  EXPECT_EQ(1U, result.unparsed);
+  EXPECT_EQ(1U, result.connections_lost);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(1), [this]()->bool {
+    return messages_received_ == kSingles + 2;
+  }));  // NOLINT
+}
+
+TEST(TypedMessageTest, BEH_TypedMessageKind) {
+  // The kind read from a received message's fields is that of the type it was sent as.
+  EXPECT_EQ(detail::TypedMessageKind<SingleToSingleMessage>(),
+            detail::TypedMessageKind(false, false, false));
+  EXPECT_EQ(detail::TypedMessageKind<SingleToGroupMessage>(),
+            detail::TypedMessageKind(false, true, false));
+  EXPECT_EQ(detail::TypedMessageKind<GroupToSingleMessage>(),
+            detail::TypedMessageKind(true, false, false));
+  EXPECT_EQ(detail::TypedMessageKind<GroupToGroupMessage>(),
+            detail::TypedMessageKind(true, true, false));
+  EXPECT_EQ(detail::TypedMessageKind<SingleToGroupRelayMessage>(),
+            detail::TypedMessageKind(false, true, true));
+  // Relay fields only matter on a single source's message to a group.
+  EXPECT_EQ(detail::TypedMessageKind<SingleToSingleMessage>(),
+            detail::TypedMessageKind(false, false, true));
+  EXPECT_EQ(detail::TypedMessageKind<GroupToGroupMessage>(),
+            detail::TypedMessageKind(true, true, true));
+  for (int i(0); i != 8; ++i)
+    EXPECT_GT(detail::kTypedMessageKindCount, detail::TypedMessageKind(i & 1, i & 2, i & 4));
+}
+
+TEST(TypedMessageTest, BEH_ReleaseTypedMessage) {
+  const NodeId kSourceId(NodeId::kRandomId), kGroupId(NodeId::kRandomId),
+      kDestinationId(NodeId::kRandomId);
+  const std::string kContents(RandomString(1024));
+  protobuf::Message proto_message;
+  proto_message.set_source_id(kSourceId.string());
+  proto_message.set_destination_id(kDestinationId.string());
+  proto_message.set_group_source(kGroupId.string());
+  proto_message.set_cacheable(static_cast<int32_t>(Cacheable::kGet));
+  proto_message.add_data(kContents);
+
+  // Creating a typed message copies the payload; releasing one moves it out.
+  GroupToSingleMessage created(CreateGroupToSingleMessage(proto_message));
+  EXPECT_EQ(kContents, proto_message.data(0));
+  GroupToSingleMessage released(ReleaseTypedMessage<GroupToSingleMessage>(proto_message));
+  EXPECT_TRUE(proto_message.data(0).empty());
+  for (const auto& message : {created, released}) {
+    EXPECT_EQ(kContents, message.contents);
+    EXPECT_EQ(kGroupId, message.sender.group_id.data);
+    EXPECT_EQ(kSourceId, message.sender.sender_id.data);
+    EXPECT_EQ(kDestinationId, message.receiver.data);
+    EXPECT_EQ(Cacheable::kGet, message.cacheable);
+  }
+}
+
 }  // namespace test
 
 }  // namespace routing
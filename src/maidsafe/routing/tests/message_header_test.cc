@@ -0,0 +1,123 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+protobuf::Message MakeMessage() {
+  protobuf::Message message;
+  message.set_source_id(NodeId(NodeId::kRandomId).string());
+  message.set_destination_id(NodeId(NodeId::kRandomId).string());
+  message.set_routing_message(false);
+  message.add_data(std::string(1000, 'D'));
+  message.set_direct(true);
+  message.set_type(-3);
+  message.set_id(4567);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.set_hops_to_live(20);
+  message.set_visited(false);
+  message.set_unique_id(0x0123456789ABCDEFULL);
+  AddToRouteHistory(message, NodeId(NodeId::kRandomId));
+  return message;
+}
+
+}  // unnamed namespace
+
+TEST(MessageHeaderTest, BEH_Decode) {
+  protobuf::Message message(MakeMessage());
+  MessageHeader header;
+  ASSERT_TRUE(header.Decode(message.SerializeAsString()));
+  EXPECT_EQ(message.source_id(), header.source_id);
+  EXPECT_EQ(message.destination_id(), header.destination_id);
+  EXPECT_EQ(message.route_history_tags(), header.route_history);
+  EXPECT_EQ(20, header.hops_to_live);
+  EXPECT_EQ(-3, header.type);
+  EXPECT_EQ(4567, header.id);
+  EXPECT_EQ(0, header.cacheable);
+  EXPECT_EQ(0x0123456789ABCDEFULL, header.unique_id);
+  EXPECT_TRUE(header.has_source_id);
+  EXPECT_FALSE(header.has_relay_id);
+  EXPECT_TRUE(header.has_visited);
+  EXPECT_TRUE(header.has_unique_id);
+  EXPECT_FALSE(header.routing_message);
+  EXPECT_TRUE(header.direct);
+  EXPECT_FALSE(header.client_node);
+  EXPECT_TRUE(header.request);
+  EXPECT_FALSE(header.visited);
+  EXPECT_FALSE(header.has_path_trace);
+  message.set_path_trace(std::string());
+  ASSERT_TRUE(header.Decode(message.SerializeAsString()));
+  EXPECT_TRUE(header.has_path_trace);
+  message.clear_path_trace();
+  EXPECT_FALSE(header.has_deadline);
+  message.set_deadline(0x1122334455667788ULL);
+  ASSERT_TRUE(header.Decode(message.SerializeAsString()));
+  EXPECT_TRUE(header.has_deadline);
+  EXPECT_EQ(0x1122334455667788ULL, header.deadline);
+  // The full IDs an older node sends are read as tags.
+  const NodeId kLegacyHop(NodeId::kRandomId);
+  message.add_route_history(kLegacyHop.string());
+  ASSERT_TRUE(header.Decode(message.SerializeAsString()));
+  EXPECT_EQ(RouteHistoryTag(kLegacyHop) + message.route_history_tags(), header.route_history);
+  message.clear_route_history();
+
+  // Truncated input, or a missing required field, is rejected.
+  const std::string kSerialised(message.SerializeAsString());
+  EXPECT_FALSE(header.Decode(kSerialised.substr(0, kSerialised.size() - 1)));
+  message.clear_hops_to_live();
+  EXPECT_FALSE(header.Decode(message.SerializePartialAsString()));
+}
+
+TEST(MessageHeaderTest, BEH_RewriteForwardedMessage) {
+  protobuf::Message message(MakeMessage());
+  const std::string kSerialised(message.SerializeAsString());
+  std::string route_history(message.route_history_tags());
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  AddToRouteHistory(route_history, kThisNodeId);
+
+  protobuf::Message forwarded;
+  ASSERT_TRUE(
+      forwarded.ParseFromString(RewriteForwardedMessage(kSerialised, 19, route_history)));
+  protobuf::Message expected(message);
+  expected.set_hops_to_live(19);
+  AddToRouteHistory(expected, kThisNodeId);
+  EXPECT_EQ(expected.SerializeAsString(), forwarded.SerializeAsString());
+
+  EXPECT_TRUE(RewriteForwardedMessage(kSerialised.substr(0, 10), 19, route_history).empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -25,8 +25,9 @@ namespace routing {
 namespace test {
 
 MockNetworkUtils::MockNetworkUtils(RoutingTable& routing_table,
-                                   ClientRoutingTable& client_routing_table)
-    : NetworkUtils(routing_table, client_routing_table) {}
+                                   ClientRoutingTable& client_routing_table,
+                                   AsioService& asio_service)
+    : NetworkUtils(routing_table, client_routing_table, asio_service) {}
 
 MockNetworkUtils::~MockNetworkUtils() {}
 
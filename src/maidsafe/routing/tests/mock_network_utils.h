@@ -34,13 +34,16 @@ namespace test {
 
 class MockNetworkUtils : public NetworkUtils {
  public:
-  MockNetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table);
+  MockNetworkUtils(RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
+                   AsioService& asio_service);
   virtual ~MockNetworkUtils();
 
   MOCK_METHOD1(SendToClosestNode, void(const protobuf::Message& message));
   MOCK_METHOD1(MarkConnectionAsValid, int(const NodeId& peer_id));
   MOCK_METHOD3(SendToDirect, void(const protobuf::Message& message, const NodeId& peer,
                                   const NodeId& connection));
+  MOCK_METHOD3(SendEncodedToDirect, void(const EncodedMessage& message, const NodeId& peer,
+                                         const NodeId& connection));
   MOCK_METHOD3(Add, int(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
                         const std::string& validation_data));
   MOCK_METHOD4(GetAvailableEndpoint,
@@ -0,0 +1,80 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/network_coordinates.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(NetworkCoordinatesTest, BEH_Converges) {
+  // Four nodes at the corners of a 30ms by 40ms rectangle, each measuring the others in turn
+  const double kX[] = {0, 30, 0, 30};
+  const double kY[] = {0, 0, 40, 40};
+  const size_t kCount(4);
+  std::vector<NodeId> node_ids;
+  std::vector<std::unique_ptr<NetworkCoordinates>> nodes;
+  for (size_t i(0); i != kCount; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    nodes.emplace_back(new NetworkCoordinates);
+  }
+  auto round_trip([&](size_t i, size_t j) {
+    return std::hypot(kX[i] - kX[j], kY[i] - kY[j]);
+  });
+
+  EXPECT_GT(0.0, nodes[0]->PredictedRoundTrip(node_ids[1]));
+  for (int round(0); round != 200; ++round) {
+    for (size_t i(0); i != kCount; ++i) {
+      for (size_t j(0); j != kCount; ++j) {
+        if (i != j) {
+          nodes[i]->Update(node_ids[j], nodes[j]->Local(),
+                           std::chrono::milliseconds(std::lround(round_trip(i, j))));
+        }
+      }
+    }
+  }
+  for (size_t i(0); i != kCount; ++i) {
+    for (size_t j(0); j != kCount; ++j) {
+      if (i != j)
+        EXPECT_NEAR(round_trip(i, j), nodes[i]->PredictedRoundTrip(node_ids[j]),
+                    round_trip(i, j) * 0.2) << i << " to " << j;
+    }
+  }
+
+  // Invalid coordinates are ignored.
+  const NodeId kStranger(NodeId::kRandomId);
+  nodes[0]->Update(kStranger, std::vector<int32_t>(3, 0), std::chrono::milliseconds(1));
+  EXPECT_GT(0.0, nodes[0]->PredictedRoundTrip(kStranger));
+  EXPECT_TRUE(NetworkCoordinates::Valid(nodes[0]->Local()));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -17,10 +17,12 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <bitset>
+#include <chrono>
 #include <memory>
 #include <numeric>
 #include <vector>
 
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/test.h"
 
@@ -36,52 +38,38 @@ namespace test {
 
 TEST(NetworkStatisticsTest, BEH_AverageDistance) {
   NodeId node_id(NodeId::kRandomId);
-  NodeId average(node_id);
   NetworkStatistics network_statistics(node_id);
-  network_statistics.network_distance_data_.average_distance = average;
-  network_statistics.UpdateNetworkAverageDistance(average);
-  EXPECT_EQ(network_statistics.network_distance_data_.average_distance, average);
-
-  node_id = NodeId();
-  network_statistics.network_distance_data_.total_distance = crypto::BigInt::Zero();
-  network_statistics.network_distance_data_.average_distance = NodeId();
-  average = node_id;
   network_statistics.UpdateNetworkAverageDistance(node_id);
-  EXPECT_EQ(network_statistics.network_distance_data_.average_distance, average);
+  EXPECT_EQ(node_id, network_statistics.GetEstimate()->average_distance);
 
-  node_id = NodeId(NodeId::kMaxId);
-  network_statistics.network_distance_data_.total_distance =
-      crypto::BigInt((node_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()) *
-      network_statistics.network_distance_data_.contributors_count;
-  average = node_id;
-  network_statistics.UpdateNetworkAverageDistance(node_id);
-  EXPECT_EQ(network_statistics.network_distance_data_.average_distance, average);
+  // Zero distances are ignored
+  network_statistics.UpdateNetworkAverageDistance(NodeId());
+  EXPECT_EQ(node_id, network_statistics.GetEstimate()->average_distance);
 
-  network_statistics.network_distance_data_.contributors_count = 0;
-  network_statistics.network_distance_data_.total_distance = crypto::BigInt::Zero();
+  // A full window of the maximum distance doesn't overflow
+  for (uint16_t i(0); i != Parameters::network_distance_window_size; ++i)
+    network_statistics.UpdateNetworkAverageDistance(NodeId(NodeId::kMaxId));
+  EXPECT_EQ(NodeId(NodeId::kMaxId), network_statistics.GetEstimate()->average_distance);
 
-  std::vector<NodeId> distances_as_node_id;
+  // Only the most recent window of samples is averaged
   std::vector<crypto::BigInt> distances_as_bigint;
   uint32_t kCount(RandomUint32() % 1000 + 9000);
   for (uint32_t i(0); i < kCount; ++i) {
     NodeId node_id(NodeId::kRandomId);
-    distances_as_node_id.push_back(node_id);
+    network_statistics.UpdateNetworkAverageDistance(node_id);
     distances_as_bigint.push_back(
         crypto::BigInt((node_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str()));
   }
 
-  crypto::BigInt total(std::accumulate(distances_as_bigint.begin(), distances_as_bigint.end(),
-                                       crypto::BigInt::Zero()));
-
-  for (const auto& node_id : distances_as_node_id)
-    network_statistics.UpdateNetworkAverageDistance(node_id);
-
+  uint32_t kWindowSize(Parameters::network_distance_window_size);
+  crypto::BigInt total(std::accumulate(distances_as_bigint.end() - kWindowSize,
+                                       distances_as_bigint.end(), crypto::BigInt::Zero()));
   crypto::BigInt matrix_average_as_bigint(
-      (network_statistics.network_distance_data_.average_distance.ToStringEncoded(
+      (network_statistics.GetEstimate()->average_distance.ToStringEncoded(
            NodeId::EncodingType::kHex) +
        'h').c_str());
 
-  EXPECT_EQ(total / kCount, matrix_average_as_bigint);
+  EXPECT_EQ(total / kWindowSize, matrix_average_as_bigint);
 }
 
 TEST(NetworkStatisticsTest, BEH_IsIdInGroupRange) {
@@ -94,7 +82,6 @@ TEST(NetworkStatisticsTest, BEH_IsIdInGroupRange) {
   while (static_cast<uint16_t>(routing_table.size()) < Parameters::max_routing_table_size) {
     NodeInfo node(MakeNode());
     nodes_id.push_back(node.node_id);
-    routing_table.group_matrix_.unique_nodes_.push_back(node);
     EXPECT_TRUE(routing_table.AddNode(node));
   }
 
@@ -105,13 +92,46 @@ TEST(NetworkStatisticsTest, BEH_IsIdInGroupRange) {
   });
   uint16_t index(0);
   while (index < Parameters::max_routing_table_size) {
-    if ((nodes_id.at(index) ^ info_id) <= (network_statistics.distance_))
+    if ((nodes_id.at(index) ^ info_id) <= network_statistics.GetDistance())
       EXPECT_TRUE(network_statistics.EstimateInGroup(nodes_id.at(index++), info_id));
     else
       EXPECT_FALSE(network_statistics.EstimateInGroup(nodes_id.at(index++), info_id));
   }
 }
 
+TEST(NetworkStatisticsTest, BEH_PeerLatency) {
+  NetworkStatistics network_statistics((NodeId(NodeId::kRandomId)));
+  std::vector<NodeId> peers;
+  for (int i(0); i != 3; ++i)
+    peers.push_back(NodeId(NodeId::kRandomId));
+  // With nothing measured the closest candidate is kept.
+  EXPECT_EQ(0U, network_statistics.GetFastestPeer(peers));
+
+  network_statistics.RecordRoundTrip(peers[0], std::chrono::milliseconds(300));
+  network_statistics.RecordRoundTrip(peers[1], std::chrono::milliseconds(30));
+  EXPECT_NEAR(300.0, network_statistics.peer_latencies_[peers[0]].round_trip, 0.001);
+  EXPECT_EQ(1U, network_statistics.GetFastestPeer(peers));
+  // An unmeasured peer counts as average, so doesn't beat the fastest measured one.
+  std::vector<NodeId> unmeasured_first(1, peers[2]);
+  unmeasured_first.push_back(peers[0]);
+  EXPECT_EQ(0U, network_statistics.GetFastestPeer(unmeasured_first));
+  unmeasured_first.push_back(peers[1]);
+  EXPECT_EQ(2U, network_statistics.GetFastestPeer(unmeasured_first));
+
+  // Smoothing keeps one slow sample from swinging the choice.
+  network_statistics.RecordRoundTrip(peers[1], std::chrono::milliseconds(1000));
+  EXPECT_EQ(1U, network_statistics.GetFastestPeer(peers));
+
+  // Heavy loss makes a fast peer the slower choice.
+  for (int i(0); i != 100; ++i)
+    network_statistics.RecordSendResult(peers[1], false);
+  peers.pop_back();
+  EXPECT_EQ(0U, network_statistics.GetFastestPeer(peers));
+
+  network_statistics.RemovePeer(peers[1]);
+  EXPECT_EQ(0U, network_statistics.peer_latencies_.count(peers[1]));
+}
+
 }  // namespace test
 }  // namespace routing
 }  // namespace maidsafe
@@ -17,10 +17,16 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <boost/exception/all.hpp>
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <future>
 
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "boost/filesystem/exception.hpp"
@@ -33,9 +39,14 @@
 
 #include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/duplicate_filter.h"
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_header.h"
 #include "maidsafe/routing/return_codes.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/transport.h"
+#include "maidsafe/routing/utils.h"
 #include "maidsafe/routing/tests/test_utils.h"
 
 namespace maidsafe {
@@ -57,8 +68,154 @@ void SortFromThisNode(const NodeId& from, std::vector<NodeInfoAndPrivateKey> nod
   });
 }
 
+
+// Holds each send NetworkUtils hands to it until the test completes it with a result of its
+// choosing.
+class RecordingTransport : public Transport {
+ public:
+  struct Sent {
+    Sent() : peer_id(), message(), message_sent_functor() {}
+    NodeId peer_id;
+    std::string message;
+    rudp::MessageSentFunctor message_sent_functor;
+  };
+
+  RecordingTransport()
+      : kBootstrapId(NodeId::kRandomId), mutex_(), condition_(), sent_(), removed_(),
+        bootstrap_waves_() {}
+  // Bootstraps off the first contact of each wave, as peer kBootstrapId.
+  int Bootstrap(const std::vector<Endpoint>& bootstrap_endpoints,
+                const rudp::MessageReceivedFunctor&, const rudp::ConnectionLostFunctor&,
+                const NodeId&, std::shared_ptr<asymm::PrivateKey>,
+                std::shared_ptr<asymm::PublicKey>, NodeId& chosen_bootstrap_peer, rudp::NatType&,
+                Endpoint) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bootstrap_waves_.push_back(bootstrap_endpoints);
+    chosen_bootstrap_peer = kBootstrapId;
+    return kSuccess;
+  }
+  int GetAvailableEndpoint(const NodeId&, const rudp::EndpointPair&, rudp::EndpointPair&,
+                           rudp::NatType&) override {
+    return kSuccess;
+  }
+  int Add(const NodeId&, const rudp::EndpointPair&, const std::string&) override {
+    return kSuccess;
+  }
+  int MarkConnectionAsValid(const NodeId&, Endpoint&) override { return kSuccess; }
+  void Remove(const NodeId& peer_id) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removed_.push_back(peer_id);
+  }
+  void Send(const NodeId& peer_id, const std::string& message,
+            const rudp::MessageSentFunctor& message_sent_functor) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sent_.push_back(Sent());
+      sent_.back().peer_id = peer_id;
+      sent_.back().message = message;
+      sent_.back().message_sent_functor = message_sent_functor;
+    }
+    condition_.notify_all();
+  }
+
+  // Takes the oldest send not yet taken, waiting up to |timeout| for one.
+  bool TakeSent(Sent& sent, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!condition_.wait_for(lock, timeout, [this] { return !sent_.empty(); }))
+      return false;
+    sent = sent_.front();
+    sent_.pop_front();
+    return true;
+  }
+  std::vector<NodeId> removed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return removed_;
+  }
+  std::vector<std::vector<Endpoint>> bootstrap_waves() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bootstrap_waves_;
+  }
+
+  const NodeId kBootstrapId;
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Sent> sent_;
+  std::vector<NodeId> removed_;
+  std::vector<std::vector<Endpoint>> bootstrap_waves_;
+};
+
+// A NetworkUtils sending over a RecordingTransport.
+struct SendingNode {
+  SendingNode()
+      : node_id(NodeId::kRandomId),
+        network_statistics(node_id),
+        routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics),
+        client_routing_table(routing_table.kNodeId()),
+        asio_service(1),
+        network(routing_table, client_routing_table, asio_service),
+        transport(new RecordingTransport) {
+    network.set_transport(std::unique_ptr<Transport>(transport));
+  }
+
+  // Adds |count| peers to the routing table, returning them closest to |target| first.
+  std::vector<NodeInfo> AddPeers(size_t count, const NodeId& target) {
+    std::vector<NodeInfo> peers;
+    while (peers.size() != count) {
+      peers.push_back(MakeNode());
+      EXPECT_TRUE(routing_table.AddNode(peers.back()));
+    }
+    SortNodeInfosFromTarget(target, peers);
+    return peers;
+  }
+
+  NodeId node_id;
+  NetworkStatistics network_statistics;
+  RoutingTable routing_table;
+  ClientRoutingTable client_routing_table;
+  AsioService asio_service;
+  NetworkUtils network;
+  RecordingTransport* transport;  // owned by network
+};
+
+protobuf::Message MakeDirectMessage(const NodeId& destination_id, const NodeId& source_id) {
+  protobuf::Message message;
+  message.set_destination_id(destination_id.string());
+  message.set_source_id(source_id.string());
+  message.add_data("data");
+  message.set_direct(true);
+  message.set_type(10);
+  message.set_routing_message(false);
+  message.set_request(true);
+  message.set_client_node(false);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  return message;
+}
+
 }  // anonymous namespace
 
+TEST(NetworkUtilsTest, BEH_MessageBatch) {
+  protobuf::Message message;
+  message.set_routing_message(true);
+  message.set_client_node(false);
+  message.set_request(true);
+  message.set_direct(true);
+  message.set_hops_to_live(Parameters::hops_to_live);
+  std::vector<std::string> serialised_messages;
+  for (int i(0); i != 3; ++i) {
+    message.set_id(i);
+    serialised_messages.push_back(message.SerializeAsString());
+    EXPECT_FALSE(IsMessageBatch(serialised_messages.back()));
+  }
+  const std::string kBatch(SerializeMessageBatch(serialised_messages));
+  EXPECT_TRUE(IsMessageBatch(kBatch));
+  std::vector<std::string> parsed;
+  ASSERT_TRUE(ParseMessageBatch(kBatch, parsed));
+  EXPECT_EQ(serialised_messages, parsed);
+  EXPECT_FALSE(ParseMessageBatch(serialised_messages.front(), parsed));
+}
+
 TEST(NetworkUtilsTest, BEH_ProcessSendDirectInvalidEndpoint) {
   protobuf::Message message;
   message.set_routing_message(true);
@@ -74,7 +231,7 @@ TEST(NetworkUtilsTest, BEH_ProcessSendDirectInvalidEndpoint) {
   RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   network.SendToClosestNode(message);
 }
 
@@ -94,7 +251,7 @@ TEST(NetworkUtilsTest, BEH_ProcessSendUnavailableDirectEndpoint) {
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   Endpoint endpoint(GetLocalIp(), maidsafe::test::GetRandomPort());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   network.SendToDirect(message, NodeId(NodeId::kRandomId), NodeId(NodeId::kRandomId));
 }
 
@@ -210,7 +367,7 @@ TEST(NetworkUtilsTest, FUNC_ProcessSendDirectEndpoint) {
   NodeId node_id3(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
 
   std::vector<Endpoint> bootstrap_endpoint(1, endpoint2);
   EXPECT_EQ(kSuccess, network.Bootstrap(bootstrap_endpoint, message_received_functor3,
@@ -239,6 +396,423 @@ TEST(NetworkUtilsTest, FUNC_ProcessSendDirectEndpoint) {
   }
 }
 
+TEST(NetworkUtilsTest, BEH_DeliveryAcknowledged) {
+  SendingNode node;
+  const NodeId kDestinationId(NodeId::kRandomId);
+  auto peers(node.AddPeers(2, kDestinationId));
+  std::promise<bool> delivered;
+  int reports(0);
+  node.network.SendToClosestNode(MakeDirectMessage(kDestinationId, node.node_id),
+                                 [&](bool success) {
+                                   ++reports;
+                                   delivered.set_value(success);
+                                 });
+  // Delivery is reported once the first hop has acknowledged the message, with no retry.
+  RecordingTransport::Sent sent;
+  ASSERT_TRUE(node.transport->TakeSent(sent));
+  EXPECT_EQ(peers[0].connection_id, sent.peer_id);
+  sent.message_sent_functor(rudp::kSuccess);
+  auto delivered_future(delivered.get_future());
+  ASSERT_EQ(std::future_status::ready, delivered_future.wait_for(std::chrono::seconds(5)));
+  EXPECT_TRUE(delivered_future.get());
+  EXPECT_EQ(1, reports);
+  EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+}
+
+TEST(NetworkUtilsTest, BEH_SendRetryBackoff) {
+  const uint16_t kOldMaxSendRetries(Parameters::max_send_retries);
+  const std::chrono::milliseconds kOldBaseDelay(Parameters::send_retry_base_delay),
+      kOldMaxDelay(Parameters::send_retry_max_delay),
+      kOldFlushDelay(Parameters::coalesce_flush_delay);
+  Parameters::max_send_retries = 4;
+  Parameters::send_retry_base_delay = std::chrono::milliseconds(20);
+  Parameters::send_retry_max_delay = std::chrono::milliseconds(40);
+  Parameters::coalesce_flush_delay = std::chrono::milliseconds(0);
+  {
+    SendingNode node;
+    const NodeId kDestinationId(NodeId::kRandomId);
+    auto peers(node.AddPeers(2, kDestinationId));
+    std::promise<bool> delivered;
+    node.network.SendToClosestNode(MakeDirectMessage(kDestinationId, node.node_id),
+                                   [&delivered](bool success) { delivered.set_value(success); });
+    RecordingTransport::Sent sent;
+    auto fail_next_send([&](const NodeInfo& expected_peer) {
+      ASSERT_TRUE(node.transport->TakeSent(sent));
+      EXPECT_EQ(expected_peer.connection_id, sent.peer_id);
+      sent.message_sent_functor(rudp::kSendFailure);
+    });
+
+    // A failed peer is passed over for the next closest at once ...
+    fail_next_send(peers[0]);
+    auto all_failed_at(std::chrono::steady_clock::now());
+    fail_next_send(peers[1]);
+    // ... and only once every candidate has failed is the next attempt delayed, when the closest
+    // is tried again.
+    fail_next_send(peers[0]);
+    EXPECT_GE(std::chrono::steady_clock::now() - all_failed_at, Parameters::send_retry_base_delay);
+    // A peer which fails the same message three times is dropped.
+    fail_next_send(peers[0]);
+    auto removed(node.transport->removed());
+    ASSERT_EQ(1U, removed.size());
+    EXPECT_EQ(peers[0].connection_id, removed.front());
+    EXPECT_FALSE(node.routing_table.Contains(peers[0].node_id));
+    // The message is given up on once it has used its retries.
+    fail_next_send(peers[1]);
+    auto delivered_future(delivered.get_future());
+    ASSERT_EQ(std::future_status::ready, delivered_future.wait_for(std::chrono::seconds(5)));
+    EXPECT_FALSE(delivered_future.get());
+    EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(200)));
+  }
+  Parameters::max_send_retries = kOldMaxSendRetries;
+  Parameters::send_retry_base_delay = kOldBaseDelay;
+  Parameters::send_retry_max_delay = kOldMaxDelay;
+  Parameters::coalesce_flush_delay = kOldFlushDelay;
+}
+
+TEST(NetworkUtilsTest, BEH_CoalescedSends) {
+  const std::chrono::milliseconds kOldFlushDelay(Parameters::coalesce_flush_delay);
+  Parameters::coalesce_flush_delay = std::chrono::seconds(10);
+  const NodeId kPeerId(NodeId::kRandomId);
+  std::vector<int> results;
+  std::mutex results_mutex;
+  auto record([&](int result) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results.push_back(result);
+  });
+  {
+    SendingNode node;
+    protobuf::Message first(MakeDirectMessage(kPeerId, node.node_id)),
+        second(MakeDirectMessage(kPeerId, node.node_id)),
+        large(MakeDirectMessage(kPeerId, node.node_id));
+    second.set_data(0, "second");
+    large.set_data(0, RandomString(Parameters::coalesced_message_size_limit + 1));
+    node.network.SendToDirect(first, kPeerId, record);
+    node.network.SendToDirect(second, kPeerId, record);
+    RecordingTransport::Sent sent;
+    // Small messages are held back for a batch ...
+    EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+    // ... until a message which can't join it flushes the batch ahead of itself.
+    node.network.SendToDirect(large, kPeerId, record);
+    ASSERT_TRUE(node.transport->TakeSent(sent));
+    EXPECT_EQ(kPeerId, sent.peer_id);
+    std::vector<std::string> messages;
+    ASSERT_TRUE(IsMessageBatch(sent.message));
+    ASSERT_TRUE(ParseMessageBatch(sent.message, messages));
+    ASSERT_EQ(2U, messages.size());
+    EXPECT_EQ(first.SerializeAsString(), messages.front());
+    EXPECT_EQ(second.SerializeAsString(), messages.back());
+    // Each message in the batch hears how the batch's send went.
+    sent.message_sent_functor(rudp::kSuccess);
+    ASSERT_TRUE(node.transport->TakeSent(sent));
+    EXPECT_EQ(large.SerializeAsString(), sent.message);
+    sent.message_sent_functor(rudp::kSuccess);
+    {
+      std::lock_guard<std::mutex> lock(results_mutex);
+      EXPECT_EQ(std::vector<int>(3, rudp::kSuccess), results);
+      results.clear();
+    }
+    // A message still waiting in a batch when the NetworkUtils goes is failed.
+    node.network.SendToDirect(first, kPeerId, record);
+    EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+  }
+  EXPECT_EQ(std::vector<int>(1, kNetworkShuttingDown), results);
+  Parameters::coalesce_flush_delay = kOldFlushDelay;
+}
+
+TEST(NetworkUtilsTest, BEH_SendWindow) {
+  const uint32_t kOldMaxInFlight(Parameters::max_in_flight_per_peer);
+  const std::chrono::milliseconds kOldFlushDelay(Parameters::coalesce_flush_delay);
+  Parameters::max_in_flight_per_peer = 1;
+  Parameters::coalesce_flush_delay = std::chrono::milliseconds(0);
+  const NodeId kPeerId(NodeId::kRandomId);
+  std::vector<int> results;
+  std::mutex results_mutex;
+  auto record([&](int result) {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    results.push_back(result);
+  });
+  RecordingTransport::Sent in_flight;
+  {
+    SendingNode node;
+    std::vector<protobuf::Message> messages(3, MakeDirectMessage(kPeerId, node.node_id));
+    for (size_t i(0); i != messages.size(); ++i) {
+      messages[i].set_id(static_cast<int32_t>(i));
+      node.network.SendToDirect(messages[i], kPeerId, record);
+    }
+    // Only one message is handed to the transport at a time ...
+    RecordingTransport::Sent sent;
+    ASSERT_TRUE(node.transport->TakeSent(sent));
+    EXPECT_EQ(messages[0].SerializeAsString(), sent.message);
+    EXPECT_FALSE(node.transport->TakeSent(in_flight, std::chrono::milliseconds(100)));
+    // ... and the next queued one follows once it has been reported on.
+    sent.message_sent_functor(rudp::kSuccess);
+    ASSERT_TRUE(node.transport->TakeSent(in_flight));
+    EXPECT_EQ(messages[1].SerializeAsString(), in_flight.message);
+    {
+      std::lock_guard<std::mutex> lock(results_mutex);
+      EXPECT_EQ(std::vector<int>(1, rudp::kSuccess), results);
+      results.clear();
+    }
+  }
+  // The message still queued is failed when the NetworkUtils goes, and a report on the one in
+  // flight arriving afterwards reaches its sender without touching the window.
+  {
+    std::lock_guard<std::mutex> lock(results_mutex);
+    EXPECT_EQ(std::vector<int>(1, kNetworkShuttingDown), results);
+    results.clear();
+  }
+  in_flight.message_sent_functor(rudp::kSendFailure);
+  EXPECT_EQ(std::vector<int>(1, rudp::kSendFailure), results);
+  Parameters::max_in_flight_per_peer = kOldMaxInFlight;
+  Parameters::coalesce_flush_delay = kOldFlushDelay;
+}
+
+TEST(NetworkUtilsTest, BEH_LivenessProbes) {
+  const std::chrono::milliseconds kOldIdleTime(Parameters::liveness_idle_time),
+      kOldProbeTimeout(Parameters::liveness_probe_timeout),
+      kOldCheckInterval(Parameters::liveness_check_interval),
+      kOldFlushDelay(Parameters::coalesce_flush_delay);
+  const uint32_t kOldMaxInFlight(Parameters::max_in_flight_per_peer);
+  const bool kOldLookaheadRouting(Parameters::lookahead_routing);
+  Parameters::liveness_idle_time = std::chrono::milliseconds(100);
+  Parameters::liveness_probe_timeout = std::chrono::milliseconds(100);
+  Parameters::liveness_check_interval = std::chrono::milliseconds(20);
+  Parameters::coalesce_flush_delay = std::chrono::milliseconds(0);
+  Parameters::max_in_flight_per_peer = 1;
+  // Table summary pings would otherwise be sent alongside the probes.
+  Parameters::lookahead_routing = false;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<NodeId> suspected;
+  {
+    SendingNode node;
+    std::vector<NodeInfo> peers(node.AddPeers(2, node.node_id));
+    const NodeInfo kIdle(peers[0]), kBusy(peers[1]);
+    for (const auto& peer : peers)
+      EXPECT_EQ(kSuccess, node.network.MarkConnectionAsValid(peer.connection_id));
+    // The busy peer has a send which rudp hasn't reported on.
+    node.network.SendToDirect(MakeDirectMessage(kBusy.node_id, node.node_id), kBusy.node_id,
+                              kBusy.connection_id);
+    RecordingTransport::Sent busy_send;
+    ASSERT_TRUE(node.transport->TakeSent(busy_send));
+    node.network.set_suspected_dead_functor([&](const NodeId& connection_id) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        suspected.push_back(connection_id);
+      }
+      condition.notify_one();
+    });
+
+    // Only the idle peer is probed, and only it is suspected once the probe goes unanswered.
+    RecordingTransport::Sent probe;
+    ASSERT_TRUE(node.transport->TakeSent(probe));
+    EXPECT_EQ(kIdle.connection_id, probe.peer_id);
+    protobuf::Message ping;
+    ASSERT_TRUE(ping.ParseFromString(probe.message));
+    EXPECT_EQ(static_cast<int32_t>(MessageType::kPing), ping.type());
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(2),
+                                     [&] { return !suspected.empty(); }));
+      EXPECT_EQ(std::vector<NodeId>(1, kIdle.connection_id), suspected);
+    }
+    Sleep(std::chrono::milliseconds(300));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      EXPECT_EQ(1U, suspected.size());
+    }
+
+    // The unanswered probe took no room in the idle peer's window.
+    node.network.SendToDirect(MakeDirectMessage(kIdle.node_id, node.node_id), kIdle.node_id,
+                              kIdle.connection_id);
+    RecordingTransport::Sent sent;
+    ASSERT_TRUE(node.transport->TakeSent(sent, std::chrono::milliseconds(500)));
+    EXPECT_EQ(kIdle.connection_id, sent.peer_id);
+    EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+  }
+  Parameters::liveness_idle_time = kOldIdleTime;
+  Parameters::liveness_probe_timeout = kOldProbeTimeout;
+  Parameters::liveness_check_interval = kOldCheckInterval;
+  Parameters::coalesce_flush_delay = kOldFlushDelay;
+  Parameters::max_in_flight_per_peer = kOldMaxInFlight;
+  Parameters::lookahead_routing = kOldLookaheadRouting;
+}
+
+TEST(NetworkUtilsTest, BEH_ReceiptKeepsShortcut) {
+  const uint32_t kOldMessageThreshold(Parameters::shortcut_message_threshold);
+  Parameters::shortcut_message_threshold = 1;
+  {
+    SendingNode node;
+    node.network.set_shortcut_functor([](const NodeId&) {});
+    const NodeInfo kPeer(MakeNode()), kOther(MakeNode());
+    const auto kNow(RoutingClock::now());
+    const auto kAdded(kNow - Parameters::shortcut_idle_time + std::chrono::seconds(5));
+    ASSERT_TRUE(node.network.shortcuts().Add(kPeer, kAdded));
+    ASSERT_TRUE(node.network.shortcuts().Add(kOther, kAdded));
+
+    // Only the shortcut a message has just arrived over from its source is still in use.
+    protobuf::Message message(MakeDirectMessage(node.node_id, kPeer.node_id));
+    MessageHeader header;
+    ASSERT_TRUE(header.Decode(message.SerializeAsString()));
+    node.network.RecordReceived(header);
+    auto idle(node.network.shortcuts().TakeIdle(Parameters::shortcut_idle_time,
+                                                kNow + std::chrono::seconds(10)));
+    ASSERT_EQ(1U, idle.size());
+    EXPECT_EQ(kOther.node_id, idle.front().node_id);
+  }
+  Parameters::shortcut_message_threshold = kOldMessageThreshold;
+}
+
+TEST(NetworkUtilsTest, BEH_Redirect) {
+  SendingNode node;
+  const Endpoint kBootstrap(GetLocalIp(), 5483), kFirst(GetLocalIp(), 5484),
+      kSecond(GetLocalIp(), 5485);
+  rudp::MessageReceivedFunctor message_received_functor([](const std::string&) {});
+  rudp::ConnectionLostFunctor connection_lost_functor([](const NodeId&) {});
+  ASSERT_EQ(kSuccess, node.network.Bootstrap(BootstrapContacts(1, kBootstrap),
+                                             message_received_functor, connection_lost_functor));
+  ASSERT_EQ(node.transport->kBootstrapId, node.network.bootstrap_connection_id());
+
+  // While an overloaded bootstrap node redirects this node, a concurrent redirect is safe.
+  std::thread redirecting([&] {
+    node.network.Redirect(BootstrapContacts(1, kSecond), Parameters::relay_overload_load);
+  });
+  node.network.Redirect(BootstrapContacts(1, kFirst), Parameters::relay_overload_load);
+  redirecting.join();
+  auto removed(node.transport->removed());
+  ASSERT_FALSE(removed.empty());
+  EXPECT_EQ(node.transport->kBootstrapId, removed.front());
+
+  // The rebootstrap tries the contacts redirected to before the overloaded bootstrap node.
+  node.network.clear_bootstrap_connection_info();
+  ASSERT_EQ(kSuccess, node.network.Bootstrap(BootstrapContacts(), message_received_functor,
+                                             connection_lost_functor));
+  auto waves(node.transport->bootstrap_waves());
+  ASSERT_EQ(2U, waves.size());
+  ASSERT_EQ(1U, waves.back().size());
+  EXPECT_TRUE(waves.back().front() == kFirst || waves.back().front() == kSecond);
+}
+
+TEST(NetworkUtilsTest, BEH_RouteCache) {
+  const uint16_t kOldMaxSendRetries(Parameters::max_send_retries),
+      kOldPrefixBits(Parameters::route_cache_prefix_bits);
+  const std::chrono::milliseconds kOldFlushDelay(Parameters::coalesce_flush_delay);
+  // Every destination shares the one cached route.
+  Parameters::route_cache_prefix_bits = 0;
+  Parameters::max_send_retries = 0;
+  Parameters::coalesce_flush_delay = std::chrono::milliseconds(0);
+  auto expect_send([](SendingNode& node, const NodeId& destination_id, const NodeId& expected_peer,
+                      int message_sent) {
+    std::promise<bool> delivered;
+    node.network.SendToClosestNode(MakeDirectMessage(destination_id, node.node_id),
+                                   [&delivered](bool success) { delivered.set_value(success); });
+    RecordingTransport::Sent sent;
+    ASSERT_TRUE(node.transport->TakeSent(sent));
+    EXPECT_EQ(expected_peer, sent.peer_id);
+    sent.message_sent_functor(message_sent);
+    auto delivered_future(delivered.get_future());
+    ASSERT_EQ(std::future_status::ready, delivered_future.wait_for(std::chrono::seconds(5)));
+    EXPECT_EQ(rudp::kSuccess == message_sent, delivered_future.get());
+  });
+  auto find_destination([](const std::function<bool(const NodeId&)>& wanted) {
+    for (int attempt(0); attempt != 10000; ++attempt) {
+      NodeId destination_id(NodeId::kRandomId);
+      if (wanted(destination_id))
+        return destination_id;
+    }
+    return NodeId();
+  });
+  // Picks a first destination which peers[0] is closest to, and a second which peers[1] is
+  // closest to but peers[0] is still closer to than |node|, so that a route cached via peers[0]
+  // is used for it.  Where no such second destination exists the peers swap roles.
+  auto find_destinations([&](const SendingNode& node, std::vector<NodeInfo>& peers,
+                             NodeId& first_id, NodeId& second_id) {
+    for (int swapped(0); swapped != 2 && second_id.IsZero(); ++swapped) {
+      if (swapped)
+        std::swap(peers[0], peers[1]);
+      second_id = find_destination([&](const NodeId& destination_id) {
+        return NodeId::CloserToTarget(peers[1].node_id, peers[0].node_id, destination_id) &&
+               NodeId::CloserToTarget(peers[0].node_id, node.node_id, destination_id);
+      });
+    }
+    first_id = find_destination([&](const NodeId& destination_id) {
+      return NodeId::CloserToTarget(peers[0].node_id, peers[1].node_id, destination_id);
+    });
+    ASSERT_FALSE(first_id.IsZero());
+    ASSERT_FALSE(second_id.IsZero());
+  });
+
+  {
+    SendingNode node;
+    auto peers(node.AddPeers(2, NodeId(NodeId::kRandomId)));
+    NodeId first_id, second_id;
+    find_destinations(node, peers, first_id, second_id);
+    expect_send(node, first_id, peers[0].connection_id, rudp::kSuccess);
+    expect_send(node, second_id, peers[0].connection_id, rudp::kSuccess);
+    // A change to the routing table drops the cached route.
+    std::vector<NodeInfo> all_peers(node.AddPeers(1, second_id));
+    all_peers.insert(all_peers.end(), peers.begin(), peers.end());
+    SortNodeInfosFromTarget(second_id, all_peers);
+    ASSERT_NE(peers[0].node_id, all_peers.front().node_id);
+    expect_send(node, second_id, all_peers.front().connection_id, rudp::kSuccess);
+  }
+  {
+    SendingNode node;
+    auto peers(node.AddPeers(2, NodeId(NodeId::kRandomId)));
+    NodeId first_id, second_id;
+    find_destinations(node, peers, first_id, second_id);
+    expect_send(node, first_id, peers[0].connection_id, rudp::kSuccess);
+    // A failed send on the cached route drops it.
+    expect_send(node, second_id, peers[0].connection_id, rudp::kSendFailure);
+    expect_send(node, second_id, peers[1].connection_id, rudp::kSuccess);
+  }
+  Parameters::max_send_retries = kOldMaxSendRetries;
+  Parameters::route_cache_prefix_bits = kOldPrefixBits;
+  Parameters::coalesce_flush_delay = kOldFlushDelay;
+}
+
+TEST(NetworkUtilsTest, BEH_RaceToClosestNodes) {
+  const uint16_t kWidth(3);
+  SendingNode node;
+  auto peers(node.AddPeers(kWidth, NodeId(NodeId::kRandomId)));
+  // A destination which every peer is closer to than this node, so that each gets a copy.
+  NodeId destination_id;
+  for (int attempt(0); attempt != 10000 && destination_id.IsZero(); ++attempt) {
+    NodeId candidate(NodeId::kRandomId);
+    if (std::all_of(peers.begin(), peers.end(), [&](const NodeInfo& peer) {
+          return NodeId::CloserToTarget(peer.node_id, node.node_id, candidate);
+        }))
+      destination_id = candidate;
+  }
+  ASSERT_FALSE(destination_id.IsZero());
+  protobuf::Message message(MakeDirectMessage(destination_id, node.node_id));
+  message.set_unique_id(NewMessageId(node.node_id));
+  RecordingTransport::Sent sent;
+
+  // By default race mode sends only the one copy.
+  node.network.RaceToClosestNodes(message, Parameters::race_send_width);
+  ASSERT_TRUE(node.transport->TakeSent(sent));
+  EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+
+  // Every copy of a raced message goes to a different peer, and only the first to reach a node
+  // gets past its duplicate filter.
+  node.network.RaceToClosestNodes(message, kWidth);
+  DuplicateFilter duplicate_filter(Parameters::duplicate_filter_capacity,
+                                   Parameters::duplicate_filter_window);
+  std::vector<NodeId> sent_to;
+  for (uint16_t i(0); i != kWidth; ++i) {
+    ASSERT_TRUE(node.transport->TakeSent(sent));
+    sent_to.push_back(sent.peer_id);
+    MessageHeader header;
+    ASSERT_TRUE(header.Decode(sent.message));
+    EXPECT_EQ(i == 0, duplicate_filter.Insert(DuplicateKey(header.unique_id, header.destination_id,
+                                                           header.request, header.visited)));
+  }
+  EXPECT_FALSE(node.transport->TakeSent(sent, std::chrono::milliseconds(100)));
+  std::sort(sent_to.begin(), sent_to.end());
+  EXPECT_EQ(sent_to.end(), std::unique(sent_to.begin(), sent_to.end()));
+}
+
 // RT with only 1 active node and 7 inactive node
 TEST(NetworkUtilsTest, FUNC_ProcessSendRecursiveSendOn) {
   const int kMessageCount(1);
@@ -270,7 +844,7 @@ TEST(NetworkUtilsTest, FUNC_ProcessSendRecursiveSendOn) {
   NodeId node_id3(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
 
   rudp::MessageReceivedFunctor message_received_functor1 = [](const std::string & message) {
     LOG(kInfo) << " -- Received: " << message;
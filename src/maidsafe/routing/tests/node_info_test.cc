@@ -0,0 +1,55 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/node_info.h"
+
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(NodeInfoTest, BEH_CopiesSharePublicKey) {
+  asymm::Keys keys(asymm::GenerateKeyPair());
+  NodeInfo node_info;
+  node_info.public_key = keys.public_key;
+  EXPECT_TRUE(asymm::MatchingKeys(keys.public_key, node_info.public_key));
+  NodeInfo copy(node_info);
+  EXPECT_TRUE(copy.public_key.SharesKeyWith(node_info.public_key));
+  EXPECT_EQ(&node_info.public_key.get(), &copy.public_key.get());
+}
+
+TEST(NodeInfoTest, BEH_PublicKeysInterned) {
+  asymm::Keys keys(asymm::GenerateKeyPair());
+  SharedPublicKey first(keys.public_key), second(keys.public_key);
+  EXPECT_TRUE(first.SharesKeyWith(second));
+  // Invalid keys aren't interned.
+  asymm::PublicKey invalid_key;
+  SharedPublicKey third(invalid_key), fourth(invalid_key);
+  EXPECT_FALSE(third.SharesKeyWith(fourth));
+  EXPECT_FALSE(asymm::ValidateKey(SharedPublicKey().get()));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
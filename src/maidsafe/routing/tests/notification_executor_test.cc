@@ -0,0 +1,100 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/notification_executor.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(NotificationExecutorTest, BEH_LatestNetworkStatusWins) {
+  NotificationExecutor notifications;
+  std::mutex mutex;
+  std::vector<int> delivered;
+  std::thread::id delivering_thread;
+  std::promise<void> first_delivered, release, all_delivered;
+  auto released(release.get_future().share());
+  NetworkStatusFunctor functor([&](int network_status) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      delivered.push_back(network_status);
+      delivering_thread = std::this_thread::get_id();
+    }
+    if (network_status == 0) {
+      first_delivered.set_value();
+      released.wait();
+    } else if (network_status == 5) {
+      all_delivered.set_value();
+    }
+  });
+
+  // Statuses posted while the handler is busy are coalesced into the last of them.
+  notifications.PostNetworkStatus(0, functor);
+  first_delivered.get_future().wait();
+  for (int network_status(1); network_status != 6; ++network_status)
+    notifications.PostNetworkStatus(network_status, functor);
+  release.set_value();
+  ASSERT_EQ(std::future_status::ready,
+            all_delivered.get_future().wait_for(std::chrono::seconds(5)));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(2U, delivered.size());
+  EXPECT_EQ(0, delivered[0]);
+  EXPECT_EQ(5, delivered[1]);
+  EXPECT_NE(std::this_thread::get_id(), delivering_thread);
+}
+
+TEST(NotificationExecutorTest, BEH_StopDiscardsPending) {
+  NotificationExecutor notifications;
+  std::promise<void> first_delivered, release;
+  auto released(release.get_future().share());
+  int delivered_count(0);
+  NetworkStatusFunctor functor([&](int) {
+    if (++delivered_count == 1) {
+      first_delivered.set_value();
+      released.wait();
+    }
+  });
+  notifications.PostNetworkStatus(0, functor);
+  first_delivered.get_future().wait();
+  notifications.PostNetworkStatus(1, functor);
+  std::thread releaser([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    release.set_value();
+  });
+  notifications.Stop();
+  releaser.join();
+  EXPECT_EQ(1, delivered_count);
+  notifications.PostNetworkStatus(2, functor);
+  EXPECT_EQ(1, delivered_count);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,115 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/object_pool.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+struct Pooled {
+  Pooled() : value(0), clears(0) {}
+  void Clear() {
+    value = 0;
+    ++clears;
+  }
+  int ByteSize() const { return value; }
+  int value;
+  int clears;
+};
+
+// Pooled separately from Pooled
+struct Sized : Pooled {};
+
+}  // unnamed namespace
+
+TEST(ObjectPoolTest, BEH_ReusesReleasedObjects) {
+  typedef ObjectPool<Pooled> Pool;
+  Pooled* address(nullptr);
+  {
+    Pool::Pointer object(Pool::Acquire());
+    object->value = 7;
+    address = object.get();
+  }
+  Pool::Pointer object(Pool::Acquire());
+  EXPECT_EQ(address, object.get());
+  EXPECT_EQ(0, object->value);
+  EXPECT_EQ(1, object->clears);
+  std::shared_ptr<Pooled> shared(Pool::AcquireShared());
+  EXPECT_NE(address, shared.get());
+}
+
+TEST(ObjectPoolTest, BEH_CrossThreadReturn) {
+  typedef ObjectPool<Pooled> Pool;
+  std::vector<Pool::Pointer> objects;
+  for (size_t i(0); i != 2 * Pool::kThreadCacheSize; ++i)
+    objects.push_back(Pool::Acquire());
+  std::set<Pooled*> addresses;
+  for (const auto& object : objects)
+    addresses.insert(object.get());
+  // Returned on another thread, whose cache spills its surplus and, once that thread ends, the
+  // rest to the depot, from which this thread takes them.
+  std::thread releaser([&objects] { objects.clear(); });
+  releaser.join();
+  EXPECT_EQ(std::min(addresses.size(), Pool::kDepotSize), Pool::DepotSize());
+  for (size_t i(0); i != Pool::kBatchSize; ++i) {
+    objects.push_back(Pool::Acquire());
+    EXPECT_EQ(1U, addresses.count(objects.back().get()));
+  }
+}
+
+TEST(ObjectPoolTest, BEH_FreesBigObjects) {
+  typedef ObjectPool<Sized> Pool;
+  {
+    Pool::Pointer small(Pool::Acquire()), big(Pool::Acquire());
+    small->value = 1;
+    big->value = static_cast<int>(Pool::kMaxPooledBytes) + 1;
+  }
+  // Only the small one was kept, so the second taken is new.
+  Pool::Pointer first(Pool::Acquire()), second(Pool::Acquire());
+  EXPECT_EQ(1, first->clears);
+  EXPECT_EQ(0, second->clears);
+}
+
+TEST(ObjectPoolTest, BEH_DepotIsBounded) {
+  typedef ObjectPool<Pooled> Pool;
+  std::thread releaser([] {
+    std::vector<Pool::Pointer> objects;
+    for (size_t i(0); i != 2 * Pool::kDepotSize; ++i)
+      objects.push_back(Pool::Acquire());
+  });
+  releaser.join();
+  EXPECT_EQ(Pool::kDepotSize, Pool::DepotSize());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
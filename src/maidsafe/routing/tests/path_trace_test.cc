@@ -0,0 +1,113 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/path_trace.h"
+
+#include <chrono>
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(PathTraceTest, BEH_RecordHops) {
+  const NodeId kSender(NodeId::kRandomId), kRelay(NodeId::kRandomId),
+      kDestination(NodeId::kRandomId), kRetried(NodeId::kRandomId);
+  protobuf::Message message;
+  message.set_id(77);
+  message.set_type(101);
+  message.set_request(true);
+  PathTrace trace;
+  EXPECT_FALSE(GetPathTrace(message, trace));
+
+  // The sender has no record until choosing a next hop, which a retry replaces.
+  message.set_path_trace(std::string());
+  SetPathTraceNextHop(message, kSender, kRetried);
+  SetPathTraceNextHop(message, kSender, kRelay);
+  EXPECT_EQ(kPathTraceRecordSize, message.path_trace().size());
+
+  const auto kReceived(std::chrono::system_clock::now());
+  AddPathTraceHop(message, kRelay, kReceived, std::chrono::milliseconds(3));
+  SetPathTraceNextHop(message, kRelay, kDestination);
+  AddPathTraceHop(message, kDestination, kReceived, std::chrono::microseconds(-5));
+
+  ASSERT_TRUE(GetPathTrace(message, trace));
+  EXPECT_EQ(77, trace.message_id);
+  EXPECT_EQ(101, trace.message_type);
+  EXPECT_TRUE(trace.request);
+  ASSERT_EQ(3U, trace.hops.size());
+  EXPECT_EQ(RouteHistoryTag(kSender), trace.hops[0].node_tag);
+  EXPECT_EQ(RouteHistoryTag(kRelay), trace.hops[0].next_hop_tag);
+  EXPECT_EQ(0, trace.hops[0].queue_delay.count());
+  EXPECT_EQ(RouteHistoryTag(kRelay), trace.hops[1].node_tag);
+  EXPECT_EQ(RouteHistoryTag(kDestination), trace.hops[1].next_hop_tag);
+  EXPECT_EQ(3000, trace.hops[1].queue_delay.count());
+  EXPECT_EQ(std::chrono::duration_cast<std::chrono::microseconds>(kReceived.time_since_epoch()),
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                trace.hops[1].received.time_since_epoch()));
+  EXPECT_EQ(RouteHistoryTag(kDestination), trace.hops[2].node_tag);
+  EXPECT_TRUE(trace.hops[2].next_hop_tag.empty());
+  EXPECT_EQ(0, trace.hops[2].queue_delay.count());
+
+  message.mutable_path_trace()->push_back('x');
+  EXPECT_FALSE(GetPathTrace(message, trace));
+}
+
+TEST(PathTraceTest, BEH_BoundedLength) {
+  protobuf::Message message;
+  message.set_path_trace(std::string());
+  for (size_t i(0); i != kMaxPathTraceHops + 5; ++i) {
+    const NodeId kHop(NodeId::kRandomId);
+    AddPathTraceHop(message, kHop, std::chrono::system_clock::now(),
+                    std::chrono::steady_clock::duration(0));
+    SetPathTraceNextHop(message, kHop, NodeId(NodeId::kRandomId));
+  }
+  EXPECT_EQ(kMaxPathTraceHops * kPathTraceRecordSize, message.path_trace().size());
+}
+
+TEST(PathTraceTest, BEH_Sampling) {
+  const uint32_t kDefaultSampling(Parameters::path_trace_sampling);
+  Parameters::path_trace_sampling = 0;
+  for (int i(0); i != 100; ++i)
+    EXPECT_FALSE(SamplePathTrace());
+  Parameters::path_trace_sampling = 1;
+  for (int i(0); i != 100; ++i)
+    EXPECT_TRUE(SamplePathTrace());
+  Parameters::path_trace_sampling = 4;
+  int sampled(0);
+  for (int i(0); i != 4000; ++i)
+    sampled += SamplePathTrace() ? 1 : 0;
+  EXPECT_GT(sampled, 700);
+  EXPECT_LT(sampled, 1300);
+  Parameters::path_trace_sampling = kDefaultSampling;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,117 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/pending_requests.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(PendingRequestsTest, BEH_MatchesRepliesByDigest) {
+  PendingRequests pending_requests(std::chrono::seconds(10));
+  protobuf::PingRequest ping_request;
+  ping_request.set_ping(true);
+  protobuf::Message request;
+  request.set_id(7);
+  request.add_data(ping_request.SerializeAsString());
+  pending_requests.Add(request);
+  ASSERT_EQ(Parameters::digest_rpc_responses, request.digest_reply());
+  if (!request.digest_reply())
+    return;
+  EXPECT_EQ(1U, pending_requests.size());
+
+  protobuf::PingResponse ping_response;
+  ping_response.set_pong(true);
+  SetSignedOriginalRequest(request, ping_response);
+  EXPECT_FALSE(ping_response.has_original_request());
+  EXPECT_FALSE(ping_response.has_original_signature());
+  EXPECT_EQ(RequestDigest(request.data(0)), ping_response.request_digest());
+
+  protobuf::Message reply;
+  reply.set_id(7);
+  std::string serialised_request;
+  EXPECT_TRUE(pending_requests.Find(reply, ping_response, serialised_request));
+  EXPECT_EQ(request.data(0), serialised_request);
+  // Every reply to the request is matched until the request expires.
+  EXPECT_TRUE(pending_requests.Find(reply, ping_response, serialised_request));
+  reply.set_id(8);
+  EXPECT_FALSE(pending_requests.Find(reply, ping_response, serialised_request));
+}
+
+TEST(PendingRequestsTest, BEH_RequestsEchoedInFullWhenNotAskedForDigest) {
+  PendingRequests pending_requests(std::chrono::seconds(0));
+  protobuf::Message request;
+  request.set_id(3);
+  request.add_data("request");
+  request.set_signature("signature");
+  protobuf::PingResponse ping_response;
+  SetSignedOriginalRequest(request, ping_response);
+  EXPECT_EQ("request", ping_response.original_request());
+  EXPECT_EQ("signature", ping_response.original_signature());
+  EXPECT_FALSE(ping_response.has_request_digest());
+  std::string serialised_request;
+  EXPECT_TRUE(pending_requests.Find(request, ping_response, serialised_request));
+  EXPECT_EQ("request", serialised_request);
+
+  pending_requests.Add(request);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_FALSE(pending_requests.Find(3, RequestDigest(request.data(0)), serialised_request));
+  EXPECT_EQ(0U, pending_requests.size());
+}
+
+TEST(PendingRequestsTest, BEH_RequestsMovedIntoResponsesAndParsedInPlace) {
+  PendingRequests pending_requests(std::chrono::seconds(10));
+  protobuf::PingRequest ping_request;
+  ping_request.set_ping(true);
+  ping_request.set_timestamp(42);
+  protobuf::Message request;
+  request.set_id(5);
+  request.add_data(ping_request.SerializeAsString());
+  request.set_signature("signature");
+  const std::string kSerialisedRequest(request.data(0));
+  protobuf::PingResponse ping_response;
+  TakeSignedOriginalRequest(request, ping_response);
+  EXPECT_EQ(kSerialisedRequest, ping_response.original_request());
+  EXPECT_EQ("signature", ping_response.original_signature());
+  EXPECT_TRUE(request.data(0).empty());
+  EXPECT_FALSE(request.has_signature());
+
+  protobuf::PingRequest parsed_request;
+  EXPECT_TRUE(pending_requests.Parse(request, ping_response, parsed_request));
+  EXPECT_EQ(42U, parsed_request.timestamp());
+  ping_response.set_original_request("not a request");
+  EXPECT_FALSE(pending_requests.Parse(request, ping_response, parsed_request));
+  ping_response.clear_original_request();
+  EXPECT_FALSE(pending_requests.Parse(request, ping_response, parsed_request));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
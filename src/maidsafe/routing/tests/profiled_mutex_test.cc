@@ -0,0 +1,101 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/profiled_mutex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+LockStatistics StatisticsFor(const std::string& name) {
+  auto statistics(LockProfiler::Snapshot());
+  auto itr(std::find_if(statistics.begin(), statistics.end(),
+                        [&](const LockStatistics& lock) { return lock.name == name; }));
+  return itr == statistics.end() ? LockStatistics() : *itr;
+}
+
+}  // unnamed namespace
+
+TEST(ProfiledMutexTest, BEH_CountsAcquisitions) {
+  ProfiledMutex first("ProfiledMutexTest::first"), second("ProfiledMutexTest::first");
+  { std::lock_guard<ProfiledMutex> lock(first); }
+  { std::lock_guard<ProfiledMutex> lock(second); }
+  ASSERT_TRUE(first.try_lock());
+  EXPECT_FALSE(first.try_lock());
+  first.unlock();
+  // Locks of the same name share their counts.
+  const LockStatistics kStatistics(StatisticsFor("ProfiledMutexTest::first"));
+  EXPECT_EQ(3U, kStatistics.acquisitions);
+  EXPECT_EQ(0U, kStatistics.contended_acquisitions);
+  EXPECT_EQ(0, kStatistics.wait_time.count());
+}
+
+TEST(ProfiledMutexTest, BEH_CountsContention) {
+  ProfiledMutex mutex("ProfiledMutexTest::contended");
+  std::unique_lock<ProfiledMutex> lock(mutex);
+  std::thread waiter([&] {
+    std::lock_guard<ProfiledMutex> waiting_lock(mutex);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  lock.unlock();
+  waiter.join();
+  const LockStatistics kStatistics(StatisticsFor("ProfiledMutexTest::contended"));
+  EXPECT_EQ(2U, kStatistics.acquisitions);
+  EXPECT_EQ(1U, kStatistics.contended_acquisitions);
+  EXPECT_GE(kStatistics.wait_time, std::chrono::milliseconds(40));
+  EXPECT_GE(kStatistics.hold_time, std::chrono::milliseconds(50));
+}
+
+TEST(ProfiledMutexTest, BEH_ManyThreads) {
+  ProfiledMutex mutex("ProfiledMutexTest::many");
+  const int kThreads(8), kIncrements(10000);
+  int total(0);
+  std::vector<std::thread> threads;
+  for (int i(0); i != kThreads; ++i) {
+    threads.push_back(std::thread([&] {
+      for (int j(0); j != kIncrements; ++j) {
+        std::lock_guard<ProfiledMutex> lock(mutex);
+        ++total;
+      }
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(kThreads * kIncrements, total);
+  const LockStatistics kStatistics(StatisticsFor("ProfiledMutexTest::many"));
+  EXPECT_EQ(static_cast<uint64_t>(kThreads * kIncrements), kStatistics.acquisitions);
+  EXPECT_LE(kStatistics.contended_acquisitions, kStatistics.acquisitions);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,84 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/public_key_cache.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(PublicKeyCacheTest, BEH_GetAddRemove) {
+  PublicKeyCache public_key_cache;
+  const NodeId kNodeId(NodeId::kRandomId);
+  const asymm::Keys kKeys(asymm::GenerateKeyPair());
+  asymm::PublicKey public_key;
+  EXPECT_FALSE(public_key_cache.Get(kNodeId, public_key));
+  public_key_cache.Add(kNodeId, kKeys.public_key);
+  ASSERT_TRUE(public_key_cache.Get(kNodeId, public_key));
+  EXPECT_TRUE(asymm::MatchingKeys(kKeys.public_key, public_key));
+  EXPECT_EQ(1U, public_key_cache.size());
+  public_key_cache.Remove(kNodeId);
+  EXPECT_FALSE(public_key_cache.Get(kNodeId, public_key));
+  EXPECT_EQ(0U, public_key_cache.size());
+}
+
+TEST(PublicKeyCacheTest, BEH_Expiry) {
+  const auto kOldTtl(Parameters::public_key_cache_ttl);
+  Parameters::public_key_cache_ttl = std::chrono::steady_clock::duration::zero();
+  PublicKeyCache public_key_cache;
+  const NodeId kNodeId(NodeId::kRandomId);
+  public_key_cache.Add(kNodeId, asymm::GenerateKeyPair().public_key);
+  asymm::PublicKey public_key;
+  EXPECT_FALSE(public_key_cache.Get(kNodeId, public_key));
+  EXPECT_EQ(0U, public_key_cache.size());
+  Parameters::public_key_cache_ttl = kOldTtl;
+}
+
+TEST(PublicKeyCacheTest, BEH_LeastRecentlyUsed) {
+  const auto kOldSize(Parameters::public_key_cache_size);
+  Parameters::public_key_cache_size = 2;
+  PublicKeyCache public_key_cache;
+  const asymm::PublicKey kPublicKey(asymm::GenerateKeyPair().public_key);
+  const NodeId kFirst(NodeId::kRandomId), kSecond(NodeId::kRandomId), kThird(NodeId::kRandomId);
+  public_key_cache.Add(kFirst, kPublicKey);
+  public_key_cache.Add(kSecond, kPublicKey);
+  // Using the first key leaves the second as the least recently used.
+  asymm::PublicKey public_key;
+  EXPECT_TRUE(public_key_cache.Get(kFirst, public_key));
+  public_key_cache.Add(kThird, kPublicKey);
+  EXPECT_EQ(2U, public_key_cache.size());
+  EXPECT_TRUE(public_key_cache.Get(kFirst, public_key));
+  EXPECT_FALSE(public_key_cache.Get(kSecond, public_key));
+  EXPECT_TRUE(public_key_cache.Get(kThird, public_key));
+  Parameters::public_key_cache_size = kOldSize;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,161 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/public_key_prefetch.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// Holds each request until Answer is called.
+struct PendingRequests {
+  void Answer() {
+    auto pending(std::move(give_keys));
+    give_keys.clear();
+    for (const auto& give_key : pending)
+      give_key(asymm::PublicKey());
+  }
+  std::vector<NodeId> requested;
+  std::vector<GivePublicKeyFunctor> give_keys;
+};
+
+}  // unnamed namespace
+
+TEST(PublicKeyPrefetchTest, BEH_PrefetchThenTake) {
+  PendingRequests requests;
+  PublicKeyPrefetch prefetch(8, std::chrono::seconds(10));
+  prefetch.set_request_public_key_functor([&](NodeId node_id, GivePublicKeyFunctor give_key) {
+    requests.requested.push_back(node_id);
+    requests.give_keys.push_back(give_key);
+  });
+  NodeId early(NodeId::kRandomId), late(NodeId::kRandomId), unfetched(NodeId::kRandomId);
+  int given(0);
+  auto count([&given](asymm::PublicKey) { ++given; });
+
+  // Answered before it's taken
+  prefetch.Prefetch(early);
+  prefetch.Prefetch(early);
+  EXPECT_EQ(1U, requests.requested.size());
+  requests.Answer();
+  prefetch.Take(early, count);
+  EXPECT_EQ(1, given);
+  EXPECT_EQ(1U, requests.requested.size());
+
+  // Taken before it's answered
+  prefetch.Prefetch(late);
+  prefetch.Take(late, count);
+  EXPECT_EQ(1, given);
+  requests.Answer();
+  EXPECT_EQ(2, given);
+
+  // Never prefetched
+  prefetch.Take(unfetched, count);
+  EXPECT_EQ(3U, requests.requested.size());
+  requests.Answer();
+  EXPECT_EQ(3, given);
+
+  // Each key is handed out once
+  prefetch.Take(early, count);
+  EXPECT_EQ(4U, requests.requested.size());
+}
+
+TEST(PublicKeyPrefetchTest, BEH_Capacity) {
+  PendingRequests requests;
+  PublicKeyPrefetch prefetch(2, std::chrono::seconds(10));
+  prefetch.set_request_public_key_functor([&](NodeId node_id, GivePublicKeyFunctor give_key) {
+    requests.requested.push_back(node_id);
+    requests.give_keys.push_back(give_key);
+  });
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 3; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    prefetch.Prefetch(node_ids.back());
+  }
+  requests.Answer();
+  int given(0);
+  auto count([&given](asymm::PublicKey) { ++given; });
+  // The oldest was forgotten, so is asked for again.
+  prefetch.Take(node_ids[0], count);
+  EXPECT_EQ(0, given);
+  EXPECT_EQ(4U, requests.requested.size());
+  prefetch.Take(node_ids[2], count);
+  EXPECT_EQ(1, given);
+}
+
+TEST(PublicKeyPrefetchTest, BEH_WaitersExpire) {
+  PendingRequests requests;
+  PublicKeyPrefetch prefetch(8, std::chrono::milliseconds(50));
+  prefetch.set_request_public_key_functor([&](NodeId node_id, GivePublicKeyFunctor give_key) {
+    requests.requested.push_back(node_id);
+    requests.give_keys.push_back(give_key);
+  });
+  NodeId unanswered(NodeId::kRandomId), answered(NodeId::kRandomId);
+  int given(0);
+  auto count([&given](asymm::PublicKey) { ++given; });
+  prefetch.Take(unanswered, count);
+  Sleep(std::chrono::milliseconds(100));
+  prefetch.Take(answered, count);
+
+  // The first waiter has given up by the time its key arrives.
+  requests.Answer();
+  EXPECT_EQ(1, given);
+  prefetch.Take(unanswered, count);
+  EXPECT_EQ(3U, requests.requested.size());
+}
+
+TEST(PublicKeyPrefetchTest, BEH_HoldsWaitedForKeysBeyondCapacity) {
+  PendingRequests requests;
+  PublicKeyPrefetch prefetch(1, std::chrono::milliseconds(50));
+  prefetch.set_request_public_key_functor([&](NodeId node_id, GivePublicKeyFunctor give_key) {
+    requests.requested.push_back(node_id);
+    requests.give_keys.push_back(give_key);
+  });
+  NodeId waited_for(NodeId::kRandomId), prefetched(NodeId::kRandomId);
+  int given(0);
+  auto count([&given](asymm::PublicKey) { ++given; });
+  EXPECT_FALSE(prefetch.Holds(waited_for));
+  prefetch.Take(waited_for, count);
+  prefetch.Prefetch(prefetched);
+  EXPECT_TRUE(prefetch.Holds(waited_for));
+  EXPECT_TRUE(prefetch.Holds(prefetched));
+
+  // Once given, a key no longer times out but can be pushed out by newer ones.
+  requests.Answer();
+  EXPECT_EQ(1, given);
+  EXPECT_FALSE(prefetch.Holds(waited_for));
+  Sleep(std::chrono::milliseconds(100));
+  EXPECT_TRUE(prefetch.Holds(prefetched));
+  prefetch.Prefetch(NodeId(NodeId::kRandomId));
+  EXPECT_FALSE(prefetch.Holds(prefetched));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
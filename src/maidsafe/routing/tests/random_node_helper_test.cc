@@ -0,0 +1,143 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/random_node_helper.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RandomNodeHelperTest, BEH_AddRemoveGet) {
+  RandomNodeHelper helper(10);
+  EXPECT_TRUE(helper.Get().IsZero());
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 10; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    helper.Add(node_ids.back());
+    helper.Add(node_ids.back());
+  }
+  EXPECT_EQ(10U, helper.size());
+  helper.Remove(node_ids[3]);
+  helper.Remove(node_ids[3]);
+  helper.Remove(NodeId(NodeId::kRandomId));
+  EXPECT_EQ(9U, helper.size());
+  for (int i(0); i != 200; ++i) {
+    NodeId got(helper.Get());
+    EXPECT_NE(node_ids[3], got);
+    EXPECT_NE(node_ids.end(), std::find(node_ids.begin(), node_ids.end(), got));
+  }
+  for (const auto& node_id : node_ids)
+    helper.Remove(node_id);
+  EXPECT_EQ(0U, helper.size());
+  EXPECT_TRUE(helper.Get().IsZero());
+}
+
+TEST(RandomNodeHelperTest, BEH_GetIsUniformWhenFull) {
+  const size_t kCapacity(10);
+  RandomNodeHelper helper(kCapacity);
+  for (size_t i(0); i != kCapacity; ++i)
+    helper.Add(NodeId(NodeId::kRandomId));
+  const int kDraws(20000);
+  std::map<NodeId, int> counts;
+  for (int i(0); i != kDraws; ++i)
+    ++counts[helper.Get()];
+  ASSERT_EQ(kCapacity, counts.size());
+  for (const auto& count : counts) {
+    EXPECT_GT(count.second, kDraws / static_cast<int>(kCapacity) / 2);
+    EXPECT_LT(count.second, kDraws / static_cast<int>(kCapacity) * 2);
+  }
+}
+
+TEST(RandomNodeHelperTest, BEH_FullSampleKeepsTakingNewNodes) {
+  const size_t kCapacity(10);
+  RandomNodeHelper helper(kCapacity);
+  std::vector<NodeId> first;
+  for (size_t i(0); i != kCapacity; ++i) {
+    first.push_back(NodeId(NodeId::kRandomId));
+    helper.Add(first.back());
+  }
+  for (int i(0); i != 1000; ++i)
+    helper.Add(NodeId(NodeId::kRandomId));
+  EXPECT_EQ(kCapacity, helper.size());
+  // Each newcomer replaces a member with probability of at least 1 / kRecencyFactor, so after 1000
+  // none of the first members should be left.
+  for (int i(0); i != 200; ++i)
+    EXPECT_EQ(first.end(), std::find(first.begin(), first.end(), helper.Get()));
+}
+
+TEST(RandomNodeHelperTest, BEH_RepeatedAddsAreOneTrial) {
+  const size_t kCapacity(10);
+  const int kHelperCount(200);
+  const NodeId kChattyId(NodeId::kRandomId);
+  int sampled_count(0);
+  for (int i(0); i != kHelperCount; ++i) {
+    RandomNodeHelper helper(kCapacity);
+    for (size_t j(0); j != 4 * kCapacity; ++j)
+      helper.Add(NodeId(NodeId::kRandomId));
+    // However many messages it sends, the newcomer is kept with probability 1 / 4.
+    for (int j(0); j != 100; ++j)
+      helper.Add(kChattyId);
+    bool sampled(false);
+    for (int j(0); j != 100 && !sampled; ++j)
+      sampled = helper.Get() == kChattyId;
+    if (sampled)
+      ++sampled_count;
+  }
+  EXPECT_LT(sampled_count, kHelperCount / 2);
+}
+
+TEST(RandomNodeHelperTest, BEH_ConcurrentAccess) {
+  RandomNodeHelper helper(20);
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 50; ++i)
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+  std::vector<std::thread> threads;
+  for (int t(0); t != 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i(0); i != 2000; ++i) {
+        const NodeId& node_id(node_ids[(i * 7 + t) % node_ids.size()]);
+        if (i % 5 == 0)
+          helper.Remove(node_id);
+        else
+          helper.Add(node_id);
+        NodeId got(helper.Get());
+        if (!got.IsZero())
+          EXPECT_NE(node_ids.end(), std::find(node_ids.begin(), node_ids.end(), got));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_GE(20U, helper.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
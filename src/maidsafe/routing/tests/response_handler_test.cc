@@ -20,6 +20,7 @@
 #include <memory>
 #include <vector>
 
+#include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
@@ -50,12 +51,13 @@ namespace test {
 class ResponseHandlerTest : public testing::Test {
  public:
   ResponseHandlerTest()
-      : node_id_(NodeId::kRandomId),
+      : asio_service_(1),
+        node_id_(NodeId::kRandomId),
         network_statistics_(node_id_),
         routing_table_(false, NodeId(NodeId::kRandomId), asymm::GenerateKeyPair(),
                        network_statistics_),
         client_routing_table_(routing_table_.kNodeId()),
-        network_(routing_table_, client_routing_table_),
+        network_(routing_table_, client_routing_table_, asio_service_),
         group_change_handler_(routing_table_, client_routing_table_, network_),
         response_handler_(routing_table_, client_routing_table_, network_, group_change_handler_) {}
 
@@ -153,7 +155,7 @@ class ResponseHandlerTest : public testing::Test {
     protobuf::Message message;
     //     message.set_destination_id(message.source_id());
     message.set_source_id(routing_table_.kNodeId().string());
-    message.clear_route_history();
+    message.clear_route_history_tags();
     message.clear_data();
     message.add_data(data);
     message.set_direct(true);
@@ -196,6 +198,7 @@ class ResponseHandlerTest : public testing::Test {
     return ComposeMsg(ComposePingResponse(ping_request.SerializeAsString()).SerializeAsString());
   }
 
+  AsioService asio_service_;
   NodeId node_id_;
   NetworkStatistics network_statistics_;
   RoutingTable routing_table_;
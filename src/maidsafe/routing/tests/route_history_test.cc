@@ -0,0 +1,102 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RouteHistoryTest, BEH_AddToRouteHistory) {
+  protobuf::Message message;
+  std::vector<NodeId> hops;
+  for (uint16_t i(0); i != Parameters::max_route_history + 2; ++i) {
+    hops.push_back(NodeId(NodeId::kRandomId));
+    AddToRouteHistory(message, hops.back());
+    AddToRouteHistory(message, hops.back());
+    EXPECT_TRUE(RouteHistoryContains(message, hops.back()));
+  }
+  EXPECT_EQ(Parameters::max_route_history, RouteHistorySize(message));
+  EXPECT_EQ(Parameters::max_route_history * kRouteHistoryTagSize,
+            message.route_history_tags().size());
+  EXPECT_FALSE(RouteHistoryContains(message, hops.at(0)));
+  EXPECT_FALSE(RouteHistoryContains(message, hops.at(1)));
+  EXPECT_FALSE(RouteHistoryContains(message, NodeId(NodeId::kRandomId)));
+  EXPECT_EQ(RouteHistoryTag(hops.back()),
+            message.route_history_tags().substr(message.route_history_tags().size() -
+                                           kRouteHistoryTagSize));
+}
+
+TEST(RouteHistoryTest, BEH_UpgradeRouteHistory) {
+  protobuf::Message message;
+  const NodeId kLegacyHop(NodeId::kRandomId), kHop(NodeId::kRandomId);
+  UpgradeRouteHistory(message);
+  EXPECT_FALSE(message.has_route_history_tags());
+  message.add_route_history(kLegacyHop.string());
+  message.add_route_history(kLegacyHop.string());
+  AddToRouteHistory(message, kHop);
+  UpgradeRouteHistory(message);
+  EXPECT_EQ(0, message.route_history_size());
+  EXPECT_EQ(2U, RouteHistorySize(message));
+  EXPECT_EQ(RouteHistoryTag(kLegacyHop) + RouteHistoryTag(kHop), message.route_history_tags());
+}
+
+TEST(RouteHistoryTest, BEH_RouteHistoryExclusions) {
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  const NodeId kFirstHop(NodeId::kRandomId), kLastHop(NodeId::kRandomId);
+  const std::vector<std::string> kFailedPeers(1, NodeId(NodeId::kRandomId).string());
+  protobuf::Message message;
+
+  EXPECT_TRUE(RouteHistoryExclusions(message, kThisNodeId, false).empty());
+
+  AddToRouteHistory(message, kThisNodeId);
+  EXPECT_TRUE(RouteHistoryExclusions(message, kThisNodeId, false).empty());
+
+  message.clear_route_history_tags();
+  AddToRouteHistory(message, kFirstHop);
+  EXPECT_TRUE(RouteHistoryExclusions(message, kThisNodeId, false).Contains(kFirstHop));
+
+  AddToRouteHistory(message, kLastHop);
+  ExcludedNodes exclusions(RouteHistoryExclusions(message, kThisNodeId, false, kFailedPeers));
+  EXPECT_EQ(2U, exclusions.size());
+  EXPECT_TRUE(exclusions.Contains(kFirstHop));
+  EXPECT_FALSE(exclusions.Contains(kLastHop));
+  EXPECT_TRUE(exclusions.Contains(NodeId(kFailedPeers.front())));
+  EXPECT_FALSE(exclusions.ContainsTag(NodeId(kFailedPeers.front())));
+
+  exclusions = RouteHistoryExclusions(message, kThisNodeId, true, kFailedPeers);
+  EXPECT_EQ(3U, exclusions.size());
+  EXPECT_TRUE(exclusions.Contains(kLastHop));
+  EXPECT_FALSE(exclusions.Contains(kThisNodeId));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
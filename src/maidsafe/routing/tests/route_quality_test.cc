@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_quality.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RouteQualityTest, BEH_LongRoutesEarnAllowance) {
+  const uint16_t kMaxBias(Parameters::route_quality_max_bucket_bias);
+  Parameters::route_quality_max_bucket_bias = 2;
+  RouteQuality route_quality;
+  const int32_t kNearBucket(400), kFarBucket(500);
+  for (int i(0); i != 64; ++i) {
+    route_quality.RecordHops(kNearBucket, 2);
+    route_quality.RecordHops(kFarBucket, 2);
+  }
+  EXPECT_EQ(0U, route_quality.BucketAllowance(kNearBucket));
+  EXPECT_EQ(0U, route_quality.BucketAllowance(kFarBucket));
+
+  // Once the far bucket's routes are longer than the average by more than the cap, its allowance
+  // is capped.
+  for (int i(0); i != 64; ++i)
+    route_quality.RecordHops(kFarBucket, 12);
+  EXPECT_GT(route_quality.MeanHops(kFarBucket), route_quality.MeanHops(kNearBucket));
+  EXPECT_EQ(0U, route_quality.BucketAllowance(kNearBucket));
+  EXPECT_EQ(2U, route_quality.BucketAllowance(kFarBucket));
+
+  // It goes again as routes to it shorten.
+  for (int i(0); i != 64; ++i) {
+    route_quality.RecordHops(kNearBucket, 2);
+    route_quality.RecordHops(kFarBucket, 2);
+  }
+  EXPECT_EQ(0U, route_quality.BucketAllowance(kFarBucket));
+
+  // No allowance is given when the bias is disabled.
+  Parameters::route_quality_max_bucket_bias = 0;
+  for (int i(0); i != 64; ++i)
+    route_quality.RecordHops(kFarBucket, 12);
+  EXPECT_EQ(0U, route_quality.BucketAllowance(kFarBucket));
+  Parameters::route_quality_max_bucket_bias = kMaxBias;
+}
+
+TEST(RouteQualityTest, BEH_IgnoresInvalidSamples) {
+  RouteQuality route_quality;
+  route_quality.RecordHops(-1, 3);
+  route_quality.RecordHops(RouteQuality::kBucketCount, 3);
+  route_quality.RecordHops(10, 0);
+  EXPECT_EQ(0.0, route_quality.MeanHops(10));
+  EXPECT_EQ(0U, route_quality.BucketAllowance(-1));
+  EXPECT_EQ(0U, route_quality.BucketAllowance(RouteQuality::kBucketCount));
+  // Too few samples to act on
+  for (int i(0); i != 4; ++i)
+    route_quality.RecordHops(10, 20);
+  EXPECT_EQ(0U, route_quality.BucketAllowance(10));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,245 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/message_handler.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/simulated_transport.h"
+#include "maidsafe/routing/tests/routing_network.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+typedef std::chrono::steady_clock::duration Duration;
+
+// How much churn a run drives: |events| joins or leaves of vaults in a network of |vaults|, one
+// every |interval| or once the previous one has converged, whichever is later.
+struct ChurnProfile {
+  size_t vaults, events;
+  double join_fraction;
+  std::chrono::milliseconds interval;
+};
+
+// Counts of messages sent, per hop, of the types churn causes.
+struct MessageCounts {
+  MessageCounts() : closest_nodes_update(0), connect(0), remove(0) {}
+  std::atomic<uint64_t> closest_nodes_update, connect, remove;
+};
+
+struct ChurnEventResult {
+  bool join;
+  // Until every routing table holds its closest vaults, and every group matrix its close group;
+  // zero if not reached within kConvergenceTimeout.
+  Duration routing_table_convergence, close_group_convergence;
+  uint64_t closest_nodes_updates, connects, removes, matrix_changes;
+};
+
+const Duration kConvergenceTimeout(std::chrono::seconds(60));
+const std::chrono::milliseconds kPollInterval(100);
+
+double Milliseconds(Duration duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+}
+
+}  // unnamed namespace
+
+// Drives churn over a simulated network and reports how quickly, and at what cost in messages and
+// matrix changes, the network converges after each event.  The bootstrap nodes' matrix changes
+// aren't counted, as they join before their functors can be set.
+class RoutingChurnBenchmark : public GenericNetwork,
+                              public testing::TestWithParam<ChurnProfile> {
+ public:
+  RoutingChurnBenchmark()
+      : GenericNetwork(),
+        simulated_network_(std::make_shared<SimulatedNetwork>()),
+        message_counts_(std::make_shared<MessageCounts>()),
+        matrix_changes_(std::make_shared<std::atomic<uint64_t>>(0)) {}
+
+  void SetUp() override {
+    std::shared_ptr<MessageCounts> message_counts(message_counts_);
+    simulated_network_->set_message_observer([message_counts](const std::string& message) {
+      MessageHeader header;
+      if (!header.Decode(message) || !header.request)
+        return;
+      switch (static_cast<MessageType>(header.type)) {
+        case MessageType::kClosestNodesUpdate:
+          ++message_counts->closest_nodes_update;
+          break;
+        case MessageType::kConnect:
+          ++message_counts->connect;
+          break;
+        case MessageType::kRemove:
+          ++message_counts->remove;
+          break;
+        default:
+          break;
+      }
+    });
+    // Routing's own timers run in real time, so the network must keep up with them.
+    simulated_network_->Start();
+    GenericNode::UseSimulatedNetwork(simulated_network_);
+    GenericNetwork::SetUp();
+  }
+
+  void TearDown() override {
+    GenericNetwork::TearDown();
+    nodes_.clear();
+    GenericNode::UseSimulatedNetwork(nullptr);
+    simulated_network_->Stop();
+  }
+
+ protected:
+  void AddVault() {
+    std::shared_ptr<std::atomic<uint64_t>> matrix_changes(matrix_changes_);
+    AddNode(MakePmid(), [matrix_changes](std::shared_ptr<MatrixChange>) { ++*matrix_changes; });
+  }
+
+  // Returns how long it took for |converged| to hold, from |start|, or zero if it didn't within
+  // kConvergenceTimeout.
+  template <typename Predicate>
+  Duration ConvergenceTime(std::chrono::steady_clock::time_point start, Predicate converged) {
+    while (!converged()) {
+      if (std::chrono::steady_clock::now() - start > kConvergenceTimeout)
+        return Duration::zero();
+      Sleep(kPollInterval);
+    }
+    return std::chrono::steady_clock::now() - start;
+  }
+
+  ChurnEventResult RunEvent(bool join) {
+    ChurnEventResult result;
+    result.join = join;
+    const uint64_t kClosestNodesUpdates(message_counts_->closest_nodes_update),
+        kConnects(message_counts_->connect), kRemoves(message_counts_->remove),
+        kMatrixChanges(*matrix_changes_);
+    const auto kStart(std::chrono::steady_clock::now());
+    if (join) {
+      AddVault();
+    } else {
+      // The bootstrap nodes, at indices 0 and 1, stay.
+      const size_t kIndex(2 + RandomUint32() % (ClientIndex() - 2));
+      RemoveNode(nodes_.at(kIndex)->node_id());
+    }
+    result.routing_table_convergence =
+        ConvergenceTime(kStart, [this] { return ValidateRoutingTables(); });
+    result.close_group_convergence = ConvergenceTime(
+        kStart, [this] { return static_cast<bool>(CheckGroupMatrixUniqueNodes()); });
+    // Messages and matrix changes are counted until the next event starts.
+    std::this_thread::sleep_until(kStart + GetParam().interval);
+    result.closest_nodes_updates = message_counts_->closest_nodes_update - kClosestNodesUpdates;
+    result.connects = message_counts_->connect - kConnects;
+    result.removes = message_counts_->remove - kRemoves;
+    result.matrix_changes = *matrix_changes_ - kMatrixChanges;
+    return result;
+  }
+
+  void Report(const std::vector<ChurnEventResult>& results) {
+    std::cout << std::left << std::setw(8) << "event" << std::right << std::setw(14)
+              << "table_ms" << std::setw(14) << "group_ms" << std::setw(10) << "updates"
+              << std::setw(10) << "connects" << std::setw(10) << "removes" << std::setw(10)
+              << "matrix" << '\n';
+    auto print([](const std::string& name, double table_ms, double group_ms, double updates,
+                  double connects, double removes, double matrix_changes) {
+      std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+                << std::setprecision(1) << std::setw(14) << table_ms << std::setw(14) << group_ms
+                << std::setw(10) << updates << std::setw(10) << connects << std::setw(10)
+                << removes << std::setw(10) << matrix_changes << '\n';
+    });
+    for (const bool kJoin : {true, false}) {
+      double table_ms(0), group_ms(0), updates(0), connects(0), removes(0), matrix_changes(0);
+      size_t events(0);
+      for (const auto& result : results) {
+        if (result.join != kJoin)
+          continue;
+        ++events;
+        table_ms += Milliseconds(result.routing_table_convergence);
+        group_ms += Milliseconds(result.close_group_convergence);
+        updates += result.closest_nodes_updates;
+        connects += result.connects;
+        removes += result.removes;
+        matrix_changes += result.matrix_changes;
+      }
+      if (events != 0) {
+        print(kJoin ? "join" : "leave", table_ms / events, group_ms / events, updates / events,
+              connects / events, removes / events, matrix_changes / events);
+      }
+    }
+    std::cout << "(means per event; messages are requests sent, counting each hop)" << std::endl;
+  }
+
+  std::shared_ptr<SimulatedNetwork> simulated_network_;
+  std::shared_ptr<MessageCounts> message_counts_;
+  std::shared_ptr<std::atomic<uint64_t>> matrix_changes_;
+};
+
+TEST_P(RoutingChurnBenchmark, FUNC_ChurnConvergence) {
+  const ChurnProfile kProfile(GetParam());
+  for (size_t i(0); i != kProfile.vaults; ++i)
+    AddVault();
+  ASSERT_TRUE(WaitForNodesToJoin());
+  ASSERT_TRUE(WaitForHealthToStabilise());
+
+  std::vector<ChurnEventResult> results;
+  for (size_t i(0); i != kProfile.events; ++i) {
+    // Joins and leaves are balanced around the starting size, so the network neither empties nor
+    // outgrows the profile.
+    const bool kJoin(ClientIndex() <= 2 + kProfile.vaults / 2 ||
+                     (ClientIndex() < 2 + kProfile.vaults * 3 / 2 &&
+                      RandomUint32() % 1000 < kProfile.join_fraction * 1000));
+    results.push_back(RunEvent(kJoin));
+    EXPECT_NE(Duration::zero(), results.back().routing_table_convergence)
+        << "Routing tables didn't converge after event " << i;
+    EXPECT_NE(Duration::zero(), results.back().close_group_convergence)
+        << "Close groups didn't converge after event " << i;
+  }
+  std::cout << kProfile.vaults << " vaults, " << kProfile.events << " events, one per "
+            << kProfile.interval.count() << " ms at the most" << std::endl;
+  Report(results);
+}
+
+INSTANTIATE_TEST_CASE_P(ChurnRates, RoutingChurnBenchmark,
+                        testing::Values(ChurnProfile{20, 20, 0.5, std::chrono::seconds(5)},
+                                        ChurnProfile{20, 20, 0.5, std::chrono::seconds(1)},
+                                        ChurnProfile{40, 40, 0.5, std::chrono::seconds(1)}));
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,134 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/routing_api.h"
+#include "maidsafe/routing/routing_context.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RoutingContextTest, BEH_DefaultThreadCount) {
+  RoutingContext context;
+  EXPECT_EQ(std::max(std::thread::hardware_concurrency(), 1U), context.thread_count());
+  EXPECT_EQ(context.asio_service(), context.asio_service());
+  RoutingContext single_threaded(1);
+  EXPECT_EQ(1U, single_threaded.thread_count());
+}
+
+TEST(RoutingContextTest, BEH_SharedServiceRunsWork) {
+  RoutingContext context(2);
+  std::shared_ptr<AsioService> first(context.asio_service()), second(context.asio_service());
+  std::atomic<int> run_count(0);
+  std::promise<void> done;
+  first->service().post([&] { ++run_count; });
+  second->service().post([&] {
+    ++run_count;
+    done.set_value();
+  });
+  done.get_future().wait();
+  context.Stop();
+  EXPECT_EQ(2, run_count);
+  context.Stop();
+}
+
+TEST(RoutingContextTest, BEH_DestroyOneOfTwoRoutingObjects) {
+  RoutingContext context(2);
+  std::unique_ptr<Routing> first(new Routing(context)), second(new Routing(context));
+  Functors functors;
+  functors.network_status = [](int) {};  // NOLINT
+  functors.message_and_caching.message_received = [](const std::string&, ReplyFunctor) {};
+  // Nobody answers at this contact, so both keep retrying on the shared service's timers.
+  const std::vector<boost::asio::ip::udp::endpoint> kContacts(
+      1, boost::asio::ip::udp::endpoint(GetLocalIp(), maidsafe::test::GetRandomPort()));
+  first->Join(functors, kContacts);
+  second->Join(functors, kContacts);
+  Sleep(std::chrono::milliseconds(200));
+
+  // Whatever the first leaves queued on the service does nothing once it's gone.
+  first.reset();
+  Sleep(std::chrono::milliseconds(500));
+  std::promise<void> ran;
+  context.asio_service()->service().post([&ran] { ran.set_value(); });
+  EXPECT_EQ(std::future_status::ready, ran.get_future().wait_for(std::chrono::seconds(5)));
+  second.reset();
+  context.Stop();
+}
+
+TEST(RoutingContextTest, BEH_DestroyWithRelayRetirementQueued) {
+  const uint16_t kOldRelayRetirementThreshold(Parameters::relay_retirement_threshold);
+  // Each change of network status then posts a relay retirement to the shared service.
+  Parameters::relay_retirement_threshold = 1;
+  RoutingContext context(2);
+  auto pmid1(MakePmid()), pmid2(MakePmid());
+  NodeInfoAndPrivateKey node1(MakeNodeInfoAndKeysWithPmid(pmid1));
+  NodeInfoAndPrivateKey node2(MakeNodeInfoAndKeysWithPmid(pmid2));
+  std::unique_ptr<Routing> first(new Routing(pmid1, context)), second(new Routing(pmid2, context));
+  Functors functors1, functors2;
+  functors1.network_status = [](int) {};  // NOLINT
+  functors1.message_and_caching.message_received = [](const std::string&, ReplyFunctor) {};
+  functors2 = functors1;
+  functors1.request_public_key = [&](const NodeId&, GivePublicKeyFunctor give_key) {
+    give_key(pmid2.public_key());
+  };
+  functors2.request_public_key = [&](const NodeId&, GivePublicKeyFunctor give_key) {
+    give_key(pmid1.public_key());
+  };
+  boost::asio::ip::udp::endpoint endpoint1(GetLocalIp(), maidsafe::test::GetRandomPort()),
+      endpoint2(GetLocalIp(), maidsafe::test::GetRandomPort());
+  auto join1(std::async(std::launch::async, [&] {
+    return first->ZeroStateJoin(functors1, endpoint1, endpoint2, node2.node_info);
+  }));
+  auto join2(std::async(std::launch::async, [&] {
+    return second->ZeroStateJoin(functors2, endpoint2, endpoint1, node1.node_info);
+  }));
+  EXPECT_EQ(kSuccess, join1.get());
+  EXPECT_EQ(kSuccess, join2.get());
+
+  // The first goes while its retirement may still be queued, and its peer sees it leave.
+  first.reset();
+  Sleep(std::chrono::milliseconds(500));
+  std::promise<void> ran;
+  context.asio_service()->service().post([&ran] { ran.set_value(); });
+  EXPECT_EQ(std::future_status::ready, ran.get_future().wait_for(std::chrono::seconds(5)));
+  second.reset();
+  context.Stop();
+  Parameters::relay_retirement_threshold = kOldRelayRetirementThreshold;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
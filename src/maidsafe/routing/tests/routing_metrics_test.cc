@@ -0,0 +1,155 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/routing_metrics.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RoutingMetricsTest, BEH_LatencyHistogramBuckets) {
+  // Exact below 8us, then 8 buckets per doubling.
+  for (int64_t value(0); value != 8; ++value) {
+    EXPECT_EQ(value, LatencyHistogram::BucketIndex(std::chrono::microseconds(value)));
+    EXPECT_EQ(value, LatencyHistogram::BucketUpperBound(static_cast<int>(value)).count());
+  }
+  EXPECT_EQ(8, LatencyHistogram::BucketIndex(std::chrono::microseconds(8)));
+  EXPECT_EQ(15, LatencyHistogram::BucketIndex(std::chrono::microseconds(15)));
+  EXPECT_EQ(16, LatencyHistogram::BucketIndex(std::chrono::microseconds(16)));
+  EXPECT_EQ(16, LatencyHistogram::BucketIndex(std::chrono::microseconds(17)));
+  EXPECT_EQ(17, LatencyHistogram::BucketUpperBound(16).count());
+
+  // Every value lies in a bucket no wider than an eighth of it, whose bounds hold it.
+  for (int64_t value(1); value < (int64_t(1) << 28); value = value * 3 / 2 + 1) {
+    const int kIndex(LatencyHistogram::BucketIndex(std::chrono::microseconds(value)));
+    const int64_t kUpper(LatencyHistogram::BucketUpperBound(kIndex).count());
+    const int64_t kLower(kIndex == 0 ? 0 : LatencyHistogram::BucketUpperBound(kIndex - 1).count());
+    EXPECT_LT(kLower, value);
+    EXPECT_GE(kUpper, value);
+    EXPECT_LE((kUpper - kLower) * 8, value + 8);
+  }
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1,
+            LatencyHistogram::BucketIndex(std::chrono::hours(24)));
+  EXPECT_EQ(0, LatencyHistogram::BucketIndex(std::chrono::microseconds(-1)));
+}
+
+TEST(RoutingMetricsTest, BEH_Percentiles) {
+  RoutingMetrics metrics;
+  EXPECT_EQ(0, metrics.Snapshot().response_latency.Percentile(50).count());
+  for (int i(1); i <= 1000; ++i)
+    metrics.RecordResponseLatency(std::chrono::milliseconds(i));
+  const LatencyHistogram kLatency(metrics.Snapshot().response_latency);
+  EXPECT_EQ(1000U, kLatency.count);
+  auto near([](std::chrono::microseconds actual, std::chrono::microseconds expected) {
+    return actual >= expected && actual <= expected + expected / 8;
+  });
+  EXPECT_TRUE(near(kLatency.Percentile(50), std::chrono::milliseconds(500)));
+  EXPECT_TRUE(near(kLatency.Percentile(99), std::chrono::milliseconds(990)));
+  EXPECT_TRUE(near(kLatency.Percentile(100), std::chrono::milliseconds(1000)));
+  EXPECT_TRUE(near(kLatency.Percentile(0), std::chrono::milliseconds(1)));
+}
+
+TEST(RoutingMetricsTest, BEH_CountersMergeAcrossThreads) {
+  RoutingMetrics metrics;
+  const int kThreads(16), kIncrements(10000);
+  std::vector<std::thread> threads;
+  for (int i(0); i != kThreads; ++i) {
+    threads.push_back(std::thread([&metrics, i] {
+      for (int j(0); j != kIncrements; ++j) {
+        metrics.Add(RoutingMetrics::kReceived, 2);
+        metrics.Add(RoutingMetrics::kBytesReceived, 2, 10);
+        metrics.Add(RoutingMetrics::kForwarded, i % 2 == 0 ? 101 : 555);
+      }
+    }));
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  const RoutingStatistics kStatistics(metrics.Snapshot());
+  // Only types counted at all appear; unknown types are counted under 0.
+  ASSERT_EQ(3U, kStatistics.by_type.size());
+  EXPECT_EQ(kThreads * kIncrements, kStatistics.by_type.at(2).received);
+  EXPECT_EQ(kThreads * kIncrements * 10U, kStatistics.by_type.at(2).bytes_received);
+  EXPECT_EQ(kThreads * kIncrements / 2, kStatistics.by_type.at(101).forwarded);
+  EXPECT_EQ(kThreads * kIncrements / 2, kStatistics.by_type.at(0).forwarded);
+  const MessageTypeCounters kTotal(kStatistics.Total());
+  EXPECT_EQ(kThreads * kIncrements, kTotal.received);
+  EXPECT_EQ(kThreads * kIncrements, kTotal.forwarded);
+  EXPECT_EQ(0U, kTotal.sent);
+}
+
+TEST(RoutingMetricsTest, BEH_RequestOutcomes) {
+  RoutingMetrics metrics;
+  TaskOutcome outcome;
+  outcome.tag = RoutingMetrics::RequestTag(DestinationType::kDirect, 100);
+  outcome.expected_response_count = outcome.response_count = 1;
+  outcome.elapsed = std::chrono::milliseconds(20);
+  metrics.RecordRequestOutcome(outcome);
+
+  outcome.tag = RoutingMetrics::RequestTag(DestinationType::kGroup, 20 * 1024);
+  outcome.ending = TaskOutcome::kTimedOut;
+  outcome.expected_response_count = 4;
+  outcome.response_count = 3;
+  metrics.RecordRequestOutcome(outcome);
+  outcome.response_count = 0;
+  metrics.RecordRequestOutcome(outcome);
+  outcome.ending = TaskOutcome::kCancelled;
+  metrics.RecordRequestOutcome(outcome);
+
+  // Tasks which aren't requests are left out.
+  outcome.tag = 0;
+  metrics.RecordRequestOutcome(outcome);
+
+  const RoutingStatistics kStatistics(metrics.Snapshot());
+  const RequestStatistics& kDirect(kStatistics.direct_requests[0]);
+  EXPECT_EQ(1U, kDirect.completed);
+  EXPECT_EQ(1U, kDirect.responses);
+  EXPECT_EQ(1U, kDirect.completion_latency.count);
+  EXPECT_GE(kDirect.completion_latency.Percentile(50), std::chrono::milliseconds(20));
+  const RequestStatistics& kGroup(kStatistics.group_requests[2]);
+  EXPECT_EQ(0U, kGroup.completed);
+  EXPECT_EQ(2U, kGroup.timed_out);
+  EXPECT_EQ(1U, kGroup.timed_out_partially_answered);
+  EXPECT_EQ(1U, kGroup.cancelled);
+  EXPECT_EQ(3U, kGroup.responses);
+  EXPECT_EQ(12U, kGroup.expected_responses);
+  EXPECT_EQ(0U, kGroup.completion_latency.count);
+  for (int i(0); i != RoutingStatistics::kRequestSizeClassCount; ++i) {
+    if (i != 0)
+      EXPECT_EQ(0U, kStatistics.direct_requests[i].completed);
+    if (i != 2)
+      EXPECT_EQ(0U, kStatistics.group_requests[i].timed_out);
+  }
+  EXPECT_EQ(0, RoutingStatistics::RequestSizeClass(1024));
+  EXPECT_EQ(1, RoutingStatistics::RequestSizeClass(1025));
+  EXPECT_EQ(3, RoutingStatistics::RequestSizeClass(256 * 1024 + 1));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -18,9 +18,13 @@
 
 #include "maidsafe/routing/tests/routing_network.h"
 
+#include <algorithm>
 #include <future>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -32,6 +36,7 @@
 #include "maidsafe/routing/routing_api.h"
 #include "maidsafe/routing/tests/test_utils.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/simulated_transport.h"
 #include "maidsafe/routing/utils.h"
 
 namespace asio = boost::asio;
@@ -67,6 +72,7 @@ typedef boost::asio::ip::udp::endpoint Endpoint;
 }  // unnamed namespace
 
 size_t GenericNode::next_node_id_(1);
+std::shared_ptr<SimulatedNetwork> GenericNode::simulated_network_in_use_;
 
 GenericNode::GenericNode(bool has_symmetric_nat)
     : functors_(),
@@ -79,6 +85,7 @@ GenericNode::GenericNode(bool has_symmetric_nat)
       nat_type_(rudp::NatType::kUnknown),
       has_symmetric_nat_(has_symmetric_nat),
       endpoint_(),
+      simulated_network_(simulated_network_in_use_),
       messages_(),
       routing_(),
       health_mutex_(),
@@ -86,8 +93,7 @@ GenericNode::GenericNode(bool has_symmetric_nat)
   node_info_plus_.reset(new NodeInfoAndPrivateKey(MakeNodeInfoAndKeys()));
   routing_.reset(new Routing());
   node_info_plus_->node_info.node_id = routing_->kNodeId();
-  endpoint_.address(GetLocalIp());
-  endpoint_.port(maidsafe::test::GetRandomPort());
+  InitialiseEndpoint();
   InitialiseFunctors();
   LOG(kVerbose) << "Node constructor";
   std::lock_guard<std::mutex> lock(mutex_);
@@ -105,6 +111,7 @@ GenericNode::GenericNode(bool client_mode, const rudp::NatType& nat_type)
       nat_type_(nat_type),
       has_symmetric_nat_(nat_type == rudp::NatType::kSymmetric),
       endpoint_(),
+      simulated_network_(simulated_network_in_use_),
       messages_(),
       routing_(),
       health_mutex_(),
@@ -118,8 +125,7 @@ GenericNode::GenericNode(bool client_mode, const rudp::NatType& nat_type)
     node_info_plus_.reset(new NodeInfoAndPrivateKey(MakeNodeInfoAndKeysWithPmid(pmid)));
     routing_.reset(new Routing(pmid));
   }
-  endpoint_.address(GetLocalIp());
-  endpoint_.port(maidsafe::test::GetRandomPort());
+  InitialiseEndpoint();
   InitialiseFunctors();
   routing_->pimpl_->network_.nat_type_ = nat_type_;
   LOG(kVerbose) << "Node constructor";
@@ -139,14 +145,14 @@ GenericNode::GenericNode(const passport::Pmid& pmid, bool has_symmetric_nat)
       nat_type_(rudp::NatType::kUnknown),
       has_symmetric_nat_(has_symmetric_nat),
       endpoint_(),
+      simulated_network_(simulated_network_in_use_),
       messages_(),
       routing_(),
       health_mutex_(),
       health_(0) {
-  endpoint_.address(GetLocalIp());
-  endpoint_.port(maidsafe::test::GetRandomPort());
   InitialiseFunctors();
   routing_.reset(new Routing(pmid));
+  InitialiseEndpoint();
   LOG(kVerbose) << "Node constructor";
   std::lock_guard<std::mutex> lock(mutex_);
   id_ = next_node_id_++;
@@ -164,14 +170,14 @@ GenericNode::GenericNode(const passport::Maid& maid, bool has_symmetric_nat)
       nat_type_(rudp::NatType::kUnknown),
       has_symmetric_nat_(has_symmetric_nat),
       endpoint_(),
+      simulated_network_(simulated_network_in_use_),
       messages_(),
       routing_(),
       health_mutex_(),
       health_(0) {
-  endpoint_.address(GetLocalIp());
-  endpoint_.port(maidsafe::test::GetRandomPort());
   InitialiseFunctors();
   routing_.reset(new Routing(maid));
+  InitialiseEndpoint();
   LOG(kVerbose) << "Node constructor";
   std::lock_guard<std::mutex> lock(mutex_);
   id_ = next_node_id_++;
@@ -179,6 +185,21 @@ GenericNode::GenericNode(const passport::Maid& maid, bool has_symmetric_nat)
 
 GenericNode::~GenericNode() {}
 
+void GenericNode::UseSimulatedNetwork(std::shared_ptr<SimulatedNetwork> simulated_network) {
+  simulated_network_in_use_ = simulated_network;
+}
+
+void GenericNode::InitialiseEndpoint() {
+  if (!simulated_network_) {
+    endpoint_.address(GetLocalIp());
+    endpoint_.port(maidsafe::test::GetRandomPort());
+    return;
+  }
+  std::unique_ptr<SimulatedTransport> transport(simulated_network_->CreateTransport());
+  endpoint_ = transport->endpoint();
+  routing_->pimpl_->network_.set_transport(std::move(transport));
+}
+
 void GenericNode::InitialiseFunctors() {
   functors_.close_node_replaced = [&](const std::vector<NodeInfo>&) {
     std::cout << "Node " << HexSubstr(node_info_plus_->node_info.node_id.string())
@@ -380,22 +401,21 @@ void GenericNode::PrintRoutingTable() {
              << (IsClient() ? " (Client)" : " (Vault) :")
              << "Routing table size: " << routing_->pimpl_->routing_table_.nodes_.size();
   {
-    std::lock_guard<std::mutex> lock(routing_->pimpl_->routing_table_.mutex_);
+    std::lock_guard<HotPathMutex> lock(routing_->pimpl_->routing_table_.mutex_);
     for (const auto& node_info : routing_->pimpl_->routing_table_.nodes_) {
       LOG(kInfo) << "\tNodeId : " << HexSubstr(node_info.node_id.string());
     }
   }
   LOG(kInfo) << "[" << HexSubstr(node_info_plus_->node_info.node_id.string())
              << "]'s Non-RoutingTable : ";
-  std::lock_guard<std::mutex> lock(routing_->pimpl_->client_routing_table_.mutex_);
-  for (const auto& node_info : routing_->pimpl_->client_routing_table_.nodes_) {
+  for (const auto& node_info : routing_->pimpl_->client_routing_table_.nodes()) {
     LOG(kInfo) << "\tNodeId : " << HexSubstr(node_info.node_id.string());
   }
 }
 
 std::vector<NodeId> GenericNode::ReturnRoutingTable() {
   std::vector<NodeId> routing_nodes;
-  std::lock_guard<std::mutex> lock(routing_->pimpl_->routing_table_.mutex_);
+  std::lock_guard<HotPathMutex> lock(routing_->pimpl_->routing_table_.mutex_);
   for (const auto& node_info : routing_->pimpl_->routing_table_.nodes_)
     routing_nodes.push_back(node_info.node_id);
   return routing_nodes;
@@ -440,11 +460,13 @@ void GenericNode::SetHealth(int health) {
 void GenericNode::PostTaskToAsioService(std::function<void()> functor) {
   std::lock_guard<std::mutex> lock(routing_->pimpl_->running_mutex_);
   if (routing_->pimpl_->running_)
-    routing_->pimpl_->asio_service_.service().post(functor);
+    routing_->pimpl_->asio_service_->service().post(functor);
 }
 
 rudp::NatType GenericNode::nat_type() { return routing_->pimpl_->network_.nat_type(); }
 
+CacheStatistics GenericNode::GetCacheStatistics() const { return routing_->GetCacheStatistics(); }
+
 GenericNetwork::GenericNetwork()
     : mutex_(),
       fobs_mutex_(),
@@ -469,7 +491,9 @@ GenericNetwork::~GenericNetwork() {
 }
 
 void GenericNetwork::SetUp() {
-  NodePtr node1(new GenericNode(MakePmid())), node2(new GenericNode(MakePmid()));
+  auto pmid1(std::async(std::launch::async, [] { return MakePmid(); }));
+  passport::Pmid pmid2(MakePmid());
+  NodePtr node1(new GenericNode(pmid1.get())), node2(new GenericNode(pmid2));
   nodes_.push_back(node1);
   nodes_.push_back(node2);
   client_index_ = 2;
@@ -565,6 +589,77 @@ void GenericNetwork::SetUpNetwork(size_t total_number_vaults,
   //    EXPECT_TRUE(ValidateRoutingTables());
 }
 
+void GenericNetwork::SetUpNetworkInWaves(const NetworkSnapshot& snapshot, size_t wave_size) {
+  std::vector<NodePtr> vaults, clients;
+  for (const auto& pmid : snapshot.vaults)
+    vaults.push_back(NodePtr(new GenericNode(pmid)));
+  for (const auto& maid : snapshot.clients)
+    clients.push_back(NodePtr(new GenericNode(maid)));
+  // Clients need vaults to join through, so only start once every vault is in.
+  JoinInWaves(vaults, wave_size);
+  JoinInWaves(clients, wave_size);
+  Sleep(std::chrono::seconds(1));
+  PrintRoutingTables();
+}
+
+NetworkSnapshot GenericNetwork::MakeNetworkSnapshot(size_t total_number_vaults,
+                                                    size_t total_number_clients) {
+  assert(total_number_vaults >= 2);
+  const size_t kVaults(total_number_vaults - 2), kTotal(kVaults + total_number_clients);
+  const size_t kThreads(std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(), kTotal)));
+  // Each thread makes a contiguous share of the vaults' then clients' identities.
+  std::vector<std::future<NetworkSnapshot>> shares;
+  for (size_t thread(0); thread != kThreads; ++thread) {
+    const size_t kBegin(kTotal * thread / kThreads), kEnd(kTotal * (thread + 1) / kThreads);
+    shares.push_back(std::async(std::launch::async, [kBegin, kEnd, kVaults] {
+      NetworkSnapshot share;
+      for (size_t index(kBegin); index != kEnd; ++index) {
+        if (index < kVaults)
+          share.vaults.push_back(MakePmid());
+        else
+          share.clients.push_back(MakeMaid());
+      }
+      return share;
+    }));
+  }
+  NetworkSnapshot snapshot;
+  for (auto& share : shares) {
+    NetworkSnapshot part(share.get());
+    snapshot.vaults.insert(snapshot.vaults.end(), part.vaults.begin(), part.vaults.end());
+    snapshot.clients.insert(snapshot.clients.end(), part.clients.begin(), part.clients.end());
+  }
+  return snapshot;
+}
+
+const NetworkSnapshot& GenericNetwork::SharedNetworkSnapshot(size_t total_number_vaults,
+                                                             size_t total_number_clients) {
+  static std::mutex mutex;
+  static std::map<std::pair<size_t, size_t>, NetworkSnapshot> snapshots;
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto kKey(std::make_pair(total_number_vaults, total_number_clients));
+  auto itr(snapshots.find(kKey));
+  if (itr == snapshots.end())
+    itr = snapshots.insert(std::make_pair(
+        kKey, MakeNetworkSnapshot(total_number_vaults, total_number_clients))).first;
+  return itr->second;
+}
+
+void GenericNetwork::JoinInWaves(const std::vector<NodePtr>& nodes, size_t wave_size) {
+  wave_size = std::max<size_t>(1, wave_size);
+  for (size_t begin(0); begin < nodes.size(); begin += wave_size) {
+    std::vector<std::future<void>> joins;
+    for (size_t index(begin); index != std::min(nodes.size(), begin + wave_size); ++index) {
+      NodePtr node(nodes[index]);
+      joins.push_back(
+          std::async(std::launch::async, [this, node] { AddNodeDetails(node, false); }));
+    }
+    for (auto& join : joins)
+      join.get();
+    LOG(kVerbose) << "Wave joined; " << nodes_.size() << " nodes in network";
+  }
+}
+
 void GenericNetwork::AddNode(bool client_mode, MatrixChangedFunctor matrix_change_functor) {
   NodePtr node;
   if (client_mode) {
@@ -1521,7 +1616,7 @@ uint16_t GenericNetwork::NonClientNonSymmetricNatNodesSize() const {
   return non_client_non_sym_size;
 }
 
-void GenericNetwork::AddNodeDetails(NodePtr node) {
+void GenericNetwork::AddNodeDetails(NodePtr node, bool settle) {
   std::string descriptor;
   if (node->has_symmetric_nat_)
     descriptor.append("Symmetric ");
@@ -1584,9 +1679,11 @@ void GenericNetwork::AddNodeDetails(NodePtr node) {
     auto result = cond_var->wait_for(lock, std::chrono::seconds(maximum_wait));
     EXPECT_EQ(result, std::cv_status::no_timeout) << descriptor << " node failed to join: "
                                                   << DebugId(node->node_id());
-    Sleep(std::chrono::milliseconds(1000));
+    if (settle)
+      Sleep(std::chrono::milliseconds(1000));
   }
-  PrintRoutingTables();
+  if (settle)
+    PrintRoutingTables();
 }
 
 std::shared_ptr<GenericNetwork> NodesEnvironment::g_env_ =
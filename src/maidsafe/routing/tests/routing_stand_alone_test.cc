@@ -99,6 +99,13 @@ TEST_F(RoutingStandAloneTest, FUNC_ClientRoutingTableUpdate) {
 
 TEST_F(RoutingStandAloneTest, FUNC_SetupNetwork) { this->SetUpNetwork(kServerSize); }
 
+TEST_F(RoutingStandAloneTest, FUNC_SetupNetworkInWaves) {
+  this->SetUpNetworkInWaves(SharedNetworkSnapshot(kServerSize, kClientSize));
+  ASSERT_EQ(kNetworkSize, this->nodes_.size());
+  EXPECT_TRUE(this->WaitForHealthToStabilise());
+  EXPECT_TRUE(this->SendDirect(1));
+}
+
 TEST_F(RoutingStandAloneTest, FUNC_SetupSingleClientHybridNetwork) {
   this->SetUpNetwork(kServerSize, 1);
 }
@@ -324,7 +331,9 @@ class ProportionedRoutingStandAloneTest : public GenericNetwork, public testing:
         old_closest_nodes_size_(Parameters::closest_nodes_size),
         old_max_client_routing_table_size_(Parameters::max_client_routing_table_size),
         old_max_route_history_(Parameters::max_route_history),
-        old_greedy_fraction_(Parameters::greedy_fraction) {
+        old_greedy_fraction_(Parameters::greedy_fraction),
+        old_removal_high_watermark_(Parameters::removal_high_watermark),
+        old_removal_low_watermark_(Parameters::removal_low_watermark) {
     // NB. relative calculations should match those in parameters.cc
     Parameters::max_routing_table_size = 32;
     Parameters::routing_table_size_threshold = Parameters::max_routing_table_size / 2;
@@ -333,6 +342,10 @@ class ProportionedRoutingStandAloneTest : public GenericNetwork, public testing:
     Parameters::max_client_routing_table_size = Parameters::max_routing_table_size;
     //    Parameters::max_route_history = 3;  // less than closest_nodes_size
     Parameters::greedy_fraction = Parameters::max_routing_table_size * 3 / 4;
+    Parameters::removal_high_watermark =
+        Parameters::greedy_fraction +
+        (Parameters::max_routing_table_size - Parameters::greedy_fraction) / 2;
+    Parameters::removal_low_watermark = Parameters::greedy_fraction;
   }
 
   virtual ~ProportionedRoutingStandAloneTest() {
@@ -343,6 +356,8 @@ class ProportionedRoutingStandAloneTest : public GenericNetwork, public testing:
     Parameters::max_client_routing_table_size = old_max_client_routing_table_size_;
     Parameters::max_route_history = old_max_route_history_;
     Parameters::greedy_fraction = old_greedy_fraction_;
+    Parameters::removal_high_watermark = old_removal_high_watermark_;
+    Parameters::removal_low_watermark = old_removal_low_watermark_;
   }
 
   virtual void SetUp() override { GenericNetwork::SetUp(); }
@@ -360,6 +375,8 @@ class ProportionedRoutingStandAloneTest : public GenericNetwork, public testing:
   uint16_t old_max_client_routing_table_size_;
   uint16_t old_max_route_history_;
   uint16_t old_greedy_fraction_;
+  uint16_t old_removal_high_watermark_;
+  uint16_t old_removal_low_watermark_;
 };
 
 // TODO(Alison) - Add ProportionedRoutingStandAloneTest involving clients
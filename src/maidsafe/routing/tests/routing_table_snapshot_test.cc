@@ -0,0 +1,91 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_table_snapshot.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(RoutingTableSnapshotTest, BEH_SerialiseParse) {
+  std::vector<SnapshotPeer> peers(3);
+  for (size_t i(0); i != peers.size(); ++i) {
+    peers[i].node.node_id = NodeId(NodeId::kRandomId);
+    peers[i].node.connection_id = NodeId(NodeId::kRandomId);
+  }
+  peers[0].node.nat_type = rudp::NatType::kSymmetric;
+  peers[1].node.nat_type = rudp::NatType::kOther;
+  peers[1].endpoint = boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 5483);
+
+  const asymm::Keys kKeys(asymm::GenerateKeyPair());
+  auto parsed(ParseRoutingTableSnapshot(SerialiseRoutingTableSnapshot(peers, kKeys.private_key),
+                                        kKeys.public_key));
+  ASSERT_EQ(peers.size(), parsed.size());
+  for (size_t i(0); i != peers.size(); ++i) {
+    EXPECT_EQ(peers[i].node.node_id, parsed[i].node.node_id);
+    EXPECT_EQ(peers[i].node.connection_id, parsed[i].node.connection_id);
+    EXPECT_EQ(peers[i].node.nat_type, parsed[i].node.nat_type);
+    EXPECT_EQ(peers[i].endpoint, parsed[i].endpoint);
+  }
+  EXPECT_TRUE(parsed[0].endpoint.address().is_unspecified());
+
+  EXPECT_TRUE(ParseRoutingTableSnapshot(SerialiseRoutingTableSnapshot(
+      std::vector<SnapshotPeer>(), kKeys.private_key), kKeys.public_key).empty());
+  EXPECT_THROW(ParseRoutingTableSnapshot(std::string("\xff\xff\xff"), kKeys.public_key),
+               std::exception);
+}
+
+TEST(RoutingTableSnapshotTest, BEH_OnlySignedEntriesTrusted) {
+  std::vector<SnapshotPeer> peers(2);
+  for (auto& peer : peers) {
+    peer.node.node_id = NodeId(NodeId::kRandomId);
+    peer.node.connection_id = NodeId(NodeId::kRandomId);
+  }
+  const asymm::Keys kKeys(asymm::GenerateKeyPair());
+  const std::string kSnapshot(SerialiseRoutingTableSnapshot(peers, kKeys.private_key));
+
+  // Another node's snapshot is of no use.
+  EXPECT_TRUE(ParseRoutingTableSnapshot(kSnapshot, asymm::GenerateKeyPair().public_key).empty());
+
+  // An entry whose key has been swapped for another since is skipped.
+  protobuf::RoutingTableSnapshot protobuf_snapshot;
+  ASSERT_TRUE(protobuf_snapshot.ParseFromString(kSnapshot));
+  protobuf_snapshot.mutable_peers(0)->set_node_id(NodeId(NodeId::kRandomId).string());
+  auto parsed(ParseRoutingTableSnapshot(protobuf_snapshot.SerializeAsString(), kKeys.public_key));
+  ASSERT_EQ(1U, parsed.size());
+  EXPECT_EQ(peers[1].node.node_id, parsed[0].node.node_id);
+
+  protobuf_snapshot.mutable_peers(1)->clear_signature();
+  EXPECT_TRUE(ParseRoutingTableSnapshot(protobuf_snapshot.SerializeAsString(),
+                                        kKeys.public_key).empty());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -16,8 +16,13 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
+#include <atomic>
 #include <bitset>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "maidsafe/common/log.h"
@@ -88,6 +93,108 @@ TEST(RoutingTableTest, FUNC_AddTooManyNodes) {
   EXPECT_EQ(routing_table.size(), Parameters::max_routing_table_size);
 }
 
+TEST(RoutingTableTest, BEH_EvictionBackoff) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  for (uint16_t i = 0; i < Parameters::closest_nodes_size; ++i)
+    EXPECT_TRUE(routing_table.AddNode(MakeNode()));
+
+  // The furthest and closest possible IDs
+  std::string far_id(node_id.string()), close_id(node_id.string());
+  for (auto& byte : far_id)
+    byte = static_cast<char>(~byte);
+  close_id.back() = static_cast<char>(close_id.back() ^ 1);
+  NodeInfo far_node, close_node;
+  far_node.node_id = NodeId(far_id);
+  close_node.node_id = NodeId(close_id);
+  EXPECT_TRUE(routing_table.CheckNode(far_node));
+  routing_table.RecordEviction(far_node.node_id);
+  routing_table.RecordEviction(close_node.node_id);
+  EXPECT_FALSE(routing_table.CheckNode(far_node));
+  // One of this node's closest is accepted regardless.
+  EXPECT_TRUE(routing_table.CheckNode(close_node));
+}
+
+TEST(RoutingTableTest, BEH_ProximityReplacement) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  routing_table.InitialiseFunctors([](const int&) {}, [](const NodeInfo&, bool) {}, []() {},
+                                   [](std::vector<NodeInfo>, std::vector<NodeInfo>) {},
+                                   [](std::shared_ptr<MatrixChange>) {});
+  // Every peer shares the furthest bucket, the candidate lying further out within it than the
+  // peers, so that only its latency can earn it a place.
+  const std::string kOwnId(node_id.string());
+  auto make_far_node([&](bool furthest) {
+    NodeInfo node(MakeNode());
+    std::string id(node.node_id.string());
+    id[0] = static_cast<char>(kOwnId[0] ^ (furthest ? 0xc0 : 0x80));
+    node.node_id = node.connection_id = NodeId(id);
+    return node;
+  });
+  while (routing_table.size() < Parameters::max_routing_table_size)
+    routing_table.AddNode(make_far_node(false));
+
+  auto close_ids(routing_table.GetClosestNodes(node_id, Parameters::closest_nodes_size));
+  NodeId slow_id;
+  for (const auto& peer_id : routing_table.GetClosestNodes(node_id, routing_table.kMaxSize())) {
+    bool close(std::find(close_ids.begin(), close_ids.end(), peer_id) != close_ids.end());
+    routing_table.RecordRoundTrip(peer_id, std::chrono::milliseconds(50));
+    if (!close && slow_id.IsZero()) {
+      slow_id = peer_id;
+      routing_table.RecordRoundTrip(peer_id, std::chrono::milliseconds(100000));
+    }
+  }
+  ASSERT_FALSE(slow_id.IsZero());
+  EXPECT_EQ(slow_id, routing_table.GetRemovableNode().node_id);
+
+  NodeInfo candidate(make_far_node(true));
+  EXPECT_FALSE(routing_table.CheckNode(candidate));
+  // Predicted to be as close as possible, the candidate replaces the slowest peer.
+  routing_table.RecordRoundTrip(candidate.node_id, std::chrono::milliseconds(-1),
+                                routing_table.network_coordinates().Local());
+  EXPECT_TRUE(routing_table.CheckNode(candidate));
+  EXPECT_TRUE(routing_table.AddNode(candidate));
+  EXPECT_TRUE(routing_table.Contains(candidate.node_id));
+  EXPECT_FALSE(routing_table.Contains(slow_id));
+  EXPECT_EQ(Parameters::max_routing_table_size, routing_table.size());
+}
+
+TEST(RoutingTableTest, BEH_LookaheadRouting) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  routing_table.InitialiseFunctors([](const int&) {}, [](const NodeInfo&, bool) {}, []() {},
+                                   [](std::vector<NodeInfo>, std::vector<NodeInfo>) {},
+                                   [](std::shared_ptr<MatrixChange>) {});
+  const std::string kOwnId(node_id.string());
+  auto make_node([&](unsigned char first_byte_distance) {
+    NodeInfo node(MakeNode());
+    std::string id(node.node_id.string());
+    id[0] = static_cast<char>(kOwnId[0] ^ first_byte_distance);
+    node.node_id = node.connection_id = NodeId(id);
+    return node;
+  });
+  std::string target(NodeId(NodeId::kRandomId).string());
+  target[0] = static_cast<char>(kOwnId[0] ^ 0xff);
+  const NodeId kTarget(target);
+  const NodeInfo kClosest(make_node(0xf0)), kNext(make_node(0xe0));
+  ASSERT_TRUE(routing_table.AddNode(kClosest));
+  ASSERT_TRUE(routing_table.AddNode(kNext));
+  EXPECT_EQ(kClosest.node_id,
+            routing_table.GetNodeForSendingMessage(kTarget, ExcludedNodes()).node_id);
+
+  // The next closest peer knows a node far closer to the target than the closest peer does.
+  routing_table.RecordTableSummary(kNext.node_id,
+                                   std::vector<uint64_t>(1, TableSummaries::Prefix(kTarget) ^ 1));
+  EXPECT_EQ(kNext.node_id,
+            routing_table.GetNodeForSendingMessage(kTarget, ExcludedNodes()).node_id);
+  const std::vector<std::string> kExcludedIds(1, kNext.node_id.string());
+  EXPECT_EQ(kClosest.node_id,
+            routing_table.GetNodeForSendingMessage(kTarget, ExcludedNodes(kExcludedIds)).node_id);
+}
+
 TEST(RoutingTableTest, BEH_PopulateAndDepopulateGroupCheckGroupChange) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -133,6 +240,46 @@ TEST(RoutingTableTest, BEH_PopulateAndDepopulateGroupCheckGroupChange) {
   EXPECT_EQ(0, routing_table.size());
 }
 
+TEST(RoutingTableTest, BEH_AddAndDropNodesInBatch) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  int matrix_change_count(0), group_change_count(0), status_count(0);
+  routing_table.InitialiseFunctors([&](const int&) { ++status_count; },
+                                   [](const NodeInfo&, bool) {}, []() {},
+                                   [&](std::vector<NodeInfo>, std::vector<NodeInfo>) {
+                                     ++group_change_count;
+                                   },
+                                   [&](std::shared_ptr<MatrixChange>) { ++matrix_change_count; });
+  std::vector<NodeInfo> nodes;
+  for (uint16_t i(0); i != 2 * Parameters::closest_nodes_size; ++i)
+    nodes.push_back(MakeNode());
+
+  EXPECT_EQ(nodes.size(), routing_table.AddNodes(nodes));
+  EXPECT_EQ(nodes.size(), routing_table.size());
+  EXPECT_EQ(0, routing_table.AddNodes(nodes));
+  EXPECT_EQ(1, matrix_change_count);
+  EXPECT_EQ(1, group_change_count);
+  EXPECT_EQ(1, status_count);
+
+  SortFromTarget(own_node_id, nodes);
+  std::vector<NodeId> close_nodes(
+      routing_table.GetClosestNodes(own_node_id, Parameters::closest_nodes_size));
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i)
+    EXPECT_EQ(nodes.at(i).node_id, close_nodes.at(i));
+
+  std::vector<NodeId> to_drop;
+  for (uint16_t i(0); i != Parameters::group_size; ++i)
+    to_drop.push_back(nodes.at(i).node_id);
+  EXPECT_EQ(to_drop.size(), routing_table.DropNodes(to_drop, true).size());
+  EXPECT_EQ(nodes.size() - to_drop.size(), routing_table.size());
+  EXPECT_EQ(2, matrix_change_count);
+  EXPECT_EQ(2, group_change_count);
+  EXPECT_EQ(2, status_count);
+  for (const auto& node_id : to_drop)
+    EXPECT_FALSE(routing_table.Contains(node_id));
+}
+
 TEST(RoutingTableTest, FUNC_OrderedGroupChange) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -257,6 +404,88 @@ TEST(RoutingTableTest, FUNC_ReverseOrderedGroupChange) {
   EXPECT_EQ(0, routing_table.group_matrix_.GetConnectedPeers().size());
 }
 
+TEST(RoutingTableTest, BEH_CoalesceGroupChanges) {
+  const std::chrono::milliseconds kOldSettleWindow(Parameters::group_change_settle_window);
+  Parameters::group_change_settle_window = std::chrono::milliseconds(500);
+  // The settle window runs on RoutingClock, so virtual time alone decides when it closes.
+  std::atomic<RoutingClock::rep> virtual_ticks(0);
+  RoutingClock::set_virtual_time([&virtual_ticks] {
+    return RoutingClock::time_point(RoutingClock::duration(virtual_ticks.load()));
+  });
+  {
+    NodeId node_id(NodeId::kRandomId);
+    NetworkStatistics network_statistics(node_id);
+    RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+    std::vector<NodeInfo> nodes;
+    for (uint16_t i(0); i < 2 * Parameters::closest_nodes_size; ++i)
+      nodes.push_back(MakeNode());
+    SortFromTarget(routing_table.kNodeId(), nodes);
+
+    std::atomic<int> group_change_count(0), matrix_change_count(0);
+    std::vector<NodeInfo> last_new_nodes;
+    std::mutex mutex;
+    routing_table.InitialiseFunctors([](const int&) {}, [](const NodeInfo&, bool) {}, []() {},
+                                     [&](std::vector<NodeInfo> new_nodes, std::vector<NodeInfo>) {
+                                       std::lock_guard<std::mutex> lock(mutex);
+                                       last_new_nodes = new_nodes;
+                                       ++group_change_count;
+                                     },
+                                     [&](std::shared_ptr<MatrixChange>) { ++matrix_change_count; });
+
+    auto advance_virtual_time([&virtual_ticks](std::chrono::milliseconds duration) {
+      virtual_ticks += std::chrono::duration_cast<RoutingClock::duration>(duration).count();
+    });
+    // Waits in real time for the notifier thread to catch up with the virtual clock.
+    auto wait_for_count([](const std::atomic<int>& count, int expected) {
+      for (int i(0); i != 500 && count != expected; ++i)
+        Sleep(std::chrono::milliseconds(10));
+    });
+
+    // Changes in the size of the close group are passed on immediately ...
+    for (auto ritr(nodes.rbegin()); ritr != nodes.rbegin() + Parameters::closest_nodes_size; ++ritr)
+      ASSERT_TRUE(routing_table.AddNode(*ritr));
+    EXPECT_EQ(Parameters::closest_nodes_size, group_change_count);
+    // ... while matrix changes are held back until the window has passed on RoutingClock, however
+    // long they wait in real time.  Rows are given to the close peers so that the furthest can be
+    // pruned as closer ones are added below.
+    int matrix_changes_before_rows(matrix_change_count);
+    for (auto ritr(nodes.rbegin()); ritr != nodes.rbegin() + Parameters::closest_nodes_size; ++ritr) {
+      routing_table.GroupUpdateFromConnectedPeer(ritr->node_id,
+                                                 std::vector<NodeInfo>(1, MakeNode()));
+    }
+    Sleep(std::chrono::milliseconds(100));
+    EXPECT_EQ(matrix_changes_before_rows, matrix_change_count);
+    advance_virtual_time(Parameters::group_change_settle_window);
+    wait_for_count(matrix_change_count, matrix_changes_before_rows + 1);
+    EXPECT_EQ(matrix_changes_before_rows + 1, matrix_change_count);
+    EXPECT_EQ(Parameters::closest_nodes_size, group_change_count);
+
+    // Replacements within a full close group are merged into one notification of the net change.
+    int matrix_changes_before_replacements(matrix_change_count);
+    for (auto ritr(nodes.rbegin() + Parameters::closest_nodes_size); ritr != nodes.rend(); ++ritr)
+      ASSERT_TRUE(routing_table.AddNode(*ritr));
+    Sleep(std::chrono::milliseconds(100));
+    EXPECT_EQ(Parameters::closest_nodes_size, group_change_count);
+    advance_virtual_time(Parameters::group_change_settle_window - std::chrono::milliseconds(1));
+    Sleep(std::chrono::milliseconds(100));
+    EXPECT_EQ(Parameters::closest_nodes_size, group_change_count);
+    EXPECT_EQ(matrix_changes_before_replacements, matrix_change_count);
+
+    advance_virtual_time(std::chrono::milliseconds(1));
+    wait_for_count(group_change_count, Parameters::closest_nodes_size + 1);
+    EXPECT_EQ(Parameters::closest_nodes_size + 1, group_change_count);
+    wait_for_count(matrix_change_count, matrix_changes_before_replacements + 1);
+    EXPECT_EQ(matrix_changes_before_replacements + 1, matrix_change_count);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(Parameters::closest_nodes_size, last_new_nodes.size());
+    for (uint16_t i(0); i < Parameters::closest_nodes_size; ++i)
+      EXPECT_EQ(nodes.at(i).node_id, last_new_nodes.at(i).node_id);
+  }
+  RoutingClock::set_virtual_time(RoutingClock::TimeSource());
+  Parameters::group_change_settle_window = kOldSettleWindow;
+}
+
 TEST(RoutingTableTest, FUNC_CheckGroupChangeRemoveNodesFromGroup) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -772,6 +1001,64 @@ TEST(RoutingTableTest, BEH_GetNthClosest) {
   }
 }
 
+TEST(RoutingTableTest, BEH_GetClosestNodes) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  std::vector<NodeInfo> known_nodes;
+  while (routing_table.size() < 2 * Parameters::closest_nodes_size) {
+    NodeInfo node(MakeNode());
+    known_nodes.push_back(node);
+    EXPECT_TRUE(routing_table.AddNode(node));
+  }
+
+  std::vector<NodeId> targets(1, own_node_id);
+  for (const auto& node : known_nodes)
+    targets.push_back(node.node_id);
+  for (int i(0); i != 20; ++i)
+    targets.push_back(NodeId(NodeId::kRandomId));
+
+  for (const auto& target : targets) {
+    SortFromTarget(target, known_nodes);
+    std::vector<NodeId> closest(
+        routing_table.GetClosestNodes(target, Parameters::closest_nodes_size));
+    ASSERT_EQ(Parameters::closest_nodes_size, closest.size());
+    for (uint16_t index(0); index != Parameters::closest_nodes_size; ++index)
+      EXPECT_EQ(known_nodes[index].node_id, closest[index]);
+    EXPECT_EQ(known_nodes.front().node_id, routing_table.GetClosestNode(target).node_id);
+  }
+}
+
+TEST(RoutingTableTest, BEH_VisitClosestNodes) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  for (size_t index(0); index < Parameters::closest_nodes_size; ++index)
+    EXPECT_TRUE(routing_table.AddNode(MakeNode()));
+  const NodeId kTarget(NodeId::kRandomId);
+  std::vector<NodeId> visited;
+  routing_table.VisitClosestNodes(kTarget, Parameters::group_size, [&](const NodeInfo& node) {
+    visited.push_back(node.node_id);
+    return true;
+  });
+  EXPECT_EQ(routing_table.GetClosestNodes(kTarget, Parameters::group_size), visited);
+
+  // Visiting stops as soon as the visitor returns false.
+  visited.clear();
+  routing_table.VisitClosestNodes(kTarget, Parameters::group_size, [&](const NodeInfo& node) {
+    visited.push_back(node.node_id);
+    return false;
+  });
+  EXPECT_EQ(1U, visited.size());
+
+  std::vector<NodeInfo> matrix_nodes;
+  routing_table.VisitMatrixNodes([&](const NodeInfo& node) {
+    matrix_nodes.push_back(node);
+    return true;
+  });
+  EXPECT_EQ(routing_table.GetMatrixNodes().size(), matrix_nodes.size());
+}
+
 TEST(RoutingTableTest, FUNC_GetClosestNodeWithExclusion) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -1187,6 +1474,87 @@ TEST(RoutingTableTest, FUNC_IsNodeIdInGroupRange) {
   }
 }
 
+TEST(RoutingTableTest, BEH_GroupRangeView) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  EXPECT_EQ(GroupRangeStatus::kInRange,
+            routing_table.GetGroupRangeView().IsNodeIdInGroupRange(NodeId(NodeId::kRandomId)));
+
+  std::vector<NodeId> node_ids;
+  while (routing_table.size() < Parameters::max_routing_table_size) {
+    NodeInfo node_info(MakeNode());
+    node_ids.push_back(node_info.node_id);
+    EXPECT_TRUE(routing_table.AddNode(node_info));
+  }
+  std::vector<NodeId> unique_node_ids(routing_table.group_matrix_.GetUniqueNodeIds());
+  GroupRangeView group_range_view(routing_table.GetGroupRangeView());
+  for (uint16_t i(0); i < 200; ++i) {
+    NodeId group_id(i % 4 == 0 ? node_ids.at(RandomUint32() % node_ids.size())
+                               : NodeId(NodeId::kRandomId));
+    EXPECT_EQ(routing_table.IsNodeIdInGroupRange(group_id),
+              group_range_view.IsNodeIdInGroupRange(group_id));
+    NodeId node_id(unique_node_ids.at(RandomUint32() % unique_node_ids.size()));
+    if (routing_table.IsNodeIdInGroupRange(group_id) == GroupRangeStatus::kInRange) {
+      EXPECT_EQ(routing_table.IsNodeIdInGroupRange(group_id, node_id),
+                group_range_view.IsNodeIdInGroupRange(group_id, node_id));
+    } else if (group_id != node_id) {
+      EXPECT_THROW(group_range_view.IsNodeIdInGroupRange(group_id, node_id), maidsafe_error);
+    }
+    EXPECT_EQ(network_statistics.EstimateInGroup(node_id, group_id),
+              group_range_view.EstimateInGroup(node_id, group_id));
+  }
+}
+
+TEST(RoutingTableTest, BEH_ResponsibilityRanges) {
+  NodeId own_node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(own_node_id);
+  RoutingTable routing_table(false, own_node_id, asymm::GenerateKeyPair(), network_statistics);
+  ResponsibilityRanges ranges(routing_table.GetGroupRangeView().GetResponsibilityRanges());
+  ASSERT_EQ(1U, ranges.in_range.size());
+  EXPECT_EQ(KeyRange(NodeId(), NodeId(NodeId::kMaxId)), ranges.in_range.front());
+  EXPECT_TRUE(ranges.proximal.empty());
+
+  routing_table.InitialiseFunctors([](const int&) {}, [](const NodeInfo&, bool) {}, []() {},
+                                   [](std::vector<NodeInfo>, std::vector<NodeInfo>) {},
+                                   [](std::shared_ptr<MatrixChange>) {});
+  while (routing_table.size() < Parameters::max_routing_table_size)
+    EXPECT_TRUE(routing_table.AddNode(MakeNode()));
+  GroupRangeView group_range_view(routing_table.GetGroupRangeView());
+  ResponsibilityRanges previous(ranges);
+  ranges = group_range_view.GetResponsibilityRanges();
+  EXPECT_FALSE(ranges.in_range.empty());
+  auto status_of([&ranges](const NodeId & group_id) {
+    for (const auto& range : ranges.in_range) {
+      if (!(group_id < range.first) && !(range.last < group_id))
+        return GroupRangeStatus::kInRange;
+    }
+    for (const auto& range : ranges.proximal) {
+      if (!(group_id < range.first) && !(range.last < group_id))
+        return GroupRangeStatus::kInProximalRange;
+    }
+    return GroupRangeStatus::kOutwithRange;
+  });
+  for (uint16_t i(0); i < 1000; ++i) {
+    // Half of the IDs are near this node, where the ranges' boundaries lie.
+    std::string raw(NodeId(NodeId::kRandomId).string());
+    if (i % 2 == 0)
+      raw.replace(0, 2, own_node_id.string().substr(0, 2));
+    const NodeId kGroupId(raw);
+    EXPECT_EQ(group_range_view.IsNodeIdInGroupRange(kGroupId), status_of(kGroupId));
+  }
+
+  SetRangeChanges(previous, ranges);
+  EXPECT_TRUE(ranges.gained.empty());
+  EXPECT_FALSE(ranges.lost.empty());
+  std::vector<KeyRange> covered(ranges.in_range);
+  covered.insert(covered.end(), ranges.proximal.begin(), ranges.proximal.end());
+  covered.insert(covered.end(), ranges.lost.begin(), ranges.lost.end());
+  covered = MergeRanges(covered);
+  ASSERT_EQ(1U, covered.size());
+  EXPECT_EQ(KeyRange(NodeId(), NodeId(NodeId::kMaxId)), covered.front());
+}
+
 TEST(RoutingTableTest, BEH_MatrixChange) {
   NodeId node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(node_id);
@@ -1225,6 +1593,32 @@ TEST(RoutingTableTest, BEH_MatrixChange) {
   EXPECT_EQ(count, Parameters::closest_nodes_size + 2);
 }
 
+TEST(RoutingTableTest, BEH_GetGroupMemo) {
+  NodeId node_id(NodeId::kRandomId);
+  NetworkStatistics network_statistics(node_id);
+  RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+  for (size_t index(0); index < Parameters::closest_nodes_size; ++index)
+    EXPECT_TRUE(routing_table.AddNode(MakeNode()));
+  const NodeId kTarget(NodeId::kRandomId);
+  auto group(routing_table.GetGroup(kTarget));
+  ASSERT_EQ(Parameters::group_size, group.size());
+  EXPECT_EQ(group, routing_table.GetGroup(kTarget));
+
+  // Losing a member invalidates the memoised answer.
+  const NodeId kLost(group.front() == node_id ? group.back() : group.front());
+  routing_table.DropNode(kLost, true);
+  group = routing_table.GetGroup(kTarget);
+  EXPECT_TRUE(std::find(group.begin(), group.end(), kLost) == group.end());
+
+  // As does gaining a closer node.
+  NodeInfo closer(MakeNode());
+  closer.node_id = kTarget;
+  EXPECT_TRUE(routing_table.AddNode(closer));
+  group = routing_table.GetGroup(kTarget);
+  ASSERT_FALSE(group.empty());
+  EXPECT_EQ(kTarget, group.front());
+}
+
 TEST(RoutingTableTest, FUNC_ClosestToId) {
   NodeId own_node_id(NodeId::kRandomId);
   NetworkStatistics network_statistics(own_node_id);
@@ -193,6 +193,52 @@ TEST(RpcsTest, BEH_FindNodesMessageNodeRelayMode) {
   ASSERT_FALSE(node.IsZero());
 }
 
+TEST(RpcsTest, BEH_ClosestNodesUpdateDeltaMessage) {
+  NodeInfo us(MakeNode()), them(MakeNode()), added(MakeNode()), removed(MakeNode());
+  protobuf::Message message = rpcs::ClosestNodesUpdateDelta(
+      them.node_id, us.node_id, std::vector<NodeInfo>(1, added),
+      std::vector<NodeId>(1, removed.node_id), 7);
+  ASSERT_TRUE(message.IsInitialized());
+  protobuf::ClosestNodesUpdate closest_nodes_update;
+  EXPECT_TRUE(closest_nodes_update.ParseFromString(message.data(0)));
+  EXPECT_EQ(us.node_id.string(), closest_nodes_update.node());
+  EXPECT_TRUE(closest_nodes_update.delta());
+  EXPECT_EQ(7U, closest_nodes_update.sequence());
+  ASSERT_EQ(1, closest_nodes_update.nodes_info_size());
+  EXPECT_EQ(added.node_id.string(), closest_nodes_update.nodes_info(0).node_id());
+  ASSERT_EQ(1, closest_nodes_update.removed_nodes_size());
+  EXPECT_EQ(removed.node_id.string(), closest_nodes_update.removed_nodes(0));
+  EXPECT_FALSE(closest_nodes_update.request_full_state());
+  EXPECT_EQ(them.node_id.string(), message.destination_id());
+  EXPECT_EQ(static_cast<int32_t>(MessageType::kClosestNodesUpdate), message.type());
+
+  message = rpcs::ClosestNodesUpdateFullStateRequest(them.node_id, us.node_id);
+  ASSERT_TRUE(message.IsInitialized());
+  EXPECT_TRUE(closest_nodes_update.ParseFromString(message.data(0)));
+  EXPECT_TRUE(closest_nodes_update.request_full_state());
+  EXPECT_FALSE(closest_nodes_update.delta());
+  EXPECT_EQ(0, closest_nodes_update.nodes_info_size());
+}
+
+TEST(RpcsTest, BEH_LeaveMessage) {
+  NodeInfo us(MakeNode()), them(MakeNode()), other(MakeNode());
+  std::vector<NodeId> replacement_ids;
+  replacement_ids.push_back(them.node_id);
+  replacement_ids.push_back(other.node_id);
+  protobuf::Message message = rpcs::Leave(them.node_id, us.node_id, replacement_ids, false);
+  ASSERT_TRUE(message.IsInitialized());
+  EXPECT_EQ(static_cast<int32_t>(MessageType::kLeave), message.type());
+  EXPECT_EQ(them.node_id.string(), message.destination_id());
+  EXPECT_EQ(us.node_id.string(), message.source_id());
+  EXPECT_TRUE(message.direct());
+  EXPECT_TRUE(message.one_way());
+  protobuf::LeaveRequest leave_request;
+  ASSERT_TRUE(leave_request.ParseFromString(message.data(0)));
+  // The recipient isn't suggested as its own replacement.
+  ASSERT_EQ(1, leave_request.replacement_ids_size());
+  EXPECT_EQ(other.node_id.string(), leave_request.replacement_ids(0));
+}
+
 }  // namespace test
 
 }  // namespace routing
@@ -16,6 +16,8 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -31,8 +33,10 @@
 #include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_clock.h"
 #include "maidsafe/routing/rpcs.h"
 #include "maidsafe/routing/service.h"
+#include "maidsafe/routing/tests/mock_network_utils.h"
 #include "maidsafe/routing/tests/test_utils.h"
 
 namespace maidsafe {
@@ -45,6 +49,13 @@ namespace {
 
 typedef boost::asio::ip::udp::endpoint Endpoint;
 
+protobuf::ConnectResponseType ConnectAnswer(const protobuf::Message& message) {
+  protobuf::ConnectResponse connect_response;
+  EXPECT_EQ(1, message.data_size());
+  EXPECT_TRUE(connect_response.ParseFromString(message.data(0)));
+  return connect_response.answer();
+}
+
 }  // unnamed namespace
 
 TEST(ServicesTest, BEH_Ping) {
@@ -53,7 +64,7 @@ TEST(ServicesTest, BEH_Ping) {
   RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   GroupChangeHandler group_change_handler(routing_table, client_routing_table, network);
   Service service(routing_table, client_routing_table, network);
   NodeInfo node;
@@ -85,7 +96,7 @@ TEST(ServicesTest, BEH_FindNodes) {
   NodeId this_node_id(routing_table.kNodeId());
   ClientRoutingTable client_routing_table(routing_table.kNodeId());
   AsioService asio_service(1);
-  NetworkUtils network(routing_table, client_routing_table);
+  NetworkUtils network(routing_table, client_routing_table, asio_service);
   GroupChangeHandler group_change_handler(routing_table, client_routing_table, network);
   Service service(routing_table, client_routing_table, network);
   protobuf::Message message = rpcs::FindNodes(this_node_id, this_node_id, 8);
@@ -109,6 +120,88 @@ TEST(ServicesTest, BEH_FindNodes) {
   // EXPECT_FALSE(message.has_relay());
 }
 
+TEST(ServicesTest, BEH_QueuedConnects) {
+  const uint16_t kOldMaxAttempts(Parameters::max_concurrent_connect_attempts),
+      kOldMaxQueued(Parameters::max_queued_connect_requests);
+  const std::chrono::seconds kOldTimeout(Parameters::connect_attempt_timeout);
+  Parameters::max_concurrent_connect_attempts = 1;
+  Parameters::max_queued_connect_requests = 2;
+  Parameters::connect_attempt_timeout = std::chrono::seconds(10);
+  std::atomic<RoutingClock::rep> virtual_ticks(0);
+  RoutingClock::set_virtual_time([&virtual_ticks] {
+    return RoutingClock::time_point(RoutingClock::duration(virtual_ticks.load()));
+  });
+  {
+    NodeId node_id(NodeId::kRandomId);
+    NetworkStatistics network_statistics(node_id);
+    RoutingTable routing_table(false, node_id, asymm::GenerateKeyPair(), network_statistics);
+    ClientRoutingTable client_routing_table(routing_table.kNodeId());
+    AsioService asio_service(1);
+    MockNetworkUtils network(routing_table, client_routing_table, asio_service);
+    Service service(routing_table, client_routing_table, network);
+    std::vector<std::function<void()>> posted;
+    service.set_post_functor([&posted](const std::function<void()>& handler) {
+      posted.push_back(handler);
+    });
+    rudp::EndpointPair endpoints;
+    endpoints.local = endpoints.external = Endpoint(GetLocalIp(), maidsafe::test::GetRandomPort());
+    EXPECT_CALL(network, GetAvailableEndpoint(testing::_, testing::_, testing::_, testing::_))
+        .WillRepeatedly(testing::DoAll(testing::SetArgReferee<2>(endpoints),
+                                       testing::Return(rudp::kSuccess)));
+    EXPECT_CALL(network, Add(testing::_, testing::_, testing::_))
+        .WillRepeatedly(testing::Return(rudp::kSuccess));
+    std::vector<protobuf::Message> sent;
+    EXPECT_CALL(network, SendToDirect(testing::_, testing::_, testing::_))
+        .WillRepeatedly(testing::Invoke([&sent](const protobuf::Message& message, const NodeId&,
+                                                const NodeId&) { sent.push_back(message); }));
+    auto connect_from([&](const NodeId& peer_id) {
+      return rpcs::Connect(routing_table.kNodeId(), endpoints, peer_id, peer_id);
+    });
+    const NodeId kRunning(NodeId::kRandomId), kWaiting(NodeId::kRandomId),
+        kAbandoned(NodeId::kRandomId);
+
+    auto message(connect_from(kRunning));
+    service.Connect(message);
+    EXPECT_EQ(protobuf::ConnectResponseType::kAccepted, ConnectAnswer(message));
+    message = connect_from(kWaiting);
+    service.Connect(message);
+    EXPECT_FALSE(message.IsInitialized());
+
+    // The queued request is answered once the running attempt ends, but not inside the caller.
+    service.EndConnectAttempt(kRunning);
+    EXPECT_TRUE(sent.empty());
+    ASSERT_EQ(1U, posted.size());
+    posted.front()();
+    posted.clear();
+    ASSERT_EQ(1U, sent.size());
+    EXPECT_EQ(kWaiting.string(), sent.front().destination_id());
+    EXPECT_EQ(protobuf::ConnectResponseType::kAccepted, ConnectAnswer(sent.front()));
+    sent.clear();
+
+    // A request left queued past the timeout is refused rather than dropped.
+    message = connect_from(kAbandoned);
+    service.Connect(message);
+    EXPECT_FALSE(message.IsInitialized());
+    virtual_ticks += std::chrono::duration_cast<RoutingClock::duration>(
+                         Parameters::connect_attempt_timeout).count();
+    const NodeId kLate(NodeId::kRandomId);
+    message = connect_from(kLate);
+    service.Connect(message);
+    EXPECT_FALSE(message.IsInitialized());
+    ASSERT_EQ(1U, posted.size());
+    posted.front()();
+    ASSERT_EQ(2U, sent.size());
+    EXPECT_EQ(kLate.string(), sent[0].destination_id());
+    EXPECT_EQ(protobuf::ConnectResponseType::kAccepted, ConnectAnswer(sent[0]));
+    EXPECT_EQ(kAbandoned.string(), sent[1].destination_id());
+    EXPECT_EQ(protobuf::ConnectResponseType::kRejected, ConnectAnswer(sent[1]));
+  }
+  RoutingClock::set_virtual_time(RoutingClock::TimeSource());
+  Parameters::max_concurrent_connect_attempts = kOldMaxAttempts;
+  Parameters::max_queued_connect_requests = kOldMaxQueued;
+  Parameters::connect_attempt_timeout = kOldTimeout;
+}
+
 // TEST(ServicesTest, BEH_ProxyConnect) {
 //   asymm::Keys my_keys;
 //   my_keys.identity = RandomString(64);
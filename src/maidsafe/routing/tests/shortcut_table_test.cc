@@ -0,0 +1,141 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/shortcut_table.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+NodeInfo MakePeer() {
+  NodeInfo peer;
+  peer.node_id = NodeId(NodeId::kRandomId);
+  peer.connection_id = NodeId(NodeId::kRandomId);
+  return peer;
+}
+
+}  // unnamed namespace
+
+TEST(ShortcutTableTest, BEH_HeavyFlowAsksForOneShortcut) {
+  const auto kStart(std::chrono::steady_clock::now());
+  ShortcutTable shortcuts(2, 3, std::chrono::seconds(10));
+  const NodeInfo kPeer(MakePeer());
+  EXPECT_FALSE(shortcuts.RecordSend(kPeer.node_id, kStart));
+  EXPECT_FALSE(shortcuts.RecordSend(kPeer.node_id, kStart));
+  EXPECT_TRUE(shortcuts.RecordSend(kPeer.node_id, kStart + std::chrono::seconds(1)));
+  // Asked for once while the attempt is pending.
+  EXPECT_FALSE(shortcuts.RecordSend(kPeer.node_id, kStart + std::chrono::seconds(1)));
+  EXPECT_EQ(NodeId(), shortcuts.Get(kPeer.node_id, kStart).node_id);
+
+  EXPECT_TRUE(shortcuts.Add(kPeer, kStart + std::chrono::seconds(2)));
+  EXPECT_EQ(1U, shortcuts.size());
+  EXPECT_EQ(kPeer.connection_id, shortcuts.Get(kPeer.node_id, kStart).connection_id);
+  EXPECT_TRUE(shortcuts.Contains(kPeer.connection_id));
+  EXPECT_FALSE(shortcuts.RecordSend(kPeer.node_id, kStart + std::chrono::seconds(2)));
+  EXPECT_TRUE(shortcuts.Remove(kPeer.connection_id));
+  EXPECT_FALSE(shortcuts.Remove(kPeer.connection_id));
+  EXPECT_EQ(0U, shortcuts.size());
+}
+
+TEST(ShortcutTableTest, BEH_CountsWithinWindow) {
+  const auto kStart(std::chrono::steady_clock::now());
+  ShortcutTable shortcuts(2, 2, std::chrono::seconds(10));
+  const NodeId kDestination(NodeId::kRandomId);
+  EXPECT_FALSE(shortcuts.RecordSend(kDestination, kStart));
+  // The first message's window has ended, so the count starts again.
+  EXPECT_FALSE(shortcuts.RecordSend(kDestination, kStart + std::chrono::seconds(10)));
+  EXPECT_TRUE(shortcuts.RecordSend(kDestination, kStart + std::chrono::seconds(11)));
+  // An abandoned attempt leaves the destination to be counted afresh.
+  shortcuts.Abandon(kDestination);
+  EXPECT_FALSE(shortcuts.RecordSend(kDestination, kStart + std::chrono::seconds(12)));
+  EXPECT_TRUE(shortcuts.RecordSend(kDestination, kStart + std::chrono::seconds(12)));
+}
+
+TEST(ShortcutTableTest, BEH_ReceiptKeepsShortcut) {
+  const auto kStart(std::chrono::steady_clock::now());
+  ShortcutTable shortcuts(2, 1, std::chrono::seconds(10));
+  const NodeInfo kPeer(MakePeer());
+  EXPECT_TRUE(shortcuts.RecordSend(kPeer.node_id, kStart));
+  EXPECT_TRUE(shortcuts.Add(kPeer, kStart));
+  // Only ever received from, it's still in use.
+  shortcuts.MarkUsed(kPeer.node_id, kStart + std::chrono::seconds(20));
+  shortcuts.MarkUsed(NodeId(NodeId::kRandomId), kStart + std::chrono::seconds(20));
+  EXPECT_TRUE(shortcuts.TakeIdle(std::chrono::seconds(30), kStart + std::chrono::seconds(40))
+                  .empty());
+  auto idle(shortcuts.TakeIdle(std::chrono::seconds(30), kStart + std::chrono::seconds(50)));
+  ASSERT_EQ(1U, idle.size());
+  EXPECT_EQ(kPeer.connection_id, idle.front().connection_id);
+}
+
+TEST(ShortcutTableTest, BEH_HoldsNoMoreThanMax) {
+  const auto kStart(std::chrono::steady_clock::now());
+  ShortcutTable shortcuts(2, 1, std::chrono::seconds(10));
+  const NodeInfo kFirst(MakePeer()), kSecond(MakePeer()), kThird(MakePeer());
+  EXPECT_TRUE(shortcuts.RecordSend(kFirst.node_id, kStart));
+  EXPECT_TRUE(shortcuts.Admits(kSecond.node_id));
+  EXPECT_TRUE(shortcuts.Add(kSecond, kStart));
+  // A pending attempt holds its room.
+  EXPECT_FALSE(shortcuts.Admits(kThird.node_id));
+  EXPECT_FALSE(shortcuts.RecordSend(kThird.node_id, kStart));
+  EXPECT_FALSE(shortcuts.Add(kThird, kStart));
+  EXPECT_TRUE(shortcuts.Add(kFirst, kStart));
+  EXPECT_EQ(2U, shortcuts.size());
+  EXPECT_FALSE(shortcuts.Add(kThird, kStart));
+
+  ShortcutTable disabled(2, 0, std::chrono::seconds(10));
+  EXPECT_FALSE(disabled.RecordSend(kFirst.node_id, kStart));
+  EXPECT_FALSE(disabled.Admits(kFirst.node_id));
+}
+
+TEST(ShortcutTableTest, BEH_TakesIdleShortcutsAndStaleAttempts) {
+  const auto kStart(std::chrono::steady_clock::now());
+  const std::chrono::seconds kIdleTime(30);
+  ShortcutTable shortcuts(2, 1, std::chrono::seconds(10));
+  const NodeInfo kBusy(MakePeer()), kIdle(MakePeer()), kUnanswered(MakePeer());
+  EXPECT_TRUE(shortcuts.Add(kBusy, kStart));
+  EXPECT_TRUE(shortcuts.Add(kIdle, kStart));
+  EXPECT_FALSE(shortcuts.RecordSend(kUnanswered.node_id, kStart));
+  shortcuts.Get(kBusy.node_id, kStart + std::chrono::seconds(20));
+  auto idle(shortcuts.TakeIdle(kIdleTime, kStart + kIdleTime));
+  ASSERT_EQ(1U, idle.size());
+  EXPECT_EQ(kIdle.node_id, idle.front().node_id);
+  EXPECT_EQ(1U, shortcuts.size());
+
+  EXPECT_TRUE(shortcuts.RecordSend(kUnanswered.node_id, kStart + kIdleTime));
+  const auto kLater(kStart + std::chrono::seconds(59));
+  EXPECT_EQ(1U, shortcuts.TakeIdle(kIdleTime, kLater).size());
+  EXPECT_FALSE(shortcuts.RecordSend(kUnanswered.node_id, kLater));
+  // The attempt, unanswered for the idle time, is given up so that it can be made again.
+  EXPECT_TRUE(shortcuts.TakeIdle(kIdleTime, kLater + std::chrono::seconds(1)).empty());
+  EXPECT_TRUE(shortcuts.RecordSend(kUnanswered.node_id, kLater + std::chrono::seconds(1)));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
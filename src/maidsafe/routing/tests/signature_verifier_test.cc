@@ -0,0 +1,88 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/signature_verifier.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(SignatureVerifierTest, BEH_VerifyInOrder) {
+  const int kCount(100);
+  asymm::Keys keys(asymm::GenerateKeyPair());
+  SignatureVerifier verifier(3, 4, 16);
+
+  std::mutex mutex;
+  std::vector<std::pair<int, bool>> results;
+  std::promise<void> done_promise;
+  for (int i(0); i != kCount; ++i) {
+    const std::string kData("data " + std::to_string(i));
+    std::string signature(asymm::Sign(asymm::PlainText(kData), keys.private_key).string());
+    // Every third message is tampered with.
+    verifier.Verify(i % 3 == 0 ? kData + "!" : kData, signature, keys.public_key,
+                    [&, i](bool valid) {
+                      std::lock_guard<std::mutex> lock(mutex);
+                      results.push_back(std::make_pair(i, valid));
+                      if (static_cast<int>(results.size()) == kCount + 1)
+                        done_promise.set_value();
+                    });
+  }
+  // A repeat of an earlier valid message is answered from the cache.
+  const std::string kRepeated("data 1");
+  verifier.Verify(kRepeated, asymm::Sign(asymm::PlainText(kRepeated), keys.private_key).string(),
+                  keys.public_key, [&](bool valid) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results.push_back(std::make_pair(kCount, valid));
+                    done_promise.set_value();
+                  });
+  ASSERT_EQ(std::future_status::ready,
+            done_promise.get_future().wait_for(std::chrono::seconds(30)));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(kCount + 1, static_cast<int>(results.size()));
+  for (int i(0); i != kCount; ++i) {
+    EXPECT_EQ(i, results[i].first);
+    EXPECT_EQ(i % 3 != 0, results[i].second) << i;
+  }
+  EXPECT_TRUE(results.back().second);
+}
+
+TEST(SignatureVerifierTest, BEH_StopDiscardsResults) {
+  asymm::Keys keys(asymm::GenerateKeyPair());
+  SignatureVerifier verifier(1, 1, 0);
+  verifier.Stop();
+  bool called(false);
+  verifier.Verify("data", "signature", keys.public_key, [&](bool) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
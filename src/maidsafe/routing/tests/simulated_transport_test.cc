@@ -0,0 +1,225 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/rudp/return_codes.h"
+
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/routing_clock.h"
+#include "maidsafe/routing/simulated_transport.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+struct SimulatedPeer {
+  explicit SimulatedPeer(SimulatedNetwork& network)
+      : node_id(NodeId::kRandomId), transport(network.CreateTransport()), received(), lost() {}
+
+  int Bootstrap(const SimulatedPeer& peer, NodeId& chosen) {
+    rudp::NatType nat_type;
+    return transport->Bootstrap(
+        std::vector<boost::asio::ip::udp::endpoint>(1, peer.transport->endpoint()),
+        [this](const std::string& message) { received.push_back(message); },
+        [this](const NodeId& peer_id) { lost.push_back(peer_id); }, node_id,
+        std::shared_ptr<asymm::PrivateKey>(), std::shared_ptr<asymm::PublicKey>(), chosen,
+        nat_type, boost::asio::ip::udp::endpoint());
+  }
+
+  rudp::EndpointPair endpoint_pair() const {
+    rudp::EndpointPair endpoint_pair;
+    endpoint_pair.local = endpoint_pair.external = transport->endpoint();
+    return endpoint_pair;
+  }
+
+  NodeId node_id;
+  std::unique_ptr<SimulatedTransport> transport;
+  std::vector<std::string> received;
+  std::vector<NodeId> lost;
+};
+
+SimulatedNetworkConfig FixedLatency(std::chrono::milliseconds latency) {
+  SimulatedNetworkConfig config;
+  config.latency = latency;
+  config.jitter = std::chrono::microseconds(0);
+  return config;
+}
+
+}  // unnamed namespace
+
+TEST(SimulatedTransportTest, BEH_ConnectSendAndRemove) {
+  SimulatedNetwork network(FixedLatency(std::chrono::milliseconds(10)));
+  SimulatedPeer bootstrap(network), joiner(network), other(network);
+  NodeId chosen;
+  EXPECT_EQ(kNoOnlineBootstrapContacts, bootstrap.Bootstrap(bootstrap, chosen));
+  EXPECT_EQ(kSuccess, joiner.Bootstrap(bootstrap, chosen));
+  EXPECT_EQ(bootstrap.node_id, chosen);
+
+  rudp::EndpointPair this_endpoint_pair;
+  rudp::NatType nat_type;
+  EXPECT_EQ(rudp::kBootstrapConnectionAlreadyExists,
+            joiner.transport->GetAvailableEndpoint(bootstrap.node_id, bootstrap.endpoint_pair(),
+                                                   this_endpoint_pair, nat_type));
+  EXPECT_EQ(joiner.transport->endpoint(), this_endpoint_pair.external);
+
+  // Messages arrive after the link's latency, in the order they were sent.
+  std::vector<int> results;
+  auto record_result([&](int result) { results.push_back(result); });
+  joiner.transport->Send(bootstrap.node_id, "first", record_result);
+  joiner.transport->Send(bootstrap.node_id, "second", record_result);
+  network.AdvanceBy(std::chrono::milliseconds(5));
+  EXPECT_TRUE(bootstrap.received.empty());
+  network.AdvanceBy(std::chrono::milliseconds(10));
+  ASSERT_EQ(2U, bootstrap.received.size());
+  EXPECT_EQ("first", bootstrap.received.front());
+  EXPECT_EQ("second", bootstrap.received.back());
+  network.AdvanceBy(std::chrono::milliseconds(10));
+  EXPECT_EQ(std::vector<int>(2, rudp::kSuccess), results);
+
+  // There's no connection to a peer which hasn't been added.
+  other.Bootstrap(bootstrap, chosen);
+  other.transport->Send(joiner.node_id, "lost", record_result);
+  network.AdvanceBy(std::chrono::milliseconds(1));
+  EXPECT_EQ(rudp::kSendFailure, results.back());
+
+  // Adding each other delivers the validation data.
+  EXPECT_EQ(rudp::kSuccess,
+            other.transport->GetAvailableEndpoint(joiner.node_id, joiner.endpoint_pair(),
+                                                  this_endpoint_pair, nat_type));
+  EXPECT_EQ(rudp::kConnectAttemptAlreadyRunning,
+            other.transport->GetAvailableEndpoint(joiner.node_id, joiner.endpoint_pair(),
+                                                  this_endpoint_pair, nat_type));
+  EXPECT_EQ(kSuccess, other.transport->Add(joiner.node_id, joiner.endpoint_pair(), "valid"));
+  boost::asio::ip::udp::endpoint new_endpoint;
+  EXPECT_EQ(kSuccess, other.transport->MarkConnectionAsValid(joiner.node_id, new_endpoint));
+  network.AdvanceBy(std::chrono::milliseconds(20));
+  ASSERT_EQ(1U, joiner.received.size());
+  EXPECT_EQ("valid", joiner.received.front());
+
+  // Removal is reported to the peer only.
+  other.transport->Remove(joiner.node_id);
+  network.AdvanceBy(std::chrono::milliseconds(20));
+  ASSERT_EQ(1U, joiner.lost.size());
+  EXPECT_EQ(other.node_id, joiner.lost.front());
+  EXPECT_TRUE(other.lost.empty());
+
+  // As is the destruction of a transport.
+  joiner.transport.reset();
+  network.AdvanceBy(std::chrono::milliseconds(20));
+  ASSERT_EQ(1U, bootstrap.lost.size());
+  EXPECT_EQ(joiner.node_id, bootstrap.lost.front());
+}
+
+TEST(SimulatedTransportTest, BEH_ZeroStateBootstrap) {
+  SimulatedNetwork network;
+  SimulatedPeer peer1(network), peer2(network);
+  // Each waits for the other to start bootstrapping.
+  NodeId chosen1, chosen2;
+  auto bootstrap1(std::async(std::launch::async, [&] { return peer1.Bootstrap(peer2, chosen1); }));
+  EXPECT_EQ(kSuccess, peer2.Bootstrap(peer1, chosen2));
+  EXPECT_EQ(kSuccess, bootstrap1.get());
+  EXPECT_EQ(peer2.node_id, chosen1);
+  EXPECT_EQ(peer1.node_id, chosen2);
+}
+
+TEST(SimulatedTransportTest, BEH_Loss) {
+  SimulatedNetworkConfig config(FixedLatency(std::chrono::milliseconds(10)));
+  config.loss = 1.0;
+  config.max_attempts = 3;
+  SimulatedNetwork network(config);
+  SimulatedPeer peer1(network), peer2(network);
+  NodeId chosen;
+  peer2.Bootstrap(peer2, chosen);
+  ASSERT_EQ(kSuccess, peer1.Bootstrap(peer2, chosen));
+
+  // Every transmission is lost, so the send fails after its last retransmission.
+  int result(kSuccess);
+  peer1.transport->Send(peer2.node_id, std::string(10, 'a'), [&](int sent) { result = sent; });
+  network.AdvanceBy(std::chrono::seconds(1));
+  EXPECT_EQ(rudp::kSendFailure, result);
+  EXPECT_TRUE(peer2.received.empty());
+  EXPECT_EQ(3U, network.Statistics().transmissions_lost);
+  EXPECT_EQ(1U, network.Statistics().send_failures);
+}
+
+TEST(SimulatedTransportTest, BEH_BandwidthQueuesMessages) {
+  SimulatedNetworkConfig config(FixedLatency(std::chrono::milliseconds(10)));
+  config.bandwidth = 1000;  // bytes per second
+  SimulatedNetwork network(config);
+  SimulatedPeer peer1(network), peer2(network);
+  NodeId chosen;
+  peer2.Bootstrap(peer2, chosen);
+  ASSERT_EQ(kSuccess, peer1.Bootstrap(peer2, chosen));
+
+  // Each 100 byte message takes 100ms to send, so the second arrives 100ms after the first.
+  peer1.transport->Send(peer2.node_id, std::string(100, 'a'), rudp::MessageSentFunctor());
+  peer1.transport->Send(peer2.node_id, std::string(100, 'b'), rudp::MessageSentFunctor());
+  network.AdvanceBy(std::chrono::milliseconds(111));
+  EXPECT_EQ(1U, peer2.received.size());
+  network.AdvanceBy(std::chrono::milliseconds(100));
+  EXPECT_EQ(2U, peer2.received.size());
+  EXPECT_EQ(200U, network.Statistics().bytes_sent);
+  EXPECT_EQ(2U, network.Statistics().messages_delivered);
+}
+
+TEST(SimulatedTransportTest, BEH_StartOn) {
+  SimulatedNetwork network(FixedLatency(std::chrono::milliseconds(10)));
+  SimulatedPeer peer1(network), peer2(network);
+  NodeId chosen;
+  peer2.Bootstrap(peer2, chosen);
+  ASSERT_EQ(kSuccess, peer1.Bootstrap(peer2, chosen));
+
+  // A timer on the routing clock expires in virtual time, interleaved with the network's events on
+  // the one thread running the io_service.
+  boost::asio::io_service io_service;
+  network.StartOn(io_service, std::chrono::milliseconds(1));
+  EXPECT_TRUE(RoutingClock::is_virtual());
+  peer1.transport->Send(peer2.node_id, "message", rudp::MessageSentFunctor());
+  RoutingTimer timer(io_service, std::chrono::milliseconds(50));
+  size_t received_by_expiry(0);
+  std::chrono::steady_clock::duration expired_at;
+  timer.async_wait([&](const boost::system::error_code& error) {
+    EXPECT_FALSE(error);
+    received_by_expiry = peer2.received.size();
+    expired_at = network.now();
+    io_service.stop();
+  });
+  io_service.run();
+  network.Stop();
+  EXPECT_FALSE(RoutingClock::is_virtual());
+  EXPECT_EQ(1U, received_by_expiry);
+  EXPECT_GE(expired_at, std::chrono::steady_clock::duration(std::chrono::milliseconds(50)));
+  EXPECT_LT(expired_at, std::chrono::steady_clock::duration(std::chrono::milliseconds(52)));
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,78 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <algorithm>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/distance.h"
+#include "maidsafe/routing/standby_cache.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(StandbyCacheTest, BEH_KeepsClosest) {
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  StandbyCache standby_cache(kThisNodeId, 4);
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 10; ++i)
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+
+  EXPECT_TRUE(standby_cache.Add(std::vector<NodeId>(1, kThisNodeId)).empty());
+  auto added(standby_cache.Add(std::vector<NodeId>(node_ids.begin(), node_ids.begin() + 2)));
+  EXPECT_EQ(2U, added.size());
+  EXPECT_TRUE(standby_cache.Add(std::vector<NodeId>(node_ids.begin(), node_ids.begin() + 2))
+                  .empty());
+  standby_cache.Add(node_ids);
+  EXPECT_EQ(4U, standby_cache.size());
+
+  SortByDistance(node_ids, kThisNodeId);
+  auto taken(standby_cache.Take(10, [](const NodeId&) { return true; }));
+  EXPECT_EQ(std::vector<NodeId>(node_ids.begin(), node_ids.begin() + 4), taken);
+  EXPECT_EQ(0U, standby_cache.size());
+}
+
+TEST(StandbyCacheTest, BEH_TakeSkipsUnusable) {
+  const NodeId kThisNodeId(NodeId::kRandomId);
+  StandbyCache standby_cache(kThisNodeId, 8);
+  std::vector<NodeId> node_ids;
+  for (int i(0); i != 5; ++i)
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+  standby_cache.Add(node_ids);
+  SortByDistance(node_ids, kThisNodeId);
+  standby_cache.Remove(node_ids[1]);
+  EXPECT_EQ(4U, standby_cache.size());
+
+  // The closest is unusable, so is passed over and discarded.
+  const NodeId kUnusable(node_ids[0]);
+  auto taken(standby_cache.Take(1, [&](const NodeId& node_id) { return node_id != kUnusable; }));
+  ASSERT_EQ(1U, taken.size());
+  EXPECT_EQ(node_ids[2], taken.front());
+  EXPECT_EQ(2U, standby_cache.size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
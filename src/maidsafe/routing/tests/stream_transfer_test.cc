@@ -0,0 +1,126 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/stream_transfer.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(StreamTransferTest, BEH_SendsWindowAndReassembles) {
+  const std::string kPayload(RandomString(1000));
+  std::vector<std::pair<uint32_t, ResponseFunctor>> in_flight;
+  std::vector<std::string> fragments(4);
+  int result(kPendingResult);
+  auto sender(std::make_shared<StreamSender>(
+      kPayload, 250, 2, 1,
+      [&](uint32_t index, uint32_t count, std::string fragment, ResponseFunctor acknowledged) {
+        EXPECT_EQ(4U, count);
+        fragments[index] = fragment;
+        in_flight.push_back(std::make_pair(index, acknowledged));
+      },
+      [&](int stream_result) { result = stream_result; }));
+  EXPECT_EQ(4U, sender->fragment_count());
+  sender->Start();
+  ASSERT_EQ(2U, in_flight.size());
+
+  StreamReassembler reassembler(2000, 250, 1, std::chrono::seconds(10));
+  std::string payload;
+  // Delivered out of order, with one fragment resent after its acknowledgement was lost.
+  EXPECT_EQ(StreamReassembler::Result::kAccepted,
+            reassembler.Add("source", 7, 1, 4, fragments[1], payload));
+  EXPECT_EQ(StreamReassembler::Result::kAccepted,
+            reassembler.Add("source", 7, 1, 4, fragments[1], payload));
+  EXPECT_EQ(StreamReassembler::Result::kRejected,
+            reassembler.Add("other", 8, 0, 1, "x", payload));
+  while (!in_flight.empty()) {
+    auto next(in_flight.front());
+    in_flight.erase(in_flight.begin());
+    if (next.first != 1) {
+      EXPECT_NE(StreamReassembler::Result::kRejected,
+                reassembler.Add("source", 7, next.first, 4, fragments[next.first], payload));
+    }
+    EXPECT_LE(in_flight.size(), 2U);
+    next.second("ack");
+  }
+  EXPECT_EQ(kSuccess, result);
+  EXPECT_EQ(kPayload, payload);
+  EXPECT_EQ(0U, reassembler.size());
+  EXPECT_EQ(StreamReassembler::Result::kAccepted,
+            reassembler.Add("source", 7, 3, 4, fragments[3], payload));
+}
+
+TEST(StreamTransferTest, BEH_RejectsImpossibleFragments) {
+  StreamReassembler reassembler(1000, 100, 2, std::chrono::seconds(10));
+  std::string payload;
+  // No more fragments than the stream's size allows, and no short one but the last.
+  EXPECT_EQ(StreamReassembler::Result::kRejected,
+            reassembler.Add("source", 1, 0, 11, std::string(100, 'a'), payload));
+  EXPECT_EQ(StreamReassembler::Result::kRejected,
+            reassembler.Add("source", 1, 0, std::numeric_limits<uint32_t>::max(), "a", payload));
+  EXPECT_EQ(StreamReassembler::Result::kRejected,
+            reassembler.Add("source", 1, 0, 10, "a", payload));
+  EXPECT_EQ(StreamReassembler::Result::kRejected,
+            reassembler.Add("source", 1, 9, 10, std::string(101, 'a'), payload));
+  EXPECT_EQ(0U, reassembler.size());
+
+  EXPECT_EQ(StreamReassembler::Result::kAccepted,
+            reassembler.Add("source", 1, 1, 2, "b", payload));
+  EXPECT_EQ(StreamReassembler::Result::kComplete,
+            reassembler.Add("source", 1, 0, 2, std::string(100, 'a'), payload));
+  EXPECT_EQ(std::string(100, 'a') + "b", payload);
+}
+
+TEST(StreamTransferTest, BEH_FailsAfterMaxAttempts) {
+  std::vector<ResponseFunctor> in_flight;
+  int result(kPendingResult);
+  auto sender(std::make_shared<StreamSender>(
+      RandomString(10), 100, 4, 2,
+      [&](uint32_t, uint32_t, std::string, ResponseFunctor acknowledged) {
+        in_flight.push_back(acknowledged);
+      },
+      [&](int stream_result) { result = stream_result; }));
+  sender->Start();
+  ASSERT_EQ(1U, in_flight.size());
+  in_flight.back()("");
+  ASSERT_EQ(2U, in_flight.size());
+  EXPECT_EQ(kPendingResult, result);
+  in_flight.back()("");
+  EXPECT_EQ(2U, in_flight.size());
+  EXPECT_EQ(kResponseTimeout, result);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,83 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/table_size_tuner.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+// A distance with |leading_zero_bytes| zero bytes then all ones.
+NodeId DistanceWithLeadingZeros(size_t leading_zero_bytes) {
+  return NodeId(std::string(leading_zero_bytes, '\0') +
+                std::string(NodeId::kSize - leading_zero_bytes, '\xff'));
+}
+
+}  // unnamed namespace
+
+TEST(TableSizeTunerTest, BEH_EstimateNetworkSize) {
+  EXPECT_EQ(4U, TableSizeTuner::EstimateNetworkSize(NodeId(), 4));
+  EXPECT_EQ(4U, TableSizeTuner::EstimateNetworkSize(DistanceWithLeadingZeros(0), 4));
+  EXPECT_EQ(4U << 8, TableSizeTuner::EstimateNetworkSize(DistanceWithLeadingZeros(1), 4));
+  EXPECT_EQ(4U << 16, TableSizeTuner::EstimateNetworkSize(DistanceWithLeadingZeros(2), 4));
+}
+
+TEST(TableSizeTunerTest, BEH_TargetFollowsNetworkSizeWithHysteresis) {
+  const uint16_t kMinSize(16), kMaxSize(64);
+  TableSizeTuner tuner(kMinSize, kMaxSize, kMaxSize);
+  EXPECT_EQ(kMaxSize, tuner.target());
+
+  // A small network shrinks the target to the minimum.
+  EXPECT_TRUE(tuner.Update(DistanceWithLeadingZeros(0)));
+  EXPECT_EQ(kMinSize, tuner.target());
+  EXPECT_FALSE(tuner.Update(DistanceWithLeadingZeros(0)));
+
+  // A much larger one grows it, but never past the maximum.
+  EXPECT_TRUE(tuner.Update(DistanceWithLeadingZeros(3)));
+  const uint16_t kLargeTarget(tuner.target());
+  EXPECT_LT(kMinSize, kLargeTarget);
+  EXPECT_GE(kMaxSize, kLargeTarget);
+
+  // Slow delivery pushes the target up by at least the hysteresis step.
+  for (int i(0); i != 32; ++i)
+    tuner.RecordHops(100);
+  if (kLargeTarget + Parameters::auto_tune_hysteresis <= kMaxSize) {
+    EXPECT_TRUE(tuner.Update(DistanceWithLeadingZeros(3)));
+    EXPECT_LE(kLargeTarget + Parameters::auto_tune_hysteresis, tuner.target());
+  }
+  auto statistics(tuner.Statistics());
+  EXPECT_EQ(100.0, statistics.mean_hops);
+  EXPECT_EQ(tuner.target(), statistics.target_table_size);
+  EXPECT_LE(2U, statistics.adjustments);
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
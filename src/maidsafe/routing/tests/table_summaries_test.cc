@@ -0,0 +1,94 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/table_summaries.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+NodeId MakeId(unsigned char first_byte) {
+  std::string id(NodeId(NodeId::kRandomId).string());
+  id[0] = static_cast<char>(first_byte);
+  return NodeId(id);
+}
+
+}  // unnamed namespace
+
+TEST(TableSummariesTest, BEH_Summarise) {
+  std::vector<NodeId> peer_ids;
+  for (int i(0); i != 8; ++i)
+    peer_ids.push_back(MakeId(static_cast<unsigned char>(i << 5)));
+  auto summary(TableSummaries::Summarise(peer_ids, 4));
+  ASSERT_EQ(4U, summary.size());
+  // Every other peer, so the whole table is represented.
+  for (size_t i(0); i != summary.size(); ++i)
+    EXPECT_EQ(TableSummaries::Prefix(peer_ids[2 * i]), summary[i]);
+  EXPECT_EQ(8U, TableSummaries::Summarise(peer_ids, 32).size());
+  EXPECT_TRUE(TableSummaries::Summarise(std::vector<NodeId>(), 32).empty());
+  EXPECT_EQ(0x20U, TableSummaries::Prefix(MakeId(0x20)) >> 56);
+}
+
+TEST(TableSummariesTest, BEH_LookaheadDistance) {
+  TableSummaries summaries;
+  const NodeId kTarget(MakeId(0xff)), kPeer(MakeId(0x80)), kPeersPeer(MakeId(0xfe));
+  const uint64_t kDirect(TableSummaries::Prefix(kPeer) ^ TableSummaries::Prefix(kTarget));
+  EXPECT_EQ(kDirect, summaries.LookaheadDistance(kPeer, kTarget));
+
+  // A peer of the peer much closer to the target brings the distance down to its own.
+  summaries.Update(kPeer, std::vector<uint64_t>(1, TableSummaries::Prefix(kPeersPeer)));
+  EXPECT_EQ(TableSummaries::Prefix(kPeersPeer) ^ TableSummaries::Prefix(kTarget),
+            summaries.LookaheadDistance(kPeer, kTarget));
+  EXPECT_GT(kDirect, summaries.LookaheadDistance(kPeer, kTarget));
+
+  summaries.Remove(kPeer);
+  EXPECT_EQ(kDirect, summaries.LookaheadDistance(kPeer, kTarget));
+  EXPECT_EQ(0U, summaries.size());
+}
+
+TEST(TableSummariesTest, BEH_TakeStale) {
+  TableSummaries summaries;
+  const NodeId kFresh(NodeId::kRandomId), kMissing(NodeId::kRandomId);
+  summaries.Update(kFresh, std::vector<uint64_t>(1, 1));
+  std::vector<NodeId> peer_ids;
+  peer_ids.push_back(kFresh);
+  peer_ids.push_back(kMissing);
+  auto stale(summaries.TakeStale(peer_ids, std::chrono::hours(1)));
+  ASSERT_EQ(1U, stale.size());
+  EXPECT_EQ(kMissing, stale.front());
+  // Once taken, a peer isn't stale again until its refresh would be overdue.
+  EXPECT_TRUE(summaries.TakeStale(peer_ids, std::chrono::hours(1)).empty());
+  EXPECT_EQ(2U, summaries.TakeStale(peer_ids, std::chrono::seconds(0)).size());
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -29,8 +29,11 @@
 
 #include "maidsafe/rudp/managed_connections.h"
 
-#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/message_handler.h"
 #include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/rpcs.h"
 
 namespace asio = boost::asio;
 namespace ip = asio::ip;
@@ -50,6 +53,47 @@ NodeInfo MakeNode() {
   return node;
 }
 
+std::vector<protobuf::Message> MakeMessageOfEachType(size_t node_level_data_size) {
+  const NodeId kThisId(NodeId::kRandomId), kDestinationId(NodeId::kRandomId);
+  std::vector<NodeId> close_ids;
+  std::vector<NodeInfo> close_nodes;
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    close_nodes.push_back(MakeNode());
+    close_ids.push_back(close_nodes.back().node_id);
+  }
+  rudp::EndpointPair endpoint_pair;
+  endpoint_pair.local = ip::udp::endpoint(ip::address_v4::loopback(), 5483);
+  endpoint_pair.external = endpoint_pair.local;
+  std::vector<protobuf::Message> messages;
+  messages.push_back(rpcs::Ping(kDestinationId, RandomString(64)));
+  messages.push_back(rpcs::Connect(kDestinationId, endpoint_pair, kThisId, kThisId));
+  messages.push_back(rpcs::FindNodes(kDestinationId, kThisId, Parameters::closest_nodes_size));
+  messages.push_back(rpcs::ConnectSuccess(kDestinationId, kThisId, kThisId, true, false));
+  messages.push_back(rpcs::ConnectSuccessAcknowledgement(kDestinationId, kThisId, kThisId, true,
+                                                         close_ids, false));
+  messages.push_back(rpcs::Remove(kDestinationId, kThisId, kThisId, std::vector<std::string>()));
+  messages.push_back(rpcs::ClosestNodesUpdate(kDestinationId, kThisId, close_nodes));
+  messages.push_back(rpcs::GetGroup(kDestinationId, kThisId));
+
+  protobuf::Message node_level;
+  node_level.set_source_id(kThisId.string());
+  node_level.set_destination_id(kDestinationId.string());
+  node_level.set_routing_message(false);
+  node_level.add_data(RandomString(node_level_data_size));
+  node_level.set_direct(true);
+  node_level.set_type(static_cast<int32_t>(MessageType::kNodeLevel));
+  node_level.set_id(RandomUint32() % 10000);
+  node_level.set_client_node(false);
+  node_level.set_request(true);
+  node_level.set_hops_to_live(Parameters::hops_to_live);
+  node_level.set_unique_id(RandomUint32());
+  messages.push_back(node_level);
+
+  for (auto& message : messages)
+    AddToRouteHistory(message, NodeId(NodeId::kRandomId));
+  return messages;
+}
+
 NodeInfoAndPrivateKey MakeNodeInfoAndKeys() {
   passport::Pmid pmid(MakePmid());
   return MakeNodeInfoAndKeysWithFob(pmid);
@@ -31,6 +31,7 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 
 namespace maidsafe {
@@ -86,6 +87,11 @@ void SortNodeInfosFromTarget(const NodeId& target, std::vector<NodeInfo>& nodes)
 
 bool CompareListOfNodeInfos(const std::vector<NodeInfo>& lhs, const std::vector<NodeInfo>& rhs);
 
+// One request of each routing MessageType as rpcs makes them, in type order, then a node-level
+// request carrying |node_level_data_size| bytes of data.  Each has one hop in its route history, as
+// a message being forwarded would.
+std::vector<protobuf::Message> MakeMessageOfEachType(size_t node_level_data_size);
+
 }  // namespace test
 
 }  // namespace routing
@@ -16,13 +16,16 @@
     See the Licences for the specific language governing permissions and limitations relating to
     use of the MaidSafe Software.                                                                 */
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <future>
 #include <iterator>
 #include <map>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "maidsafe/common/asio_service.h"
 #include "maidsafe/common/error.h"
@@ -74,7 +77,8 @@ class TimerTest : public testing::Test {
 
   void TearDown() override {
     asio_service_.Stop();
-    EXPECT_TRUE(timer_.tasks_.empty());
+    for (const auto& shard : timer_.shards_)
+      EXPECT_TRUE(shard->tasks.empty());
   }
 
  protected:
@@ -115,6 +119,60 @@ TEST_F(TimerTest, BEH_SingleResponse) {
                                  [&] { return pass_response_count_ == 1U; }));
 }
 
+TEST_F(TimerTest, BEH_ResponseLatencyObserver) {
+  // Only responses are observed, not the shortfall made up at timeout.
+  std::vector<std::chrono::steady_clock::duration> latencies;
+  timer_.set_response_latency_observer([&](std::chrono::steady_clock::duration latency) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latencies.push_back(latency);
+  });
+  auto task_id(timer_.NewTaskId());
+  timer_.AddTask(std::chrono::milliseconds(200), variable_response_functor_, 2, task_id);
+  Sleep(std::chrono::milliseconds(50));
+  timer_.AddResponse(task_id, message_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] {
+    return pass_response_count_ == 1U && failed_response_count_ == 1U;
+  }));
+  ASSERT_EQ(1U, latencies.size());
+  EXPECT_GE(latencies.front(), std::chrono::milliseconds(50));
+  EXPECT_LT(latencies.front(), std::chrono::milliseconds(200));
+}
+
+TEST_F(TimerTest, BEH_TaskOutcomeObserver) {
+  std::vector<TaskOutcome> outcomes;
+  timer_.set_task_outcome_observer([&](const TaskOutcome& outcome) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    outcomes.push_back(outcome);
+  });
+  const TaskId kFirstTaskId(timer_.NewTaskIds(3));
+  timer_.AddTask(std::chrono::seconds(2), variable_response_functor_, 2, kFirstTaskId, 1);
+  timer_.AddTask(std::chrono::milliseconds(100), variable_response_functor_, 3, kFirstTaskId + 1,
+                 2);
+  timer_.AddTask(std::chrono::seconds(2), variable_response_functor_, 1, kFirstTaskId + 2, 3);
+  timer_.AddResponse(kFirstTaskId, message_);
+  timer_.AddResponse(kFirstTaskId, message_);
+  timer_.AddResponse(kFirstTaskId + 1, message_);
+  timer_.CancelTask(kFirstTaskId + 2);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] {
+    return pass_response_count_ == 3U && failed_response_count_ == 3U;
+  }));
+  ASSERT_EQ(3U, outcomes.size());
+  std::sort(std::begin(outcomes), std::end(outcomes),
+            [](const TaskOutcome& lhs, const TaskOutcome& rhs) { return lhs.tag < rhs.tag; });
+  EXPECT_EQ(TaskOutcome::kCompleted, outcomes[0].ending);
+  EXPECT_EQ(kFirstTaskId, outcomes[0].task_id);
+  EXPECT_EQ(2, outcomes[0].response_count);
+  EXPECT_EQ(2, outcomes[0].expected_response_count);
+  EXPECT_EQ(TaskOutcome::kTimedOut, outcomes[1].ending);
+  EXPECT_EQ(1, outcomes[1].response_count);
+  EXPECT_EQ(3, outcomes[1].expected_response_count);
+  EXPECT_GE(outcomes[1].elapsed, std::chrono::milliseconds(100));
+  EXPECT_EQ(TaskOutcome::kCancelled, outcomes[2].ending);
+  EXPECT_EQ(0, outcomes[2].response_count);
+}
+
 TEST_F(TimerTest, BEH_SingleResponseTimedOut) {
   timer_.AddTask(std::chrono::milliseconds(100), failed_response_functor_, 1, timer_.NewTaskId());
   std::unique_lock<std::mutex> lock(mutex_);
@@ -243,6 +301,82 @@ TEST_F(TimerTest, BEH_CancelTask) {
   EXPECT_EQ(failed_response_count_, kGroupSize_ - 1);
 }
 
+TEST_F(TimerTest, BEH_AddTasks) {
+  const int kTaskCount(50);
+  typedef Timer<std::string>::NewTask NewTask;
+  std::vector<NewTask> invalid(1, NewTask(timer_.NewTaskId(), pass_response_functor_, 1));
+  invalid.push_back(NewTask(timer_.NewTaskId(), nullptr, 1));
+  EXPECT_THROW(timer_.AddTasks(std::chrono::seconds(1), invalid), maidsafe_error);
+  EXPECT_THROW(timer_.AddResponse(invalid.front().task_id, message_), maidsafe_error);
+
+  const TaskId kFirstTaskId(timer_.NewTaskIds(kTaskCount));
+  EXPECT_EQ(kFirstTaskId + kTaskCount, timer_.NewTaskId());
+  std::vector<NewTask> tasks;
+  for (int i(0); i != kTaskCount; ++i)
+    tasks.push_back(NewTask(kFirstTaskId + i, variable_response_functor_, 2));
+  timer_.AddTasks(std::chrono::milliseconds(100), tasks);
+  for (int i(0); i != kTaskCount; ++i)
+    timer_.AddResponse(kFirstTaskId + i, message_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(2), [&] {
+    return pass_response_count_ + failed_response_count_ == 2U * kTaskCount;
+  }));
+  EXPECT_EQ(static_cast<uint32_t>(kTaskCount), pass_response_count_);
+  EXPECT_EQ(static_cast<uint32_t>(kTaskCount), failed_response_count_);
+}
+
+TEST_F(TimerTest, BEH_QuorumTask) {
+  EXPECT_THROW(timer_.AddQuorumTask(std::chrono::seconds(1), 5, 4, timer_.NewTaskId()),
+               maidsafe_error);
+
+  // Met early, the task is cancelled and further responses are refused.
+  const TaskId kEarlyTaskId(timer_.NewTaskId());
+  auto early(timer_.AddQuorumTask(std::chrono::seconds(10), 2, 4, kEarlyTaskId));
+  timer_.AddResponse(kEarlyTaskId, "first");
+  timer_.AddResponse(kEarlyTaskId, "second");
+  ASSERT_EQ(std::future_status::ready, early.wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ(std::vector<std::string>({"first", "second"}), early.get());
+  EXPECT_THROW(timer_.AddResponse(kEarlyTaskId, message_), maidsafe_error);
+
+  // Not met, the partial set is given at the deadline.
+  const TaskId kPartialTaskId(timer_.NewTaskId());
+  auto partial(timer_.AddQuorumTask(std::chrono::milliseconds(100), 3, 4, kPartialTaskId));
+  timer_.AddResponse(kPartialTaskId, message_);
+  EXPECT_EQ(std::future_status::timeout, partial.wait_for(std::chrono::milliseconds(10)));
+  ASSERT_EQ(std::future_status::ready, partial.wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ(std::vector<std::string>(1, message_), partial.get());
+}
+
+TEST_F(TimerTest, BEH_TimeoutsAcrossWheelLevels) {
+  // Timeouts spanning more than one revolution of the wheel's lowest level must be cascaded down
+  // and fire neither early nor more than once.
+  const uint32_t kTaskCount(500);
+  std::vector<std::chrono::steady_clock::time_point> deadlines(kTaskCount);
+  std::vector<int> early_count(kTaskCount, 0), fired_count(kTaskCount, 0);
+  uint32_t functor_calls(0);
+  for (uint32_t i(0); i != kTaskCount; ++i) {
+    std::chrono::milliseconds timeout((RandomUint32() % 1500) + 20);
+    deadlines[i] = std::chrono::steady_clock::now() + timeout;
+    timer_.AddTask(timeout, [&, i](std::string response) {
+                              std::lock_guard<std::mutex> lock(mutex_);
+                              EXPECT_TRUE(response.empty());
+                              if (std::chrono::steady_clock::now() < deadlines[i])
+                                ++early_count[i];
+                              ++fired_count[i];
+                              ++functor_calls;
+                              cond_var_.notify_one();
+                            },
+                   1, timer_.NewTaskId());
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  EXPECT_TRUE(cond_var_.wait_for(lock, std::chrono::seconds(5),
+                                 [&] { return functor_calls == kTaskCount; }));
+  for (uint32_t i(0); i != kTaskCount; ++i) {
+    EXPECT_EQ(0, early_count[i]);
+    EXPECT_EQ(1, fired_count[i]);
+  }
+}
+
 struct MessageDetails {
   MessageDetails()
       : message(RandomAlphaNumericString(30)),
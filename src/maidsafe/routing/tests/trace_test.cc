@@ -0,0 +1,91 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/test.h"
+
+#include "maidsafe/routing/trace.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+TEST(TraceTest, BEH_RecordOnlyWhenEnabled) {
+  Tracer& tracer(Tracer::Instance());
+  tracer.Clear();
+  tracer.set_level(TraceLevel::kOff);
+  EXPECT_FALSE(ROUTING_TRACE_ENABLED(TraceLevel::kInfo));
+  tracer.Record(TraceEvent::kSent, 1, 2, 3, NodeId(NodeId::kRandomId).string());
+  // Record itself is unconditional; only the macros check the level.
+  EXPECT_EQ(1U, tracer.GetRecords().size());
+
+  tracer.Clear();
+  int evaluated(0);
+  auto peer_id([&evaluated]() -> std::string {
+    ++evaluated;
+    return NodeId(NodeId::kRandomId).string();
+  });
+  struct {
+    int32_t id() const { return 7; }
+    int32_t type() const { return 3; }
+    int32_t hops_to_live() const { return 50; }
+  } message;
+  ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kReceived, message, peer_id());
+  EXPECT_EQ(0, evaluated);
+  EXPECT_TRUE(tracer.GetRecords().empty());
+
+  tracer.set_level(TraceLevel::kInfo);
+  ROUTING_TRACE(TraceLevel::kInfo, TraceEvent::kReceived, message, peer_id());
+  ROUTING_TRACE(TraceLevel::kVerbose, TraceEvent::kReceived, message, peer_id());
+  EXPECT_EQ(1, evaluated);
+  auto records(tracer.GetRecords());
+  ASSERT_EQ(1U, records.size());
+  EXPECT_EQ(TraceEvent::kReceived, records.front().event);
+  EXPECT_EQ(7, records.front().message_id);
+  EXPECT_EQ(3, records.front().message_type);
+  EXPECT_EQ(50, records.front().hops_to_live);
+  EXPECT_FALSE(tracer.Dump().empty());
+  tracer.set_level(TraceLevel::kOff);
+  tracer.Clear();
+}
+
+TEST(TraceTest, BEH_RingKeepsMostRecent) {
+  Tracer& tracer(Tracer::Instance());
+  tracer.Clear();
+  const std::string kPeerId(NodeId(NodeId::kRandomId).string());
+  for (size_t i(0); i != Tracer::kCapacity + 10; ++i)
+    tracer.Record(TraceEvent::kSent, static_cast<int32_t>(i), 0, 0, kPeerId);
+  auto records(tracer.GetRecords());
+  ASSERT_EQ(Tracer::kCapacity, records.size());
+  EXPECT_EQ(10, records.front().message_id);
+  EXPECT_EQ(static_cast<int32_t>(Tracer::kCapacity + 9), records.back().message_id);
+  EXPECT_EQ(kPeerId.substr(0, TraceRecord::kPeerPrefixSize),
+            std::string(records.back().peer_prefix.data(), TraceRecord::kPeerPrefixSize));
+  tracer.Clear();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
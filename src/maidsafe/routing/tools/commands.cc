@@ -19,8 +19,12 @@
 #include "maidsafe/routing/tools/commands.h"
 
 #include <algorithm>
+#include <csignal>
+#include <fstream>
 #include <iostream>  // NOLINT
+#include <thread>
 
+#include "boost/asio/signal_set.hpp"
 #include "boost/format.hpp"
 #include "boost/filesystem.hpp"
 #include "boost/tokenizer.hpp"
@@ -111,6 +115,19 @@ void Commands::Run() {
   }
 }
 
+void Commands::RunDaemon() {
+  std::cout << "Joining the node ......" << std::endl;
+  if (identity_index_ < 2)
+    ZeroStateJoin();
+  else
+    Join();
+
+  boost::asio::io_service io_service;
+  boost::asio::signal_set signals(io_service, SIGINT, SIGTERM);
+  signals.async_wait([](const boost::system::error_code&, int) {});
+  io_service.run();
+}
+
 void Commands::PrintRoutingTable() {
   auto routing_nodes = demo_node_->ReturnRoutingTable();
   std::cout << "ROUTING TABLE::::" << std::endl;
@@ -118,6 +135,27 @@ void Commands::PrintRoutingTable() {
     std::cout << "\t" << maidsafe::HexSubstr(routing_node.string()) << std::endl;
 }
 
+void Commands::PrintCacheStatistics() {
+  const char* const kKindNames[CacheStatistics::kKindCount] = {
+      "single_to_single", "single_to_group", "group_to_single", "group_to_group"};
+  CacheStatistics statistics(demo_node_->GetCacheStatistics());
+  auto print([](const std::string& name, const CacheCounters& counters) {
+    std::cout << "\t" << name << " : lookups " << counters.lookups << ", hits " << counters.hits
+              << ", misses " << counters.misses << ", timeouts " << counters.timeouts
+              << ", bytes served " << counters.bytes_served << ", evictions "
+              << counters.evictions << ", coalesced " << counters.coalesced << std::endl;
+  });
+  std::cout << "CACHE STATISTICS::::" << std::endl;
+  for (int kind(0); kind != CacheStatistics::kKindCount; ++kind)
+    print(kKindNames[kind], statistics.by_kind[kind]);
+  const CacheCounters kTotal(statistics.Total());
+  print("total", kTotal);
+  if (kTotal.lookups != 0) {
+    std::cout << "\thit ratio : " << (100.0 * kTotal.hits / kTotal.lookups) << "%"
+              << std::endl;
+  }
+}
+
 void Commands::GetPeer(const std::string& peer) {
   size_t delim = peer.rfind(':');
   try {
@@ -326,6 +364,7 @@ void Commands::PrintUsage() {
   std::cout << "\tzerostatejoin ZeroStateJoin.\n";
   std::cout << "\tjoin Normal Join.\n";
   std::cout << "\tprt Print Local Routing Table.\n";
+  std::cout << "\tcachestats Print this node's cache statistics.\n";
   std::cout << "\trrt <dest_index> Request Routing Table from peer node with the specified"
             << " identity-index.\n";
   std::cout << "\tsenddirect <dest_index> <num_msg> Send a msg to a node with specified"
@@ -340,6 +379,9 @@ void Commands::PrintUsage() {
   std::cout << "\tdatarate <data_rate> Set the data_rate for the message.\n";
   std::cout << "\tattype Print the NatType of this node.\n";
   std::cout << "\tperformance Execute performance test from this node.\n";
+  std::cout << "\tloadtest [rate=<msgs/s>] [duration=<s>] [concurrency=<n>] [direct=<fraction>]"
+            << " [sizes=<n,n,...>] [label=<text>] [format=csv|json] [out=<file>] Send messages"
+            << " at a fixed rate and report latency percentiles, throughput and timeouts.\n";
   std::cout << "\texit Exit application.\n";
 }
 
@@ -369,6 +411,8 @@ void Commands::ProcessCommand(const std::string& cmdline) {
     PrintUsage();
   } else if (cmd == "prt") {
     PrintRoutingTable();
+  } else if (cmd == "cachestats") {
+    PrintCacheStatistics();
   } else if (cmd == "rrt") {
     if (args.size() == 1) {
       SendMessages(atoi(args[0].c_str()), DestinationType::kDirect, true, 1);
@@ -435,6 +479,8 @@ void Commands::ProcessCommand(const std::string& cmdline) {
     std::cout << "NatType for this node is : " << demo_node_->nat_type() << std::endl;
   } else if (cmd == "performance") {
     PerformanceTest();
+  } else if (cmd == "loadtest") {
+    LoadTest(args);
   } else if (cmd == "exit") {
     std::cout << "Exiting application...\n";
     finish_ = true;
@@ -507,6 +553,157 @@ void Commands::RunPerformanceTest(bool is_send_group) {
   }
 }
 
+void Commands::LoadTest(const Arguments& args) {
+  LoadProfile profile;
+  std::string format("csv"), output_path;
+  try {
+    for (const auto& arg : args) {
+      const size_t kDelim(arg.find('='));
+      if (kDelim == std::string::npos)
+        throw std::invalid_argument(arg);
+      const std::string kKey(arg.substr(0, kDelim)), kValue(arg.substr(kDelim + 1));
+      if (kKey == "rate") {
+        profile.rate = boost::lexical_cast<double>(kValue);
+      } else if (kKey == "duration") {
+        profile.duration = std::chrono::seconds(boost::lexical_cast<int>(kValue));
+      } else if (kKey == "concurrency") {
+        profile.concurrency = boost::lexical_cast<size_t>(kValue);
+      } else if (kKey == "direct") {
+        profile.direct_fraction = boost::lexical_cast<double>(kValue);
+      } else if (kKey == "sizes") {
+        profile.message_sizes.clear();
+        boost::char_separator<char> sep(",");
+        boost::tokenizer<boost::char_separator<char>> tok(kValue, sep);
+        for (const auto& size : tok)
+          profile.message_sizes.push_back(boost::lexical_cast<size_t>(size));
+      } else if (kKey == "label") {
+        profile.label = kValue;
+      } else if (kKey == "format") {
+        format = kValue;
+      } else if (kKey == "out") {
+        output_path = kValue;
+      } else {
+        throw std::invalid_argument(arg);
+      }
+    }
+  }
+  catch (const std::exception& e) {
+    std::cout << "Error : invalid option " << e.what() << std::endl;
+    return;
+  }
+  if (profile.rate <= 0 || profile.concurrency == 0 || profile.message_sizes.empty() ||
+      profile.direct_fraction < 0 || profile.direct_fraction > 1 ||
+      (format != "csv" && format != "json")) {
+    std::cout << "Error : Try correct option" << std::endl;
+    return;
+  }
+
+  const LoadReport kReport(RunLoadTest(profile));
+  if (output_path.empty()) {
+    if (format == "csv")
+      std::cout << LoadReport::CsvHeader() << std::endl;
+    std::cout << (format == "csv" ? kReport.ToCsv() : kReport.ToJson()) << std::endl;
+    return;
+  }
+  // Appended to, so that runs can be collected in one file; a new CSV file gets a header.
+  const bool kNewFile(!fs::exists(output_path));
+  std::ofstream output(output_path, std::ios::app);
+  if (format == "csv" && kNewFile)
+    output << LoadReport::CsvHeader() << '\n';
+  output << (format == "csv" ? kReport.ToCsv() : kReport.ToJson()) << '\n';
+  std::cout << (output ? "Report written to " : "Error : failed writing to ") << output_path
+            << std::endl;
+}
+
+LoadReport Commands::RunLoadTest(const LoadProfile& profile) {
+  struct State {
+    State() : mutex(), cond_var(), in_flight(0), report() {}
+    std::mutex mutex;
+    std::condition_variable cond_var;
+    size_t in_flight;
+    LoadReport report;
+  };
+  // Responses for a group message arrive one by one; it's complete once all have.
+  struct Outstanding {
+    Outstanding(int remaining_in, std::chrono::steady_clock::time_point due_in)
+        : remaining(remaining_in), timed_out(false), due(due_in) {}
+    int remaining;
+    bool timed_out;
+    const std::chrono::steady_clock::time_point due;
+  };
+
+  std::vector<NodeId> direct_ids;
+  for (const auto& node_id : all_ids_.empty() ? demo_node_->ReturnRoutingTable() : all_ids_) {
+    if (node_id != demo_node_->node_id())
+      direct_ids.push_back(node_id);
+  }
+  // Payloads are made up front so as not to slow the sender.
+  std::vector<std::string> payloads;
+  for (const auto& size : profile.message_sizes)
+    payloads.push_back(RandomAlphaNumericString(size));
+
+  auto state(std::make_shared<State>());
+  state->report.profile = profile;
+  const auto kPeriod(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / profile.rate)));
+  const auto kStart(std::chrono::steady_clock::now());
+  const auto kEnd(kStart + profile.duration);
+  for (uint64_t index(0);; ++index) {
+    const auto kDue(kStart + kPeriod * index);
+    if (kDue >= kEnd)
+      break;
+    std::this_thread::sleep_until(kDue);
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      ++state->report.scheduled;
+      if (state->in_flight >= profile.concurrency) {
+        ++state->report.skipped;
+        continue;
+      }
+      ++state->in_flight;
+      ++state->report.sent;
+    }
+    const bool kDirect(!direct_ids.empty() &&
+                       RandomUint32() < profile.direct_fraction * 4294967295.0);
+    const std::string& payload(payloads[RandomUint32() % payloads.size()]);
+    auto outstanding(std::make_shared<Outstanding>(
+        kDirect ? 1 : static_cast<int>(Parameters::group_size), kDue));
+    auto on_response([state, outstanding](std::string response) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (response.empty())
+        outstanding->timed_out = true;
+      if (--outstanding->remaining != 0)
+        return;
+      if (outstanding->timed_out) {
+        ++state->report.timed_out;
+      } else {
+        ++state->report.completed;
+        state->report.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - outstanding->due));
+      }
+      --state->in_flight;
+      state->cond_var.notify_one();
+    });
+    if (kDirect) {
+      demo_node_->SendDirect(direct_ids[RandomUint32() % direct_ids.size()], payload, false,
+                             on_response);
+    } else {
+      demo_node_->SendGroup(NodeId(NodeId::kRandomId), payload, false, on_response);
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  // Every outstanding message is answered, if only by its timeout, within the response timeout.
+  state->cond_var.wait_for(lock, Parameters::default_response_timeout + std::chrono::seconds(5),
+                           [state] { return state->in_flight == 0; });
+  // Any still unanswered are counted as timed out.
+  state->report.timed_out += state->in_flight;
+  state->report.elapsed = std::chrono::steady_clock::now() - kStart;
+  LoadReport report(state->report);
+  std::sort(report.latencies.begin(), report.latencies.end());
+  return report;
+}
+
 }  //  namespace test
 
 }  //  namespace routing
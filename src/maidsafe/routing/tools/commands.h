@@ -31,6 +31,7 @@
 #include "maidsafe/passport/types.h"
 #include "maidsafe/routing/tests/routing_network.h"
 #include "maidsafe/routing/tests/test_utils.h"
+#include "maidsafe/routing/tools/load_report.h"
 #include "maidsafe/routing/utils.h"
 
 namespace bptime = boost::posix_time;
@@ -49,6 +50,8 @@ class Commands {
                     std::vector<maidsafe::passport::detail::AnmaidToPmid> all_keys,
                     int identity_index);
   void Run();
+  // Joins, then leaves the node running without the command prompt until SIGINT or SIGTERM.
+  void RunDaemon();
   void GetPeer(const std::string& peer);
 
  private:
@@ -60,6 +63,7 @@ class Commands {
   bool ResultArrived() { return result_arrived_; }
 
   void PrintRoutingTable();
+  void PrintCacheStatistics();
   void ZeroStateJoin();
   void Join();
   void Validate(const NodeId& node_id, GivePublicKeyFunctor give_public_key);
@@ -79,6 +83,9 @@ class Commands {
                     std::string data);
   void PerformanceTest();
   void RunPerformanceTest(bool is_send_group);
+  // Parses "key=value" |args| into a LoadProfile, runs it, and writes the report as CSV or JSON.
+  void LoadTest(const Arguments& args);
+  LoadReport RunLoadTest(const LoadProfile& profile);
 
   std::shared_ptr<GenericNode> demo_node_;
   std::vector<maidsafe::passport::detail::AnmaidToPmid> all_keys_;
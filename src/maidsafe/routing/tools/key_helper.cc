@@ -18,12 +18,16 @@
 
 #include <signal.h>
 
+#include <algorithm>
 #include <atomic>
 #include <iostream>  // NOLINT
 #include <fstream>   // NOLINT
 #include <future>    // NOLINT
+#include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "boost/filesystem.hpp"
 #include "boost/asio.hpp"
@@ -47,6 +51,7 @@
 
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/routing_api.h"
+#include "maidsafe/routing/tools/key_store.h"
 #include "maidsafe/routing/utils.h"
 
 namespace fs = boost::filesystem;
@@ -69,18 +74,34 @@ void PrintKeys(const KeysVector& all_keys) {
               << (i < 2 ? " (bootstrap)" : "") << std::endl;
 }
 
-bool CreateKeys(size_t keys_count, KeysVector& all_keys) {
+// Generating the RSA keys is nearly all the work, so it's shared between |threads_count| threads,
+// each making a contiguous share of the IDs.
+bool CreateKeys(size_t keys_count, unsigned threads_count, KeysVector& all_keys) {
   all_keys.clear();
-  for (size_t i(0); i < keys_count; ++i) {
-    try {
-      all_keys.emplace_back(maidsafe::passport::detail::AnmaidToPmid());
-    }
-    catch (const std::exception& /*ex*/) {
-      LOG(kError) << "CreatePmids - Could not create ID #" << i;
-      return false;
-    }
+  const size_t kThreads(std::max<size_t>(1, std::min<size_t>(threads_count, keys_count)));
+  std::vector<std::future<KeysVector>> shares;
+  for (size_t thread(0); thread != kThreads; ++thread) {
+    const size_t kBegin(keys_count * thread / kThreads);
+    const size_t kEnd(keys_count * (thread + 1) / kThreads);
+    shares.push_back(std::async(std::launch::async, [kBegin, kEnd] {
+      KeysVector keys;
+      for (size_t i(kBegin); i != kEnd; ++i) {
+        try {
+          keys.emplace_back(maidsafe::passport::detail::AnmaidToPmid());
+        }
+        catch (const std::exception& /*ex*/) {
+          LOG(kError) << "CreatePmids - Could not create ID #" << i;
+          break;
+        }
+      }
+      return keys;
+    }));
   }
-  return true;
+  for (auto& share : shares) {
+    KeysVector keys(share.get());
+    std::move(keys.begin(), keys.end(), std::back_inserter(all_keys));
+  }
+  return all_keys.size() == keys_count;
 }
 
 }  // unnamed namespace
@@ -94,19 +115,24 @@ int main(int argc, char* argv[]) {
   boost::system::error_code error_code;
 
   size_t pmids_count(12);
+  unsigned threads_count(std::max(1U, std::thread::hardware_concurrency()));
 
   try {
     // Options allowed only on command line
     po::options_description generic_options("Commands");
     generic_options.add_options()("help,h", "Print this help message")(
         "create,c", "Create pmids and write to file")("load,l", "Load pmids from file")(
-        "delete,d", "Delete pmids file")("print,p", "Print the list of pmids available");
+        "delete,d", "Delete pmids file")("print,p", "Print the list of pmids available")(
+        "key_store,k", "Create pmids as an indexed key store, which can be memory-mapped and read "
+        "one ID at a time; loading detects either format");
 
     // Options allowed both on command line and in config file
     po::options_description config_file_options("Configuration options");
     config_file_options.add_options()("pmids_count,n",
                                       po::value<size_t>(&pmids_count)->default_value(pmids_count),
                                       "Number of pmids to create")(
+        "threads,t", po::value<unsigned>(&threads_count)->default_value(threads_count),
+        "Number of threads creating pmids")(
         "pmids_path", po::value<std::string>()->default_value(fs::path(
                           fs::temp_directory_path(error_code) / "pmids_list.dat").string()),
         "Path to pmids file");
@@ -124,6 +150,7 @@ int main(int argc, char* argv[]) {
     bool do_load(variables_map.count("load") != 0);
     bool do_delete(variables_map.count("delete") != 0);
     bool do_print(variables_map.count("print") != 0);
+    bool key_store(variables_map.count("key_store") != 0);
 
     if (variables_map.count("help") || (!do_create && !do_load && !do_delete && !do_print)) {
       std::cout << cmdline_options << std::endl << "Commands are executed in this order: [c|l] p d"
@@ -135,9 +162,10 @@ int main(int argc, char* argv[]) {
     auto pmids_path(maidsafe::GetPathFromProgramOptions("pmids_path", variables_map, false, true));
 
     if (do_create) {
-      if (CreateKeys(pmids_count, all_keys)) {
+      if (CreateKeys(pmids_count, threads_count, all_keys)) {
         std::cout << "Created " << all_keys.size() << " fobs." << std::endl;
-        if (maidsafe::passport::detail::WriteKeyChainList(pmids_path, all_keys))
+        if (key_store ? maidsafe::routing::test::KeyStore::Write(pmids_path, all_keys)
+                      : maidsafe::passport::detail::WriteKeyChainList(pmids_path, all_keys))
           std::cout << "Wrote pmids to " << pmids_path << std::endl;
         else
           std::cout << "Could not write pmids to " << pmids_path << std::endl;
@@ -146,7 +174,10 @@ int main(int argc, char* argv[]) {
       }
     } else if (do_load) {
       try {
-        all_keys = maidsafe::passport::detail::ReadKeyChainList(pmids_path);
+        if (maidsafe::routing::test::KeyStore::IsKeyStore(pmids_path))
+          all_keys = maidsafe::routing::test::KeyStore(pmids_path).GetAll();
+        else
+          all_keys = maidsafe::passport::detail::ReadKeyChainList(pmids_path);
         std::cout << "Loaded " << all_keys.size() << " pmids from " << pmids_path << std::endl;
       }
       catch (const std::exception& /*ex*/) {
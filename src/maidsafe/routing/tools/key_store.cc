@@ -0,0 +1,161 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tools/key_store.h"
+
+#include <algorithm>
+#include <fstream>  // NOLINT
+#include <stdexcept>
+#include <string>
+
+#include "boost/filesystem/operations.hpp"
+
+#include "maidsafe/passport/detail/fob.h"
+#include "maidsafe/passport/detail/passport.pb.h"
+
+namespace fs = boost::filesystem;
+namespace bi = boost::interprocess;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+const char kMagic[] = {'M', 'S', 'K', 'E', 'Y', 'S', '\0', '\1'};
+const size_t kMagicSize(sizeof(kMagic));
+const size_t kHeaderSize(kMagicSize + 8);
+
+void AppendUint(uint64_t value, size_t bytes, std::string& output) {
+  for (size_t i(0); i != bytes; ++i)
+    output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint64_t ReadUint(const char* input, size_t bytes) {
+  uint64_t value(0);
+  for (size_t i(0); i != bytes; ++i)
+    value |= static_cast<uint64_t>(static_cast<unsigned char>(input[i])) << (8 * i);
+  return value;
+}
+
+template <typename FobType>
+void AppendFob(const FobType& fob, std::string& output) {
+  passport::detail::protobuf::Fob proto_fob;
+  fob.ToProtobuf(&proto_fob);
+  const std::string kSerialised(proto_fob.SerializeAsString());
+  AppendUint(kSerialised.size(), 4, output);
+  output.append(kSerialised);
+}
+
+// Reads the fob at |position| in [|begin|, |end|), leaving |position| after it.
+template <typename FobType>
+FobType ReadFob(const char* begin, const char* end, const char*& position) {
+  if (end - position < 4)
+    throw std::runtime_error("Key store truncated");
+  const uint64_t kSize(ReadUint(position, 4));
+  position += 4;
+  passport::detail::protobuf::Fob proto_fob;
+  if (static_cast<uint64_t>(end - position) < kSize ||
+      !proto_fob.ParseFromArray(position, static_cast<int>(kSize)))
+    throw std::runtime_error("Key store has a malformed fob at offset " +
+                             std::to_string(position - begin));
+  position += kSize;
+  return FobType(proto_fob);
+}
+
+}  // unnamed namespace
+
+bool KeyStore::Write(const fs::path& path,
+                     const std::vector<passport::detail::AnmaidToPmid>& keys) {
+  std::string records;
+  std::vector<uint64_t> offsets;
+  const uint64_t kRecordsBegin(kHeaderSize + 8 * keys.size());
+  for (const auto& key : keys) {
+    offsets.push_back(kRecordsBegin + records.size());
+    AppendFob(key.anmaid, records);
+    AppendFob(key.maid, records);
+    AppendFob(key.anpmid, records);
+    AppendFob(key.pmid, records);
+  }
+  std::string header(kMagic, kMagicSize);
+  AppendUint(keys.size(), 8, header);
+  for (const auto offset : offsets)
+    AppendUint(offset, 8, header);
+
+  std::ofstream stream(path.string().c_str(), std::ios::binary | std::ios::trunc);
+  stream.write(header.data(), header.size());
+  stream.write(records.data(), records.size());
+  return stream.good();
+}
+
+bool KeyStore::IsKeyStore(const fs::path& path) {
+  std::ifstream stream(path.string().c_str(), std::ios::binary);
+  char magic[kMagicSize];
+  return stream.read(magic, kMagicSize) && std::equal(magic, magic + kMagicSize, kMagic);
+}
+
+KeyStore::KeyStore(const fs::path& path)
+    : file_(), region_(), data_(nullptr), size_(0), count_(0) {
+  try {
+    file_ = bi::file_mapping(path.string().c_str(), bi::read_only);
+    region_ = bi::mapped_region(file_, bi::read_only);
+  }
+  catch (const bi::interprocess_exception& e) {
+    throw std::runtime_error("Failed to map key store " + path.string() + ": " + e.what());
+  }
+  data_ = static_cast<const char*>(region_.get_address());
+  size_ = region_.get_size();
+  if (size_ < kHeaderSize || !std::equal(data_, data_ + kMagicSize, kMagic))
+    throw std::runtime_error(path.string() + " is not a key store");
+  count_ = ReadUint(data_ + kMagicSize, 8);
+  if (count_ > (size_ - kHeaderSize) / 8)
+    throw std::runtime_error("Key store " + path.string() + " has a truncated index");
+}
+
+passport::detail::AnmaidToPmid KeyStore::Get(size_t index) const {
+  if (index >= count_)
+    throw std::out_of_range("Key store has no key chain #" + std::to_string(index));
+  const char* const kIndex(data_ + kHeaderSize);
+  const uint64_t kBegin(ReadUint(kIndex + 8 * index, 8));
+  const uint64_t kEnd(index + 1 == count_ ? size_ : ReadUint(kIndex + 8 * (index + 1), 8));
+  if (kBegin < kHeaderSize + 8 * count_ || kBegin > kEnd || kEnd > size_)
+    throw std::runtime_error("Key store has a malformed index entry #" + std::to_string(index));
+  const char* position(data_ + kBegin);
+  const char* const kRecordEnd(data_ + kEnd);
+  passport::Anmaid anmaid(ReadFob<passport::Anmaid>(data_, kRecordEnd, position));
+  passport::Maid maid(ReadFob<passport::Maid>(data_, kRecordEnd, position));
+  passport::Anpmid anpmid(ReadFob<passport::Anpmid>(data_, kRecordEnd, position));
+  passport::Pmid pmid(ReadFob<passport::Pmid>(data_, kRecordEnd, position));
+  return passport::detail::AnmaidToPmid(anmaid, maid, anpmid, pmid);
+}
+
+std::vector<passport::detail::AnmaidToPmid> KeyStore::GetAll() const {
+  std::vector<passport::detail::AnmaidToPmid> keys;
+  keys.reserve(size());
+  for (size_t index(0); index != size(); ++index)
+    keys.push_back(Get(index));
+  return keys;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
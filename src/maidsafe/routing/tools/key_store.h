@@ -0,0 +1,77 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_KEY_STORE_H_
+#define MAIDSAFE_ROUTING_TOOLS_KEY_STORE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "boost/filesystem/path.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+
+#include "maidsafe/passport/types.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// A file of key chains with an index of where each starts, which is memory-mapped so that any one
+// of them can be read without reading or parsing the rest.  After an 8-byte magic string and the
+// count of key chains, each a little-endian uint64, come the key chains' offsets from the start of
+// the file, then the key chains themselves: the anmaid's, maid's, anpmid's and pmid's serialised
+// protobuf::Fob, each after its size as a little-endian uint32.
+class KeyStore {
+ public:
+  // Writes |keys| to |path| as a key store, replacing whatever was there.
+  static bool Write(const boost::filesystem::path& path,
+                    const std::vector<passport::detail::AnmaidToPmid>& keys);
+  // Whether |path| is a key store rather than e.g. a passport::detail::WriteKeyChainList file.
+  static bool IsKeyStore(const boost::filesystem::path& path);
+
+  // Throws std::runtime_error if |path| can't be mapped or isn't a well-formed key store.
+  explicit KeyStore(const boost::filesystem::path& path);
+
+  size_t size() const { return static_cast<size_t>(count_); }
+  // Throws std::out_of_range if |index| isn't below size(), or std::runtime_error if the key chain
+  // there is malformed.
+  passport::detail::AnmaidToPmid Get(size_t index) const;
+  std::vector<passport::detail::AnmaidToPmid> GetAll() const;
+
+ private:
+  KeyStore(const KeyStore&);
+  KeyStore& operator=(const KeyStore&);
+
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  const char* data_;
+  size_t size_;
+  uint64_t count_;
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_KEY_STORE_H_
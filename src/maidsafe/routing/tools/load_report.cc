@@ -0,0 +1,142 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tools/load_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+const double kReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+const char* const kReportedNames[] = {"p50", "p90", "p99", "p99.9"};
+
+std::string SizesString(const std::vector<size_t>& sizes, char separator) {
+  std::ostringstream stream;
+  for (size_t i(0); i != sizes.size(); ++i)
+    stream << (i == 0 ? "" : std::string(1, separator)) << sizes[i];
+  return stream.str();
+}
+
+std::string CsvQuote(const std::string& input) {
+  std::string output("\"");
+  for (const char c : input)
+    output += (c == '"' ? "\"\"" : std::string(1, c));
+  return output + '"';
+}
+
+std::string JsonEscape(const std::string& input) {
+  std::string output;
+  for (const char c : input) {
+    if (c == '"' || c == '\\')
+      output += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      output += c;
+  }
+  return output;
+}
+
+double Seconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+}
+
+}  // unnamed namespace
+
+LoadProfile::LoadProfile()
+    : rate(10.0),
+      duration(std::chrono::seconds(10)),
+      concurrency(100),
+      direct_fraction(1.0),
+      message_sizes(1, 1024),
+      label() {}
+
+LoadReport::LoadReport()
+    : profile(),
+      scheduled(0),
+      sent(0),
+      completed(0),
+      timed_out(0),
+      skipped(0),
+      elapsed(std::chrono::steady_clock::duration::zero()),
+      latencies() {}
+
+std::chrono::microseconds LoadReport::Percentile(double percent) const {
+  if (latencies.empty())
+    return std::chrono::microseconds(0);
+  // Nearest rank, allowing for e.g. 99.9% of 1000 not being exactly 999 in floating point
+  size_t rank(static_cast<size_t>(std::ceil(percent / 100.0 * latencies.size() - 1e-9)));
+  return latencies[rank == 0 ? 0 : std::min(rank, latencies.size()) - 1];
+}
+
+double LoadReport::Throughput() const {
+  const double kSeconds(Seconds(elapsed));
+  return kSeconds > 0 ? completed / kSeconds : 0.0;
+}
+
+std::string LoadReport::CsvHeader() {
+  std::string header("label,rate,duration_s,concurrency,direct_fraction,sizes,scheduled,sent,"
+                     "completed,timed_out,skipped,elapsed_s,throughput");
+  for (const char* name : kReportedNames)
+    header += std::string(",") + name + "_us";
+  return header;
+}
+
+std::string LoadReport::ToCsv() const {
+  std::ostringstream stream;
+  // The label is quoted, and the sizes separated by ';', to keep to one field each.
+  stream << CsvQuote(profile.label) << ',' << profile.rate << ',' << profile.duration.count() << ','
+         << profile.concurrency << ',' << profile.direct_fraction << ','
+         << SizesString(profile.message_sizes, ';') << ',' << scheduled << ',' << sent << ','
+         << completed << ',' << timed_out << ',' << skipped << ',' << Seconds(elapsed) << ','
+         << Throughput();
+  for (const double percent : kReportedPercentiles)
+    stream << ',' << Percentile(percent).count();
+  return stream.str();
+}
+
+std::string LoadReport::ToJson() const {
+  std::ostringstream stream;
+  stream << "{\"label\": \"" << JsonEscape(profile.label) << "\", \"rate\": " << profile.rate
+         << ", \"duration_s\": " << profile.duration.count()
+         << ", \"concurrency\": " << profile.concurrency
+         << ", \"direct_fraction\": " << profile.direct_fraction << ", \"sizes\": ["
+         << SizesString(profile.message_sizes, ',') << "], \"scheduled\": " << scheduled
+         << ", \"sent\": " << sent << ", \"completed\": " << completed
+         << ", \"timed_out\": " << timed_out << ", \"skipped\": " << skipped
+         << ", \"elapsed_s\": " << Seconds(elapsed) << ", \"throughput\": " << Throughput()
+         << ", \"latency_us\": {";
+  for (size_t i(0); i != sizeof(kReportedNames) / sizeof(kReportedNames[0]); ++i) {
+    stream << (i == 0 ? "" : ", ") << '"' << kReportedNames[i]
+           << "\": " << Percentile(kReportedPercentiles[i]).count();
+  }
+  stream << "}}";
+  return stream.str();
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
@@ -0,0 +1,73 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_LOAD_REPORT_H_
+#define MAIDSAFE_ROUTING_TOOLS_LOAD_REPORT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// What the "loadtest" command offers the network: messages at a fixed rate for |duration|,
+// regardless of how quickly earlier ones are answered, with at most |concurrency| outstanding.
+struct LoadProfile {
+  LoadProfile();
+  double rate;  // messages per second
+  std::chrono::seconds duration;
+  size_t concurrency;
+  // Chance of each message being sent direct rather than to a group.
+  double direct_fraction;
+  // Each message's size is picked from these at random.
+  std::vector<size_t> message_sizes;
+  // Copied to the report, to tell runs apart, e.g. by release.
+  std::string label;
+};
+
+// How the messages of a load test fared.  Latencies are measured from when each message was due
+// to be sent, not when it was, so that a slow sender doesn't hide its own queueing.
+struct LoadReport {
+  LoadReport();
+  // The latency below which |percent| of the completed messages' latencies lie.
+  std::chrono::microseconds Percentile(double percent) const;
+  double Throughput() const;  // completed messages per second
+  static std::string CsvHeader();
+  std::string ToCsv() const;
+  std::string ToJson() const;
+
+  LoadProfile profile;
+  // Messages due, sent, answered in full, and not answered in full in time.  Those due while
+  // |profile.concurrency| were outstanding are skipped rather than sent.
+  uint64_t scheduled, sent, completed, timed_out, skipped;
+  std::chrono::steady_clock::duration elapsed;
+  std::vector<std::chrono::microseconds> latencies;  // of completed messages, in ascending order
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_LOAD_REPORT_H_
@@ -0,0 +1,365 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/tools/metrics_exporter.h"
+
+#include <iomanip>
+#include <istream>
+#include <sstream>
+#include <utility>
+
+#include "boost/asio/read_until.hpp"
+#include "boost/asio/streambuf.hpp"
+#include "boost/asio/write.hpp"
+
+#include "maidsafe/common/log.h"
+
+namespace asio = boost::asio;
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+namespace {
+
+const char* const kCacheKindNames[CacheStatistics::kKindCount] = {
+    "single_to_single", "single_to_group", "group_to_single", "group_to_group"};
+const char* const kSizeClassNames[RoutingStatistics::kRequestSizeClassCount] = {
+    "1KiB", "16KiB", "256KiB", "larger"};
+// Requests larger than this are refused unread; "GET /metrics" needs nothing like it.
+const size_t kMaxRequestSize(8192);
+
+std::string MessageTypeName(int32_t type) {
+  switch (type) {
+    case 1: return "ping";
+    case 2: return "connect";
+    case 3: return "find_nodes";
+    case 4: return "connect_success";
+    case 5: return "connect_success_acknowledgement";
+    case 6: return "remove";
+    case 7: return "close_node_update";
+    case 8: return "get_group";
+    case 101: return "node_level";
+    default: return "unknown";
+  }
+}
+
+std::string LabelEscape(const std::string& input) {
+  std::string output;
+  for (const char c : input) {
+    if (c == '\\' || c == '"')
+      output += '\\';
+    output += (c == '\n' ? std::string("\\n") : std::string(1, c));
+  }
+  return output;
+}
+
+class Writer {
+ public:
+  Writer() : stream_() { stream_ << std::setprecision(12); }
+
+  void Describe(const std::string& name, const std::string& type, const std::string& help) {
+    stream_ << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+  }
+
+  template <typename T>
+  void Value(const std::string& name, const std::string& labels, T value) {
+    stream_ << name;
+    if (!labels.empty())
+      stream_ << '{' << labels << '}';
+    stream_ << ' ' << value << '\n';
+  }
+
+  // Every 8th bucket, so at each doubling, rather than all 208 of them.  The last bucket also
+  // holds the values beyond it, so only +Inf stands for it.
+  void Histogram(const std::string& name, const std::string& labels,
+                 const LatencyHistogram& histogram) {
+    const std::string kSeparator(labels.empty() ? "" : ",");
+    const int kStride(1 << LatencyHistogram::kSubBucketBits);
+    uint64_t cumulative(0);
+    for (int index(0); index != LatencyHistogram::kBucketCount - 1; ++index) {
+      cumulative += histogram.buckets[index];
+      if (index % kStride != kStride - 1)
+        continue;
+      std::ostringstream bound;
+      bound << std::setprecision(12)
+            << LatencyHistogram::BucketUpperBound(index).count() / 1000000.0;
+      Value(name + "_bucket", labels + kSeparator + "le=\"" + bound.str() + '"', cumulative);
+    }
+    Value(name + "_bucket", labels + kSeparator + "le=\"+Inf\"", histogram.count);
+    Value(name + "_count", labels, histogram.count);
+  }
+
+  std::string str() const { return stream_.str(); }
+
+ private:
+  std::ostringstream stream_;
+};
+
+void WriteMessageCounters(Writer& writer, const RoutingStatistics& routing) {
+  struct Field {
+    const char* name;
+    uint64_t MessageTypeCounters::* counter;
+    const char* help;
+  };
+  const Field kFields[] = {
+      {"received", &MessageTypeCounters::received, "Messages received from peers."},
+      {"received_bytes", &MessageTypeCounters::bytes_received, "Bytes received from peers."},
+      {"dropped_duplicate", &MessageTypeCounters::dropped_duplicate,
+       "Received messages dropped as seen before."},
+      {"dropped_hops_to_live", &MessageTypeCounters::dropped_hops_to_live,
+       "Received messages dropped as out of hops."},
+      {"dropped_expired", &MessageTypeCounters::dropped_expired,
+       "Received messages dropped as past their origin's deadline."},
+      {"dropped_invalid", &MessageTypeCounters::dropped_invalid,
+       "Received messages dropped as otherwise invalid."},
+      {"handled_locally", &MessageTypeCounters::handled_locally,
+       "Received messages for this node or its group."},
+      {"forwarded", &MessageTypeCounters::forwarded, "Received messages passed on."},
+      {"sent", &MessageTypeCounters::sent, "Messages sent to peers, each hop counting once."},
+      {"sent_bytes", &MessageTypeCounters::bytes_sent, "Bytes sent to peers."},
+      {"send_failures", &MessageTypeCounters::send_failures,
+       "Messages sent which the transport reported lost."}};
+  for (const auto& field : kFields) {
+    const std::string kName(std::string("maidsafe_routing_messages_") + field.name + "_total");
+    writer.Describe(kName, "counter", field.help);
+    for (const auto& type : routing.by_type) {
+      writer.Value(kName, "type=\"" + MessageTypeName(type.first) + '"',
+                   type.second.*field.counter);
+    }
+  }
+  writer.Describe("maidsafe_routing_response_latency_seconds", "histogram",
+                  "From each request being sent to each response to it arriving.");
+  writer.Histogram("maidsafe_routing_response_latency_seconds", "", routing.response_latency);
+}
+
+void WriteRequestStatistics(Writer& writer, const RoutingStatistics& routing) {
+  struct Field {
+    const char* name;
+    uint64_t RequestStatistics::* counter;
+    const char* help;
+  };
+  const Field kFields[] = {
+      {"completed", &RequestStatistics::completed, "Requests having had every response."},
+      {"timed_out", &RequestStatistics::timed_out, "Requests timed out."},
+      {"timed_out_partially_answered", &RequestStatistics::timed_out_partially_answered,
+       "Requests timed out having had some responses."},
+      {"cancelled", &RequestStatistics::cancelled, "Requests cancelled."},
+      {"responses", &RequestStatistics::responses, "Responses to requests."},
+      {"expected_responses", &RequestStatistics::expected_responses,
+       "Responses requests expected."}};
+  auto for_each_class([&](const std::function<void(const std::string&,
+                                                   const RequestStatistics&)>& functor) {
+    for (int size_class(0); size_class != RoutingStatistics::kRequestSizeClassCount;
+         ++size_class) {
+      const std::string kSize(std::string("size=\"") + kSizeClassNames[size_class] + '"');
+      functor("destination=\"direct\"," + kSize, routing.direct_requests[size_class]);
+      functor("destination=\"group\"," + kSize, routing.group_requests[size_class]);
+    }
+  });
+  for (const auto& field : kFields) {
+    const std::string kName(std::string("maidsafe_routing_requests_") + field.name + "_total");
+    writer.Describe(kName, "counter", field.help);
+    for_each_class([&](const std::string& labels, const RequestStatistics& requests) {
+      writer.Value(kName, labels, requests.*field.counter);
+    });
+  }
+  writer.Describe("maidsafe_routing_request_completion_latency_seconds", "histogram",
+                  "From sending each completed request to its last response arriving.");
+  for_each_class([&](const std::string& labels, const RequestStatistics& requests) {
+    writer.Histogram("maidsafe_routing_request_completion_latency_seconds", labels,
+                     requests.completion_latency);
+  });
+}
+
+void WriteCacheStatistics(Writer& writer, const CacheStatistics& cache) {
+  struct Field {
+    const char* name;
+    uint64_t CacheCounters::* counter;
+    const char* help;
+  };
+  const Field kFields[] = {
+      {"lookups", &CacheCounters::lookups, "Cacheable gets checked against the caches."},
+      {"hits", &CacheCounters::hits, "Cacheable gets answered from a cache."},
+      {"misses", &CacheCounters::misses, "Cacheable gets answered by no cache."},
+      {"timeouts", &CacheCounters::timeouts, "Misses the application gave no answer to in time."},
+      {"served_bytes", &CacheCounters::bytes_served, "Cached reply bytes sent."},
+      {"evictions", &CacheCounters::evictions, "Built-in cache entries displaced."},
+      {"coalesced", &CacheCounters::coalesced, "Misses held back behind an identical get."}};
+  for (const auto& field : kFields) {
+    const std::string kName(std::string("maidsafe_routing_cache_") + field.name + "_total");
+    writer.Describe(kName, "counter", field.help);
+    for (int kind(0); kind != CacheStatistics::kKindCount; ++kind) {
+      writer.Value(kName, std::string("kind=\"") + kCacheKindNames[kind] + '"',
+                   cache.by_kind[kind].*field.counter);
+    }
+  }
+}
+
+void WriteLockStatistics(Writer& writer, const std::vector<LockStatistics>& locks) {
+  if (locks.empty())
+    return;
+  writer.Describe("maidsafe_routing_lock_acquisitions_total", "counter", "Lock acquisitions.");
+  for (const auto& lock : locks)
+    writer.Value("maidsafe_routing_lock_acquisitions_total",
+                 "lock=\"" + LabelEscape(lock.name) + '"', lock.acquisitions);
+  writer.Describe("maidsafe_routing_lock_contended_acquisitions_total", "counter",
+                  "Lock acquisitions finding the lock already held.");
+  for (const auto& lock : locks)
+    writer.Value("maidsafe_routing_lock_contended_acquisitions_total",
+                 "lock=\"" + LabelEscape(lock.name) + '"', lock.contended_acquisitions);
+  writer.Describe("maidsafe_routing_lock_wait_seconds_total", "counter",
+                  "Time spent waiting for locks.");
+  for (const auto& lock : locks)
+    writer.Value("maidsafe_routing_lock_wait_seconds_total",
+                 "lock=\"" + LabelEscape(lock.name) + '"', lock.wait_time.count() / 1e9);
+  writer.Describe("maidsafe_routing_lock_hold_seconds_total", "counter",
+                  "Time locks were held for.");
+  for (const auto& lock : locks)
+    writer.Value("maidsafe_routing_lock_hold_seconds_total",
+                 "lock=\"" + LabelEscape(lock.name) + '"', lock.hold_time.count() / 1e9);
+}
+
+}  // unnamed namespace
+
+struct MetricsExporter::Connection {
+  explicit Connection(asio::io_service& io_service)
+      : socket(io_service), request(kMaxRequestSize), response() {}
+  asio::ip::tcp::socket socket;
+  asio::streambuf request;
+  std::string response;
+};
+
+MetricsSample::MetricsSample()
+    : network_status(0), routing_table_size(0), inbound_queue_depths(), cache(), routing() {}
+
+std::string PrometheusText(const MetricsSample& sample) {
+  Writer writer;
+  writer.Describe("maidsafe_routing_network_status", "gauge",
+                  "Network health from 0 to 100, or a negative error.");
+  writer.Value("maidsafe_routing_network_status", "", sample.network_status);
+  writer.Describe("maidsafe_routing_table_size", "gauge", "Nodes in the routing table.");
+  writer.Value("maidsafe_routing_table_size", "", sample.routing_table_size);
+  writer.Describe("maidsafe_routing_inbound_queue_depth", "gauge",
+                  "Received messages waiting to be handled, by queue.");
+  for (size_t index(0); index != sample.inbound_queue_depths.size(); ++index) {
+    const bool kControl(index + 1 == sample.inbound_queue_depths.size());
+    std::ostringstream queue;
+    queue << "queue=\"" << (kControl ? std::string("control") : std::to_string(index)) << '"';
+    writer.Value("maidsafe_routing_inbound_queue_depth", queue.str(),
+                 sample.inbound_queue_depths[index]);
+  }
+  WriteMessageCounters(writer, sample.routing);
+  WriteRequestStatistics(writer, sample.routing);
+  WriteCacheStatistics(writer, sample.cache);
+  WriteLockStatistics(writer, sample.routing.locks);
+  return writer.str();
+}
+
+MetricsExporter::MetricsExporter(uint16_t port, Sampler sampler,
+                                 std::chrono::milliseconds interval)
+    : sampler_(std::move(sampler)),
+      kInterval_(interval),
+      io_service_(),
+      acceptor_(io_service_, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), port)),
+      timer_(io_service_),
+      mutex_(),
+      text_(),
+      thread_() {
+  io_service_.post([this] { Sample(); });
+  Accept();
+  thread_ = std::thread([this] { io_service_.run(); });
+}
+
+MetricsExporter::~MetricsExporter() {
+  io_service_.stop();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+uint16_t MetricsExporter::port() const { return acceptor_.local_endpoint().port(); }
+
+void MetricsExporter::Sample() {
+  try {
+    std::string text(PrometheusText(sampler_()));
+    std::lock_guard<std::mutex> lock(mutex_);
+    text_.swap(text);
+  }
+  catch (const std::exception& e) {
+    LOG(kError) << "Failed to sample metrics: " << e.what();
+  }
+  timer_.expires_from_now(kInterval_);
+  timer_.async_wait([this](const boost::system::error_code& error) {
+    if (error != asio::error::operation_aborted)
+      Sample();
+  });
+}
+
+void MetricsExporter::Accept() {
+  std::shared_ptr<Connection> connection(std::make_shared<Connection>(io_service_));
+  acceptor_.async_accept(connection->socket,
+                         [this, connection](const boost::system::error_code& error) {
+    if (error == asio::error::operation_aborted)
+      return;
+    if (!error)
+      Respond(connection);
+    Accept();
+  });
+}
+
+void MetricsExporter::Respond(std::shared_ptr<Connection> connection) {
+  asio::async_read_until(connection->socket, connection->request, "\r\n\r\n",
+                         [this, connection](const boost::system::error_code& error, size_t) {
+    std::string status("400 Bad Request"), body;
+    if (!error) {
+      std::istream request(&connection->request);
+      std::string method, target;
+      request >> method >> target;
+      if (method != "GET") {
+        status = "405 Method Not Allowed";
+      } else if (target != "/metrics") {
+        status = "404 Not Found";
+      } else {
+        body = Text();
+        status = body.empty() ? "503 Service Unavailable" : "200 OK";
+      }
+    }
+    std::ostringstream response;
+    response << "HTTP/1.0 " << status << "\r\nContent-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\nConnection: close\r\n\r\n" << body;
+    connection->response = response.str();
+    asio::async_write(connection->socket, asio::buffer(connection->response),
+                      [connection](const boost::system::error_code&, size_t) {
+      boost::system::error_code ignored;
+      connection->socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+    });
+  });
+}
+
+std::string MetricsExporter::Text() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return text_;
+}
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
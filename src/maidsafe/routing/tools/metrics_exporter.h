@@ -0,0 +1,98 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_METRICS_EXPORTER_H_
+#define MAIDSAFE_ROUTING_TOOLS_METRICS_EXPORTER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+#include "maidsafe/routing/api_config.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace test {
+
+// One reading of everything the exporter publishes about a node.
+struct MetricsSample {
+  MetricsSample();
+
+  int network_status;
+  size_t routing_table_size;
+  std::vector<size_t> inbound_queue_depths;  // as Routing::InboundQueueDepths gives them
+  CacheStatistics cache;
+  RoutingStatistics routing;
+};
+
+// |sample| in Prometheus' text exposition format.  Everything counted since the node started is
+// a counter, so message rates are for the scraper to take, e.g. with rate().
+std::string PrometheusText(const MetricsSample& sample);
+
+// Serves the latest sample as PrometheusText to "GET /metrics" over HTTP on 127.0.0.1:|port|.
+// Sampling is done every |interval| on the exporter's own thread and scrapes are answered from the
+// last one taken, so however often it's scraped, routing's threads only ever see |sampler| called
+// at that rate.
+class MetricsExporter {
+ public:
+  typedef std::function<MetricsSample()> Sampler;
+
+  MetricsExporter(uint16_t port, Sampler sampler, std::chrono::milliseconds interval);
+  ~MetricsExporter();
+  // The port actually bound, which is picked by the OS when 0 was asked for.
+  uint16_t port() const;
+
+ private:
+  struct Connection;
+
+  MetricsExporter(const MetricsExporter&);
+  MetricsExporter& operator=(const MetricsExporter&);
+
+  void Sample();
+  void Accept();
+  void Respond(std::shared_ptr<Connection> connection);
+  std::string Text() const;
+
+  Sampler sampler_;
+  const std::chrono::milliseconds kInterval_;
+  boost::asio::io_service io_service_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+  boost::asio::steady_timer timer_;
+  mutable std::mutex mutex_;
+  std::string text_;
+  std::thread thread_;
+};
+
+}  // namespace test
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_METRICS_EXPORTER_H_
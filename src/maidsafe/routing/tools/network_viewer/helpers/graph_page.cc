@@ -19,10 +19,13 @@
 #include "helpers/graph_page.h"
 
 #include <limits>
+#include <map>
 #include <vector>
 
 #include "maidsafe/common/tools/network_viewer.h"
 
+#include "models/matrix_receiver.h"
+
 namespace maidsafe {
 
 GraphPage::GraphPage(std::shared_ptr<APIHelper> api_helper, QObject* parent)
@@ -31,7 +34,9 @@ GraphPage::GraphPage(std::shared_ptr<APIHelper> api_helper, QObject* parent)
       current_graph_data_(),
       current_parent_id_(),
       is_data_node_(false),
-      expanded_children_() {
+      expanded_children_(),
+      expanded_clusters_(),
+      rendered_state_id_(-1) {
   QFile frame_template(":/index.html");
   frame_template.open(QFile::ReadOnly | QIODevice::Text);
   mainFrame()->setHtml(QLatin1String(frame_template.readAll()));
@@ -42,8 +47,11 @@ void GraphPage::RenderGraph(int state_id, std::string parent_id, bool is_data_no
   expanded_children_.clear();
   current_parent_id_ = parent_id;
   is_data_node_ = is_data_node;
-  if (parent_id.empty())
+  rendered_state_id_ = api_helper_->CurrentState();
+  if (parent_id.empty()) {
+    RenderClusters();
     return;
+  }
   RenderNode(state_id, parent_id, true, is_data_node);
 }
 
@@ -51,6 +59,28 @@ void GraphPage::javaScriptAlert(QWebFrame* /*frame*/, const QString& msg) {
   QStringList message_parts(msg.split("-"));
   if (message_parts.count() < 2)
     return;
+  if (current_parent_id_.empty()) {
+    // In the overview, a click splits a cluster and a double click merges it back into its parent.
+    // A lone node opens in a view of its own.
+    std::string name(message_parts.at(1).toStdString());
+    const std::string kClusterName(kClusterNamePrefix);
+    if (name.compare(0, kClusterName.size(), kClusterName) != 0) {
+      if (message_parts.at(0) == "click" || message_parts.at(0) == "newview")
+        emit RequestNewGraphView(message_parts.at(1));
+      return;
+    }
+    std::string prefix(name.substr(kClusterName.size()));
+    if (message_parts.at(0) == "click") {
+      expanded_clusters_.insert(prefix);
+    } else if (message_parts.at(0) == "dblclick" && !prefix.empty()) {
+      prefix.pop_back();
+      auto itr(expanded_clusters_.lower_bound(prefix));
+      while (itr != expanded_clusters_.end() && itr->compare(0, prefix.size(), prefix) == 0)
+        itr = expanded_clusters_.erase(itr);
+    }
+    RenderClusters();
+    return;
+  }
   if (message_parts.at(0) == "click") {
     std::string node_id(message_parts.at(1).toStdString());
     if (expanded_children_.contains(node_id)) {
@@ -68,6 +98,19 @@ void GraphPage::javaScriptAlert(QWebFrame* /*frame*/, const QString& msg) {
 }
 
 void GraphPage::RefreshGraph(int state_id) {
+  if (current_parent_id_.empty()) {
+    RenderClusters();
+    return;
+  }
+  // Only the drawn nodes' rows matter; the rest of the network's updates are skipped.
+  bool changed(state_id < 0 || api_helper_->ChangedSince(rendered_state_id_, current_parent_id_));
+  foreach(std::string node_id, expanded_children_) {
+    changed = changed || api_helper_->ChangedSince(rendered_state_id_, node_id);
+  }
+  if (state_id >= 0)
+    rendered_state_id_ = state_id;
+  if (!changed)
+    return;
   RenderNode(state_id, current_parent_id_, true, is_data_node_);
   foreach(std::string node_id, expanded_children_) { RenderNode(state_id, node_id, false, false); }
 }
@@ -103,6 +146,39 @@ void GraphPage::RenderNode(int state_id, std::string node_id, bool is_parent, bo
   SetGraphContents(graph_contents);
 }
 
+void GraphPage::RenderClusters() {
+  std::vector<ViewerCluster> clusters(api_helper_->GetClusters(expanded_clusters_));
+  // Clusters newly split off are placed by the page next to the cluster they came from.
+  QString graph_contents;
+  std::map<std::string, size_t> links;
+  for (const auto& cluster : clusters) {
+    QString q_name(QString::fromStdString(cluster.name));
+    graph_contents.append(QString("%1 {clusterSize:%2, churn:%3")
+                              .arg(q_name)
+                              .arg(QString::number(cluster.size))
+                              .arg(QString::number(cluster.churn_per_minute)));
+    if (!cluster.prefix.empty()) {
+      std::string parent(cluster.prefix.substr(0, cluster.prefix.size() - 1));
+      graph_contents.append(QString(", parentCluster:%1%2")
+                                .arg(kClusterNamePrefix)
+                                .arg(QString::fromStdString(parent)));
+    }
+    graph_contents.append("}\\n");
+    // Links both ways between a pair of clusters are drawn as one edge.
+    for (const auto& link : cluster.links) {
+      std::string key(cluster.name < link.first ? cluster.name + " -> " + link.first
+                                                : link.first + " -> " + cluster.name);
+      links[key] += link.second;
+    }
+  }
+  for (const auto& link : links) {
+    graph_contents.append(QString("%1 {linkCount:%2}\\n")
+                              .arg(QString::fromStdString(link.first))
+                              .arg(QString::number(link.second)));
+  }
+  SetGraphContents(graph_contents);
+}
+
 QString GraphPage::CreateEdge(std::string parent_id, const Node& child_node,
                               QString* current_content) {
   QString q_parent_id(QString::fromStdString(parent_id));
@@ -21,6 +21,7 @@
 
 // std
 #include <memory>
+#include <set>
 #include <string>
 
 #include "helpers/qt_push_headers.h"
@@ -30,11 +31,8 @@
 
 namespace maidsafe {
 
-namespace network_viewer {
-struct ViewableNode;
-}
-
 class APIHelper;
+struct ViewerNode;
 
 class GraphPage : public QWebPage {
   Q_OBJECT
@@ -54,9 +52,11 @@ class GraphPage : public QWebPage {
 slots:  // NOLINT - Viv
   void RefreshGraph(int state_id);
   void RenderNode(int state_id, std::string node_id, bool is_parent, bool is_data_node);
+  // Draws the whole network as clusters of nodes, when no node is chosen.
+  void RenderClusters();
 
  private:
-  typedef network_viewer::ViewableNode Node;
+  typedef ViewerNode Node;
   GraphPage(const GraphPage&);
   GraphPage& operator=(const GraphPage&);
   QString CreateEdge(std::string parent_id, const Node& child_node, QString* current_content);
@@ -69,6 +69,10 @@ slots:  // NOLINT - Viv
   std::string current_parent_id_;
   bool is_data_node_;
   QList<std::string> expanded_children_;
+  // Prefixes of the clusters the overview shows split
+  std::set<std::string> expanded_clusters_;
+  // The state the graph was last drawn from, so that updates to other nodes don't redraw it
+  int rendered_state_id_;
 };
 
 }  // namespace maidsafe
@@ -19,34 +19,58 @@
 #include "models/api_helper.h"
 
 #include <chrono>
+#include <limits>
 
 #include "helpers/qt_push_headers.h"
 #include "helpers/qt_pop_headers.h"
 
-#include "maidsafe/common/tools/network_viewer.h"
 #include "maidsafe/common/node_id.h"
 #include "maidsafe/common/utils.h"
 
+#include "models/matrix_receiver.h"
+
 namespace maidsafe {
 
-APIHelper::APIHelper(QObject* parent) : QObject(parent) {
-  network_viewer::SetUpdateFunctor([this](int state_id) { NetworkUpdated(state_id); });
-  network_viewer::Run(std::chrono::milliseconds(1000));
+namespace {
+
+// The overview divides the network into clusters of about this many nodes before any are expanded.
+const size_t kOverviewClusterSize(16);
+
+int ToStateId(uint64_t version) {
+  return static_cast<int>(version % static_cast<uint64_t>(std::numeric_limits<int>::max()));
 }
 
-APIHelper::~APIHelper() { network_viewer::Stop(); }
+}  // unnamed namespace
+
+APIHelper::APIHelper(QObject* parent)
+    : QObject(parent),
+      matrix_receiver_(new MatrixReceiver([this](uint64_t version) {
+                                            NetworkUpdated(ToStateId(version));
+                                          },
+                                          std::chrono::milliseconds(1000))) {}
+
+APIHelper::~APIHelper() {}
 
 std::vector<std::string> APIHelper::GetNodesInNetwork(int state_id) const {
   qDebug() << QString("APIHelper::GetNodesInNetwork for State: %1").arg(QString::number(state_id));
-  return network_viewer::GetNodesInNetwork(state_id);
+  return matrix_receiver_->Nodes();
 }
 
-std::vector<network_viewer::ViewableNode> APIHelper::GetCloseNodes(int state_id,
-                                                                   const std::string& id) const {
+std::vector<ViewerNode> APIHelper::GetCloseNodes(int state_id, const std::string& id) const {
   qDebug() << QString("APIHelper::GetCloseNodes for State: %1 Node: %2")
                   .arg(QString::number(state_id))
                   .arg(GetShortNodeId(id));
-  return network_viewer::GetCloseNodes(state_id, id);
+  return matrix_receiver_->CloseNodes(id);
+}
+
+std::vector<ViewerCluster> APIHelper::GetClusters(const std::set<std::string>& expanded) const {
+  return matrix_receiver_->Clusters(kOverviewClusterSize, expanded);
+}
+
+int APIHelper::CurrentState() const { return ToStateId(matrix_receiver_->version()); }
+
+bool APIHelper::ChangedSince(int state_id, const std::string& id) const {
+  return state_id < 0 || matrix_receiver_->ChangedSince(static_cast<uint64_t>(state_id), id);
 }
 
 void APIHelper::NetworkUpdated(int state_id) {
@@ -20,7 +20,9 @@
 #define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_API_HELPER_H_
 
 // std
+#include <cstdint>
 #include <memory>
+#include <set>
 #include <string>
 #include <functional>
 #include <vector>
@@ -30,10 +32,12 @@
 
 namespace maidsafe {
 
-namespace network_viewer {
-struct ViewableNode;
-}
+class MatrixReceiver;
+struct ViewerCluster;
+struct ViewerNode;
 
+// The network as last reported by its nodes.  A state_id is a version of the network, of which
+// only the current one (passed as -1, or as its version) is kept.
 class APIHelper : public QObject {
   Q_OBJECT
 
@@ -41,8 +45,13 @@ class APIHelper : public QObject {
   explicit APIHelper(QObject* parent = nullptr);
   ~APIHelper();
   std::vector<std::string> GetNodesInNetwork(int state_id) const;
-  std::vector<network_viewer::ViewableNode> GetCloseNodes(int state_id,
-                                                          const std::string& id) const;
+  std::vector<ViewerNode> GetCloseNodes(int state_id, const std::string& id) const;
+  // The overview of the current state, |expanded| naming the cluster prefixes to show in detail.
+  std::vector<ViewerCluster> GetClusters(const std::set<std::string>& expanded) const;
+  // The current state_id.
+  int CurrentState() const;
+  // Whether the close nodes of |id| have changed since |state_id| was current.
+  bool ChangedSince(int state_id, const std::string& id) const;
   void NetworkUpdated(int state_id);
   QString GetShortNodeId(std::string node_id) const;
 
@@ -54,6 +63,8 @@ class APIHelper : public QObject {
   APIHelper& operator=(const APIHelper&);
   APIHelper(APIHelper&&);
   APIHelper& operator=(APIHelper&&);
+
+  std::unique_ptr<MatrixReceiver> matrix_receiver_;
 };
 
 }  // namespace maidsafe
@@ -0,0 +1,203 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "models/matrix_receiver.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "boost/date_time/posix_time/posix_time.hpp"
+
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace {
+
+namespace bi = boost::interprocess;
+
+// Large enough for a snapshot of any node's matrix.
+const size_t kMaxMessageSize(64 * 1024);
+const size_t kMaxMessages(4096);
+const std::chrono::minutes kChurnWindow(1);
+
+}  // unnamed namespace
+
+const char kClusterNamePrefix[] = "cluster_";
+
+MatrixReceiver::MatrixReceiver(UpdateFunctor update_functor,
+                               std::chrono::milliseconds notify_interval)
+    : kUpdateFunctor_(update_functor),
+      kNotifyInterval_(notify_interval),
+      message_queue_(),
+      mutex_(),
+      model_(),
+      changed_at_(),
+      churn_(),
+      stop_(false),
+      receiver_() {
+  bi::message_queue::remove(routing::kMatrixUpdateQueueName);
+  message_queue_.reset(new bi::message_queue(bi::create_only, routing::kMatrixUpdateQueueName,
+                                             kMaxMessages, kMaxMessageSize));
+  receiver_ = std::thread([this] { Receive(); });
+}
+
+MatrixReceiver::~MatrixReceiver() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  receiver_.join();
+  message_queue_.reset();
+  bi::message_queue::remove(routing::kMatrixUpdateQueueName);
+}
+
+uint64_t MatrixReceiver::version() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return model_.version();
+}
+
+std::vector<std::string> MatrixReceiver::Nodes() const {
+  std::vector<NodeId> node_ids;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    node_ids = model_.Nodes();
+  }
+  std::vector<std::string> nodes;
+  nodes.reserve(node_ids.size());
+  for (const auto& node_id : node_ids)
+    nodes.push_back(node_id.ToStringEncoded(NodeId::EncodingType::kHex));
+  return nodes;
+}
+
+std::vector<ViewerNode> MatrixReceiver::CloseNodes(const std::string& id) const {
+  const NodeId kNodeId(id, NodeId::EncodingType::kHex);
+  routing::MatrixRow row;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    row = model_.Row(kNodeId);
+  }
+  std::vector<std::pair<NodeId, network_viewer::ChildType>> peers(row.begin(), row.end());
+  std::sort(peers.begin(), peers.end(),
+            [&kNodeId](const std::pair<NodeId, network_viewer::ChildType>& lhs,
+                       const std::pair<NodeId, network_viewer::ChildType>& rhs) {
+    return NodeId::CloserToTarget(lhs.first, rhs.first, kNodeId);
+  });
+  std::vector<ViewerNode> close_nodes(peers.size());
+  for (size_t i(0); i != peers.size(); ++i) {
+    close_nodes[i].id = peers[i].first.ToStringEncoded(NodeId::EncodingType::kHex);
+    close_nodes[i].distance =
+        (peers[i].first ^ kNodeId).ToStringEncoded(NodeId::EncodingType::kHex);
+    close_nodes[i].type = peers[i].second;
+  }
+  return close_nodes;
+}
+
+std::vector<ViewerCluster> MatrixReceiver::Clusters(size_t cluster_size,
+                                                    const std::set<std::string>& expanded) const {
+  std::vector<routing::MatrixCluster> clusters;
+  std::deque<std::pair<std::chrono::steady_clock::time_point, NodeId>> churn;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clusters = routing::ClusterMatrix(
+        model_, routing::ClusterPrefixBits(model_.Nodes().size(), cluster_size), expanded);
+    PruneChurn(std::chrono::steady_clock::now());
+    churn = churn_;
+  }
+  std::map<std::string, std::string> names;
+  for (const auto& cluster : clusters) {
+    names[cluster.prefix] = cluster.nodes.size() == 1
+                                ? cluster.nodes.front().ToStringEncoded(NodeId::EncodingType::kHex)
+                                : kClusterNamePrefix + cluster.prefix;
+  }
+  std::vector<ViewerCluster> viewer_clusters(clusters.size());
+  for (size_t i(0); i != clusters.size(); ++i) {
+    viewer_clusters[i].name = names[clusters[i].prefix];
+    viewer_clusters[i].prefix = clusters[i].prefix;
+    viewer_clusters[i].size = clusters[i].nodes.size();
+    for (const auto& link : clusters[i].links)
+      viewer_clusters[i].links[names[link.first]] = link.second;
+    const std::string& prefix(clusters[i].prefix);
+    viewer_clusters[i].churn_per_minute = static_cast<double>(
+        std::count_if(churn.begin(), churn.end(),
+                      [&prefix](const std::pair<std::chrono::steady_clock::time_point, NodeId>&
+                                    event) { return routing::HasPrefix(event.second, prefix); }));
+  }
+  return viewer_clusters;
+}
+
+bool MatrixReceiver::ChangedSince(uint64_t version, const std::string& id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr(changed_at_.find(NodeId(id, NodeId::EncodingType::kHex)));
+  return itr != changed_at_.end() && itr->second > version;
+}
+
+void MatrixReceiver::Receive() {
+  std::string buffer(kMaxMessageSize, '\0');
+  routing::MatrixUpdate update;
+  uint64_t notified_version(0);
+  auto next_notification(std::chrono::steady_clock::now() + kNotifyInterval_);
+  for (;;) {
+    uint64_t version(0);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_)
+        return;
+      version = model_.version();
+    }
+    auto now(std::chrono::steady_clock::now());
+    if (now >= next_notification) {
+      if (version != notified_version) {
+        kUpdateFunctor_(version);
+        notified_version = version;
+      }
+      next_notification = now + kNotifyInterval_;
+    }
+
+    // Woken at least every notify interval, so that the last updates of a burst are notified.
+    bi::message_queue::size_type received_size(0);
+    unsigned int priority(0);
+    auto timeout(boost::posix_time::microsec_clock::universal_time() +
+                 boost::posix_time::milliseconds(kNotifyInterval_.count()));
+    if (!message_queue_->timed_receive(&buffer[0], buffer.size(), received_size, priority,
+                                       timeout)) {
+      continue;
+    }
+    if (!routing::MatrixUpdate::Parse(buffer.substr(0, received_size), update)) {
+      LOG(kWarning) << "Received a malformed matrix update";
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    routing::MatrixModel::ApplyResult result(model_.Apply(update));
+    if (result == routing::MatrixModel::ApplyResult::kIgnored)
+      continue;
+    changed_at_[update.node_id] = model_.version();
+    if (result != routing::MatrixModel::ApplyResult::kApplied) {
+      now = std::chrono::steady_clock::now();
+      churn_.emplace_back(now, update.node_id);
+      PruneChurn(now);
+    }
+  }
+}
+
+void MatrixReceiver::PruneChurn(std::chrono::steady_clock::time_point now) const {
+  while (!churn_.empty() && churn_.front().first + kChurnWindow < now)
+    churn_.pop_front();
+}
+
+}  // namespace maidsafe
@@ -0,0 +1,106 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_MATRIX_RECEIVER_H_
+#define MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_MATRIX_RECEIVER_H_
+
+// std
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/interprocess/ipc/message_queue.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/tools/network_viewer.h"
+
+#include "maidsafe/routing/matrix_clusters.h"
+#include "maidsafe/routing/matrix_update.h"
+
+namespace maidsafe {
+
+// A peer of a node, as drawn by the graph.  IDs and distances are hex encoded, and the distance is
+// from the node whose peer this is.
+struct ViewerNode {
+  ViewerNode() : id(), distance(), type(network_viewer::ChildType::kMatrix) {}
+  std::string id, distance;
+  network_viewer::ChildType type;
+};
+
+// A routing::MatrixCluster as drawn by the overview graph.
+struct ViewerCluster {
+  ViewerCluster() : name(), prefix(), size(0), churn_per_minute(0.0), links() {}
+  // The graph node's name: a lone node's hex ID, or else kClusterNamePrefix and the prefix.
+  std::string name, prefix;
+  size_t size;
+  double churn_per_minute;  // nodes joining or leaving the cluster, over the last minute
+  std::map<std::string, size_t> links;  // by name
+};
+
+extern const char kClusterNamePrefix[];
+
+// Creates the queue routing nodes send their MatrixUpdates to, and applies each to a
+// routing::MatrixModel as it arrives.  |update_functor| is passed the model's version at most once
+// per |notify_interval|, from the receiving thread, and only once something has changed.
+class MatrixReceiver {
+ public:
+  typedef std::function<void(uint64_t version)> UpdateFunctor;
+
+  MatrixReceiver(UpdateFunctor update_functor, std::chrono::milliseconds notify_interval);
+  ~MatrixReceiver();
+  uint64_t version() const;
+  std::vector<std::string> Nodes() const;
+  // Sorted closest to |id| first.
+  std::vector<ViewerNode> CloseNodes(const std::string& id) const;
+  // The overview: the network split into clusters of about |cluster_size| nodes, further split
+  // where their prefixes are in |expanded|.
+  std::vector<ViewerCluster> Clusters(size_t cluster_size,
+                                      const std::set<std::string>& expanded) const;
+  // Whether |id|'s row has changed (or it has left) since the model was at |version|.
+  bool ChangedSince(uint64_t version, const std::string& id) const;
+
+ private:
+  MatrixReceiver(const MatrixReceiver&);
+  MatrixReceiver& operator=(const MatrixReceiver&);
+  void Receive();
+  void PruneChurn(std::chrono::steady_clock::time_point now) const;
+
+  const UpdateFunctor kUpdateFunctor_;
+  const std::chrono::milliseconds kNotifyInterval_;
+  std::unique_ptr<boost::interprocess::message_queue> message_queue_;
+  mutable std::mutex mutex_;
+  routing::MatrixModel model_;
+  // The model version at which each node's row last changed
+  std::map<NodeId, uint64_t> changed_at_;
+  // Each node's joining or leaving within the last minute, oldest first
+  mutable std::deque<std::pair<std::chrono::steady_clock::time_point, NodeId>> churn_;
+  bool stop_;
+  std::thread receiver_;
+};
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TOOLS_NETWORK_VIEWER_MODELS_MATRIX_RECEIVER_H_
@@ -24,10 +24,21 @@ var mainCanvas = arbor.ParticleSystem(50, 512, 0.5);
 
 function setContent(text) {
   var network = parse(text);
+  var splitFrom = {};
   $.each(network.nodes, function (nname, ndata) {
     if (ndata.label === undefined) ndata.label = nname;
+    // A newly split cluster starts where its parent was, so that the rest of the layout holds.
+    if (ndata.parentCluster !== undefined && mainCanvas.getNode(nname) === undefined) {
+      var parent = mainCanvas.getNode(ndata.parentCluster);
+      if (parent !== undefined) splitFrom[nname] = parent.p;
+    }
   });
   mainCanvas.merge(network);
+  $.each(splitFrom, function (nname, p) {
+    var node = mainCanvas.getNode(nname);
+    if (node !== undefined)
+      node.p = arbor.Point(p.x + Math.random() - 0.5, p.y + Math.random() - 0.5);
+  });
   mainCanvas.renderer.redraw();
 }
 
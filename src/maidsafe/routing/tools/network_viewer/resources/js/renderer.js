@@ -62,6 +62,32 @@
         }
       },
 
+      clusterRadius: function(node) {
+        return 18 + 6 * Math.sqrt(node.data.clusterSize);
+      },
+
+      // A cluster of the overview: a circle sized by its node count, labelled with its ID prefix
+      // (taken from its name, as the parser would turn the prefix into a number), its node count
+      // and its churn over the last minute, redder the higher that is.
+      drawCluster: function(node, pt) {
+        var r = that.clusterRadius(node);
+        var prefix = node.name.substr(node.name.indexOf("_") + 1);
+        var churnRatio = Math.min(1, (node.data.churn || 0) / node.data.clusterSize);
+        ctx.save();
+        ctx.beginPath();
+        ctx.arc(Math.floor(pt.x), Math.floor(pt.y), r, 0, 2 * Math.PI);
+        ctx.fillStyle = "rgb(" + Math.floor(60 + 160 * churnRatio) + ",90,140)";
+        ctx.fill();
+        ctx.font = "12px Courier";
+        ctx.textAlign = "center";
+        ctx.fillStyle = "white";
+        if (prefix.length > 12) prefix = "..." + prefix.substr(prefix.length - 12);
+        ctx.fillText(prefix || "*", pt.x, pt.y - 8);
+        ctx.fillText(node.data.clusterSize + " nodes", pt.x, pt.y + 6);
+        ctx.fillText((node.data.churn || 0) + "/min", pt.x, pt.y + 20);
+        ctx.restore();
+      },
+
       redraw: function() {
         if (!particleSystem) return
 
@@ -75,6 +101,13 @@
 
           // determine the box size and round off the coords if we'll be 
           // drawing a text label (awful alignment jitter otherwise...)
+          if (node.data.clusterSize !== undefined && node.data.clusterSize > 1) {
+            that.drawCluster(node, pt);
+            var r = that.clusterRadius(node);
+            nodeBoxes[node.name] = [pt.x - r, pt.y - r, r * 2, r * 2];
+            return;
+          }
+
           var label = node.data.label || "";
           var prefixNodeId = label.substr(0, 6) || "";
           var suffixNodeId = label.substr(label.length - 6, 6) || "";
@@ -159,7 +192,7 @@
           // pt2:  {x:#, y:#}  target position in screen coords
 
           //var weight = edge.data.weight
-          var weight = 1;
+          var weight = edge.data.linkCount ? 1 + Math.log(edge.data.linkCount) : 1;
           var arrowWeight = !isNaN(weight) ? parseFloat(weight) : 1;
           var arrowLength = 8 + arrowWeight;
           var arrowWidth = 6 + arrowWeight;
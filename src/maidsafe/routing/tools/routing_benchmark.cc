@@ -0,0 +1,341 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+// Microbenchmarks of the routing table and group matrix, loaded to their configured sizes.  Each
+// operation is timed alone and then again while reader threads call GetNodeForSendingMessage on the
+// same table, and reported as nanoseconds and heap allocations per call.  Then each type of message
+// is serialised, parsed and forwarded both ways a vault can forward it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>  // NOLINT
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/program_options.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/routing/client_routing_table.h"
+#include "maidsafe/routing/group_matrix.h"
+#include "maidsafe/routing/matrix_change.h"
+#include "maidsafe/routing/message_header.h"
+#include "maidsafe/routing/network_statistics.h"
+#include "maidsafe/routing/node_info.h"
+#include "maidsafe/routing/parameters.h"
+#include "maidsafe/routing/route_history.h"
+#include "maidsafe/routing/routing.pb.h"
+#include "maidsafe/routing/routing_table.h"
+#include "maidsafe/routing/tests/test_utils.h"
+
+namespace po = boost::program_options;
+
+namespace {
+
+// Counted per thread, so that readers' allocations aren't put down to the benchmarked operation.
+thread_local uint64_t g_allocations(0);
+
+}  // unnamed namespace
+
+void* operator new(std::size_t size) {
+  ++g_allocations;
+  if (void* pointer = std::malloc(size == 0 ? 1 : size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace benchmark {
+
+namespace {
+
+struct Options {
+  Options() : filter(), duration(500), readers(0) {}
+  std::string filter;
+  std::chrono::milliseconds duration;
+  unsigned readers;
+};
+
+// Calls |operation| repeatedly for |options.duration|, with |readers| threads meanwhile calling
+// |reader|, and prints the mean time per call of |operation|.
+void Run(const Options& options, const std::string& name, unsigned readers,
+         const std::function<void(uint64_t)>& operation, const std::function<void()>& reader) {
+  if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+    return;
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> reader_threads;
+  for (unsigned i(0); i != readers; ++i) {
+    reader_threads.push_back(std::thread([&] {
+      while (!stop)
+        reader();
+    }));
+  }
+  // Checking the clock only every kBatch calls keeps its cost out of the faster operations.
+  const uint64_t kBatch(64);
+  uint64_t calls(0);
+  const uint64_t kAllocationsBefore(g_allocations);
+  const auto kStart(std::chrono::steady_clock::now());
+  auto elapsed(std::chrono::steady_clock::duration::zero());
+  while (elapsed < options.duration) {
+    for (uint64_t i(0); i != kBatch; ++i)
+      operation(calls++);
+    elapsed = std::chrono::steady_clock::now() - kStart;
+  }
+  const uint64_t kAllocations(g_allocations - kAllocationsBefore);
+  stop = true;
+  for (auto& reader_thread : reader_threads)
+    reader_thread.join();
+  const auto kNanoseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  std::cout << std::left << std::setw(48) << name << std::right << std::setw(8) << readers
+            << std::setw(12) << calls << std::setw(14) << std::fixed << std::setprecision(1)
+            << static_cast<double>(kNanoseconds) / static_cast<double>(calls) << std::setw(14)
+            << static_cast<double>(kAllocations) / static_cast<double>(calls) << '\n';
+}
+
+// As above, alone and then with |options.readers| readers if any were asked for.
+void RunSingleAndContended(const Options& options, const std::string& name,
+              const std::function<void(uint64_t)>& operation, const std::function<void()>& reader) {
+  Run(options, name, 0, operation, reader);
+  if (options.readers != 0)
+    Run(options, name, options.readers, operation, reader);
+}
+
+std::vector<NodeId> RandomIds(size_t count) {
+  std::vector<NodeId> ids;
+  for (size_t i(0); i != count; ++i)
+    ids.push_back(NodeId(NodeId::kRandomId));
+  return ids;
+}
+
+// A random ID sharing its first eight bytes with |holder|, far closer to it than random peers are
+NodeId NearbyId(const NodeId& holder) {
+  return holder ^ NodeId(std::string(8, '\0') + RandomString(NodeId::kSize - 8));
+}
+
+// The group matrix rows are made up of close nodes only, so they are drawn from near |holder|.
+std::vector<NodeInfo> MakeRow(const NodeId& holder) {
+  std::vector<NodeInfo> row;
+  for (uint16_t i(0); i != Parameters::closest_nodes_size; ++i) {
+    NodeInfo node;
+    node.node_id = NearbyId(holder);
+    row.push_back(node);
+  }
+  return row;
+}
+
+void BenchmarkRoutingTable(const Options& options) {
+  const NodeId kNodeId(NodeId::kRandomId);
+  NetworkStatistics network_statistics(kNodeId);
+  RoutingTable routing_table(false, kNodeId, asymm::GenerateKeyPair(), network_statistics);
+  routing_table.InitialiseFunctors([](int) {}, [](const NodeInfo&, bool) {}, []() {},
+                                  [](std::vector<NodeInfo>, std::vector<NodeInfo>) {},
+                                  [](std::shared_ptr<MatrixChange>) {});
+  std::vector<NodeInfo> peers;
+  // Adding more than the table holds leaves it full, as a long-running vault's is.
+  for (uint16_t i(0); i != 2 * Parameters::max_routing_table_size; ++i)
+    routing_table.AddNode(test::MakeNode());
+  routing_table.VisitClosestNodes(kNodeId, static_cast<uint16_t>(routing_table.size()),
+                                  [&peers](const NodeInfo& node_info) {
+                                    peers.push_back(node_info);
+                                    return true;
+                                  });
+  for (size_t i(0); i != std::min<size_t>(peers.size(), Parameters::closest_nodes_size); ++i)
+    routing_table.GroupUpdateFromConnectedPeer(peers[i].node_id, MakeRow(peers[i].node_id));
+  std::cout << "Routing table of " << routing_table.size() << " peers\n";
+
+  const std::vector<NodeId> kTargets(RandomIds(1024));
+  auto target([&kTargets](uint64_t call) { return kTargets[call % kTargets.size()]; });
+  std::function<void()> reader([&] {
+    routing_table.GetNodeForSendingMessage(NodeId(NodeId::kRandomId), ExcludedNodes(), false);
+  });
+
+  // The furthest peers, which are dropped and re-added without disturbing the close group
+  const std::vector<NodeInfo> kFurthest(peers.end() - std::min<size_t>(peers.size(), 16),
+                                        peers.end());
+  if (!kFurthest.empty()) {
+    RunSingleAndContended(options, "RoutingTable::DropNode+AddNode", [&](uint64_t call) {
+      const NodeInfo& peer(kFurthest[call % kFurthest.size()]);
+      routing_table.DropNode(peer.node_id, true);
+      routing_table.AddNode(peer);
+    }, reader);
+  }
+  RunSingleAndContended(options, "RoutingTable::GetNodeForSendingMessage", [&](uint64_t call) {
+    routing_table.GetNodeForSendingMessage(target(call), ExcludedNodes(), false);
+  }, reader);
+  RunSingleAndContended(options, "RoutingTable::GetClosestNodes", [&](uint64_t call) {
+    routing_table.GetClosestNodes(target(call), Parameters::group_size);
+  }, reader);
+  RunSingleAndContended(options, "RoutingTable::IsNodeIdInGroupRange", [&](uint64_t call) {
+    routing_table.IsNodeIdInGroupRange(target(call));
+  }, reader);
+}
+
+void BenchmarkClientRoutingTable(const Options& options) {
+  const NodeId kNodeId(NodeId::kRandomId);
+  ClientRoutingTable client_routing_table(kNodeId);
+  // Clients are only accepted from within the close group's range, here taken to be all of it.
+  const NodeId kFurthestCloseNode(NodeId::kMaxId);
+  std::vector<NodeInfo> clients;
+  for (uint16_t i(0); i != Parameters::max_client_routing_table_size; ++i) {
+    NodeInfo client(test::MakeNode());
+    client.node_id = NearbyId(kNodeId);
+    if (client_routing_table.AddNode(client, kFurthestCloseNode))
+      clients.push_back(client);
+  }
+  std::cout << "Client routing table of " << client_routing_table.size() << " clients\n";
+  if (clients.empty())
+    return;
+  RunSingleAndContended(options, "ClientRoutingTable::DropNodes+AddNode", [&](uint64_t call) {
+    NodeInfo client(clients[call % clients.size()]);
+    client_routing_table.DropNodes(client.node_id);
+    client_routing_table.AddNode(client, kFurthestCloseNode);
+  }, [&] { client_routing_table.Contains(clients.front().node_id); });
+}
+
+void BenchmarkGroupMatrix(const Options& options) {
+  const NodeId kNodeId(NodeId::kRandomId);
+  GroupMatrix group_matrix(kNodeId, false);
+  std::vector<NodeInfo> peers(MakeRow(kNodeId));
+  for (const auto& peer : peers) {
+    group_matrix.AddConnectedPeer(peer);
+    group_matrix.UpdateFromConnectedPeer(peer.node_id, MakeRow(peer.node_id),
+                                         group_matrix.GetUniqueNodeIds());
+  }
+  std::cout << "Group matrix of " << group_matrix.GetUniqueNodeIds().size() << " unique nodes\n";
+
+  // Each update swaps a row between two versions differing in one node, so that every one is a
+  // real change.
+  std::vector<std::vector<NodeInfo>> rows;
+  for (const auto& peer : peers) {
+    std::vector<NodeInfo> row(MakeRow(peer.node_id));
+    rows.push_back(row);
+    row.back().node_id = NearbyId(peer.node_id);
+    rows.push_back(row);
+  }
+  // GroupMatrix relies on RoutingTable for its locking, so is only benchmarked single-threaded.
+  std::shared_ptr<MatrixChange> matrix_change;
+  Run(options, "GroupMatrix::UpdateFromConnectedPeer", 0, [&](uint64_t call) {
+    const size_t kIndex(static_cast<size_t>(call % rows.size()));
+    matrix_change = group_matrix.UpdateFromConnectedPeer(peers[kIndex / 2].node_id, rows[kIndex],
+                                                         group_matrix.GetUniqueNodeIds());
+  }, [] {});
+  if (!matrix_change)
+    return;
+
+  const std::vector<NodeId> kTargets(RandomIds(1024));
+  RunSingleAndContended(options, "MatrixChange::CheckHolders", [&](uint64_t call) {
+    matrix_change->CheckHolders(kTargets[call % kTargets.size()]);
+  }, [&] { matrix_change->CheckHolders(NodeId(NodeId::kRandomId)); });
+}
+
+void BenchmarkSerialisation(const Options& options) {
+  const char* const kTypeNames[] = {"ping", "connect", "find_nodes", "connect_success",
+                                    "connect_success_acknowledgement", "remove",
+                                    "closest_nodes_update", "get_group", "node_level_1KiB"};
+  std::vector<protobuf::Message> messages(test::MakeMessageOfEachType(1024));
+  std::vector<std::string> names(std::begin(kTypeNames), std::end(kTypeNames));
+  messages.push_back(test::MakeMessageOfEachType(64 * 1024).back());
+  names.push_back("node_level_64KiB");
+  const NodeId kThisNodeId(NodeId::kRandomId);
+
+  for (size_t i(0); i != messages.size() && i != names.size(); ++i) {
+    const protobuf::Message& message(messages[i]);
+    const std::string kSerialised(message.SerializeAsString());
+    protobuf::Message parsed;
+    Run(options, "Serialise/" + names[i], 0,
+        [&](uint64_t) { message.SerializeAsString(); }, [] {});
+    Run(options, "Parse/" + names[i], 0, [&](uint64_t) { parsed.ParseFromString(kSerialised); },
+        [] {});
+    // Forwarding as Routing::Impl does when it can't take the fast path: parsing into a reused
+    // message, then serialising it again with a hop added.
+    Run(options, "Forward/parsed/" + names[i], 0, [&](uint64_t) {
+      parsed.ParseFromString(kSerialised);
+      parsed.set_hops_to_live(parsed.hops_to_live() - 1);
+      AddToRouteHistory(parsed, kThisNodeId);
+      parsed.SerializeAsString();
+    }, [] {});
+    // As MessageHandler::ForwardAsFarNode does, from the header alone.
+    Run(options, "Forward/header/" + names[i], 0, [&](uint64_t) {
+      MessageHeader header;
+      header.Decode(kSerialised);
+      std::string route_history(header.route_history);
+      AddToRouteHistory(route_history, kThisNodeId);
+      RewriteForwardedMessage(kSerialised, header.hops_to_live - 1, route_history);
+    }, [] {});
+  }
+}
+
+}  // unnamed namespace
+
+}  // namespace benchmark
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+int main(int argc, char** argv) {
+  maidsafe::routing::benchmark::Options options;
+  try {
+    po::options_description options_description("Options");
+    uint64_t duration_ms(static_cast<uint64_t>(options.duration.count()));
+    options_description.add_options()("help,h", "Print this help message.")(
+        "filter", po::value<std::string>(&options.filter),
+        "Only run benchmarks whose names contain this.")(
+        "duration_ms", po::value<uint64_t>(&duration_ms)->default_value(duration_ms),
+        "Milliseconds to run each benchmark for.")(
+        "readers", po::value<unsigned>(&options.readers)->default_value(options.readers),
+        "Reader threads to contend with each benchmark, after it has been run alone.");
+    po::variables_map variables_map;
+    po::store(po::parse_command_line(argc, argv, options_description), variables_map);
+    po::notify(variables_map);
+    if (variables_map.count("help")) {
+      std::cout << options_description << '\n';
+      return 0;
+    }
+    options.duration = std::chrono::milliseconds(duration_ms);
+  }
+  catch (const std::exception& e) {
+    std::cout << "Error: " << e.what() << '\n';
+    return 1;
+  }
+
+  std::cout << std::left << std::setw(48) << "Benchmark" << std::right << std::setw(8) << "Readers"
+            << std::setw(12) << "Calls" << std::setw(14) << "ns/call" << std::setw(14)
+            << "allocs/call" << '\n';
+  maidsafe::routing::benchmark::BenchmarkRoutingTable(options);
+  maidsafe::routing::benchmark::BenchmarkClientRoutingTable(options);
+  maidsafe::routing::benchmark::BenchmarkGroupMatrix(options);
+  maidsafe::routing::benchmark::BenchmarkSerialisation(options);
+  return 0;
+}
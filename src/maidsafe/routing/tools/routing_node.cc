@@ -17,6 +17,8 @@
     use of the MaidSafe Software.                                                                 */
 
 #include <signal.h>
+#include <memory>
+
 #include "boost/filesystem.hpp"
 #include "boost/program_options.hpp"
 
@@ -24,6 +26,8 @@
 #include "maidsafe/common/utils.h"
 
 #include "maidsafe/routing/tools/commands.h"
+#include "maidsafe/routing/tools/key_store.h"
+#include "maidsafe/routing/tools/metrics_exporter.h"
 #include "maidsafe/routing/utils.h"
 
 namespace bptime = boost::posix_time;
@@ -67,6 +71,18 @@ void OptionDependency(const po::variables_map& variables_map, const char* for_wh
   }
 }
 
+maidsafe::routing::test::MetricsSample SampleNode(
+    const maidsafe::routing::test::DemoNodePtr& demo_node) {
+  maidsafe::routing::test::MetricsSample sample;
+  auto routing(demo_node->routing());
+  sample.network_status = routing->network_status();
+  sample.routing_table_size = demo_node->RoutingTable().size();
+  sample.inbound_queue_depths = routing->InboundQueueDepths();
+  sample.cache = routing->GetCacheStatistics();
+  sample.routing = routing->GetStatistics();
+  return sample;
+}
+
 // volatile bool ctrlc_pressed(false);
 //  reported unused (dirvine)
 //  void CtrlCHandler(int /*a*/) {
@@ -91,7 +107,12 @@ int main(int argc, char** argv) {
         "Entry from keys file to use as ID (starts from 0)")(
         "pmids_path", po::value<std::string>()->default_value(fs::path(
                           fs::temp_directory_path(error_code) / "pmids_list.dat").string()),
-        "Path to pmid file");
+        "Path to pmid file")(
+        "daemon,d", po::bool_switch(), "Join, then run without the command prompt until killed")(
+        "metrics_port,m", po::value<uint16_t>()->default_value(0),
+        "Serve Prometheus metrics on this port of 127.0.0.1 (0 for none)")(
+        "metrics_interval", po::value<int>()->default_value(1000),
+        "Milliseconds between samples of the metrics served");
 
     po::variables_map variables_map;
     //     po::store(po::parse_command_line(argc, argv, options_description),
@@ -112,7 +133,10 @@ int main(int argc, char** argv) {
     auto pmids_path(maidsafe::GetPathFromProgramOptions("pmids_path", variables_map, false, true));
     if (fs::exists(pmids_path, error_code)) {
       try {
-        all_keys = maidsafe::passport::detail::ReadKeyChainList(pmids_path);
+        if (maidsafe::routing::test::KeyStore::IsKeyStore(pmids_path))
+          all_keys = maidsafe::routing::test::KeyStore(pmids_path).GetAll();
+        else
+          all_keys = maidsafe::passport::detail::ReadKeyChainList(pmids_path);
       } catch (const std::exception& e) {
         std::cout << "Error: Failed to read key chain list at path : "
                   << pmids_path.string() << ". error : "
@@ -181,7 +205,19 @@ int main(int argc, char** argv) {
     if (!peer.empty()) {
       commands.GetPeer(peer);
     }
-    commands.Run();
+    std::unique_ptr<maidsafe::routing::test::MetricsExporter> metrics_exporter;
+    uint16_t metrics_port(variables_map.at("metrics_port").as<uint16_t>());
+    if (metrics_port != 0) {
+      metrics_exporter.reset(new maidsafe::routing::test::MetricsExporter(
+          metrics_port, [demo_node] { return SampleNode(demo_node); },
+          std::chrono::milliseconds(variables_map.at("metrics_interval").as<int>())));
+      std::cout << "Serving metrics at http://127.0.0.1:" << metrics_exporter->port()
+                << "/metrics" << std::endl;
+    }
+    if (variables_map["daemon"].as<bool>())
+      commands.RunDaemon();
+    else
+      commands.Run();
 
     std::cout << "Node stopped successfully." << std::endl;
   }
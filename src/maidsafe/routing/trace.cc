@@ -0,0 +1,116 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/routing/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+namespace {
+
+const char* EventString(TraceEvent event) {
+  switch (event) {
+    case TraceEvent::kReceived:
+      return "rcvd";
+    case TraceEvent::kSent:
+      return "sent";
+    case TraceEvent::kSendFailed:
+      return "fail";
+    case TraceEvent::kForwarded:
+      return "fwd ";
+    case TraceEvent::kDropped:
+      return "drop";
+    default:
+      return "????";
+  }
+}
+
+}  // unnamed namespace
+
+const size_t TraceRecord::kPeerPrefixSize;
+
+Tracer& Tracer::Instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer() : level_(static_cast<int>(TraceLevel::kOff)), next_index_(0), slots_() {}
+
+void Tracer::Record(TraceEvent event, int32_t message_id, int32_t message_type,
+                    int32_t hops_to_live, const std::string& peer_id) {
+  uint64_t index(next_index_.fetch_add(1, std::memory_order_relaxed));
+  Slot& slot(slots_[index % kCapacity]);
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.record.timestamp = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+  slot.record.message_id = message_id;
+  slot.record.message_type = message_type;
+  slot.record.hops_to_live = hops_to_live;
+  slot.record.event = event;
+  slot.record.peer_prefix.fill(0);
+  std::memcpy(slot.record.peer_prefix.data(), peer_id.data(),
+              std::min(peer_id.size(), TraceRecord::kPeerPrefixSize));
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceRecord> Tracer::GetRecords() const {
+  std::vector<TraceRecord> records;
+  uint64_t end(next_index_.load(std::memory_order_acquire));
+  uint64_t begin(end > kCapacity ? end - kCapacity : 0);
+  for (uint64_t index(begin); index != end; ++index) {
+    const Slot& slot(slots_[index % kCapacity]);
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+      continue;
+    TraceRecord record(slot.record);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) == index + 1)
+      records.push_back(record);
+  }
+  return records;
+}
+
+std::string Tracer::Dump() const {
+  std::ostringstream dump;
+  for (const auto& record : GetRecords()) {
+    dump << record.timestamp << ' ' << EventString(record.event) << " id: " << record.message_id
+         << " type: " << record.message_type << " hops: " << record.hops_to_live << " peer: "
+         << HexEncode(std::string(record.peer_prefix.data(), TraceRecord::kPeerPrefixSize))
+         << '\n';
+  }
+  return dump.str();
+}
+
+void Tracer::Clear() {
+  for (auto& slot : slots_)
+    slot.sequence.store(0, std::memory_order_relaxed);
+  next_index_.store(0, std::memory_order_release);
+}
+
+}  // namespace routing
+
+}  // namespace maidsafe
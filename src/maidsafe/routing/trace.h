@@ -0,0 +1,115 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TRACE_H_
+#define MAIDSAFE_ROUTING_TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Events above this level are compiled out entirely.  Below it, they cost one relaxed atomic load
+// each until a runtime level is set via Tracer::set_level.
+#ifndef MAIDSAFE_ROUTING_TRACE_LEVEL
+#ifdef TESTING
+#define MAIDSAFE_ROUTING_TRACE_LEVEL 2
+#else
+#define MAIDSAFE_ROUTING_TRACE_LEVEL 1
+#endif
+#endif
+
+// True if events at |level| are being recorded.  Use to guard building expensive diagnostics.
+#define ROUTING_TRACE_ENABLED(level)                                            \
+  (static_cast<int>(level) <= MAIDSAFE_ROUTING_TRACE_LEVEL &&                   \
+   maidsafe::routing::Tracer::Instance().enabled(level))
+
+// Records |event| for |message| to or from the peer with raw ID |peer_id|.  Arguments are only
+// evaluated if the event is enabled.
+#define ROUTING_TRACE(level, event, message, peer_id)                                        \
+  do {                                                                                       \
+    if (ROUTING_TRACE_ENABLED(level))                                                        \
+      maidsafe::routing::Tracer::Instance().Record(event, (message).id(), (message).type(),  \
+                                                   (message).hops_to_live(), peer_id);       \
+  } while (false)
+
+namespace maidsafe {
+
+namespace routing {
+
+enum class TraceLevel : int { kOff = 0, kInfo = 1, kVerbose = 2 };
+
+enum class TraceEvent : uint8_t { kReceived = 0, kSent, kSendFailed, kForwarded, kDropped };
+
+// Fixed-size, allocation-free record of one event on the message path.
+struct TraceRecord {
+  TraceRecord()
+      : timestamp(0), message_id(0), message_type(0), hops_to_live(0),
+        event(TraceEvent::kReceived), peer_prefix() {}
+  static const size_t kPeerPrefixSize = 8;
+  uint64_t timestamp;  // nanoseconds of std::chrono::steady_clock
+  int32_t message_id;
+  int32_t message_type;
+  int32_t hops_to_live;
+  TraceEvent event;
+  std::array<char, kPeerPrefixSize> peer_prefix;
+};
+
+// Process-wide ring of the most recent kCapacity trace records.  Recording is lock-free: writers
+// claim slots with a single fetch_add and publish them with a per-slot sequence number, so a record
+// overwritten while being read is skipped by GetRecords rather than returned torn.
+class Tracer {
+ public:
+  static const size_t kCapacity = 4096;
+
+  static Tracer& Instance();
+
+  void set_level(TraceLevel level) { level_.store(static_cast<int>(level)); }
+  bool enabled(TraceLevel level) const {
+    return static_cast<int>(level) <= level_.load(std::memory_order_relaxed);
+  }
+  void Record(TraceEvent event, int32_t message_id, int32_t message_type, int32_t hops_to_live,
+              const std::string& peer_id);
+  // Returns the buffered records, oldest first.
+  std::vector<TraceRecord> GetRecords() const;
+  // Returns the buffered records formatted one per line, oldest first.
+  std::string Dump() const;
+  void Clear();
+
+ private:
+  struct Slot {
+    Slot() : sequence(0), record() {}
+    std::atomic<uint64_t> sequence;  // 1 + index of the record held, or 0 while being written
+    TraceRecord record;
+  };
+
+  Tracer();
+  Tracer(const Tracer&);
+  Tracer& operator=(const Tracer&);
+
+  std::atomic<int> level_;
+  std::atomic<uint64_t> next_index_;
+  std::array<Slot, kCapacity> slots_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TRACE_H_
@@ -0,0 +1,95 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_ROUTING_TRANSPORT_H_
+#define MAIDSAFE_ROUTING_TRANSPORT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "boost/asio/ip/udp.hpp"
+
+#include "maidsafe/common/node_id.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/rudp/managed_connections.h"
+#include "maidsafe/rudp/nat_type.h"
+
+namespace maidsafe {
+
+namespace routing {
+
+// The connections NetworkUtils sends over: the parts of rudp::ManagedConnections which routing
+// uses, with the same return codes and callbacks, so that an in-process SimulatedTransport (see
+// simulated_transport.h) can stand in for rudp.
+class Transport {
+ public:
+  virtual ~Transport() {}
+  virtual int Bootstrap(const std::vector<boost::asio::ip::udp::endpoint>& bootstrap_endpoints,
+                        const rudp::MessageReceivedFunctor& message_received_functor,
+                        const rudp::ConnectionLostFunctor& connection_lost_functor,
+                        const NodeId& this_node_id,
+                        std::shared_ptr<asymm::PrivateKey> private_key,
+                        std::shared_ptr<asymm::PublicKey> public_key,
+                        NodeId& chosen_bootstrap_peer, rudp::NatType& nat_type,
+                        boost::asio::ip::udp::endpoint local_endpoint) = 0;
+  virtual int GetAvailableEndpoint(const NodeId& peer_id,
+                                   const rudp::EndpointPair& peer_endpoint_pair,
+                                   rudp::EndpointPair& this_endpoint_pair,
+                                   rudp::NatType& this_nat_type) = 0;
+  virtual int Add(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+                  const std::string& validation_data) = 0;
+  virtual int MarkConnectionAsValid(const NodeId& peer_id,
+                                    boost::asio::ip::udp::endpoint& new_endpoint) = 0;
+  virtual void Remove(const NodeId& peer_id) = 0;
+  virtual void Send(const NodeId& peer_id, const std::string& message,
+                    const rudp::MessageSentFunctor& message_sent_functor) = 0;
+};
+
+class RudpTransport : public Transport {
+ public:
+  RudpTransport();
+  int Bootstrap(const std::vector<boost::asio::ip::udp::endpoint>& bootstrap_endpoints,
+                const rudp::MessageReceivedFunctor& message_received_functor,
+                const rudp::ConnectionLostFunctor& connection_lost_functor,
+                const NodeId& this_node_id, std::shared_ptr<asymm::PrivateKey> private_key,
+                std::shared_ptr<asymm::PublicKey> public_key, NodeId& chosen_bootstrap_peer,
+                rudp::NatType& nat_type, boost::asio::ip::udp::endpoint local_endpoint) override;
+  int GetAvailableEndpoint(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+                           rudp::EndpointPair& this_endpoint_pair,
+                           rudp::NatType& this_nat_type) override;
+  int Add(const NodeId& peer_id, const rudp::EndpointPair& peer_endpoint_pair,
+          const std::string& validation_data) override;
+  int MarkConnectionAsValid(const NodeId& peer_id,
+                            boost::asio::ip::udp::endpoint& new_endpoint) override;
+  void Remove(const NodeId& peer_id) override;
+  void Send(const NodeId& peer_id, const std::string& message,
+            const rudp::MessageSentFunctor& message_sent_functor) override;
+
+ private:
+  RudpTransport(const RudpTransport&);
+  RudpTransport& operator=(const RudpTransport&);
+
+  rudp::ManagedConnections managed_connections_;
+};
+
+}  // namespace routing
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_ROUTING_TRANSPORT_H_
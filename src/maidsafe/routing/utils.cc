@@ -22,6 +22,7 @@
 
 #include "maidsafe/routing/utils.h"
 
+#include "maidsafe/common/crypto.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/node_id.h"
@@ -31,6 +32,7 @@
 #include "maidsafe/routing/message_handler.h"
 #include "maidsafe/routing/network_utils.h"
 #include "maidsafe/routing/return_codes.h"
+#include "maidsafe/routing/route_history.h"
 #include "maidsafe/routing/routing.pb.h"
 #include "maidsafe/routing/routing_table.h"
 #include "maidsafe/routing/rpcs.h"
@@ -41,11 +43,13 @@ namespace routing {
 
 int AddToRudp(NetworkUtils& network, const NodeId& this_node_id, const NodeId& this_connection_id,
               const NodeId& peer_id, const NodeId& peer_connection_id,
-              rudp::EndpointPair peer_endpoint_pair, bool requestor, bool client) {
+              rudp::EndpointPair peer_endpoint_pair, bool requestor, bool client,
+              bool streamlined, const std::vector<NodeId>& close_ids, bool shortcut) {
   LOG(kVerbose) << "AddToRudp. peer_id : " << DebugId(peer_id)
                 << " , connection id : " << DebugId(peer_connection_id);
-  protobuf::Message connect_success(
-      rpcs::ConnectSuccess(peer_id, this_node_id, this_connection_id, requestor, client));
+  protobuf::Message connect_success(rpcs::ConnectSuccess(
+      peer_id, this_node_id, this_connection_id, requestor, client, streamlined, close_ids,
+      shortcut));
   int result =
       network.Add(peer_connection_id, peer_endpoint_pair, connect_success.SerializeAsString());
   if (result != rudp::kSuccess) {
@@ -58,6 +62,22 @@ int AddToRudp(NetworkUtils& network, const NodeId& this_node_id, const NodeId& t
   return result;
 }
 
+bool OffersStreamlinedHandshake(const NetworkUtils& network, const NodeId& peer_id,
+                                const NodeId& peer_connection_id) {
+  return Parameters::streamlined_handshake &&
+         peer_id != network.bootstrap_connection_id() &&
+         peer_connection_id != network.bootstrap_connection_id();
+}
+
+std::vector<NodeId> CloseIdsForPeer(RoutingTable& routing_table, const NodeId& peer_id,
+                                    bool peer_is_client) {
+  std::vector<NodeId> close_ids(routing_table.GetClosestNodes(
+      peer_id, peer_is_client ? Parameters::max_routing_table_size_for_client
+                              : routing_table.kGreedyFraction()));
+  close_ids.erase(std::remove(close_ids.begin(), close_ids.end(), peer_id), close_ids.end());
+  return close_ids;
+}
+
 bool ValidateAndAddToRoutingTable(NetworkUtils& network, RoutingTable& routing_table,
                                   ClientRoutingTable& client_routing_table,
                                   const NodeId& peer_id, const NodeId& connection_id,
@@ -76,11 +96,7 @@ bool ValidateAndAddToRoutingTable(NetworkUtils& network, RoutingTable& routing_t
   peer.connection_id = connection_id;
   bool routing_accepted_node(false);
   if (client) {
-    NodeId furthest_close_node_id =
-        routing_table.GetNthClosestNode(NodeId(routing_table.kNodeId()),
-                                        2 * Parameters::closest_nodes_size).node_id;
-
-    if (client_routing_table.AddNode(peer, furthest_close_node_id))
+    if (client_routing_table.AddNode(peer, routing_table.FurthestClientRangeNode()))
       routing_accepted_node = true;
   } else {  // Vaults
     if (routing_table.AddNode(peer, matrix_update))
@@ -128,9 +144,13 @@ void HandleSymmetricNodeAdd(RoutingTable& /*routing_table*/, const NodeId& /*pee
   //  }
 }
 
+std::string PublicKeyFingerprint(const asymm::PublicKey& public_key) {
+  return crypto::Hash<crypto::SHA1>(asymm::EncodeKey(public_key).string()).string();
+}
+
 GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id,
                                   const NodeId& this_node_id,
-                                  const crypto::BigInt& proximity_radius,
+                                  const DistanceUint& proximity_radius,
                                   const std::vector<NodeId>& holders) {
   assert((std::find(holders.begin(), holders.end(), target_id) == holders.end()) &&
          "Ensure to remove target id entry from holders, if present");
@@ -148,9 +168,7 @@ GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id
     return GroupRangeStatus::kInRange;
   }
 
-  NodeId distance_id(node_id ^ target_id);
-  crypto::BigInt distance((distance_id.ToStringEncoded(NodeId::EncodingType::kHex) + 'h').c_str());
-  return (distance < proximity_radius) ? GroupRangeStatus::kInProximalRange
+  return (DistanceUint(node_id, target_id) < proximity_radius) ? GroupRangeStatus::kInProximalRange
                                        : GroupRangeStatus::kOutwithRange;
 }
 
@@ -176,6 +194,20 @@ bool IsCacheablePut(const protobuf::Message& message) {
           (static_cast<Cacheable>(message.cacheable()) == Cacheable::kPut));
 }
 
+void SetDeadline(protobuf::Message& message, std::chrono::steady_clock::duration timeout) {
+  if (Parameters::message_deadlines) {
+    message.set_deadline(
+        GetTimeStamp() +
+        std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+  }
+}
+
+bool DeadlinePassed(uint64_t deadline) {
+  return GetTimeStamp() >
+         deadline + std::chrono::duration_cast<std::chrono::milliseconds>(
+                        Parameters::message_deadline_tolerance).count();
+}
+
 bool IsClientToClientMessageWithDifferentNodeIds(const protobuf::Message& message,
                                                  const bool is_destination_client) {
   return (is_destination_client && message.request() && message.client_node() &&
@@ -192,12 +224,9 @@ bool ValidateMessage(const protobuf::Message& message) {
 
   // Message has traversed more hops than expected
   if (message.hops_to_live() <= 0) {
-    std::string route_history;
-    for (const auto& route : message.route_history())
-      route_history += HexSubstr(route) + ", ";
     LOG(kError) << "Message has traversed more hops than expected. "
                 << Parameters::max_route_history
-                << " last hops in route history are: " << route_history
+                << " last hops in route history are: " << RouteHistoryDebugString(message)
                 << " \nMessage source: " << HexSubstr(message.source_id())
                 << ", \nMessage destination: " << HexSubstr(message.destination_id())
                 << ", \nMessage type: " << message.type() << ", \nMessage id: " << message.id();
@@ -287,6 +316,9 @@ std::string MessageTypeString(const protobuf::Message& message) {
     case MessageType::kGetGroup:
       message_type = "kGetGroup";
       break;
+    case MessageType::kLeave:
+      message_type = "kLeave";
+      break;
     case MessageType::kNodeLevel:
       message_type = "kNodeLevel";
       break;
@@ -385,37 +417,66 @@ std::string SerializeNodeIdList(const std::vector<NodeId>& node_list) {
   return node_list_msg.SerializeAsString();
 }
 
-SingleToSingleMessage CreateSingleToSingleMessage(const protobuf::Message& proto_message) {
-  return SingleToSingleMessage(proto_message.data(0),
+std::string SerializeMessageBatch(const std::vector<std::string>& serialised_messages) {
+  protobuf::MessageBatch batch;
+  for (const auto& serialised_message : serialised_messages)
+    batch.add_messages(serialised_message);
+  return std::string(1, '\0') + batch.SerializeAsString();
+}
+
+bool IsMessageBatch(const std::string& serialised) {
+  return !serialised.empty() && serialised[0] == '\0';
+}
+
+bool ParseMessageBatch(const std::string& serialised, std::vector<std::string>& messages) {
+  protobuf::MessageBatch batch;
+  if (!IsMessageBatch(serialised) ||
+      !batch.ParseFromArray(serialised.data() + 1, static_cast<int>(serialised.size() - 1)))
+    return false;
+  messages.resize(batch.messages_size());
+  for (int i(0); i != batch.messages_size(); ++i)
+    messages[i].swap(*batch.mutable_messages(i));
+  return true;
+}
+
+namespace {
+
+SingleToSingleMessage MakeSingleToSingleMessage(const protobuf::Message& proto_message,
+                                                std::string contents) {
+  return SingleToSingleMessage(std::move(contents),
                                SingleSource(NodeId(proto_message.source_id())),
                                SingleId(NodeId(proto_message.destination_id())),
                                static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-SingleToGroupMessage CreateSingleToGroupMessage(const protobuf::Message& proto_message) {
-  return SingleToGroupMessage(proto_message.data(0),
+SingleToGroupMessage MakeSingleToGroupMessage(const protobuf::Message& proto_message,
+                                              std::string contents) {
+  return SingleToGroupMessage(std::move(contents),
                               SingleSource(NodeId(proto_message.source_id())),
                               GroupId(NodeId(proto_message.group_destination())),
                               static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-GroupToSingleMessage CreateGroupToSingleMessage(const protobuf::Message& proto_message) {
-  return GroupToSingleMessage(proto_message.data(0),
+GroupToSingleMessage MakeGroupToSingleMessage(const protobuf::Message& proto_message,
+                                              std::string contents) {
+  return GroupToSingleMessage(std::move(contents),
                               GroupSource(GroupId(NodeId(proto_message.group_source())),
                                           SingleId(NodeId(proto_message.source_id()))),
                               SingleId(NodeId(proto_message.destination_id())),
                               static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-GroupToGroupMessage CreateGroupToGroupMessage(const protobuf::Message& proto_message) {
-  return GroupToGroupMessage(proto_message.data(0),
+GroupToGroupMessage MakeGroupToGroupMessage(const protobuf::Message& proto_message,
+                                            std::string contents) {
+  return GroupToGroupMessage(std::move(contents),
                              GroupSource(GroupId(NodeId(proto_message.group_source())),
                                          SingleId(NodeId(proto_message.source_id()))),
                              GroupId(NodeId(proto_message.group_destination())),
                              static_cast<Cacheable>(proto_message.cacheable()));
 }
 
-SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Message& proto_message) {
+SingleToGroupRelayMessage MakeSingleToGroupRelayMessage(const protobuf::Message& proto_message,
+                                                        std::string contents) {
   SingleSource single_src(NodeId(proto_message.relay_id()));
   NodeId connection_id(proto_message.relay_connection_id());
   SingleSource single_src_relay_node(NodeId(proto_message.source_id()));
@@ -423,19 +484,63 @@ SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Messag
                                      connection_id,
                                      single_src_relay_node);
 
-  return SingleToGroupRelayMessage(proto_message.data(0),
+  return SingleToGroupRelayMessage(std::move(contents),
       single_relay_src,  // relay node
           GroupId(NodeId(proto_message.group_destination())),
               static_cast<Cacheable>(proto_message.cacheable()));
+}
+
+// Leaves the payload of |proto_message| empty.
+std::string ReleaseContents(protobuf::Message& proto_message) {
+  return std::move(*proto_message.mutable_data(0));
+}
+
+}  // unnamed namespace
+
+SingleToSingleMessage CreateSingleToSingleMessage(const protobuf::Message& proto_message) {
+  return MakeSingleToSingleMessage(proto_message, proto_message.data(0));
+}
+
+SingleToGroupMessage CreateSingleToGroupMessage(const protobuf::Message& proto_message) {
+  return MakeSingleToGroupMessage(proto_message, proto_message.data(0));
+}
+
+GroupToSingleMessage CreateGroupToSingleMessage(const protobuf::Message& proto_message) {
+  return MakeGroupToSingleMessage(proto_message, proto_message.data(0));
+}
 
-//  return SingleToGroupRelayMessage(proto_message.data(0),
-//      SingleSourceRelay(SingleSource(NodeId(proto_message.relay_id())), // original sender
-//                        NodeId(proto_message.relay_connection_id()),
-//                        SingleSource(NodeId(proto_message.source_id()))),  // relay node
-//          GroupId(NodeId(proto_message.group_destination())),
-//              static_cast<Cacheable>(proto_message.cacheable()));
+GroupToGroupMessage CreateGroupToGroupMessage(const protobuf::Message& proto_message) {
+  return MakeGroupToGroupMessage(proto_message, proto_message.data(0));
+}
+
+SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Message& proto_message) {
+  return MakeSingleToGroupRelayMessage(proto_message, proto_message.data(0));
 }
 
+template <>
+SingleToSingleMessage ReleaseTypedMessage(protobuf::Message& proto_message) {
+  return MakeSingleToSingleMessage(proto_message, ReleaseContents(proto_message));
+}
+
+template <>
+SingleToGroupMessage ReleaseTypedMessage(protobuf::Message& proto_message) {
+  return MakeSingleToGroupMessage(proto_message, ReleaseContents(proto_message));
+}
+
+template <>
+GroupToSingleMessage ReleaseTypedMessage(protobuf::Message& proto_message) {
+  return MakeGroupToSingleMessage(proto_message, ReleaseContents(proto_message));
+}
+
+template <>
+GroupToGroupMessage ReleaseTypedMessage(protobuf::Message& proto_message) {
+  return MakeGroupToGroupMessage(proto_message, ReleaseContents(proto_message));
+}
+
+template <>
+SingleToGroupRelayMessage ReleaseTypedMessage(protobuf::Message& proto_message) {
+  return MakeSingleToGroupRelayMessage(proto_message, ReleaseContents(proto_message));
+}
 
 }  // namespace routing
 
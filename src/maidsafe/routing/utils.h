@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_ROUTING_UTILS_H_
 #define MAIDSAFE_ROUTING_UTILS_H_
 
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,7 @@
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/routing/api_config.h"
+#include "maidsafe/routing/fixed_uint.h"
 #include "maidsafe/routing/node_info.h"
 #include "maidsafe/routing/parameters.h"
 #include "maidsafe/routing/routing.pb.h"
@@ -53,9 +55,25 @@ class NetworkUtils;
 class ClientRoutingTable;
 class RoutingTable;
 
+// |streamlined|, |close_ids| and |shortcut| are carried in the ConnectSuccess given to rudp as
+// validation data.
 int AddToRudp(NetworkUtils& network, const NodeId& this_node_id, const NodeId& this_connection_id,
               const NodeId& peer_id, const NodeId& peer_connection_id,
-              rudp::EndpointPair peer_endpoint_pair, bool requestor, bool client);
+              rudp::EndpointPair peer_endpoint_pair, bool requestor, bool client,
+              bool streamlined = false,
+              const std::vector<NodeId>& close_ids = std::vector<NodeId>(),
+              bool shortcut = false);
+
+// Whether this node offers the streamlined handshake (see Parameters::streamlined_handshake) to the
+// peer.  Never to this node's bootstrap peer, whose connection rudp has already validated.
+bool OffersStreamlinedHandshake(const NetworkUtils& network, const NodeId& peer_id,
+                                const NodeId& peer_connection_id);
+
+// The close IDs a newly connected peer is told of, by either handshake: this node's closest to
+// |peer_id|, bar the peer itself, and only as many as the peer would go on to connect to (see
+// RoutingTable::kGreedyFraction).
+std::vector<NodeId> CloseIdsForPeer(RoutingTable& routing_table, const NodeId& peer_id,
+                                    bool peer_is_client);
 
 bool ValidateAndAddToRoutingTable(
     NetworkUtils& network, RoutingTable& routing_table, ClientRoutingTable& client_routing_table,
@@ -64,9 +82,11 @@ bool ValidateAndAddToRoutingTable(
 
 void HandleSymmetricNodeAdd(RoutingTable& routing_table, const NodeId& peer_id,
                             const asymm::PublicKey& public_key);
+// SHA1 of the encoded key, by which the routing tables index their entries' keys.
+std::string PublicKeyFingerprint(const asymm::PublicKey& public_key);
 GroupRangeStatus GetProximalRange(const NodeId& target_id, const NodeId& node_id,
                                   const NodeId& this_node_id,
-                                  const crypto::BigInt& proximity_radius,
+                                  const DistanceUint& proximity_radius,
                                   const std::vector<NodeId>& holders);
 
 bool IsRoutingMessage(const protobuf::Message& message);
@@ -76,6 +96,10 @@ bool IsResponse(const protobuf::Message& message);
 bool IsDirect(const protobuf::Message& message);
 bool IsCacheableGet(const protobuf::Message& message);
 bool IsCacheablePut(const protobuf::Message& message);
+// Sets |message|'s deadline |timeout| from now, unless Parameters::message_deadlines is unset.
+void SetDeadline(protobuf::Message& message, std::chrono::steady_clock::duration timeout);
+// Whether it is more than Parameters::message_deadline_tolerance past |deadline|.
+bool DeadlinePassed(uint64_t deadline);
 bool IsClientToClientMessageWithDifferentNodeIds(const protobuf::Message& message,
                                                  const bool is_destination_client);
 bool CheckId(const std::string& id_to_test);
@@ -91,11 +115,29 @@ rudp::NatType NatTypeFromProtobuf(const protobuf::NatType& nat_type_proto);
 std::string PrintMessage(const protobuf::Message& message);
 std::vector<NodeId> DeserializeNodeIdList(const std::string& node_list_str);
 std::string SerializeNodeIdList(const std::vector<NodeId>& node_list);
+std::string SerializeMessageBatch(const std::vector<std::string>& serialised_messages);
+bool IsMessageBatch(const std::string& serialised);
+// Returns false if |serialised| is not a valid batch.
+bool ParseMessageBatch(const std::string& serialised, std::vector<std::string>& messages);
 SingleToSingleMessage CreateSingleToSingleMessage(const protobuf::Message& proto_message);
 SingleToGroupMessage CreateSingleToGroupMessage(const protobuf::Message& proto_message);
 GroupToSingleMessage CreateGroupToSingleMessage(const protobuf::Message& proto_message);
 GroupToGroupMessage CreateGroupToGroupMessage(const protobuf::Message& proto_message);
 SingleToGroupRelayMessage CreateSingleToGroupRelayMessage(const protobuf::Message& proto_message);
+// As the Create*Message functions, but moving the payload out of |proto_message| rather than
+// copying it.
+template <typename T>
+T ReleaseTypedMessage(protobuf::Message& proto_message);
+template <>
+SingleToSingleMessage ReleaseTypedMessage(protobuf::Message& proto_message);
+template <>
+SingleToGroupMessage ReleaseTypedMessage(protobuf::Message& proto_message);
+template <>
+GroupToSingleMessage ReleaseTypedMessage(protobuf::Message& proto_message);
+template <>
+GroupToGroupMessage ReleaseTypedMessage(protobuf::Message& proto_message);
+template <>
+SingleToGroupRelayMessage ReleaseTypedMessage(protobuf::Message& proto_message);
 }  // namespace routing
 
 }  // namespace maidsafe